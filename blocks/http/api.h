@@ -25,10 +25,13 @@ SOFTWARE.
 // Current HTTP API provides a generic interface for basic HTTP operations,
 // along with their cross-platform implementations.
 //
-// HTTP server has a POSIX implementation.
+// HTTP server has a POSIX implementation, with two engines: the default one, with a thread blocked on `accept()`,
+// and, on Linux, the `epoll` one, with keep-alive and pipelining. Use `HTTP(port, HTTPServerOptions(...))` to pick.
 // HTTP client has POSIX, MacOS/iOS and Android/Java implementations (the Java one is untested for a while).
 //
 // The user does not have to select the implementation, a suitable one will be selected at compile time.
+//
+// `HTTPAsync(...)` sends the requests from a pool of worker threads, see `async.h`.
 
 #ifndef BLOCKS_HTTP_API_H
 #define BLOCKS_HTTP_API_H
@@ -39,6 +42,7 @@ SOFTWARE.
 #include "response.h"
 #include "types.h"
 #include "favicon.h"
+#include "async.h"
 
 #include "../../bricks/util/singleton.h"
 #include "../../bricks/template/weed.h"
@@ -64,6 +68,7 @@ using HTTP_CLIENT = java_wrapper::HTTPClientPlatformWrapper;
 #endif
 
 using HTTP_IMPL = current::http::HTTPImpl<HTTP_CLIENT, CHUNKED_HTTP_CLIENT, current::http::HTTPServerPOSIX>;
+using HTTP_ASYNC_IMPL = current::http::GenericHTTPAsyncClient<HTTP_IMPL>;
 
 namespace current {
 namespace http {
@@ -73,13 +78,21 @@ inline typename current::weed::call_with_type<HTTP_IMPL, TS...> HTTP(TS&&... par
   return current::Singleton<HTTP_IMPL>()(std::forward<TS>(params)...);
 }
 
+template <typename... TS>
+inline auto HTTPAsync(TS&&... params) {
+  return current::Singleton<HTTP_ASYNC_IMPL>()(std::forward<TS>(params)...);
+}
+
 }  // namespace http
 }  // namespace current
 
 using current::http::HTTP;
+using current::http::HTTPAsync;
 using current::http::Request;
 using current::http::Response;
 using current::http::ReRegisterRoute;
+using current::http::HTTPServerEngine;
+using current::http::HTTPServerOptions;
 using HTTPRoutesScope = typename HTTP_IMPL::server_impl_t::HTTPRoutesScope;
 using HTTPRoutesScopeEntry = current::http::HTTPServerPOSIX::HTTPRoutesScopeEntry;
 
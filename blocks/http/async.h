@@ -0,0 +1,159 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2014 Dmitry "Dima" Korolev, <dmitry.korolev@gmail.com>.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The asynchronous HTTP client: `HTTPAsync(GET(url))` returns an `std::future<>` of the response,
+// `HTTPAsync(GET(url), on_response, on_error)` calls back, and `HTTPAsync(std::vector<POST>(...))` sends a batch.
+//
+// The requests are queued, and sent by a fixed set of worker threads, each sending one request at a time with
+// the regular, blocking, `HTTP(...)`. With the POSIX client, the connections are kept alive in its pool, so a batch
+// of requests to one host goes over as many connections as there are worker threads, instead of one per request.
+// The queued requests are sent before the client is destroyed.
+
+#ifndef BLOCKS_HTTP_ASYNC_H
+#define BLOCKS_HTTP_ASYNC_H
+
+#include "../../port.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+#include "../../bricks/exception.h"
+#include "../../bricks/util/singleton.h"
+
+namespace current {
+namespace http {
+
+template <class HTTP_IMPL_T>
+class GenericHTTPAsyncClient final {
+ public:
+  using on_response_t = std::function<void(HTTPResponseWithBuffer)>;
+  using on_error_t = std::function<void(const current::Exception&)>;
+
+  // The number of worker threads is also the number of connections per host that the requests are sent over.
+  enum { kDefaultWorkerThreads = 8 };
+
+  explicit GenericHTTPAsyncClient(size_t worker_threads = kDefaultWorkerThreads) {
+    for (size_t i = 0u; i < std::max(worker_threads, static_cast<size_t>(1u)); ++i) {
+      threads_.emplace_back([this]() { Thread(); });
+    }
+  }
+
+  ~GenericHTTPAsyncClient() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      terminating_ = true;
+    }
+    condition_variable_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  template <typename REQUEST>
+  std::future<HTTPResponseWithBuffer> operator()(REQUEST request) {
+    auto promise = std::make_shared<std::promise<HTTPResponseWithBuffer>>();
+    std::future<HTTPResponseWithBuffer> future = promise->get_future();
+    Enqueue([promise, request]() {
+      try {
+        promise->set_value(current::Singleton<HTTP_IMPL_T>()(request));
+      } catch (...) {
+        promise->set_exception(std::current_exception());
+      }
+    });
+    return future;
+  }
+
+  // The callbacks are called from the worker threads. The exceptions thrown by `on_response` are not caught.
+  template <typename REQUEST>
+  void operator()(REQUEST request, on_response_t on_response, on_error_t on_error = [](const current::Exception&) {}) {
+    Enqueue([request, on_response, on_error]() {
+      std::unique_ptr<HTTPResponseWithBuffer> response;
+      try {
+        response = std::make_unique<HTTPResponseWithBuffer>(current::Singleton<HTTP_IMPL_T>()(request));
+      } catch (const current::Exception& e) {
+        on_error(e);
+        return;
+      } catch (const std::exception& e) {
+        on_error(current::Exception(e.what()));
+        return;
+      }
+      on_response(std::move(*response));
+    });
+  }
+
+  template <typename REQUEST>
+  std::vector<std::future<HTTPResponseWithBuffer>> operator()(const std::vector<REQUEST>& requests) {
+    std::vector<std::future<HTTPResponseWithBuffer>> futures;
+    futures.reserve(requests.size());
+    for (const REQUEST& request : requests) {
+      futures.push_back(operator()(request));
+    }
+    return futures;
+  }
+
+ private:
+  void Enqueue(std::function<void()> job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(job));
+    }
+    condition_variable_.notify_one();
+  }
+
+  void Thread() {
+    while (true) {
+      std::function<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_variable_.wait(lock, [this]() { return terminating_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        job = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      job();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condition_variable_;
+  std::deque<std::function<void()>> queue_;
+  bool terminating_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace current::http
+}  // namespace current
+
+#endif  // BLOCKS_HTTP_ASYNC_H
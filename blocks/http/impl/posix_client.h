@@ -29,6 +29,7 @@ SOFTWARE.
 #define BLOCKS_HTTP_IMPL_POSIX_CLIENT_H
 
 #include "../types.h"
+#include "posix_client_pool.h"
 
 #include <memory>
 #include <string>
@@ -38,6 +39,8 @@ SOFTWARE.
 
 #include "../../../bricks/net/http/http.h"
 #include "../../../bricks/file/file.h"
+#include "../../../bricks/strings/util.h"
+#include "../../../bricks/util/singleton.h"
 
 namespace current {
 namespace http {
@@ -94,47 +97,34 @@ class GenericHTTPClientPOSIX final {
           port = 80;
         }
       }
-      current::net::Connection connection(
-          current::net::Connection(current::net::ClientSocket(parsed_url.host, port)));
-      connection.BlockingWrite(
-          request_method_ + ' ' + parsed_url.path + parsed_url.ComposeParameters() + " HTTP/1.1\r\n", true);
-      connection.BlockingWrite("Host: " + parsed_url.host + "\r\n", true);
-      if (!request_user_agent_.empty()) {
-        connection.BlockingWrite("User-Agent: " + request_user_agent_ + "\r\n", true);
-      }
-      for (const auto& h : request_headers_) {
-        connection.BlockingWrite(h.header + ": " + h.value + "\r\n", true);
-      }
-      if (!request_headers_.cookies.empty()) {
-        connection.BlockingWrite("Cookie: " + request_headers_.CookiesAsString() + "\r\n", true);
-      }
-      if (!request_body_content_type_.empty()) {
-        connection.BlockingWrite("Content-Type: " + request_body_content_type_ + "\r\n", true);
-      }
-      if (!request_body_contents_.empty() || current::net::NeedContentLengthHeader(request_method_)) {
-        // NOTE(dkorolev): The `try/catch/throw` combo here is a hack for the unit test for HTTP 413 to pass.
-        // It swallows the `SocketWriteException` exception for huge payloads, as Current's HTTP server logic
-        // does intentionally close the HTTP connection prematurely if `Content-Length` exceeds a reasonable limit.
+      // With `keep_alive_`, the connection is taken from the pool, and returned to it if the server agrees.
+      // If a connection from the pool turns out to have been closed by the server, the request is retried
+      // over a new connection, unless it is not idempotent and may have reached the server.
+      const bool keep_alive = keep_alive_ && request_method_ != "HEAD";
+      bool reused = false;
+      std::unique_ptr<current::net::Connection> connection =
+          keep_alive ? current::Singleton<HTTPClientConnectionPool>().Connect(parsed_url.host, port, reused)
+                     : std::make_unique<current::net::Connection>(current::net::ClientSocket(parsed_url.host, port));
+      bool request_fully_sent;
+      while (true) {
         try {
-#ifndef CURRENT_WINDOWS
-          connection.BlockingWrite("Content-Length: " + std::to_string(request_body_contents_.length()) + "\r\n", true);
-          connection.BlockingWrite("\r\n", true);
-          connection.BlockingWrite(request_body_contents_, false);
-#else
-          // TODO(grixa): this fix for the PayloadTooLarge test on Windows is temporary, need to revisit it.
-          connection.BlockingWrite("Content-Length: " + std::to_string(request_body_contents_.length()) + "\r\n\r\n" +
-                                       request_body_contents_,
-                                   false);
-#endif
-        } catch (const net::SocketWriteException&) {
-          if (request_body_contents_.length() <= net::constants::kMaxHTTPPayloadSizeInBytes) {
+          request_fully_sent = SendRequestAndReceiveResponse(*connection, parsed_url);
+          break;
+        } catch (const current::net::SocketWriteException&) {
+          if (!reused) {
+            throw;
+          }
+        } catch (const current::net::SocketException&) {
+          if (!reused || !(request_method_ == "GET" || request_method_ == "PUT" || request_method_ == "DELETE")) {
             throw;
           }
         }
-      } else {
-        connection.BlockingWrite("\r\n", false);
+        connection = std::make_unique<current::net::Connection>(current::net::ClientSocket(parsed_url.host, port));
+        reused = false;
+      }
+      if (keep_alive && request_fully_sent && IsResponseKeptAlive()) {
+        current::Singleton<HTTPClientConnectionPool>().Release(parsed_url.host, port, std::move(connection));
       }
-      http_request_.reset(new CustomHTTPRequestData(connection, request_data_construction_params_));
       // TODO(dkorolev): Rename `Path()`, it's only called so now because of HTTP request/response format.
       // Elaboration:
       // HTTP request  message is: `GET /path HTTP/1.1`, "/path" is the second component of it.
@@ -159,6 +149,63 @@ class GenericHTTPClientPOSIX final {
 
   const CustomHTTPRequestData& HTTPRequest() const { return *http_request_.get(); }
 
+ private:
+  // Sends the request over `connection`, and parses the response into `http_request_`.
+  // Returns `false` if the server has closed the connection before the whole request body was sent.
+  bool SendRequestAndReceiveResponse(current::net::Connection& connection, const URL& parsed_url) {
+    bool request_fully_sent = true;
+    connection.BlockingWrite(
+        request_method_ + ' ' + parsed_url.path + parsed_url.ComposeParameters() + " HTTP/1.1\r\n", true);
+    connection.BlockingWrite("Host: " + parsed_url.host + "\r\n", true);
+    if (!request_user_agent_.empty()) {
+      connection.BlockingWrite("User-Agent: " + request_user_agent_ + "\r\n", true);
+    }
+    for (const auto& h : request_headers_) {
+      connection.BlockingWrite(h.header + ": " + h.value + "\r\n", true);
+    }
+    if (!request_headers_.cookies.empty()) {
+      connection.BlockingWrite("Cookie: " + request_headers_.CookiesAsString() + "\r\n", true);
+    }
+    if (!request_body_content_type_.empty()) {
+      connection.BlockingWrite("Content-Type: " + request_body_content_type_ + "\r\n", true);
+    }
+    if (!request_body_contents_.empty() || current::net::NeedContentLengthHeader(request_method_)) {
+      // NOTE(dkorolev): The `try/catch/throw` combo here is a hack for the unit test for HTTP 413 to pass.
+      // It swallows the `SocketWriteException` exception for huge payloads, as Current's HTTP server logic
+      // does intentionally close the HTTP connection prematurely if `Content-Length` exceeds a reasonable limit.
+      try {
+#ifndef CURRENT_WINDOWS
+        connection.BlockingWrite("Content-Length: " + std::to_string(request_body_contents_.length()) + "\r\n", true);
+        connection.BlockingWrite("\r\n", !request_body_contents_.empty());
+        connection.BlockingWrite(request_body_contents_, false);
+#else
+        // TODO(grixa): this fix for the PayloadTooLarge test on Windows is temporary, need to revisit it.
+        connection.BlockingWrite("Content-Length: " + std::to_string(request_body_contents_.length()) + "\r\n\r\n" +
+                                     request_body_contents_,
+                                 false);
+#endif
+      } catch (const net::SocketWriteException&) {
+        if (request_body_contents_.length() <= net::constants::kMaxHTTPPayloadSizeInBytes) {
+          throw;
+        }
+        request_fully_sent = false;
+      }
+    } else {
+      connection.BlockingWrite("\r\n", false);
+    }
+    http_request_.reset(new CustomHTTPRequestData(connection, request_data_construction_params_));
+    return request_fully_sent;
+  }
+
+  // Whether the server has agreed to keep the connection alive, and the response is framed by its `Content-Length`,
+  // so that nothing of it is left unread on the connection.
+  bool IsResponseKeptAlive() const {
+    const auto& headers = http_request_->headers();
+    return http_request_->Method() == "HTTP/1.1" && headers.Has(current::net::constants::kContentLengthHeaderKey) &&
+           !headers.Has(current::net::constants::kTransferEncodingHeaderKey) &&
+           current::strings::ToLower(headers.GetOrDefault("Connection", "")).find("close") == std::string::npos;
+  }
+
  public:
   // Request parameters.
   std::string request_method_ = "";
@@ -169,6 +216,7 @@ class GenericHTTPClientPOSIX final {
   current::net::http::Headers request_headers_;
   const typename HTTP_HELPER::ConstructionParams request_data_construction_params_;
   bool allow_redirects_ = false;
+  bool keep_alive_ = false;
 
   // Output parameters.
   current::net::HTTPResponseCodeValue response_code_ = HTTPResponseCode.InvalidCode;
@@ -188,6 +236,7 @@ struct ImplWrapper<HTTPClientPOSIX> {
     client.request_user_agent_ = request.custom_user_agent;
     client.request_headers_ = request.custom_headers;
     client.allow_redirects_ = request.allow_redirects;
+    client.keep_alive_ = request.keep_alive;
   }
 
   inline static void PrepareInput(const HEAD& request, HTTPClientPOSIX& client) {
@@ -196,6 +245,7 @@ struct ImplWrapper<HTTPClientPOSIX> {
     client.request_user_agent_ = request.custom_user_agent;
     client.request_headers_ = request.custom_headers;
     client.allow_redirects_ = request.allow_redirects;
+    client.keep_alive_ = request.keep_alive;
   }
 
   inline static void PrepareInput(const POST& request, HTTPClientPOSIX& client) {
@@ -206,6 +256,7 @@ struct ImplWrapper<HTTPClientPOSIX> {
     client.request_body_contents_ = request.body;
     client.request_body_content_type_ = request.content_type;
     client.allow_redirects_ = request.allow_redirects;
+    client.keep_alive_ = request.keep_alive;
   }
 
   inline static void PrepareInput(const POSTFromFile& request, HTTPClientPOSIX& client) {
@@ -217,6 +268,7 @@ struct ImplWrapper<HTTPClientPOSIX> {
         current::FileSystem::ReadFileAsString(request.file_name);  // Can throw FileException.
     client.request_body_content_type_ = request.content_type;
     client.allow_redirects_ = request.allow_redirects;
+    client.keep_alive_ = request.keep_alive;
   }
 
   inline static void PrepareInput(const PUT& request, HTTPClientPOSIX& client) {
@@ -227,6 +279,7 @@ struct ImplWrapper<HTTPClientPOSIX> {
     client.request_body_contents_ = request.body;
     client.request_body_content_type_ = request.content_type;
     client.allow_redirects_ = request.allow_redirects;
+    client.keep_alive_ = request.keep_alive;
   }
 
   inline static void PrepareInput(const PATCH& request, HTTPClientPOSIX& client) {
@@ -237,6 +290,7 @@ struct ImplWrapper<HTTPClientPOSIX> {
     client.request_body_contents_ = request.body;
     client.request_body_content_type_ = request.content_type;
     client.allow_redirects_ = request.allow_redirects;
+    client.keep_alive_ = request.keep_alive;
   }
 
   inline static void PrepareInput(const DELETE& request, HTTPClientPOSIX& client) {
@@ -245,6 +299,7 @@ struct ImplWrapper<HTTPClientPOSIX> {
     client.request_user_agent_ = request.custom_user_agent;  // LCOV_EXCL_LINE  -- tested in GET above.
     client.request_headers_ = request.custom_headers;
     client.allow_redirects_ = request.allow_redirects;
+    client.keep_alive_ = request.keep_alive;
   }
 
   inline static void PrepareInput(const KeepResponseInMemory&, HTTPClientPOSIX&) {}
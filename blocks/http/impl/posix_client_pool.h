@@ -0,0 +1,145 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2014 Dmitry "Dima" Korolev, <dmitry.korolev@gmail.com>.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The pool of idle keep-alive connections of `HTTPClientPOSIX`, per host and port.
+//
+// After a response the server has agreed to keep the connection alive for, the connection is returned to the pool,
+// and the next request to the same host and port is sent over it instead of over a new one. The most recently used
+// connection is reused first. Before it is reused, the connection is checked to not have been closed by the server.
+// The pool keeps at most `max_idle_connections_per_host` idle connections per host, for at most `idle_timeout`,
+// which should be shorter than the idle timeout of the servers, five seconds for Current's `epoll` engine.
+
+#ifndef BLOCKS_HTTP_IMPL_POSIX_CLIENT_POOL_H
+#define BLOCKS_HTTP_IMPL_POSIX_CLIENT_POOL_H
+
+#include "../../../port.h"
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "../../../bricks/net/tcp/tcp.h"
+
+namespace current {
+namespace http {
+
+struct HTTPClientConnectionPoolOptions {
+  size_t max_idle_connections_per_host;
+  std::chrono::milliseconds idle_timeout;
+
+  explicit HTTPClientConnectionPoolOptions(size_t max_idle_connections_per_host = 32u,
+                                           std::chrono::milliseconds idle_timeout = std::chrono::milliseconds(2000))
+      : max_idle_connections_per_host(max_idle_connections_per_host), idle_timeout(idle_timeout) {}
+};
+
+class HTTPClientConnectionPool final {
+ public:
+  struct Stats {
+    size_t connections_opened = 0u;     // New connections established.
+    size_t connections_reused = 0u;     // Requests sent over the idle connections from the pool.
+    size_t connections_discarded = 0u;  // Idle connections found closed by the server, expired, or over the limit.
+  };
+
+  void SetOptions(const HTTPClientConnectionPoolOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = options;
+  }
+
+  // Returns an idle connection to `host:port` that is still open, or a new connection.
+  // Sets `reused` accordingly, so that the caller can retry over a new connection if the reused one fails.
+  std::unique_ptr<net::Connection> Connect(const std::string& host, int port, bool& reused) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto it = idle_.find(Key(host, port));
+      if (it != idle_.end()) {
+        auto& connections = it->second;
+        const auto now = std::chrono::steady_clock::now();
+        while (!connections.empty()) {
+          IdleConnection idle = std::move(connections.back());
+          connections.pop_back();
+          if (now - idle.since < options_.idle_timeout && idle.connection->IsOpenAndIdle()) {
+            ++stats_.connections_reused;
+            reused = true;
+            return std::move(idle.connection);
+          }
+          ++stats_.connections_discarded;
+        }
+      }
+      ++stats_.connections_opened;
+    }
+    reused = false;
+    return std::make_unique<net::Connection>(net::ClientSocket(host, port));
+  }
+
+  // Keeps the connection, over which a response has just been fully received, for the next request to `host:port`.
+  void Release(const std::string& host, int port, std::unique_ptr<net::Connection> connection) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& connections = idle_[Key(host, port)];
+    const auto now = std::chrono::steady_clock::now();
+    while (!connections.empty() &&
+           (connections.size() >= options_.max_idle_connections_per_host ||
+            now - connections.front().since >= options_.idle_timeout)) {
+      connections.pop_front();
+      ++stats_.connections_discarded;
+    }
+    if (options_.max_idle_connections_per_host) {
+      connections.push_back(IdleConnection{std::move(connection), now});
+    } else {
+      ++stats_.connections_discarded;
+    }
+  }
+
+  // Closes all the idle connections.
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.clear();
+  }
+
+  Stats GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  struct IdleConnection {
+    std::unique_ptr<net::Connection> connection;
+    std::chrono::steady_clock::time_point since;
+  };
+
+  static std::string Key(const std::string& host, int port) { return host + ':' + std::to_string(port); }
+
+  mutable std::mutex mutex_;
+  HTTPClientConnectionPoolOptions options_;
+  std::map<std::string, std::deque<IdleConnection>> idle_;
+  Stats stats_;
+};
+
+}  // namespace current::http
+}  // namespace current
+
+#endif  // BLOCKS_HTTP_IMPL_POSIX_CLIENT_POOL_H
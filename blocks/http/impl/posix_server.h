@@ -25,6 +25,7 @@ SOFTWARE.
 #ifndef BLOCKS_HTTP_IMPL_POSIX_SERVER_H
 #define BLOCKS_HTTP_IMPL_POSIX_SERVER_H
 
+#include <algorithm>
 #include <atomic>
 #include <string>
 #include <map>
@@ -35,6 +36,9 @@ SOFTWARE.
 #include "../types.h"
 #include "../request.h"
 
+#include "posix_server_epoll.h"
+#include "posix_server_routes.h"
+
 #include "../../url/url.h"
 
 #include "../../../typesystem/optional.h"
@@ -42,7 +46,6 @@ SOFTWARE.
 #include "../../../bricks/net/exceptions.h"
 #include "../../../bricks/net/http/http.h"
 #include "../../../bricks/strings/printf.h"
-#include "../../../bricks/sync/owned_borrowed.h"
 #include "../../../bricks/time/chrono.h"
 #include "../../../bricks/util/accumulative_scoped_deleter.h"
 
@@ -159,11 +162,26 @@ struct StaticFileServer {
 // HTTP server bound to a specific port.
 class HTTPServerPOSIX final {
  public:
+  using options_t = HTTPServerOptions;
+
   // The constructor starts listening on the specified port.
   // Since instances of `HTTPServerPOSIX` are created via a singleton,
   // a listening thread will only be created once per port, on the first access to that port.
-  explicit HTTPServerPOSIX(uint16_t port)
-      : terminating_(false), port_(port), thread_(&HTTPServerPOSIX::Thread, this, current::net::Socket(port)) {}
+  // With `HTTPServerEngine::Epoll`, the connections are served by `HTTPServerEpollEngine` instead of that thread.
+  explicit HTTPServerPOSIX(uint16_t port, const HTTPServerOptions& options = HTTPServerOptions())
+      : terminating_(false), port_(port), options_(options) {
+    if (options_.engine == HTTPServerEngine::Epoll) {
+      epoll_engine_ = std::make_unique<HTTPServerEpollEngine>(
+          current::net::Socket(port),
+          options_,
+          terminating_,
+          [this](const HTTPServerEpollEngine::connection_factory_t& make_connection) {
+            ServeConnection(make_connection);
+          });
+    } else {
+      thread_ = std::thread(&HTTPServerPOSIX::Thread, this, current::net::Socket(port));
+    }
+  }
 
   // The destructor closes the socket.
   // Note that the destructor will only be run on the shutdown of the binary,
@@ -188,16 +206,23 @@ class HTTPServerPOSIX final {
     if (thread_.joinable()) {
       thread_.join();
     }
+    epoll_engine_ = nullptr;
   }
 
   // The bare `Join()` method is only used by small scripts to run the server indefinitely,
   // instead of `while(true)`
   // LCOV_EXCL_START
   void Join() {
-    thread_.join();  // May throw.
+    if (epoll_engine_) {
+      epoll_engine_->Join();  // May throw.
+    } else {
+      thread_.join();  // May throw.
+    }
   }
   // LCOV_EXCL_STOP
 
+  const HTTPServerOptions& Options() const { return options_; }
+
   // Scoped de-registerer of routes, of its own type.
   struct ScopedRegistererDifferentiator {};
   using HTTPRoutesScope = current::AccumulativeScopedDeleter<ScopedRegistererDifferentiator>;
@@ -244,25 +269,28 @@ class HTTPServerPOSIX final {
   void UnRegister(const std::string& path,
                   const URLPathArgs::CountMask path_args_count_mask = URLPathArgs::CountMask::None) {
     std::lock_guard<std::mutex> lock(mutex_);
+    auto it = handlers_.find(path);
+    if (it == handlers_.end()) {
+      CURRENT_THROW(HandlerDoesNotExistException(path));
+    }
+    routes_t::handlers_t handlers = it->second;
     URLPathArgs::CountMask mask = URLPathArgs::CountMask::None;  // `None` == 1 == (1 << 0).
     for (size_t i = 0; i <= URLPathArgs::MaxArgsCount; ++i, mask <<= 1) {
       if ((path_args_count_mask & mask) == mask) {
-        auto it1 = handlers_.find(path);
-        if (it1 == handlers_.end()) {
+        if (!handlers[i]) {
           CURRENT_THROW(HandlerDoesNotExistException(path));
         }
-        auto& map = it1->second;
-        auto it2 = map.find(i);
-        if (it2 == map.end()) {
-          CURRENT_THROW(HandlerDoesNotExistException(path));
-        }
-        map.erase(it2);
-        if (map.empty()) {
-          // Maintain the value of `PathHandlersCount()` invariant.
-          handlers_.erase(it1);
-        }
+        handlers[i] = nullptr;
       }
     }
+    if (std::none_of(handlers.begin(), handlers.end(), [](const auto& handler) { return handler != nullptr; })) {
+      // Maintain the value of `PathHandlersCount()` invariant.
+      handlers_.erase(it);
+    } else {
+      it->second = handlers;
+    }
+    // Returns once the unregistered handler is no longer in use.
+    routes_.Set(path, handlers);
   }
 
   HTTPRoutesScope ServeStaticFilesFrom(const std::string& dir,
@@ -348,117 +376,91 @@ class HTTPServerPOSIX final {
   }
 
  private:
-  // Although this may look complicated, all it does is making sure the handler, if found,
-  // is returned wrapped into a special object which prohibits its de-registration while in use.
+  // Returns the handler, if found, marked as in use, which prohibits its de-registration while it is being run.
   // Note: If the user code handles the request synchronously, the scoped HTTP registerers will do the job.
   // If the user handles the request from another thread, it's the responsibility of the user to make sure
   // the very object ("this") does not get destroyed while the request is being handled.
-  Optional<Borrowed<std::function<void(Request)>>> FindHandler(const std::string& path,
-                                                               URLPathArgs& output_url_args) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-
+  // Takes no locks, see `posix_server_routes.h`.
+  impl::HTTPRouteInUse FindHandler(const std::string& path, URLPathArgs& output_url_args) const {
     // LCOV_EXCL_START
     if (path.empty()) {
       std::cerr << "HTTP: path is empty.\n";
-      return nullptr;
+      return impl::HTTPRouteInUse();
     }
     if (path[0] != '/') {
       std::cerr << "HTTP: path does not start with a slash.\n";
-      return nullptr;
+      return impl::HTTPRouteInUse();
     }
     // LCOV_EXCL_STOP
 
-    // Work with the path by trying to match the full one, then the one with the last component removed,
-    // then the one with two last components removed, etc.
-    // As a component is removed, it's removed from `base_path` and is added to `url_args`.
-    std::string& remaining_path = output_url_args.base_path;
-    remaining_path = path;
-
-    // Friendly reminder: `remaining_path[0]` is guaranteed to be '/'.
-    while (true) {
-      while (remaining_path.length() > 1 && remaining_path.back() == '/') {
-        remaining_path.resize(remaining_path.length() - 1);
-      }
-
-      const auto cit = handlers_.find(remaining_path);
-      if (cit != handlers_.end()) {
-        const auto cit2 = cit->second.find(output_url_args.size());
-        if (cit2 != cit->second.end()) {
-          return Borrowed<std::function<void(Request)>>(cit2->second);
-        }
-      }
-
-      if (remaining_path == "/") {
-        break;
-      }
-
-      const size_t arg_begin_index = remaining_path.rfind('/') + 1;
-      output_url_args.add(URL::DecodeURIComponent(remaining_path.substr(arg_begin_index)));
-      remaining_path.resize(arg_begin_index);
-    }
-
-    return nullptr;
+    return routes_.Find(path, output_url_args);
   }
 
   void Thread(current::net::Socket socket) {
-    // TODO(dkorolev): Benchmark QPS.
+    // See `examples/benchmark/http` for the QPS of this engine vs. the `epoll`-based one.
     while (!terminating_) {
-      try {
-        std::unique_ptr<current::net::HTTPServerConnection> connection(
-            new current::net::HTTPServerConnection(socket.Accept()));
-        if (terminating_) {
-          // Already terminating. Will not send the response, and this
-          // lack of response should not result in an exception.
-          connection->DoNotSendAnyResponse();
-          break;
-        }
-        URLPathArgs url_path_args;
-        const auto handler = FindHandler(connection->HTTPRequest().URL().path, url_path_args);
-        if (Exists(handler)) {
-          // OK, here's the tricky part with error handling and exceptions in this multithreaded world.
-          // * On the one hand, the connection should be std::move-d into the request,
-          //   since it might end up being served in another thread, via a message queue, etc.
-          //   Thus, the user code is responsible for closing the connection.
-          //   Not to mention that the std::move-d away connection can easily outlive this scope.
-          // * On the other hand, if an exception occurs in user code, we need to return a 500,
-          //   which should obviously happen before the connection object is destructed.
-          //   This seems like a good reason to not std::move it away, or move it away with some flag,
-          //   but I thought hard of it, and don't think it's a good choice -- D.K.
-          //
-          // Solution: Do nothing here. No matter how tempting it is, it won't work across threads. Period.
-          //
-          // The implementation of HTTP connection will return an "INTERNAL SERVER ERROR"
-          // if no response was sent. That's what the user gets. In debugger, they can put a breakpoint there
-          // and see what caused the error.
-          //
-          // It is the job of the user of this library to ensure no exceptions leave their code.
-          // In practice, a top-level try-catch for `const current::Exception& e` is good enough.
-          try {
-            (*Value(handler))(Request(std::move(connection), url_path_args));
-          } catch (const current::Exception& e) {  // LCOV_EXCL_LINE
-            // WARNING: This `catch` is really not sufficient, it just logs a message
-            // if a user exception occurred in the same thread that ran the handler.
-            // DO NOT COUNT ON IT.
-            std::cerr << "HTTP route failed in user code: " << e.what() << '\n';  // LCOV_EXCL_LINE
-          }
-        } else {
-          connection->SendHTTPResponse(current::net::DefaultNotFoundMessage(),
-                                       HTTPResponseCode.NotFound,
-                                       current::net::http::Headers(),
-                                       current::net::constants::kDefaultHTMLContentType);
+      ServeConnection([&socket]() { return std::make_unique<current::net::HTTPServerConnection>(socket.Accept()); });
+    }
+  }
+
+  // Serves one request: the one parsed by `make_connection()`, which is where the request is read from the socket.
+  // Used by both engines, the blocking `accept()` one and the `epoll` one.
+  template <typename F>
+  void ServeConnection(F&& make_connection) {
+    try {
+      std::unique_ptr<current::net::HTTPServerConnection> connection = make_connection();
+      if (terminating_) {
+        // Already terminating. Will not send the response, and this
+        // lack of response should not result in an exception.
+        connection->DoNotSendAnyResponse();
+        return;
+      }
+      URLPathArgs url_path_args;
+      const auto handler = FindHandler(connection->HTTPRequest().URL().path, url_path_args);
+      if (handler) {
+        // OK, here's the tricky part with error handling and exceptions in this multithreaded world.
+        // * On the one hand, the connection should be std::move-d into the request,
+        //   since it might end up being served in another thread, via a message queue, etc.
+        //   Thus, the user code is responsible for closing the connection.
+        //   Not to mention that the std::move-d away connection can easily outlive this scope.
+        // * On the other hand, if an exception occurs in user code, we need to return a 500,
+        //   which should obviously happen before the connection object is destructed.
+        //   This seems like a good reason to not std::move it away, or move it away with some flag,
+        //   but I thought hard of it, and don't think it's a good choice -- D.K.
+        //
+        // Solution: Do nothing here. No matter how tempting it is, it won't work across threads. Period.
+        //
+        // The implementation of HTTP connection will return an "INTERNAL SERVER ERROR"
+        // if no response was sent. That's what the user gets. In debugger, they can put a breakpoint there
+        // and see what caused the error.
+        //
+        // It is the job of the user of this library to ensure no exceptions leave their code.
+        // In practice, a top-level try-catch for `const current::Exception& e` is good enough.
+        try {
+          handler(Request(std::move(connection), url_path_args));
+        } catch (const current::Exception& e) {  // LCOV_EXCL_LINE
+          // WARNING: This `catch` is really not sufficient, it just logs a message
+          // if a user exception occurred in the same thread that ran the handler.
+          // DO NOT COUNT ON IT.
+          std::cerr << "HTTP route failed in user code: " << e.what() << '\n';  // LCOV_EXCL_LINE
         }
-      } catch (const current::net::ChunkSizeNotAValidHEXValue&) {
-        // The `ChunkSizeNotAValidHEXValue` situation, if emerged, is already handled with a "400 BAD REQUEST" response.
-      } catch (const current::net::HTTPPayloadTooLarge&) {
-        // The `HTTPPayloadTooLarge` situation, if emerged, is already handled with a "413 ENTITY TOO LARGE" response.
-      } catch (const current::net::HTTPRequestBodyLengthNotProvided&) {
-        // The `HTTPRequestBodyLengthNotProvided` situation, if emerged, is already handled with "411 LENGTH REQUIRED".
-      } catch (const current::net::EmptySocketException&) {  // LCOV_EXCL_LINE
-        // Silently discard errors if no data was sent in.
-      } catch (const current::Exception& e) {  // LCOV_EXCL_LINE
-        // TODO(dkorolev): More reliable logging.
-        std::cerr << "HTTP route failed: " << e.what() << '\n';  // LCOV_EXCL_LINE
+      } else {
+        connection->SendHTTPResponse(current::net::DefaultNotFoundMessage(),
+                                     HTTPResponseCode.NotFound,
+                                     current::net::http::Headers(),
+                                     current::net::constants::kDefaultHTMLContentType);
       }
+    } catch (const current::net::ChunkSizeNotAValidHEXValue&) {
+      // The `ChunkSizeNotAValidHEXValue` situation, if emerged, is already handled with a "400 BAD REQUEST" response.
+    } catch (const current::net::HTTPPayloadTooLarge&) {
+      // The `HTTPPayloadTooLarge` situation, if emerged, is already handled with a "413 ENTITY TOO LARGE" response.
+    } catch (const current::net::HTTPRequestBodyLengthNotProvided&) {
+      // The `HTTPRequestBodyLengthNotProvided` situation, if emerged, is already handled with "411 LENGTH REQUIRED".
+    } catch (const current::net::EmptySocketException&) {  // LCOV_EXCL_LINE
+      // Silently discard errors if no data was sent in.
+    } catch (const current::Exception& e) {  // LCOV_EXCL_LINE
+      // TODO(dkorolev): More reliable logging.
+      std::cerr << "HTTP route failed: " << e.what() << '\n';  // LCOV_EXCL_LINE
     }
   }
 
@@ -492,8 +494,7 @@ class HTTPServerPOSIX final {
       URLPathArgs::CountMask mask = URLPathArgs::CountMask::None;  // `None` == 1 == (1 << 0).
       for (size_t i = 0; i <= URLPathArgs::MaxArgsCount; ++i, mask = mask << 1) {
         if ((path_args_count_mask & mask) == mask) {
-          if (handlers_per_path_iterator == handlers_.end() ||
-              handlers_per_path_iterator->second.find(i) == handlers_per_path_iterator->second.end()) {
+          if (handlers_per_path_iterator == handlers_.end() || !handlers_per_path_iterator->second[i]) {
             // No such handler. Throw if trying to "Update" it.
             if (policy == ReRegisterRoute::SilentlyUpdateExisting) {
               CURRENT_THROW(HandlerDoesNotExistException(path));
@@ -509,14 +510,16 @@ class HTTPServerPOSIX final {
     }
 
     {
-      // Step 2: Update.
+      // Step 2: Update, and publish the new version of the route table.
       auto& handlers_per_path = handlers_[path];
+      const auto route = std::make_shared<impl::HTTPRoute>(std::move(handler));
       URLPathArgs::CountMask mask = URLPathArgs::CountMask::None;  // `None` == 1 == (1 << 0).
       for (size_t i = 0; i <= URLPathArgs::MaxArgsCount; ++i, mask = mask << 1) {
         if ((path_args_count_mask & mask) == mask) {
-          handlers_per_path[i] = MakeOwned<std::function<void(Request)>>(handler);
+          handlers_per_path[i] = route;
         }
       }
+      routes_.Set(path, handlers_per_path);
     }
 
     if (policy == ReRegisterRoute::SilentlyUpdateExisting) {
@@ -530,12 +533,16 @@ class HTTPServerPOSIX final {
 
   std::atomic_bool terminating_;
   const uint16_t port_;
+  const HTTPServerOptions options_;
   std::thread thread_;
+  std::unique_ptr<HTTPServerEpollEngine> epoll_engine_;
 
-  // TODO(dkorolev): Look into read-write mutexes here.
+  // Guards the changes to the routes. Serving requests does not lock it.
   mutable std::mutex mutex_;
 
-  std::map<std::string, std::map<size_t, Owned<std::function<void(Request)>>>> handlers_;
+  using routes_t = impl::HTTPRoutes;
+  std::map<std::string, routes_t::handlers_t> handlers_;
+  routes_t routes_;
   std::vector<std::unique_ptr<StaticFileServer>> static_file_servers_;
 };
 
@@ -0,0 +1,543 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2014 Dmitry "Dima" Korolev, <dmitry.korolev@gmail.com>.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The event-driven engine of `HTTPServerPOSIX`, an alternative to its default thread blocked on `accept()`.
+//
+// One acceptor thread hands the accepted connections over to N worker threads round-robin. Each worker reads
+// from its connections via `epoll`, without blocking, until a whole HTTP request is received. The request
+// is then parsed from memory by the very `GenericHTTPRequestData` the default engine uses, and passed to the handler.
+//
+// HTTP/1.1 keep-alive and pipelining are supported: after the response, the connection goes back to its worker,
+// which serves the next request right away if it has already been received, or waits for it otherwise.
+// The connections idle for longer than the configured timeout are closed.
+//
+// NOTE: With this engine, the handlers are called from several threads concurrently.
+
+#ifndef BLOCKS_HTTP_IMPL_POSIX_SERVER_EPOLL_H
+#define BLOCKS_HTTP_IMPL_POSIX_SERVER_EPOLL_H
+
+#include "../../../port.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef CURRENT_POSIX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif  // CURRENT_POSIX
+
+#include "../../../bricks/exception.h"
+#include "../../../bricks/net/http/http.h"
+#include "../../../bricks/strings/util.h"
+
+namespace current {
+namespace http {
+
+enum class HTTPServerEngine : int {
+  Threaded = 0,  // The single thread blocked on `accept()`, one request per connection.
+  Epoll = 1      // The acceptor and `epoll`-driven workers, with keep-alive and pipelining. Linux only.
+};
+
+struct HTTPServerOptions {
+  HTTPServerEngine engine;
+
+  // The number of `epoll` worker threads, zero for one per CPU core.
+  size_t worker_threads;
+
+  // How long a kept alive connection may remain idle, or a request take to be received, before it is closed.
+  std::chrono::milliseconds idle_timeout;
+
+  explicit HTTPServerOptions(HTTPServerEngine engine = HTTPServerEngine::Threaded,
+                             size_t worker_threads = 0u,
+                             std::chrono::milliseconds idle_timeout = std::chrono::milliseconds(5000))
+      : engine(engine), worker_threads(worker_threads), idle_timeout(idle_timeout) {}
+
+  bool operator==(const HTTPServerOptions& rhs) const {
+    return engine == rhs.engine && worker_threads == rhs.worker_threads && idle_timeout == rhs.idle_timeout;
+  }
+  bool operator!=(const HTTPServerOptions& rhs) const { return !operator==(rhs); }
+};
+
+struct HTTPServerEngineNotSupportedException : Exception {
+  using Exception::Exception;
+};
+
+namespace impl {
+
+// The result of looking for the end of the first HTTP request in the data received so far.
+struct FramedHTTPRequest {
+  size_t length = 0u;       // The number of bytes the request takes, zero if it has not been fully received yet.
+  bool keep_alive = false;  // Whether the client expects the connection to remain open after the response.
+};
+
+// Follows the logic of `GenericHTTPRequestData`, to tell where the request it would parse ends. Requests that
+// `GenericHTTPRequestData` would reject, e.g. for a missing `Content-Length`, end right after their headers.
+inline FramedHTTPRequest FrameHTTPRequest(const char* const begin, const char* const end) {
+  const auto FindCRLF = [end](const char* p) -> const char* {
+    while (p + 1 < end) {
+      const char* cr = static_cast<const char*>(::memchr(p, '\r', (end - p) - 1));
+      if (!cr) {
+        return nullptr;
+      }
+      if (cr[1] == '\n') {
+        return cr;
+      }
+      p = cr + 1;
+    }
+    return nullptr;
+  };
+  const auto HeaderNameEquals = [](const char* lhs, const char* lhs_end, const char* rhs) {
+    const auto NormalizeHeaderChar = [](char c) { return c != '_' ? std::tolower(c) : '-'; };
+    while (lhs < lhs_end && *rhs) {
+      if (NormalizeHeaderChar(*lhs++) != NormalizeHeaderChar(*rhs++)) {
+        return false;
+      }
+    }
+    return lhs == lhs_end && !*rhs;
+  };
+  const auto IsSpaceOrTab = [](const char c) { return c == ' ' || c == '\t'; };
+
+  FramedHTTPRequest result;
+  bool http_1_1 = false;
+  bool connection_close = false;
+  bool connection_keep_alive = false;
+  bool chunked = false;
+  size_t content_length = static_cast<size_t>(-1);
+
+  const char* p = begin;
+  bool first_line_parsed = false;
+  while (true) {
+    const char* crlf = FindCRLF(p);
+    if (!crlf) {
+      return FramedHTTPRequest();
+    }
+    const char* next = crlf + net::constants::kCRLFLength;
+    if (!first_line_parsed) {
+      // Blank lines before the first line are ignored.
+      if (crlf != p) {
+        const std::vector<std::string> pieces = strings::Split<strings::ByWhitespace>(std::string(p, crlf));
+        http_1_1 = (pieces.size() >= 3 && pieces[2] == "HTTP/1.1");
+        first_line_parsed = true;
+      }
+    } else if (crlf == p) {
+      p = next;
+      break;
+    } else {
+      const char* colon = static_cast<const char*>(::memchr(p, net::constants::kHeaderKeyValueSeparator, crlf - p));
+      if (colon) {
+        const char* value = colon + 1;
+        const char* value_end = crlf;
+        while (value < value_end && IsSpaceOrTab(*value)) {
+          ++value;
+        }
+        while (value_end > value && IsSpaceOrTab(*(value_end - 1))) {
+          --value_end;
+        }
+        if (HeaderNameEquals(p, colon, net::constants::kContentLengthHeaderKey)) {
+          content_length = static_cast<size_t>(atoi(std::string(value, value_end).c_str()));
+        } else if (HeaderNameEquals(p, colon, net::constants::kTransferEncodingHeaderKey)) {
+          chunked = HeaderNameEquals(value, value_end, net::constants::kTransferEncodingChunkedValue);
+        } else if (HeaderNameEquals(p, colon, "Connection")) {
+          const std::string lowercase_value = strings::ToLower(std::string(value, value_end));
+          connection_close = (lowercase_value.find("close") != std::string::npos);
+          connection_keep_alive = (lowercase_value.find("keep-alive") != std::string::npos);
+        }
+      }
+    }
+    p = next;
+  }
+
+  if (chunked) {
+    while (true) {
+      const char* crlf = FindCRLF(p);
+      if (!crlf) {
+        return FramedHTTPRequest();
+      }
+      const char* next = crlf + net::constants::kCRLFLength;
+      if (crlf != p) {
+        const std::string line(p, crlf);
+        char* hex_end = nullptr;
+        const long chunk_length = std::strtol(line.c_str(), &hex_end, 16);
+        if (hex_end == line.c_str() || chunk_length <= 0) {
+          // Either the last chunk, or the chunk size `GenericHTTPRequestData` would respond with a 400 to.
+          p = next;
+          break;
+        }
+        if (static_cast<size_t>(end - next) < static_cast<size_t>(chunk_length)) {
+          return FramedHTTPRequest();
+        }
+        next += chunk_length;
+      }
+      p = next;
+    }
+  } else if (content_length != static_cast<size_t>(-1) &&
+             content_length <= net::constants::kMaxHTTPPayloadSizeInBytes) {
+    if (static_cast<size_t>(end - p) < content_length) {
+      return FramedHTTPRequest();
+    }
+    p += content_length;
+  }
+
+  result.length = static_cast<size_t>(p - begin);
+  result.keep_alive = !connection_close && (http_1_1 || connection_keep_alive);
+  return result;
+}
+
+}  // namespace current::http::impl
+
+#ifdef CURRENT_POSIX
+
+class HTTPServerEpollEngine final {
+ public:
+  // Serves one request: calls the factory, which parses the request into a connection, and runs the handler.
+  using connection_factory_t = std::function<std::unique_ptr<net::HTTPServerConnection>()>;
+  using serve_t = std::function<void(const connection_factory_t&)>;
+
+  // Connections with more than this many bytes received and yet no complete request in them are closed.
+  constexpr static size_t kMaxBufferedRequestBytes = net::constants::kMaxHTTPPayloadSizeInBytes + 1024 * 1024;
+
+  HTTPServerEpollEngine(net::Socket socket,
+                        const HTTPServerOptions& options,
+                        const std::atomic_bool& terminating,
+                        serve_t serve)
+      : terminating_(terminating), serve_(std::move(serve)) {
+    const size_t threads = options.worker_threads
+                               ? options.worker_threads
+                               : std::max(static_cast<size_t>(std::thread::hardware_concurrency()), size_t(1));
+    for (size_t i = 0; i < threads; ++i) {
+      workers_.push_back(std::make_unique<Worker>(options.idle_timeout, serve_));
+    }
+    acceptor_ = std::thread(&HTTPServerEpollEngine::AcceptorThread, this, std::move(socket));
+  }
+
+  // The acceptor thread terminates on the first connection accepted after `terminating` has been set.
+  ~HTTPServerEpollEngine() {
+    if (acceptor_.joinable()) {
+      acceptor_.join();
+    }
+    workers_.clear();
+  }
+
+  // LCOV_EXCL_START
+  void Join() { acceptor_.join(); }
+  // LCOV_EXCL_STOP
+
+ private:
+  struct ConnectionState final {
+    std::unique_ptr<net::Connection> connection;  // Empty while the connection is passed on to the handler.
+    SOCKET fd;
+    std::string buffer;  // Received and not yet served.
+    std::chrono::steady_clock::time_point last_activity;
+    bool registered = false;  // Whether the socket has been added to the `epoll` set of the worker.
+    bool peer_closed = false;
+  };
+
+  // The inbox of a worker, for the new connections from the acceptor, and for the ones returned after the response.
+  // Outlives the worker, as the kept alive connection may be returned after the server is gone.
+  struct Mailbox final {
+    std::mutex mutex;
+    bool alive = true;
+    int event_fd;
+    std::thread::id worker_thread_id;
+    std::vector<std::pair<std::shared_ptr<ConnectionState>, std::unique_ptr<net::Connection>>> connections;
+
+    Mailbox() : event_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+      if (event_fd < 0) {
+        CURRENT_THROW(net::SocketCreateException());  // LCOV_EXCL_LINE
+      }
+    }
+    ~Mailbox() { ::close(event_fd); }
+
+    void Post(std::shared_ptr<ConnectionState> state, std::unique_ptr<net::Connection> connection) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (alive) {
+        connections.emplace_back(std::move(state), std::move(connection));
+        // The connection returned by a handler the worker itself is running needs no wakeup.
+        if (std::this_thread::get_id() != worker_thread_id) {
+          Wake();
+        }
+      }
+    }
+
+    void Wake() {
+      const uint64_t one = 1u;
+      if (::write(event_fd, &one, sizeof(one)) < 0) {
+        // The counter is non-zero already, which is just as good.
+      }
+    }
+  };
+
+  class Worker final {
+   public:
+    Worker(std::chrono::milliseconds idle_timeout, const serve_t& serve)
+        : idle_timeout_(idle_timeout),
+          sweep_period_(std::max(std::chrono::milliseconds(1), std::min(idle_timeout, std::chrono::milliseconds(250)))),
+          serve_(serve),
+          epoll_fd_(::epoll_create1(EPOLL_CLOEXEC)),
+          mailbox_(std::make_shared<Mailbox>()) {
+      if (epoll_fd_ < 0) {
+        CURRENT_THROW(net::SocketCreateException());  // LCOV_EXCL_LINE
+      }
+      epoll_event event;
+      event.events = EPOLLIN;
+      event.data.ptr = nullptr;
+      if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, mailbox_->event_fd, &event)) {
+        CURRENT_THROW(net::SocketCreateException());  // LCOV_EXCL_LINE
+      }
+      thread_ = std::thread(&Worker::Thread, this);
+    }
+
+    ~Worker() {
+      {
+        std::lock_guard<std::mutex> lock(mailbox_->mutex);
+        mailbox_->alive = false;
+      }
+      mailbox_->Wake();
+      thread_.join();
+      ::close(epoll_fd_);
+    }
+
+    void Accept(std::unique_ptr<net::Connection> connection) {
+      auto state = std::make_shared<ConnectionState>();
+      state->fd = static_cast<SOCKET>(connection->socket);
+      mailbox_->Post(std::move(state), std::move(connection));
+    }
+
+   private:
+    void Thread() {
+      {
+        std::lock_guard<std::mutex> lock(mailbox_->mutex);
+        mailbox_->worker_thread_id = std::this_thread::get_id();
+      }
+      constexpr int kMaxEvents = 256;
+      epoll_event events[kMaxEvents];
+      auto next_sweep = std::chrono::steady_clock::now() + sweep_period_;
+      while (true) {
+        const int n = ::epoll_wait(epoll_fd_, events, kMaxEvents, static_cast<int>(sweep_period_.count()));
+        for (int i = 0; i < n; ++i) {
+          if (!events[i].data.ptr) {
+            uint64_t unused;
+            if (::read(mailbox_->event_fd, &unused, sizeof(unused)) < 0) {
+              // The counter has already been reset, which is fine.
+            }
+          } else {
+            OnReadable(static_cast<ConnectionState*>(events[i].data.ptr));
+          }
+        }
+        if (!ProcessMailbox()) {
+          break;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= next_sweep) {
+          CloseIdleConnections(now);
+          next_sweep = now + sweep_period_;
+        }
+      }
+      connections_.clear();
+    }
+
+    // Takes in the new and the returned connections. Returns `false` once the worker should stop.
+    bool ProcessMailbox() {
+      while (true) {
+        std::vector<std::pair<std::shared_ptr<ConnectionState>, std::unique_ptr<net::Connection>>> connections;
+        {
+          std::lock_guard<std::mutex> lock(mailbox_->mutex);
+          if (!mailbox_->alive) {
+            return false;
+          }
+          if (mailbox_->connections.empty()) {
+            return true;
+          }
+          connections.swap(mailbox_->connections);
+        }
+        for (auto& e : connections) {
+          ConnectionState* state = e.first.get();
+          e.second->SetPrefetchedData(std::string());
+          state->connection = std::move(e.second);
+          state->last_activity = std::chrono::steady_clock::now();
+          connections_[state] = std::move(e.first);
+          if (!state->registered) {
+            // The responses are small and written in full, so there is nothing for Nagle's algorithm to gain.
+            int just_one = 1;
+            ::setsockopt(state->fd, IPPROTO_TCP, TCP_NODELAY, &just_one, sizeof(just_one));
+            state->registered = true;
+            Arm(state, EPOLL_CTL_ADD);
+          } else if (!ServeBufferedRequest(state)) {
+            if (state->peer_closed) {
+              connections_.erase(state);
+            } else {
+              Arm(state, EPOLL_CTL_MOD);
+            }
+          }
+        }
+      }
+    }
+
+    void Arm(ConnectionState* state, int op) {
+      epoll_event event;
+      event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+      event.data.ptr = state;
+      if (::epoll_ctl(epoll_fd_, op, state->fd, &event)) {
+        connections_.erase(state);  // LCOV_EXCL_LINE
+      }
+    }
+
+    void OnReadable(ConnectionState* state) {
+      char buffer[64 * 1024];
+      while (true) {
+        const ssize_t bytes = ::recv(state->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (bytes > 0) {
+          state->buffer.append(buffer, static_cast<size_t>(bytes));
+          if (static_cast<size_t>(bytes) < sizeof(buffer)) {
+            break;
+          }
+        } else if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+          break;
+        } else {
+          state->peer_closed = true;
+          break;
+        }
+      }
+      state->last_activity = std::chrono::steady_clock::now();
+      if (!ServeBufferedRequest(state)) {
+        if (state->peer_closed || state->buffer.length() > kMaxBufferedRequestBytes) {
+          connections_.erase(state);
+        } else {
+          Arm(state, EPOLL_CTL_MOD);
+        }
+      }
+    }
+
+    // Passes the first fully received request, if any, to the handler. Returns `false` if there is none.
+    bool ServeBufferedRequest(ConnectionState* state) {
+      const impl::FramedHTTPRequest framed =
+          impl::FrameHTTPRequest(state->buffer.data(), state->buffer.data() + state->buffer.length());
+      if (!framed.length) {
+        return false;
+      }
+
+      std::string request;
+      if (framed.length == state->buffer.length()) {
+        request.swap(state->buffer);
+      } else {
+        request.assign(state->buffer, 0u, framed.length);
+        state->buffer.erase(0u, framed.length);
+      }
+
+      // From now on, and until it is returned via the mailbox, the connection is owned by the request.
+      std::unique_ptr<net::Connection> connection = std::move(state->connection);
+      connection->SetPrefetchedData(std::move(request));
+      std::shared_ptr<ConnectionState> owned_state = std::move(connections_[state]);
+      connections_.erase(state);
+
+      const std::shared_ptr<Mailbox>& mailbox = mailbox_;
+      serve_([&]() {
+        auto result = std::make_unique<net::HTTPServerConnection>(std::move(*connection));
+        if (framed.keep_alive && !owned_state->peer_closed) {
+          std::weak_ptr<Mailbox> weak_mailbox = mailbox;
+          result->KeepAlive([weak_mailbox, owned_state](net::Connection&& c) {
+            const auto mailbox = weak_mailbox.lock();
+            if (mailbox) {
+              mailbox->Post(owned_state, std::make_unique<net::Connection>(std::move(c)));
+            }
+          });
+        }
+        return result;
+      });
+      return true;
+    }
+
+    void CloseIdleConnections(std::chrono::steady_clock::time_point now) {
+      for (auto it = connections_.begin(); it != connections_.end();) {
+        if (now - it->second->last_activity > idle_timeout_) {
+          it = connections_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    const std::chrono::milliseconds idle_timeout_;
+    const std::chrono::milliseconds sweep_period_;
+    const serve_t& serve_;
+    const int epoll_fd_;
+    const std::shared_ptr<Mailbox> mailbox_;
+    // The connections this worker is reading the requests from, i.e. all of them except those being responded to.
+    std::unordered_map<ConnectionState*, std::shared_ptr<ConnectionState>> connections_;
+    std::thread thread_;
+  };
+
+  void AcceptorThread(net::Socket socket) {
+    size_t next_worker = 0u;
+    while (!terminating_) {
+      try {
+        auto connection = std::make_unique<net::Connection>(socket.Accept());
+        if (terminating_) {
+          // The connection made to wake this thread up; close it without a response.
+          break;
+        }
+        workers_[next_worker]->Accept(std::move(connection));
+        next_worker = (next_worker + 1u) % workers_.size();
+      } catch (const current::Exception& e) {                   // LCOV_EXCL_LINE
+        std::cerr << "HTTP accept failed: " << e.what() << '\n';  // LCOV_EXCL_LINE
+      }
+    }
+  }
+
+  const std::atomic_bool& terminating_;
+  const serve_t serve_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::thread acceptor_;
+};
+
+#else
+
+class HTTPServerEpollEngine final {
+ public:
+  using connection_factory_t = std::function<std::unique_ptr<net::HTTPServerConnection>()>;
+  using serve_t = std::function<void(const connection_factory_t&)>;
+
+  HTTPServerEpollEngine(net::Socket, const HTTPServerOptions&, const std::atomic_bool&, serve_t) {
+    CURRENT_THROW(HTTPServerEngineNotSupportedException("The `epoll` HTTP server engine requires Linux."));
+  }
+  void Join() {}
+};
+
+#endif  // CURRENT_POSIX
+
+}  // namespace http
+}  // namespace current
+
+#endif  // BLOCKS_HTTP_IMPL_POSIX_SERVER_EPOLL_H
@@ -0,0 +1,361 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2014 Dmitry "Dima" Korolev, <dmitry.korolev@gmail.com>.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The route table of `HTTPServerPOSIX`.
+//
+// The routes form a trie keyed by URL path components, and the trie is immutable. Each change, made under
+// the server's mutex, builds a new version of the trie, copying only the nodes on the path to the changed one,
+// and publishes it read-copy-update style. Looking up a handler takes no locks, only two atomic increments:
+// one to pin the current version of the trie for the duration of the lookup, and one to mark the handler as in use.
+//
+// The guarantee of the former `Owned` / `Borrowed` handlers is kept: once `UnRegister()` returns, the handler
+// is not being run, and it will not be run again. Thus the objects the handler refers to can be destroyed right away.
+
+#ifndef BLOCKS_HTTP_IMPL_POSIX_SERVER_ROUTES_H
+#define BLOCKS_HTTP_IMPL_POSIX_SERVER_ROUTES_H
+
+#include "../../../port.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../request.h"
+
+#include "../../url/url.h"
+
+namespace current {
+namespace http {
+namespace impl {
+
+// Publishes immutable versions of `T` to the readers that never lock.
+// `Read()` pins the current version for as long as the returned scope is alive. `Publish()` makes the new version
+// current, and then waits until each reader that may still have the previous version pinned is done with it.
+// The readers are counted in two counters, and the new readers are switched over from one to the other before
+// waiting for it to drain, so that the writer does not starve under a steady flow of reads.
+template <typename T>
+class RCUPublished final {
+ private:
+  struct alignas(64) ReadersCounter {
+    std::atomic_size_t readers{0u};
+  };
+
+ public:
+  class ReadScope final {
+   public:
+    ReadScope(std::atomic_size_t& readers, const T& value) : readers_(&readers), value_(&value) {}
+    ReadScope(ReadScope&& rhs) : readers_(rhs.readers_), value_(rhs.value_) { rhs.readers_ = nullptr; }
+    ~ReadScope() {
+      if (readers_) {
+        readers_->fetch_sub(1u);
+      }
+    }
+
+    const T& operator*() const { return *value_; }
+    const T* operator->() const { return value_; }
+
+    ReadScope(const ReadScope&) = delete;
+    ReadScope& operator=(const ReadScope&) = delete;
+    ReadScope& operator=(ReadScope&&) = delete;
+
+   private:
+    std::atomic_size_t* readers_;
+    const T* value_;
+  };
+
+  explicit RCUPublished(std::shared_ptr<const T> initial) : owned_(std::move(initial)), current_(owned_.get()) {}
+
+  ReadScope Read() const {
+    std::atomic_size_t& readers = counters_[epoch_.load()].readers;
+    readers.fetch_add(1u);
+    return ReadScope(readers, *current_.load());
+  }
+
+  // The writer side. Must be externally synchronized with other `Publish()` and `Current()` calls.
+  const std::shared_ptr<const T>& Current() const { return owned_; }
+
+  void Publish(std::shared_ptr<const T> next) {
+    std::shared_ptr<const T> previous = std::move(owned_);
+    owned_ = std::move(next);
+    current_.store(owned_.get());
+    for (size_t phase = 0u; phase < 2u; ++phase) {
+      const size_t drained = epoch_.load();
+      epoch_.store(drained ^ 1u);
+      while (counters_[drained].readers.load()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+ private:
+  std::shared_ptr<const T> owned_;
+  std::atomic<const T*> current_;
+  mutable std::atomic_size_t epoch_{0u};
+  mutable std::array<ReadersCounter, 2u> counters_;
+};
+
+// A registered handler, along with the number of requests it is serving right now.
+class HTTPRoute final {
+ public:
+  explicit HTTPRoute(std::function<void(Request)> handler) : handler_(std::move(handler)) {}
+
+  void operator()(Request r) const { handler_(std::move(r)); }
+
+  void Acquire() { in_use_.fetch_add(1u); }
+
+  void Release() {
+    if (in_use_.fetch_sub(1u) == 1u && retiring_.load()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      condition_variable_.notify_all();
+    }
+  }
+
+  // Called once the route table no longer refers to this handler, so that no new `Acquire()` can happen.
+  void WaitUntilNotInUse() {
+    retiring_.store(true);
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_variable_.wait(lock, [this]() { return in_use_.load() == 0u; });
+  }
+
+ private:
+  const std::function<void(Request)> handler_;
+  std::atomic_size_t in_use_{0u};
+  std::atomic_bool retiring_{false};
+  std::mutex mutex_;
+  std::condition_variable condition_variable_;
+};
+
+// The handler found by `HTTPRoutes::Find()`, marked as in use while this object is alive.
+class HTTPRouteInUse final {
+ public:
+  HTTPRouteInUse() : route_(nullptr) {}
+  explicit HTTPRouteInUse(HTTPRoute& route) : route_(&route) { route_->Acquire(); }
+  HTTPRouteInUse(HTTPRouteInUse&& rhs) : route_(rhs.route_) { rhs.route_ = nullptr; }
+  ~HTTPRouteInUse() {
+    if (route_) {
+      route_->Release();
+    }
+  }
+
+  operator bool() const { return route_ != nullptr; }
+  void operator()(Request r) const { (*route_)(std::move(r)); }
+
+  HTTPRouteInUse(const HTTPRouteInUse&) = delete;
+  HTTPRouteInUse& operator=(const HTTPRouteInUse&) = delete;
+  HTTPRouteInUse& operator=(HTTPRouteInUse&&) = delete;
+
+ private:
+  HTTPRoute* route_;
+};
+
+class HTTPRoutes final {
+ public:
+  // Per path, the handler for each number of URL path arguments, from zero to `URLPathArgs::MaxArgsCount`.
+  using handlers_t = std::array<std::shared_ptr<HTTPRoute>, URLPathArgs::MaxArgsCount + 1>;
+
+  HTTPRoutes() : trie_(std::make_shared<const Node>()) {}
+
+  // Mimics trying the full path first, and then the paths with one, two, etc. last components moved
+  // into `output_url_args`. Only the components that end up as URL path arguments are decoded and copied.
+  HTTPRouteInUse Find(std::string_view path, URLPathArgs& output_url_args) const {
+    while (path.length() > 1u && path.back() == '/') {
+      path.remove_suffix(1u);
+    }
+
+    const auto trie = trie_.Read();
+
+    // The nodes matching the path prefixes, each with the position in `path` where its prefix ends.
+    // The root node matches the "/" prefix, which, for the purposes of this code, ends at position zero.
+    struct Prefix {
+      const Node* node;
+      size_t end;
+    };
+    std::array<Prefix, kMaxPrefixesOnStack> prefixes_on_stack;
+    std::vector<Prefix> prefixes_on_heap;
+    size_t prefixes_count = 0u;
+    const auto add_prefix = [&](const Node* node, size_t end) {
+      if (prefixes_count < kMaxPrefixesOnStack) {
+        prefixes_on_stack[prefixes_count] = Prefix{node, end};
+      } else {
+        if (prefixes_count == kMaxPrefixesOnStack) {
+          prefixes_on_heap.assign(prefixes_on_stack.begin(), prefixes_on_stack.end());
+        }
+        prefixes_on_heap.push_back(Prefix{node, end});
+      }
+      ++prefixes_count;
+    };
+    const auto prefix_at = [&](size_t index) -> const Prefix& {
+      return prefixes_count > kMaxPrefixesOnStack ? prefixes_on_heap[index] : prefixes_on_stack[index];
+    };
+
+    add_prefix(&(*trie), 0u);
+    if (path.length() > 1u) {
+      const Node* node = &(*trie);
+      for (size_t begin = 1u; begin <= path.length();) {
+        const size_t end = std::min(path.find('/', begin), path.length());
+        const auto cit = node->children.find(path.substr(begin, end - begin));
+        if (cit == node->children.end()) {
+          break;
+        }
+        node = cit->second.get();
+        add_prefix(node, end);
+        begin = end + 1u;
+      }
+    }
+
+    // The number of non-empty path components past the deepest matched prefix.
+    size_t args_count = 0u;
+    for (size_t i = prefix_at(prefixes_count - 1u).end; i < path.length(); ++i) {
+      if (path[i] != '/' && (i == 0u || path[i - 1u] == '/')) {
+        ++args_count;
+      }
+    }
+
+    // Only the prefixes that end with a non-empty component, or the root one, are tried,
+    // since the trailing slashes are dropped after each component is moved into the URL path arguments.
+    for (size_t index = prefixes_count; index-- > 0u;) {
+      const Prefix& prefix = prefix_at(index);
+      if (index == 0u || prefix.end > prefix_at(index - 1u).end + 1u) {
+        HTTPRoute* route =
+            args_count < prefix.node->handlers.size() ? prefix.node->handlers[args_count].get() : nullptr;
+        if (route) {
+          HTTPRouteInUse result(*route);
+          for (size_t end = path.length(); end > prefix.end;) {
+            const size_t begin = path.rfind('/', end - 1u) + 1u;
+            if (begin < end) {
+              output_url_args.add(URL::DecodeURIComponent(path.substr(begin, end - begin)));
+            }
+            end = begin - 1u;
+          }
+          output_url_args.base_path = index ? std::string(path.substr(0u, prefix.end)) : "/";
+          return result;
+        }
+        ++args_count;
+      }
+    }
+    return HTTPRouteInUse();
+  }
+
+  // The writer side. Must be called under the mutex of the server.
+  const handlers_t& Get(const std::string& path) const {
+    static const handlers_t empty;
+    const Node* node = trie_.Current().get();
+    for (const std::string& component : Components(path)) {
+      const auto cit = node->children.find(component);
+      if (cit == node->children.end()) {
+        return empty;
+      }
+      node = cit->second.get();
+    }
+    return node->handlers;
+  }
+
+  // Publishes the new trie, and then waits for each replaced handler to finish serving the requests it is serving.
+  void Set(const std::string& path, const handlers_t& handlers) {
+    const handlers_t previous = Get(path);
+    const std::vector<std::string> components = Components(path);
+    std::shared_ptr<const Node> root = WithHandlers(trie_.Current().get(), components, 0u, handlers);
+    trie_.Publish(root ? std::move(root) : std::make_shared<const Node>());
+    for (size_t i = 0u; i < previous.size(); ++i) {
+      if (previous[i] && previous[i] != handlers[i]) {
+        previous[i]->WaitUntilNotInUse();
+      }
+    }
+  }
+
+ private:
+  enum { kMaxPrefixesOnStack = 32 };
+
+  struct Node final {
+    handlers_t handlers;
+    std::map<std::string, std::shared_ptr<const Node>, std::less<>> children;
+
+    bool Empty() const {
+      if (!children.empty()) {
+        return false;
+      }
+      for (const auto& handler : handlers) {
+        if (handler) {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+
+  // The registered paths are validated to start with a slash, and to not end with one, unless it's the "/" path.
+  static std::vector<std::string> Components(const std::string& path) {
+    std::vector<std::string> components;
+    if (path.length() > 1u) {
+      for (size_t i = 1u; i <= path.length();) {
+        const size_t end = std::min(path.find('/', i), path.length());
+        components.push_back(path.substr(i, end - i));
+        i = end + 1u;
+      }
+    }
+    return components;
+  }
+
+  // Returns the copy of `node` with `handlers` set at `components[depth...]`, or `nullptr` if it ends up empty.
+  // The subtrees off the path to the updated node are shared with the previous version of the trie.
+  static std::shared_ptr<const Node> WithHandlers(const Node* node,
+                                                  const std::vector<std::string>& components,
+                                                  size_t depth,
+                                                  const handlers_t& handlers) {
+    auto copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+    if (depth == components.size()) {
+      copy->handlers = handlers;
+    } else {
+      const auto it = copy->children.find(components[depth]);
+      std::shared_ptr<const Node> child =
+          WithHandlers(it != copy->children.end() ? it->second.get() : nullptr, components, depth + 1u, handlers);
+      if (child) {
+        copy->children[components[depth]] = std::move(child);
+      } else if (it != copy->children.end()) {
+        copy->children.erase(it);
+      }
+    }
+    if (copy->Empty()) {
+      return nullptr;
+    }
+    return copy;
+  }
+
+  RCUPublished<Node> trie_;
+};
+
+}  // namespace current::http::impl
+}  // namespace current::http
+}  // namespace current
+
+#endif  // BLOCKS_HTTP_IMPL_POSIX_SERVER_ROUTES_H
@@ -82,6 +82,9 @@ DEFINE_int32(net_api_test_port_secondary,
              "different from "
              "ports in other network-based tests, since API-driven HTTP server will hold it open for the whole "
              "lifetime of the binary.");
+DEFINE_int32(net_api_test_port_epoll,
+             PickPortForUnitTest(),
+             "Local port to use for the test API-based HTTP server run by the `epoll` engine.");
 DEFINE_string(net_api_test_tmpdir, ".current", "Local path for the test to create temporary files in.");
 
 CURRENT_STRUCT(HTTPAPITestObject) {
@@ -227,6 +230,68 @@ TEST(HTTPAPI, ComposeURLPathWithURLPathArgs) {
   EXPECT_EQ("/ (/user/a/1/blah, /user/a/1/blah)", run("/user/a/1/blah/"));
 }
 
+TEST(HTTPAPI, RouteTableLookup) {
+  using current::http::impl::HTTPRoute;
+  using current::http::impl::HTTPRoutes;
+
+  HTTPRoutes routes;
+  const auto route = std::make_shared<HTTPRoute>([](Request) {});
+  HTTPRoutes::handlers_t any;
+  any.fill(route);
+  HTTPRoutes::handlers_t none;
+  none[0] = route;
+  routes.Set("/", any);
+  routes.Set("/a//b", none);
+  routes.Set("/a/b/c", any);
+
+  const auto find = [&routes](const std::string& path) -> std::string {
+    URLPathArgs args;
+    if (!routes.Find(path, args)) {
+      return "404";
+    }
+    return args.base_path + " (" + current::strings::Join(args, ", ") + ")";
+  };
+
+  EXPECT_EQ("/ ()", find("/"));
+  EXPECT_EQ("/ ()", find("///"));
+  EXPECT_EQ("/a//b ()", find("/a//b"));
+  EXPECT_EQ("/a//b ()", find("/a//b//"));
+  EXPECT_EQ("/ (a, b, x)", find("/a//b/x"));
+  EXPECT_EQ("/a/b/c (x, y z)", find("/a/b/c//x/y+z/"));
+  EXPECT_EQ("/ (1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)",
+            find("/1/2/3/4/5/6/7/8/9/10/11/12/13/14/15"));
+  EXPECT_EQ("404", find("/1/2/3/4/5/6/7/8/9/10/11/12/13/14/15/16"));
+  EXPECT_EQ("/a/b/c (4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18)",
+            find("/a/b/c/4/5/6/7/8/9/10/11/12/13/14/15/16/17/18"));
+
+  routes.Set("/", HTTPRoutes::handlers_t());
+  EXPECT_EQ("404", find("/a//b/x"));
+  EXPECT_EQ("/a//b ()", find("/a//b"));
+  routes.Set("/a//b", HTTPRoutes::handlers_t());
+  routes.Set("/a/b/c", HTTPRoutes::handlers_t());
+  EXPECT_EQ("404", find("/a/b/c"));
+}
+
+TEST(HTTPAPI, UnRegisterWaitsForTheHandlerToReturn) {
+  const string url = Printf("http://localhost:%d/slow", FLAGS_net_api_test_port);
+  std::atomic_bool handler_entered(false);
+  std::atomic_bool handler_returned(false);
+  auto scope = HTTP(FLAGS_net_api_test_port).Register("/slow", [&](Request r) {
+    handler_entered = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    r("done");
+    handler_returned = true;
+  });
+  std::thread client([&url]() { EXPECT_EQ("done", HTTP(GET(url)).body); });
+  while (!handler_entered) {
+    std::this_thread::yield();
+  }
+  scope = nullptr;
+  EXPECT_TRUE(handler_returned);
+  client.join();
+  EXPECT_EQ(404, static_cast<int>(HTTP(GET(url)).code));
+}
+
 TEST(HTTPAPI, ScopeLeftHangingThrowsAnException) {
   const string url = Printf("http://localhost:%d/foo", FLAGS_net_api_test_port);
 
@@ -271,6 +336,35 @@ TEST(HTTPAPI, ScopeCanBeAssignedNullPtr) {
   EXPECT_EQ(404, static_cast<int>(HTTP(GET(url)).code));
 }
 
+TEST(HTTPAPI, AsyncRequests) {
+  const auto scope = HTTP(FLAGS_net_api_test_port)
+                         .Register("/async", [](Request r) { r(r.method + ' ' + r.url.query["i"] + ' ' + r.body); });
+  const string url = Printf("http://localhost:%d/async", FLAGS_net_api_test_port);
+
+  EXPECT_EQ("GET 0 ", HTTPAsync(GET(url + "?i=0")).get().body);
+
+  std::vector<POST> batch;
+  for (int i = 0; i < 20; ++i) {
+    batch.emplace_back(url + "?i=" + current::ToString(i), "x");
+  }
+  auto futures = HTTPAsync(batch);
+  ASSERT_EQ(20u, futures.size());
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ("POST " + current::ToString(i) + " x", futures[i].get().body);
+  }
+
+  std::promise<std::string> response;
+  HTTPAsync(GET(url + "?i=42"), [&response](HTTPResponseWithBuffer r) { response.set_value(r.body); });
+  EXPECT_EQ("GET 42 ", response.get_future().get());
+
+  std::promise<std::string> error;
+  HTTPAsync(GET("http://999.999.999.999/"),
+            [](HTTPResponseWithBuffer) { ASSERT_TRUE(false); },
+            [&error](const current::Exception& e) { error.set_value(e.what()); });
+  EXPECT_FALSE(error.get_future().get().empty());
+  EXPECT_THROW(HTTPAsync(GET("http://999.999.999.999/")).get(), SocketResolveAddressException);
+}
+
 TEST(HTTPAPI, URLParameters) {
   const auto scope = HTTP(FLAGS_net_api_test_port).Register("/query", [](Request r) { r("x=" + r.url.query["x"]); });
   EXPECT_EQ("x=", HTTP(GET(Printf("http://localhost:%d/query", FLAGS_net_api_test_port))).body);
@@ -1811,3 +1905,147 @@ TEST(HTTPAPI, JSONDoesHaveCORSHeaderByDefault) {
     EXPECT_EQ("*", response.headers.Get("Access-Control-Allow-Origin"));
   }
 }
+
+#ifdef CURRENT_POSIX
+
+// The options all the tests of the `epoll` engine run its server with, as they are fixed per port.
+inline HTTPServerOptions EpollTestServerOptions() {
+  return HTTPServerOptions(HTTPServerEngine::Epoll, 2u, std::chrono::milliseconds(200));
+}
+
+TEST(HTTPAPI, EpollEngineFramesRequests) {
+  using current::http::impl::FrameHTTPRequest;
+  const auto Frame = [](const std::string& s) { return FrameHTTPRequest(s.data(), s.data() + s.length()); };
+
+  EXPECT_EQ(0u, Frame("").length);
+  EXPECT_EQ(0u, Frame("GET / HTTP/1.1\r\nHost: x\r\n").length);
+  EXPECT_EQ(27u, Frame("GET / HTTP/1.1\r\nHost: x\r\n\r\nGET /next HTTP/1.1\r\n").length);
+  EXPECT_TRUE(Frame("GET / HTTP/1.1\r\n\r\n").keep_alive);
+  EXPECT_FALSE(Frame("GET / HTTP/1.1\r\nConnection: close\r\n\r\n").keep_alive);
+  EXPECT_FALSE(Frame("GET / HTTP/1.0\r\n\r\n").keep_alive);
+  EXPECT_TRUE(Frame("GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n").keep_alive);
+
+  EXPECT_EQ(0u, Frame("POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nfoo").length);
+  EXPECT_EQ(43u, Frame("POST / HTTP/1.1\r\ncontent_length: 5\r\n\r\nfoo\r\nGET").length);
+
+  const std::string chunked = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nfoo\r\n";
+  EXPECT_EQ(0u, Frame(chunked).length);
+  EXPECT_EQ(0u, Frame(chunked + "4\r\n\r\n\r\n").length);
+  EXPECT_EQ(chunked.length() + 12u, Frame(chunked + "4\r\n\r\n\r\n\r\n0\r\n\r\n").length);
+}
+
+TEST(HTTPAPI, EpollEngineServesRequests) {
+  auto& server = HTTP(FLAGS_net_api_test_port_epoll, EpollTestServerOptions());
+  EXPECT_TRUE(server.Options() == EpollTestServerOptions());
+  EXPECT_THROW(HTTP(FLAGS_net_api_test_port_epoll, HTTPServerOptions()),
+               current::http::HTTPServerAlreadyRunningWithDifferentOptionsException);
+
+  const auto scope = server.Register("/hello", [](Request r) { r("Hello, " + r.url.query["name"] + "!\n"); }) +
+                     server.Register("/echo", [](Request r) { r(r.method + ' ' + r.body); });
+
+  const std::string base_url = Printf("http://localhost:%d", FLAGS_net_api_test_port_epoll);
+  {
+    const auto response = HTTP(GET(base_url + "/hello?name=epoll"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ("Hello, epoll!\n", response.body);
+    EXPECT_EQ("keep-alive", response.headers.Get("Connection"));
+  }
+  {
+    const auto response = HTTP(POST(base_url + "/echo", std::string(100000, 'x'), "text/plain"));
+    EXPECT_EQ(200, static_cast<int>(response.code));
+    EXPECT_EQ("POST " + std::string(100000, 'x'), response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "/nope"));
+    EXPECT_EQ(404, static_cast<int>(response.code));
+    EXPECT_EQ(DefaultNotFoundMessage(), response.body);
+  }
+}
+
+TEST(HTTPAPI, EpollEngineKeepAliveAndPipelining) {
+  auto& server = HTTP(FLAGS_net_api_test_port_epoll, EpollTestServerOptions());
+  // The second handler responds from another thread, after the first one has returned.
+  const auto scope =
+      server.Register("/sync", [](Request r) { r("sync:" + r.body); }) +
+      server.Register("/async", [](Request r) {
+        std::thread([](Request r) { r("async:" + r.body); }, std::move(r)).detach();
+      });
+
+  Connection connection(current::net::ClientSocket("localhost", FLAGS_net_api_test_port_epoll));
+  // All the requests are sent at once, before reading any responses. The last one asks to close the connection.
+  connection.BlockingWrite(
+      "POST /sync HTTP/1.1\r\nContent-Length: 1\r\n\r\n1"
+      "POST /async HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\n2\r\n0\r\n\r\n"
+      "GET /sync HTTP/1.1\r\n\r\n"
+      "POST /async HTTP/1.1\r\nContent-Length: 1\r\nConnection: close\r\n\r\n4",
+      false);
+
+  const auto Response = [](const std::string& connection_header, const std::string& body) {
+    return "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: " + connection_header +
+           "\r\nContent-Length: " + std::to_string(body.length()) + "\r\n\r\n" + body;
+  };
+  const std::string expected = Response("keep-alive", "sync:1") + Response("keep-alive", "async:2") +
+                               Response("keep-alive", "sync:") + Response("close", "async:4");
+
+  std::string received(expected.length(), '\0');
+  ASSERT_EQ(expected.length(), connection.BlockingRead(&received[0], received.length(), Connection::FillFullBuffer));
+  EXPECT_EQ(expected, received);
+
+  // The server has closed the connection after the last response.
+  char c;
+  EXPECT_THROW(connection.BlockingRead(&c, 1u), current::net::SocketException);
+}
+
+TEST(HTTPAPI, EpollEngineClosesIdleConnections) {
+  auto& server = HTTP(FLAGS_net_api_test_port_epoll, EpollTestServerOptions());
+  const auto scope = server.Register("/idle", [](Request r) { r("idle"); });
+
+  Connection connection(current::net::ClientSocket("localhost", FLAGS_net_api_test_port_epoll));
+  connection.BlockingWrite("GET /idle HTTP/1.1\r\n\r\n", false);
+  const std::string expected =
+      "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: keep-alive\r\nContent-Length: 4\r\n\r\nidle";
+  std::string received(expected.length(), '\0');
+  ASSERT_EQ(expected.length(), connection.BlockingRead(&received[0], received.length(), Connection::FillFullBuffer));
+  EXPECT_EQ(expected, received);
+
+  // Nothing is sent after the response, so the connection is closed by the server once the idle timeout is over.
+  const auto begin = std::chrono::steady_clock::now();
+  char c;
+  EXPECT_THROW(connection.BlockingRead(&c, 1u), current::net::SocketException);
+  EXPECT_GE(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(100));
+}
+
+TEST(HTTPAPI, ClientKeepsConnectionsAlive) {
+  auto& server = HTTP(FLAGS_net_api_test_port_epoll, EpollTestServerOptions());
+  const auto scope =
+      server.Register("/port", [](Request r) { r(current::ToString(r.connection.RemoteIPAndPort().port)); });
+  const std::string url = Printf("http://localhost:%d/port", FLAGS_net_api_test_port_epoll);
+
+  auto& pool = current::Singleton<current::http::HTTPClientConnectionPool>();
+  pool.Clear();
+  const auto stats_before = pool.GetStats();
+
+  const std::string port = HTTP(GET(url)).body;
+  EXPECT_EQ(port, HTTP(GET(url)).body);
+  EXPECT_EQ(port, HTTP(POST(url, "body")).body);
+  EXPECT_NE(port, HTTP(GET(url).KeepAlive(false)).body);
+  EXPECT_EQ(stats_before.connections_opened + 1u, pool.GetStats().connections_opened);
+  EXPECT_EQ(stats_before.connections_reused + 2u, pool.GetStats().connections_reused);
+
+  // Empty requests and responses are not held back by `MSG_MORE` over the kept alive connections.
+  const auto empty_scope = server.Register("/empty", [](Request r) { r("", HTTPResponseCode.NoContent); });
+  const std::string empty_url = Printf("http://localhost:%d/empty", FLAGS_net_api_test_port_epoll);
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(204, static_cast<int>(HTTP(POST(empty_url, "")).code));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::milliseconds(150));
+
+  // The server closes the connections idle for longer than 200ms, and the pool checks for it before reusing them.
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_NE(port, HTTP(GET(url)).body);
+  EXPECT_EQ(stats_before.connections_opened + 2u, pool.GetStats().connections_opened);
+  EXPECT_EQ(stats_before.connections_discarded + 1u, pool.GetStats().connections_discarded);
+}
+
+#endif  // CURRENT_POSIX
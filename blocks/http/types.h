@@ -43,6 +43,11 @@ SOFTWARE.
 namespace current {
 namespace http {
 
+// Thrown by `HTTP(port, options)` if the server on this port is already running with different options.
+struct HTTPServerAlreadyRunningWithDifferentOptionsException : Exception {
+  using Exception::Exception;
+};
+
 // The policy for registering HTTP endpoints.
 // TODO(dkorolev): Add another option, to throw if the handler does not exist, while it's expected to?
 enum class ReRegisterRoute { ThrowOnAttempt, SilentlyUpdateExisting };
@@ -59,6 +64,7 @@ struct HTTPRequestBase {
   std::string custom_user_agent = "";
   current::net::http::Headers custom_headers;
   bool allow_redirects = false;
+  bool keep_alive = true;
 
   HTTPRequestBase(const std::string& url) : url(url) {}
 
@@ -72,6 +78,12 @@ struct HTTPRequestBase {
     return static_cast<T&>(*this);
   }
 
+  // Whether the POSIX client may send the request over a kept alive connection, and keep this one alive after it.
+  T& KeepAlive(bool keep_alive_setting = true) {
+    keep_alive = keep_alive_setting;
+    return static_cast<T&>(*this);
+  }
+
   T& SetHeader(const std::string& key, const std::string& value) {
     custom_headers.emplace_back(key, value);
     return static_cast<T&>(*this);
@@ -231,15 +243,12 @@ struct HTTPImpl {
   typedef CHUNKED_CLIENT_IMPL chunked_client_impl_t;
   typedef SERVER_IMPL server_impl_t;
 
-  server_impl_t& operator()(uint16_t port) {
-    static std::mutex mutex;
-    static std::map<uint16_t, std::unique_ptr<server_impl_t>> servers;
-    std::lock_guard<std::mutex> lock(mutex);
-    std::unique_ptr<server_impl_t>& server = servers[port];
-    if (!server) {
-      server.reset(new server_impl_t(port));
-    }
-    return *server;
+  server_impl_t& operator()(uint16_t port) { return Server(port, nullptr); }
+
+  // The `options`, such as which engine to run the server with, are only applied when the server is started,
+  // so they should be passed on the first access to the port. Later on, only the same options are accepted.
+  server_impl_t& operator()(uint16_t port, const typename server_impl_t::options_t& options) {
+    return Server(port, &options);
   }
 
   // TODO(dkorolev): Deprecate the below some time in the future. And perhaps add an `http_port_t`.
@@ -247,6 +256,10 @@ struct HTTPImpl {
     CURRENT_ASSERT(port > 0 && port < 65536);
     return operator()(static_cast<uint16_t>(port));
   }
+  server_impl_t& operator()(int port, const typename server_impl_t::options_t& options) {
+    CURRENT_ASSERT(port > 0 && port < 65536);
+    return operator()(static_cast<uint16_t>(port), options);
+  }
 
   template <typename REQUEST_PARAMS, typename RESPONSE_PARAMS = KeepResponseInMemory>
   inline typename ResponseTypeFromRequestType<RESPONSE_PARAMS>::response_type_t operator()(
@@ -282,6 +295,20 @@ struct HTTPImpl {
       return HTTPResponseCode.InvalidCode;
     }
   }
+
+ private:
+  server_impl_t& Server(uint16_t port, const typename server_impl_t::options_t* options) {
+    static std::mutex mutex;
+    static std::map<uint16_t, std::unique_ptr<server_impl_t>> servers;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<server_impl_t>& server = servers[port];
+    if (!server) {
+      server.reset(options ? new server_impl_t(port, *options) : new server_impl_t(port));
+    } else if (options && server->Options() != *options) {
+      CURRENT_THROW(HTTPServerAlreadyRunningWithDifferentOptionsException(std::to_string(port)));
+    }
+    return *server;
+  }
 };
 
 }  // namespace http
@@ -70,6 +70,14 @@ struct UnsafePublishBadIndexTimestampException : PersistenceException {
             "Expecting index %lld, seeing %lld.", static_cast<long long>(expected), static_cast<long long>(found))) {}
 };
 
+struct InvalidPublishBatchException : PersistenceException {
+  explicit InvalidPublishBatchException(size_t entries, size_t timestamps)
+      : PersistenceException(current::strings::Printf("Expecting a non-empty batch with a timestamp per entry, seeing "
+                                                      "%lld entries and %lld timestamps.",
+                                                      static_cast<long long>(entries),
+                                                      static_cast<long long>(timestamps))) {}
+};
+
 }  // namespace peristence
 }  // namespace current
 
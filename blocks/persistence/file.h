@@ -27,13 +27,36 @@ SOFTWARE.
 // The file is replayed at startup to check its integriry and to extract the most recent index/timestamp.
 // Each iterator opens the same file again, to read its first N lines.
 // Iterators never outlive the persister.
+//
+// Publishing is group-committed: concurrent publishers append their serialized entries to a pending batch,
+// and one of them, the leader, writes the whole batch with a single `writev()`, outside the publishing mutex.
+// Each `Publish()` returns once its batch is as durable as the `FileSyncPolicy` of the persister requires.
+//
+// Only every `index_stride`-th entry is indexed in memory, and in the sidecar index file, `<filename>.idx`.
+// At startup, the sidecar index is trusted, and only the tail of the file past its last checkpoint is replayed.
 
 #ifndef BLOCKS_PERSISTENCE_FILE_H
 #define BLOCKS_PERSISTENCE_FILE_H
 
 #include <atomic>
+#include <climits>
+#include <condition_variable>
 #include <fstream>
+#include <iterator>
 #include <functional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef CURRENT_WINDOWS
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#endif  // CURRENT_WINDOWS
 
 #ifdef CURRENT_BUILD_WITH_PARANOIC_RUNTIME_CHECKS
 #include <iostream>
@@ -44,16 +67,39 @@ SOFTWARE.
 #include "../ss/persister.h"
 #include "../ss/signature.h"
 
+#include "../../bricks/file/file.h"
+#include "../../bricks/strings/scan.h"
 #include "../../bricks/sync/locks.h"
 #include "../../bricks/sync/owned_borrowed.h"
 #include "../../bricks/time/chrono.h"
 #include "../../bricks/util/atomic_that_works.h"
+#include "../../bricks/util/crc32.h"
 #include "../../typesystem/schema/schema.h"
 #include "../../typesystem/serialization/json.h"
 
 namespace current {
 namespace persistence {
 
+// How hard `FilePersister` tries to have the published entries survive a crash of the machine, not just the process.
+// Nothing is buffered in user space, so each batch always reaches the OS before its publishers return;
+// thus "no sync" and "flush only" are the same policy, `FlushOnly`.
+enum class FileSyncPolicy : int {
+  FlushOnly = 0,              // Each batch is handed over to the OS, which is enough to survive a crash of the process.
+  FDataSyncEveryBatch = 1,    // Each batch is `fdatasync()`-ed before its publishers return.
+  FDataSyncPeriodically = 2,  // The file is `fdatasync()`-ed in the background every `sync_period`, if changed.
+};
+
+struct FilePersisterOptions {
+  FileSyncPolicy sync_policy = FileSyncPolicy::FlushOnly;
+  std::chrono::milliseconds sync_period = std::chrono::milliseconds(100);
+  uint64_t index_stride = 256u;  // Index every this many entries. Changing it rebuilds the sidecar index.
+
+  FilePersisterOptions() = default;
+  FilePersisterOptions(FileSyncPolicy sync_policy,
+                       std::chrono::milliseconds sync_period = std::chrono::milliseconds(100))
+      : sync_policy(sync_policy), sync_period(sync_period) {}
+};
+
 namespace impl {
 
 namespace constants {
@@ -61,17 +107,154 @@ constexpr char kDirectiveMarker = '#';
 constexpr char kSignatureDirective[] = "#signature";
 constexpr char kHeadDirective[] = "#head";
 constexpr char kHeadFormatString[] = "%020lld";
+constexpr char kIndexFileSuffix[] = ".idx";
+constexpr uint64_t kIndexFileMagic = 0x3130584449545343ull;  // "CSTIDX01".
 }  // namespace current::persistence::impl::constants
 
 typedef int64_t head_value_t;
 
+// The file descriptor to append the batches of lines to. Writes go straight to the OS, bypassing `std::ofstream`,
+// so that a batch of any number of lines is written with one syscall.
+class AppendOnlyFile final {
+ public:
+  explicit AppendOnlyFile(const std::string& filename)
+      :
+#ifndef CURRENT_WINDOWS
+        fd_(::open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644))
+#else
+        fd_(::_open(filename.c_str(), _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE))
+#endif  // CURRENT_WINDOWS
+  {
+  }
+
+  ~AppendOnlyFile() {
+    if (fd_ >= 0) {
+#ifndef CURRENT_WINDOWS
+      ::close(fd_);
+#else
+      ::_close(fd_);
+#endif  // CURRENT_WINDOWS
+    }
+  }
+
+  bool IsOpen() const { return fd_ >= 0; }
+
+  // Returns `false` if the lines could not be written in full.
+  bool Write(const std::vector<std::string>& lines) {
+#ifndef CURRENT_WINDOWS
+#ifdef IOV_MAX
+    const size_t max_iov = static_cast<size_t>(IOV_MAX);
+#else
+    const size_t max_iov = 1024u;
+#endif  // IOV_MAX
+    std::vector<struct iovec> iov;
+    iov.reserve(lines.size());
+    for (const std::string& line : lines) {
+      if (!line.empty()) {
+        iov.push_back({const_cast<char*>(line.data()), line.length()});
+      }
+    }
+    size_t i = 0u;
+    while (i < iov.size()) {
+      const ssize_t written = ::writev(fd_, &iov[i], static_cast<int>(std::min(iov.size() - i, max_iov)));
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      // Skip what has been written, which may end in the middle of a line.
+      size_t remaining = static_cast<size_t>(written);
+      while (i < iov.size() && remaining >= iov[i].iov_len) {
+        remaining -= iov[i].iov_len;
+        ++i;
+      }
+      if (remaining) {
+        iov[i].iov_base = reinterpret_cast<char*>(iov[i].iov_base) + remaining;
+        iov[i].iov_len -= remaining;
+      }
+    }
+    return true;
+#else
+    std::string buffer;
+    for (const std::string& line : lines) {
+      buffer += line;
+    }
+    const char* ptr = buffer.data();
+    size_t size = buffer.length();
+    while (size) {
+      const int written = ::_write(fd_, ptr, static_cast<unsigned int>(size));
+      if (written <= 0) {
+        return false;
+      }
+      ptr += written;
+      size -= static_cast<size_t>(written);
+    }
+    return true;
+#endif  // CURRENT_WINDOWS
+  }
+
+  // Returns `false` if the data could not be synced, in which case what is written past the last sync is suspect.
+  bool SyncData() {
+#if defined(CURRENT_WINDOWS)
+    return !::_commit(fd_);
+#elif defined(CURRENT_APPLE)
+    return !::fsync(fd_);
+#else
+    return !::fdatasync(fd_);
+#endif
+  }
+
+  // Cut off the partially written tail of a failed write. The appends that follow go past the new end.
+  bool Truncate(std::streamoff size) {
+#ifndef CURRENT_WINDOWS
+    return !::ftruncate(fd_, static_cast<off_t>(size));
+#else
+    return !::_chsize_s(fd_, static_cast<__int64>(size));
+#endif  // CURRENT_WINDOWS
+  }
+
+ private:
+  const int fd_;
+
+  AppendOnlyFile() = delete;
+  AppendOnlyFile(const AppendOnlyFile&) = delete;
+  AppendOnlyFile& operator=(const AppendOnlyFile&) = delete;
+};
+
+// A record of the sidecar index file: the offset and the timestamp of the entry with a certain index.
+// The first record of the file is the header, `{ kIndexFileMagic, index_stride, 0 }`.
+struct FileIndexRecord {
+  uint64_t index;
+  int64_t offset;
+  int64_t us;
+  uint32_t crc;
+  uint32_t reserved;
+
+  static FileIndexRecord Make(uint64_t index, int64_t offset, int64_t us) {
+    FileIndexRecord record;
+    record.index = index;
+    record.offset = offset;
+    record.us = us;
+    record.crc = record.ComputeCRC();
+    record.reserved = 0u;
+    return record;
+  }
+
+  uint32_t ComputeCRC() const { return CRC32(0u, reinterpret_cast<const char*>(this), offsetof(FileIndexRecord, crc)); }
+  bool IsValid() const { return crc == ComputeCRC(); }
+  std::string AsString() const { return std::string(reinterpret_cast<const char*>(this), sizeof(FileIndexRecord)); }
+};
+static_assert(sizeof(FileIndexRecord) == 32, "");
+
 // An iterator to read a file line by line, extracting tab-separated `idxts_t index` and `const char* data`.
 // Validates the entries come in the right order of 0-based indexes, and with strictly increasing timestamps.
+// The file is read in large blocks, and the lines of each block, and their tabs, are found all at once, in bulk.
 template <typename ENTRY>
 class IteratorOverFileOfPersistedEntries {
  public:
   IteratorOverFileOfPersistedEntries(std::istream& fi, std::streampos offset, uint64_t index_at_offset)
-      : fi_(fi), next_(index_at_offset, std::chrono::microseconds(0)) {
+      : fi_(fi), offset_(offset), next_(index_at_offset, std::chrono::microseconds(0)) {
     CURRENT_ASSERT(!fi_.bad());
     if (offset) {
       fi_.seekg(offset, std::ios_base::beg);
@@ -80,42 +263,97 @@ class IteratorOverFileOfPersistedEntries {
 
   template <typename F1, typename F2>
   bool ProcessNextEntry(F1&& on_entry, F2&& on_directive) {
-    if (std::getline(fi_, line_)) {
-      // A directive always starts with kDirectiveMarker ('#'),
-      // an entry - with JSON-serialized `idxts_t` object
-      if (line_[0] != constants::kDirectiveMarker) {
-        const size_t tab_pos = line_.find('\t');
-        if (tab_pos == std::string::npos) {
-          CURRENT_THROW(MalformedEntryException(line_));
-        }
-        const auto current = ParseJSON<idxts_t>(line_.substr(0, tab_pos));
-        if (current.index != next_.index) {
-          // Indexes must be strictly continuous.
-          CURRENT_THROW(ss::InconsistentIndexException(next_.index, current.index));
-        }
-        if (current.us < next_.us) {
-          // Timestamps must monotonically increase.
-          CURRENT_THROW(ss::InconsistentTimestampException(next_.us, current.us));
-        }
-        on_entry(current, line_.c_str() + tab_pos + 1);
-        next_ = current;
-        ++next_.index;
-        ++next_.us;
-      } else {
-        on_directive(line_);
+    if (next_line_ == lines_.size() && !ReadLines()) {
+      return false;
+    }
+    const line_t& line = lines_[next_line_++];
+    char* const data = &buffer_[line.begin];
+    offset_ += static_cast<std::streamoff>(line.length + 1u);
+    // A directive always starts with kDirectiveMarker ('#'),
+    // an entry - with JSON-serialized `idxts_t` object
+    if (data[0] != constants::kDirectiveMarker) {
+      if (line.tab_pos == std::string_view::npos) {
+        CURRENT_THROW(MalformedEntryException(std::string(data, line.length)));
       }
-      return true;
+      const auto current = ss::ParseIndexAndTimestampJSON(std::string_view(data, line.tab_pos));
+      if (current.index != next_.index) {
+        // Indexes must be strictly continuous.
+        CURRENT_THROW(ss::InconsistentIndexException(next_.index, current.index));
+      }
+      if (current.us < next_.us) {
+        // Timestamps must monotonically increase.
+        CURRENT_THROW(ss::InconsistentTimestampException(next_.us, current.us));
+      }
+      on_entry(current, data + line.tab_pos + 1);
+      next_ = current;
+      ++next_.index;
+      ++next_.us;
     } else {
-      return false;
+      on_directive(std::string(data, line.length));
     }
+    return true;
   }
 
   // Return the absolute lowest possible next entry to scan or publish.
   idxts_t Next() const { return next_; }
 
+  // The offset in the file right past the most recently processed line, where the next one begins.
+  std::streampos Offset() const { return offset_; }
+
  private:
+  // The blocks grow from small, for the iterators which only read a few entries, to large, for the full replay.
+  constexpr static size_t kInitialBlockSize = 1u << 14;
+  constexpr static size_t kMaxBlockSize = 1u << 20;
+
+  // Where the line is within `buffer_`, without its '\n', which is replaced by '\0', and where its first tab is.
+  struct line_t {
+    size_t begin;
+    size_t length;
+    size_t tab_pos;
+  };
+
+  // Reads the next block of the file, and finds its lines. As `std::getline()` would, treats the incomplete last line
+  // of the file as a line. Returns `false` once there are no lines left.
+  bool ReadLines() {
+    // Keep the incomplete line, if any, which the previous block ended with.
+    buffer_.erase(0u, unprocessed_begin_);
+    unprocessed_begin_ = 0u;
+    lines_.clear();
+    next_line_ = 0u;
+    while (lines_.empty()) {
+      const size_t kept = buffer_.length();
+      bool eof = true;
+      if (fi_) {
+        buffer_.resize(kept + block_size_);
+        fi_.read(&buffer_[kept], static_cast<std::streamsize>(block_size_));
+        buffer_.resize(kept + static_cast<size_t>(fi_.gcount()));
+        eof = !fi_;
+        block_size_ = std::min(block_size_ * 2u, kMaxBlockSize);
+      }
+      unprocessed_begin_ = strings::ForEachLineWithTab(buffer_, [this](std::string_view line, size_t tab_pos) {
+        const size_t begin = static_cast<size_t>(line.data() - buffer_.data());
+        buffer_[begin + line.length()] = '\0';
+        lines_.push_back({begin, line.length(), tab_pos});
+      });
+      if (eof) {
+        if (unprocessed_begin_ < buffer_.length()) {
+          const std::string_view line = std::string_view(buffer_).substr(unprocessed_begin_);
+          lines_.push_back({unprocessed_begin_, line.length(), line.find('\t')});
+          unprocessed_begin_ = buffer_.length();
+        }
+        break;
+      }
+    }
+    return !lines_.empty();
+  }
+
   std::istream& fi_;
-  std::string line_;
+  std::string buffer_;
+  size_t block_size_ = kInitialBlockSize;
+  size_t unprocessed_begin_ = 0u;
+  std::vector<line_t> lines_;
+  size_t next_line_ = 0u;
+  std::streampos offset_;
   idxts_t next_;
 };
 
@@ -147,20 +385,53 @@ class FilePersister {
  private:
   struct FilePersisterImpl final {
     const std::string filename_;
-    std::ofstream file_appender_;
+    const FilePersisterOptions options_;
+    AppendOnlyFile file_appender_;  // Must be initialized before `head_rewriter_`, as it creates the file.
     std::fstream head_rewriter_;
 
-    // `record_offset_.size() == end.next_index`,
-    // and `record_offset_[i]` is the record_offset_ in bytes where the line for index `i` begins.
-    std::mutex& publish_mutex_ref_;  // Guards `record_offset_`, `head_offset_` and `record_timestamp_`.
-    std::vector<std::streampos> record_offset_;
+    // `checkpoints_[i]` is where the line for index `i * index_stride_` begins, and the timestamp of that entry.
+    // `checkpoints_.size() == (pending_end_.next_index + index_stride_ - 1) / index_stride_`.
+    struct checkpoint_t {
+      std::streampos offset;
+      std::chrono::microseconds us;
+    };
+    std::mutex& publish_mutex_ref_;  // Guards `checkpoints_`, `head_offset_`, `append_offset_` and `pending_end_`.
+    const uint64_t index_stride_;
+    std::vector<checkpoint_t> checkpoints_;
     std::streampos head_offset_;
-    std::vector<std::chrono::microseconds> record_timestamp_;
+    std::streampos append_offset_;  // The size of the file once everything enqueued so far is written.
+    end_t pending_end_;             // The `end_` to become once everything enqueued so far is written.
 
     // Just `std::atomic<end_t> end_;` won't work in g++ until 5.1, ref.
     // http://stackoverflow.com/questions/29824570/segfault-in-stdatomic-load/29824840#29824840
     // std::atomic<end_t> end_;
-    current::atomic_that_works<end_t> end_;
+    current::atomic_that_works<end_t> end_;  // Only covers what has been written to the file.
+
+    // The group commit state. Lines are enqueued under `publish_mutex_ref_`, but written under neither of the mutexes.
+    std::mutex batch_mutex_;  // Guards the `batch_*` fields.
+    std::condition_variable batch_cv_;
+    std::vector<std::string> batch_lines_;
+    std::vector<std::string> batch_index_records_;
+    end_t batch_end_;
+    std::streampos batch_append_offset_;   // The `append_offset_` as of the last line enqueued.
+    std::streampos batch_written_offset_;  // The size of the file as of the last successful write.
+    uint64_t batch_enqueued_ = 0ull;       // The number of lines enqueued so far, the "ticket" of the last one.
+    uint64_t batch_written_ = 0ull;        // The number of lines written so far.
+    uint64_t batch_waiters_ = 0ull;        // The number of publishers in `WaitUntilWritten()`.
+    bool batch_writing_ = false;
+    // Set once a write fails. Everything enqueued by then is lost, as its indexes follow the failed lines.
+    // Cleared by `RecoverFromFailedWriteIfNeeded()`, which rolls back to the last successfully written line.
+    bool batch_failed_ = false;
+
+    // The sidecar index is advisory: it is validated at startup, so failing to append to it is not an error.
+    std::unique_ptr<AppendOnlyFile> index_appender_;
+
+    // The background `fdatasync()`-er for `FileSyncPolicy::FDataSyncPeriodically`.
+    std::atomic_bool sync_needed_;
+    std::mutex syncer_mutex_;
+    std::condition_variable syncer_cv_;
+    bool syncer_stop_ = false;
+    std::thread syncer_;
 
     FilePersisterImpl() = delete;
     FilePersisterImpl(const FilePersisterImpl&) = delete;
@@ -170,42 +441,214 @@ class FilePersister {
 
     FilePersisterImpl(std::mutex& publish_mutex_ref,
                       const ss::StreamNamespaceName& namespace_name,
-                      const std::string& filename)
+                      const std::string& filename,
+                      const FilePersisterOptions& options)
         : filename_(filename),
-          file_appender_(filename, std::ofstream::app | std::ofstream::ate),
+          options_(options),
+          file_appender_(filename),
           head_rewriter_(filename, std::ofstream::in | std::ofstream::out),
           publish_mutex_ref_(publish_mutex_ref),
-          head_offset_(0) {
+          index_stride_(std::max(options.index_stride, static_cast<uint64_t>(1u))),
+          head_offset_(0),
+          append_offset_(0),
+          sync_needed_(false) {
+      if (!file_appender_.IsOpen()) {
+        CURRENT_THROW(PersistenceFileNotWritable(filename));
+      }
       ValidateFileAndInitializeHead(namespace_name);
-      if (file_appender_.bad() || head_rewriter_.bad()) {
+      if (head_rewriter_.bad()) {
         CURRENT_THROW(PersistenceFileNotWritable(filename));
       }
+      append_offset_ = static_cast<std::streamoff>(current::FileSystem::GetFileSize(filename_));
+      index_appender_ = std::make_unique<AppendOnlyFile>(filename_ + constants::kIndexFileSuffix);
+      pending_end_ = batch_end_ = end_.load();
+      batch_append_offset_ = batch_written_offset_ = append_offset_;
+      if (options_.sync_policy == FileSyncPolicy::FDataSyncPeriodically) {
+        syncer_ = std::thread([this]() { SyncerThread(); });
+      }
+    }
+
+    ~FilePersisterImpl() {
+      if (syncer_.joinable()) {
+        {
+          std::lock_guard<std::mutex> lock(syncer_mutex_);
+          syncer_stop_ = true;
+        }
+        syncer_cv_.notify_one();
+        syncer_.join();
+      }
+    }
+
+    // Enqueue a line to be written to the file, along with the `end_` to become once it is written.
+    // Must be called under `publish_mutex_ref_`, so that the lines are enqueued in the order of their indexes.
+    // Returns the "ticket" to pass to `WaitUntilWritten()`.
+    uint64_t Enqueue(std::string&& line, const end_t& end, std::string&& index_record = "") {
+      append_offset_ += static_cast<std::streamoff>(line.length());
+      pending_end_ = end;
+      std::lock_guard<std::mutex> lock(batch_mutex_);
+      batch_lines_.push_back(std::move(line));
+      if (!index_record.empty()) {
+        batch_index_records_.push_back(std::move(index_record));
+      }
+      batch_end_ = end;
+      batch_append_offset_ = append_offset_;
+      return ++batch_enqueued_;
+    }
+
+    // Must be called under `publish_mutex_ref_` for each entry about to be enqueued, before `Enqueue()`.
+    // Returns the record to append to the sidecar index, or an empty string if this entry is not a checkpoint.
+    std::string AddCheckpointIfNeeded(uint64_t index, std::chrono::microseconds us) {
+      return AddCheckpointIfNeeded(index, us, append_offset_);
+    }
+
+    // Same as the above, for the entry at `offset`, which can be past `append_offset_` for the entries of a batch.
+    std::string AddCheckpointIfNeeded(uint64_t index, std::chrono::microseconds us, std::streampos offset) {
+      if (index % index_stride_) {
+        return "";
+      }
+      CURRENT_ASSERT(index / index_stride_ == checkpoints_.size());
+      checkpoints_.push_back({offset, us});
+      return FileIndexRecord::Make(index, static_cast<std::streamoff>(offset), us.count()).AsString();
+    }
+
+    // Return once the line with this ticket is written. The first waiter to find no write in progress becomes
+    // the leader: it writes everything enqueued so far, on behalf of all the waiters, with no mutex locked.
+    // Never locks `publish_mutex_ref_`, as the publishers that have it locked may be waiting here themselves.
+    void WaitUntilWritten(uint64_t ticket) {
+      std::unique_lock<std::mutex> lock(batch_mutex_);
+      ++batch_waiters_;
+      while (batch_written_ < ticket && !batch_failed_) {
+        if (!batch_writing_) {
+          batch_writing_ = true;
+          std::vector<std::string> lines;
+          std::vector<std::string> index_records;
+          lines.swap(batch_lines_);
+          index_records.swap(batch_index_records_);
+          const end_t end = batch_end_;
+          const std::streampos offset = batch_append_offset_;
+          const uint64_t written = batch_enqueued_;
+          lock.unlock();
+          const bool ok = file_appender_.Write(lines) && MarkWritten();
+          if (ok) {
+            end_.store(end);
+            // Only index what is already written, so that the sidecar index is never ahead of the file.
+            if (!index_records.empty() && index_appender_->IsOpen()) {
+              index_appender_->Write(index_records);
+            }
+          }
+          lock.lock();
+          batch_writing_ = false;
+          if (ok) {
+            batch_written_ = written;
+            batch_written_offset_ = offset;
+          } else {
+            batch_failed_ = true;
+          }
+          batch_cv_.notify_all();
+        } else {
+          batch_cv_.wait(lock);
+        }
+      }
+      --batch_waiters_;
+      if (batch_written_ < ticket) {
+        // Let `RecoverFromFailedWriteIfNeeded()` know once the last waiter for the lost lines is gone.
+        batch_cv_.notify_all();
+        CURRENT_THROW(PersistenceFileNotWritable(filename_));
+      }
+    }
+
+    // Must be called under `publish_mutex_ref_`, before reading `pending_end_`, by every publisher.
+    // If a write has failed, rolls the persister back to the last successfully written line: cuts the file
+    // back to it, and forgets everything enqueued past it, so that the next line takes the index of the first lost one.
+    // Waits for the publishers of the lost lines to get their exceptions first, as their tickets are reused.
+    // If the file can not even be truncated, it is left failed, and it is only safe to reopen the persister.
+    void RecoverFromFailedWriteIfNeeded() {
+      std::unique_lock<std::mutex> lock(batch_mutex_);
+      if (!batch_failed_) {
+        return;
+      }
+      batch_cv_.wait(lock, [this]() { return !batch_waiters_; });
+      if (!file_appender_.Truncate(static_cast<std::streamoff>(batch_written_offset_))) {
+        CURRENT_THROW(PersistenceFileNotWritable(filename_));
+      }
+      batch_lines_.clear();
+      batch_index_records_.clear();
+      batch_end_ = pending_end_ = end_.load();
+      batch_append_offset_ = append_offset_ = batch_written_offset_;
+      batch_written_ = batch_enqueued_;
+      batch_failed_ = false;
+      checkpoints_.resize((pending_end_.next_index + index_stride_ - 1u) / index_stride_);
+      head_offset_ = 0;
+    }
+
+    // Must be called under `publish_mutex_ref_`.
+    bool EverythingEnqueuedIsWritten() {
+      std::lock_guard<std::mutex> lock(batch_mutex_);
+      return batch_written_ == batch_enqueued_ && !batch_failed_;
+    }
+
+    // Apply the `FileSyncPolicy` to the data just written. Returns `false` if it could not be synced.
+    bool MarkWritten() {
+      if (options_.sync_policy == FileSyncPolicy::FDataSyncEveryBatch) {
+        return file_appender_.SyncData();
+      } else if (options_.sync_policy == FileSyncPolicy::FDataSyncPeriodically) {
+        sync_needed_ = true;
+      }
+      return true;
+    }
+
+    void SyncerThread() {
+      std::unique_lock<std::mutex> lock(syncer_mutex_);
+      while (!syncer_stop_) {
+        syncer_cv_.wait_for(lock, options_.sync_period);
+        if (sync_needed_.exchange(false)) {
+          file_appender_.SyncData();
+        }
+      }
     }
 
     // Replay the file but ignore its contents. Used to initialize `end_` at startup.
+    // If the sidecar index is available, the part of the file before its last checkpoint is not replayed.
     void ValidateFileAndInitializeHead(const ss::StreamNamespaceName& namespace_name) {
       std::ifstream fi(filename_);
       if (!fi.bad()) {
-        // Read through all the lines.
+        reflection::StructSchema struct_schema;
+        struct_schema.AddType<ENTRY>();
+        const auto signature = JSON(ss::StreamSignature(namespace_name, struct_schema.GetSchemaInfo()));
+
+        bool index_is_clean = true;
+        checkpoints_ = LoadCheckpointsFromIndex(fi, index_is_clean);
+        const size_t checkpoints_loaded = checkpoints_.size();
+
+        // Read through all the lines, from the last checkpoint, or from the very beginning of the file.
         // Let `IteratorOverFileOfPersistedEntries` maintain its own `next_`, which later becomes `this->end_`.
-        // While reading the file, record the offset of each record and store it in `record_offset_`.
-        IteratorOverFileOfPersistedEntries<ENTRY> cit(fi, 0, 0);
+        // While reading the file, record the offset and the timestamp of each `index_stride_`-th entry.
         const std::streampos offset_zero(0);
         auto current_offset = offset_zero;
+        uint64_t current_index = 0u;
         auto head = std::chrono::microseconds(-1);
-        reflection::StructSchema struct_schema;
-        struct_schema.AddType<ENTRY>();
-        const auto signature = JSON(ss::StreamSignature(namespace_name, struct_schema.GetSchemaInfo()));
+        if (checkpoints_.size() > 1u) {
+          ValidateSignatureLine(fi, signature);
+          current_offset = checkpoints_.back().offset;
+          current_index = (checkpoints_.size() - 1u) * index_stride_;
+          head = checkpoints_.back().us - std::chrono::microseconds(1);
+        } else {
+          checkpoints_.clear();
+        }
+        fi.clear();
+        fi.seekg(current_offset, std::ios_base::beg);
+
+        IteratorOverFileOfPersistedEntries<ENTRY> cit(fi, current_offset, current_index);
+        // NOTE: `cit` reads the file ahead, so the offsets of the lines are taken from it, not from `fi.tellg()`.
         while (cit.ProcessNextEntry(
             [&](const idxts_t& current, const char*) {
-              CURRENT_ASSERT(current.index == record_offset_.size());
-              CURRENT_ASSERT(current.index == record_timestamp_.size());
               if (!(current.us > head)) {
                 CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), current.us));
               }
-              record_offset_.push_back(current_offset);
-              record_timestamp_.push_back(current.us);
-              current_offset = fi.tellg();
+              if (!(current.index % index_stride_) && current.index / index_stride_ == checkpoints_.size()) {
+                checkpoints_.push_back({current_offset, current.us});
+              }
+              current_offset = cit.Offset();
               head = current.us;
               head_offset_ = 0;
             },
@@ -229,15 +672,9 @@ class FilePersister {
                 if (current_offset != offset_zero) {
                   CURRENT_THROW(InvalidSignatureLocation());
                 }
-                auto offset = signature_key_length;
-                while (std::isspace(value[offset])) {
-                  ++offset;
-                }
-                if (value.compare(offset, signature.length(), signature)) {
-                  CURRENT_THROW(InvalidStreamSignature(signature, value.substr(offset)));
-                }
+                ValidateSignature(value, signature);
               }
-              current_offset = fi.tellg();
+              current_offset = cit.Offset();
             })) {
           ;
         }
@@ -247,11 +684,185 @@ class FilePersister {
         end_.store({next.index, next.us - std::chrono::microseconds(1), head});
         // Append the signature if there is neither entries nor directives in the file.
         if (!current_offset) {
-          file_appender_ << constants::kSignatureDirective << ' ' << signature << std::endl;
+          if (!file_appender_.Write({std::string(constants::kSignatureDirective) + ' ' + signature + '\n'})) {
+            CURRENT_THROW(PersistenceFileNotWritable(filename_));
+          }
+          MarkWritten();
+        }
+        if (!index_is_clean || checkpoints_.size() != checkpoints_loaded) {
+          RewriteIndex();
         }
       } else {
         end_.store({0ull, std::chrono::microseconds(-1), std::chrono::microseconds(-1)});
+        checkpoints_.clear();
+        RewriteIndex();
+      }
+    }
+
+    static void ValidateSignature(const std::string& directive, const std::string& signature) {
+      auto offset = strlen(constants::kSignatureDirective);
+      while (std::isspace(directive[offset])) {
+        ++offset;
+      }
+      if (directive.compare(offset, signature.length(), signature)) {
+        CURRENT_THROW(InvalidStreamSignature(signature, directive.substr(offset)));
+      }
+    }
+
+    // The replay from a checkpoint skips the beginning of the file, so check the signature explicitly.
+    static void ValidateSignatureLine(std::ifstream& fi, const std::string& signature) {
+      fi.clear();
+      fi.seekg(0, std::ios_base::beg);
+      std::string line;
+      if (std::getline(fi, line) &&
+          !line.compare(0, strlen(constants::kSignatureDirective), constants::kSignatureDirective)) {
+        ValidateSignature(line, signature);
+      }
+    }
+
+    // Load the checkpoints from the sidecar index, dropping the trailing ones that do not match the file,
+    // which is what a crash or a replaced file may leave behind. Sets `index_is_clean` to `false` if anything
+    // has been dropped, so that the sidecar index is rewritten.
+    std::vector<checkpoint_t> LoadCheckpointsFromIndex(std::ifstream& fi, bool& index_is_clean) const {
+      std::vector<checkpoint_t> result;
+      std::string contents;
+      try {
+        contents = current::FileSystem::ReadFileAsString(filename_ + constants::kIndexFileSuffix);
+      } catch (const current::Exception&) {
+        index_is_clean = false;
+        return result;
+      }
+      const size_t records = contents.length() / sizeof(FileIndexRecord);
+      const FileIndexRecord* record = reinterpret_cast<const FileIndexRecord*>(contents.data());
+      if (!records || !record[0].IsValid() || record[0].index != constants::kIndexFileMagic ||
+          static_cast<uint64_t>(record[0].offset) != index_stride_) {
+        index_is_clean = false;
+        return result;
+      }
+      index_is_clean = (contents.length() % sizeof(FileIndexRecord) == 0u);
+      for (size_t i = 1u; i < records; ++i) {
+        const FileIndexRecord& r = record[i];
+        if (!r.IsValid() || r.index != result.size() * index_stride_ ||
+            (!result.empty() && !(r.offset > result.back().offset && r.us > result.back().us.count()))) {
+          index_is_clean = false;
+          break;
+        }
+        result.push_back({std::streampos(r.offset), std::chrono::microseconds(r.us)});
+      }
+      const int64_t file_size = static_cast<int64_t>(current::FileSystem::GetFileSize(filename_));
+      while (!result.empty() &&
+             !CheckpointMatchesFile(fi, (result.size() - 1u) * index_stride_, result.back(), file_size)) {
+        result.pop_back();
+        index_is_clean = false;
       }
+      return result;
+    }
+
+    static bool CheckpointMatchesFile(std::ifstream& fi,
+                                      uint64_t index,
+                                      const checkpoint_t& checkpoint,
+                                      int64_t file_size) {
+      const int64_t offset = static_cast<std::streamoff>(checkpoint.offset);
+      if (!(offset < file_size)) {
+        return false;
+      }
+      fi.clear();
+      if (offset) {
+        // The checkpoint must point to the beginning of a line.
+        fi.seekg(offset - 1, std::ios_base::beg);
+        if (fi.get() != '\n') {
+          return false;
+        }
+      } else {
+        fi.seekg(0, std::ios_base::beg);
+      }
+      std::string line;
+      if (!std::getline(fi, line) || line.empty() || line[0] == constants::kDirectiveMarker) {
+        return false;
+      }
+      const size_t tab_pos = line.find('\t');
+      if (tab_pos == std::string::npos) {
+        return false;
+      }
+      try {
+        const auto idxts = ss::ParseIndexAndTimestampJSON(std::string_view(line).substr(0, tab_pos));
+        return idxts.index == index && idxts.us == checkpoint.us;
+      } catch (const current::Exception&) {
+        return false;
+      }
+    }
+
+    void RewriteIndex() const {
+      std::string contents = FileIndexRecord::Make(constants::kIndexFileMagic, index_stride_, 0).AsString();
+      contents.reserve(sizeof(FileIndexRecord) * (checkpoints_.size() + 1u));
+      for (size_t i = 0u; i < checkpoints_.size(); ++i) {
+        contents += FileIndexRecord::Make(i * index_stride_,
+                                          static_cast<std::streamoff>(checkpoints_[i].offset),
+                                          checkpoints_[i].us.count()).AsString();
+      }
+      current::FileSystem::WriteStringToFile(contents, (filename_ + constants::kIndexFileSuffix).c_str());
+    }
+
+    // The entries `[begin, end)`, starting at `offset` in the file, among which the first one with a given timestamp
+    // is, if it is not `end`.
+    struct TimestampSearchBlock {
+      uint64_t begin;
+      uint64_t end;
+      std::streampos offset;
+    };
+
+    // Must be called under `publish_mutex_ref_`. Binary-searches the sparse index for the block of at most
+    // `index_stride_` entries, among the first `end` ones, where the first entry with its timestamp `>= t`,
+    // or `> t` if `strictly_greater`, is. The block is empty if this entry is the very first one.
+    TimestampSearchBlock FindTimestampBlock(std::chrono::microseconds t, bool strictly_greater, uint64_t end) const {
+      const size_t checkpoints =
+          std::min(checkpoints_.size(), static_cast<size_t>((end + index_stride_ - 1u) / index_stride_));
+      const size_t first_matching_checkpoint = static_cast<size_t>(
+          std::partition_point(checkpoints_.begin(),
+                               checkpoints_.begin() + checkpoints,
+                               [t, strictly_greater](const checkpoint_t& checkpoint) {
+                                 return !TimestampMatches(checkpoint.us, t, strictly_greater);
+                               }) -
+          checkpoints_.begin());
+      if (!first_matching_checkpoint) {
+        return TimestampSearchBlock{0u, 0u, 0};
+      }
+      // The first matching entry, if any, is after the last non-matching checkpoint, and not after the matching one.
+      const uint64_t begin = (first_matching_checkpoint - 1u) * index_stride_;
+      return TimestampSearchBlock{
+          begin, std::min(end, begin + index_stride_), checkpoints_[first_matching_checkpoint - 1u].offset};
+    }
+
+    // Returns the index of the first entry in `block` which has its timestamp `>= t`, or `> t` if `strictly_greater`,
+    // or `block.end` if there is no such entry. Reads at most `index_stride_` entries from the file, and, as the
+    // iterators do, needs no lock, as the entries of the block have already been written.
+    uint64_t FirstIndexWithTimestampInBlock(const TimestampSearchBlock& block,
+                                            std::chrono::microseconds t,
+                                            bool strictly_greater) const {
+      if (block.begin == block.end) {
+        return block.end;
+      }
+      uint64_t result = block.end;
+      std::ifstream fi(filename_);
+      IteratorOverFileOfPersistedEntries<ENTRY> cit(fi, block.offset, block.begin);
+      bool done = false;
+      while (!done && cit.ProcessNextEntry(
+                          [&](const idxts_t& current, const char*) {
+                            if (current.index >= block.end) {
+                              done = true;
+                            } else if (TimestampMatches(current.us, t, strictly_greater)) {
+                              result = current.index;
+                              done = true;
+                            }
+                          },
+                          [](const std::string&) {})) {
+        ;
+      }
+      return result;
+    }
+
+    static bool TimestampMatches(std::chrono::microseconds us, std::chrono::microseconds t, bool strictly_greater) {
+      return strictly_greater ? us > t : us >= t;
     }
   };
 
@@ -264,8 +875,9 @@ class FilePersister {
 
   FilePersister(std::mutex& publish_mutex_ref,
                 const ss::StreamNamespaceName& namespace_name,
-                const std::string& filename)
-      : file_persister_impl_(MakeOwned<FilePersisterImpl>(publish_mutex_ref, namespace_name, filename)) {}
+                const std::string& filename,
+                const FilePersisterOptions& options = FilePersisterOptions())
+      : file_persister_impl_(MakeOwned<FilePersisterImpl>(publish_mutex_ref, namespace_name, filename, options)) {}
 
   class Iterator final {
    public:
@@ -345,8 +957,8 @@ class FilePersister {
                    const std::string& filename,
                    uint64_t i,
                    std::streampos offset,
-                   uint64_t)
-        : file_persister_impl_(std::move(file_persister_impl)), i_(i), current_offset_(offset) {
+                   uint64_t index_at_offset)
+        : file_persister_impl_(std::move(file_persister_impl)), i_(i), index_at_offset_(index_at_offset) {
       if (!filename.empty()) {
         fi_ = std::make_unique<std::ifstream>(filename);
         CURRENT_ASSERT(!fi_->bad());
@@ -360,16 +972,17 @@ class FilePersister {
     // The range-based for-loop works fine. -- D.K.
     std::string operator*() const {
       if (current_entry_.empty()) {
-        const auto offset = file_persister_impl_->record_offset_[i_];
-        if (offset != current_offset_) {
-          fi_->seekg(offset, std::ios_base::beg);
-          current_offset_ = offset;
-        }
-        if (std::getline(*fi_, current_entry_)) {
-          CURRENT_ASSERT(current_entry_[0] != constants::kDirectiveMarker);
-        } else {
-          // End of file. Should never happen as long as the user only iterates over valid ranges.
-          CURRENT_THROW(current::Exception());  // LCOV_EXCL_LINE
+        // Only the checkpoints are indexed, so skip the lines, if any, between the last one read and the desired one.
+        while (true) {
+          if (!std::getline(*fi_, current_entry_)) {
+            // End of file. Should never happen as long as the user only iterates over valid ranges.
+            CURRENT_THROW(current::Exception());  // LCOV_EXCL_LINE
+          }
+          if (current_entry_[0] != constants::kDirectiveMarker) {
+            if (index_at_offset_++ == i_) {
+              break;
+            }
+          }
         }
       }
       return current_entry_;
@@ -386,34 +999,41 @@ class FilePersister {
 
    private:
     Borrowed<FilePersisterImpl> file_persister_impl_;
-    bool valid_ = true;
     std::unique_ptr<std::ifstream> fi_;
     uint64_t i_;
+    mutable uint64_t index_at_offset_;  // The index of the next entry line to be read from `fi_`.
     mutable std::string current_entry_;
-    mutable std::streampos current_offset_;
   };
 
   template <typename ITERATOR>
   class IterableRangeImpl {
    public:
+    // `begin_offset` is the offset of the entry with index `begin_offset_index`, which is at or before `begin`.
     IterableRangeImpl(Borrowed<FilePersisterImpl> file_persister_impl,
                       uint64_t begin,
                       uint64_t end,
-                      std::streampos begin_offset)
-        : file_persister_impl_(std::move(file_persister_impl)), begin_(begin), end_(end), begin_offset_(begin_offset) {}
+                      std::streampos begin_offset,
+                      uint64_t begin_offset_index)
+        : file_persister_impl_(std::move(file_persister_impl)),
+          begin_(begin),
+          end_(end),
+          begin_offset_(begin_offset),
+          begin_offset_index_(begin_offset_index) {}
 
     IterableRangeImpl(IterableRangeImpl&& rhs)
         : file_persister_impl_(std::move(rhs.file_persister_impl_)),
           begin_(rhs.begin_),
           end_(rhs.end_),
-          begin_offset_(rhs.begin_offset_) {}
+          begin_offset_(rhs.begin_offset_),
+          begin_offset_index_(rhs.begin_offset_index_) {}
 
     ITERATOR begin() const {
       // By convention, iterating over data, being an immutable operation, does not throw.
       if (begin_ == end_) {
         return ITERATOR(file_persister_impl_, "", 0, 0, 0);  // No need in accessing the file for a null iterator.
       } else {
-        return ITERATOR(file_persister_impl_, file_persister_impl_->filename_, begin_, begin_offset_, begin_);
+        return ITERATOR(
+            file_persister_impl_, file_persister_impl_->filename_, begin_, begin_offset_, begin_offset_index_);
       }
     }
     ITERATOR end() const {
@@ -433,94 +1053,213 @@ class FilePersister {
     const uint64_t begin_;
     const uint64_t end_;
     const std::streampos begin_offset_;
+    const uint64_t begin_offset_index_;
   };
 
   // `TIMESTAMP` can be `std::chrono::microseconds` or `current::time::DefaultTimeArgument`.
   template <current::locks::MutexLockStatus MLS, typename E, typename TIMESTAMP>
   idxts_t PersisterPublishImpl(E&& entry, const TIMESTAMP provided_timestamp) {
-    current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
-
-    end_t iterator = file_persister_impl_->end_.load();
-    const auto timestamp = current::time::TimestampAsMicroseconds(provided_timestamp);
-    if (!(timestamp > iterator.head)) {
+    idxts_t idxts;
+    uint64_t ticket;
+    {
+      current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
+
+      file_persister_impl_->RecoverFromFailedWriteIfNeeded();
+      end_t iterator = file_persister_impl_->pending_end_;
+      const auto timestamp = current::time::TimestampAsMicroseconds(provided_timestamp);
+      if (!(timestamp > iterator.head)) {
 #ifdef CURRENT_BUILD_WITH_PARANOIC_RUNTIME_CHECKS
-      std::cerr << "timestamp: " << timestamp.count() << ", iterator.head: " << iterator.head.count() << std::endl;
+        std::cerr << "timestamp: " << timestamp.count() << ", iterator.head: " << iterator.head.count() << std::endl;
 #endif  // CURRENT_BUILD_WITH_PARANOIC_RUNTIME_CHECKS
-      CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), timestamp));
-    }
-
-    iterator.last_entry_us = iterator.head = timestamp;
-    const auto idxts = idxts_t(iterator.next_index, iterator.last_entry_us);
-    CURRENT_ASSERT(file_persister_impl_->record_offset_.size() == iterator.next_index);
-    CURRENT_ASSERT(file_persister_impl_->record_timestamp_.size() == iterator.next_index);
-    file_persister_impl_->record_offset_.push_back(file_persister_impl_->file_appender_.tellp());
-    file_persister_impl_->record_timestamp_.push_back(timestamp);
+        CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), timestamp));
+      }
 
-    // Explicit `MakeSureTheRightTypeIsSerialized` is essential, otherwise the `Variant`'s case
-    // would be serialized in an unwrapped way when passed directly.
-    file_persister_impl_->file_appender_ << JSON(idxts) << '\t'
-                                         << JSON(MakeSureTheRightTypeIsSerialized<ENTRY, decay_t<E>>::DoIt(
-                                                std::forward<E>(entry))) << std::endl;
-    ++iterator.next_index;
-    file_persister_impl_->head_offset_ = 0;
-    file_persister_impl_->end_.store(iterator);
+      iterator.last_entry_us = iterator.head = timestamp;
+      idxts = idxts_t(iterator.next_index, iterator.last_entry_us);
+      std::string index_record = file_persister_impl_->AddCheckpointIfNeeded(iterator.next_index, timestamp);
+
+      // Explicit `MakeSureTheRightTypeIsSerialized` is essential, otherwise the `Variant`'s case
+      // would be serialized in an unwrapped way when passed directly.
+      std::string line = JSON(idxts) + '\t' +
+                         JSON(MakeSureTheRightTypeIsSerialized<ENTRY, decay_t<E>>::DoIt(std::forward<E>(entry))) +
+                         '\n';
+      ++iterator.next_index;
+      file_persister_impl_->head_offset_ = 0;
+      ticket = file_persister_impl_->Enqueue(std::move(line), iterator, std::move(index_record));
+    }
+    WaitUntilWritten<MLS>(ticket);
 
     return idxts;
   }
 
   template <current::locks::MutexLockStatus MLS>
   idxts_t PersisterPublishUnsafeImpl(const std::string& raw_log_line) {
-    current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
+    idxts_t idxts;
+    uint64_t ticket;
+    {
+      current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
+
+      file_persister_impl_->RecoverFromFailedWriteIfNeeded();
+      end_t iterator = file_persister_impl_->pending_end_;
+      const auto tab_pos = raw_log_line.find('\t');
+      if (tab_pos == std::string::npos) {
+        CURRENT_THROW(MalformedEntryException(raw_log_line));
+      }
+      idxts = ss::ParseIndexAndTimestampJSON(std::string_view(raw_log_line).substr(0, tab_pos));
+      if (idxts.index != iterator.next_index) {
+        CURRENT_THROW(UnsafePublishBadIndexTimestampException(iterator.next_index, idxts.index));
+      }
+      if (!(idxts.us > iterator.head)) {
+        CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), idxts.us));
+      }
 
-    end_t iterator = file_persister_impl_->end_.load();
-    const auto tab_pos = raw_log_line.find('\t');
-    if (tab_pos == std::string::npos) {
-      CURRENT_THROW(MalformedEntryException(raw_log_line));
+      iterator.last_entry_us = iterator.head = idxts.us;
+      std::string index_record = file_persister_impl_->AddCheckpointIfNeeded(idxts.index, idxts.us);
+
+      ++iterator.next_index;
+      file_persister_impl_->head_offset_ = 0;
+      ticket = file_persister_impl_->Enqueue(raw_log_line + '\n', iterator, std::move(index_record));
     }
-    const idxts_t idxts = ParseJSON<idxts_t>(raw_log_line.substr(0, tab_pos));
-    if (idxts.index != iterator.next_index) {
-      CURRENT_THROW(UnsafePublishBadIndexTimestampException(iterator.next_index, idxts.index));
+    WaitUntilWritten<MLS>(ticket);
+
+    return idxts;
+  }
+
+  // The lines are validated one by one, and then enqueued to be written as they are, with a single `Enqueue()`.
+  template <current::locks::MutexLockStatus MLS>
+  idxts_t PersisterPublishUnsafeImpl(const ss::RawLogLinesBatch& batch) {
+    if (!batch.Complete()) {
+      CURRENT_THROW(MalformedEntryException(std::string(batch.lines)));
     }
-    if (!(idxts.us > iterator.head)) {
-      CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), idxts.us));
+    idxts_t idxts;
+    uint64_t ticket;
+    {
+      current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
+
+      file_persister_impl_->RecoverFromFailedWriteIfNeeded();
+      end_t iterator = file_persister_impl_->pending_end_;
+      // Validate the whole batch before adding any checkpoints, so that nothing is published if any line is invalid.
+      struct entry_position_t {
+        idxts_t idxts;
+        std::streamoff offset;
+      };
+      std::vector<entry_position_t> positions;
+      std::streamoff offset = static_cast<std::streamoff>(file_persister_impl_->append_offset_);
+      batch.ForEachLineWithTab([&](std::string_view line, size_t tab_pos) {
+        if (tab_pos == std::string_view::npos) {
+          CURRENT_THROW(MalformedEntryException(std::string(line)));
+        }
+        idxts = ss::ParseIndexAndTimestampJSON(line.substr(0, tab_pos));
+        if (idxts.index != iterator.next_index) {
+          CURRENT_THROW(UnsafePublishBadIndexTimestampException(iterator.next_index, idxts.index));
+        }
+        if (!(idxts.us > iterator.head)) {
+          CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), idxts.us));
+        }
+        iterator.last_entry_us = iterator.head = idxts.us;
+        ++iterator.next_index;
+        positions.push_back({idxts, offset});
+        offset += static_cast<std::streamoff>(line.length() + 1u);
+      });
+
+      std::string index_records;
+      for (const auto& position : positions) {
+        index_records += file_persister_impl_->AddCheckpointIfNeeded(
+            position.idxts.index, position.idxts.us, std::streampos(position.offset));
+      }
+      file_persister_impl_->head_offset_ = 0;
+      ticket = file_persister_impl_->Enqueue(std::string(batch.lines), iterator, std::move(index_records));
     }
+    WaitUntilWritten<MLS>(ticket);
+
+    return idxts;
+  }
 
-    iterator.last_entry_us = iterator.head = idxts.us;
-    CURRENT_ASSERT(file_persister_impl_->record_offset_.size() == idxts.index);
-    CURRENT_ASSERT(file_persister_impl_->record_timestamp_.size() == idxts.index);
-    file_persister_impl_->record_offset_.push_back(file_persister_impl_->file_appender_.tellp());
-    file_persister_impl_->record_timestamp_.push_back(idxts.us);
+  // The entries are serialized into one buffer, which is enqueued to be written with a single `Enqueue()`.
+  template <current::locks::MutexLockStatus MLS, typename ENTRIES, typename TIMESTAMPS>
+  idxts_t PersisterPublishBatchImpl(ENTRIES&& entries, const TIMESTAMPS& timestamps) {
+    const size_t count = static_cast<size_t>(std::size(entries));
+    if (!count || count != static_cast<size_t>(std::size(timestamps))) {
+      CURRENT_THROW(InvalidPublishBatchException(count, static_cast<size_t>(std::size(timestamps))));
+    }
+    idxts_t idxts;
+    uint64_t ticket;
+    {
+      current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
+
+      file_persister_impl_->RecoverFromFailedWriteIfNeeded();
+      end_t iterator = file_persister_impl_->pending_end_;
+      // Validate and serialize the whole batch before adding any checkpoints, so that nothing is published
+      // if any of its entries is invalid.
+      struct entry_position_t {
+        idxts_t idxts;
+        std::streamoff offset;
+      };
+      std::vector<entry_position_t> positions;
+      positions.reserve(count);
+      std::string lines;
+      const std::streamoff begin_offset = static_cast<std::streamoff>(file_persister_impl_->append_offset_);
+      auto timestamp = std::begin(timestamps);
+      for (const auto& entry : entries) {
+        if (!(*timestamp > iterator.head)) {
+          CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), *timestamp));
+        }
+        iterator.last_entry_us = iterator.head = *timestamp;
+        idxts = idxts_t(iterator.next_index, *timestamp);
+        positions.push_back({idxts, begin_offset + static_cast<std::streamoff>(lines.length())});
+        lines += JSON(idxts);
+        lines += '\t';
+        lines += JSON(MakeSureTheRightTypeIsSerialized<ENTRY, decay_t<decltype(entry)>>::DoIt(entry));
+        lines += '\n';
+        ++iterator.next_index;
+        ++timestamp;
+      }
 
-    file_persister_impl_->file_appender_ << raw_log_line << std::endl;
-    ++iterator.next_index;
-    file_persister_impl_->head_offset_ = 0;
-    file_persister_impl_->end_.store(iterator);
+      std::string index_records;
+      for (const auto& position : positions) {
+        index_records += file_persister_impl_->AddCheckpointIfNeeded(
+            position.idxts.index, position.idxts.us, std::streampos(position.offset));
+      }
+      file_persister_impl_->head_offset_ = 0;
+      ticket = file_persister_impl_->Enqueue(std::move(lines), iterator, std::move(index_records));
+    }
+    WaitUntilWritten<MLS>(ticket);
 
     return idxts;
   }
 
   template <current::locks::MutexLockStatus MLS, typename TIMESTAMP>
   void PersisterUpdateHeadImpl(const TIMESTAMP provided_timestamp) {
-    current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
-
-    end_t iterator = file_persister_impl_->end_.load();
-    const auto timestamp = current::time::TimestampAsMicroseconds(provided_timestamp);
-    if (!(timestamp > iterator.head)) {
-      CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), timestamp));
-    }
-    iterator.head = timestamp;
-    const auto head_str = Printf(constants::kHeadFormatString, static_cast<long long>(timestamp.count()));
-    if (file_persister_impl_->head_offset_) {
-      auto& rewriter = file_persister_impl_->head_rewriter_;
-      rewriter.seekp(file_persister_impl_->head_offset_, std::ios_base::beg);
-      rewriter << head_str << std::endl;
-    } else {
-      auto& file_appender_ = file_persister_impl_->file_appender_;
-      file_appender_ << constants::kHeadDirective << ' ';
-      file_persister_impl_->head_offset_ = file_appender_.tellp();
-      file_appender_ << head_str << std::endl;
+    uint64_t ticket;
+    {
+      current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
+
+      file_persister_impl_->RecoverFromFailedWriteIfNeeded();
+      end_t iterator = file_persister_impl_->pending_end_;
+      const auto timestamp = current::time::TimestampAsMicroseconds(provided_timestamp);
+      if (!(timestamp > iterator.head)) {
+        CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), timestamp));
+      }
+      iterator.head = timestamp;
+      const auto head_str = Printf(constants::kHeadFormatString, static_cast<long long>(timestamp.count()));
+      // The head directive can only be rewritten in place if it is the last line of the file, and is already written.
+      // Otherwise, if it is not written yet, the fresh one is just appended after it, which is as valid.
+      if (file_persister_impl_->head_offset_ && file_persister_impl_->EverythingEnqueuedIsWritten()) {
+        auto& rewriter = file_persister_impl_->head_rewriter_;
+        rewriter.seekp(file_persister_impl_->head_offset_, std::ios_base::beg);
+        rewriter << head_str << std::endl;
+        file_persister_impl_->MarkWritten();
+        file_persister_impl_->pending_end_ = iterator;
+        file_persister_impl_->end_.store(iterator);
+        return;
+      }
+      std::string line = std::string(constants::kHeadDirective) + ' ';
+      file_persister_impl_->head_offset_ =
+          file_persister_impl_->append_offset_ + static_cast<std::streamoff>(line.length());
+      line += head_str + '\n';
+      ticket = file_persister_impl_->Enqueue(std::move(line), iterator);
     }
-    file_persister_impl_->end_.store(iterator);
+    WaitUntilWritten<MLS>(ticket);
   }
 
   template <current::locks::MutexLockStatus MLS>
@@ -561,24 +1300,29 @@ class FilePersister {
   template <current::locks::MutexLockStatus MLS>
   std::pair<uint64_t, uint64_t> PersisterIndexRangeByTimestampRangeImpl(std::chrono::microseconds from,
                                                                         std::chrono::microseconds till) const {
+    using block_t = typename FilePersisterImpl::TimestampSearchBlock;
     std::pair<uint64_t, uint64_t> result{static_cast<uint64_t>(-1), static_cast<uint64_t>(-1)};
-    current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
-    const auto begin_it =
-        std::lower_bound(file_persister_impl_->record_timestamp_.begin(),
-                         file_persister_impl_->record_timestamp_.end(),
-                         from,
-                         [](std::chrono::microseconds entry_t, std::chrono::microseconds t) { return entry_t < t; });
-    if (begin_it != file_persister_impl_->record_timestamp_.end()) {
-      result.first = std::distance(file_persister_impl_->record_timestamp_.begin(), begin_it);
+    uint64_t end;
+    block_t from_block;
+    block_t till_block;
+    {
+      // Only the sparse index is searched under the lock; the entries themselves are read from the file after it.
+      current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
+      // Only look through the entries already written, as the enqueued ones may not be iterated over yet.
+      end = file_persister_impl_->end_.load().next_index;
+      from_block = file_persister_impl_->FindTimestampBlock(from, false, end);
+      if (till.count() > 0) {
+        till_block = file_persister_impl_->FindTimestampBlock(till, true, end);
+      }
+    }
+    const uint64_t begin_index = file_persister_impl_->FirstIndexWithTimestampInBlock(from_block, from, false);
+    if (begin_index != end) {
+      result.first = begin_index;
     }
     if (till.count() > 0) {
-      const auto end_it =
-          std::upper_bound(file_persister_impl_->record_timestamp_.begin(),
-                           file_persister_impl_->record_timestamp_.end(),
-                           till,
-                           [](std::chrono::microseconds t, std::chrono::microseconds entry_t) { return t < entry_t; });
-      if (end_it != file_persister_impl_->record_timestamp_.end()) {
-        result.second = std::distance(file_persister_impl_->record_timestamp_.begin(), end_it);
+      const uint64_t end_index = file_persister_impl_->FirstIndexWithTimestampInBlock(till_block, till, true);
+      if (end_index != end) {
+        result.second = end_index;
       }
     }
     return result;
@@ -608,6 +1352,17 @@ class FilePersister {
   }
 
  private:
+  template <current::locks::MutexLockStatus MLS>
+  void WaitUntilWritten(uint64_t ticket) {
+    file_persister_impl_->WaitUntilWritten(ticket);
+    if (MLS == current::locks::MutexLockStatus::NeedToLock) {
+      // The leader has updated `end_` without `publish_mutex_ref_` locked. Lock and unlock it once, so that
+      // no subscriber, which checks `end_` and then waits with this mutex locked, could miss the notification
+      // the caller is about to send.
+      std::lock_guard<std::mutex> fence(file_persister_impl_->publish_mutex_ref_);
+    }
+  }
+
   template <current::locks::MutexLockStatus MLS, typename ITERABLE>
   ITERABLE PersisterIterateImpl(uint64_t begin_index, uint64_t end_index) const {
     // OK to only lock the mutex later, as `file_persister_impl_->end_` is an `atomic`.
@@ -619,7 +1374,8 @@ class FilePersister {
       CURRENT_THROW(InvalidIterableRangeException());
     }
     if (begin_index == end_index) {
-      return ITERABLE(file_persister_impl_, 0, 0, 0);  // OK, even for an empty persister, where 0 is an invalid index.
+      // OK, even for an empty persister, where 0 is an invalid index.
+      return ITERABLE(file_persister_impl_, 0, 0, 0, 0);
     }
     if (end_index < begin_index) {
       CURRENT_THROW(InvalidIterableRangeException());
@@ -627,10 +1383,16 @@ class FilePersister {
 
     current::locks::SmartMutexLockGuard<MLS> lock(file_persister_impl_->publish_mutex_ref_);
 
+    // Start from the checkpoint at or before `begin_index`, the iterators skip the entries up to it.
+    const size_t checkpoint = static_cast<size_t>(begin_index / file_persister_impl_->index_stride_);
     // ">" is OK, as this call is multithreading-friendly, and more entries could have been added during this call.
-    CURRENT_ASSERT(file_persister_impl_->record_offset_.size() >= current_size);
+    CURRENT_ASSERT(file_persister_impl_->checkpoints_.size() > checkpoint);
 
-    return ITERABLE(file_persister_impl_, begin_index, end_index, file_persister_impl_->record_offset_[begin_index]);
+    return ITERABLE(file_persister_impl_,
+                    begin_index,
+                    end_index,
+                    file_persister_impl_->checkpoints_[checkpoint].offset,
+                    checkpoint * file_persister_impl_->index_stride_);
   }
 
   template <current::locks::MutexLockStatus MLS, typename ITERABLE>
@@ -643,7 +1405,7 @@ class FilePersister {
     if (index_range.first != static_cast<uint64_t>(-1)) {
       return PersisterIterateImpl<MLS, ITERABLE>(index_range.first, index_range.second);
     } else {  // No entries found in the requested range.
-      return ITERABLE(file_persister_impl_, 0, 0, 0);
+      return ITERABLE(file_persister_impl_, 0, 0, 0, 0);
     }
   }
 
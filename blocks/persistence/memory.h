@@ -37,9 +37,13 @@ SOFTWARE.
 #ifndef BLOCKS_PERSISTENCE_MEMORY_H
 #define BLOCKS_PERSISTENCE_MEMORY_H
 
+#include <algorithm>
 #include <deque>
 #include <functional>
+#include <iterator>
 #include <mutex>
+#include <string_view>
+#include <vector>
 
 #include "exceptions.h"
 
@@ -174,7 +178,7 @@ class MemoryPersister {
     if (tab_pos == std::string::npos) {
       CURRENT_THROW(MalformedEntryException(raw_log_line));
     }
-    const auto idxts = ParseJSON<idxts_t>(raw_log_line.substr(0, tab_pos));
+    const auto idxts = ss::ParseIndexAndTimestampJSON(std::string_view(raw_log_line).substr(0, tab_pos));
     const auto expected_index = static_cast<uint64_t>(container_->entries_.size());
     if (idxts.index != expected_index) {
       CURRENT_THROW(UnsafePublishBadIndexTimestampException(expected_index, idxts.index));
@@ -188,6 +192,66 @@ class MemoryPersister {
     return idxts;
   }
 
+  template <current::locks::MutexLockStatus MLS>
+  idxts_t PersisterPublishUnsafeImpl(const ss::RawLogLinesBatch& batch) {
+    current::locks::SmartMutexLockGuard<MLS> lock(container_->memory_persister_container_mutex_);
+    // Parse the whole batch first, so that nothing is published if any of its lines is invalid.
+    std::vector<typename Container::entry_t> entries;
+    auto head = container_->head_;
+    uint64_t expected_index = static_cast<uint64_t>(container_->entries_.size());
+    idxts_t idxts;
+    batch.ForEachLineWithTab([&](std::string_view line, size_t tab_pos) {
+      if (tab_pos == std::string_view::npos) {
+        CURRENT_THROW(MalformedEntryException(std::string(line)));
+      }
+      idxts = ss::ParseIndexAndTimestampJSON(line.substr(0, tab_pos));
+      if (idxts.index != expected_index) {
+        CURRENT_THROW(UnsafePublishBadIndexTimestampException(expected_index, idxts.index));
+      }
+      if (!(idxts.us > head)) {
+        CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), idxts.us));
+      }
+      entries.emplace_back(idxts.us, ParseJSON<ENTRY>(std::string(line.substr(tab_pos + 1))));
+      head = idxts.us;
+      ++expected_index;
+    });
+    if (entries.empty()) {
+      CURRENT_THROW(MalformedEntryException(""));
+    }
+    std::move(entries.begin(), entries.end(), std::back_inserter(container_->entries_));
+    container_->head_ = head;
+    return idxts;
+  }
+
+  template <current::locks::MutexLockStatus MLS, typename ENTRIES, typename TIMESTAMPS>
+  idxts_t PersisterPublishBatchImpl(ENTRIES&& entries, const TIMESTAMPS& timestamps) {
+    const size_t count = static_cast<size_t>(std::size(entries));
+    if (!count || count != static_cast<size_t>(std::size(timestamps))) {
+      CURRENT_THROW(InvalidPublishBatchException(count, static_cast<size_t>(std::size(timestamps))));
+    }
+    current::locks::SmartMutexLockGuard<MLS> lock(container_->memory_persister_container_mutex_);
+    // Check all the timestamps first, so that nothing is published if any of them is out of order.
+    auto head = container_->head_;
+    for (const std::chrono::microseconds timestamp : timestamps) {
+      if (!(timestamp > head)) {
+        CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), timestamp));
+      }
+      head = timestamp;
+    }
+    const auto first_index = static_cast<uint64_t>(container_->entries_.size());
+    auto timestamp = std::begin(timestamps);
+    for (auto&& entry : entries) {
+      if constexpr (std::is_lvalue_reference_v<ENTRIES>) {
+        container_->entries_.emplace_back(*timestamp, entry);
+      } else {
+        container_->entries_.emplace_back(*timestamp, std::move(entry));
+      }
+      ++timestamp;
+    }
+    container_->head_ = head;
+    return idxts_t(first_index + count - 1u, head);
+  }
+
   template <current::locks::MutexLockStatus MLS, typename TIMESTAMP>
   void PersisterUpdateHeadImpl(const TIMESTAMP user_timestamp) {
     current::locks::SmartMutexLockGuard<MLS> lock(container_->memory_persister_container_mutex_);
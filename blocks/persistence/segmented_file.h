@@ -0,0 +1,1014 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+          (c) 2016 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// A binary, segmented, implementation of a file-based persister.
+// The entries are stored in a directory, as length-prefixed binary records in fixed-size segment files.
+// A full segment is sealed with an index footer, so that only the last, active, segment is scanned at startup.
+// Segments are `mmap`-ed, and the iterators read the records directly from the mapped memory.
+// The entries are stored in the binary format of `typesystem/serialization/binary`, as the schema is pinned by the
+// signature of the stream anyway, so that iterating over them parses no JSON. The raw log lines of `IterateUnsafe()`
+// and `PublishUnsafe()` are still JSON, for the segmented file to replicate to and from the `File` persister.
+// Iterators never outlive the persister.
+//
+// Segment file layout, all integers are native-endian:
+// * `SegmentHeader`, followed by the stream signature, padded to eight bytes.
+// * Records, each being a `SegmentRecordHeader`, with the CRC32 of the record, followed by the payload, padded to eight
+//   bytes.
+// * Zeroes, until the very end of the segment file for the active one.
+// * For the sealed segments: `SegmentIndexEntry`-s for each entry of this segment, followed by `SegmentFooter`,
+//   which occupies the very last bytes of the segment file.
+//
+// A segment is created under a temporary name and renamed once its header is written, so a crash never leaves a torn
+// header behind. The record torn by a crash, the last one in the active segment, fails its CRC, and is zeroed out,
+// along with whatever follows it, on open. An empty segment file, as an older version could leave, is removed on open.
+
+#ifndef BLOCKS_PERSISTENCE_SEGMENTED_FILE_H
+#define BLOCKS_PERSISTENCE_SEGMENTED_FILE_H
+
+#include "../../port.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exceptions.h"
+#include "file.h"
+
+#include "../ss/persister.h"
+#include "../ss/signature.h"
+
+#include "../../bricks/file/file.h"
+#include "../../bricks/strings/printf.h"
+#include "../../bricks/sync/locks.h"
+#include "../../bricks/sync/owned_borrowed.h"
+#include "../../bricks/time/chrono.h"
+#include "../../bricks/util/atomic_that_works.h"
+#include "../../bricks/util/crc32.h"
+#include "../../typesystem/schema/schema.h"
+#include "../../typesystem/serialization/binary.h"
+#include "../../typesystem/serialization/json.h"
+
+namespace current {
+namespace persistence {
+
+namespace impl {
+
+namespace segmented_file_constants {
+constexpr size_t kDefaultSegmentSize = 64 * 1024 * 1024;
+constexpr size_t kSegmentSizeGranularity = 4096;
+constexpr char kSegmentFileNameFormat[] = "segment.%08llu";
+constexpr char kSegmentTmpFileNameSuffix[] = ".tmp";
+constexpr char kSegmentHeaderMagic[8] = {'C', '5', 'T', 'S', 'E', 'G', '0', '1'};
+constexpr char kSegmentFooterMagic[8] = {'C', '5', 'T', 'I', 'D', 'X', '0', '1'};
+}  // namespace current::persistence::impl::segmented_file_constants
+
+enum class SegmentRecordKind : uint32_t { None = 0u, Entry = 1u, Head = 2u };
+
+struct SegmentHeader {
+  char magic[8];
+  uint64_t first_index;
+  uint64_t signature_length;
+};
+
+struct SegmentRecordHeader {
+  SegmentRecordKind kind;
+  uint32_t payload_length;
+  uint64_t index;
+  int64_t us;
+  uint32_t crc;  // Of the header, with zero in place of the CRC, and of the payload.
+  uint32_t reserved;
+};
+
+struct SegmentIndexEntry {
+  uint64_t offset;
+  int64_t us;
+};
+
+struct SegmentFooter {
+  uint64_t records;
+  uint64_t index_offset;
+  int64_t head_us;
+  char magic[8];
+};
+
+static_assert(sizeof(SegmentHeader) == 24, "");
+static_assert(sizeof(SegmentRecordHeader) == 32, "");
+static_assert(sizeof(SegmentIndexEntry) == 16, "");
+static_assert(sizeof(SegmentFooter) == 32, "");
+
+inline size_t SegmentAlignedSize(size_t size) { return (size + 7u) & ~static_cast<size_t>(7u); }
+
+inline size_t SegmentRecordSize(size_t payload_length) {
+  return SegmentAlignedSize(sizeof(SegmentRecordHeader) + payload_length);
+}
+
+inline uint32_t SegmentRecordCRC(const SegmentRecordHeader& header, const char* payload) {
+  SegmentRecordHeader header_without_crc = header;
+  header_without_crc.crc = 0u;
+  const uint32_t crc = CRC32(0u, reinterpret_cast<const char*>(&header_without_crc), sizeof(header_without_crc));
+  return CRC32(crc, payload, header.payload_length);
+}
+
+inline SegmentRecordHeader MakeSegmentRecordHeader(SegmentRecordKind kind,
+                                                   uint64_t index,
+                                                   std::chrono::microseconds us,
+                                                   const std::string& payload) {
+  SegmentRecordHeader header;
+  header.kind = kind;
+  header.payload_length = static_cast<uint32_t>(payload.length());
+  header.index = index;
+  header.us = us.count();
+  header.reserved = 0u;
+  header.crc = SegmentRecordCRC(header, payload.data());
+  return header;
+}
+
+// One segment file, `mmap`-ed in full. The file is never resized after it is created,
+// so the mapping stays valid, and the records written via `pwrite()` are visible through it right away.
+struct Segment final {
+  const std::string filename;
+  int fd = -1;
+  const char* data = nullptr;
+  size_t capacity = 0u;
+  uint64_t first_index = 0u;
+  size_t data_begin = 0u;
+  size_t write_offset = 0u;
+
+  // The index of the entries in this segment. Points into the footer for sealed segments,
+  // and is kept in `active_index` for the active one. Guarded by `segments_mutex_` of the persister.
+  bool sealed = false;
+  uint64_t sealed_records = 0u;
+  const SegmentIndexEntry* sealed_index = nullptr;
+  std::vector<SegmentIndexEntry> active_index;
+
+  explicit Segment(const std::string& filename) : filename(filename) {}
+  ~Segment() {
+    if (data) {
+      ::munmap(const_cast<char*>(data), capacity);
+    }
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+
+  uint64_t Records() const { return sealed ? sealed_records : static_cast<uint64_t>(active_index.size()); }
+  SegmentIndexEntry IndexEntry(uint64_t i) const { return sealed ? sealed_index[i] : active_index[i]; }
+  const SegmentRecordHeader* RecordAt(size_t offset) const {
+    return reinterpret_cast<const SegmentRecordHeader*>(data + offset);
+  }
+  static const char* Payload(const SegmentRecordHeader& record) { return reinterpret_cast<const char*>(&record + 1); }
+
+  void Map() {
+    void* mapped = ::mmap(nullptr, capacity, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+      CURRENT_THROW(PersistenceFileNotWritable(filename));  // LCOV_EXCL_LINE
+    }
+    data = reinterpret_cast<const char*>(mapped);
+  }
+
+  void WriteAt(size_t offset, const void* buffer, size_t size) {
+    const char* ptr = reinterpret_cast<const char*>(buffer);
+    while (size) {
+      const ssize_t written = ::pwrite(fd, ptr, size, static_cast<off_t>(offset));
+      if (written <= 0) {
+        CURRENT_THROW(PersistenceFileNotWritable(filename));  // LCOV_EXCL_LINE
+      }
+      ptr += written;
+      offset += static_cast<size_t>(written);
+      size -= static_cast<size_t>(written);
+    }
+  }
+
+  Segment() = delete;
+  Segment(const Segment&) = delete;
+  Segment& operator=(const Segment&) = delete;
+};
+
+// The position of the iterator within the segmented file, to not look up every next entry in the index.
+struct SegmentCursor {
+  std::shared_ptr<Segment> segment;
+  size_t offset = 0u;
+  uint64_t index = static_cast<uint64_t>(-1);
+};
+
+// The implementation of a persister based on appending binary records to segment files in a directory.
+template <typename ENTRY>
+class SegmentedFilePersister {
+ protected:
+  // { last_published_index + 1, last_published_us, current_head_us }, or { 0, -1us, -1us } for an empty persister.
+  struct end_t {
+    uint64_t next_index;
+    std::chrono::microseconds last_entry_us;
+    std::chrono::microseconds head;
+  };
+  static_assert(sizeof(std::chrono::microseconds) == 8, "");
+
+ private:
+  struct SegmentedFilePersisterImpl final {
+    const std::string directory_;
+    const size_t segment_size_;
+    const std::string signature_;
+
+    std::mutex& publish_mutex_ref_;  // Guards the writes into the active segment and `last_head_offset_`.
+
+    // Guards `segments_` and the index of the active segment, as iterators may look them up while publishing.
+    mutable std::mutex segments_mutex_;
+    std::vector<std::shared_ptr<Segment>> segments_;
+
+    // The offset of the `Head` record in the active segment, if it is the last record there, to rewrite it in place.
+    size_t last_head_offset_ = 0u;
+
+    current::atomic_that_works<end_t> end_;
+
+    SegmentedFilePersisterImpl() = delete;
+    SegmentedFilePersisterImpl(const SegmentedFilePersisterImpl&) = delete;
+    SegmentedFilePersisterImpl(SegmentedFilePersisterImpl&&) = delete;
+    SegmentedFilePersisterImpl& operator=(const SegmentedFilePersisterImpl&) = delete;
+    SegmentedFilePersisterImpl& operator=(SegmentedFilePersisterImpl&&) = delete;
+
+    SegmentedFilePersisterImpl(std::mutex& publish_mutex_ref,
+                               const ss::StreamNamespaceName& namespace_name,
+                               const std::string& directory,
+                               size_t segment_size)
+        : directory_(directory),
+          segment_size_(std::max(segment_size, segmented_file_constants::kSegmentSizeGranularity)),
+          signature_(StreamSignatureAsString(namespace_name)),
+          publish_mutex_ref_(publish_mutex_ref) {
+      FileSystem::MkDir(directory_, FileSystem::MkDirParameters::Silent);
+      OpenSegmentsAndInitializeHead();
+    }
+
+    static std::string StreamSignatureAsString(const ss::StreamNamespaceName& namespace_name) {
+      reflection::StructSchema struct_schema;
+      struct_schema.AddType<ENTRY>();
+      return JSON(ss::StreamSignature(namespace_name, struct_schema.GetSchemaInfo()));
+    }
+
+    std::string SegmentFileName(uint64_t segment_ordinal) const {
+      return FileSystem::JoinPath(
+          directory_,
+          current::strings::Printf(segmented_file_constants::kSegmentFileNameFormat,
+                                   static_cast<unsigned long long>(segment_ordinal)));
+    }
+
+    size_t SegmentDataBegin() const { return SegmentAlignedSize(sizeof(SegmentHeader) + signature_.length()); }
+
+    // Open the existing segments one by one. Only the footers of the sealed segments are read,
+    // and only the last, active, segment is scanned record by record.
+    void OpenSegmentsAndInitializeHead() {
+      end_t end{0u, std::chrono::microseconds(-1), std::chrono::microseconds(-1)};
+      while (true) {
+        const std::string filename = SegmentFileName(segments_.size());
+        ::unlink((filename + segmented_file_constants::kSegmentTmpFileNameSuffix).c_str());
+        const int fd = ::open(filename.c_str(), O_RDWR);
+        if (fd < 0) {
+          break;
+        }
+        auto segment = std::make_shared<Segment>(filename);
+        segment->fd = fd;
+        struct stat info;
+        if (::fstat(fd, &info)) {
+          CURRENT_THROW(MalformedEntryException("Malformed segment `" + filename + "`."));  // LCOV_EXCL_LINE
+        }
+        if (IsEmptySegmentFile(fd, static_cast<size_t>(info.st_size)) &&
+            ::access(SegmentFileName(segments_.size() + 1u).c_str(), F_OK)) {
+          // The last segment file has never been written to, as its creation was torn by a crash.
+          ::unlink(filename.c_str());
+          break;
+        }
+        if (!segments_.empty() && !segments_.back()->sealed) {
+          CURRENT_THROW(MalformedEntryException("Unsealed segment followed by `" + filename + "`."));
+        }
+        if (static_cast<size_t>(info.st_size) < SegmentDataBegin() + sizeof(SegmentFooter)) {
+          CURRENT_THROW(MalformedEntryException("Malformed segment `" + filename + "`."));
+        }
+        segment->capacity = static_cast<size_t>(info.st_size);
+        segment->Map();
+        ValidateSegmentHeader(*segment, end.next_index);
+        segment->first_index = end.next_index;
+        const SegmentFooter& footer =
+            *reinterpret_cast<const SegmentFooter*>(segment->data + segment->capacity - sizeof(SegmentFooter));
+        if (!std::memcmp(footer.magic, segmented_file_constants::kSegmentFooterMagic, sizeof(footer.magic))) {
+          InitializeSealedSegment(*segment, footer, end);
+        } else {
+          ScanActiveSegment(*segment, end);
+        }
+        segments_.push_back(std::move(segment));
+      }
+      if (segments_.empty()) {
+        segments_.push_back(CreateSegment(0u, 0u, 0u));
+      }
+      end_.store(end);
+    }
+
+    // Whether the segment file is empty, or has only been extended with zeroes, with no header written into it.
+    static bool IsEmptySegmentFile(int fd, size_t size) {
+      char magic[sizeof(SegmentHeader::magic)] = {};
+      if (size >= sizeof(magic) && ::pread(fd, magic, sizeof(magic), 0) != static_cast<ssize_t>(sizeof(magic))) {
+        return false;  // LCOV_EXCL_LINE
+      }
+      return std::all_of(std::begin(magic), std::end(magic), [](char c) { return !c; });
+    }
+
+    void ValidateSegmentHeader(const Segment& segment, uint64_t expected_first_index) const {
+      const SegmentHeader& header = *reinterpret_cast<const SegmentHeader*>(segment.data);
+      if (std::memcmp(header.magic, segmented_file_constants::kSegmentHeaderMagic, sizeof(header.magic))) {
+        CURRENT_THROW(MalformedEntryException("Malformed segment `" + segment.filename + "`."));
+      }
+      const std::string signature(segment.data + sizeof(SegmentHeader),
+                                  std::min(static_cast<size_t>(header.signature_length),
+                                           segment.capacity - sizeof(SegmentHeader)));
+      if (signature != signature_) {
+        CURRENT_THROW(InvalidStreamSignature(signature_, signature));
+      }
+      if (header.first_index != expected_first_index) {
+        CURRENT_THROW(ss::InconsistentIndexException(expected_first_index, header.first_index));
+      }
+    }
+
+    // Trust the index footer of the sealed segment, only confirming it fits the previous segments.
+    void InitializeSealedSegment(Segment& segment, const SegmentFooter& footer, end_t& end) const {
+      if (footer.index_offset < SegmentDataBegin() ||
+          footer.index_offset + footer.records * sizeof(SegmentIndexEntry) + sizeof(SegmentFooter) !=
+              segment.capacity) {
+        CURRENT_THROW(MalformedEntryException("Malformed index footer in `" + segment.filename + "`."));
+      }
+      segment.data_begin = SegmentDataBegin();
+      segment.write_offset = static_cast<size_t>(footer.index_offset);
+      segment.sealed = true;
+      segment.sealed_records = footer.records;
+      segment.sealed_index = reinterpret_cast<const SegmentIndexEntry*>(segment.data + footer.index_offset);
+      if (footer.records) {
+        const auto first_us = std::chrono::microseconds(segment.sealed_index[0].us);
+        const auto last_us = std::chrono::microseconds(segment.sealed_index[footer.records - 1].us);
+        if (!(first_us > end.head)) {
+          CURRENT_THROW(ss::InconsistentTimestampException(end.head + std::chrono::microseconds(1), first_us));
+        }
+        end.next_index += footer.records;
+        end.last_entry_us = end.head = last_us;
+      }
+      const auto head = std::chrono::microseconds(footer.head_us);
+      if (head < end.head) {
+        CURRENT_THROW(ss::InconsistentTimestampException(end.head, head));
+      }
+      end.head = head;
+    }
+
+    // Scan the active segment record by record, validating indexes and timestamps and building its index.
+    // The first record which is not intact, if any, is the one torn by a crash; it is truncated, along with the rest.
+    void ScanActiveSegment(Segment& segment, end_t& end) {
+      segment.data_begin = SegmentDataBegin();
+      size_t offset = segment.data_begin;
+      last_head_offset_ = 0u;
+      while (offset + sizeof(SegmentRecordHeader) <= segment.capacity) {
+        const SegmentRecordHeader& record = *segment.RecordAt(offset);
+        if (record.kind == SegmentRecordKind::None && !record.payload_length && !record.crc) {
+          break;
+        }
+        const size_t record_size = SegmentRecordSize(record.payload_length);
+        if (offset + record_size > segment.capacity - sizeof(SegmentFooter) ||
+            SegmentRecordCRC(record, Segment::Payload(record)) != record.crc) {
+          TruncateActiveSegment(segment, offset);
+          break;
+        }
+        const auto us = std::chrono::microseconds(record.us);
+        if (record.kind == SegmentRecordKind::Entry) {
+          if (record.index != end.next_index) {
+            CURRENT_THROW(ss::InconsistentIndexException(end.next_index, record.index));
+          }
+          if (!(us > end.head)) {
+            CURRENT_THROW(ss::InconsistentTimestampException(end.head + std::chrono::microseconds(1), us));
+          }
+          segment.active_index.push_back(SegmentIndexEntry{offset, record.us});
+          ++end.next_index;
+          end.last_entry_us = end.head = us;
+          last_head_offset_ = 0u;
+        } else if (record.kind == SegmentRecordKind::Head) {
+          if (!(us > end.head)) {
+            CURRENT_THROW(ss::InconsistentTimestampException(end.head + std::chrono::microseconds(1), us));
+          }
+          end.head = us;
+          last_head_offset_ = offset;
+        } else {
+          CURRENT_THROW(MalformedEntryException("Unknown record type in `" + segment.filename + "`."));
+        }
+        offset += record_size;
+      }
+      segment.write_offset = offset;
+    }
+
+    // Zeroes out the active segment from `offset` on, for the records appended from there to be all that follows.
+    // The file keeps its size, as the segment is mapped in full.
+    static void TruncateActiveSegment(Segment& segment, size_t offset) {
+      size_t end = segment.capacity;
+      while (end > offset && !segment.data[end - 1u]) {
+        --end;
+      }
+      const std::string zeroes(std::min(end - offset, static_cast<size_t>(1u << 16)), '\0');
+      while (offset < end) {
+        const size_t size = std::min(end - offset, zeroes.length());
+        segment.WriteAt(offset, zeroes.data(), size);
+        offset += size;
+      }
+    }
+
+    // The segment file gets its final name only once its header is written, not to ever be seen half-created.
+    std::shared_ptr<Segment> CreateSegment(uint64_t segment_ordinal, uint64_t first_index, size_t min_capacity) {
+      const size_t granularity = segmented_file_constants::kSegmentSizeGranularity;
+      auto segment = std::make_shared<Segment>(SegmentFileName(segment_ordinal));
+      const std::string tmp_filename = segment->filename + segmented_file_constants::kSegmentTmpFileNameSuffix;
+      segment->capacity = std::max(segment_size_, (min_capacity + granularity - 1u) / granularity * granularity);
+      segment->fd = ::open(tmp_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (segment->fd < 0 || ::ftruncate(segment->fd, static_cast<off_t>(segment->capacity))) {
+        CURRENT_THROW(PersistenceFileNotWritable(segment->filename));
+      }
+      SegmentHeader header;
+      std::memcpy(header.magic, segmented_file_constants::kSegmentHeaderMagic, sizeof(header.magic));
+      header.first_index = first_index;
+      header.signature_length = signature_.length();
+      std::string buffer(SegmentDataBegin(), '\0');
+      std::memcpy(&buffer[0], &header, sizeof(header));
+      std::memcpy(&buffer[sizeof(header)], signature_.data(), signature_.length());
+      segment->WriteAt(0u, buffer.data(), buffer.length());
+      if (::rename(tmp_filename.c_str(), segment->filename.c_str())) {
+        CURRENT_THROW(PersistenceFileNotWritable(segment->filename));  // LCOV_EXCL_LINE
+      }
+      segment->Map();
+      segment->first_index = first_index;
+      segment->data_begin = segment->write_offset = buffer.length();
+      return segment;
+    }
+
+    // Write the index of the active segment and its footer at the very end of the segment file.
+    // NOTE: Must be called from within a locked section of `segments_mutex_`.
+    void SealSegment(Segment& segment, std::chrono::microseconds head) {
+      const auto& index = segment.active_index;
+      SegmentFooter footer;
+      footer.records = index.size();
+      footer.index_offset = segment.capacity - sizeof(SegmentFooter) - index.size() * sizeof(SegmentIndexEntry);
+      footer.head_us = head.count();
+      std::memcpy(footer.magic, segmented_file_constants::kSegmentFooterMagic, sizeof(footer.magic));
+      CURRENT_ASSERT(footer.index_offset >= segment.write_offset);
+      if (!index.empty()) {
+        segment.WriteAt(footer.index_offset, index.data(), index.size() * sizeof(SegmentIndexEntry));
+      }
+      segment.WriteAt(segment.capacity - sizeof(SegmentFooter), &footer, sizeof(footer));
+      segment.sealed_records = footer.records;
+      segment.sealed_index = reinterpret_cast<const SegmentIndexEntry*>(segment.data + footer.index_offset);
+      segment.sealed = true;
+      segment.active_index.clear();
+      segment.active_index.shrink_to_fit();
+    }
+
+    // Append a record to the active segment, sealing it and starting the next one if the record does not fit.
+    // NOTE: Must be called from within a locked section of `publish_mutex_ref_`.
+    void AppendRecord(SegmentRecordKind kind,
+                      uint64_t index,
+                      std::chrono::microseconds us,
+                      const std::string& payload) {
+      const size_t record_size = SegmentRecordSize(payload.length());
+      const size_t index_growth = (kind == SegmentRecordKind::Entry) ? sizeof(SegmentIndexEntry) : 0u;
+      std::shared_ptr<Segment> segment;
+      {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        segment = segments_.back();
+        if (segment->sealed || segment->write_offset + record_size + index_growth +
+                                       segment->active_index.size() * sizeof(SegmentIndexEntry) +
+                                       sizeof(SegmentFooter) >
+                                   segment->capacity) {
+          if (!segment->sealed) {
+            SealSegment(*segment, end_.load().head);
+          }
+          segment = CreateSegment(segments_.size(),
+                                  end_.load().next_index,
+                                  SegmentDataBegin() + record_size + index_growth + sizeof(SegmentFooter));
+          segments_.push_back(segment);
+          last_head_offset_ = 0u;
+        }
+      }
+
+      std::string buffer(record_size, '\0');
+      const SegmentRecordHeader header = MakeSegmentRecordHeader(kind, index, us, payload);
+      std::memcpy(&buffer[0], &header, sizeof(header));
+      std::memcpy(&buffer[sizeof(SegmentRecordHeader)], payload.data(), payload.length());
+      const size_t offset = segment->write_offset;
+      segment->WriteAt(offset, buffer.data(), buffer.length());
+      segment->write_offset += record_size;
+
+      if (kind == SegmentRecordKind::Entry) {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        segment->active_index.push_back(SegmentIndexEntry{offset, us.count()});
+        last_head_offset_ = 0u;
+      } else {
+        last_head_offset_ = offset;
+      }
+    }
+
+    // NOTE: Must be called from within a locked section of `publish_mutex_ref_`.
+    void WriteHead(std::chrono::microseconds us) {
+      if (last_head_offset_) {
+        std::shared_ptr<Segment> segment;
+        {
+          std::lock_guard<std::mutex> lock(segments_mutex_);
+          segment = segments_.back();
+        }
+        // The whole header is rewritten, as the CRC changes along with the timestamp.
+        const SegmentRecordHeader header = MakeSegmentRecordHeader(SegmentRecordKind::Head, 0u, us, "");
+        segment->WriteAt(last_head_offset_, &header, sizeof(header));
+      } else {
+        AppendRecord(SegmentRecordKind::Head, 0u, us, "");
+      }
+    }
+
+    // Returns the segment containing the record with the given index.
+    // NOTE: Must be called from within a locked section of `segments_mutex_`.
+    const std::shared_ptr<Segment>& FindSegment(uint64_t index) const {
+      // Segments with no entries share `first_index` with the next one, and `upper_bound` skips them.
+      auto it = std::upper_bound(
+          segments_.begin(),
+          segments_.end(),
+          index,
+          [](uint64_t i, const std::shared_ptr<Segment>& segment) { return i < segment->first_index; });
+      CURRENT_ASSERT(it != segments_.begin());
+      --it;
+      if (!(index - (*it)->first_index < (*it)->Records())) {
+        // Should never happen as long as the user only iterates over valid ranges.
+        CURRENT_THROW(InvalidIterableRangeException());  // LCOV_EXCL_LINE
+      }
+      return *it;
+    }
+
+    // Returns the segment and the offset of the record with the given index.
+    SegmentCursor Locate(uint64_t index) const {
+      std::lock_guard<std::mutex> lock(segments_mutex_);
+      SegmentCursor result;
+      result.segment = FindSegment(index);
+      result.offset = static_cast<size_t>(result.segment->IndexEntry(index - result.segment->first_index).offset);
+      result.index = index;
+      return result;
+    }
+
+    // Returns the record with the given index, advancing the cursor past it.
+    // Sequential reads only touch the mapped memory, the index is only looked up on a jump or a segment boundary.
+    const SegmentRecordHeader& ReadRecord(SegmentCursor& cursor, uint64_t index) const {
+      if (cursor.segment && cursor.index == index) {
+        const Segment& segment = *cursor.segment;
+        while (cursor.offset + sizeof(SegmentRecordHeader) <= segment.capacity) {
+          const SegmentRecordHeader& record = *segment.RecordAt(cursor.offset);
+          if (record.kind == SegmentRecordKind::Head) {
+            cursor.offset += SegmentRecordSize(record.payload_length);
+          } else {
+            if (record.kind == SegmentRecordKind::Entry && record.index == index) {
+              cursor.offset += SegmentRecordSize(record.payload_length);
+              ++cursor.index;
+              return record;
+            }
+            break;
+          }
+        }
+      }
+      cursor = Locate(index);
+      const SegmentRecordHeader& record = *cursor.segment->RecordAt(cursor.offset);
+      CURRENT_ASSERT(record.kind == SegmentRecordKind::Entry);
+      CURRENT_ASSERT(record.index == index);
+      cursor.offset += SegmentRecordSize(record.payload_length);
+      ++cursor.index;
+      return record;
+    }
+
+    // Returns the number of leading entries, out of the first `size`, for which `predicate(us)` holds.
+    // The predicate must be monotonic, and the lookup is a binary search over the index of the segments.
+    template <typename PREDICATE>
+    uint64_t PartitionPointByTimestamp(uint64_t size, PREDICATE&& predicate) const {
+      std::lock_guard<std::mutex> lock(segments_mutex_);
+      uint64_t a = 0u;
+      uint64_t b = size;
+      while (a < b) {
+        const uint64_t mid = a + (b - a) / 2u;
+        const Segment& segment = *FindSegment(mid);
+        if (predicate(std::chrono::microseconds(segment.IndexEntry(mid - segment.first_index).us))) {
+          a = mid + 1u;
+        } else {
+          b = mid;
+        }
+      }
+      return a;
+    }
+  };
+
+ public:
+  SegmentedFilePersister() = delete;
+  SegmentedFilePersister(const SegmentedFilePersister&) = delete;
+  SegmentedFilePersister(SegmentedFilePersister&&) = delete;
+  SegmentedFilePersister& operator=(const SegmentedFilePersister&) = delete;
+  SegmentedFilePersister& operator=(SegmentedFilePersister&&) = delete;
+
+  SegmentedFilePersister(std::mutex& publish_mutex_ref,
+                         const ss::StreamNamespaceName& namespace_name,
+                         const std::string& directory,
+                         size_t segment_size = segmented_file_constants::kDefaultSegmentSize)
+      : impl_(MakeOwned<SegmentedFilePersisterImpl>(publish_mutex_ref, namespace_name, directory, segment_size)) {}
+
+  class Iterator final {
+   public:
+    struct Entry {
+      idxts_t idx_ts;
+      ENTRY entry;
+    };
+
+    Iterator() = delete;
+    Iterator(const Iterator&) = delete;
+    Iterator& operator=(const Iterator&) = delete;
+
+    Iterator(Iterator&&) = default;
+    Iterator& operator=(Iterator&&) = default;
+
+    Iterator(Borrowed<SegmentedFilePersisterImpl> impl, uint64_t i) : impl_(std::move(impl)), i_(i) {}
+
+    Entry operator*() const {
+      const SegmentRecordHeader& record = impl_->ReadRecord(cursor_, i_);
+      Entry result;
+      result.idx_ts = idxts_t(i_, std::chrono::microseconds(record.us));
+      LoadEntry(record, result.entry);
+      return result;
+    }
+
+    Iterator& operator++() {
+      // By convention, iterating over data, being an immutable operation, does not throw.
+      ++i_;
+      return *this;
+    }
+    bool operator==(const Iterator& rhs) const { return i_ == rhs.i_; }
+    bool operator!=(const Iterator& rhs) const { return !operator==(rhs); }
+    operator bool() const { return impl_; }
+
+   private:
+    const Borrowed<SegmentedFilePersisterImpl> impl_;
+    mutable SegmentCursor cursor_;
+    uint64_t i_;
+  };
+
+  class IteratorUnsafe final {
+   public:
+    IteratorUnsafe() = delete;
+    IteratorUnsafe(const IteratorUnsafe&) = delete;
+    IteratorUnsafe(IteratorUnsafe&&) = default;
+    IteratorUnsafe& operator=(const IteratorUnsafe&) = delete;
+    IteratorUnsafe& operator=(IteratorUnsafe&&) = default;
+
+    IteratorUnsafe(Borrowed<SegmentedFilePersisterImpl> impl, uint64_t i) : impl_(std::move(impl)), i_(i) {}
+
+    // Returns the same "raw" log line as `FilePersister` does, so that the two are interchangeable for replication.
+    std::string operator*() const {
+      const SegmentRecordHeader& record = impl_->ReadRecord(cursor_, i_);
+      ENTRY entry;
+      LoadEntry(record, entry);
+      return JSON(idxts_t(i_, std::chrono::microseconds(record.us))) + '\t' + JSON(entry);
+    }
+
+    IteratorUnsafe& operator++() {
+      ++i_;
+      return *this;
+    }
+    bool operator==(const IteratorUnsafe& rhs) const { return i_ == rhs.i_; }
+    bool operator!=(const IteratorUnsafe& rhs) const { return !operator==(rhs); }
+    operator bool() const { return impl_; }
+
+   private:
+    Borrowed<SegmentedFilePersisterImpl> impl_;
+    mutable SegmentCursor cursor_;
+    uint64_t i_;
+  };
+
+  static void LoadEntry(const SegmentRecordHeader& record, ENTRY& entry) {
+    const char* payload = Segment::Payload(record);
+    serialization::binary::LoadBinaryBody(payload, payload + record.payload_length, entry);
+  }
+
+  static std::string SaveEntry(const ENTRY& entry) {
+    std::string payload;
+    serialization::binary::AppendBinaryBody(payload, entry);
+    return payload;
+  }
+
+  // The payload of the raw log line is converted from JSON, as the entries are stored in the binary format.
+  static std::string SaveEntryFromJSON(std::string_view json) {
+    try {
+      return SaveEntry(ParseJSON<ENTRY>(std::string(json)));
+    } catch (const TypeSystemParseJSONException&) {
+      CURRENT_THROW(MalformedEntryException(std::string(json)));
+    }
+  }
+
+  template <typename ITERATOR>
+  class IterableRangeImpl {
+   public:
+    IterableRangeImpl(Borrowed<SegmentedFilePersisterImpl> impl, uint64_t begin, uint64_t end)
+        : impl_(std::move(impl)), begin_(begin), end_(end) {}
+
+    IterableRangeImpl(IterableRangeImpl&& rhs) : impl_(std::move(rhs.impl_)), begin_(rhs.begin_), end_(rhs.end_) {}
+
+    ITERATOR begin() const { return ITERATOR(impl_, begin_); }
+    ITERATOR end() const { return ITERATOR(impl_, end_); }
+    operator bool() const { return impl_; }
+
+   private:
+    const Borrowed<SegmentedFilePersisterImpl> impl_;
+    const uint64_t begin_;
+    const uint64_t end_;
+  };
+
+  // `TIMESTAMP` can be `std::chrono::microseconds` or `current::time::DefaultTimeArgument`.
+  template <current::locks::MutexLockStatus MLS, typename E, typename TIMESTAMP>
+  idxts_t PersisterPublishImpl(E&& entry, const TIMESTAMP provided_timestamp) {
+    current::locks::SmartMutexLockGuard<MLS> lock(impl_->publish_mutex_ref_);
+
+    end_t iterator = impl_->end_.load();
+    const auto timestamp = current::time::TimestampAsMicroseconds(provided_timestamp);
+    if (!(timestamp > iterator.head)) {
+      CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), timestamp));
+    }
+
+    iterator.last_entry_us = iterator.head = timestamp;
+    const auto idxts = idxts_t(iterator.next_index, iterator.last_entry_us);
+
+    // Explicit `MakeSureTheRightTypeIsSerialized` is essential, otherwise the `Variant`'s case
+    // would be serialized in an unwrapped way when passed directly.
+    impl_->AppendRecord(SegmentRecordKind::Entry,
+                        idxts.index,
+                        idxts.us,
+                        SaveEntry(MakeSureTheRightTypeIsSerialized<ENTRY, decay_t<E>>::DoIt(std::forward<E>(entry))));
+    ++iterator.next_index;
+    impl_->end_.store(iterator);
+
+    return idxts;
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  idxts_t PersisterPublishUnsafeImpl(const std::string& raw_log_line) {
+    current::locks::SmartMutexLockGuard<MLS> lock(impl_->publish_mutex_ref_);
+
+    end_t iterator = impl_->end_.load();
+    const auto tab_pos = raw_log_line.find('\t');
+    if (tab_pos == std::string::npos) {
+      CURRENT_THROW(MalformedEntryException(raw_log_line));
+    }
+    const idxts_t idxts = ss::ParseIndexAndTimestampJSON(std::string_view(raw_log_line).substr(0, tab_pos));
+    if (idxts.index != iterator.next_index) {
+      CURRENT_THROW(UnsafePublishBadIndexTimestampException(iterator.next_index, idxts.index));
+    }
+    if (!(idxts.us > iterator.head)) {
+      CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), idxts.us));
+    }
+
+    const std::string payload = SaveEntryFromJSON(std::string_view(raw_log_line).substr(tab_pos + 1));
+    iterator.last_entry_us = iterator.head = idxts.us;
+    impl_->AppendRecord(SegmentRecordKind::Entry, idxts.index, idxts.us, payload);
+    ++iterator.next_index;
+    impl_->end_.store(iterator);
+
+    return idxts;
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  idxts_t PersisterPublishUnsafeImpl(const ss::RawLogLinesBatch& batch) {
+    current::locks::SmartMutexLockGuard<MLS> lock(impl_->publish_mutex_ref_);
+
+    // Validate the whole batch first, so that nothing is published if any of its lines is invalid.
+    end_t iterator = impl_->end_.load();
+    std::vector<std::pair<idxts_t, std::string>> entries;
+    batch.ForEachLineWithTab([&](std::string_view line, size_t tab_pos) {
+      if (tab_pos == std::string_view::npos) {
+        CURRENT_THROW(MalformedEntryException(std::string(line)));
+      }
+      const idxts_t idxts = ss::ParseIndexAndTimestampJSON(line.substr(0, tab_pos));
+      if (idxts.index != iterator.next_index + entries.size()) {
+        CURRENT_THROW(UnsafePublishBadIndexTimestampException(iterator.next_index + entries.size(), idxts.index));
+      }
+      const auto head = entries.empty() ? iterator.head : entries.back().first.us;
+      if (!(idxts.us > head)) {
+        CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), idxts.us));
+      }
+      entries.emplace_back(idxts, SaveEntryFromJSON(line.substr(tab_pos + 1)));
+    });
+    if (entries.empty()) {
+      CURRENT_THROW(MalformedEntryException(""));
+    }
+
+    for (const auto& entry : entries) {
+      impl_->AppendRecord(SegmentRecordKind::Entry, entry.first.index, entry.first.us, entry.second);
+      iterator.last_entry_us = iterator.head = entry.first.us;
+      ++iterator.next_index;
+      impl_->end_.store(iterator);
+    }
+
+    return entries.back().first;
+  }
+
+  template <current::locks::MutexLockStatus MLS, typename ENTRIES, typename TIMESTAMPS>
+  idxts_t PersisterPublishBatchImpl(ENTRIES&& entries, const TIMESTAMPS& timestamps) {
+    const size_t count = static_cast<size_t>(std::size(entries));
+    if (!count || count != static_cast<size_t>(std::size(timestamps))) {
+      CURRENT_THROW(InvalidPublishBatchException(count, static_cast<size_t>(std::size(timestamps))));
+    }
+    current::locks::SmartMutexLockGuard<MLS> lock(impl_->publish_mutex_ref_);
+
+    // Validate and serialize the whole batch first, so that nothing is published if any of its entries is invalid.
+    end_t iterator = impl_->end_.load();
+    std::vector<std::pair<idxts_t, std::string>> records;
+    records.reserve(count);
+    auto timestamp = std::begin(timestamps);
+    for (const auto& entry : entries) {
+      const auto head = records.empty() ? iterator.head : records.back().first.us;
+      if (!(*timestamp > head)) {
+        CURRENT_THROW(ss::InconsistentTimestampException(head + std::chrono::microseconds(1), *timestamp));
+      }
+      records.emplace_back(
+          idxts_t(iterator.next_index + records.size(), *timestamp),
+          SaveEntry(MakeSureTheRightTypeIsSerialized<ENTRY, decay_t<decltype(entry)>>::DoIt(entry)));
+      ++timestamp;
+    }
+
+    for (auto& record : records) {
+      impl_->AppendRecord(SegmentRecordKind::Entry, record.first.index, record.first.us, std::move(record.second));
+      iterator.last_entry_us = iterator.head = record.first.us;
+      ++iterator.next_index;
+      impl_->end_.store(iterator);
+    }
+
+    return records.back().first;
+  }
+
+  template <current::locks::MutexLockStatus MLS, typename TIMESTAMP>
+  void PersisterUpdateHeadImpl(const TIMESTAMP provided_timestamp) {
+    current::locks::SmartMutexLockGuard<MLS> lock(impl_->publish_mutex_ref_);
+
+    end_t iterator = impl_->end_.load();
+    const auto timestamp = current::time::TimestampAsMicroseconds(provided_timestamp);
+    if (!(timestamp > iterator.head)) {
+      CURRENT_THROW(ss::InconsistentTimestampException(iterator.head + std::chrono::microseconds(1), timestamp));
+    }
+    iterator.head = timestamp;
+    impl_->WriteHead(timestamp);
+    impl_->end_.store(iterator);
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  bool PersisterEmptyImpl() const {
+    return !impl_->end_.load().next_index;
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  uint64_t PersisterSizeImpl() const noexcept {
+    return impl_->end_.load().next_index;
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  std::chrono::microseconds PersisterCurrentHeadImpl() const noexcept {
+    return impl_->end_.load().head;
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  idxts_t PersisterLastPublishedIndexAndTimestampImpl() const {
+    const auto iterator = impl_->end_.load();
+    if (iterator.next_index) {
+      return idxts_t(iterator.next_index - 1, iterator.last_entry_us);
+    } else {
+      CURRENT_THROW(NoEntriesPublishedYet());
+    }
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  head_optidxts_t PersisterHeadAndLastPublishedIndexAndTimestampImpl() const noexcept {
+    const auto iterator = impl_->end_.load();
+    if (iterator.next_index) {
+      return head_optidxts_t(iterator.head, iterator.next_index - 1, iterator.last_entry_us);
+    } else {
+      return head_optidxts_t(iterator.head);
+    }
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  std::pair<uint64_t, uint64_t> PersisterIndexRangeByTimestampRangeImpl(std::chrono::microseconds from,
+                                                                        std::chrono::microseconds till) const {
+    std::pair<uint64_t, uint64_t> result{static_cast<uint64_t>(-1), static_cast<uint64_t>(-1)};
+    current::locks::SmartMutexLockGuard<MLS> lock(impl_->publish_mutex_ref_);
+    const uint64_t size = impl_->end_.load().next_index;
+    const uint64_t begin =
+        impl_->PartitionPointByTimestamp(size, [from](std::chrono::microseconds t) { return t < from; });
+    if (begin != size) {
+      result.first = begin;
+    }
+    if (till.count() > 0) {
+      const uint64_t end =
+          impl_->PartitionPointByTimestamp(size, [till](std::chrono::microseconds t) { return !(till < t); });
+      if (end != size) {
+        result.second = end;
+      }
+    }
+    return result;
+  }
+
+  using IterableRange = IterableRangeImpl<Iterator>;
+  using IterableRangeUnsafe = IterableRangeImpl<IteratorUnsafe>;
+
+  template <current::locks::MutexLockStatus MLS>
+  IterableRange PersisterIterate(uint64_t begin_index, uint64_t end_index) const {
+    return PersisterIterateImpl<MLS, IterableRange>(begin_index, end_index);
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  IterableRangeUnsafe PersisterIterateUnsafe(uint64_t begin_index, uint64_t end_index) const {
+    return PersisterIterateImpl<MLS, IterableRangeUnsafe>(begin_index, end_index);
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  IterableRange PersisterIterate(std::chrono::microseconds from, std::chrono::microseconds till) const {
+    return PersisterIterateImpl<MLS, IterableRange>(from, till);
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  IterableRangeUnsafe PersisterIterateUnsafe(std::chrono::microseconds from, std::chrono::microseconds till) const {
+    return PersisterIterateImpl<MLS, IterableRangeUnsafe>(from, till);
+  }
+
+ private:
+  template <current::locks::MutexLockStatus MLS, typename ITERABLE>
+  ITERABLE PersisterIterateImpl(uint64_t begin_index, uint64_t end_index) const {
+    const uint64_t current_size = impl_->end_.load().next_index;
+    if (end_index == static_cast<uint64_t>(-1)) {
+      end_index = current_size;
+    }
+    if (end_index > current_size) {
+      CURRENT_THROW(InvalidIterableRangeException());
+    }
+    if (begin_index == end_index) {
+      return ITERABLE(impl_, 0, 0);  // OK, even for an empty persister, where 0 is an invalid index.
+    }
+    if (end_index < begin_index) {
+      CURRENT_THROW(InvalidIterableRangeException());
+    }
+    return ITERABLE(impl_, begin_index, end_index);
+  }
+
+  template <current::locks::MutexLockStatus MLS, typename ITERABLE>
+  ITERABLE PersisterIterateImpl(std::chrono::microseconds from, std::chrono::microseconds till) const {
+    if (till.count() > 0 && till < from) {
+      CURRENT_THROW(InvalidIterableRangeException());
+    }
+
+    const auto index_range = PersisterIndexRangeByTimestampRangeImpl<MLS>(from, till);
+    if (index_range.first != static_cast<uint64_t>(-1)) {
+      return PersisterIterateImpl<MLS, ITERABLE>(index_range.first, index_range.second);
+    } else {  // No entries found in the requested range.
+      return ITERABLE(impl_, 0, 0);
+    }
+  }
+
+ private:
+  Owned<SegmentedFilePersisterImpl> impl_;  // `Owned`, as iterators borrow it.
+};
+
+}  // namespace current::persistence::impl
+
+template <typename ENTRY>
+using SegmentedFile = ss::EntryPersister<impl::SegmentedFilePersister<ENTRY>, ENTRY>;
+
+}  // namespace current::persistence
+}  // namespace current
+
+#endif  // BLOCKS_PERSISTENCE_SEGMENTED_FILE_H
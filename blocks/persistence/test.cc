@@ -26,11 +26,18 @@ SOFTWARE.
 #include "../../port.h"
 
 #include <string>
+#include <vector>
+
+#ifndef CURRENT_WINDOWS
+#include <csignal>
+#include <sys/resource.h>
+#endif  // CURRENT_WINDOWS
 
 #define CURRENT_MOCK_TIME  // `SetNow()`.
 
 #include "memory.h"
 #include "file.h"
+#include "segmented_file.h"
 
 #include "../ss/ss.h"
 
@@ -703,8 +710,11 @@ TEST(PersistenceLayer, FileSafeVsUnsafeIterators) {
 
   current::FileSystem::WriteStringToFile(CombineFileContents(), persistence_file_name.c_str());
 
+  // Index every entry, so that each iterator seeks right to its entry, not reading the ones before it.
+  current::persistence::FilePersisterOptions options;
+  options.index_stride = 1u;
   std::mutex mutex;
-  IMPL impl(mutex, namespace_name, persistence_file_name);
+  IMPL impl(mutex, namespace_name, persistence_file_name, options);
 
   const auto GetUnsafeIterationResult = [&]() -> std::string {
     std::string combined_result;
@@ -907,20 +917,90 @@ TEST(PersistenceLayer, FileIteratorPerformanceTest) {
   const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
   const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
   const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+  const auto index_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name + ".idx");
+  // Index sparsely enough for the iterators to have to skip entries, and densely enough for the test to be fast.
+  current::persistence::FilePersisterOptions options;
+  options.index_stride = 16u;
   {
     // First, run the proper test.
     std::mutex mutex;
-    IMPL impl(mutex, namespace_name, persistence_file_name);
+    IMPL impl(mutex, namespace_name, persistence_file_name, options);
     IteratorPerformanceTest(impl);
   }
   {
     // Then, test file resume logic as well.
     std::mutex mutex;
-    IMPL impl(mutex, namespace_name, persistence_file_name);
+    IMPL impl(mutex, namespace_name, persistence_file_name, options);
+    IteratorPerformanceTest(impl, false);
+  }
+  {
+    // And the resume logic without the sidecar index, which is then rebuilt.
+    current::FileSystem::RmFile(persistence_file_name + ".idx");
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, options);
     IteratorPerformanceTest(impl, false);
   }
 }
 
+TEST(PersistenceLayer, FileLinesAcrossReadBlocks) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+  using IMPL = current::persistence::File<std::string>;
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+  const auto index_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name + ".idx");
+
+  // The entries of all sizes, from empty to longer than the largest block the file is read in, with the tabs in them.
+  std::vector<std::string> entries;
+  for (size_t i = 0u; i < 200u; ++i) {
+    const size_t length = (i % 50u == 49u) ? (1u << 21) + i : (i * i * 37u) % 20000u;
+    std::string entry(length, static_cast<char>('a' + i % 26u));
+    if (length > 10u) {
+      entry[length / 2u] = '\t';
+    }
+    entries.push_back(entry);
+  }
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name);
+    for (size_t i = 0u; i < entries.size(); ++i) {
+      current::time::SetNow(std::chrono::microseconds(10u * (i + 1u)));
+      impl.Publish(entries[i]);
+      if (i % 70u == 69u) {
+        current::time::SetNow(std::chrono::microseconds(10u * (i + 1u) + 5u));
+        impl.UpdateHead();
+      }
+    }
+  }
+
+  // Replay the file, with and without its sidecar index.
+  for (bool with_index : {true, false}) {
+    if (!with_index) {
+      current::FileSystem::RmFile(persistence_file_name + ".idx");
+    }
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name);
+    EXPECT_EQ(entries.size(), impl.Size());
+    EXPECT_EQ(entries.size() - 1u, impl.LastPublishedIndexAndTimestamp().index);
+    size_t i = 0u;
+    for (const auto& e : impl.Iterate()) {
+      ASSERT_EQ(i, e.idx_ts.index);
+      EXPECT_EQ(static_cast<int64_t>(10u * (i + 1u)), e.idx_ts.us.count());
+      EXPECT_TRUE(entries[i] == e.entry) << i;
+      ++i;
+    }
+    EXPECT_EQ(entries.size(), i);
+    EXPECT_EQ(entries[123], (*impl.Iterate(123u, 124u).begin()).entry);
+    current::time::SetNow(std::chrono::microseconds(10u * (entries.size() + 1u)));
+    impl.Publish("more");
+    EXPECT_EQ("more", (*impl.Iterate(entries.size(), entries.size() + 1u).begin()).entry);
+    entries.push_back("more");
+  }
+}
+
 TEST(PersistenceLayer, FileIteratorCanNotOutliveFile) {
   using namespace persistence_test;
   using IMPL = current::persistence::File<std::string>;
@@ -987,6 +1067,292 @@ TEST(PersistenceLayer, FileIteratorCanNotOutliveFile) {
   t.join();
 }
 
+TEST(PersistenceLayer, FileSyncPoliciesAndConcurrentPublishers) {
+  using namespace persistence_test;
+  using IMPL = current::persistence::File<std::string>;
+  using current::persistence::FilePersisterOptions;
+  using current::persistence::FileSyncPolicy;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+
+  const size_t kThreads = 4u;
+  const size_t kEntriesPerThread = 250u;
+
+  for (const FileSyncPolicy policy : {FileSyncPolicy::FlushOnly,
+                                      FileSyncPolicy::FDataSyncEveryBatch,
+                                      FileSyncPolicy::FDataSyncPeriodically}) {
+    const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+    {
+      std::mutex mutex;
+      IMPL impl(
+          mutex, namespace_name, persistence_file_name, FilePersisterOptions(policy, std::chrono::milliseconds(1)));
+
+      // Publish concurrently from several threads, with the timestamps assigned under the mutex, so that
+      // the entries of each thread must end up in the file in the order they were published in.
+      std::vector<std::thread> threads;
+      for (size_t t = 0u; t < kThreads; ++t) {
+        threads.emplace_back([&impl, &mutex, t]() {
+          for (size_t i = 0u; i < kEntriesPerThread; ++i) {
+            const auto idxts = [&]() {
+              std::lock_guard<std::mutex> lock(mutex);
+              return impl.template Publish<current::locks::MutexLockStatus::AlreadyLocked>(
+                  Printf("%d:%d", static_cast<int>(t), static_cast<int>(i)),
+                  std::chrono::microseconds(impl.template Size<current::locks::MutexLockStatus::AlreadyLocked>() + 1));
+            }();
+            // Once `Publish()` returns, the entry must be visible to the readers.
+            EXPECT_GT(impl.Size(), idxts.index);
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      ASSERT_EQ(kThreads * kEntriesPerThread, impl.Size());
+      current::time::ResetToZero();
+      current::time::SetNow(std::chrono::microseconds(kThreads * kEntriesPerThread + 100));
+      impl.UpdateHead();
+      EXPECT_EQ(static_cast<int64_t>(kThreads * kEntriesPerThread + 100), impl.CurrentHead().count());
+    }
+    {
+      // Replay the file and confirm the entries are all there, with the per-thread order preserved.
+      std::mutex mutex;
+      IMPL impl(mutex, namespace_name, persistence_file_name);
+      ASSERT_EQ(kThreads * kEntriesPerThread, impl.Size());
+      EXPECT_EQ(static_cast<int64_t>(kThreads * kEntriesPerThread + 100), impl.CurrentHead().count());
+      std::vector<size_t> next(kThreads, 0u);
+      uint64_t expected_index = 0u;
+      for (const auto& e : impl.Iterate()) {
+        EXPECT_EQ(expected_index, e.idx_ts.index);
+        EXPECT_EQ(static_cast<int64_t>(expected_index + 1), e.idx_ts.us.count());
+        ++expected_index;
+        const auto colon = e.entry.find(':');
+        ASSERT_NE(std::string::npos, colon);
+        const size_t t = current::FromString<size_t>(e.entry.substr(0, colon));
+        ASSERT_LT(t, kThreads);
+        EXPECT_EQ(next[t], current::FromString<size_t>(e.entry.substr(colon + 1)));
+        ++next[t];
+      }
+      EXPECT_EQ(std::vector<size_t>(kThreads, kEntriesPerThread), next);
+    }
+  }
+}
+
+TEST(PersistenceLayer, FileConcurrentPublishersNeedToLock) {
+  using namespace persistence_test;
+  using IMPL = current::persistence::File<std::string>;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+
+  const size_t kThreads = 4u;
+  const size_t kEntriesPerThread = 250u;
+
+  current::time::ResetToZero();
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name);
+    std::vector<std::thread> threads;
+    for (size_t t = 0u; t < kThreads; ++t) {
+      threads.emplace_back([&impl, t]() {
+        for (size_t i = 0u; i < kEntriesPerThread; ++i) {
+          // The timestamps are assigned by the persister itself, under the mutex.
+          impl.Publish(Printf("%d:%d", static_cast<int>(t), static_cast<int>(i)));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(kThreads * kEntriesPerThread, impl.Size());
+    std::vector<std::string> unsafe;
+    for (const auto& e : impl.IterateUnsafe()) {
+      unsafe.push_back(e);
+    }
+    ASSERT_EQ(kThreads * kEntriesPerThread, unsafe.size());
+    for (size_t i = 0u; i < unsafe.size(); ++i) {
+      EXPECT_EQ(i, current::ParseJSON<idxts_t>(unsafe[i].substr(0, unsafe[i].find('\t'))).index);
+    }
+  }
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name);
+    EXPECT_EQ(kThreads * kEntriesPerThread, impl.Size());
+  }
+}
+
+#ifndef CURRENT_WINDOWS
+TEST(PersistenceLayer, FileRecoversFromFailedWrite) {
+  using namespace persistence_test;
+  using IMPL = current::persistence::File<std::string>;
+  using us_t = std::chrono::microseconds;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+  const auto index_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name + ".idx");
+
+  current::persistence::FilePersisterOptions options;
+  options.index_stride = 2u;
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, options);
+    impl.Publish("one", us_t(100));
+    impl.Publish("two", us_t(200));
+    impl.Publish("three", us_t(300));
+
+    // Make the next write stop in the middle of the line, and fail.
+    const auto size = current::FileSystem::GetFileSize(persistence_file_name);
+    struct rlimit original_limit;
+    ASSERT_EQ(0, ::getrlimit(RLIMIT_FSIZE, &original_limit));
+    const auto original_sigxfsz_handler = ::signal(SIGXFSZ, SIG_IGN);
+    struct rlimit limit = original_limit;
+    limit.rlim_cur = static_cast<rlim_t>(size + 10u);
+    ASSERT_EQ(0, ::setrlimit(RLIMIT_FSIZE, &limit));
+    EXPECT_THROW(impl.Publish(std::string(100u, 'x'), us_t(400)), current::persistence::PersistenceFileNotWritable);
+    ASSERT_EQ(0, ::setrlimit(RLIMIT_FSIZE, &original_limit));
+    ::signal(SIGXFSZ, original_sigxfsz_handler);
+
+    // The lost entry is forgotten, and the next one takes its index.
+    EXPECT_EQ(3u, impl.Size());
+    EXPECT_EQ(3u, impl.Publish("four", us_t(400)).index);
+    EXPECT_EQ(4u, impl.Publish("five", us_t(500)).index);
+    EXPECT_EQ(5u, impl.Size());
+    std::vector<std::string> entries;
+    for (const auto& e : impl.Iterate()) {
+      entries.push_back(e.entry);
+    }
+    EXPECT_EQ("one two three four five", Join(entries, ' '));
+    EXPECT_EQ("four", (*impl.Iterate(3, 4).begin()).entry);
+  }
+  {
+    // The torn line has been cut off the file.
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, options);
+    ASSERT_EQ(5u, impl.Size());
+    std::vector<std::string> entries;
+    for (const auto& e : impl.Iterate(2, 5)) {
+      entries.push_back(e.entry);
+    }
+    EXPECT_EQ("three four five", Join(entries, ' '));
+  }
+}
+#endif  // CURRENT_WINDOWS
+
+TEST(PersistenceLayer, FileSparseIndex) {
+  using namespace persistence_test;
+  using IMPL = current::persistence::File<std::string>;
+  using us_t = std::chrono::microseconds;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+  const std::string index_file_name = persistence_file_name + ".idx";
+  const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+  const auto index_file_remover = current::FileSystem::ScopedRmFile(index_file_name);
+  current::FileSystem::RmFile(index_file_name, current::FileSystem::RmFileParameters::Silent);
+
+  current::persistence::FilePersisterOptions options;
+  options.index_stride = 8u;
+
+  const auto Verify = [&](IMPL& impl, size_t n) {
+    ASSERT_EQ(n, impl.Size());
+    for (size_t i = 0u; i < n; ++i) {
+      EXPECT_EQ(current::ToString(i), (*impl.Iterate(i, i + 1).begin()).entry);
+      EXPECT_EQ(Printf("{\"index\":%d,\"us\":%d}\t\"%d\"", int(i), int(i * 10 + 10), int(i)),
+                *impl.IterateUnsafe(i, i + 1).begin());
+      // The timestamps are `10, 20, ...`, so both the exact and the in-between ones are looked up.
+      EXPECT_EQ(i, (*impl.Iterate(us_t(i * 10 + 10), us_t(i * 10 + 10)).begin()).idx_ts.index);
+      EXPECT_EQ(i, (*impl.Iterate(us_t(i * 10 + 1), us_t(i * 10 + 15)).begin()).idx_ts.index);
+    }
+    size_t entries_past_the_end = 0u;
+    for (const auto& e : impl.IterateUnsafe(us_t(n * 10 + 1), us_t(0))) {
+      static_cast<void>(e);
+      ++entries_past_the_end;
+    }
+    EXPECT_EQ(0u, entries_past_the_end);
+  };
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, options);
+    for (size_t i = 0u; i < 100u; ++i) {
+      impl.Publish(current::ToString(i), us_t(i * 10 + 10));
+    }
+    Verify(impl, 100u);
+  }
+  // The header and a record for each of the entries 0, 8, ..., 96.
+  EXPECT_EQ(32u * (1u + 13u), current::FileSystem::GetFileSize(index_file_name));
+
+  {
+    // Resume from the sidecar index.
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, options);
+    Verify(impl, 100u);
+    impl.Publish("100", us_t(1010));
+    Verify(impl, 101u);
+  }
+  EXPECT_EQ(32u * (1u + 13u), current::FileSystem::GetFileSize(index_file_name));
+
+  {
+    // Only the tail past the last checkpoint is replayed, so a corrupted entry before it goes unnoticed.
+    std::string contents = current::FileSystem::ReadFileAsString(persistence_file_name);
+    const auto pos = contents.find("{\"index\":50,");
+    ASSERT_NE(std::string::npos, pos);
+    contents[pos + 9] = '7';  // `{"index":50,` -> `{"index":70,`.
+    current::FileSystem::WriteStringToFile(contents, persistence_file_name.c_str());
+    {
+      std::mutex mutex;
+      IMPL impl(mutex, namespace_name, persistence_file_name, options);
+      EXPECT_EQ(101u, impl.Size());
+    }
+    // Without the sidecar index, the whole file is replayed.
+    current::FileSystem::RmFile(index_file_name);
+    {
+      std::mutex mutex;
+      ASSERT_THROW(IMPL(mutex, namespace_name, persistence_file_name, options),
+                   current::ss::InconsistentIndexException);
+    }
+    contents[pos + 9] = '5';
+    current::FileSystem::WriteStringToFile(contents, persistence_file_name.c_str());
+  }
+
+  {
+    // Rebuild the missing sidecar index.
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, options);
+    Verify(impl, 101u);
+  }
+  EXPECT_EQ(32u * (1u + 13u), current::FileSystem::GetFileSize(index_file_name));
+
+  {
+    // A sidecar index ahead of the file, as if the tail of the file was lost in a crash, is fixed up.
+    std::string contents = current::FileSystem::ReadFileAsString(persistence_file_name);
+    const auto pos = contents.find("{\"index\":90,");
+    ASSERT_NE(std::string::npos, pos);
+    current::FileSystem::WriteStringToFile(contents.substr(0, pos), persistence_file_name.c_str());
+    // And a half-written record at the end of the sidecar index is ignored.
+    current::FileSystem::WriteStringToFile("garbage", index_file_name.c_str(), true);
+    {
+      std::mutex mutex;
+      IMPL impl(mutex, namespace_name, persistence_file_name, options);
+      Verify(impl, 90u);
+    }
+    // The checkpoints for the entries 0, 8, ..., 88.
+    EXPECT_EQ(32u * (1u + 12u), current::FileSystem::GetFileSize(index_file_name));
+  }
+
+  {
+    // A different stride rebuilds the sidecar index.
+    options.index_stride = 4u;
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_file_name, options);
+    Verify(impl, 90u);
+  }
+  EXPECT_EQ(32u * (1u + 23u), current::FileSystem::GetFileSize(index_file_name));
+}
+
 TEST(PersistenceLayer, Exceptions) {
   using namespace persistence_test;
   using IMPL = current::persistence::File<StorableString>;
@@ -1026,3 +1392,451 @@ TEST(PersistenceLayer, Exceptions) {
     EXPECT_THROW(IMPL impl(mutex, namespace_name, persistence_file_name), InconsistentTimestampException);
   }
 }
+
+TEST(PersistenceLayer, SegmentedFile) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  using IMPL = current::persistence::SegmentedFile<StorableString>;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_dir_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segments");
+  const auto dir_remover = current::FileSystem::ScopedRmDir(persistence_dir_name);
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name);
+    EXPECT_EQ(0u, impl.Size());
+    current::time::SetNow(std::chrono::microseconds(100));
+    impl.Publish(StorableString("foo"));
+    current::time::SetNow(std::chrono::microseconds(200));
+    impl.Publish(StorableString("bar"));
+    EXPECT_EQ(2u, impl.Size());
+    current::time::SetNow(std::chrono::microseconds(300));
+    impl.UpdateHead();
+    current::time::SetNow(std::chrono::microseconds(400));
+    impl.UpdateHead();
+    EXPECT_EQ(400, impl.CurrentHead().count());
+    current::time::SetNow(std::chrono::microseconds(500));
+    impl.Publish(StorableString("meh"));
+    current::time::SetNow(std::chrono::microseconds(600));
+    impl.UpdateHead();
+
+    std::vector<std::string> all_three;
+    for (const auto& e : impl.Iterate()) {
+      all_three.push_back(Printf(
+          "%s %d %d", e.entry.s.c_str(), static_cast<int>(e.idx_ts.index), static_cast<int>(e.idx_ts.us.count())));
+    }
+    EXPECT_EQ("foo 0 100,bar 1 200,meh 2 500", Join(all_three, ","));
+    std::vector<std::string> all_three_unsafe;
+    for (const auto& e : impl.IterateUnsafe()) {
+      all_three_unsafe.push_back(e);
+    }
+    EXPECT_EQ(
+        "{\"index\":0,\"us\":100}\t{\"s\":\"foo\"},"
+        "{\"index\":1,\"us\":200}\t{\"s\":\"bar\"},"
+        "{\"index\":2,\"us\":500}\t{\"s\":\"meh\"}",
+        Join(all_three_unsafe, ","));
+  }
+
+  {
+    // Confirm the data has been saved and can be replayed, including the head.
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name);
+    EXPECT_EQ(3u, impl.Size());
+    EXPECT_EQ(600, impl.CurrentHead().count());
+    EXPECT_EQ(500, impl.LastPublishedIndexAndTimestamp().us.count());
+
+    current::time::SetNow(std::chrono::microseconds(999));
+    // The same raw log line format as with `File`, as used by the stream replicator.
+    using current::locks::MutexLockStatus;
+    impl.template PersisterPublishUnsafeImpl<MutexLockStatus::NeedToLock>("{\"index\":3,\"us\":999}\t{\"s\":\"blah\"}");
+    EXPECT_EQ(4u, impl.Size());
+    ASSERT_THROW(impl.template PersisterPublishUnsafeImpl<MutexLockStatus::NeedToLock>(
+                     "{\"index\":3,\"us\":1000}\t{\"s\":\"blah\"}"),
+                 current::persistence::UnsafePublishBadIndexTimestampException);
+
+    std::vector<std::string> all_four;
+    for (const auto& e : impl.Iterate(1)) {
+      all_four.push_back(e.entry.s);
+    }
+    EXPECT_EQ("bar,meh,blah", Join(all_four, ","));
+  }
+
+  {
+    // Wrong signature.
+    std::mutex mutex;
+    const auto another_namespace = current::ss::StreamNamespaceName("namespace_invalid", "top_level_invalid");
+    ASSERT_THROW(IMPL(mutex, another_namespace, persistence_dir_name), current::persistence::InvalidStreamSignature);
+    using INVALID_IMPL = current::persistence::SegmentedFile<std::string>;
+    ASSERT_THROW(INVALID_IMPL(mutex, namespace_name, persistence_dir_name),
+                 current::persistence::InvalidStreamSignature);
+  }
+}
+
+namespace persistence_test {
+
+// Publishes a batch of raw log lines, then makes sure a batch with any invalid line publishes nothing.
+template <typename IMPL>
+void RunPublishUnsafeBatchTest(IMPL& impl) {
+  using current::ss::RawLogLinesBatch;
+
+  current::time::SetNow(std::chrono::microseconds(100));
+  impl.Publish(StorableString("foo"));
+
+  const std::string batch =
+      "{\"index\":1,\"us\":200}\t{\"s\":\"bar\"}\n"
+      "{\"index\":2,\"us\":300}\t{\"s\":\"baz\"}\n";
+  const auto last = impl.PublishUnsafe(RawLogLinesBatch(batch));
+  EXPECT_EQ(2u, last.index);
+  EXPECT_EQ(300, last.us.count());
+  EXPECT_EQ(3u, impl.Size());
+  EXPECT_EQ(300, impl.CurrentHead().count());
+
+  const std::string ok = "{\"index\":3,\"us\":400}\t{\"s\":\"ok\"}\n";
+  ASSERT_THROW(impl.PublishUnsafe(RawLogLinesBatch(ok + "{\"index\":5,\"us\":500}\t{\"s\":\"no\"}\n")),
+               current::persistence::UnsafePublishBadIndexTimestampException);
+  ASSERT_THROW(impl.PublishUnsafe(RawLogLinesBatch(ok + "{\"index\":4,\"us\":400}\t{\"s\":\"no\"}\n")),
+               current::ss::InconsistentTimestampException);
+  ASSERT_THROW(impl.PublishUnsafe(RawLogLinesBatch(ok + "{\"index\":4,\"us\":500}\n")),
+               current::persistence::MalformedEntryException);
+  EXPECT_EQ(3u, impl.Size());
+  EXPECT_EQ(300, impl.CurrentHead().count());
+
+  impl.PublishUnsafe(RawLogLinesBatch(ok));
+  std::vector<std::string> all;
+  for (const auto& e : impl.Iterate()) {
+    all.push_back(Printf("%s %d", e.entry.s.c_str(), static_cast<int>(e.idx_ts.us.count())));
+  }
+  EXPECT_EQ("foo 100,bar 200,baz 300,ok 400", Join(all, ","));
+}
+
+}  // namespace persistence_test
+
+TEST(PersistenceLayer, PublishUnsafeBatch) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+
+  {
+    std::mutex mutex;
+    current::persistence::Memory<StorableString> impl(mutex, namespace_name);
+    RunPublishUnsafeBatchTest(impl);
+  }
+
+  {
+    const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+    const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+    {
+      std::mutex mutex;
+      current::persistence::File<StorableString> impl(mutex, namespace_name, persistence_file_name);
+      RunPublishUnsafeBatchTest(impl);
+    }
+    {
+      // The batch is written as is, and is replayed.
+      std::mutex mutex;
+      current::persistence::File<StorableString> impl(mutex, namespace_name, persistence_file_name);
+      EXPECT_EQ(4u, impl.Size());
+      EXPECT_EQ(400, impl.LastPublishedIndexAndTimestamp().us.count());
+    }
+  }
+
+  {
+    const std::string persistence_dir_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segments");
+    const auto dir_remover = current::FileSystem::ScopedRmDir(persistence_dir_name);
+    std::mutex mutex;
+    current::persistence::SegmentedFile<StorableString> impl(mutex, namespace_name, persistence_dir_name);
+    RunPublishUnsafeBatchTest(impl);
+  }
+}
+
+namespace persistence_test {
+
+// Publishes a batch of entries, then makes sure an invalid batch publishes nothing.
+template <typename IMPL>
+void RunPublishBatchTest(IMPL& impl) {
+  using us_t = std::chrono::microseconds;
+
+  impl.Publish(StorableString("foo"), us_t(100));
+
+  const std::vector<StorableString> entries({StorableString("bar"), StorableString("baz")});
+  const auto last = impl.PublishBatch(entries, std::vector<us_t>({us_t(200), us_t(300)}));
+  EXPECT_EQ(2u, last.index);
+  EXPECT_EQ(300, last.us.count());
+  EXPECT_EQ(3u, impl.Size());
+  EXPECT_EQ(300, impl.CurrentHead().count());
+
+  ASSERT_THROW(impl.PublishBatch(entries, std::vector<us_t>({us_t(400), us_t(400)})),
+               current::ss::InconsistentTimestampException);
+  ASSERT_THROW(impl.PublishBatch(entries, std::vector<us_t>({us_t(300), us_t(400)})),
+               current::ss::InconsistentTimestampException);
+  ASSERT_THROW(impl.PublishBatch(entries, std::vector<us_t>({us_t(400)})),
+               current::persistence::InvalidPublishBatchException);
+  ASSERT_THROW(impl.PublishBatch(std::vector<StorableString>(), std::vector<us_t>()),
+               current::persistence::InvalidPublishBatchException);
+  EXPECT_EQ(3u, impl.Size());
+  EXPECT_EQ(300, impl.CurrentHead().count());
+
+  impl.PublishBatch(std::vector<StorableString>({StorableString("meh")}), std::vector<us_t>({us_t(400)}));
+  std::vector<std::string> all;
+  for (const auto& e : impl.Iterate()) {
+    all.push_back(Printf("%s %d %d",
+                         e.entry.s.c_str(),
+                         static_cast<int>(e.idx_ts.index),
+                         static_cast<int>(e.idx_ts.us.count())));
+  }
+  EXPECT_EQ("foo 0 100,bar 1 200,baz 2 300,meh 3 400", Join(all, ","));
+}
+
+}  // namespace persistence_test
+
+TEST(PersistenceLayer, PublishBatch) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+
+  {
+    std::mutex mutex;
+    current::persistence::Memory<StorableString> impl(mutex, namespace_name);
+    RunPublishBatchTest(impl);
+  }
+
+  {
+    const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "data");
+    const auto file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+    {
+      std::mutex mutex;
+      current::persistence::File<StorableString> impl(mutex, namespace_name, persistence_file_name);
+      RunPublishBatchTest(impl);
+    }
+    {
+      // The batch is written as the individual entries would have been.
+      std::mutex mutex;
+      current::persistence::File<StorableString> impl(mutex, namespace_name, persistence_file_name);
+      EXPECT_EQ(4u, impl.Size());
+      std::vector<std::string> all;
+      for (const auto& e : impl.IterateUnsafe(1, 3)) {
+        all.push_back(e);
+      }
+      EXPECT_EQ(
+          "{\"index\":1,\"us\":200}\t{\"s\":\"bar\"}\n"
+          "{\"index\":2,\"us\":300}\t{\"s\":\"baz\"}",
+          Join(all, "\n"));
+    }
+  }
+
+  {
+    const std::string persistence_dir_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segments");
+    const auto dir_remover = current::FileSystem::ScopedRmDir(persistence_dir_name);
+    std::mutex mutex;
+    current::persistence::SegmentedFile<StorableString> impl(mutex, namespace_name, persistence_dir_name);
+    RunPublishBatchTest(impl);
+  }
+}
+
+TEST(PersistenceLayer, SegmentedFileManySegments) {
+  current::time::ResetToZero();
+
+  using namespace persistence_test;
+
+  using IMPL = current::persistence::SegmentedFile<StorableString>;
+  using us_t = std::chrono::microseconds;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_dir_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segments");
+  const auto dir_remover = current::FileSystem::ScopedRmDir(persistence_dir_name);
+
+  const size_t segment_size = 4096;
+  const int N = 1000;
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name, segment_size);
+    for (int i = 0; i < N; ++i) {
+      impl.Publish(LargeTestStorableString(i), us_t((i + 1) * 10));
+      if (i % 100 == 50) {
+        impl.UpdateHead(us_t((i + 1) * 10 + 5));
+      }
+    }
+    // A record larger than the segment size gets a segment of its own.
+    impl.Publish(StorableString(std::string(10000, 'x')), us_t((N + 1) * 10));
+    impl.UpdateHead(us_t((N + 1) * 10 + 5));
+  }
+
+  size_t segments = 0u;
+  current::FileSystem::ScanDir(persistence_dir_name,
+                               [&segments](const current::FileSystem::ScanDirItemInfo&) { ++segments; });
+  EXPECT_LT(10u, segments);
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name, segment_size);
+    EXPECT_EQ(static_cast<uint64_t>(N + 1), impl.Size());
+    EXPECT_EQ((N + 1) * 10 + 5, impl.CurrentHead().count());
+
+    int i = 0;
+    for (const auto& e : impl.Iterate()) {
+      ASSERT_EQ(static_cast<uint64_t>(i), e.idx_ts.index);
+      ASSERT_EQ((i + 1) * 10, e.idx_ts.us.count());
+      if (i < N) {
+        ASSERT_EQ(LargeTestStorableString(i).s, e.entry.s);
+      } else {
+        ASSERT_EQ(10000u, e.entry.s.length());
+      }
+      ++i;
+    }
+    EXPECT_EQ(N + 1, i);
+
+    EXPECT_EQ(JSON(current::ss::IndexAndTimestamp(500, us_t(5010))) + '\t' + JSON(LargeTestStorableString(500)),
+              *impl.IterateUnsafe(500, 501).begin());
+
+    EXPECT_EQ(123u, impl.IndexRangeByTimestampRange(us_t(1231)).first);
+    EXPECT_EQ(123u, impl.IndexRangeByTimestampRange(us_t(1240)).first);
+    EXPECT_EQ(static_cast<uint64_t>(-1), impl.IndexRangeByTimestampRange(us_t(100000)).first);
+    EXPECT_EQ(std::make_pair(uint64_t(100), uint64_t(200)), impl.IndexRangeByTimestampRange(us_t(1010), us_t(2009)));
+    EXPECT_EQ(std::make_pair(uint64_t(100), uint64_t(200)), impl.IndexRangeByTimestampRange(us_t(1001), us_t(2000)));
+    EXPECT_EQ("0000777 xxx", (*impl.Iterate(us_t(7771)).begin()).entry.s);
+
+    impl.Publish(StorableString("more"), us_t(1000000));
+    EXPECT_EQ("more", (*impl.Iterate(N + 1).begin()).entry.s);
+  }
+}
+
+TEST(PersistenceLayer, SegmentedFileIteratorPerformanceTest) {
+  using namespace persistence_test;
+  using IMPL = current::persistence::SegmentedFile<StorableString>;
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_dir_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segments");
+  const auto dir_remover = current::FileSystem::ScopedRmDir(persistence_dir_name);
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name, 16384);
+    IteratorPerformanceTest(impl);
+  }
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name, 16384);
+    IteratorPerformanceTest(impl, false);
+  }
+}
+
+TEST(PersistenceLayer, SegmentedFileExceptions) {
+  using namespace persistence_test;
+  using IMPL = current::persistence::SegmentedFile<std::string>;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_dir_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segments");
+  const auto dir_remover = current::FileSystem::ScopedRmDir(persistence_dir_name);
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name);
+    ASSERT_THROW(impl.LastPublishedIndexAndTimestamp(), current::persistence::NoEntriesPublishedYet);
+    impl.Publish("2", std::chrono::microseconds(2));
+    ASSERT_THROW(impl.Publish("1", std::chrono::microseconds(1)), current::ss::InconsistentTimestampException);
+    ASSERT_THROW(impl.Publish("2", std::chrono::microseconds(2)), current::ss::InconsistentTimestampException);
+    impl.UpdateHead(std::chrono::microseconds(4));
+    ASSERT_THROW(impl.UpdateHead(std::chrono::microseconds(3)), current::ss::InconsistentTimestampException);
+    ASSERT_THROW(impl.Publish("3", std::chrono::microseconds(3)), current::ss::InconsistentTimestampException);
+    ASSERT_THROW(impl.Iterate(1, 0), current::persistence::InvalidIterableRangeException);
+    ASSERT_THROW(impl.Iterate(100, 101), current::persistence::InvalidIterableRangeException);
+  }
+
+  {
+    // Not a segment file.
+    const std::string segment_file_name = current::FileSystem::JoinPath(persistence_dir_name, "segment.00000000");
+    current::FileSystem::WriteStringToFile(std::string(8192, 'x'), segment_file_name.c_str());
+    std::mutex mutex;
+    ASSERT_THROW(IMPL(mutex, namespace_name, persistence_dir_name), current::persistence::MalformedEntryException);
+  }
+}
+
+TEST(PersistenceLayer, SegmentedFileRecoversFromTornTail) {
+  using namespace persistence_test;
+  using IMPL = current::persistence::SegmentedFile<StorableString>;
+  using us_t = std::chrono::microseconds;
+
+  const auto namespace_name = current::ss::StreamNamespaceName("namespace", "entry_name");
+  const std::string persistence_dir_name = current::FileSystem::JoinPath(FLAGS_persistence_test_tmpdir, "segments");
+  const auto dir_remover = current::FileSystem::ScopedRmDir(persistence_dir_name);
+  const std::string segment_file_name = current::FileSystem::JoinPath(persistence_dir_name, "segment.00000000");
+  const size_t segment_size = 4096;
+
+  const auto entries = [&]() {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name, segment_size);
+    std::vector<std::string> result;
+    for (const auto& e : impl.Iterate()) {
+      result.push_back(e.entry.s);
+    }
+    return Join(result, ",");
+  };
+  // The segment is not sealed, so its records are followed by zeroes only.
+  const auto records_end = [&](const std::string& data) {
+    size_t end = data.length();
+    while (end && !data[end - 1u]) {
+      --end;
+    }
+    return end;
+  };
+
+  {
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name, segment_size);
+    impl.Publish(StorableString("foo"), us_t(1));
+    impl.Publish(StorableString("bar"), us_t(2));
+    impl.Publish(StorableString("meh"), us_t(3));
+  }
+
+  {
+    // A record torn in the middle of being written, following the intact ones, is truncated.
+    std::string data = current::FileSystem::ReadFileAsString(segment_file_name);
+    const size_t intact_end = records_end(data);
+    const size_t torn_begin = (intact_end + 7u) & ~static_cast<size_t>(7u);
+    std::fill(data.begin() + torn_begin, data.begin() + torn_begin + 40u, 'x');
+    current::FileSystem::WriteStringToFile(data, segment_file_name.c_str());
+    EXPECT_EQ("foo,bar,meh", entries());
+    EXPECT_EQ(intact_end, records_end(current::FileSystem::ReadFileAsString(segment_file_name)));
+    std::mutex mutex;
+    IMPL impl(mutex, namespace_name, persistence_dir_name, segment_size);
+    impl.Publish(StorableString("blah"), us_t(4));
+  }
+  EXPECT_EQ("foo,bar,meh,blah", entries());
+
+  {
+    // The last record fails its CRC if any of its bytes has not made it to disk.
+    std::string data = current::FileSystem::ReadFileAsString(segment_file_name);
+    data[records_end(data) - 1u] = '\0';
+    current::FileSystem::WriteStringToFile(data, segment_file_name.c_str());
+    EXPECT_EQ("foo,bar,meh", entries());
+  }
+
+  {
+    // The segment file which has never been written to is removed, and is created anew once needed.
+    const auto segments = [&]() {
+      size_t result = 0u;
+      current::FileSystem::ScanDir(persistence_dir_name,
+                                   [&result](const current::FileSystem::ScanDirItemInfo&) { ++result; });
+      return result;
+    };
+    const std::string next_segment_file_name =
+        current::FileSystem::JoinPath(persistence_dir_name, "segment.00000001");
+    current::FileSystem::WriteStringToFile("", next_segment_file_name.c_str());
+    EXPECT_EQ("foo,bar,meh", entries());
+    EXPECT_EQ(1u, segments());
+    current::FileSystem::WriteStringToFile(std::string(segment_size, '\0'), next_segment_file_name.c_str());
+    {
+      std::mutex mutex;
+      IMPL impl(mutex, namespace_name, persistence_dir_name, segment_size);
+      EXPECT_EQ(3u, impl.Size());
+      impl.Publish(StorableString(std::string(segment_size, 'x')), us_t(5));
+    }
+    EXPECT_EQ(2u, segments());
+    EXPECT_EQ("foo,bar,meh," + std::string(segment_size, 'x'), entries());
+  }
+}
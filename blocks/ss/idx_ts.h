@@ -33,11 +33,14 @@ SOFTWARE.
 #endif  // CURRENT_BUILD_WITH_PARANOIC_RUNTIME_CHECKS
 
 #include <chrono>
+#include <cstring>
+#include <string_view>
 
 #include "exceptions.h"
 
 #include "../../typesystem/optional.h"
 #include "../../typesystem/struct.h"
+#include "../../typesystem/serialization/json.h"
 
 namespace current {
 namespace ss {
@@ -99,6 +102,53 @@ CURRENT_STRUCT(HeadAndOptionalIndexAndTimestamp) {
   }
 };
 
+namespace impl {
+
+// Parses from one to 18 decimal digits, with no leading zeros, which thus fit `int64_t`, advancing `p` past them.
+inline bool ParseIndexAndTimestampDigits(const char*& p, const char* end, uint64_t& result) {
+  const char* begin = p;
+  result = 0u;
+  while (p != end && *p >= '0' && *p <= '9') {
+    result = result * 10u + static_cast<uint64_t>(*p - '0');
+    ++p;
+  }
+  const size_t digits = static_cast<size_t>(p - begin);
+  return digits && digits <= 18u && !(digits > 1u && *begin == '0');
+}
+
+inline bool ParseIndexAndTimestampLiteral(const char*& p, const char* end, const char* literal, size_t length) {
+  if (static_cast<size_t>(end - p) >= length && !std::memcmp(p, literal, length)) {
+    p += length;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+}  // namespace current::ss::impl
+
+// Parses the `{"index":...,"us":...}` prefix of the line of a stream, as replaying the stream does for each line.
+// The exact form `JSON()` outputs is decoded in place; anything else, such as whitespace, other order of the fields,
+// or very large numbers, is left to `ParseJSON()`, which throws on what is not a valid `IndexAndTimestamp`.
+inline IndexAndTimestamp ParseIndexAndTimestampJSON(std::string_view json) {
+  static constexpr char kIndex[] = "{\"index\":";
+  static constexpr char kUs[] = ",\"us\":";
+  const char* p = json.data();
+  const char* end = p + json.length();
+  uint64_t index;
+  uint64_t us;
+  if (impl::ParseIndexAndTimestampLiteral(p, end, kIndex, sizeof(kIndex) - 1u) &&
+      impl::ParseIndexAndTimestampDigits(p, end, index) &&
+      impl::ParseIndexAndTimestampLiteral(p, end, kUs, sizeof(kUs) - 1u)) {
+    const bool negative = impl::ParseIndexAndTimestampLiteral(p, end, "-", 1u);
+    if (impl::ParseIndexAndTimestampDigits(p, end, us) && !(negative && !us) && p + 1 == end && *p == '}') {
+      const int64_t signed_us = static_cast<int64_t>(us);
+      return IndexAndTimestamp(index, std::chrono::microseconds(negative ? -signed_us : signed_us));
+    }
+  }
+  return ParseJSON<IndexAndTimestamp>(std::string(json));
+}
+
 }  // namespace current::ss
 }  // namespace current
 
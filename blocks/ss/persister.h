@@ -84,6 +84,25 @@ class EntryPersister : public GenericEntryPersister<ENTRY>, public IMPL {
     return IMPL::template PersisterPublishUnsafeImpl<MLS>(raw_log_line, us);
   }
 
+  // Publishes the raw log lines in bulk, as is, only parsing and validating their indexes and timestamps.
+  // Either all of the lines are published, or, if any of them is invalid, none.
+  // Returns the index and timestamp of the last line, which must be non-empty.
+  template <current::locks::MutexLockStatus MLS = current::locks::MutexLockStatus::NeedToLock>
+  idxts_t PublishUnsafe(const RawLogLinesBatch& batch) {
+    return IMPL::template PersisterPublishUnsafeImpl<MLS>(batch);
+  }
+
+  // Publishes the entries in bulk, the i-th one with the i-th timestamp, under one lock and with one write.
+  // The timestamps must be strictly increasing and past the head. Either all of the entries are published, or none.
+  // Returns the index and timestamp of the last entry. The batch must be non-empty.
+  template <current::locks::MutexLockStatus MLS = current::locks::MutexLockStatus::NeedToLock,
+            typename ENTRIES,
+            typename TIMESTAMPS,
+            class = std::enable_if_t<can_publish_range_v<ENTRIES, ENTRY>>>
+  idxts_t PublishBatch(ENTRIES&& entries, const TIMESTAMPS& timestamps) {
+    return IMPL::template PersisterPublishBatchImpl<MLS>(std::forward<ENTRIES>(entries), timestamps);
+  }
+
   template <current::locks::MutexLockStatus MLS = current::locks::MutexLockStatus::NeedToLock>
   void UpdateHead(current::time::DefaultTimeArgument = current::time::DefaultTimeArgument()) {
     return IMPL::template PersisterUpdateHeadImpl<MLS>(current::time::DefaultTimeArgument());
@@ -81,6 +81,21 @@ class EntryPublisher : public GenericEntryPublisher<ENTRY>, public IMPL {
     return IMPL::template PublisherPublishUnsafeImpl<MLS>(raw_log_line);
   }
 
+  // Publishes the raw log lines in bulk, notifying the subscribers once. See `RawLogLinesBatch`.
+  template <MutexLockStatus MLS = MutexLockStatus::NeedToLock>
+  idxts_t PublishUnsafe(const RawLogLinesBatch& batch) {
+    return IMPL::template PublisherPublishUnsafeImpl<MLS>(batch);
+  }
+
+  // Publishes the entries in bulk, notifying the subscribers once. See `EntryPersister::PublishBatch()`.
+  template <MutexLockStatus MLS = MutexLockStatus::NeedToLock,
+            typename ENTRIES,
+            typename TIMESTAMPS,
+            class = std::enable_if_t<can_publish_range_v<ENTRIES, ENTRY>>>
+  idxts_t PublishBatch(ENTRIES&& entries, const TIMESTAMPS& timestamps) {
+    return IMPL::template PublisherPublishBatchImpl<MLS>(std::forward<ENTRIES>(entries), timestamps);
+  }
+
   template <MutexLockStatus MLS = MutexLockStatus::NeedToLock>
   void UpdateHead() {
     IMPL::template PublisherUpdateHeadImpl<MLS>(current::time::DefaultTimeArgument());
@@ -146,6 +161,16 @@ class EntrySubscriber : public GenericEntrySubscriber<ENTRY>, public IMPL {
   }
   EntryResponse operator()(std::chrono::microseconds ts) { return IMPL::operator()(ts); }
 
+  // Optional: the raw log lines in bulk, starting from `first_index`, for the subscribers that can take them as is.
+  template <typename I = IMPL,
+            class = std::enable_if_t<
+                std::is_same_v<decltype(std::declval<I&>()(
+                                   std::declval<const RawLogLinesBatch&>(), uint64_t(0u), std::declval<idxts_t>())),
+                               EntryResponse>>>
+  EntryResponse operator()(const RawLogLinesBatch& batch, uint64_t first_index, idxts_t last) {
+    return IMPL::operator()(batch, first_index, last);
+  }
+
   // If a type-filtered subscriber hits the end which it doesn't see as the last entry does not pass the filter,
   // we need a way to ask that subscriber whether it wants to terminate or continue.
   EntryResponse EntryResponseIfNoMorePassTypeFilter() const { return IMPL::EntryResponseIfNoMorePassTypeFilter(); }
@@ -177,6 +202,20 @@ struct IsStreamSubscriber {
   static constexpr bool value = std::is_base_of_v<GenericStreamSubscriber<current::decay_t<E>>, current::decay_t<T>>;
 };
 
+// Whether the subscriber accepts `RawLogLinesBatch`-es, for the replication to pass them on in bulk.
+template <typename T, typename = void>
+struct AcceptsRawLogLinesBatch {
+  static constexpr bool value = false;
+};
+
+template <typename T>
+struct AcceptsRawLogLinesBatch<T,
+                               std::void_t<decltype(std::declval<T&>()(std::declval<const RawLogLinesBatch&>(),
+                                                                       uint64_t(0u),
+                                                                       std::declval<idxts_t>()))>> {
+  static constexpr bool value = true;
+};
+
 namespace impl {
 
 template <typename TYPE_SUBSCRIBED_TO, typename STREAM_UNDERLYING_VARIANT>
@@ -100,6 +100,37 @@ struct DemoEntryPublisherImpl {
 
 }  // namespace stream_system_test
 
+TEST(StreamSystem, ParseIndexAndTimestampJSON) {
+  using current::ss::ParseIndexAndTimestampJSON;
+  using current::serialization::json::InvalidJSONException;
+  using current::serialization::json::JSONSchemaException;
+  const auto parse = [](const std::string& json) {
+    const idxts_t idxts = ParseIndexAndTimestampJSON(json);
+    return current::ToString(idxts.index) + ' ' + current::ToString(idxts.us.count());
+  };
+
+  // The exact form `JSON()` outputs, decoded in place.
+  EXPECT_EQ("0 0", parse("{\"index\":0,\"us\":0}"));
+  EXPECT_EQ("42 -1", parse("{\"index\":42,\"us\":-1}"));
+  EXPECT_EQ("123456789012345678 987654321098765432",
+            parse("{\"index\":123456789012345678,\"us\":987654321098765432}"));
+  for (uint64_t index : {0ull, 1ull, 999ull, 18446744073709551615ull}) {
+    for (int64_t us : {0ll, 1ll, -1000ll, 9223372036854775807ll, -9223372036854775807ll - 1ll}) {
+      const std::string json = JSON(idxts_t(index, std::chrono::microseconds(us)));
+      EXPECT_EQ(json, JSON(ParseIndexAndTimestampJSON(json)));
+    }
+  }
+
+  // Anything else, as `ParseJSON()` parses it.
+  EXPECT_EQ("1 2", parse(" { \"us\" : 2 , \"index\" : 1 } "));
+  EXPECT_EQ("1 2", parse("{\"index\":1,\"us\":2,\"extra\":3}"));
+  ASSERT_THROW(ParseIndexAndTimestampJSON(""), InvalidJSONException);
+  ASSERT_THROW(ParseIndexAndTimestampJSON("{\"index\":1,\"us\":2}}"), InvalidJSONException);
+  ASSERT_THROW(ParseIndexAndTimestampJSON("{\"index\":01,\"us\":2}"), InvalidJSONException);
+  ASSERT_THROW(ParseIndexAndTimestampJSON("{\"index\":-1,\"us\":2}"), JSONSchemaException);
+  ASSERT_THROW(ParseIndexAndTimestampJSON("{\"index\":1}"), JSONSchemaException);
+}
+
 TEST(StreamSystem, EntryPublisher) {
   using namespace stream_system_test;
   using DDE = DispatchDemoEntry;
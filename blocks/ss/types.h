@@ -26,14 +26,59 @@ SOFTWARE.
 #ifndef BLOCKS_SS_TYPES_H
 #define BLOCKS_SS_TYPES_H
 
+#include <iterator>
+#include <string_view>
 #include <type_traits>
 
+#include "../../bricks/strings/scan.h"
+
 namespace current {
 namespace ss {
 
 template <typename ENTRY, typename STREAM_ENTRY>
 inline constexpr bool can_publish_v = std::is_constructible_v<STREAM_ENTRY, ENTRY>;
 
+// Whether `PublishBatch()` can take the range of `ENTRIES`.
+template <typename ENTRIES, typename STREAM_ENTRY, typename = void>
+inline constexpr bool can_publish_range_v = false;
+
+template <typename ENTRIES, typename STREAM_ENTRY>
+inline constexpr bool can_publish_range_v<ENTRIES,
+                                          STREAM_ENTRY,
+                                          std::void_t<decltype(*std::begin(std::declval<ENTRIES&>()))>> =
+    std::is_constructible_v<STREAM_ENTRY, decltype(*std::begin(std::declval<ENTRIES&>()))>;
+
+// A batch of raw log lines, each an entry exactly as persisted, `{"index":...,"us":...}\t{...}`, terminated by '\n'.
+// `PublishUnsafe(RawLogLinesBatch(...))` publishes them in bulk, under one lock, with one write and one notification.
+// Does not own the data.
+struct RawLogLinesBatch final {
+  std::string_view lines;
+
+  explicit RawLogLinesBatch(std::string_view lines) : lines(lines) {}
+
+  bool Empty() const { return lines.empty(); }
+
+  // Whether the last line is terminated by a '\n', as the lines are written as they are, and must all be complete.
+  bool Complete() const { return !lines.empty() && lines.back() == '\n'; }
+
+  // Calls `f(line)` for each line, without its '\n'.
+  template <typename F>
+  void ForEachLine(F&& f) const {
+    ForEachLineWithTab([&f](std::string_view line, size_t) { f(line); });
+  }
+
+  // Calls `f(line, tab_pos)` for each line, without its '\n', where `tab_pos` is the position of the first '\t' in it,
+  // or `std::string_view::npos`. The lines and their tabs are found in bulk, see `bricks/strings/scan.h`.
+  template <typename F>
+  void ForEachLineWithTab(F&& f) const {
+    const size_t rest = strings::ForEachLineWithTab(lines, f);
+    if (rest < lines.length()) {
+      const std::string_view line = lines.substr(rest);
+      f(line, line.find('\t'));
+    }
+  }
+};
+
 }  // namespace current::ss
 }  // namespace current
 
@@ -34,6 +34,7 @@ SOFTWARE.
 #include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -236,20 +237,26 @@ struct URLParametersExtractor {
             c == '.' || c == '~' || c == '!' || c == '\'' || c == '(' || c == ')');
   }
 
-  static std::string DecodeURIComponent(const std::string& encoded) {
-    std::ostringstream decoded;
+  static int HexDigitValue(char c) {
+    return (c >= '0' && c <= '9') ? (c - '0') : (c >= 'a' && c <= 'f') ? (c - 'a' + 10) : (c - 'A' + 10);
+  }
+
+  // Accepts a view, so that the HTTP server can decode URL path components in place.
+  static std::string DecodeURIComponent(std::string_view encoded) {
+    std::string decoded;
+    decoded.reserve(encoded.length());
     for (size_t i = 0; i < encoded.length(); ++i) {
       const char c = encoded[i];
       if (c == '+') {
-        decoded << ' ';
+        decoded += ' ';
       } else if (c == '%' && i + 3 <= encoded.length() && IsHexDigit(encoded[i + 1]) && IsHexDigit(encoded[i + 2])) {
-        decoded << static_cast<char>(std::stoi(encoded.substr(i + 1, 2).c_str(), nullptr, 16));
+        decoded += static_cast<char>(HexDigitValue(encoded[i + 1]) * 16 + HexDigitValue(encoded[i + 2]));
         i += 2;
       } else {
-        decoded << c;
+        decoded += c;
       }
     }
-    return decoded.str();
+    return decoded;
   }
 
   static std::string EncodeURIComponent(const std::string& decoded) {
@@ -515,6 +522,7 @@ struct URLPathArgs {
   size_t size() const { return args_.size(); }
 
   void add(const std::string& arg) { args_.push_back(arg); }
+  void add(std::string&& arg) { args_.push_back(std::move(arg)); }
 
   std::string ComposeURLPathFromArgs() const {
     std::string result;
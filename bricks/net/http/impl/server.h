@@ -25,6 +25,7 @@ SOFTWARE.
 #ifndef BRICKS_NET_HTTP_IMPL_SERVER_H
 #define BRICKS_NET_HTTP_IMPL_SERVER_H
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <sstream>
@@ -122,7 +123,8 @@ struct HTTPResponder {
   }
 
   // The actual implementation of sending the HTTP response.
-  template <typename T>
+  // The `CONNECTION_TYPE` template parameter is what the `Connection:` header of the response says.
+  template <ConnectionType CONNECTION_TYPE = ConnectionClose, typename T>
   static void SendHTTPResponseImpl(Connection& connection,
                                    const T& begin,
                                    const T& end,
@@ -130,14 +132,15 @@ struct HTTPResponder {
                                    const http::Headers& headers,
                                    const std::string& content_type) {
     std::ostringstream os;
-    PrepareHTTPResponseHeader(os, ConnectionClose, code, headers, content_type);
+    PrepareHTTPResponseHeader(os, CONNECTION_TYPE, code, headers, content_type);
     os << "Content-Length: " << (end - begin) << constants::kCRLF << constants::kCRLF;
-    connection.BlockingWrite(os.str(), true);
+    // No `MSG_MORE` if the body is empty, or the header would be held back until the connection is closed.
+    connection.BlockingWrite(os.str(), begin != end);
     connection.BlockingWrite(begin, end, false);
   }
 
   // Only support STL containers of chars and bytes, this does not yet cover std::string.
-  template <typename T>
+  template <ConnectionType CONNECTION_TYPE = ConnectionClose, typename T>
   static std::enable_if_t<sizeof(typename T::value_type) == 1> SendHTTPResponse(
       Connection& connection,
       const T& begin,
@@ -145,29 +148,30 @@ struct HTTPResponder {
       HTTPResponseCodeValue code = HTTPResponseCode.OK,
       const std::string& content_type = constants::kDefaultContentType,
       const http::Headers& headers = http::Headers()) {
-    SendHTTPResponseImpl(connection, begin, end, code, headers, content_type);
+    SendHTTPResponseImpl<CONNECTION_TYPE>(connection, begin, end, code, headers, content_type);
   }
-  template <typename T>
+  template <ConnectionType CONNECTION_TYPE = ConnectionClose, typename T>
   static std::enable_if_t<sizeof(typename T::value_type) == 1> SendHTTPResponse(
       Connection& connection,
       T&& container,
       HTTPResponseCodeValue code = HTTPResponseCode.OK,
       const http::Headers& headers = http::Headers(),
       const std::string& content_type = constants::kDefaultContentType) {
-    SendHTTPResponseImpl(connection, container.begin(), container.end(), code, headers, content_type);
+    SendHTTPResponseImpl<CONNECTION_TYPE>(connection, container.begin(), container.end(), code, headers, content_type);
   }
 
   // Special case to handle std::string.
+  template <ConnectionType CONNECTION_TYPE = ConnectionClose>
   static void SendHTTPResponse(Connection& connection,
                                const std::string& string,
                                HTTPResponseCodeValue code = HTTPResponseCode.OK,
                                const http::Headers& headers = http::Headers(),
                                const std::string& content_type = constants::kDefaultContentType) {
-    SendHTTPResponseImpl(connection, string.begin(), string.end(), code, headers, content_type);
+    SendHTTPResponseImpl<CONNECTION_TYPE>(connection, string.begin(), string.end(), code, headers, content_type);
   }
 
   // Support `CURRENT_STRUCT`-s and `CURRENT_VARIANT`-s.
-  template <class T>
+  template <ConnectionType CONNECTION_TYPE = ConnectionClose, class T>
   static std::enable_if_t<IS_CURRENT_STRUCT_OR_VARIANT(current::decay_t<T>)> SendHTTPResponse(
       Connection& connection,
       T&& object,
@@ -176,7 +180,7 @@ struct HTTPResponder {
       const std::string& content_type = constants::kDefaultJSONContentType) {
     // TODO(dkorolev): We should probably make this not only correct but also efficient.
     const std::string s = JSON(std::forward<T>(object)) + '\n';
-    SendHTTPResponseImpl(connection, s.begin(), s.end(), code, headers, content_type);
+    SendHTTPResponseImpl<CONNECTION_TYPE>(connection, s.begin(), s.end(), code, headers, content_type);
   }
 };
 
@@ -562,13 +566,24 @@ class GenericHTTPServerConnection final : public HTTPResponder {
         }
       }
       // LCOV_EXCL_STOP
+    } else if (keep_alive_ && reusable_) {
+      keep_alive_(std::move(connection_));
     }
   }
 
+  // For the servers that keep the connections alive: have `SendHTTPResponse()` respond with `Connection: keep-alive`,
+  // and, once this object is destroyed after such a response, pass the connection to `f` instead of closing it.
+  // The connection is not reused after chunked responses, or if `RawConnection()` has been accessed.
+  void KeepAlive(std::function<void(Connection&&)> f) { keep_alive_ = std::move(f); }
+
   template <typename... ARGS>
   void SendHTTPResponse(ARGS&&... args) {
     if (responded_) {
       CURRENT_THROW(AttemptedToSendHTTPResponseMoreThanOnce());
+    } else if (keep_alive_) {
+      HTTPResponder::SendHTTPResponse<ConnectionKeepAlive>(connection_, std::forward<ARGS>(args)...);
+      responded_ = true;
+      reusable_ = true;
     } else {
       HTTPResponder::SendHTTPResponse(connection_, std::forward<ARGS>(args)...);
       responded_ = true;
@@ -725,10 +740,15 @@ class GenericHTTPServerConnection final : public HTTPResponder {
   const IPAndPort& LocalIPAndPort() const { return connection_.LocalIPAndPort(); }
   const IPAndPort& RemoteIPAndPort() const { return connection_.RemoteIPAndPort(); }
 
-  Connection& RawConnection() { return connection_; }
+  Connection& RawConnection() {
+    keep_alive_ = nullptr;
+    return connection_;
+  }
 
  private:
   bool responded_ = false;
+  bool reusable_ = false;
+  std::function<void(Connection&&)> keep_alive_;
   Connection connection_;
   GenericHTTPRequestData<HTTP_REQUEST_DATA> message_;
 
@@ -35,6 +35,7 @@ SOFTWARE.
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -57,6 +58,7 @@ typedef int SOCKET;
 
 #include "../../../util/singleton.h"
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <utility>
@@ -269,6 +271,16 @@ class Connection : public SocketHandle {
       uint8_t* buffer = reinterpret_cast<uint8_t*>(output_buffer);
       uint8_t* ptr = buffer;
       const uint8_t* end = (buffer + max_length);
+
+      if (prefetched_offset_ < prefetched_.length()) {
+        const size_t n = std::min(max_length, prefetched_.length() - prefetched_offset_);
+        std::memcpy(ptr, prefetched_.data() + prefetched_offset_, n);
+        prefetched_offset_ += n;
+        ptr += n;
+        if ((policy == BlockingReadPolicy::ReturnASAP) || (ptr == end)) {
+          return n;
+        }
+      }
       const int flags = ((policy == BlockingReadPolicy::ReturnASAP) ? 0 : MSG_WAITALL);
 
 #ifdef CURRENT_WINDOWS
@@ -370,6 +382,30 @@ class Connection : public SocketHandle {
     }
   }
 
+  // Makes the next `BlockingRead()`-s return `data` before reading anything more from the socket.
+  // Used by the servers that read from the sockets on their own, and then have the already received data parsed.
+  void SetPrefetchedData(std::string data) {
+    prefetched_ = std::move(data);
+    prefetched_offset_ = 0u;
+  }
+
+  // Whether the peer has neither closed the connection nor sent anything over it. Does not block.
+  // Used by the clients that keep idle connections alive, to check them before sending the next request.
+  bool IsOpenAndIdle() {
+    if (prefetched_offset_ < prefetched_.length()) {
+      return false;  // LCOV_EXCL_LINE
+    }
+    pollfd fd;
+    fd.fd = socket;
+    fd.events = POLLIN;
+    fd.revents = 0;
+#ifndef CURRENT_WINDOWS
+    return ::poll(&fd, 1, 0) == 0;
+#else
+    return ::WSAPoll(&fd, 1, 0) == 0;
+#endif
+  }
+
   inline Connection& BlockingWrite(const void* buffer, size_t write_length, bool more) {
 #if defined(CURRENT_APPLE) || defined(CURRENT_WINDOWS)
     static_cast<void>(more);  // Supress the 'unused parameter' warning.
@@ -419,6 +455,8 @@ class Connection : public SocketHandle {
  private:
   const IPAndPort local_ip_and_port_;
   const IPAndPort remote_ip_and_port_;
+  std::string prefetched_;
+  size_t prefetched_offset_ = 0u;
 
   Connection() = delete;
   Connection(const Connection&) = delete;
@@ -0,0 +1,235 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// Finding the lines, and the first tab of each line, in newline-delimited text, such as the stream files, in bulk.
+//
+// Stage one turns each 64-byte block of the text into two bitmasks, of its '\n'-s and of its '\t'-s, with AVX2
+// or SSE2 where the CPU has them, and with plain C++ elsewhere. Stage two walks the set bits of these masks,
+// calling back on each line with where its first tab is, if anywhere. The text is thus looked at once, in wide
+// vectors, not once per character for the newline and then once more for the tab.
+//
+// The quotes and the escapes need not be tracked. JSON never contains a raw '\n' or '\t', not even within its
+// strings, so the first tab of the line of a stream is always where its `{"index":...,"us":...}` ends.
+
+#ifndef BRICKS_STRINGS_SCAN_H
+#define BRICKS_STRINGS_SCAN_H
+
+#include "../../port.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CURRENT_STRINGS_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace current {
+namespace strings {
+
+enum class ScanInstructionSet : int { Scalar = 0, SSE2 = 1, AVX2 = 2 };
+
+inline bool IsScanInstructionSetSupported(ScanInstructionSet instruction_set) {
+#ifdef CURRENT_STRINGS_SCAN_X86
+  if (instruction_set == ScanInstructionSet::AVX2) {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+  }
+  if (instruction_set == ScanInstructionSet::SSE2) {
+    static const bool sse2 = __builtin_cpu_supports("sse2");
+    return sse2;
+  }
+#endif  // CURRENT_STRINGS_SCAN_X86
+  return instruction_set == ScanInstructionSet::Scalar;
+}
+
+// The instruction set used by default, the best one supported. Can be changed, to compare them, or to test them.
+inline ScanInstructionSet& DefaultScanInstructionSet() {
+  static ScanInstructionSet instruction_set = IsScanInstructionSetSupported(ScanInstructionSet::AVX2)
+                                                  ? ScanInstructionSet::AVX2
+                                                  : IsScanInstructionSetSupported(ScanInstructionSet::SSE2)
+                                                        ? ScanInstructionSet::SSE2
+                                                        : ScanInstructionSet::Scalar;
+  return instruction_set;
+}
+
+namespace impl {
+
+constexpr size_t kScanBlockSize = 64u;
+constexpr size_t kScanBlocksPerBatch = 64u;
+
+// Sets `newlines[i]` and `tabs[i]` to the masks of the '\n'-s and of the '\t'-s of the `i`-th 64-byte block of `data`.
+using scan_masks_t = void (*)(const char* data, size_t blocks, uint64_t* newlines, uint64_t* tabs);
+
+// The bits of the bytes of the little-endian `word` which are equal to `c`, eight bytes at a time, with no branches.
+// After the XOR the bytes equal to `c` are the zero bytes, and these are exactly the ones which get their high bit
+// set below; the multiplication then gathers the eight high bits into the top byte, as they never collide or carry.
+inline uint64_t ScanMaskOfEightBytes(uint64_t word, char c) {
+  constexpr uint64_t kLowSevenBits = 0x7F7F7F7F7F7F7F7Full;
+  const uint64_t x = word ^ (0x0101010101010101ull * static_cast<uint8_t>(c));
+  const uint64_t high_bits_of_zero_bytes = ~(((x & kLowSevenBits) + kLowSevenBits) | x | kLowSevenBits);
+  return ((high_bits_of_zero_bytes >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+inline void ScanMasksScalar(const char* data, size_t blocks, uint64_t* newlines, uint64_t* tabs) {
+  for (size_t b = 0u; b < blocks; ++b, data += kScanBlockSize) {
+    uint64_t n = 0u;
+    uint64_t t = 0u;
+    for (size_t i = 0u; i < kScanBlockSize; i += 8u) {
+      uint64_t word;
+      std::memcpy(&word, data + i, 8u);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+      word = __builtin_bswap64(word);
+#endif
+      n |= ScanMaskOfEightBytes(word, '\n') << i;
+      t |= ScanMaskOfEightBytes(word, '\t') << i;
+    }
+    newlines[b] = n;
+    tabs[b] = t;
+  }
+}
+
+#ifdef CURRENT_STRINGS_SCAN_X86
+
+__attribute__((target("sse2"))) inline void ScanMasksSSE2(const char* data,
+                                                          size_t blocks,
+                                                          uint64_t* newlines,
+                                                          uint64_t* tabs) {
+  const __m128i n = _mm_set1_epi8('\n');
+  const __m128i t = _mm_set1_epi8('\t');
+  for (size_t b = 0u; b < blocks; ++b, data += kScanBlockSize) {
+    uint64_t n_mask = 0u;
+    uint64_t t_mask = 0u;
+    for (size_t i = 0u; i < kScanBlockSize; i += 16u) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      n_mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, n)))) << i;
+      t_mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, t)))) << i;
+    }
+    newlines[b] = n_mask;
+    tabs[b] = t_mask;
+  }
+}
+
+__attribute__((target("avx2"))) inline void ScanMasksAVX2(const char* data,
+                                                          size_t blocks,
+                                                          uint64_t* newlines,
+                                                          uint64_t* tabs) {
+  const __m256i n = _mm256_set1_epi8('\n');
+  const __m256i t = _mm256_set1_epi8('\t');
+  for (size_t b = 0u; b < blocks; ++b, data += kScanBlockSize) {
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32u));
+    newlines[b] = static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, n)))) |
+                  (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, n)))) << 32);
+    tabs[b] = static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, t)))) |
+              (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, t)))) << 32);
+  }
+}
+
+#endif  // CURRENT_STRINGS_SCAN_X86
+
+inline scan_masks_t ScanMasks(ScanInstructionSet instruction_set) {
+#ifdef CURRENT_STRINGS_SCAN_X86
+  if (instruction_set == ScanInstructionSet::AVX2 && IsScanInstructionSetSupported(ScanInstructionSet::AVX2)) {
+    return ScanMasksAVX2;
+  }
+  if (instruction_set != ScanInstructionSet::Scalar && IsScanInstructionSetSupported(ScanInstructionSet::SSE2)) {
+    return ScanMasksSSE2;
+  }
+#else
+  static_cast<void>(instruction_set);
+#endif  // CURRENT_STRINGS_SCAN_X86
+  return ScanMasksScalar;
+}
+
+inline size_t CountTrailingZeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<size_t>(__builtin_ctzll(x));
+#else
+  size_t result = 0u;
+  while (!(x & 1u)) {
+    x >>= 1;
+    ++result;
+  }
+  return result;
+#endif
+}
+
+}  // namespace current::strings::impl
+
+// Calls `f(line, tab_pos)` for each complete, '\n'-terminated, line of `text`, passing the line without its '\n',
+// and the position of its first '\t', or `std::string_view::npos` if there is none.
+// Returns the total length of these lines, which is where the incomplete last line of `text`, if any, begins.
+template <typename F>
+size_t ForEachLineWithTab(std::string_view text,
+                          F&& f,
+                          ScanInstructionSet instruction_set = DefaultScanInstructionSet()) {
+  constexpr size_t kBatchSize = impl::kScanBlockSize * impl::kScanBlocksPerBatch;
+  const impl::scan_masks_t scan_masks = impl::ScanMasks(instruction_set);
+  uint64_t newlines[impl::kScanBlocksPerBatch];
+  uint64_t tabs[impl::kScanBlocksPerBatch];
+  const char* data = text.data();
+  size_t line_begin = 0u;
+  size_t tab_pos = std::string_view::npos;
+  for (size_t batch_begin = 0u; batch_begin < text.length(); batch_begin += kBatchSize) {
+    const size_t batch_size = std::min(kBatchSize, text.length() - batch_begin);
+    size_t blocks = batch_size / impl::kScanBlockSize;
+    scan_masks(data + batch_begin, blocks, newlines, tabs);
+    if (batch_size % impl::kScanBlockSize) {
+      // The last incomplete block is padded with zeroes, which are neither '\n'-s nor '\t'-s.
+      char padded[impl::kScanBlockSize] = {0};
+      std::memcpy(padded, data + batch_begin + blocks * impl::kScanBlockSize, batch_size % impl::kScanBlockSize);
+      scan_masks(padded, 1u, newlines + blocks, tabs + blocks);
+      ++blocks;
+    }
+    for (size_t b = 0u; b < blocks; ++b) {
+      const size_t block_begin = batch_begin + b * impl::kScanBlockSize;
+      uint64_t n = newlines[b];
+      uint64_t t = tabs[b];
+      while (n) {
+        const size_t i = impl::CountTrailingZeros(n);
+        const uint64_t before_newline = (static_cast<uint64_t>(1u) << i) - 1u;
+        if (tab_pos == std::string_view::npos && (t & before_newline)) {
+          tab_pos = block_begin + impl::CountTrailingZeros(t & before_newline) - line_begin;
+        }
+        f(std::string_view(data + line_begin, block_begin + i - line_begin), tab_pos);
+        line_begin = block_begin + i + 1u;
+        tab_pos = std::string_view::npos;
+        t &= ~before_newline;
+        n &= n - 1u;
+      }
+      if (tab_pos == std::string_view::npos && t) {
+        tab_pos = block_begin + impl::CountTrailingZeros(t) - line_begin;
+      }
+    }
+  }
+  return line_begin;
+}
+
+}  // namespace current::strings
+}  // namespace current
+
+#endif  // BRICKS_STRINGS_SCAN_H
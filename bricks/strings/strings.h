@@ -34,6 +34,7 @@ SOFTWARE.
 #include "printf.h"
 #include "regex.h"
 #include "rounding.h"
+#include "scan.h"
 #include "split.h"
 #include "time.h"
 #include "util.h"
@@ -24,6 +24,7 @@ SOFTWARE.
 
 #include <chrono>
 #include <cmath>
+#include <random>
 #include <set>
 #include <string>
 #include <vector>
@@ -991,3 +992,54 @@ TEST(UTF8StringLength, Smoke) {
   EXPECT_EQ(4u, current::strings::UTF8StringLength("test"));
   EXPECT_EQ(4u, current::strings::UTF8StringLength("тест"));
 }
+
+TEST(Scan, ForEachLineWithTab) {
+  using current::strings::ScanInstructionSet;
+  const auto naive = [](const std::string& text) {
+    std::vector<std::string> result;
+    size_t begin = 0u;
+    size_t end;
+    while ((end = text.find('\n', begin)) != std::string::npos) {
+      const std::string line = text.substr(begin, end - begin);
+      const size_t tab_pos = line.find('\t');
+      result.push_back(line + '@' + (tab_pos == std::string::npos ? "none" : current::ToString(tab_pos)));
+      begin = end + 1u;
+    }
+    result.push_back("rest@" + current::ToString(begin));
+    return result;
+  };
+  const auto scan = [](const std::string& text, ScanInstructionSet instruction_set) {
+    std::vector<std::string> result;
+    const size_t rest = current::strings::ForEachLineWithTab(
+        text,
+        [&result](std::string_view line, size_t tab_pos) {
+          result.push_back(std::string(line) + '@' +
+                           (tab_pos == std::string_view::npos ? "none" : current::ToString(tab_pos)));
+        },
+        instruction_set);
+    result.push_back("rest@" + current::ToString(rest));
+    return result;
+  };
+
+  EXPECT_EQ(naive(""), scan("", ScanInstructionSet::Scalar));
+  EXPECT_EQ(naive("a\tb\tc\n\n\t\nno newline"), scan("a\tb\tc\n\n\t\nno newline", ScanInstructionSet::Scalar));
+
+  // Lines of all lengths, crossing the 64-byte blocks and the batches of them, with the tabs anywhere in them.
+  std::mt19937 rng(42);
+  for (size_t iteration = 0u; iteration < 200u; ++iteration) {
+    std::string text;
+    const size_t length = std::uniform_int_distribution<size_t>(0u, 20000u)(rng);
+    const size_t average_line_length = std::uniform_int_distribution<size_t>(1u, 5000u)(rng);
+    for (size_t i = 0u; i < length; ++i) {
+      const size_t r = std::uniform_int_distribution<size_t>(0u, average_line_length)(rng);
+      text += (r == 0u) ? '\n' : (r == 1u) ? '\t' : static_cast<char>('a' + r % 26u);
+    }
+    const auto golden = naive(text);
+    for (ScanInstructionSet instruction_set :
+         {ScanInstructionSet::Scalar, ScanInstructionSet::SSE2, ScanInstructionSet::AVX2}) {
+      if (current::strings::IsScanInstructionSetSupported(instruction_set)) {
+        EXPECT_EQ(golden, scan(text, instruction_set)) << static_cast<int>(instruction_set);
+      }
+    }
+  }
+}
@@ -40,7 +40,7 @@ struct is_unique_ptr_impl {
   static T& extract(T* x) { return *x; }
   static const T& extract(const T* x) { return *x; }
   static T* pointer(T& x) { return &x; }
-  static const T* pointer(const T& x) { return x; }
+  static const T* pointer(const T& x) { return &x; }
   static T* pointer(T* x) { return x; }
   static const T* pointer(const T* x) { return x; }
 };
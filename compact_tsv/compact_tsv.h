@@ -29,15 +29,38 @@ SOFTWARE.
 // TODO(dkorolev): Move to fast strings.
 // TODO(batman): Exceptions.
 
+#include <algorithm>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
 
+#include "../bricks/exception.h"
 #include "../bricks/template/weed.h"
 #include "../bricks/strings/chunk.h"
+#include "../bricks/strings/util.h"
 #include "../bricks/util/singleton.h"
 
+struct CompactTSVException : current::Exception {
+  using current::Exception::Exception;
+};
+
+struct CompactTSVMalformedInputException : CompactTSVException {
+  explicit CompactTSVMalformedInputException(const std::string& what)
+      : CompactTSVException("Malformed packed TSV: " + what + '.') {}
+};
+
+struct CompactTSVInconsistentRowException : CompactTSVException {
+  CompactTSVInconsistentRowException(size_t expected, size_t actual)
+      : CompactTSVException("Expected " + current::ToString(expected) + " columns, seeing " +
+                            current::ToString(actual) + '.') {}
+};
+
+struct CompactTSVUnknownColumnException : CompactTSVException {
+  explicit CompactTSVUnknownColumnException(const std::string& column)
+      : CompactTSVException("Unknown column `" + column + "`.") {}
+};
+
 namespace efficient_tsv_parser_dispatcher {
 
 template <typename T>
@@ -201,6 +224,72 @@ class CompactTSV {
     return Unpack(std::forward<F>(f), &input[0], input.size());
   }
 
+  // Unpacks only the `columns`, by their indexes, into `const std::vector<current::strings::Chunk>&` rows, the i-th
+  // chunk being the value of `columns[i]`. The updates of all the other columns are skipped altogether, so the cost
+  // of unpacking depends on the number of the columns unpacked, not on the number of the columns in the TSV.
+  // The chunks point into `data`, and stay valid as long as it does.
+  template <typename F>
+  static size_t UnpackColumns(F&& f, const std::vector<size_t>& columns, const uint8_t* data, size_t length) {
+    return UnpackColumnsImpl(std::forward<F>(f), columns, false, data, length);
+  }
+
+  template <typename F>
+  static size_t UnpackColumns(F&& f, const std::vector<size_t>& columns, const std::string& input) {
+    return UnpackColumns(std::forward<F>(f), columns, reinterpret_cast<const uint8_t*>(&input[0]), input.length());
+  }
+
+  // Same as `UnpackColumns()`, with the columns selected by their names in the first row, the header, which is not
+  // unpacked itself.
+  template <typename F>
+  static size_t UnpackColumnsByName(F&& f, const std::vector<std::string>& names, const uint8_t* data, size_t length) {
+    const std::vector<std::string> header = Header(data, length);
+    std::vector<size_t> columns;
+    columns.reserve(names.size());
+    for (const std::string& name : names) {
+      const auto cit = std::find(header.begin(), header.end(), name);
+      if (cit == header.end()) {
+        CURRENT_THROW(CompactTSVUnknownColumnException(name));
+      }
+      columns.push_back(static_cast<size_t>(cit - header.begin()));
+    }
+    return UnpackColumnsImpl(std::forward<F>(f), columns, true, data, length);
+  }
+
+  template <typename F>
+  static size_t UnpackColumnsByName(F&& f, const std::vector<std::string>& names, const std::string& input) {
+    return UnpackColumnsByName(std::forward<F>(f), names, reinterpret_cast<const uint8_t*>(&input[0]), input.length());
+  }
+
+  // The first row, which is the header of the TSV, if it has one.
+  static std::vector<std::string> Header(const uint8_t* data, size_t length) {
+    std::vector<std::string> header;
+    const uint8_t* p = data;
+    const uint8_t* end = data + length;
+    while (p < end) {
+      const index_type index = *p++;
+      if (index == markers().storage) {
+        CheckBounds(p + sizeof(length_type), end);
+        p += sizeof(length_type) + *reinterpret_cast<const length_type*>(p) + 1u;
+      } else if (index == markers().row_done) {
+        return header;
+      } else {
+        CheckBounds(p + sizeof(offset_type), end);
+        const offset_type offset = *reinterpret_cast<const offset_type*>(p);
+        p += sizeof(offset_type);
+        const current::strings::Chunk string = StoredString(data, length, offset);
+        if (index >= header.size()) {
+          header.resize(index + 1u);
+        }
+        header[index].assign(string.c_str(), string.length());
+      }
+    }
+    CURRENT_THROW(CompactTSVMalformedInputException("no complete first row"));
+  }
+
+  static std::vector<std::string> Header(const std::string& input) {
+    return Header(reinterpret_cast<const uint8_t*>(&input[0]), input.length());
+  }
+
  private:
   // Types and helpers.
   using index_type = uint8_t;    // Type to store column index, strictly < 254, 2^8 minus two special markers.
@@ -218,6 +307,89 @@ class CompactTSV {
 
   static const Markers& markers() { return current::Singleton<Markers>(); }
 
+  static void CheckBounds(const uint8_t* p, const uint8_t* end) {
+    if (p > end) {
+      CURRENT_THROW(CompactTSVMalformedInputException("unexpected end of data"));
+    }
+  }
+
+  // The string stored at `offset`, checked to be within the `length` bytes of `data`.
+  static current::strings::Chunk StoredString(const uint8_t* data, size_t length, offset_type offset) {
+    if (static_cast<size_t>(offset) + sizeof(length_type) > length) {
+      CURRENT_THROW(CompactTSVMalformedInputException("string offset out of bounds"));
+    }
+    const length_type string_length = *reinterpret_cast<const length_type*>(data + offset);
+    if (static_cast<size_t>(offset) + sizeof(length_type) + string_length > length) {
+      CURRENT_THROW(CompactTSVMalformedInputException("string length out of bounds"));
+    }
+    const char* string = reinterpret_cast<const char*>(data + offset + sizeof(length_type));
+    return current::strings::Chunk(string, string + string_length);
+  }
+
+  template <typename F>
+  static size_t UnpackColumnsImpl(
+      F&& f, const std::vector<size_t>& columns, bool skip_header, const uint8_t* data, size_t length) {
+    // The position of each column of the TSV in the unpacked row, if it is unpacked, for a single lookup per update.
+    // A column requested more than once is copied over once the row is complete.
+    constexpr size_t kNotUnpacked = static_cast<size_t>(-1);
+    std::vector<size_t> positions(markers().row_done, kNotUnpacked);
+    std::vector<std::pair<size_t, size_t>> copies;
+    for (size_t i = 0; i < columns.size(); ++i) {
+      if (columns[i] >= positions.size()) {
+        CURRENT_THROW(CompactTSVUnknownColumnException(current::ToString(columns[i])));
+      }
+      if (positions[columns[i]] == kNotUnpacked) {
+        positions[columns[i]] = i;
+      } else {
+        copies.emplace_back(positions[columns[i]], i);
+      }
+    }
+
+    std::vector<current::strings::Chunk> row(columns.size());
+    size_t dim = 0u;
+    size_t rows = 0u;
+    const uint8_t* p = data;
+    const uint8_t* end = data + length;
+    while (p < end) {
+      const index_type index = *p++;
+      if (index == markers().storage) {
+        CheckBounds(p + sizeof(length_type), end);
+        p += sizeof(length_type) + *reinterpret_cast<const length_type*>(p) + 1u;
+        CheckBounds(p, end);
+      } else if (index == markers().row_done) {
+        if (!rows) {
+          // The first row has all the columns, so the dimension of the TSV is known once it is complete.
+          for (size_t column : columns) {
+            if (column >= dim) {
+              CURRENT_THROW(CompactTSVUnknownColumnException(current::ToString(column)));
+            }
+          }
+        }
+        if (rows++ || !skip_header) {
+          for (const auto& copy : copies) {
+            row[copy.second] = row[copy.first];
+          }
+          f(static_cast<const std::vector<current::strings::Chunk>&>(row));
+        }
+      } else {
+        CheckBounds(p + sizeof(offset_type), end);
+        const offset_type offset = *reinterpret_cast<const offset_type*>(p);
+        p += sizeof(offset_type);
+        if (index >= dim) {
+          if (rows) {
+            CURRENT_THROW(CompactTSVInconsistentRowException(dim, index + 1u));
+          }
+          dim = index + 1u;
+        }
+        const size_t position = positions[index];
+        if (position != kNotUnpacked) {
+          row[position] = StoredString(data, length, offset);
+        }
+      }
+    }
+    return (rows && skip_header) ? rows - 1u : rows;
+  }
+
   // Members.
   bool done_ = false;                 // Whether the TSV data is done.
   size_t dim_ = 0u;                   // Number of rows in input data.
@@ -0,0 +1,497 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef COMPACTTSV_COMPACTTSV_V2_H
+#define COMPACTTSV_COMPACTTSV_V2_H
+
+// The v2 format of `CompactTSV`, for the inputs which are large, wide, or need random access.
+//
+// Unlike v1, which builds the whole packed output in memory, and is limited to 253 columns, 64KB per string, and 4GB
+// in total, v2 writes the output incrementally, block by block, and has no such limits, as all the numbers are varints.
+//
+// The layout of the file:
+// * The 8-byte header, `kHeaderMagic`.
+// * The blocks, each of `rows_per_block` rows, except the last one, which may have fewer.
+//   Each block is self-contained, and is decoded on its own, with no need to look at the blocks before it:
+//   * varint: the number of rows in this block,
+//   * varint: the number of strings in the dictionary of this block,
+//   * the dictionary, each string as its varint length, its bytes, and a '\0',
+//   * the columns, one after another, each as its varint number of runs, and then, for each run of the same value
+//     in the consecutive rows, the varint length of this run and the varint id of its value in the dictionary.
+// * The block index, the 64-bit offset of each block in the file.
+// * The footer, `compact_tsv_v2::Footer`, which ends with `kFooterMagic`.
+//
+// Thus, reading row N takes finding its block, N / rows_per_block, in the block index, and decoding this one block.
+// `CompactTSV2Reader` reads the packed data from memory, such as the file mapped into memory by `CompactTSV2File`,
+// and decodes the blocks sequentially, from any row, or in parallel, in several threads.
+
+#include "../port.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef CURRENT_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // CURRENT_WINDOWS
+
+#include "compact_tsv.h"
+
+#include "../bricks/exception.h"
+#include "../bricks/file/file.h"
+#include "../bricks/strings/util.h"
+
+namespace compact_tsv_v2 {
+
+constexpr char kHeaderMagic[8] = {'C', 'T', 'S', 'V', '2', 'H', 'D', 'R'};
+constexpr char kFooterMagic[8] = {'C', 'T', 'S', 'V', '2', 'E', 'N', 'D'};
+
+struct Footer {
+  uint64_t dim;
+  uint64_t rows;
+  uint64_t rows_per_block;
+  uint64_t blocks;
+  uint64_t index_offset;
+  char magic[8];
+};
+
+static_assert(sizeof(Footer) == 48, "");
+
+inline void AppendVarint(std::string& output, uint64_t value) {
+  while (value >= 0x80u) {
+    output += static_cast<char>((value & 0x7fu) | 0x80u);
+    value >>= 7;
+  }
+  output += static_cast<char>(value);
+}
+
+inline uint64_t ReadVarint(const uint8_t*& p, const uint8_t* end) {
+  uint64_t result = 0u;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p == end) {
+      CURRENT_THROW(CompactTSVMalformedInputException("truncated block"));
+    }
+    const uint8_t byte = *p++;
+    result |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+    if (!(byte & 0x80u)) {
+      return result;
+    }
+  }
+  CURRENT_THROW(CompactTSVMalformedInputException("invalid varint"));
+}
+
+// The dispatchers of `Unpack()` for the callbacks which also take the index of the block, `f(block, row)`.
+template <typename F>
+using BlockDispatcherImplSelector = efficient_tsv_parser_dispatcher::DispatcherImpl<
+    efficient_tsv_parser_dispatcher::CW<F, size_t, std::vector<std::string>>::implemented,
+    efficient_tsv_parser_dispatcher::CW<F, size_t, std::vector<const char*>>::implemented,
+    efficient_tsv_parser_dispatcher::CW<F, size_t, std::vector<std::pair<const char*, size_t>>>::implemented,
+    efficient_tsv_parser_dispatcher::CW<F, size_t, std::vector<current::strings::UniqueChunk>>::implemented>;
+
+}  // namespace compact_tsv_v2
+
+// Packs the rows into the v2 format, writing each block into `os` as soon as it is complete.
+class CompactTSV2 {
+ public:
+  constexpr static size_t kDefaultRowsPerBlock = 1u << 14;
+
+  // `dim` can be set at construction time, or taken from the first row.
+  explicit CompactTSV2(std::ostream& os, size_t rows_per_block = kDefaultRowsPerBlock, size_t dim = 0u)
+      : os_(os), rows_per_block_(rows_per_block), dim_(dim) {
+    CURRENT_ASSERT(rows_per_block_ > 0u);
+    Write(compact_tsv_v2::kHeaderMagic, sizeof(compact_tsv_v2::kHeaderMagic));
+  }
+
+  void operator()(const std::vector<std::string>& row) {
+    CURRENT_ASSERT(!done_);
+    if (!dim_) {
+      if (row.empty()) {
+        CURRENT_THROW(CompactTSVInconsistentRowException(1u, 0u));
+      }
+      dim_ = row.size();
+    } else if (row.size() != dim_) {
+      CURRENT_THROW(CompactTSVInconsistentRowException(dim_, row.size()));
+    }
+    if (!block_rows_) {
+      columns_.resize(dim_);
+      for (std::vector<run_t>& runs : columns_) {
+        runs.clear();
+      }
+      current_.resize(dim_);
+    }
+    for (size_t i = 0u; i < dim_; ++i) {
+      std::vector<run_t>& runs = columns_[i];
+      if (block_rows_ && row[i] == current_[i]) {
+        ++runs.back().length;
+      } else {
+        current_[i] = row[i];
+        runs.push_back({1u, GetIdOf(row[i])});
+      }
+    }
+    ++rows_;
+    if (++block_rows_ == rows_per_block_) {
+      WriteBlock();
+    }
+  }
+
+  // Writes the last block, the block index, and the footer.
+  void Finalize() {
+    CURRENT_ASSERT(!done_);
+    if (block_rows_) {
+      WriteBlock();
+    }
+    const uint64_t index_offset = offset_;
+    Write(block_offsets_.data(), block_offsets_.size() * sizeof(uint64_t));
+    compact_tsv_v2::Footer footer;
+    footer.dim = dim_;
+    footer.rows = rows_;
+    footer.rows_per_block = rows_per_block_;
+    footer.blocks = block_offsets_.size();
+    footer.index_offset = index_offset;
+    std::memcpy(footer.magic, compact_tsv_v2::kFooterMagic, sizeof(footer.magic));
+    Write(&footer, sizeof(footer));
+    os_.flush();
+    done_ = true;
+  }
+
+  uint64_t Rows() const { return rows_; }
+
+ private:
+  struct run_t {
+    uint64_t length;
+    uint64_t id;
+  };
+
+  std::ostream& os_;
+  const size_t rows_per_block_;
+  size_t dim_;
+  bool done_ = false;
+  uint64_t rows_ = 0u;
+  uint64_t offset_ = 0u;                 // The number of bytes written so far.
+  std::vector<uint64_t> block_offsets_;  // Where each block written so far begins.
+
+  // The block being built.
+  size_t block_rows_ = 0u;
+  std::vector<std::vector<run_t>> columns_;        // The runs of the same value in each column.
+  std::vector<std::string> current_;               // The current values of the columns, to extend the runs.
+  std::unordered_map<std::string, uint64_t> ids_;  // The ids of the strings in the dictionary of the block.
+  std::string dictionary_;                         // The dictionary of the block, serialized.
+  std::string buffer_;                             // The block, serialized.
+
+  void Write(const void* data, size_t size) {
+    os_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    offset_ += size;
+  }
+
+  uint64_t GetIdOf(const std::string& s) {
+    const auto it = ids_.find(s);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+    const uint64_t id = ids_.size();
+    ids_.emplace(s, id);
+    compact_tsv_v2::AppendVarint(dictionary_, s.length());
+    dictionary_.append(s.c_str(), s.length() + 1u);  // Including the null character.
+    return id;
+  }
+
+  void WriteBlock() {
+    buffer_.clear();
+    compact_tsv_v2::AppendVarint(buffer_, block_rows_);
+    compact_tsv_v2::AppendVarint(buffer_, ids_.size());
+    buffer_ += dictionary_;
+    for (const std::vector<run_t>& runs : columns_) {
+      compact_tsv_v2::AppendVarint(buffer_, runs.size());
+      for (const run_t& run : runs) {
+        compact_tsv_v2::AppendVarint(buffer_, run.length);
+        compact_tsv_v2::AppendVarint(buffer_, run.id);
+      }
+    }
+    block_offsets_.push_back(offset_);
+    Write(buffer_.data(), buffer_.length());
+    block_rows_ = 0u;
+    ids_.clear();
+    dictionary_.clear();
+  }
+};
+
+// Unpacks the data packed by `CompactTSV2`. Does not own the data, which must be valid while the reader is in use.
+// Throws `CompactTSVMalformedInputException` on the data which is not valid.
+class CompactTSV2Reader {
+ public:
+  CompactTSV2Reader(const char* data, size_t length) : data_(reinterpret_cast<const uint8_t*>(data)) {
+    if (!IsCompactTSV2(data, length) || length < sizeof(compact_tsv_v2::kHeaderMagic) + sizeof(footer_)) {
+      CURRENT_THROW(CompactTSVMalformedInputException("no header"));
+    }
+    std::memcpy(&footer_, data + length - sizeof(footer_), sizeof(footer_));
+    if (std::memcmp(footer_.magic, compact_tsv_v2::kFooterMagic, sizeof(footer_.magic))) {
+      CURRENT_THROW(CompactTSVMalformedInputException("no footer"));
+    }
+    if (!footer_.rows_per_block ||
+        footer_.blocks != (footer_.rows + footer_.rows_per_block - 1u) / footer_.rows_per_block ||
+        footer_.index_offset < sizeof(compact_tsv_v2::kHeaderMagic) ||
+        footer_.index_offset > length - sizeof(footer_) ||
+        (length - sizeof(footer_) - footer_.index_offset) / sizeof(uint64_t) != footer_.blocks ||
+        (length - sizeof(footer_) - footer_.index_offset) % sizeof(uint64_t)) {
+      CURRENT_THROW(CompactTSVMalformedInputException("invalid footer"));
+    }
+    block_offsets_.resize(footer_.blocks + 1u);
+    std::memcpy(block_offsets_.data(), data + footer_.index_offset, footer_.blocks * sizeof(uint64_t));
+    block_offsets_.back() = footer_.index_offset;
+    uint64_t previous = sizeof(compact_tsv_v2::kHeaderMagic);
+    for (size_t i = 0u; i < block_offsets_.size(); ++i) {
+      const uint64_t offset = block_offsets_[i];
+      if (offset < previous) {
+        CURRENT_THROW(CompactTSVMalformedInputException("invalid block index"));
+      }
+      // A block has the numbers of its rows and of its strings, and at least a byte per column, so `dim` is checked
+      // against the size of each block before anything is allocated for that many columns.
+      if (i && (offset - previous < 2u || footer_.dim > offset - previous - 2u)) {
+        CURRENT_THROW(CompactTSVMalformedInputException("invalid number of columns"));
+      }
+      previous = offset;
+    }
+  }
+
+  explicit CompactTSV2Reader(const std::string& data) : CompactTSV2Reader(data.data(), data.length()) {}
+
+  static bool IsCompactTSV2(const char* data, size_t length) {
+    return length >= sizeof(compact_tsv_v2::kHeaderMagic) &&
+           !std::memcmp(data, compact_tsv_v2::kHeaderMagic, sizeof(compact_tsv_v2::kHeaderMagic));
+  }
+  static bool IsCompactTSV2(const std::string& data) { return IsCompactTSV2(data.data(), data.length()); }
+
+  size_t Dim() const { return static_cast<size_t>(footer_.dim); }
+  uint64_t Rows() const { return footer_.rows; }
+  uint64_t RowsPerBlock() const { return footer_.rows_per_block; }
+  size_t Blocks() const { return static_cast<size_t>(footer_.blocks); }
+
+  // Calls `f(row)` for at most `max_rows` rows, starting from the row `from_row`. Returns the number of rows unpacked.
+  // The type of the row is `std::vector<>` of `std::string`, `const char*`, `std::pair<const char*, size_t>`,
+  // or `current::strings::UniqueChunk`, whichever `f` takes, as with `CompactTSV::Unpack()`.
+  template <typename F>
+  uint64_t Unpack(F&& f, uint64_t from_row = 0u, uint64_t max_rows = std::numeric_limits<uint64_t>::max()) const {
+    efficient_tsv_parser_dispatcher::DispatcherImplSelector<F> dispatcher;
+    uint64_t total = 0u;
+    for (size_t block = static_cast<size_t>(from_row / footer_.rows_per_block);
+         block < footer_.blocks && total < max_rows;
+         ++block) {
+      const uint64_t skip = (block == from_row / footer_.rows_per_block) ? from_row % footer_.rows_per_block : 0u;
+      total += DecodeBlock(block, skip, max_rows - total, dispatcher, [&f, &dispatcher]() { dispatcher.Emit(f); });
+    }
+    return total;
+  }
+
+  // Calls `f(block, row)` for each row of the blocks in `[begin_block, end_block)`, decoding them in `threads` threads.
+  // The rows of each block are unpacked in order, by the same thread; the blocks are unpacked in no particular order,
+  // and `f` is called concurrently for different blocks. Returns the number of rows unpacked.
+  template <typename F>
+  uint64_t ParallelUnpack(F&& f,
+                          size_t threads,
+                          size_t begin_block = 0u,
+                          size_t end_block = std::numeric_limits<size_t>::max()) const {
+    end_block = std::min(end_block, Blocks());
+    std::atomic<size_t> next_block(begin_block);
+    std::atomic<uint64_t> total(0u);
+    std::vector<std::exception_ptr> errors(std::max(threads, static_cast<size_t>(1u)));
+    const auto thread_function = [&](size_t thread_index) {
+      try {
+        compact_tsv_v2::BlockDispatcherImplSelector<F> dispatcher;
+        size_t block;
+        while ((block = next_block++) < end_block) {
+          total += DecodeBlock(block,
+                               0u,
+                               std::numeric_limits<uint64_t>::max(),
+                               dispatcher,
+                               [&f, &dispatcher, block]() {
+                                 dispatcher.Emit([&f, block](const auto& row) { f(block, row); });
+                               });
+        }
+      } catch (...) {
+        errors[thread_index] = std::current_exception();
+        next_block = end_block;
+      }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1u; i < errors.size(); ++i) {
+      workers.emplace_back(thread_function, i);
+    }
+    thread_function(0u);
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+    return total;
+  }
+
+ private:
+  const uint8_t* const data_;
+  compact_tsv_v2::Footer footer_;
+  std::vector<uint64_t> block_offsets_;  // The offsets of the blocks, and then the offset of the block index.
+
+  // The position within the runs of one column of the block being decoded.
+  struct column_cursor_t {
+    const uint8_t* p;
+    uint64_t runs_left;
+    uint64_t run_left;
+  };
+
+  // Decodes the rows of the block into `dispatcher`, and calls `emit()` for at most `max_rows` of them, after skipping
+  // the first `skip` ones. Returns the number of rows emitted.
+  template <typename DISPATCHER, typename EMIT>
+  uint64_t DecodeBlock(size_t block, uint64_t skip, uint64_t max_rows, DISPATCHER& dispatcher, EMIT&& emit) const {
+    const uint8_t* p = data_ + block_offsets_[block];
+    const uint8_t* const end = data_ + block_offsets_[block + 1u];
+    const uint64_t rows = compact_tsv_v2::ReadVarint(p, end);
+    if (rows != std::min(footer_.rows_per_block, footer_.rows - block * footer_.rows_per_block)) {
+      CURRENT_THROW(CompactTSVMalformedInputException("invalid number of rows in a block"));
+    }
+    const uint64_t strings = compact_tsv_v2::ReadVarint(p, end);
+    if (strings > static_cast<uint64_t>(end - p)) {
+      CURRENT_THROW(CompactTSVMalformedInputException("invalid dictionary"));
+    }
+    std::vector<std::pair<const char*, size_t>> dictionary(static_cast<size_t>(strings));
+    for (auto& s : dictionary) {
+      const uint64_t length = compact_tsv_v2::ReadVarint(p, end);
+      if (length >= static_cast<uint64_t>(end - p) || p[length]) {
+        CURRENT_THROW(CompactTSVMalformedInputException("invalid dictionary"));
+      }
+      s = std::make_pair(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+      p += length + 1u;
+    }
+    std::vector<column_cursor_t> columns(Dim());
+    for (column_cursor_t& column : columns) {
+      column.runs_left = compact_tsv_v2::ReadVarint(p, end);
+      column.run_left = 0u;
+      column.p = p;
+      for (uint64_t i = 0u; i < column.runs_left * 2u; ++i) {
+        compact_tsv_v2::ReadVarint(p, end);
+      }
+    }
+    if (p != end) {
+      CURRENT_THROW(CompactTSVMalformedInputException("trailing data in a block"));
+    }
+    uint64_t emitted = 0u;
+    for (uint64_t row = 0u; row < rows && emitted < max_rows; ++row) {
+      for (size_t i = 0u; i < columns.size(); ++i) {
+        column_cursor_t& column = columns[i];
+        if (!column.run_left) {
+          if (!column.runs_left) {
+            CURRENT_THROW(CompactTSVMalformedInputException("invalid column"));
+          }
+          --column.runs_left;
+          column.run_left = compact_tsv_v2::ReadVarint(column.p, end);
+          const uint64_t id = compact_tsv_v2::ReadVarint(column.p, end);
+          if (!column.run_left || id >= strings) {
+            CURRENT_THROW(CompactTSVMalformedInputException("invalid column"));
+          }
+          dispatcher.Update(i, dictionary[static_cast<size_t>(id)].first, dictionary[static_cast<size_t>(id)].second);
+        }
+        --column.run_left;
+      }
+      if (row >= skip) {
+        emit();
+        ++emitted;
+      }
+    }
+    return emitted;
+  }
+};
+
+// The file mapped into memory, read-only, to unpack it with `CompactTSV2Reader`, or, where there is no `mmap()`,
+// read into memory.
+class CompactTSV2File final {
+ public:
+  explicit CompactTSV2File(const std::string& file_name) {
+#ifndef CURRENT_WINDOWS
+    fd_ = ::open(file_name.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd_ < 0 || ::fstat(fd_, &info)) {
+      Close();
+      CURRENT_THROW(current::FileException(file_name));
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_) {
+      void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+      if (mapped == MAP_FAILED) {
+        Close();
+        CURRENT_THROW(current::FileException(file_name));
+      }
+      data_ = reinterpret_cast<const char*>(mapped);
+    }
+#else
+    contents_ = current::FileSystem::ReadFileAsString(file_name);
+    data_ = contents_.data();
+    size_ = contents_.length();
+#endif  // CURRENT_WINDOWS
+  }
+
+  ~CompactTSV2File() {
+#ifndef CURRENT_WINDOWS
+    if (data_) {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+    Close();
+#endif  // CURRENT_WINDOWS
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+#ifndef CURRENT_WINDOWS
+  // Also called from the constructor before it throws, as the destructor is not called then.
+  void Close() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  int fd_ = -1;
+#else
+  std::string contents_;
+#endif  // CURRENT_WINDOWS
+  const char* data_ = nullptr;
+  size_t size_ = 0u;
+
+  CompactTSV2File(const CompactTSV2File&) = delete;
+  CompactTSV2File& operator=(const CompactTSV2File&) = delete;
+};
+
+#endif  // COMPACTTSV_COMPACTTSV_V2_H
@@ -26,15 +26,33 @@ SOFTWARE.
 #include <string>
 
 #include "compact_tsv.h"
+#include "compact_tsv_v2.h"
 
+#include "../bricks/dflags/dflags.h"
 #include "../bricks/strings/split.h"
 
-int main() {
+DEFINE_string(format, "v1", "The format to pack into, v1 or v2. The v2 one is written block by block, as it goes.");
+DEFINE_size_t(rows_per_block, CompactTSV2::kDefaultRowsPerBlock, "The number of rows per block, for the v2 format.");
+
+int main(int argc, char** argv) {
+  ParseDFlags(&argc, &argv);
+
   std::string row_as_string;
-  CompactTSV compact;
-  while (std::getline(std::cin, row_as_string)) {
-    compact(current::strings::Split(row_as_string, '\t', current::strings::EmptyFields::Keep));
+  if (FLAGS_format == "v1") {
+    CompactTSV compact;
+    while (std::getline(std::cin, row_as_string)) {
+      compact(current::strings::Split(row_as_string, '\t', current::strings::EmptyFields::Keep));
+    }
+    compact.Finalize();
+    std::cout << compact.GetPackedString();
+  } else if (FLAGS_format == "v2") {
+    CompactTSV2 compact(std::cout, FLAGS_rows_per_block);
+    while (std::getline(std::cin, row_as_string)) {
+      compact(current::strings::Split(row_as_string, '\t', current::strings::EmptyFields::Keep));
+    }
+    compact.Finalize();
+  } else {
+    std::cerr << "The `--format` flag must be 'v1' or 'v2'." << std::endl;
+    return -1;
   }
-  compact.Finalize();
-  std::cout << compact.GetPackedString();
 }
@@ -25,7 +25,10 @@ SOFTWARE.
 // TODO(batman): Test all exceptions.
 // TODO(batman): Test '\0'-s within input strings.
 
+#include <cstring>
+
 #include "compact_tsv.h"
+#include "compact_tsv_v2.h"
 #include "gen.h"
 
 #include "../bricks/time/chrono.h"
@@ -125,3 +128,265 @@ TEST(CompactTSV, Smoke) {
     // LCOV_EXCL_STOP
   }
 }
+
+namespace compact_tsv_test {
+
+inline std::vector<std::vector<std::string>> GenerateRows(size_t rows, size_t cols) {
+  std::vector<std::vector<std::string>> result;
+  CreateTSV([&result](const std::vector<size_t>& row) {
+    std::vector<std::string> row_of_strings(row.size());
+    for (size_t i = 0; i < row.size(); ++i) {
+      row_of_strings[i] = current::ToString(row[i] / 3u);
+    }
+    result.push_back(row_of_strings);
+  }, rows, cols, 5.0, 42);
+  return result;
+}
+
+inline std::string PackV2(const std::vector<std::vector<std::string>>& rows, size_t rows_per_block) {
+  std::ostringstream os;
+  CompactTSV2 packer(os, rows_per_block);
+  for (const auto& row : rows) {
+    packer(row);
+  }
+  packer.Finalize();
+  EXPECT_EQ(rows.size(), packer.Rows());
+  return os.str();
+}
+
+}  // namespace compact_tsv_test
+
+TEST(CompactTSV, V2RoundTrip) {
+  using namespace compact_tsv_test;
+  const auto rows = GenerateRows(1000u, 7u);
+  for (size_t rows_per_block : {1u, 3u, 64u, 1000u, 5000u}) {
+    const std::string packed = PackV2(rows, rows_per_block);
+    ASSERT_TRUE(CompactTSV2Reader::IsCompactTSV2(packed));
+    const CompactTSV2Reader reader(packed);
+    EXPECT_EQ(7u, reader.Dim());
+    EXPECT_EQ(1000u, reader.Rows());
+    EXPECT_EQ((1000u + rows_per_block - 1u) / rows_per_block, reader.Blocks());
+
+    std::vector<std::vector<std::string>> unpacked;
+    EXPECT_EQ(1000u, reader.Unpack([&unpacked](const std::vector<std::string>& row) { unpacked.push_back(row); }));
+    EXPECT_TRUE(rows == unpacked);
+
+    // The other types of the rows.
+    size_t i = 0u;
+    reader.Unpack([&](const std::vector<const char*>& row) {
+      ASSERT_EQ(7u, row.size());
+      EXPECT_EQ(rows[i][6], row[6]);
+      ++i;
+    });
+    i = 0u;
+    reader.Unpack([&](const std::vector<std::pair<const char*, size_t>>& row) {
+      EXPECT_EQ(rows[i][0], std::string(row[0].first, row[0].second));
+      ++i;
+    });
+    i = 0u;
+    reader.Unpack([&](const std::vector<current::strings::UniqueChunk>& row) {
+      EXPECT_EQ(rows[i][3], std::string(row[3].c_str(), row[3].length()));
+      ++i;
+    });
+    EXPECT_EQ(1000u, i);
+  }
+}
+
+TEST(CompactTSV, V2RandomAccess) {
+  using namespace compact_tsv_test;
+  const auto rows = GenerateRows(100u, 3u);
+  const std::string packed = PackV2(rows, 7u);
+  const CompactTSV2Reader reader(packed);
+  for (uint64_t from_row = 0u; from_row <= 101u; ++from_row) {
+    for (uint64_t max_rows : {0u, 1u, 6u, 7u, 8u, 1000u}) {
+      std::vector<std::vector<std::string>> unpacked;
+      const uint64_t count = reader.Unpack(
+          [&unpacked](const std::vector<std::string>& row) { unpacked.push_back(row); }, from_row, max_rows);
+      const uint64_t expected = std::min<uint64_t>(max_rows, from_row < 100u ? 100u - from_row : 0u);
+      ASSERT_EQ(expected, count);
+      ASSERT_EQ(expected, unpacked.size());
+      for (size_t i = 0u; i < unpacked.size(); ++i) {
+        EXPECT_TRUE(rows[from_row + i] == unpacked[i]);
+      }
+    }
+  }
+}
+
+TEST(CompactTSV, V2ParallelUnpack) {
+  using namespace compact_tsv_test;
+  const auto rows = GenerateRows(10000u, 5u);
+  const std::string packed = PackV2(rows, 100u);
+  const CompactTSV2Reader reader(packed);
+  for (size_t threads : {1u, 2u, 8u}) {
+    std::vector<std::vector<std::vector<std::string>>> blocks(reader.Blocks());
+    EXPECT_EQ(10000u, reader.ParallelUnpack([&blocks](size_t block, const std::vector<std::string>& row) {
+      blocks[block].push_back(row);
+    }, threads));
+    std::vector<std::vector<std::string>> unpacked;
+    for (const auto& block : blocks) {
+      unpacked.insert(unpacked.end(), block.begin(), block.end());
+    }
+    EXPECT_TRUE(rows == unpacked);
+  }
+  std::atomic<size_t> count(0u);
+  EXPECT_EQ(300u, reader.ParallelUnpack([&count](size_t, const std::vector<const char*>&) { ++count; }, 4u, 10u, 13u));
+  EXPECT_EQ(300u, count);
+}
+
+TEST(CompactTSV, V2WideTypes) {
+  // More than 254 columns, strings longer than 64KB, and strings with '\0'-s in them, none of which v1 can pack.
+  std::vector<std::vector<std::string>> rows(3u, std::vector<std::string>(1000u));
+  for (size_t i = 0u; i < 1000u; ++i) {
+    rows[0][i] = current::ToString(i);
+    rows[1][i] = (i % 2u) ? rows[0][i] : std::string("with\0null", 9u);
+    rows[2][i] = (i == 500u) ? std::string(100000u, 'x') : "";
+  }
+  const std::string packed = compact_tsv_test::PackV2(rows, 2u);
+  const CompactTSV2Reader reader(packed);
+  EXPECT_EQ(1000u, reader.Dim());
+  std::vector<std::vector<std::string>> unpacked;
+  reader.Unpack([&unpacked](const std::vector<std::string>& row) { unpacked.push_back(row); });
+  EXPECT_TRUE(rows == unpacked);
+  EXPECT_EQ(9u, unpacked[1][0].length());
+  EXPECT_EQ(100000u, unpacked[2][500].length());
+}
+
+TEST(CompactTSV, V2Exceptions) {
+  using namespace compact_tsv_test;
+  {
+    std::ostringstream os;
+    CompactTSV2 packer(os);
+    packer({"a", "b"});
+    ASSERT_THROW(packer({"a"}), CompactTSVInconsistentRowException);
+  }
+  {
+    // No rows at all is fine.
+    std::ostringstream os;
+    CompactTSV2 packer(os);
+    packer.Finalize();
+    const CompactTSV2Reader reader(os.str());
+    EXPECT_EQ(0u, reader.Rows());
+    EXPECT_EQ(0u, reader.Unpack([](const std::vector<std::string>&) {}));
+  }
+  const std::string packed = PackV2(GenerateRows(100u, 3u), 10u);
+  ASSERT_THROW(CompactTSV2Reader(""), CompactTSVMalformedInputException);
+  ASSERT_THROW(CompactTSV2Reader(packed.substr(0u, packed.length() - 1u)), CompactTSVMalformedInputException);
+  ASSERT_THROW(CompactTSV2Reader(packed.substr(1u)), CompactTSVMalformedInputException);
+  {
+    // A corrupted block is detected when it is unpacked.
+    std::string corrupted = packed;
+    corrupted[9] = static_cast<char>(0x7f);
+    const CompactTSV2Reader reader(corrupted);
+    ASSERT_THROW(reader.Unpack([](const std::vector<std::string>&) {}), CompactTSVMalformedInputException);
+    ASSERT_THROW(reader.ParallelUnpack([](size_t, const std::vector<std::string>&) {}, 2u),
+                 CompactTSVMalformedInputException);
+    EXPECT_EQ(10u, reader.Unpack([](const std::vector<std::string>&) {}, 50u, 10u));
+  }
+  {
+    // The number of columns, the first field of the footer, is checked against the blocks before it is allocated for.
+    std::string corrupted = packed;
+    const uint64_t dim = static_cast<uint64_t>(1u) << 60;
+    std::memcpy(&corrupted[corrupted.length() - sizeof(compact_tsv_v2::Footer)], &dim, sizeof(dim));
+    ASSERT_THROW(CompactTSV2Reader reader(corrupted), CompactTSVMalformedInputException);
+  }
+#ifndef CURRENT_WINDOWS
+  {
+    // A directory can be opened, but not mapped into memory, and the file descriptor is closed all the same.
+    const int probe = ::open(".", O_RDONLY);
+    ASSERT_GE(probe, 0);
+    ::close(probe);
+    ASSERT_THROW(CompactTSV2File file("."), current::FileException);
+    const int next = ::open(".", O_RDONLY);
+    EXPECT_EQ(probe, next);
+    ::close(next);
+  }
+#endif  // CURRENT_WINDOWS
+}
+
+TEST(CompactTSV, UnpackColumns) {
+  using namespace compact_tsv_test;
+  const auto rows = GenerateRows(1000u, 9u);
+  CompactTSV packer;
+  for (const auto& row : rows) {
+    packer(row);
+  }
+  packer.Finalize();
+  const std::string& packed = packer.GetPackedString();
+
+  for (const std::vector<size_t>& columns : std::vector<std::vector<size_t>>{{}, {0u}, {8u}, {2u, 5u}, {5u, 2u, 5u}}) {
+    std::vector<std::vector<std::string>> unpacked;
+    EXPECT_EQ(1000u,
+              CompactTSV::UnpackColumns([&unpacked](const std::vector<current::strings::Chunk>& row) {
+                std::vector<std::string> row_of_strings;
+                for (const current::strings::Chunk& chunk : row) {
+                  row_of_strings.emplace_back(chunk.c_str(), chunk.length());
+                }
+                unpacked.push_back(row_of_strings);
+              }, columns, packed));
+    ASSERT_EQ(1000u, unpacked.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      ASSERT_EQ(columns.size(), unpacked[i].size());
+      for (size_t j = 0; j < columns.size(); ++j) {
+        EXPECT_EQ(rows[i][columns[j]], unpacked[i][j]);
+      }
+    }
+  }
+
+  ASSERT_THROW(CompactTSV::UnpackColumns([](const std::vector<current::strings::Chunk>&) {}, {9u}, packed),
+               CompactTSVUnknownColumnException);
+  ASSERT_THROW(CompactTSV::UnpackColumns([](const std::vector<current::strings::Chunk>&) {}, {1000u}, packed),
+               CompactTSVUnknownColumnException);
+  ASSERT_THROW(CompactTSV::UnpackColumns([](const std::vector<current::strings::Chunk>&) {},
+                                         {0u},
+                                         packed.substr(0u, packed.length() - 3u)),
+               CompactTSVMalformedInputException);
+}
+
+TEST(CompactTSV, UnpackColumnsByName) {
+  CompactTSV packer;
+  packer({"name", "age", "city"});
+  packer({"alice", "30", "paris"});
+  packer({"bob", "30", "paris"});
+  packer({"carol", "25", "london"});
+  packer.Finalize();
+  const std::string& packed = packer.GetPackedString();
+
+  EXPECT_EQ(std::vector<std::string>({"name", "age", "city"}), CompactTSV::Header(packed));
+
+  std::string result;
+  EXPECT_EQ(3u, CompactTSV::UnpackColumnsByName([&result](const std::vector<current::strings::Chunk>& row) {
+    ASSERT_EQ(2u, row.size());
+    result += std::string(row[0].c_str()) + '=' + row[1].c_str() + ';';
+  }, {"city", "name"}, packed));
+  EXPECT_EQ("paris=alice;paris=bob;london=carol;", result);
+
+  ASSERT_THROW(CompactTSV::UnpackColumnsByName([](const std::vector<current::strings::Chunk>&) {}, {"zip"}, packed),
+               CompactTSVUnknownColumnException);
+  ASSERT_THROW(CompactTSV::Header(""), CompactTSVMalformedInputException);
+
+  // The strings referred to past the end of the data, or running past it, are caught. The first string is stored
+  // as its marker, its length, and "name" with the null character, followed by the first update, of column zero.
+  ASSERT_EQ(0, packed[8]);
+  const auto with_first_offset = [&packed](uint32_t offset) {
+    std::string result = packed;
+    std::memcpy(&result[9], &offset, sizeof(offset));
+    return result;
+  };
+  for (uint32_t offset : {static_cast<uint32_t>(packed.length()),
+                          static_cast<uint32_t>(packed.length() - 1u),
+                          static_cast<uint32_t>(-1)}) {
+    ASSERT_THROW(CompactTSV::Header(with_first_offset(offset)), CompactTSVMalformedInputException) << offset;
+    ASSERT_THROW(CompactTSV::UnpackColumns(
+                     [](const std::vector<current::strings::Chunk>&) {}, {0u}, with_first_offset(offset)),
+                 CompactTSVMalformedInputException)
+        << offset;
+  }
+  // The last two bytes are the high byte of an offset and the end of row marker, so the length read there is too big.
+  ASSERT_EQ(static_cast<char>(0xfe), packed.back());
+  ASSERT_THROW(CompactTSV::Header(with_first_offset(static_cast<uint32_t>(packed.length() - 2u))),
+               CompactTSVMalformedInputException);
+  ASSERT_THROW(CompactTSV::UnpackColumns([](const std::vector<current::strings::Chunk>&) {},
+                                         {0u},
+                                         with_first_offset(static_cast<uint32_t>(packed.length() - 2u))),
+               CompactTSVMalformedInputException);
+}
@@ -23,22 +23,36 @@ SOFTWARE.
 *******************************************************************************/
 
 #include <iostream>
+#include <limits>
 #include <string>
 
 #include "compact_tsv.h"
+#include "compact_tsv_v2.h"
 
 #include "../bricks/dflags/dflags.h"
-#include "../bricks/file/file.h"
 #include "../bricks/strings/join.h"
 
 DEFINE_string(input, "", "Input file to parse.");
+DEFINE_uint64(from_row, 0u, "The first row to unpack. The v2 format seeks to it right away.");
+DEFINE_uint64(rows, std::numeric_limits<uint64_t>::max(), "The maximum number of rows to unpack.");
 
 int main(int argc, char** argv) {
   ParseDFlags(&argc, &argv);
 
   CURRENT_ASSERT(!FLAGS_input.empty());
-  const auto contents = current::FileSystem::ReadFileAsString(FLAGS_input);
-
-  CompactTSV::Unpack(
-      [](const std::vector<std::string>& v) { std::cout << current::strings::Join(v, '\t') << std::endl; }, contents);
+  const CompactTSV2File file(FLAGS_input);
+
+  const auto f = [](const std::vector<std::string>& v) { std::cout << current::strings::Join(v, '\t') << std::endl; };
+  if (CompactTSV2Reader::IsCompactTSV2(file.data(), file.size())) {
+    CompactTSV2Reader(file.data(), file.size()).Unpack(f, FLAGS_from_row, FLAGS_rows);
+  } else {
+    uint64_t row = 0u;
+    const uint64_t end = FLAGS_from_row + std::min(FLAGS_rows, std::numeric_limits<uint64_t>::max() - FLAGS_from_row);
+    CompactTSV::Unpack([&row, &f, end](const std::vector<std::string>& v) {
+      if (row >= FLAGS_from_row && row < end) {
+        f(v);
+      }
+      ++row;
+    }, reinterpret_cast<const uint8_t*>(file.data()), file.size());
+  }
 }
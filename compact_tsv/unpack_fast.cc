@@ -26,26 +26,49 @@ SOFTWARE.
 #include <string>
 
 #include "compact_tsv.h"
+#include "compact_tsv_v2.h"
 
 #include "../bricks/dflags/dflags.h"
-#include "../bricks/file/file.h"
-#include "../bricks/strings/join.h"
 
 DEFINE_string(input, "", "Input file to parse.");
+DEFINE_size_t(threads, 1u, "The number of threads to unpack the blocks of the v2 format in.");
 
 int main(int argc, char** argv) {
   ParseDFlags(&argc, &argv);
 
   CURRENT_ASSERT(!FLAGS_input.empty());
-  const auto contents = current::FileSystem::ReadFileAsString(FLAGS_input);
+  const CompactTSV2File file(FLAGS_input);
 
-  CompactTSV::Unpack([](const std::vector<std::pair<const char*, size_t>>& v) {
-    for (size_t i = 0; i < v.size(); ++i) {
-      if (i) {
-        fputc('\t', stdout);
+  if (CompactTSV2Reader::IsCompactTSV2(file.data(), file.size())) {
+    // Unpack a few blocks per thread at a time, each into its own buffer, and output the buffers in order.
+    const CompactTSV2Reader reader(file.data(), file.size());
+    const size_t blocks_at_a_time = std::max(FLAGS_threads, static_cast<size_t>(1u)) * 4u;
+    std::vector<std::string> buffers(blocks_at_a_time);
+    for (size_t begin = 0u; begin < reader.Blocks(); begin += blocks_at_a_time) {
+      reader.ParallelUnpack([&buffers, begin](size_t block, const std::vector<std::pair<const char*, size_t>>& v) {
+        std::string& buffer = buffers[block - begin];
+        for (size_t i = 0; i < v.size(); ++i) {
+          if (i) {
+            buffer += '\t';
+          }
+          buffer.append(v[i].first, v[i].second);
+        }
+        buffer += '\n';
+      }, FLAGS_threads, begin, begin + blocks_at_a_time);
+      for (std::string& buffer : buffers) {
+        fwrite(buffer.data(), 1, buffer.length(), stdout);
+        buffer.clear();
       }
-      fwrite(v[i].first, 1, v[i].second, stdout);
     }
-    fputc('\n', stdout);
-  }, contents);
+  } else {
+    CompactTSV::Unpack([](const std::vector<std::pair<const char*, size_t>>& v) {
+      for (size_t i = 0; i < v.size(); ++i) {
+        if (i) {
+          fputc('\t', stdout);
+        }
+        fwrite(v[i].first, 1, v[i].second, stdout);
+      }
+      fputc('\n', stdout);
+    }, reinterpret_cast<const uint8_t*>(file.data()), file.size());
+  }
 }
@@ -22,23 +22,32 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 *******************************************************************************/
 
+#include <atomic>
 #include <iostream>
 #include <string>
 
 #include "compact_tsv.h"
+#include "compact_tsv_v2.h"
 
 #include "../bricks/dflags/dflags.h"
-#include "../bricks/file/file.h"
 
 DEFINE_string(input, "", "Input file to parse.");
+DEFINE_size_t(threads, 1u, "The number of threads to unpack the blocks of the v2 format in.");
 
 int main(int argc, char** argv) {
   ParseDFlags(&argc, &argv);
 
   CURRENT_ASSERT(!FLAGS_input.empty());
-  const auto contents = current::FileSystem::ReadFileAsString(FLAGS_input);
-
-  size_t count = 0u;
-  CompactTSV::Unpack([&count](const std::vector<const char*>&) { ++count; }, contents);
+  const CompactTSV2File file(FLAGS_input);
+
+  std::atomic<size_t> count(0u);
+  if (CompactTSV2Reader::IsCompactTSV2(file.data(), file.size())) {
+    CompactTSV2Reader(file.data(), file.size())
+        .ParallelUnpack([&count](size_t, const std::vector<const char*>&) { ++count; }, FLAGS_threads);
+  } else {
+    CompactTSV::Unpack([&count](const std::vector<const char*>&) { ++count; },
+                       reinterpret_cast<const uint8_t*>(file.data()),
+                       file.size());
+  }
   std::cerr << count << std::endl;
 }
@@ -24,10 +24,14 @@ SOFTWARE.
 
 #include "../../../current.h"
 
+#include "scenario_compact_tsv.h"
 #include "scenario_golden_1k_qps.h"
 #include "scenario_json.h"
+#include "scenario_replay.h"
+#include "scenario_serialization.h"
 #include "scenario_simple_http.h"
 #include "scenario_storage.h"
+#include "scenario_storage_containers.h"
 #include "scenario_nginx_client.h"
 #include "scenario_replication.h"
 
@@ -0,0 +1,102 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef EXAMLPES_BENCHMARK_GENERIC_SCENARIO_COMPACT_TSV_H
+#define EXAMLPES_BENCHMARK_GENERIC_SCENARIO_COMPACT_TSV_H
+
+#include "../../../port.h"
+
+#include <iomanip>
+
+#include "benchmark.h"
+
+#include "../../../compact_tsv/compact_tsv.h"
+#include "../../../compact_tsv/gen.h"
+
+#include "../../../bricks/dflags/dflags.h"
+
+#ifndef CURRENT_MAKE_CHECK_MODE
+DEFINE_size_t(compact_tsv_rows, 1000000u, "The number of rows of the TSV to unpack.");
+DEFINE_size_t(compact_tsv_cols, 40u, "The number of columns of the TSV to unpack.");
+DEFINE_string(compact_tsv_projection, "all", "The number of the columns to unpack, or `all` to unpack the rows whole.");
+#else
+DECLARE_size_t(compact_tsv_rows);
+DECLARE_size_t(compact_tsv_cols);
+DECLARE_string(compact_tsv_projection);
+#endif
+
+// Unpacks the TSV packed with `CompactTSV`, whole, or only the first `--compact_tsv_projection` columns of it, with
+// `CompactTSV::UnpackColumns()`, and reports the rows per second of each unpack.
+SCENARIO(compact_tsv, "Unpack the rows of the packed TSV, whole or only some of their columns.") {
+  std::string packed;
+  bool all;
+  std::vector<size_t> columns;
+
+  compact_tsv() : all(FLAGS_compact_tsv_projection == "all") {
+    if (!all) {
+      const size_t projection = current::FromString<size_t>(FLAGS_compact_tsv_projection);
+      if (projection > FLAGS_compact_tsv_cols) {
+        std::cerr << "The `--compact_tsv_projection` flag must be `all` or at most `--compact_tsv_cols`." << std::endl;
+        CURRENT_ASSERT(false);
+      }
+      for (size_t i = 0; i < projection; ++i) {
+        columns.push_back(i);
+      }
+    }
+    CompactTSV packer;
+    CreateTSV([&packer](const std::vector<size_t>& row) {
+      std::vector<std::string> row_of_strings(row.size());
+      for (size_t i = 0; i < row.size(); ++i) {
+        row_of_strings[i] = current::ToString(row[i]);
+      }
+      packer(row_of_strings);
+    }, FLAGS_compact_tsv_rows, FLAGS_compact_tsv_cols);
+    packer.Finalize();
+    packed = packer.GetPackedString();
+  }
+
+  void RunOneQuery() override {
+    // Sum up the lengths of the values, so that unpacking them is not optimized away.
+    size_t total_length = 0u;
+    const auto begin = std::chrono::steady_clock::now();
+    const size_t rows =
+        all ? CompactTSV::Unpack([&total_length](const std::vector<std::pair<const char*, size_t>>& row) {
+          for (const auto& value : row) {
+            total_length += value.second;
+          }
+        }, packed) : CompactTSV::UnpackColumns([&total_length](const std::vector<current::strings::Chunk>& row) {
+          for (const auto& value : row) {
+            total_length += value.length();
+          }
+        }, columns, packed);
+    const double seconds = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now() - begin).count();
+    std::cout << rows << " rows, " << total_length << " bytes unpacked in " << std::fixed << std::setprecision(3)
+              << seconds << " seconds, " << std::setprecision(1) << 1e-6 * rows / seconds << "M rows/s." << std::endl;
+  }
+};
+
+REGISTER_SCENARIO(compact_tsv);
+
+#endif  // EXAMLPES_BENCHMARK_GENERIC_SCENARIO_COMPACT_TSV_H
@@ -0,0 +1,176 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef EXAMLPES_BENCHMARK_GENERIC_SCENARIO_REPLAY_H
+#define EXAMLPES_BENCHMARK_GENERIC_SCENARIO_REPLAY_H
+
+#include "../../../port.h"
+
+#include <fstream>
+#include <iomanip>
+
+#include "benchmark.h"
+
+#include "../../../blocks/persistence/file.h"
+#include "../../../bricks/file/file.h"
+#include "../../../bricks/strings/scan.h"
+#include "../../../typesystem/struct.h"
+#include "../../../typesystem/serialization/json.h"
+
+#include "../../../bricks/dflags/dflags.h"
+
+#ifndef CURRENT_MAKE_CHECK_MODE
+DEFINE_string(replay_file, ".current/replay.stream", "The stream file to replay, generated if it does not exist.");
+DEFINE_uint64(replay_megabytes, 1024u, "The size of the stream file to generate, in megabytes.");
+DEFINE_string(replay_scan, "best", "How to find the lines, best/avx2/sse2/scalar, or getline, as it used to be.");
+DEFINE_bool(replay_entries, false, "Also parse each entry, as the storage does, not just the index and the timestamp.");
+#else
+DECLARE_string(replay_file);
+DECLARE_uint64(replay_megabytes);
+DECLARE_string(replay_scan);
+DECLARE_bool(replay_entries);
+#endif
+
+namespace replay_benchmark {
+
+CURRENT_STRUCT(ReplayEntry) {
+  CURRENT_FIELD(key, uint64_t);
+  CURRENT_FIELD(user, std::string);
+  CURRENT_FIELD(tags, std::vector<std::string>);
+  CURRENT_FIELD(values, std::vector<int32_t>);
+  CURRENT_FIELD(score, double);
+  CURRENT_FIELD(comment, Optional<std::string>);
+};
+
+}  // namespace replay_benchmark
+
+// Replays the stream file, of about 200-byte entries, end to end, as `FilePersister` does at startup, and reports
+// the gigabytes per second of each replay. Run with `--seconds=0` to replay the file once per thread.
+SCENARIO(replay, "Replay the stream file, validating the index and the timestamp of each entry.") {
+  using entry_t = replay_benchmark::ReplayEntry;
+
+  uint64_t file_size;
+
+  static void GenerateFile() {
+    std::cout << "Generating `" << FLAGS_replay_file << "`, " << FLAGS_replay_megabytes << "MB ..." << std::flush;
+    std::ofstream fo(FLAGS_replay_file);
+    std::string block;
+    uint64_t total = 0u;
+    const uint64_t total_bytes = FLAGS_replay_megabytes << 20;
+    for (uint64_t index = 0u; total < total_bytes; ++index) {
+      entry_t entry;
+      entry.key = index * 2654435761u;
+      entry.user = "user_" + current::ToString(index % 100000u);
+      entry.tags = {"replay", index % 3u ? "\"quoted\"" : "plain", "tag_" + current::ToString(index % 7u)};
+      for (int32_t i = 0; i < static_cast<int32_t>(index % 16u); ++i) {
+        entry.values.push_back(i * 1000 - static_cast<int32_t>(index % 1000u));
+      }
+      entry.score = static_cast<double>(index % 1000u) / 7.0;
+      if (index % 2u) {
+        entry.comment = "Line\twith\ttabs and a \\ backslash, " + current::ToString(index);
+      }
+      block += JSON(idxts_t(index, std::chrono::microseconds(1000000000000ll + static_cast<int64_t>(index) * 10))) +
+               '\t' + JSON(entry) + '\n';
+      if (block.length() >= (1u << 20)) {
+        fo << block;
+        total += block.length();
+        block.clear();
+      }
+    }
+    fo << block;
+    std::cout << " Done." << std::endl;
+  }
+
+  replay() {
+    if (FLAGS_replay_scan == "avx2") {
+      current::strings::DefaultScanInstructionSet() = current::strings::ScanInstructionSet::AVX2;
+    } else if (FLAGS_replay_scan == "sse2") {
+      current::strings::DefaultScanInstructionSet() = current::strings::ScanInstructionSet::SSE2;
+    } else if (FLAGS_replay_scan == "scalar") {
+      current::strings::DefaultScanInstructionSet() = current::strings::ScanInstructionSet::Scalar;
+    } else if (FLAGS_replay_scan != "best" && FLAGS_replay_scan != "getline") {
+      std::cerr << "The `--replay_scan` flag must be 'best', 'avx2', 'sse2', 'scalar', or 'getline'." << std::endl;
+      CURRENT_ASSERT(false);
+    }
+    if (!current::strings::IsScanInstructionSetSupported(current::strings::DefaultScanInstructionSet())) {
+      std::cerr << "The `--replay_scan=" << FLAGS_replay_scan << "` is not supported by this CPU." << std::endl;
+      CURRENT_ASSERT(false);
+    }
+    std::ifstream fi(FLAGS_replay_file);
+    if (!fi.good()) {
+      GenerateFile();
+    }
+    file_size = current::FileSystem::GetFileSize(FLAGS_replay_file);
+  }
+
+  // The lines are read with `std::getline()`, and the index and the timestamp are parsed with `ParseJSON()`.
+  uint64_t ReplayWithGetline() {
+    std::ifstream fi(FLAGS_replay_file);
+    std::string line;
+    uint64_t next_index = 0u;
+    while (std::getline(fi, line)) {
+      if (line[0] != '#') {
+        const size_t tab_pos = line.find('\t');
+        CURRENT_ASSERT(tab_pos != std::string::npos);
+        const auto idxts = ParseJSON<idxts_t>(line.substr(0, tab_pos));
+        CURRENT_ASSERT(idxts.index == next_index);
+        if (FLAGS_replay_entries) {
+          ParseJSON<entry_t>(line.c_str() + tab_pos + 1);
+        }
+        ++next_index;
+      }
+    }
+    return next_index;
+  }
+
+  uint64_t ReplayWithIterator() {
+    std::ifstream fi(FLAGS_replay_file);
+    current::persistence::impl::IteratorOverFileOfPersistedEntries<entry_t> cit(fi, 0, 0u);
+    uint64_t entries = 0u;
+    while (cit.ProcessNextEntry(
+        [&entries](const idxts_t&, const char* json) {
+          if (FLAGS_replay_entries) {
+            ParseJSON<entry_t>(json);
+          }
+          ++entries;
+        },
+        [](const std::string&) {})) {
+      ;
+    }
+    return entries;
+  }
+
+  void RunOneQuery() override {
+    const auto begin = std::chrono::steady_clock::now();
+    const uint64_t entries = (FLAGS_replay_scan == "getline") ? ReplayWithGetline() : ReplayWithIterator();
+    const double seconds = 1e-6 * std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now() - begin).count();
+    std::cout << entries << " entries, " << file_size << " bytes in " << std::fixed << std::setprecision(2) << seconds
+              << " seconds, " << 1e-9 * file_size / seconds << " GB/s." << std::endl;
+  }
+};
+
+REGISTER_SCENARIO(replay);
+
+#endif  // EXAMLPES_BENCHMARK_GENERIC_SCENARIO_REPLAY_H
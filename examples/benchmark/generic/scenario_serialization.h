@@ -0,0 +1,124 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef EXAMLPES_BENCHMARK_GENERIC_SCENARIO_SERIALIZATION_H
+#define EXAMLPES_BENCHMARK_GENERIC_SCENARIO_SERIALIZATION_H
+
+#include "../../../port.h"
+
+#include "../../../typesystem/struct.h"
+#include "../../../typesystem/variant.h"
+#include "../../../typesystem/serialization/binary.h"
+#include "../../../typesystem/serialization/json.h"
+
+#include "benchmark.h"
+
+#include "../../../bricks/dflags/dflags.h"
+
+#ifndef CURRENT_MAKE_CHECK_MODE
+DEFINE_string(serialization_format, "binary", "The format to test, json/binary.");
+DEFINE_string(serialization_op, "gen", "The action to take in the performance test, gen/parse/both.");
+#else
+DECLARE_string(serialization_format);
+DECLARE_string(serialization_op);
+#endif
+
+// The smoke test struct, the golden schema of which is `typesystem/schema/golden/smoke_test_struct.*`.
+#define SMOKE_TEST_STRUCT_NAMESPACE serialization_benchmark
+#include "../../../typesystem/schema/smoke_test_struct.h"
+#undef SMOKE_TEST_STRUCT_NAMESPACE
+
+SCENARIO(serialization, "JSON vs. binary serialization of the smoke test struct.") {
+  serialization_benchmark::FullTest test_object;
+  std::string test_object_serialized;
+  std::function<void()> f;
+
+  // Populated as `typesystem/schema/serialized/smoke_test_struct.json` is, plus the variants it leaves uninitialized,
+  // and a few more elements.
+  static serialization_benchmark::FullTest MakeTestObject() {
+    using namespace serialization_benchmark;
+    FullTest result{B2()};
+    C c{A()};
+    c.d = Variant<A, X, Y>(Y());
+    result.q = c;
+    result.w2.bar = X();
+    result.w5.meh = Y();
+    result.v1 = {"one", "two", "three"};
+    result.v2.resize(3u);
+    result.o = Primitives();
+    result.tsc.o3 = std::vector<std::string>({"foo", "bar"});
+    result.tsc.o7["baz"] = A();
+    return result;
+  }
+
+  serialization() : test_object(MakeTestObject()) {
+    // `FullTest` has no default constructor, so the objects are parsed into, as they would be in the user code.
+    using serialization_benchmark::FullTest;
+    if (FLAGS_serialization_format == "json") {
+      test_object_serialized = JSON(test_object);
+      if (FLAGS_serialization_op == "gen") {
+        f = [this]() { JSON(test_object); };
+      } else if (FLAGS_serialization_op == "parse") {
+        f = [this]() {
+          FullTest result{serialization_benchmark::Empty()};
+          ParseJSON(test_object_serialized, result);
+        };
+      } else if (FLAGS_serialization_op == "both") {
+        f = [this]() {
+          FullTest result{serialization_benchmark::Empty()};
+          ParseJSON(JSON(test_object), result);
+        };
+      }
+    } else if (FLAGS_serialization_format == "binary") {
+      test_object_serialized = SaveIntoBinary(test_object);
+      if (FLAGS_serialization_op == "gen") {
+        f = [this]() { SaveIntoBinary(test_object); };
+      } else if (FLAGS_serialization_op == "parse") {
+        f = [this]() {
+          FullTest result{serialization_benchmark::Empty()};
+          LoadFromBinary(test_object_serialized, result);
+        };
+      } else if (FLAGS_serialization_op == "both") {
+        f = [this]() {
+          FullTest result{serialization_benchmark::Empty()};
+          LoadFromBinary(SaveIntoBinary(test_object), result);
+        };
+      }
+    } else {
+      std::cerr << "The `--serialization_format` flag must be 'json' or 'binary'." << std::endl;
+      CURRENT_ASSERT(false);
+    }
+    if (!f) {
+      std::cerr << "The `--serialization_op` flag must be 'gen', 'parse', or 'both'." << std::endl;
+      CURRENT_ASSERT(false);
+    }
+    std::cout << test_object_serialized.length() << " bytes, ";
+  }
+
+  void RunOneQuery() override { f(); }
+};
+
+REGISTER_SCENARIO(serialization);
+
+#endif  // EXAMLPES_BENCHMARK_GENERIC_SCENARIO_SERIALIZATION_H
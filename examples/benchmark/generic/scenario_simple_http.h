@@ -40,11 +40,15 @@ DEFINE_string(simple_http_local_route, "/perftest", "Local route for `current_ht
 DEFINE_string(simple_http_test_body,
               "+current -nginx\n",
               "Golden HTTP body to return for the `current_http_server` scenario.");
+DEFINE_bool(simple_http_epoll, false, "Use the `epoll` HTTP server engine, which keeps the connections alive.");
+DEFINE_bool(simple_http_keep_alive, true, "Reuse the connections kept alive by the server.");
 #else
 DECLARE_uint16(simple_http_local_port);
 DECLARE_uint16(simple_http_local_top_port);
 DECLARE_string(simple_http_local_route);
 DECLARE_string(simple_http_test_body);
+DECLARE_bool(simple_http_epoll);
+DECLARE_bool(simple_http_keep_alive);
 #endif
 
 SCENARIO(current_http_server, "Use Current's HTTP stack for simple HTTP client-server handshake.") {
@@ -56,13 +60,15 @@ SCENARIO(current_http_server, "Use Current's HTTP stack for simple HTTP client-s
     for (uint16_t port = FLAGS_simple_http_local_port;
          port <= std::max(FLAGS_simple_http_local_top_port, FLAGS_simple_http_local_port);
          ++port) {
-      scope += HTTP(port).Register(FLAGS_simple_http_local_route, handler);
+      scope += HTTP(port, FLAGS_simple_http_epoll ? HTTPServerOptions(HTTPServerEngine::Epoll) : HTTPServerOptions())
+                   .Register(FLAGS_simple_http_local_route, handler);
       urls.push_back("localhost:" + current::strings::ToString(port) + FLAGS_simple_http_local_route);
     }
   }
 
   void RunOneQuery() override {
-    CURRENT_ASSERT(HTTP(GET(urls[rand() % urls.size()])).body == FLAGS_simple_http_test_body);
+    CURRENT_ASSERT(HTTP(GET(urls[rand() % urls.size()]).KeepAlive(FLAGS_simple_http_keep_alive)).body ==
+                   FLAGS_simple_http_test_body);
   }
 };
 
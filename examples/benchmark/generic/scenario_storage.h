@@ -39,10 +39,18 @@ SOFTWARE.
 DEFINE_uint32(storage_initial_size, 10000, "The number of records initially in the storage.");
 DEFINE_string(storage_transaction, "empty", "The transaction to run in the inner loop of the load test.");
 DEFINE_bool(storage_test_string, false, "Set to `true` to test 'get' and 'put' with string, not int, keys.");
+DEFINE_bool(storage_snapshot_reads, false, "Set to `true` to run the read-only transactions against the snapshots.");
+DEFINE_uint32(storage_mutations_per_transaction, 100, "The number of entries each 'mutations' transaction adds.");
+DEFINE_bool(storage_test_large, false, "Set to `true` to test 'mutations' with large, not small, entries.");
+DEFINE_bool(storage_rollback, false, "Set to `true` to roll back the 'mutations' transactions instead of persisting.");
 #else
 DECLARE_uint32(storage_initial_size);
 DECLARE_string(storage_transaction);
 DECLARE_bool(storage_test_string);
+DECLARE_bool(storage_snapshot_reads);
+DECLARE_uint32(storage_mutations_per_transaction);
+DECLARE_bool(storage_test_large);
+DECLARE_bool(storage_rollback);
 #endif
 
 CURRENT_STRUCT(UInt32KeyValuePair) {
@@ -58,11 +66,22 @@ CURRENT_STRUCT(StringKeyValuePair) {
       : key(std::move(key)), value(value) {}
 };
 
+// About 1.3KB of payload, to compare the cost of the mutations of large entries to that of the small ones.
+CURRENT_STRUCT(LargeKeyValuePair) {
+  CURRENT_FIELD(key, uint32_t);
+  CURRENT_FIELD(text, std::string);
+  CURRENT_FIELD(values, std::vector<uint32_t>);
+  CURRENT_CONSTRUCTOR(LargeKeyValuePair)(uint32_t key = 0, uint32_t value = 0)
+      : key(key), text(1000u, static_cast<char>('a' + value % 26u)), values(64u, value) {}
+};
+
 CURRENT_STORAGE_FIELD_ENTRY(UnorderedDictionary, UInt32KeyValuePair, PersistedUInt32KeyValuePair);
 CURRENT_STORAGE_FIELD_ENTRY(UnorderedDictionary, StringKeyValuePair, PersistedStringKeyValuePair);
+CURRENT_STORAGE_FIELD_ENTRY(UnorderedDictionary, LargeKeyValuePair, PersistedLargeKeyValuePair);
 CURRENT_STORAGE(KeyValueDB) {
   CURRENT_STORAGE_FIELD(hashmap_uint32, PersistedUInt32KeyValuePair);
   CURRENT_STORAGE_FIELD(hashmap_string, PersistedStringKeyValuePair);
+  CURRENT_STORAGE_FIELD(hashmap_large, PersistedLargeKeyValuePair);
 };
 
 struct NonSerializablePairOfTwoSizeT {
@@ -85,6 +104,7 @@ SCENARIO(storage, "Storage transactions test.") {
 
   storage() : db(storage_t::CreateMasterStorage()) {
     const bool testing_string = FLAGS_storage_test_string;
+    const bool testing_large = FLAGS_storage_test_large;
 
     std::map<std::string, std::function<void()>> tests = {
         {{"empty"}, [this]() { db->ReadOnlyTransaction([](ImmutableFields<storage_t>) {}).Wait(); }},
@@ -117,6 +137,24 @@ SCENARIO(storage, "Storage transactions test.") {
                fields.hashmap_string.Add(StringKeyValuePair(RandomString(), RandomUInt32()));
              }
            }).Wait();
+         }},
+        {{"mutations"},
+         [testing_large, this]() {
+           // Updates the entries with the keys from `[0, --storage_initial_size)`, added beforehand.
+           db->ReadWriteTransaction([testing_large](MutableFields<storage_t> fields) {
+             const uint32_t keys = std::max(FLAGS_storage_initial_size, static_cast<uint32_t>(1u));
+             for (uint32_t i = 0; i < FLAGS_storage_mutations_per_transaction; ++i) {
+               const uint32_t key = RandomUInt32() % keys;
+               if (!testing_large) {
+                 fields.hashmap_uint32.Add(UInt32KeyValuePair(key, RandomUInt32()));
+               } else {
+                 fields.hashmap_large.Add(LargeKeyValuePair(key, RandomUInt32()));
+               }
+             }
+             if (FLAGS_storage_rollback) {
+               CURRENT_STORAGE_THROW_ROLLBACK();
+             }
+           }).Wait();
          }}};
     const auto cit = tests.find(FLAGS_storage_transaction);
 
@@ -150,6 +188,22 @@ SCENARIO(storage, "Storage transactions test.") {
     if (FLAGS_storage_initial_size > 0u) {
       CURRENT_ASSERT(actual_size_string > 0u);
     }
+
+    if (FLAGS_storage_transaction == "mutations") {
+      db->ReadWriteTransaction([testing_large](MutableFields<storage_t> fields) {
+        for (uint32_t key = 0; key < FLAGS_storage_initial_size; ++key) {
+          if (!testing_large) {
+            fields.hashmap_uint32.Add(UInt32KeyValuePair(key));
+          } else {
+            fields.hashmap_large.Add(LargeKeyValuePair(key));
+          }
+        }
+      }).Wait();
+    }
+
+    if (FLAGS_storage_snapshot_reads) {
+      db->EnableSnapshotReads();
+    }
   }
 
   void RunOneQuery() override { f(); }
@@ -0,0 +1,164 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef EXAMLPES_BENCHMARK_GENERIC_SCENARIO_STORAGE_CONTAINERS_H
+#define EXAMLPES_BENCHMARK_GENERIC_SCENARIO_STORAGE_CONTAINERS_H
+
+#include "../../../port.h"
+
+#include <fstream>
+#include <mutex>
+
+#include "benchmark.h"
+#include "scenario_storage.h"  // For `UInt32KeyValuePair`.
+
+#include "../../../bricks/util/random.h"
+#include "../../../storage/container/common.h"
+
+#include "../../../bricks/dflags/dflags.h"
+
+#ifdef CURRENT_POSIX
+#include <unistd.h>
+#endif
+
+#ifndef CURRENT_MAKE_CHECK_MODE
+DEFINE_string(containers_layout, "flat", "The layout of the dictionary entries to test, separate/unordered/flat.");
+DEFINE_string(containers_op, "get", "The operation to run in the inner loop of the load test, get/put.");
+DEFINE_uint32(containers_size, 1000000, "The number of entries in the dictionary.");
+#else
+DECLARE_string(containers_layout);
+DECLARE_string(containers_op);
+DECLARE_uint32(containers_size);
+#endif
+
+// The layouts of the entries of the storage dictionaries, with their last modified times, to compare the memory per
+// entry and the speed of the lookups and of the updates, with no storage and no persistence around them:
+// * "separate": `std::unordered_map`-s of the entries and of their last modified times, as the dictionaries used to be,
+// * "unordered": one `std::unordered_map` of the entries along with their times, as `UnorderedDictionary` is now, and
+// * "flat": the `FlatMap` of the same, as `FlatDictionary` is.
+struct StorageContainersLayout {
+  virtual ~StorageContainersLayout() = default;
+  // Finds the entry and its last modified time, as the REST `GET` does.
+  virtual bool Get(uint32_t key) const = 0;
+  virtual void Put(uint32_t key, uint32_t value, std::chrono::microseconds now) = 0;
+};
+
+struct StorageContainersSeparateLayout final : StorageContainersLayout {
+  current::storage::container::Unordered<uint32_t, UInt32KeyValuePair> map;
+  current::storage::container::Unordered<uint32_t, std::chrono::microseconds> last_modified;
+
+  bool Get(uint32_t key) const override {
+    return map.find(key) != map.end() && last_modified.find(key) != last_modified.end();
+  }
+  void Put(uint32_t key, uint32_t value, std::chrono::microseconds now) override {
+    map[key] = UInt32KeyValuePair(key, value);
+    last_modified[key] = now;
+  }
+};
+
+template <template <typename...> class MAP>
+struct StorageContainersColocatedLayout final : StorageContainersLayout {
+  struct Entry final {
+    UInt32KeyValuePair object;
+    std::chrono::microseconds last_modified;
+  };
+  MAP<uint32_t, Entry> map;
+
+  bool Get(uint32_t key) const override { return map.find(key) != map.end(); }
+  void Put(uint32_t key, uint32_t value, std::chrono::microseconds now) override {
+    Entry& entry = map[key];
+    entry.object = UInt32KeyValuePair(key, value);
+    entry.last_modified = now;
+  }
+};
+
+SCENARIO(storage_containers, "Memory per entry and speed of the layouts of the storage dictionaries.") {
+  std::unique_ptr<StorageContainersLayout> layout;
+  bool put;
+  std::mutex put_mutex;
+
+  // The keys are distinct, and spread over the whole range of `uint32_t`.
+  static uint32_t Key(uint32_t i) { return i * 2654435761u; }
+  static uint32_t RandomIndex() {
+    return current::random::RandomIntegral<uint32_t>(0u, std::max(FLAGS_containers_size, 1u) - 1u);
+  }
+
+  // The resident set size of the process, in bytes, or zero where it is not known.
+  static size_t ResidentBytes() {
+#ifdef CURRENT_POSIX
+    size_t total_pages = 0u;
+    size_t resident_pages = 0u;
+    std::ifstream("/proc/self/statm") >> total_pages >> resident_pages;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0u;
+#endif
+  }
+
+  storage_containers() : put(FLAGS_containers_op == "put") {
+    if (FLAGS_containers_layout == "separate") {
+      layout = std::make_unique<StorageContainersSeparateLayout>();
+    } else if (FLAGS_containers_layout == "unordered") {
+      layout = std::make_unique<StorageContainersColocatedLayout<current::storage::container::Unordered>>();
+    } else if (FLAGS_containers_layout == "flat") {
+      layout = std::make_unique<StorageContainersColocatedLayout<current::storage::container::Flat>>();
+    } else {
+      std::cerr << "The `--containers_layout` flag must be 'separate', 'unordered', or 'flat'." << std::endl;
+      CURRENT_ASSERT(false);
+    }
+    if (!put && FLAGS_containers_op != "get") {
+      std::cerr << "The `--containers_op` flag must be 'get' or 'put'." << std::endl;
+      CURRENT_ASSERT(false);
+    }
+
+    const size_t resident_bytes_before = ResidentBytes();
+    const auto now = current::time::Now();
+    for (uint32_t i = 0; i < FLAGS_containers_size; ++i) {
+      layout->Put(Key(i), i, now);
+    }
+    const size_t resident_bytes_after = ResidentBytes();
+    if (FLAGS_containers_size && resident_bytes_after) {
+      std::cout << FLAGS_containers_size << " entries, "
+                << (resident_bytes_after - resident_bytes_before) / FLAGS_containers_size << " bytes per entry, ";
+    }
+  }
+
+  void RunOneQuery() override {
+    const uint32_t key = Key(RandomIndex());
+    if (!put) {
+      if (!layout->Get(key)) {
+        std::cerr << "Test failed." << std::endl;
+        std::exit(-1);
+      }
+    } else {
+      // The updates are serialized, as they are in the storage.
+      std::lock_guard<std::mutex> lock(put_mutex);
+      layout->Put(key, key, current::time::Now());
+    }
+  }
+};
+
+REGISTER_SCENARIO(storage_containers);
+
+#endif  // EXAMLPES_BENCHMARK_GENERIC_SCENARIO_STORAGE_CONTAINERS_H
@@ -40,48 +40,159 @@ DEFINE_int32(threads,
              "measurement will be imprecise if (ping) / (time to service the request) is greater than "
              "FLAGS_threads. Thus, this benchmarking tool is not useful when profiling remote servers.");
 
-int main(int argc, char** argv) {
-  ParseDFlags(&argc, &argv);
+DEFINE_string(mode,
+              "new_connection",
+              "One of `new_connection` (one request per connection), `keep_alive` (one connection per thread, "
+              "reconnecting if the server closes it), or `pipelined` (`--pipeline_depth` requests sent at once).");
+DEFINE_int32(pipeline_depth, 16, "The number of requests to send before reading the responses in `pipelined` mode.");
+
+DEFINE_bool(compare_engines,
+            false,
+            "Set to ignore `--url` and `--mode`, and run all the modes against two local servers instead, "
+            "one run by the default engine on `--port`, and one by the `epoll` engine on `--epoll_port`.");
+DEFINE_int32(epoll_port, PickPortForUnitTest(), "The port for the `epoll` engine server with `--compare_engines`.");
+DEFINE_int32(epoll_workers, 0, "The number of `epoll` worker threads with `--compare_engines`, zero for one per core.");
+
+enum class Mode { NewConnection, KeepAlive, Pipelined };
+
+struct LoadResult {
+  size_t queries = 0u;
+  std::vector<uint32_t> latencies_us;
+};
+
+class Worker {
+ public:
+  Worker(const std::string& url, Mode mode, double seconds)
+      : url_(url), mode_(mode), seconds_(seconds), thread_(&Worker::Thread, this) {}
+  void Join() { thread_.join(); }
+  const LoadResult& Result() const { return result_; }
+
+ private:
+  static std::chrono::microseconds Now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+  }
 
-  class Worker {
-   public:
-    explicit Worker(double seconds) : seconds_(seconds), queries_(0u), thread_(&Worker::Thread, this) {}
-    void Join() { thread_.join(); }
-    size_t TotalQueries() const { return queries_; }
-
-   private:
-    static double NowInSeconds() { return 1e-6 * static_cast<double>(time::Now().count()); }
-    void Thread() {
-      const double timestamp_end = NowInSeconds() + seconds_;
-      while (NowInSeconds() < timestamp_end) {
+  void Thread() {
+    const auto end = Now() + std::chrono::microseconds(static_cast<int64_t>(seconds_ * 1e6));
+    if (mode_ == Mode::NewConnection) {
+      while (Now() < end) {
         const int a = current::random::RandomIntegral(-1000000, +1000000);
         const int b = current::random::RandomIntegral(-1000000, +1000000);
-        const auto r =
-            HTTP(GET(strings::Printf(FLAGS_url.c_str(), FLAGS_port) + strings::Printf("?a=%d&b=%d", a, b)));
+        const auto t = Now();
+        const auto r = HTTP(GET(url_ + strings::Printf("?a=%d&b=%d", a, b)));
         CURRENT_ASSERT(r.code == HTTPResponseCode.OK);
         CURRENT_ASSERT(ParseJSON<AddResult>(r.body).sum == a + b);
-        ++queries_;
+        Record(t);
+      }
+    } else {
+      const url::URL parsed_url(url_);
+      const size_t depth = (mode_ == Mode::Pipelined) ? static_cast<size_t>(FLAGS_pipeline_depth) : 1u;
+      std::unique_ptr<net::Connection> connection;
+      std::string buffer;
+      while (Now() < end) {
+        if (!connection) {
+          connection = std::make_unique<net::Connection>(net::ClientSocket(parsed_url.host, parsed_url.port));
+          buffer.clear();
+        }
+        std::vector<int64_t> expected_sums;
+        std::string requests;
+        for (size_t i = 0; i < depth; ++i) {
+          const int a = current::random::RandomIntegral(-1000000, +1000000);
+          const int b = current::random::RandomIntegral(-1000000, +1000000);
+          requests += strings::Printf("GET %s?a=%d&b=%d HTTP/1.1\r\nHost: %s\r\n\r\n",
+                                      parsed_url.path.c_str(),
+                                      a,
+                                      b,
+                                      parsed_url.host.c_str());
+          expected_sums.push_back(a + b);
+        }
+        const auto t = Now();
+        connection->BlockingWrite(requests, false);
+        bool keep_alive = true;
+        for (const int64_t expected_sum : expected_sums) {
+          // The framing of HTTP requests, which relies on `Content-Length`, works for the responses just as well.
+          http::impl::FramedHTTPRequest framed;
+          while (!(framed = http::impl::FrameHTTPRequest(buffer.data(), buffer.data() + buffer.length())).length) {
+            char chunk[16 * 1024];
+            buffer.append(chunk, connection->BlockingRead(chunk, sizeof(chunk)));
+          }
+          const size_t body_offset = buffer.find("\r\n\r\n") + 4u;
+          CURRENT_ASSERT(buffer.compare(0u, 12u, "HTTP/1.1 200") == 0);
+          CURRENT_ASSERT(ParseJSON<AddResult>(buffer.substr(body_offset, framed.length - body_offset)).sum ==
+                         expected_sum);
+          buffer.erase(0u, framed.length);
+          keep_alive = framed.keep_alive;
+          Record(t);
+          if (!keep_alive) {
+            // The server does not support pipelining if it closes the connection after the first response.
+            CURRENT_ASSERT(depth == 1u);
+            break;
+          }
+        }
+        if (!keep_alive) {
+          connection = nullptr;
+        }
       }
     }
+  }
 
-    const double seconds_;
-    size_t queries_;
-    std::thread thread_;
-  };
+  void Record(std::chrono::microseconds request_sent_at) {
+    ++result_.queries;
+    result_.latencies_us.push_back(static_cast<uint32_t>((Now() - request_sent_at).count()));
+  }
+
+  const std::string url_;
+  const Mode mode_;
+  const double seconds_;
+  LoadResult result_;
+  std::thread thread_;
+};
 
+void RunLoad(const std::string& title, const std::string& url, Mode mode) {
   std::vector<std::unique_ptr<Worker>> threads(FLAGS_threads);
   for (auto& t : threads) {
-    t = std::make_unique<Worker>(FLAGS_seconds);
+    t = std::make_unique<Worker>(url, mode, FLAGS_seconds);
   }
-
   for (auto& t : threads) {
     t->Join();
   }
 
   size_t total_queries = 0u;
+  std::vector<uint32_t> latencies_us;
   for (auto& t : threads) {
-    total_queries += t->TotalQueries();
+    total_queries += t->Result().queries;
+    latencies_us.insert(latencies_us.end(), t->Result().latencies_us.begin(), t->Result().latencies_us.end());
   }
+  std::sort(latencies_us.begin(), latencies_us.end());
+  const auto Percentile = [&latencies_us](double p) {
+    return latencies_us.empty() ? 0u : latencies_us[static_cast<size_t>(p * (latencies_us.size() - 1))];
+  };
+
+  std::cout << title << "QPS: " << std::setw(8) << static_cast<int64_t>(total_queries / FLAGS_seconds)
+            << ", p50: " << std::setw(6) << Percentile(0.5) << "us, p99: " << std::setw(6) << Percentile(0.99) << "us"
+            << std::endl;
+}
 
-  std::cout << "QPS: " << std::setw(3) << (total_queries / FLAGS_seconds) << std::endl;
+int main(int argc, char** argv) {
+  ParseDFlags(&argc, &argv);
+
+  if (!FLAGS_compare_engines) {
+    const Mode mode = FLAGS_mode == "keep_alive" ? Mode::KeepAlive
+                                                 : FLAGS_mode == "pipelined" ? Mode::Pipelined : Mode::NewConnection;
+    RunLoad("", strings::Printf(FLAGS_url.c_str(), FLAGS_port), mode);
+  } else {
+    const BenchmarkTestServer threaded(FLAGS_port, "/add");
+    const BenchmarkTestServer epoll(
+        FLAGS_epoll_port,
+        "/add",
+        HTTPServerOptions(HTTPServerEngine::Epoll, static_cast<size_t>(FLAGS_epoll_workers)));
+    const std::string threaded_url = strings::Printf("http://localhost:%d/add", FLAGS_port);
+    const std::string epoll_url = strings::Printf("http://localhost:%d/add", FLAGS_epoll_port);
+    RunLoad("Threaded, new connection per request: ", threaded_url, Mode::NewConnection);
+    RunLoad("Threaded, keep-alive requested:       ", threaded_url, Mode::KeepAlive);
+    RunLoad("Epoll,    new connection per request: ", epoll_url, Mode::NewConnection);
+    RunLoad("Epoll,    keep-alive:                 ", epoll_url, Mode::KeepAlive);
+    RunLoad("Epoll,    pipelined:                  ", epoll_url, Mode::Pipelined);
+  }
 }
@@ -31,9 +31,15 @@ using namespace current;
 
 DEFINE_string(benchmark_local_route, "/add", "The route spawn the server on.");
 DEFINE_int32(benchmark_local_port, PickPortForUnitTest(), "The local port to spawn the server on.");
+DEFINE_bool(benchmark_epoll, false, "Set to run the server with the `epoll` engine, with keep-alive and pipelining.");
+DEFINE_int32(benchmark_epoll_workers, 0, "The number of `epoll` worker threads, zero for one per CPU core.");
 
 int main(int argc, char** argv) {
   ParseDFlags(&argc, &argv);
 
-  BenchmarkTestServer(FLAGS_benchmark_local_port, FLAGS_benchmark_local_route).Join();
+  BenchmarkTestServer(FLAGS_benchmark_local_port,
+                      FLAGS_benchmark_local_route,
+                      HTTPServerOptions(FLAGS_benchmark_epoll ? HTTPServerEngine::Epoll : HTTPServerEngine::Threaded,
+                                        static_cast<size_t>(FLAGS_benchmark_epoll_workers)))
+      .Join();
 }
@@ -34,14 +34,17 @@ CURRENT_STRUCT(AddResult) {
 
 class BenchmarkTestServer {
  public:
-  BenchmarkTestServer(int port, const std::string& route)
+  BenchmarkTestServer(int port,
+                      const std::string& route,
+                      const current::http::HTTPServerOptions& options = current::http::HTTPServerOptions())
       : port_(port),
-        scope_(HTTP(port).Register(route,
-                                   [](Request r) {
-                                     r(AddResult(current::FromString<int64_t>(r.url.query["a"]) +
-                                                 current::FromString<int64_t>(r.url.query["b"])));
-                                   }) +
-               HTTP(port).Register("/perftest", [](Request r) { r("perftest ok\n"); })) {}
+        scope_(HTTP(port, options)
+                   .Register(route,
+                             [](Request r) {
+                               r(AddResult(current::FromString<int64_t>(r.url.query["a"]) +
+                                           current::FromString<int64_t>(r.url.query["b"])));
+                             }) +
+               HTTP(port, options).Register("/perftest", [](Request r) { r("perftest ok\n"); })) {}
 
   void Join() { HTTP(port_).Join(); }
 
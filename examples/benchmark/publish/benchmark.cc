@@ -0,0 +1,117 @@
+/*******************************************************************************
+ The MIT License (MIT)
+
+ Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ *******************************************************************************/
+
+// Measures the throughput and the latency of `current::persistence::File` publishing from several threads,
+// for each `FileSyncPolicy`.
+
+#include "../../../blocks/persistence/file.h"
+
+#include "../../../bricks/dflags/dflags.h"
+#include "../../../bricks/file/file.h"
+#include "../../../bricks/time/chrono.h"
+
+DEFINE_uint32(threads, 8, "The number of threads to publish from.");
+DEFINE_uint32(entries, 2000, "The number of entries to publish from each thread.");
+DEFINE_uint32(entry_length, 100, "The length of each entry, in bytes.");
+DEFINE_uint32(sync_period_ms, 100, "The sync period for the `FDataSyncPeriodically` policy, in milliseconds.");
+DEFINE_string(tmpdir, ".current", "The directory to create the temporary stream file in.");
+
+CURRENT_STRUCT(Entry) {
+  CURRENT_FIELD(s, std::string);
+  CURRENT_CONSTRUCTOR(Entry)(std::string s = "") : s(std::move(s)) {}
+};
+
+struct Result {
+  double entries_per_second;
+  std::chrono::microseconds p50;
+  std::chrono::microseconds p99;
+};
+
+Result Run(current::persistence::FileSyncPolicy policy) {
+  using current::persistence::FilePersisterOptions;
+
+  current::FileSystem::MkDir(FLAGS_tmpdir, current::FileSystem::MkDirParameters::Silent);
+  const std::string filename = current::FileSystem::JoinPath(FLAGS_tmpdir, "publish_benchmark.data");
+  const auto file_remover = current::FileSystem::ScopedRmFile(filename);
+  const auto index_file_remover = current::FileSystem::ScopedRmFile(filename + ".idx");
+
+  std::mutex mutex;
+  current::persistence::File<Entry> persister(mutex,
+                                              current::ss::StreamNamespaceName("Entry", "Entry"),
+                                              filename,
+                                              FilePersisterOptions(policy,
+                                                                   std::chrono::milliseconds(FLAGS_sync_period_ms)));
+
+  const std::string payload(FLAGS_entry_length, '.');
+  std::vector<std::vector<std::chrono::microseconds>> latencies(FLAGS_threads);
+  std::vector<std::thread> threads;
+
+  const auto start = current::time::Now();
+  for (uint32_t t = 0; t < FLAGS_threads; ++t) {
+    threads.emplace_back([&persister, &payload, &latencies, t]() {
+      auto& thread_latencies = latencies[t];
+      thread_latencies.reserve(FLAGS_entries);
+      for (uint32_t i = 0; i < FLAGS_entries; ++i) {
+        const auto begin = std::chrono::steady_clock::now();
+        persister.Publish(Entry(payload));
+        thread_latencies.push_back(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto end = current::time::Now();
+
+  std::vector<std::chrono::microseconds> all;
+  for (const auto& thread_latencies : latencies) {
+    all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+  }
+  std::sort(all.begin(), all.end());
+
+  Result result;
+  result.entries_per_second = 1e6 * all.size() / std::max(static_cast<int64_t>(1), (end - start).count());
+  result.p50 = all[all.size() / 2];
+  result.p99 = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+  return result;
+}
+
+int main(int argc, char** argv) {
+  ParseDFlags(&argc, &argv);
+
+  using current::persistence::FileSyncPolicy;
+  const std::vector<std::pair<FileSyncPolicy, std::string>> policies = {
+      {FileSyncPolicy::FlushOnly, "FlushOnly"},
+      {FileSyncPolicy::FDataSyncEveryBatch, "FDataSyncEveryBatch"},
+      {FileSyncPolicy::FDataSyncPeriodically, "FDataSyncPeriodically"}};
+
+  std::cout << "Threads: " << FLAGS_threads << ", entries per thread: " << FLAGS_entries << std::endl;
+  for (const auto& policy : policies) {
+    const Result result = Run(policy.first);
+    std::cout << policy.second << ":\t" << static_cast<uint64_t>(result.entries_per_second) << " entries/s"
+              << ", p50 " << result.p50.count() << "us, p99 " << result.p99.count() << "us" << std::endl;
+  }
+  return 0;
+}
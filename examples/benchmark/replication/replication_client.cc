@@ -37,6 +37,7 @@ DEFINE_double(seconds, 0, "If set, the maximum number of seconds to run the benc
 DEFINE_bool(do_not_remove_replicated_data, false, "Set to not remove the data file.");
 DEFINE_bool(use_checked_subscription, false, "Set to use checked subscription for the replication");
 DEFINE_bool(use_safe_replication, false, "Set to use \"safe\" (checked) replication");
+DEFINE_bool(binary, true, "Set to false to replicate in the line-based, rather than the binary, batched, format.");
 
 inline std::chrono::microseconds FastNow() {
   return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch());
@@ -129,6 +130,7 @@ template <typename... ARGS>
 void Replicate(ARGS&&... args) {
   std::cerr << "Connecting to the stream at '" << FLAGS_url << "' ..." << std::flush;
   current::stream::SubscribableRemoteStream<benchmark::replication::Entry> remote_stream(FLAGS_url);
+  remote_stream.UseBinaryFormat(FLAGS_binary);
   auto replicator = CreateReplicator(args...);
   std::cerr << "\b\b\bOK" << std::endl;
 
@@ -151,10 +153,12 @@ void Replicate(ARGS&&... args) {
     const std::chrono::milliseconds print_delay(500);
     const auto mode = FLAGS_use_checked_subscription ? current::stream::SubscriptionMode::Checked
                                                      : current::stream::SubscriptionMode::Unchecked;
+    const std::chrono::microseconds from_us(0);
     const auto subscriber_scope =
         FLAGS_use_safe_replication
-            ? static_cast<current::stream::SubscriberScope>(remote_stream.Subscribe(*replicator, 0, mode))
-            : static_cast<current::stream::SubscriberScope>(remote_stream.SubscribeUnchecked(*replicator, 0, mode));
+            ? static_cast<current::stream::SubscriberScope>(remote_stream.Subscribe(*replicator, 0, from_us, mode))
+            : static_cast<current::stream::SubscriberScope>(
+                  remote_stream.SubscribeUnchecked(*replicator, 0, from_us, mode));
     std::cerr << "\b\b\bOK" << std::endl;
     auto next_print_time = start_time + print_delay;
 
@@ -25,6 +25,10 @@ SOFTWARE.
 // A simple load test for the server.
 // Not suitable for large latencies, since it sends requests synchronously from N threads,
 // instead of using `epoll()` to maximize client-side throughput.
+//
+// With `--keep_alive`, the default, the connections are reused across requests; run the server with `--db_demo_epoll`
+// for it to keep them alive, and compare to `--nokeep_alive`. With `--async_batch=N`, each thread sends batches
+// of N requests via `HTTPAsync()`, over its pooled connections, instead of one request at a time.
 
 #include "../../current.h"
 
@@ -36,6 +40,8 @@ DEFINE_double(seconds, 2.5, "Run the load test for this many seconds.");
 DEFINE_string(url, "http://localhost:%d", "The URL for the load test, default to `http://localhost:${FLAGS_port}`.");
 DEFINE_int32(port, 8889, "The port to use, if `--url` includes it.");
 DEFINE_int32(threads, 100, "The number of threads to run requests from.");
+DEFINE_bool(keep_alive, true, "Reuse the connections kept alive by the server.");
+DEFINE_int32(async_batch, 0, "If nonzero, send the requests in batches of this size via `HTTPAsync()`.");
 
 DEFINE_int32(userid_lengths, 4, "The length of random user IDs to generate.");
 DEFINE_int32(nickname_lengths, 6, "The length of random user nicknames to generate.");
@@ -69,9 +75,18 @@ int main(int argc, char** argv) {
       const double timestamp_begin = NowInSeconds();
       const double timestamp_end = timestamp_begin + seconds_;
       double timestamp_now;
+      const POST request = POST(url_, body).KeepAlive(FLAGS_keep_alive);
+      const std::vector<POST> batch(static_cast<size_t>(std::max(FLAGS_async_batch, 0)), request);
       while ((timestamp_now = NowInSeconds()) < timestamp_end) {
-        CURRENT_ASSERT(HTTP(POST(url_, body)).code == HTTPResponseCode.NoContent);
-        ++queries_;
+        if (batch.empty()) {
+          CURRENT_ASSERT(HTTP(request).code == HTTPResponseCode.NoContent);
+          ++queries_;
+        } else {
+          for (auto& response : HTTPAsync(batch)) {
+            CURRENT_ASSERT(response.get().code == HTTPResponseCode.NoContent);
+            ++queries_;
+          }
+        }
       }
     }
 
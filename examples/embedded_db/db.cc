@@ -32,6 +32,7 @@ DEFINE_string(db_dir, ".current", "Local path to the data storage location.");
 DEFINE_string(db_filename, "data.json", "File name for the persisted data.");
 
 DEFINE_int32(db_demo_port, PickPortForUnitTest(), "Local port to spawn the server on.");
+DEFINE_bool(db_demo_epoll, false, "Use the `epoll` HTTP server engine, which keeps the connections alive.");
 
 DEFINE_bool(legend, true, "Print example usage patterns.");
 
@@ -136,32 +137,40 @@ int main(int argc, char** argv) {
     std::cerr << "Demo Embedded Event Log DB running on localhost:" << FLAGS_db_demo_port << std::flush << std::endl;
   }
 
-  HTTP(FLAGS_db_demo_port).Register("/healthz", [](Request r) { r("OK\n"); });
+  HTTPRoutesScope scope = HTTP(FLAGS_db_demo_port,
+                               FLAGS_db_demo_epoll ? HTTPServerOptions(HTTPServerEngine::Epoll) : HTTPServerOptions())
+                              .Register("/healthz", [](Request r) { r("OK\n"); });
 
   // Schema.
   using reflection::SchemaInfo;
   using reflection::StructSchema;
   using reflection::Language;
 
-  HTTP(FLAGS_db_demo_port)
+  scope += HTTP(FLAGS_db_demo_port)
       .Register(
           "/schema.h",
           [](Request r) {
             StructSchema schema;
             schema.AddType<Event>();
-            r(schema.GetSchemaInfo().Describe<Language::CPP>(), HTTPResponseCode.OK, "text/plain; charset=us-ascii");
+            r(schema.GetSchemaInfo().Describe<Language::CPP>(),
+              HTTPResponseCode.OK,
+              current::net::http::Headers(),
+              "text/plain; charset=us-ascii");
           });
 
-  HTTP(FLAGS_db_demo_port)
+  scope += HTTP(FLAGS_db_demo_port)
       .Register(
           "/schema.fs",
           [](Request r) {
             StructSchema schema;
             schema.AddType<Event>();
-            r(schema.GetSchemaInfo().Describe<Language::FSharp>(), HTTPResponseCode.OK, "text/plain; charset=us-ascii");
+            r(schema.GetSchemaInfo().Describe<Language::FSharp>(),
+              HTTPResponseCode.OK,
+              current::net::http::Headers(),
+              "text/plain; charset=us-ascii");
           });
 
-  HTTP(FLAGS_db_demo_port)
+  scope += HTTP(FLAGS_db_demo_port)
       .Register("/schema.json",
                 [](Request r) {
                   StructSchema schema;
@@ -170,10 +179,10 @@ int main(int argc, char** argv) {
                 });
 
   // Subscribe.
-  HTTP(FLAGS_db_demo_port).Register("/data", *stream);
+  scope += HTTP(FLAGS_db_demo_port).Register("/data", *stream);
 
   // Publish.
-  HTTP(FLAGS_db_demo_port)
+  scope += HTTP(FLAGS_db_demo_port)
       .Register("/publish",
                 [&stream](Request r) {
                   if (r.method == "POST") {
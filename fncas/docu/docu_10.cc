@@ -83,8 +83,9 @@ using namespace fncas_docu;
 }
   
   // Create the blueprint of this function: its internal tree representation.
-  // The scope of `x` would be where the blueprint and its uses are valid
-  // from within this particular thread. It uses a thread-local singleton.
+  // The scope of `x` is where the function is recorded, into the default context
+  // of this thread. To record several functions at once, from one thread or from
+  // many, use `variables_vector_t x(context, 2)` with a `context_t context` each.
   variables_vector_t x(2);
   number_of_calls = 0;
   function_t<JIT::Blueprint> blueprint = simple_function(x);
@@ -211,7 +211,7 @@ inline node_index_t d_f(MathFunction function, const V& original, const V& x, co
 // will overflow the stack for every formula containing repeated operation on the top level.
 inline node_index_t differentiate_node(node_index_t index, size_t var_index, size_t dim) {
   CURRENT_ASSERT(var_index < dim);
-  std::vector<std::vector<node_index_t>>& df_container = internals_singleton().df_;
+  std::vector<std::vector<node_index_t>>& df_container = current_context().df_;
   if (df_container.empty()) {
     df_container.resize(dim);
   }
@@ -304,43 +304,51 @@ struct g_impl<JIT::NativeWrapper> : g_super {
 
 template <>
 struct g_impl<JIT::Blueprint> : g_super {
-  V f_;               // `f_` holds the node index for the value of the preprocessed expression.
-  std::vector<V> g_;  // `g_[i]` holds the node index for the value of the derivative by variable `i`.
-  g_impl(const X& x_ref, const V& f) : f_(f) {
-    CURRENT_ASSERT(&x_ref == internals_singleton().x_ptr_);
-    const size_t dim = internals_singleton().dim_;
+  V f_;                    // `f_` holds the node index for the value of the preprocessed expression.
+  std::vector<V> g_;       // `g_[i]` holds the node index for the value of the derivative by variable `i`.
+  context_impl* context_;  // The context `f_` is recorded, and `g_` is differentiated, in.
+  // The function can be differentiated while it is being recorded, or after, as long as its context is not reused.
+  g_impl(context_impl& context, const V& f) : f_(f), context_(&context) {
+    const context_scope scope(context);
+    const size_t dim = context.dim_;
     g_.resize(dim);
     for (size_t i = 0; i < dim; ++i) {
-      g_[i] = f_.template differentiate<X>(x_ref, i);
+      g_[i] = from_index(differentiate_node(f_.index_, i, dim));
     }
-    internals_singleton().node_vector_.shrink_to_fit();
+    context.node_vector_.shrink_to_fit();
   }
-  explicit g_impl(const V& f) : g_impl(*internals_singleton().x_ptr_, f) {}
+  g_impl(const X& x_ref, const V& f) : g_impl(x_ref.context(), f) { CURRENT_ASSERT(&x_ref == context_->x_ptr_); }
+  explicit g_impl(const V& f) : g_impl(current_context(), f) {}
   g_impl(const X& x_ref, const f_impl<JIT::Blueprint>& fi) : g_impl(x_ref, fi.f_) {}
-  explicit g_impl(const f_impl<JIT::Blueprint>& fi) : g_impl(*internals_singleton().x_ptr_, fi.f_) {}
+  explicit g_impl(const f_impl<JIT::Blueprint>& fi) : g_impl(fi.context(), fi.f_) {}
   g_impl() = delete;
   void operator=(const g_impl& rhs) {
     f_ = rhs.f_;
     g_ = rhs.g_;
+    context_ = rhs.context_;
   }
   std::vector<double_t> operator()(const std::vector<double_t>& x) const override {
     std::vector<double_t> r;
     r.resize(g_.size());
     for (size_t i = 0; i < g_.size(); ++i) {
-      r[i] = g_[i](x, i ? reuse_cache::reuse : reuse_cache::invalidate);
+      r[i] = eval_node(*context_, g_[i].index_, x, i ? reuse_cache::reuse : reuse_cache::invalidate);
     }
     return r;
   }
-  std::string debug_gradient_as_string(size_t i) const { return g_[i].debug_as_string(); }
+  std::string debug_gradient_as_string(size_t i) const {
+    const context_scope scope(*context_);
+    return g_[i].debug_as_string();
+  }
+  context_impl& context() const { return *context_; }
   size_t dim() const override { return g_.size(); }
 };
 
 template <>
 struct node_differentiate_impl<X> {
   static V differentiate(const X& x_ref, node_index_t node_index, size_t variable_index) {
-    CURRENT_ASSERT(&x_ref == internals_singleton().x_ptr_);
-    CURRENT_ASSERT(static_cast<size_t>(variable_index) < internals_singleton().dim_);
-    return from_index(differentiate_node(node_index, variable_index, internals_singleton().dim_));
+    CURRENT_ASSERT(&x_ref == current_context().x_ptr_);
+    CURRENT_ASSERT(static_cast<size_t>(variable_index) < current_context().dim_);
+    return from_index(differentiate_node(node_index, variable_index, current_context().dim_));
   }
 };
 
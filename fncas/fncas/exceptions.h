@@ -57,6 +57,12 @@ struct BacktrackingException : FnCASOptimizationException {
   using FnCASOptimizationException::FnCASOptimizationException;
 };
 
+// This exception is thrown when the call to `StrongWolfeLineSearch` in `mathutil.h` finds no step which decreases
+// the function, or when the direction it is given to search along is not the descent one.
+struct LineSearchException : FnCASOptimizationException {
+  using FnCASOptimizationException::FnCASOptimizationException;
+};
+
 }  // namespace fncas::exceptions
 }  // namespace fncas
 
@@ -31,6 +31,7 @@
 #include "base.h"
 #include "node.h"
 #include "differentiate.h"
+#include "simplify.h"
 #include "optimize.h"
 #include "jit.h"
 
@@ -42,18 +42,54 @@
 #include <dlfcn.h>
 
 #include "../../bricks/strings/printf.h"
+#include "../../bricks/strings/util.h"
 #include "../../bricks/file/file.h"
 #include "../../bricks/system/syscalls.h"
 
 #include "base.h"
 #include "node.h"
 #include "differentiate.h"
+#include "logger.h"
+#include "simplify.h"
+#include "jit_cache.h"
 
 namespace fncas {
 namespace impl {
 
 static_assert(std::is_same_v<double, double_t>, "FnCAS JIT assumes `double_t` is the native double.");
 
+// The nodes to compile the expressions of `roots` by, in the current context: simplified, unless disabled.
+inline std::vector<node_index_t> nodes_to_compile(const std::vector<node_index_t>& roots) {
+  context_impl& context = current_context();
+  if (!context.simplify_before_compilation_) {
+    return roots;
+  }
+  const size_t nodes_before = count_nodes(context, roots);
+  std::vector<node_index_t> result = simplify_nodes(context, roots);
+  OptimizerLogger().Log("FnCAS: Simplified the expression from " + current::ToString(nodes_before) + " to " +
+                        current::ToString(count_nodes(context, result)) + " nodes.");
+  return result;
+}
+
+// The name of the code generator, for the keys of the compiled code in `jit_cache()`.
+inline std::string jit_cache_generator_name(JIT jit, const std::string& what) {
+  switch (jit) {
+    case JIT::CLANG:
+      return "CLANG " + what;
+    case JIT::AS:
+      return "AS " + what;
+    case JIT::NASM:
+      return "NASM " + what;
+#ifdef FNCAS_X64_NATIVE_JIT_ENABLED
+    case JIT::X64NativeJIT:
+      return "X64NativeJIT " + what;
+#endif
+    default:
+      CURRENT_ASSERT(false);
+      return what;
+  }
+}
+
 // Linux- and Mac-friendly code to compile into .so and link against it at runtime.
 // Not portable.
 
@@ -121,13 +157,7 @@ struct compiled_expression final : noncopyable {
     CURRENT_ASSERT(heap_size_);
     CURRENT_ASSERT(function_);
 
-    std::vector<double>& heap = internals_singleton().heap_for_compiled_evaluations_;
-    const size_t desired_heap_size = heap_size_();
-    if (heap.size() < desired_heap_size) {
-      heap.resize(desired_heap_size);
-    }
-
-    return function_(x, &heap[0]);
+    return function_(x, evaluation_buffers_singleton().heap(heap_size_()));
   }
 
   double compute_compiled_f(const std::vector<double>& x) const { return compute_compiled_f(&x[0]); }
@@ -139,18 +169,15 @@ struct compiled_expression final : noncopyable {
     const auto dim = static_cast<size_t>(dim_());
     CURRENT_ASSERT(gradient_indexes_.size() == dim);
 
-    std::vector<double>& heap = internals_singleton().heap_for_compiled_evaluations_;
-    const size_t desired_heap_size = heap_size_();
-    if (heap.size() < desired_heap_size) {
-      heap.resize(desired_heap_size);
-    }
+    const size_t heap_size = heap_size_();
+    double* heap = evaluation_buffers_singleton().heap(heap_size);
 
-    gradient_(x, &heap[0]);
+    gradient_(x, heap);
 
     CURRENT_ASSERT(gradient_indexes_.size() == dim);
     std::vector<double> result(dim);
     for (size_t i = 0; i < gradient_indexes_.size(); ++i) {
-      CURRENT_ASSERT(static_cast<size_t>(gradient_indexes_[i]) < heap.size());
+      CURRENT_ASSERT(static_cast<size_t>(gradient_indexes_[i]) < heap_size);
       result[i] = heap[gradient_indexes_[i]];
     }
 
@@ -176,8 +203,8 @@ struct compiled_expression final : noncopyable {
 template <>
 class JITImplementation<JIT::NASM> final {
  public:
-  JITImplementation(const std::string& filebase, bool has_g)
-      : filebase(filebase), f(fopen((filebase + ".asm").c_str(), "w")) {
+  JITImplementation(const std::string& filebase, const jit_cache_key_t& key, bool has_g)
+      : filebase(filebase), key(key), f(fopen((filebase + ".asm").c_str(), "w")) {
     CURRENT_ASSERT(f);
 
     fprintf(f, "[bits 64]\n");
@@ -203,15 +230,15 @@ class JITImplementation<JIT::NASM> final {
     fprintf(f, "  push rbp\n");
     fprintf(f, "  mov rbp, rsp\n");
     generate_nasm_code_for_node(index);
-    fprintf(f, "  ; return a[%lld]\n", static_cast<long long>(index));
-    fprintf(f, "  movq xmm0, [rsi+%lld]\n", static_cast<long long>(index) * 8);
+    fprintf(f, "  ; return a[%lld]\n", offset(index));
+    fprintf(f, "  movq xmm0, [rsi+%lld]\n", offset(index) * 8);
     fprintf(f, "  mov rsp, rbp\n");
     fprintf(f, "  pop rbp\n");
     fprintf(f, "  ret\n");
   }
 
   void compile_eval_g(node_index_t f_index, const std::vector<node_index_t>& g_indexes) {
-    CURRENT_ASSERT(g_indexes.size() == internals_singleton().dim_);
+    CURRENT_ASSERT(g_indexes.size() == current_context().dim_);
 #ifdef CURRENT_APPLE
     fprintf(f, "_eval_g:\n");
 #else
@@ -222,10 +249,10 @@ class JITImplementation<JIT::NASM> final {
     generate_nasm_code_for_node(f_index);
     for (size_t i = 0; i < g_indexes.size(); ++i) {
       generate_nasm_code_for_node(g_indexes[i]);
-      fprintf(f, "  ; g[%lld] is a[%lld]\n", static_cast<long long>(i), static_cast<long long>(g_indexes[i]));
+      fprintf(f, "  ; g[%lld] is a[%lld]\n", static_cast<long long>(i), offset(g_indexes[i]));
     }
-    fprintf(f, "  ; return a[%lld]\n", static_cast<long long>(f_index));
-    fprintf(f, "  movq xmm0, [rsi+%lld]\n", static_cast<long long>(f_index) * 8);
+    fprintf(f, "  ; return a[%lld]\n", offset(f_index));
+    fprintf(f, "  movq xmm0, [rsi+%lld]\n", offset(f_index) * 8);
     fprintf(f, "  mov rsp, rbp\n");
     fprintf(f, "  pop rbp\n");
     fprintf(f, "  ret\n");
@@ -240,7 +267,7 @@ class JITImplementation<JIT::NASM> final {
 #endif
     fprintf(f, "  push rbp\n");
     fprintf(f, "  mov rbp, rsp\n");
-    fprintf(f, "  mov rax, %lld\n", static_cast<long long>(internals_singleton().dim_));
+    fprintf(f, "  mov rax, %lld\n", static_cast<long long>(current_context().dim_));
     fprintf(f, "  mov rsp, rbp\n");
     fprintf(f, "  pop rbp\n");
     fprintf(f, "  ret\n");
@@ -252,7 +279,7 @@ class JITImplementation<JIT::NASM> final {
 #endif
     fprintf(f, "  push rbp\n");
     fprintf(f, "  mov rbp, rsp\n");
-    fprintf(f, "  mov rax, %lld\n", static_cast<long long>(max_dim + 1));
+    fprintf(f, "  mov rax, %lld\n", static_cast<long long>(key.heap_size));
     fprintf(f, "  mov rsp, rbp\n");
     fprintf(f, "  pop rbp\n");
     fprintf(f, "  ret\n");
@@ -273,9 +300,11 @@ class JITImplementation<JIT::NASM> final {
 
  private:
   const std::string& filebase;
+  const jit_cache_key_t& key;
   FILE* f;
   std::vector<bool> computed;
-  node_index_t max_dim = 0;
+
+  long long offset(node_index_t i) const { return static_cast<long long>(key.heap_offset(i)); }
 
   // generate_nasm_code_for_node() writes NASM code to evaluate the expression to the file.
   void generate_nasm_code_for_node(node_index_t index) {
@@ -288,7 +317,6 @@ class JITImplementation<JIT::NASM> final {
       stack.pop();
       const node_index_t dependent_i = ~i;
       if (i > dependent_i) {
-        max_dim = std::max(max_dim, static_cast<node_index_t>(i));
         if (computed.size() <= static_cast<size_t>(i)) {
           computed.resize(static_cast<size_t>(i) + 1);
         }
@@ -297,13 +325,13 @@ class JITImplementation<JIT::NASM> final {
           node_impl& node = node_vector_singleton()[i];
           if (node.type() == NodeType::variable) {
             int32_t v = node.variable();
-            fprintf(f, "  ; a[%lld] = x[%d];\n", static_cast<long long>(i), v);
+            fprintf(f, "  ; a[%lld] = x[%d];\n", offset(i), v);
             fprintf(f, "  mov rax, [rdi+%d]\n", v * 8);
-            fprintf(f, "  mov [rsi+%lld], rax\n", static_cast<long long>(i) * 8);
+            fprintf(f, "  mov [rsi+%lld], rax\n", offset(i) * 8);
           } else if (node.type() == NodeType::value) {
-            fprintf(f, "  ; a[%lld] = %lf\n", static_cast<long long>(i), node.value());
+            fprintf(f, "  ; a[%lld] = %lf\n", offset(i), node.value());
             fprintf(f, "  mov rax, %s\n", std::to_string(*reinterpret_cast<int64_t*>(&node.value())).c_str());
-            fprintf(f, "  mov [rsi+%lld], rax\n", static_cast<long long>(i) * 8);
+            fprintf(f, "  mov [rsi+%lld], rax\n", offset(i) * 8);
           } else if (node.type() == NodeType::operation) {
             stack.push(~i);
             stack.push(node.lhs_index());
@@ -320,56 +348,56 @@ class JITImplementation<JIT::NASM> final {
         if (node.type() == NodeType::operation) {
           fprintf(f,
                   "  ; a[%lld] = a[%lld] %s a[%lld];\n",
-                  static_cast<long long>(dependent_i),
-                  static_cast<long long>(node.lhs_index()),
+                  offset(dependent_i),
+                  offset(node.lhs_index()),
                   operation_as_string(node.operation()),
-                  static_cast<long long>(node.rhs_index()));
-          fprintf(f, "  movq xmm0, [rsi+%lld]\n", static_cast<long long>(node.lhs_index()) * 8);
-          fprintf(f, "  movq xmm1, [rsi+%lld]\n", static_cast<long long>(node.rhs_index()) * 8);
+                  offset(node.rhs_index()));
+          fprintf(f, "  movq xmm0, [rsi+%lld]\n", offset(node.lhs_index()) * 8);
+          fprintf(f, "  movq xmm1, [rsi+%lld]\n", offset(node.rhs_index()) * 8);
           fprintf(f, "  %s xmm0, xmm1\n", operation_as_assembler_opcode(node.operation()));
-          fprintf(f, "  movq [rsi+%lld], xmm0\n", static_cast<long long>(dependent_i) * 8);
+          fprintf(f, "  movq [rsi+%lld], xmm0\n", offset(dependent_i) * 8);
         } else if (node.type() == NodeType::function) {
           if (node.function() == MathFunction::sqr) {
             fprintf(f,
                     "  ; a[%lld] = sqr(a[%lld]);  # `sqr` is a special case.\n",
-                    static_cast<long long>(dependent_i),
-                    static_cast<long long>(node.argument_index()));
-            fprintf(f, "  movq xmm0, [rsi+%lld]\n", static_cast<long long>(node.argument_index()) * 8);
+                    offset(dependent_i),
+                    offset(node.argument_index()));
+            fprintf(f, "  movq xmm0, [rsi+%lld]\n", offset(node.argument_index()) * 8);
             fprintf(f, "  mulpd xmm0, xmm0\n");
-            fprintf(f, "  movq [rsi+%lld], xmm0\n", static_cast<long long>(dependent_i) * 8);
+            fprintf(f, "  movq [rsi+%lld], xmm0\n", offset(dependent_i) * 8);
           } else if (node.function() == MathFunction::unit_step) {
             fprintf(f,
                     "  ; a[%lld] = unit_step(a[%lld]);  # `unit_step` is a special case.\n",
-                    static_cast<long long>(dependent_i),
-                    static_cast<long long>(node.argument_index()));
-            fprintf(f, "  movq xmm0, [rsi+%lld]\n", static_cast<long long>(node.argument_index()) * 8);
+                    offset(dependent_i),
+                    offset(node.argument_index()));
+            fprintf(f, "  movq xmm0, [rsi+%lld]\n", offset(node.argument_index()) * 8);
             fprintf(f, "  mov rax, %s  ; 0\n", std::to_string(*reinterpret_cast<const int64_t*>(&d_0)).c_str());
             fprintf(f, "  movq xmm1, rax\n");
             fprintf(f, "  ucomisd xmm0, xmm1\n");
-            fprintf(f, "  jb unit_step_%lld\n", static_cast<long long>(dependent_i));
+            fprintf(f, "  jb unit_step_%lld\n", offset(dependent_i));
             fprintf(f, "  mov rax, %s  ; 1\n", std::to_string(*reinterpret_cast<const int64_t*>(&d_1)).c_str());
-            fprintf(f, "unit_step_%lld:\n", static_cast<long long>(dependent_i));
-            fprintf(f, "  mov [rsi+%lld], rax\n", static_cast<long long>(dependent_i) * 8);
+            fprintf(f, "unit_step_%lld:\n", offset(dependent_i));
+            fprintf(f, "  mov [rsi+%lld], rax\n", offset(dependent_i) * 8);
           } else if (node.function() == MathFunction::ramp) {
             fprintf(f,
                     "  ; a[%lld] = ramp(a[%lld]);  # `ramp` is a special case.\n",
-                    static_cast<long long>(dependent_i),
-                    static_cast<long long>(node.argument_index()));
-            fprintf(f, "  movq xmm0, [rsi+%lld]\n", static_cast<long long>(node.argument_index()) * 8);
+                    offset(dependent_i),
+                    offset(node.argument_index()));
+            fprintf(f, "  movq xmm0, [rsi+%lld]\n", offset(node.argument_index()) * 8);
             fprintf(f, "  mov rax, %s  ; 0\n", std::to_string(*reinterpret_cast<const int64_t*>(&d_0)).c_str());
             fprintf(f, "  movq xmm1, rax\n");
             fprintf(f, "  ucomisd xmm0, xmm1\n");
-            fprintf(f, "  ja ramp_%lld\n", static_cast<long long>(dependent_i));
+            fprintf(f, "  ja ramp_%lld\n", offset(dependent_i));
             fprintf(f, "  movq xmm0, rax\n");
-            fprintf(f, "ramp_%lld:\n", static_cast<long long>(dependent_i));
-            fprintf(f, "  movq [rsi+%lld], xmm0\n", static_cast<long long>(dependent_i) * 8);
+            fprintf(f, "ramp_%lld:\n", offset(dependent_i));
+            fprintf(f, "  movq [rsi+%lld], xmm0\n", offset(dependent_i) * 8);
           } else {
             fprintf(f,
                     "  ; a[%lld] = %s(a[%lld]);\n",
-                    static_cast<long long>(dependent_i),
+                    offset(dependent_i),
                     function_as_string(node.function()),
-                    static_cast<long long>(node.argument_index()));
-            fprintf(f, "  movq xmm0, [rsi+%lld]\n", static_cast<long long>(node.argument_index()) * 8);
+                    offset(node.argument_index()));
+            fprintf(f, "  movq xmm0, [rsi+%lld]\n", offset(node.argument_index()) * 8);
             fprintf(f, "  push rdi\n");
             fprintf(f, "  push rsi\n");
 #ifdef CURRENT_APPLE
@@ -379,7 +407,7 @@ class JITImplementation<JIT::NASM> final {
 #endif
             fprintf(f, "  pop rsi\n");
             fprintf(f, "  pop rdi\n");
-            fprintf(f, "  movq [rsi+%lld], xmm0\n", static_cast<long long>(dependent_i) * 8);
+            fprintf(f, "  movq [rsi+%lld], xmm0\n", offset(dependent_i) * 8);
           }
         } else {
           CURRENT_ASSERT(false);
@@ -392,8 +420,8 @@ class JITImplementation<JIT::NASM> final {
 template <>
 class JITImplementation<JIT::AS> final {
  public:
-  JITImplementation(const std::string& filebase, bool has_g)
-      : filebase(filebase), f(fopen((filebase + ".s").c_str(), "w")) {
+  JITImplementation(const std::string& filebase, const jit_cache_key_t& key, bool has_g)
+      : filebase(filebase), key(key), f(fopen((filebase + ".s").c_str(), "w")) {
     CURRENT_ASSERT(f);
 
     // `.section .text' is equivalent to the `.text` directive.
@@ -417,15 +445,15 @@ class JITImplementation<JIT::AS> final {
     fprintf(f, "  push %%rbp\n");
     fprintf(f, "  mov %%rsp, %%rbp\n");
     generate_as_code_for_node(index);
-    fprintf(f, "  # return a[%lld]\n", static_cast<long long>(index));
-    fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", static_cast<long long>(index) * 8);
+    fprintf(f, "  # return a[%lld]\n", offset(index));
+    fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", offset(index) * 8);
     fprintf(f, "  mov %%rbp, %%rsp\n");
     fprintf(f, "  pop %%rbp\n");
     fprintf(f, "  ret\n");
   }
 
   void compile_eval_g(node_index_t f_index, const std::vector<node_index_t>& g_indexes) {
-    CURRENT_ASSERT(g_indexes.size() == internals_singleton().dim_);
+    CURRENT_ASSERT(g_indexes.size() == current_context().dim_);
 #ifdef CURRENT_APPLE
     fprintf(f, "_eval_g:\n");
 #else
@@ -436,10 +464,10 @@ class JITImplementation<JIT::AS> final {
     generate_as_code_for_node(f_index);
     for (size_t i = 0; i < g_indexes.size(); ++i) {
       generate_as_code_for_node(g_indexes[i]);
-      fprintf(f, "  # g[%lld] is a[%lld]\n", static_cast<long long>(i), static_cast<long long>(g_indexes[i]));
+      fprintf(f, "  # g[%lld] is a[%lld]\n", static_cast<long long>(i), offset(g_indexes[i]));
     }
-    fprintf(f, "  # return a[%lld]\n", static_cast<long long>(f_index));
-    fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", static_cast<long long>(f_index) * 8);
+    fprintf(f, "  # return a[%lld]\n", offset(f_index));
+    fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", offset(f_index) * 8);
     fprintf(f, "  mov %%rbp, %%rsp\n");
     fprintf(f, "  pop %%rbp\n");
     fprintf(f, "  ret\n");
@@ -454,7 +482,7 @@ class JITImplementation<JIT::AS> final {
 #endif
     fprintf(f, "  push %%rbp\n");
     fprintf(f, "  mov %%rsp, %%rbp\n");
-    fprintf(f, "  movabs $%lld, %%rax\n", static_cast<long long>(internals_singleton().dim_));
+    fprintf(f, "  movabs $%lld, %%rax\n", static_cast<long long>(current_context().dim_));
     fprintf(f, "  mov %%rbp, %%rsp\n");
     fprintf(f, "  pop %%rbp\n");
     fprintf(f, "  ret\n");
@@ -466,7 +494,7 @@ class JITImplementation<JIT::AS> final {
 #endif
     fprintf(f, "  push %%rbp\n");
     fprintf(f, "  mov %%rsp, %%rbp\n");
-    fprintf(f, "  movabs $%lld, %%rax\n", static_cast<long long>(max_dim + 1));
+    fprintf(f, "  movabs $%lld, %%rax\n", static_cast<long long>(key.heap_size));
     fprintf(f, "  mov %%rbp, %%rsp\n");
     fprintf(f, "  pop %%rbp\n");
     fprintf(f, "  ret\n");
@@ -478,9 +506,11 @@ class JITImplementation<JIT::AS> final {
 
  private:
   const std::string& filebase;
+  const jit_cache_key_t& key;
   FILE* f;
   std::vector<bool> computed;
-  node_index_t max_dim = 0;
+
+  long long offset(node_index_t i) const { return static_cast<long long>(key.heap_offset(i)); }
 
   // generate_as_code_for_node() writes AS code to evaluate the expression to the file.
   void generate_as_code_for_node(node_index_t index) {
@@ -493,7 +523,6 @@ class JITImplementation<JIT::AS> final {
       stack.pop();
       const node_index_t dependent_i = ~i;
       if (i > dependent_i) {
-        max_dim = std::max(max_dim, static_cast<node_index_t>(i));
         if (computed.size() <= static_cast<size_t>(i)) {
           computed.resize(static_cast<size_t>(i) + 1);
         }
@@ -502,13 +531,13 @@ class JITImplementation<JIT::AS> final {
           node_impl& node = node_vector_singleton()[i];
           if (node.type() == NodeType::variable) {
             int32_t v = node.variable();
-            fprintf(f, "  # a[%lld] = x[%d];\n", static_cast<long long>(i), v);
+            fprintf(f, "  # a[%lld] = x[%d];\n", offset(i), v);
             fprintf(f, "  mov %d(%%rdi), %%rax\n", v * 8);
-            fprintf(f, "  mov %%rax, %lld(%%rsi)\n", static_cast<long long>(i) * 8);
+            fprintf(f, "  mov %%rax, %lld(%%rsi)\n", offset(i) * 8);
           } else if (node.type() == NodeType::value) {
-            fprintf(f, "  # a[%lld] = %lf\n", static_cast<long long>(i), node.value());
+            fprintf(f, "  # a[%lld] = %lf\n", offset(i), node.value());
             fprintf(f, "  movabs $%s, %%rax\n", std::to_string(*reinterpret_cast<int64_t*>(&node.value())).c_str());
-            fprintf(f, "  mov %%rax, %lld(%%rsi)\n", static_cast<long long>(i) * 8);
+            fprintf(f, "  mov %%rax, %lld(%%rsi)\n", offset(i) * 8);
           } else if (node.type() == NodeType::operation) {
             stack.push(~i);
             stack.push(node.lhs_index());
@@ -525,54 +554,54 @@ class JITImplementation<JIT::AS> final {
         if (node.type() == NodeType::operation) {
           fprintf(f,
                   "  # a[%lld] = a[%lld] %s a[%lld];\n",
-                  static_cast<long long>(dependent_i),
-                  static_cast<long long>(node.lhs_index()),
+                  offset(dependent_i),
+                  offset(node.lhs_index()),
                   operation_as_string(node.operation()),
-                  static_cast<long long>(node.rhs_index()));
-          fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", static_cast<long long>(node.lhs_index()) * 8);
-          fprintf(f, "  movq %lld(%%rsi), %%xmm1\n", static_cast<long long>(node.rhs_index()) * 8);
+                  offset(node.rhs_index()));
+          fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", offset(node.lhs_index()) * 8);
+          fprintf(f, "  movq %lld(%%rsi), %%xmm1\n", offset(node.rhs_index()) * 8);
           fprintf(f, "  %s %%xmm1, %%xmm0\n", operation_as_assembler_opcode(node.operation()));
-          fprintf(f, "  movq %%xmm0, %lld(%%rsi)\n", static_cast<long long>(dependent_i) * 8);
+          fprintf(f, "  movq %%xmm0, %lld(%%rsi)\n", offset(dependent_i) * 8);
         } else if (node.type() == NodeType::function) {
           if (node.function() == MathFunction::sqr) {
             fprintf(f,
                     "  # a[%lld] = sqr(a[%lld]);  # `sqr` is a special case.\n",
-                    static_cast<long long>(dependent_i),
-                    static_cast<long long>(node.argument_index()));
-            fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", static_cast<long long>(node.argument_index()) * 8);
+                    offset(dependent_i),
+                    offset(node.argument_index()));
+            fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", offset(node.argument_index()) * 8);
             fprintf(f, "  mulpd %%xmm0, %%xmm0\n");
-            fprintf(f, "  movq %%xmm0, %lld(%%rsi)\n", static_cast<long long>(dependent_i) * 8);
+            fprintf(f, "  movq %%xmm0, %lld(%%rsi)\n", offset(dependent_i) * 8);
           } else if (node.function() == MathFunction::unit_step) {
             fprintf(f,
                     "  # a[%lld] = unit_step(a[%lld]);  # `unit_step` is a special case.\n",
-                    static_cast<long long>(dependent_i),
-                    static_cast<long long>(node.argument_index()));
-            fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", static_cast<long long>(node.argument_index()) * 8);
+                    offset(dependent_i),
+                    offset(node.argument_index()));
+            fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", offset(node.argument_index()) * 8);
             fprintf(f, "  movabs $%s, %%rax  # 0\n", std::to_string(*reinterpret_cast<const int64_t*>(&d_0)).c_str());
             fprintf(f, "  movq %%rax, %%xmm1\n");
             fprintf(f, "  ucomisd %%xmm1, %%xmm0\n");
             fprintf(f, "  jb . +12\n");  // NOTE(dkorolev): `. +12` skips the next `movabs`.
             fprintf(f, "  movabs $%s, %%rax #; 1\n", std::to_string(*reinterpret_cast<const int64_t*>(&d_1)).c_str());
-            fprintf(f, "  mov %%rax, %lld(%%rsi)\n", static_cast<long long>(dependent_i) * 8);
+            fprintf(f, "  mov %%rax, %lld(%%rsi)\n", offset(dependent_i) * 8);
           } else if (node.function() == MathFunction::ramp) {
             fprintf(f,
                     "  # a[%lld] = ramp(a[%lld]);  # `ramp` is a special case.\n",
-                    static_cast<long long>(dependent_i),
-                    static_cast<long long>(node.argument_index()));
-            fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", static_cast<long long>(node.argument_index()) * 8);
+                    offset(dependent_i),
+                    offset(node.argument_index()));
+            fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", offset(node.argument_index()) * 8);
             fprintf(f, "  movabs $%s, %%rax #; 0\n", std::to_string(*reinterpret_cast<const int64_t*>(&d_0)).c_str());
             fprintf(f, "  movq %%rax, %%xmm1\n");
             fprintf(f, "  ucomisd %%xmm1, %%xmm0\n");
             fprintf(f, "  ja . +7\n");  // NOTE(dkorolev): `. +7` skips the next `movq`.
             fprintf(f, "  movq %%rax, %%xmm0\n");
-            fprintf(f, "  movq %%xmm0, %lld(%%rsi)\n", static_cast<long long>(dependent_i) * 8);
+            fprintf(f, "  movq %%xmm0, %lld(%%rsi)\n", offset(dependent_i) * 8);
           } else {
             fprintf(f,
                     "  # a[%lld] = %s(a[%lld]);\n",
-                    static_cast<long long>(dependent_i),
+                    offset(dependent_i),
                     function_as_string(node.function()),
-                    static_cast<long long>(node.argument_index()));
-            fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", static_cast<long long>(node.argument_index()) * 8);
+                    offset(node.argument_index()));
+            fprintf(f, "  movq %lld(%%rsi), %%xmm0\n", offset(node.argument_index()) * 8);
             fprintf(f, "  push %%rdi\n");
             fprintf(f, "  push %%rsi\n");
 #ifdef CURRENT_APPLE
@@ -582,7 +611,7 @@ class JITImplementation<JIT::AS> final {
 #endif
             fprintf(f, "  pop %%rsi\n");
             fprintf(f, "  pop %%rdi\n");
-            fprintf(f, "  movq %%xmm0, %lld(%%rsi)\n", static_cast<long long>(dependent_i) * 8);
+            fprintf(f, "  movq %%xmm0, %lld(%%rsi)\n", offset(dependent_i) * 8);
           }
         } else {
           CURRENT_ASSERT(false);
@@ -595,8 +624,8 @@ class JITImplementation<JIT::AS> final {
 template <>
 class JITImplementation<JIT::CLANG> final {
  public:
-  JITImplementation(const std::string& filebase, bool has_g)
-      : filebase(filebase), f(fopen((filebase + ".c").c_str(), "w")) {
+  JITImplementation(const std::string& filebase, const jit_cache_key_t& key, bool has_g)
+      : filebase(filebase), key(key), f(fopen((filebase + ".c").c_str(), "w")) {
     static_cast<void>(has_g);
     CURRENT_ASSERT(f);
     fprintf(f, "#include <math.h>\n");
@@ -608,27 +637,27 @@ class JITImplementation<JIT::CLANG> final {
   void compile_eval_f(node_index_t index) {
     fprintf(f, "double eval_f(const double* x, double* a) {\n");
     generate_c_code_for_node(index);
-    fprintf(f, "  return a[%lld];\n", static_cast<long long>(index));
+    fprintf(f, "  return a[%lld];\n", offset(index));
     fprintf(f, "}\n");
   }
 
   void compile_eval_g(node_index_t f_index, const std::vector<node_index_t>& g_indexes) {
-    CURRENT_ASSERT(g_indexes.size() == internals_singleton().dim_);
+    CURRENT_ASSERT(g_indexes.size() == current_context().dim_);
     fprintf(f, "double eval_g(const double* x, double* a) {\n");
     generate_c_code_for_node(f_index);
     for (size_t i = 0; i < g_indexes.size(); ++i) {
       generate_c_code_for_node(g_indexes[i]);
     }
     for (size_t i = 0; i < g_indexes.size(); ++i) {
-      fprintf(f, "  // g[%lld] is a[%lld]\n", static_cast<long long>(i), static_cast<long long>(g_indexes[i]));
+      fprintf(f, "  // g[%lld] is a[%lld]\n", static_cast<long long>(i), offset(g_indexes[i]));
     }
-    fprintf(f, "  return a[%lld];\n", static_cast<long long>(f_index));
+    fprintf(f, "  return a[%lld];\n", offset(f_index));
     fprintf(f, "}\n");
   }
 
   ~JITImplementation() {
-    fprintf(f, "long long dim() { return %lld; }\n", static_cast<long long>(internals_singleton().dim_));
-    fprintf(f, "long long heap_size() { return %lld; }\n", static_cast<long long>(max_dim + 1));
+    fprintf(f, "long long dim() { return %lld; }\n", static_cast<long long>(current_context().dim_));
+    fprintf(f, "long long heap_size() { return %lld; }\n", static_cast<long long>(key.heap_size));
 
     fclose(f);
 
@@ -639,9 +668,11 @@ class JITImplementation<JIT::CLANG> final {
 
  private:
   const std::string& filebase;
+  const jit_cache_key_t& key;
   FILE* f;
   std::vector<bool> computed;
-  node_index_t max_dim = 0;
+
+  long long offset(node_index_t i) const { return static_cast<long long>(key.heap_offset(i)); }
 
   // generate_c_code_for_node() writes C code to evaluate the expression to the file.
   void generate_c_code_for_node(node_index_t index) {
@@ -652,7 +683,6 @@ class JITImplementation<JIT::CLANG> final {
       stack.pop();
       const node_index_t dependent_i = ~i;
       if (i > dependent_i) {
-        max_dim = std::max(max_dim, static_cast<node_index_t>(i));
         if (computed.size() <= static_cast<size_t>(i)) {
           computed.resize(static_cast<size_t>(i) + 1);
         }
@@ -661,11 +691,11 @@ class JITImplementation<JIT::CLANG> final {
           node_impl& node = node_vector_singleton()[i];
           if (node.type() == NodeType::variable) {
             int32_t v = node.variable();
-            fprintf(f, "  a[%lld] = x[%d];\n", static_cast<long long>(i), v);
+            fprintf(f, "  a[%lld] = x[%d];\n", offset(i), v);
           } else if (node.type() == NodeType::value) {
             fprintf(f,
                     "  a[%lld] = %a;  // %lf\n",  // "%a" is hexadecimal full precision.
-                    static_cast<long long>(i),
+                    offset(i),
                     node.value(),
                     node.value());  // "%a" is hexadecimal full precision.
           } else if (node.type() == NodeType::operation) {
@@ -684,16 +714,16 @@ class JITImplementation<JIT::CLANG> final {
         if (node.type() == NodeType::operation) {
           fprintf(f,
                   "  a[%lld] = a[%lld] %s a[%lld];\n",
-                  static_cast<long long>(dependent_i),
-                  static_cast<long long>(node.lhs_index()),
+                  offset(dependent_i),
+                  offset(node.lhs_index()),
                   operation_as_string(node.operation()),
-                  static_cast<long long>(node.rhs_index()));
+                  offset(node.rhs_index()));
         } else if (node.type() == NodeType::function) {
           fprintf(f,
                   "  a[%lld] = %s(a[%lld]);\n",
-                  static_cast<long long>(dependent_i),
+                  offset(dependent_i),
                   function_as_string(node.function()),
-                  static_cast<long long>(node.argument_index()));
+                  offset(node.argument_index()));
         } else {
           CURRENT_ASSERT(false);
         }
@@ -704,14 +734,12 @@ class JITImplementation<JIT::CLANG> final {
 
 template <JIT JIT_IMPLEMENTATION>
 compiled_expression compile_eval_f(node_index_t index) {
-  const std::string filebase(current::FileSystem::GenTmpFileName());
-  const std::string filename_so = filebase + ".so";
-  current::FileSystem::RmFile(filename_so, current::FileSystem::RmFileParameters::Silent);
-  {
-    JITImplementation<JIT_IMPLEMENTATION> code_generator(filebase, false);
-    code_generator.compile_eval_f(index);
-  }
-  return compiled_expression(filename_so);
+  const node_index_t simplified_index = nodes_to_compile({index}).front();
+  const jit_cache_key_t key = jit_cache_key(jit_cache_generator_name(JIT_IMPLEMENTATION, "f"), {simplified_index});
+  return compiled_expression(jit_cache().Library(key.hash, [simplified_index, &key](const std::string& filebase) {
+    JITImplementation<JIT_IMPLEMENTATION> code_generator(filebase, key, false);
+    code_generator.compile_eval_f(simplified_index);
+  }));
 }
 
 template <JIT JIT_IMPLEMENTATION>
@@ -721,14 +749,23 @@ inline compiled_expression compile_eval_f(const V& node) {
 
 template <JIT JIT_IMPLEMENTATION>
 compiled_expression compile_eval_g(node_index_t f_index, const std::vector<node_index_t>& g_indexes) {
-  const std::string filebase(current::FileSystem::GenTmpFileName());
-  const std::string filename_so = filebase + ".so";
-  current::FileSystem::RmFile(filename_so, current::FileSystem::RmFileParameters::Silent);
-  {
-    JITImplementation<JIT_IMPLEMENTATION> code_generator(filebase, true);
-    code_generator.compile_eval_g(f_index, g_indexes);
+  // Simplify the function and the gradient together, as the gradient mostly consists of the nodes of the function.
+  std::vector<node_index_t> indexes(1u, f_index);
+  indexes.insert(indexes.end(), g_indexes.begin(), g_indexes.end());
+  indexes = nodes_to_compile(indexes);
+  const std::vector<node_index_t> simplified_g_indexes(indexes.begin() + 1, indexes.end());
+  const jit_cache_key_t key = jit_cache_key(jit_cache_generator_name(JIT_IMPLEMENTATION, "g"), indexes);
+  const std::string lib_filename = jit_cache().Library(key.hash, [&](const std::string& base) {
+    JITImplementation<JIT_IMPLEMENTATION> code_generator(base, key, true);
+    code_generator.compile_eval_g(indexes.front(), simplified_g_indexes);
+  });
+  // The gradient is read from the heap, where the generated code has put it by the heap offsets of its nodes.
+  std::vector<node_index_t> gradient_heap_offsets;
+  gradient_heap_offsets.reserve(simplified_g_indexes.size());
+  for (node_index_t i : simplified_g_indexes) {
+    gradient_heap_offsets.push_back(key.heap_offset(i));
   }
-  return compiled_expression(filename_so, g_indexes);
+  return compiled_expression(lib_filename, gradient_heap_offsets);
 }
 
 template <JIT JIT_IMPLEMENTATION>
@@ -741,6 +778,19 @@ inline compiled_expression compile_eval_g(const V& f_node, const std::vector<V>&
   return compile_eval_g<JIT_IMPLEMENTATION>(f_node.index_, g_node_indexes);
 }
 
+// The functions are compiled in the context they are recorded in, which may be other than the current one.
+template <JIT JIT_IMPLEMENTATION>
+inline compiled_expression compile_eval_f(const f_impl<JIT::Blueprint>& f) {
+  const context_scope scope(f.context());
+  return compile_eval_f<JIT_IMPLEMENTATION>(f.f_);
+}
+
+template <JIT JIT_IMPLEMENTATION>
+inline compiled_expression compile_eval_g(const f_impl<JIT::Blueprint>& f, const g_impl<JIT::Blueprint>& g) {
+  const context_scope scope(g.context());
+  return compile_eval_g<JIT_IMPLEMENTATION>(f.f_, g.g_);
+}
+
 struct f_compiled_super : f_super {};
 
 template <JIT JIT_IMPLEMENTATION>
@@ -750,7 +800,7 @@ struct f_compiled final : f_compiled_super {
   explicit f_compiled(const V& node) : c_(compile_eval_f<JIT_IMPLEMENTATION>(node)) {
     CURRENT_ASSERT(c_.HasFunction());
   }
-  explicit f_compiled(const f_impl<JIT::Blueprint>& f) : c_(compile_eval_f<JIT_IMPLEMENTATION>(f.f_)) {
+  explicit f_compiled(const f_impl<JIT::Blueprint>& f) : c_(compile_eval_f<JIT_IMPLEMENTATION>(f)) {
     CURRENT_ASSERT(c_.HasFunction());
   }
 
@@ -774,14 +824,20 @@ struct f_compiled final : f_compiled_super {
 #error "Someone forgot to un-#define `FNCAS_DEBUG_NATIVE_JIT`."
 #endif
 
+// With `lanes == 1`, generates scalar SSE2 code, which evaluates one point per call.
+// With `lanes == 4`, generates 256-bit AVX code, which evaluates four points per call, for the batch mode.
+// In the latter case each input variable and each node occupy four consecutive doubles, one per point, so that
+// the node at heap index `i` lives at `[i * lanes, (i + 1) * lanes)`, and the variable `v` at `x[v * lanes + lane]`.
 struct JITCodeGenerator final {
   std::vector<uint8_t>& code;
+  const jit_cache_key_t& key;  // The nodes are placed on the heap by their `key.heap_offset()`.
   size_t const dim;  // "Pre-allocated" in the output vector, 0 for function computation, dim. of `x` for gradients.
+  size_t const lanes;
 
   std::vector<bool> computed;
-  node_index_t max_dim = 0;
 
-  JITCodeGenerator(std::vector<uint8_t>& code, size_t dim) : code(code), dim(dim) {
+  JITCodeGenerator(std::vector<uint8_t>& code, const jit_cache_key_t& key, size_t dim, size_t lanes = 1)
+      : code(code), key(key), dim(dim), lanes(lanes) {
     using namespace current::fncas::x64_native_jit;
 
     opcodes::push_rbx(code);
@@ -795,6 +851,9 @@ struct JITCodeGenerator final {
   ~JITCodeGenerator() {
     using namespace current::fncas::x64_native_jit;
 
+    if (lanes > 1) {
+      opcodes::vzeroupper(code);
+    }
     opcodes::pop_rbx(code);
     opcodes::ret(code);
 
@@ -803,6 +862,9 @@ struct JITCodeGenerator final {
 #endif
   }
 
+  // The heap address of the node: its heap offset, past the first `dim` doubles, which are the gradient.
+  size_t at(node_index_t i) const { return static_cast<size_t>(key.heap_offset(i)) + dim; }
+
   void jit_compile_node(node_index_t index) {
     using namespace current::fncas::x64_native_jit;
 
@@ -814,7 +876,6 @@ struct JITCodeGenerator final {
       stack.pop();
       const node_index_t dependent_i = ~i;
       if (i > dependent_i) {
-        max_dim = std::max(max_dim, static_cast<node_index_t>(i));
         if (computed.size() <= static_cast<size_t>(i)) {
           computed.resize(static_cast<size_t>(i) + 1);
         }
@@ -823,21 +884,28 @@ struct JITCodeGenerator final {
           node_impl& node = node_vector_singleton()[i];
           if (node.type() == NodeType::variable) {
             int32_t v = node.variable();
-            // Load input variable `v` by address `i + dim`, because the first `dim` of the output are the gradient.
+            // Load input variable `v` by address `at(i)`, because the first `dim` of the output are the gradient.
             // NOTE(dkorolev) / HACK(dkorolev): Perhaps use `rax`, not `xmm0`, for mere value transfer?
-            opcodes::load_from_memory_by_rdi_offset_to_xmm0(code, v);
-            opcodes::store_xmm0_to_memory_by_rbx_offset(code, i + dim);
+            if (lanes == 1) {
+              opcodes::load_from_memory_by_rdi_offset_to_xmm0(code, v);
+              opcodes::store_xmm0_to_memory_by_rbx_offset(code, at(i));
+            } else {
+              opcodes::load_from_memory_by_rdi_offset_to_ymm0(code, v * lanes);
+              opcodes::store_ymm0_to_memory_by_rbx_offset(code, at(i) * lanes);
+            }
 #ifdef FNCAS_DEBUG_NATIVE_JIT
-            std::cerr << "# Z[" << i << " + " << dim << "] = X[" << v << "];\n";
+            std::cerr << "# Z[" << at(i) << "] = X[" << v << "];\n";
             std::cerr << "load_from_memory_by_rdi_offset_to_xmm0(" << v << ");\n";
-            std::cerr << "store_xmm0_to_memory_by_rbx_offset(" << i + dim << ");\n";
+            std::cerr << "store_xmm0_to_memory_by_rbx_offset(" << at(i) << ");\n";
 #endif
           } else if (node.type() == NodeType::value) {
-            // Load value `node.value()` by address `i + dim`, because the first `dim` of the output are the gradient.
-            opcodes::load_immediate_to_memory_by_rbx_offset(code, i + dim, node.value());
+            // Load value `node.value()` by address `at(i)`, because the first `dim` of the output are the gradient.
+            for (size_t lane = 0; lane < lanes; ++lane) {
+              opcodes::load_immediate_to_memory_by_rbx_offset(code, at(i) * lanes + lane, node.value());
+            }
 #ifdef FNCAS_DEBUG_NATIVE_JIT
-            std::cerr << "# Z[" << i << " + " << dim << "] = " << node.value() << ";\n";
-            std::cerr << "load_immediate_to_memory_by_rbx_offset(" << i + dim << ", " << node.value() << ");\n";
+            std::cerr << "# Z[" << at(i) << "] = " << node.value() << ";\n";
+            std::cerr << "load_immediate_to_memory_by_rbx_offset(" << at(i) << ", " << node.value() << ");\n";
 #endif
           } else if (node.type() == NodeType::operation) {
             stack.push(~i);
@@ -855,49 +923,59 @@ struct JITCodeGenerator final {
         if (node.type() == NodeType::operation) {
           // Perform add/sub/mul/div, all in the operating memory, shifted by `dim`.
           auto const op = node.operation();
-          opcodes::load_from_memory_by_rbx_offset_to_xmm0(code, node.lhs_index() + dim);
+          if (lanes > 1) {
+            jit_compile_vector_operation(op, at(node.lhs_index()), at(node.rhs_index()), at(dependent_i));
+            continue;
+          }
+          opcodes::load_from_memory_by_rbx_offset_to_xmm0(code, at(node.lhs_index()));
 #ifdef FNCAS_DEBUG_NATIVE_JIT
-          std::cerr << "# Z[" << dependent_i << " + " << dim << "] = Z["
-                    << node.lhs_index() << " + " << dim << "] " << operation_as_string(op) << " Z["
-                    << node.rhs_index() << " + " << dim << "];\n";
+          std::cerr << "# Z[" << at(dependent_i) << "] = Z["
+                    << at(node.lhs_index()) << "] " << operation_as_string(op) << " Z["
+                    << at(node.rhs_index()) << "];\n";
 
-          std::cerr << "load_from_memory_by_rbx_offset_to_xmm0(" << node.lhs_index() + dim << ");\n";
+          std::cerr << "load_from_memory_by_rbx_offset_to_xmm0(" << at(node.lhs_index()) << ");\n";
 #endif
           if (op == MathOperation::add) {
-            opcodes::add_from_memory_by_rbx_offset_to_xmm0(code, node.rhs_index() + dim);
+            opcodes::add_from_memory_by_rbx_offset_to_xmm0(code, at(node.rhs_index()));
           } else if (op == MathOperation::subtract) {
-            opcodes::sub_from_memory_by_rbx_offset_to_xmm0(code, node.rhs_index() + dim);
+            opcodes::sub_from_memory_by_rbx_offset_to_xmm0(code, at(node.rhs_index()));
           } else if (op == MathOperation::multiply) {
-            opcodes::mul_from_memory_by_rbx_offset_to_xmm0(code, node.rhs_index() + dim);
+            opcodes::mul_from_memory_by_rbx_offset_to_xmm0(code, at(node.rhs_index()));
           } else if (op == MathOperation::divide) {
-            opcodes::div_from_memory_by_rbx_offset_to_xmm0(code, node.rhs_index() + dim);
+            opcodes::div_from_memory_by_rbx_offset_to_xmm0(code, at(node.rhs_index()));
           } else {
             CURRENT_ASSERT(false);
           }
-          opcodes::store_xmm0_to_memory_by_rbx_offset(code, dependent_i + dim);
+          opcodes::store_xmm0_to_memory_by_rbx_offset(code, at(dependent_i));
 #ifdef FNCAS_DEBUG_NATIVE_JIT
           std::cerr << std::string(operation_as_assembler_opcode(op)).substr(0, 3)
-                    << "_from_memory_by_rbx_offset_to_xmm0("<< node.rhs_index() + dim << ");\n";
-          std::cerr << "store_xmm0_to_memory_by_rbx_offset(" << dependent_i + dim << ");\n";
+                    << "_from_memory_by_rbx_offset_to_xmm0("<< at(node.rhs_index()) << ");\n";
+          std::cerr << "store_xmm0_to_memory_by_rbx_offset(" << at(dependent_i) << ");\n";
 #endif
         } else if (node.type() == NodeType::function) {
-          opcodes::load_from_memory_by_rbx_offset_to_xmm0(code, node.argument_index() + dim);
-          opcodes::push_rdi(code);
-          opcodes::push_rdx(code);
-          opcodes::call_function_from_rdx_pointers_array_by_index(code, static_cast<uint8_t>(node.function()));
-          opcodes::pop_rdx(code);
-          opcodes::pop_rdi(code);
-          opcodes::store_xmm0_to_memory_by_rbx_offset(code, dependent_i + dim);
+          if (lanes > 1) {
+            // The external functions are scalar, so call them once per lane, avoiding the AVX-SSE transition penalty.
+            opcodes::vzeroupper(code);
+          }
+          for (size_t lane = 0; lane < lanes; ++lane) {
+            opcodes::load_from_memory_by_rbx_offset_to_xmm0(code, at(node.argument_index()) * lanes + lane);
+            opcodes::push_rdi(code);
+            opcodes::push_rdx(code);
+            opcodes::call_function_from_rdx_pointers_array_by_index(code, static_cast<uint8_t>(node.function()));
+            opcodes::pop_rdx(code);
+            opcodes::pop_rdi(code);
+            opcodes::store_xmm0_to_memory_by_rbx_offset(code, at(dependent_i) * lanes + lane);
+          }
 #ifdef FNCAS_DEBUG_NATIVE_JIT
-          std::cerr << "# Z[" << dependent_i << " + " << dim << "] = "
-                    << function_as_string(node.function()) << "(Z[" << node.argument_index() << " + " << dim << "]);\n";
-          std::cerr << "load_from_memory_by_rbx_offset_to_xmm0(" << node.argument_index() + dim << ");\n";
+          std::cerr << "# Z[" << at(dependent_i) << "] = "
+                    << function_as_string(node.function()) << "(Z[" << at(node.argument_index()) << "]);\n";
+          std::cerr << "load_from_memory_by_rbx_offset_to_xmm0(" << at(node.argument_index()) << ");\n";
           std::cerr << "push_rdi();\n";
           std::cerr << "push_rdx();\n";
           std::cerr << "call_function_from_rdx_pointers_array_by_index(" << static_cast<int>(node.function()) << ");\n";
           std::cerr << "pop_rdx();\n";
           std::cerr << "pop_rdi();\n";
-          std::cerr << "store_xmm0_to_memory_by_rbx_offset(" << dependent_i + dim << ");\n";
+          std::cerr << "store_xmm0_to_memory_by_rbx_offset(" << at(dependent_i) << ");\n";
 #endif
         } else {
           CURRENT_ASSERT(false);
@@ -905,8 +983,46 @@ struct JITCodeGenerator final {
       }
     }
   }
+
+  void jit_compile_vector_operation(MathOperation op, size_t lhs, size_t rhs, size_t result) {
+    using namespace current::fncas::x64_native_jit;
+    opcodes::load_from_memory_by_rbx_offset_to_ymm0(code, lhs * lanes);
+    if (op == MathOperation::add) {
+      opcodes::add_from_memory_by_rbx_offset_to_ymm0(code, rhs * lanes);
+    } else if (op == MathOperation::subtract) {
+      opcodes::sub_from_memory_by_rbx_offset_to_ymm0(code, rhs * lanes);
+    } else if (op == MathOperation::multiply) {
+      opcodes::mul_from_memory_by_rbx_offset_to_ymm0(code, rhs * lanes);
+    } else if (op == MathOperation::divide) {
+      opcodes::div_from_memory_by_rbx_offset_to_ymm0(code, rhs * lanes);
+    } else {
+      CURRENT_ASSERT(false);
+    }
+    opcodes::store_ymm0_to_memory_by_rbx_offset(code, result * lanes);
+  }
+
+  // Copies the node at heap index `from` into heap index `to`, all lanes at once.
+  void jit_copy(size_t from, size_t to) {
+    using namespace current::fncas::x64_native_jit;
+    if (lanes == 1) {
+      opcodes::load_from_memory_by_rbx_offset_to_xmm0(code, from);
+      opcodes::store_xmm0_to_memory_by_rbx_offset(code, to);
+    } else {
+      opcodes::load_from_memory_by_rbx_offset_to_ymm0(code, from * lanes);
+      opcodes::store_ymm0_to_memory_by_rbx_offset(code, to * lanes);
+    }
+  }
 };
 
+inline std::vector<node_index_t> gradient_indexes(const g_impl<JIT::Blueprint>& g) {
+  std::vector<node_index_t> result;
+  result.reserve(g.g_.size());
+  for (const V& component : g.g_) {
+    result.push_back(component.index());
+  }
+  return result;
+}
+
 struct x64_native_jit_function_pointers {
   std::vector<double (*)(double x)> p;
   x64_native_jit_function_pointers() {
@@ -920,33 +1036,35 @@ struct x64_native_jit_function_pointers {
 };
 
 struct f_compiled_x64_native_jit final {
-  std::unique_ptr<current::fncas::x64_native_jit::CallableVectorUInt8> jit_compiled_code;
-  mutable std::vector<double> actual_heap;
+  jit_cache_impl::x64_code_t jit_compiled_code;  // Shared by all the instances of the same function, see `jit_cache()`.
+  size_t heap_size;  // The heap itself is per thread, so that the function can be evaluated from many threads at once.
 
   void generate_code_for_f(V const& v) {
-    std::vector<uint8_t> code;
-    size_t required_heap_size;
-    {
-      using namespace current::fncas::x64_native_jit;
-      JITCodeGenerator code_generator(code, 0);
-      code_generator.jit_compile_node(v.index());
-      opcodes::load_from_memory_by_rbx_offset_to_xmm0(code, v.index());
+    const node_index_t index = nodes_to_compile({v.index()}).front();
+    const jit_cache_key_t key = jit_cache_key(jit_cache_generator_name(JIT::X64NativeJIT, "f"), {index});
+    jit_compiled_code = jit_cache().X64Code(key.hash, [index, &key]() {
+      std::vector<uint8_t> code;
+      {
+        using namespace current::fncas::x64_native_jit;
+        JITCodeGenerator code_generator(code, key, 0);
+        code_generator.jit_compile_node(index);
+        opcodes::load_from_memory_by_rbx_offset_to_xmm0(code, code_generator.at(index));
 #ifdef FNCAS_DEBUG_NATIVE_JIT
-      std::cerr << "# return Z[" << v.index() << "];\n";
-      std::cerr << "load_from_memory_by_rbx_offset_to_xmm0(" << v.index() << ");\n";
+        std::cerr << "# return Z[" << code_generator.at(index) << "];\n";
+        std::cerr << "load_from_memory_by_rbx_offset_to_xmm0(" << code_generator.at(index) << ");\n";
 #endif
-      required_heap_size = code_generator.max_dim + 1;
-    }
+      }
 #ifdef FNCAS_DEBUG_NATIVE_JIT
-    std::cerr << "Code:";
-    for (uint8_t c : code) {
-      fprintf(stderr, " %02x", int(c));
-    }
-    std::cerr << "\nHeap size: " << required_heap_size << '\n';
-    std::cerr << "Desired index: " << v.index() << '\n';
+      std::cerr << "Code:";
+      for (uint8_t c : code) {
+        fprintf(stderr, " %02x", int(c));
+      }
+      std::cerr << "\nHeap size: " << key.heap_size << '\n';
+      std::cerr << "Desired index: " << key.heap_offset(index) << '\n';
 #endif
-    jit_compiled_code = std::make_unique<current::fncas::x64_native_jit::CallableVectorUInt8>(code);
-    actual_heap.resize(required_heap_size);
+      return code;
+    });
+    heap_size = key.heap_size;
   }
 
   explicit f_compiled_x64_native_jit(V const& node) {
@@ -954,11 +1072,13 @@ struct f_compiled_x64_native_jit final {
   }
 
   explicit f_compiled_x64_native_jit(const f_impl<JIT::Blueprint>& f) {
+    const context_scope scope(f.context());
     generate_code_for_f(f.f_);
   }
 
   double operator()(const std::vector<double>& x) const {
-    return (*jit_compiled_code)(&x[0], &actual_heap[0], &x64_native_jit_function_pointers::tls().p[0]);
+    return (*jit_compiled_code)(
+        &x[0], evaluation_buffers_singleton().heap(heap_size), &x64_native_jit_function_pointers::tls().p[0]);
   }
 
   // For backwards "compatibility" with the unit tests. -- D.K.
@@ -967,55 +1087,170 @@ struct f_compiled_x64_native_jit final {
 
 struct g_compiled_x64_native_jit final {
   size_t const dim;
-  std::unique_ptr<current::fncas::x64_native_jit::CallableVectorUInt8> jit_compiled_code;
-  mutable std::vector<double> actual_heap;
+  jit_cache_impl::x64_code_t jit_compiled_code;
+  size_t heap_size;  // The heap itself is per thread, so that the gradient can be evaluated from many threads at once.
 
-  void generate_code_for_g(JITCodeGenerator& code_generator, V const& v, size_t output_index) {
+  void generate_code_for_g(JITCodeGenerator& code_generator, node_index_t index, size_t output_index) {
     using namespace current::fncas::x64_native_jit;
-    code_generator.jit_compile_node(v.index());
-    opcodes::load_from_memory_by_rbx_offset_to_xmm0(code_generator.code, v.index() + dim);
+    code_generator.jit_compile_node(index);
+    opcodes::load_from_memory_by_rbx_offset_to_xmm0(code_generator.code, code_generator.at(index));
     opcodes::store_xmm0_to_memory_by_rbx_offset(code_generator.code, output_index);
 #ifdef FNCAS_DEBUG_NATIVE_JIT
-    std::cerr << "# G[" << output_index << "] = Z[" << v.index() << " + " << dim << "];\n";
-    std::cerr << "load_from_memory_by_rbx_offset_to_xmm0(" << v.index() + dim << ");\n";
+    std::cerr << "# G[" << output_index << "] = Z[" << code_generator.at(index) << "];\n";
+    std::cerr << "load_from_memory_by_rbx_offset_to_xmm0(" << code_generator.at(index) << ");\n";
     std::cerr << "store_xmm0_to_memory_by_rbx_offset(" << output_index << ");\n";
 #endif
   }
 
   g_compiled_x64_native_jit(const f_impl<JIT::Blueprint>& unused_f, const g_impl<JIT::Blueprint>& g)
       : dim(g.g_.size()) {
-    CURRENT_ASSERT(dim == internals_singleton().dim_);
-    std::vector<uint8_t> code;
-    {
-      JITCodeGenerator code_generator(code, dim);
-      static_cast<void>(unused_f);
-      for (size_t i = 0; i < dim; ++i) {
-        generate_code_for_g(code_generator, g.g_[i], i);
+    const context_scope scope(g.context());
+    CURRENT_ASSERT(dim == current_context().dim_);
+    static_cast<void>(unused_f);
+    const std::vector<node_index_t> g_indexes = nodes_to_compile(gradient_indexes(g));
+    const jit_cache_key_t key = jit_cache_key(jit_cache_generator_name(JIT::X64NativeJIT, "g"), g_indexes);
+    heap_size = dim + key.heap_size;
+    jit_compiled_code = jit_cache().X64Code(key.hash, [this, &g_indexes, &key]() {
+      std::vector<uint8_t> code;
+      {
+        JITCodeGenerator code_generator(code, key, dim);
+        for (size_t i = 0; i < dim; ++i) {
+          generate_code_for_g(code_generator, g_indexes[i], i);
+        }
       }
-      CURRENT_ASSERT(static_cast<size_t>(code_generator.max_dim + 1) >= dim);
-      actual_heap.resize(dim + code_generator.max_dim + 1);
-    }
 #ifdef FNCAS_DEBUG_NATIVE_JIT
-    std::cerr << "Code:";
-    for (uint8_t c : code) {
-      fprintf(stderr, " %02x", int(c));
-    }
-    std::cerr << "\nHeap size: " << actual_heap.size() << '\n';
+      std::cerr << "Code:";
+      for (uint8_t c : code) {
+        fprintf(stderr, " %02x", int(c));
+      }
+      std::cerr << "\nHeap size: " << heap_size << '\n';
 #endif
-    jit_compiled_code = std::make_unique<current::fncas::x64_native_jit::CallableVectorUInt8>(code);
+      return code;
+    });
   }
 
-  // NOTE(dkorolev): Perhaps just return a pointer to `&actual_heap[0]` to avoid a copy?
+  // NOTE(dkorolev): Perhaps just return a pointer to the heap to avoid a copy?
   // NOTE(dkorolev): This would require looking into the optimizer(s) code, I'll do it some time later.
   std::vector<double> operator()(const std::vector<double>& x) const {
-    (*jit_compiled_code)(&x[0], &actual_heap[0], &x64_native_jit_function_pointers::tls().p[0]);
-    return std::vector<double>(&actual_heap[0], &actual_heap[0] + dim);
+    double* heap = evaluation_buffers_singleton().heap(heap_size);
+    (*jit_compiled_code)(&x[0], heap, &x64_native_jit_function_pointers::tls().p[0]);
+    return std::vector<double>(heap, heap + dim);
   }
 
   // For backwards "compatibility" with the unit tests. -- D.K.
   static const char* lib_filename() { return ""; }
 };
 
+// The batch mode evaluates the function, or its gradient, on many points per call: four points per instruction stream
+// on CPUs with AVX, and one point at a time otherwise. The points are read with arbitrary strides, the variable `j`
+// of the point `i` being `x[i * point_stride + j * variable_stride]`, so that both the "point after point" layout
+// (`point_stride == dim`, `variable_stride == 1`) and the "variable after variable" one (`point_stride == 1`,
+// `variable_stride == n`) are supported with no extra copies by the caller.
+inline size_t x64_native_jit_default_batch_lanes() {
+  return current::fncas::x64_native_jit::cpu_supports_avx() ? 4u : 1u;
+}
+
+struct x64_native_jit_batch_base {
+  size_t const dim;
+  size_t const lanes;
+  jit_cache_impl::x64_code_t jit_compiled_code;
+  size_t heap_size;  // In nodes, each of them taking `lanes` doubles of the per-thread heap.
+
+  x64_native_jit_batch_base(size_t dim, size_t lanes) : dim(dim), lanes(lanes) {
+    CURRENT_ASSERT(lanes == 1u || lanes == 4u);
+  }
+
+  // Evaluates the compiled code on the points `lanes` at a time, calling `process(first_point, count, heap)` after
+  // each block. The points are transposed into the tail of the heap first, and the last block is padded
+  // with copies of the last point, as the code always evaluates all the lanes.
+  template <typename F>
+  void evaluate(const double* x, size_t n, size_t point_stride, size_t variable_stride, F&& process) const {
+    double* heap = evaluation_buffers_singleton().heap((heap_size + dim) * lanes);
+    double* input = heap + heap_size * lanes;
+    double (**functions)(double) = &x64_native_jit_function_pointers::tls().p[0];
+    for (size_t i = 0; i < n; i += lanes) {
+      const size_t count = std::min(lanes, n - i);
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        const double* point = x + (i + std::min(lane, count - 1)) * point_stride;
+        for (size_t j = 0; j < dim; ++j) {
+          input[j * lanes + lane] = point[j * variable_stride];
+        }
+      }
+      (*jit_compiled_code)(input, heap, functions);
+      process(i, count, heap);
+    }
+  }
+};
+
+struct f_compiled_x64_native_jit_batch final : x64_native_jit_batch_base {
+  node_index_t result_offset;  // The heap offset of the value of the function.
+
+  explicit f_compiled_x64_native_jit_batch(const f_impl<JIT::Blueprint>& f,
+                                           size_t lanes = x64_native_jit_default_batch_lanes())
+      : x64_native_jit_batch_base(f.dim(), lanes) {
+    const context_scope scope(f.context());
+    const node_index_t index = nodes_to_compile({f.f_.index()}).front();
+    const jit_cache_key_t key = jit_cache_key(
+        jit_cache_generator_name(JIT::X64NativeJIT, "batch f, " + current::ToString(lanes) + " lanes"), {index});
+    heap_size = key.heap_size;
+    result_offset = key.heap_offset(index);
+    jit_compiled_code = jit_cache().X64Code(key.hash, [this, index, &key]() {
+      std::vector<uint8_t> code;
+      {
+        JITCodeGenerator code_generator(code, key, 0, this->lanes);
+        code_generator.jit_compile_node(index);
+      }
+      return code;
+    });
+  }
+
+  // Writes the value of the function at the point `i` into `output[i]`.
+  void operator()(const double* x, size_t n, size_t point_stride, size_t variable_stride, double* output) const {
+    evaluate(x, n, point_stride, variable_stride, [this, output](size_t i, size_t count, const double* heap) {
+      for (size_t lane = 0; lane < count; ++lane) {
+        output[i + lane] = heap[result_offset * lanes + lane];
+      }
+    });
+  }
+};
+
+struct g_compiled_x64_native_jit_batch final : x64_native_jit_batch_base {
+  g_compiled_x64_native_jit_batch(const f_impl<JIT::Blueprint>& unused_f,
+                                  const g_impl<JIT::Blueprint>& g,
+                                  size_t lanes = x64_native_jit_default_batch_lanes())
+      : x64_native_jit_batch_base(g.g_.size(), lanes) {
+    const context_scope scope(g.context());
+    CURRENT_ASSERT(dim == current_context().dim_);
+    static_cast<void>(unused_f);
+    const std::vector<node_index_t> g_indexes = nodes_to_compile(gradient_indexes(g));
+    const jit_cache_key_t key = jit_cache_key(
+        jit_cache_generator_name(JIT::X64NativeJIT, "batch g, " + current::ToString(lanes) + " lanes"), g_indexes);
+    heap_size = dim + key.heap_size;
+    jit_compiled_code = jit_cache().X64Code(key.hash, [this, &g_indexes, &key]() {
+      std::vector<uint8_t> code;
+      {
+        JITCodeGenerator code_generator(code, key, dim, this->lanes);
+        for (size_t i = 0; i < dim; ++i) {
+          code_generator.jit_compile_node(g_indexes[i]);
+          code_generator.jit_copy(code_generator.at(g_indexes[i]), i);
+        }
+      }
+      return code;
+    });
+  }
+
+  // Writes the gradient at the point `i` into `output[i * dim]` ... `output[i * dim + dim - 1]`.
+  void operator()(const double* x, size_t n, size_t point_stride, size_t variable_stride, double* output) const {
+    evaluate(x, n, point_stride, variable_stride, [this, output](size_t i, size_t count, const double* heap) {
+      for (size_t lane = 0; lane < count; ++lane) {
+        for (size_t j = 0; j < dim; ++j) {
+          output[(i + lane) * dim + j] = heap[j * lanes + lane];
+        }
+      }
+    });
+  }
+};
+
 #endif  // FNCAS_X64_NATIVE_JIT_ENABLED
 
 struct g_compiled_super : g_super {};
@@ -1025,7 +1260,7 @@ struct g_compiled final : g_compiled_super {
   fncas::impl::compiled_expression c_;
 
   explicit g_compiled(const f_impl<JIT::Blueprint>& f, const g_impl<JIT::Blueprint>& g)
-      : c_(compile_eval_g<JIT_IMPLEMENTATION>(f.f_, g.g_)) {
+      : c_(compile_eval_g<JIT_IMPLEMENTATION>(f, g)) {
     CURRENT_ASSERT(c_.HasGradient());
   }
 
@@ -1088,6 +1323,13 @@ struct g_impl_selector<JIT::X64NativeJIT> {
 #endif  // FNCAS_X64_NATIVE_JIT_ENABLED
 
 }  // namespace fncas::impl
+
+#ifdef FNCAS_X64_NATIVE_JIT_ENABLED
+// Evaluate the JIT-compiled function, or its gradient, on many points per call, see `x64_native_jit_batch_base`.
+using batch_function_t = impl::f_compiled_x64_native_jit_batch;
+using batch_gradient_t = impl::g_compiled_x64_native_jit_batch;
+#endif  // FNCAS_X64_NATIVE_JIT_ENABLED
+
 }  // namespace fncas
 
 #endif  // FNCAS_USE_LONG_DOUBLE
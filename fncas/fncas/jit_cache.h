@@ -0,0 +1,302 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * *******************************************************************************/
+
+// The content-addressed cache of the JIT-compiled code, so that the same function is not compiled twice.
+//
+// The key is the SHA256 of the expression as it is compiled: of its nodes, simplified and renumbered in the DFS order,
+// as the generated code addresses the heap by these numbers, and of the code generator with its settings. The code
+// is cached in memory, and, once `SetDirectory()` is called or the `FNCAS_JIT_CACHE_DIR` environment variable is set,
+// on disk, as the `<key>.so` libraries and the `<key>.x64` native JIT code, so that the restarted binaries load it.
+
+#ifndef FNCAS_FNCAS_JIT_CACHE_H
+#define FNCAS_FNCAS_JIT_CACHE_H
+
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <stack>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../bricks/file/file.h"
+#include "../../bricks/strings/util.h"
+#include "../../bricks/util/random.h"
+#include "../../bricks/util/sha256.h"
+#include "../../bricks/util/singleton.h"
+
+#include "base.h"
+#include "node.h"
+#include "logger.h"
+
+namespace fncas {
+namespace impl {
+
+// Bump when the generated code changes, to not load the code generated by the previous versions of FnCAS.
+constexpr static const char* kJITCacheFormatVersion = "FnCAS JIT cache v2";
+
+// The nodes reachable from the roots are renumbered in the order of the DFS from them, so that the same expression
+// has the same key, and the same code, wherever its nodes are in the context. The generated code addresses
+// the heap by these numbers, the "heap offsets", which also keeps the heap as small as the expression.
+struct jit_cache_key_t final {
+  std::string hash;  // The hexadecimal SHA256, which is also the name of the cached file.
+  std::vector<node_index_t> heap_offsets;  // By the index of the node, -1 for the nodes not reachable from the roots.
+  node_index_t heap_size = 0;              // The number of the nodes reachable from the roots.
+
+  node_index_t heap_offset(node_index_t i) const {
+    CURRENT_ASSERT(i >= 0 && static_cast<size_t>(i) < heap_offsets.size() && heap_offsets[i] >= 0);
+    return heap_offsets[i];
+  }
+};
+
+// The key of the code generated by `generator` for the expressions of `roots` in the current context.
+inline jit_cache_key_t jit_cache_key(const std::string& generator, const std::vector<node_index_t>& roots) {
+  context_impl& context = current_context();
+  std::vector<node_impl>& node_vector = context.node_vector_;
+
+  // First, number the nodes in the order they are first reached in.
+  jit_cache_key_t result;
+  result.heap_offsets.assign(node_vector.size(), -1);
+  std::vector<node_index_t> nodes;
+  std::stack<node_index_t> stack;
+  for (auto rit = roots.rbegin(); rit != roots.rend(); ++rit) {
+    stack.push(*rit);
+  }
+  while (!stack.empty()) {
+    const node_index_t i = stack.top();
+    stack.pop();
+    if (result.heap_offsets[i] < 0) {
+      result.heap_offsets[i] = static_cast<node_index_t>(nodes.size());
+      nodes.push_back(i);
+      node_impl& node = node_vector[i];
+      if (node.type() == NodeType::operation) {
+        stack.push(node.rhs_index());
+        stack.push(node.lhs_index());
+      } else if (node.type() == NodeType::function) {
+        stack.push(node.argument_index());
+      }
+    }
+  }
+  result.heap_size = static_cast<node_index_t>(nodes.size());
+
+  // Then, hash the nodes in this order, referring to the nodes by their heap offsets only.
+  sha256_impl_by_StephanBrumme::SHA256 sha256;
+  const auto add = [&sha256](const auto& value) { sha256.add(&value, sizeof(value)); };
+  const auto add_string = [&sha256](const std::string& s) { sha256.add(s.c_str(), s.length() + 1u); };
+
+  add_string(kJITCacheFormatVersion);
+  add_string(generator);
+  // The generated code calls the functions by their indexes in `fncas_functions.dsl.h`.
+  for (size_t f = 0; f < static_cast<size_t>(MathFunction::end); ++f) {
+    add_string(function_as_string(static_cast<MathFunction>(f)));
+  }
+  add(static_cast<uint64_t>(context.dim_));
+  add(static_cast<uint64_t>(roots.size()));
+  for (node_index_t root : roots) {
+    add(result.heap_offset(root));
+  }
+  add(result.heap_size);
+  for (node_index_t i : nodes) {
+    node_impl& node = node_vector[i];
+    add(node.type());
+    if (node.type() == NodeType::variable) {
+      add(node.variable());
+    } else if (node.type() == NodeType::value) {
+      add(node.value());
+    } else if (node.type() == NodeType::operation) {
+      add(node.operation());
+      add(result.heap_offset(node.lhs_index()));
+      add(result.heap_offset(node.rhs_index()));
+    } else if (node.type() == NodeType::function) {
+      add(node.function());
+      add(result.heap_offset(node.argument_index()));
+    } else {
+      CURRENT_ASSERT(false);
+    }
+  }
+  result.hash = sha256.getHash();
+  return result;
+}
+
+class jit_cache_impl final {
+ public:
+  struct Stats final {
+    size_t memory_hits = 0u;
+    size_t disk_hits = 0u;
+    size_t misses = 0u;
+  };
+
+  jit_cache_impl() {
+    const char* const directory = std::getenv("FNCAS_JIT_CACHE_DIR");
+    if (directory && *directory) {
+      SetDirectory(directory);
+    }
+  }
+
+  // Keeps the compiled code in `directory` as well, creating it if needed. The empty one keeps it in memory only.
+  void SetDirectory(const std::string& directory) {
+    if (!directory.empty()) {
+      current::FileSystem::MkDir(directory, current::FileSystem::MkDirParameters::Silent);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+  }
+
+  std::string Directory() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return directory_;
+  }
+
+  // Forgets the code cached in memory, but not the one on disk.
+  void ClearMemory() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    libraries_.clear();
+#ifdef FNCAS_X64_NATIVE_JIT_ENABLED
+    code_.clear();
+#endif
+  }
+
+  Stats GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+  // The `.so` library for `key`, compiled by `compile(filebase)` into `filebase + ".so"` unless it is cached.
+  // The functions are compiled outside the lock, so that different threads can compile different ones at once.
+  template <typename F>
+  std::string Library(const std::string& key, F&& compile) {
+    std::string directory;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto cit = libraries_.find(key);
+      if (cit != libraries_.end()) {
+        ++stats_.memory_hits;
+        return cit->second;
+      }
+      directory = directory_;
+    }
+    const std::string cached_file_name =
+        directory.empty() ? "" : current::FileSystem::JoinPath(directory, key + ".so");
+    std::string result;
+    if (!cached_file_name.empty() && IsCached(cached_file_name)) {
+      result = cached_file_name;
+      Journal(&Stats::disk_hits, "FnCAS: Loaded the compiled code from `" + cached_file_name + "`.");
+    } else {
+      const std::string filebase = current::FileSystem::GenTmpFileName();
+      const std::string filename_so = filebase + ".so";
+      current::FileSystem::RmFile(filename_so, current::FileSystem::RmFileParameters::Silent);
+      compile(filebase);
+      result = cached_file_name.empty()
+                   ? filename_so
+                   : Store(current::FileSystem::ReadFileAsString(filename_so), cached_file_name, filename_so);
+      Journal(&Stats::misses, "FnCAS: Compiled `" + result + "`.");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return libraries_.emplace(key, result).first->second;
+  }
+
+#ifdef FNCAS_X64_NATIVE_JIT_ENABLED
+  using x64_code_t = std::shared_ptr<const current::fncas::x64_native_jit::CallableVectorUInt8>;
+
+  // The native x64 code for `key`, generated by `generate()` as an `std::vector<uint8_t>` unless it is cached.
+  template <typename F>
+  x64_code_t X64Code(const std::string& key, F&& generate) {
+    std::string directory;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto cit = code_.find(key);
+      if (cit != code_.end()) {
+        ++stats_.memory_hits;
+        return cit->second;
+      }
+      directory = directory_;
+    }
+    const std::string cached_file_name =
+        directory.empty() ? "" : current::FileSystem::JoinPath(directory, key + ".x64");
+    std::vector<uint8_t> code;
+    if (!cached_file_name.empty() && IsCached(cached_file_name)) {
+      const std::string contents = current::FileSystem::ReadFileAsString(cached_file_name);
+      code.assign(contents.begin(), contents.end());
+      Journal(&Stats::disk_hits, "FnCAS: Loaded the compiled code from `" + cached_file_name + "`.");
+    } else {
+      code = generate();
+      if (!cached_file_name.empty()) {
+        Store(std::string(code.begin(), code.end()), cached_file_name, "");
+      }
+      Journal(&Stats::misses, "FnCAS: Generated " + current::ToString(code.size()) + " bytes of native x64 code.");
+    }
+    x64_code_t result = std::make_shared<const current::fncas::x64_native_jit::CallableVectorUInt8>(code);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return code_.emplace(key, result).first->second;
+  }
+#endif  // FNCAS_X64_NATIVE_JIT_ENABLED
+
+ private:
+  mutable std::mutex mutex_;
+  std::string directory_;
+  Stats stats_;
+  std::unordered_map<std::string, std::string> libraries_;
+#ifdef FNCAS_X64_NATIVE_JIT_ENABLED
+  std::unordered_map<std::string, x64_code_t> code_;
+#endif
+
+  static bool IsCached(const std::string& file_name) {
+    try {
+      return current::FileSystem::GetFileSize(file_name) > 0u;
+    } catch (const current::FileException&) {
+      return false;
+    }
+  }
+
+  // Writes `contents` into `file_name` atomically, via a temporary file in the same directory, so that concurrently
+  // running binaries never see partially written code. Returns `fallback` if the directory is not writable.
+  static std::string Store(const std::string& contents, const std::string& file_name, const std::string& fallback) {
+    const std::string tmp_file_name = file_name + '.' + current::ToString(current::random::CSRandomUInt(0u, ~0u));
+    try {
+      current::FileSystem::WriteStringToFile(contents, tmp_file_name.c_str());
+      current::FileSystem::RenameFile(tmp_file_name, file_name);
+      return file_name;
+    } catch (const current::FileException&) {
+      current::FileSystem::RmFile(tmp_file_name, current::FileSystem::RmFileParameters::Silent);
+      OptimizerLogger().Log("FnCAS: Could not cache the compiled code in `" + file_name + "`.");
+      return fallback;
+    }
+  }
+
+  void Journal(size_t Stats::*counter, const std::string& message) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++(stats_.*counter);
+    }
+    OptimizerLogger().Log(message);
+  }
+};
+
+inline jit_cache_impl& jit_cache() { return current::Singleton<jit_cache_impl>(); }
+
+}  // namespace fncas::impl
+}  // namespace fncas
+
+#endif  // #ifndef FNCAS_FNCAS_JIT_CACHE_H
@@ -191,6 +191,169 @@ ValueAndPoint Backtracking(F&& f,
   }
 }
 
+// The point the line search has stopped at, with the gradient there, which the quasi-Newton methods need anyway.
+struct LineSearchResult {
+  ValueAndPoint value_and_point;
+  std::vector<double_t> gradient;
+};
+
+// Line search for the step along `direction` which satisfies the strong Wolfe conditions:
+// the sufficient decrease one, `f(x + t * d) <= f(x) + c1 * t * (g(x), d)`, and the curvature one,
+// `|(g(x + t * d), d)| <= c2 * |(g(x), d)|`, with 0 < c1 < c2 < 1.
+// First extends the step until the interval which contains such a step is found, and then zooms in on it,
+// picking the minimum of the quadratic interpolation, see Nocedal and Wright, "Numerical Optimization", 3.5 and 3.6.
+// The value and the gradient at `current`, which the caller has already computed, are passed in, and returned,
+// with their signs flipped if the function is maximized, so that the search always minimizes.
+template <OptimizationDirection DIRECTION, class F, class G>
+LineSearchResult StrongWolfeLineSearch(F&& f,
+                                       G&& g,
+                                       const ValueAndPoint& current,
+                                       const std::vector<double_t>& current_gradient,
+                                       const std::vector<double_t>& direction,
+                                       optimize::OptimizerStats& stats,
+                                       const double_t initial_step = 1.0,
+                                       const double_t c1 = 1e-4,
+                                       const double_t c2 = 0.9,
+                                       const size_t max_steps = 25) {
+  const double sign = (DIRECTION == OptimizationDirection::Minimize ? +1 : -1);
+  const auto& logger = OptimizerLogger();
+
+  const double_t slope = DotProduct(current_gradient, direction);
+  if (!(slope < 0)) {
+    CURRENT_THROW(exceptions::LineSearchException("The search direction is not the descent one."));
+  }
+
+  struct Step {
+    double_t t = 0.0;
+    double_t value = 0.0;
+    double_t slope = 0.0;
+    std::vector<double_t> point;
+    std::vector<double_t> gradient;
+  };
+  const auto evaluate_value = [&](Step& step) {
+    step.point = SumVectors(current.point, direction, step.t);
+    stats.JournalFunction();
+    step.value = f(step.point) * sign;
+  };
+  const auto evaluate_gradient = [&](Step& step) {
+    stats.JournalGradient();
+    step.gradient = g(step.point);
+    if (DIRECTION == OptimizationDirection::Maximize) {
+      FlipSign(step.gradient);
+    }
+    step.slope = DotProduct(step.gradient, direction);
+  };
+  const auto sufficient_decrease = [&](const Step& step) {
+    return IsNormal(step.value) && step.value <= current.value + c1 * step.t * slope;
+  };
+  const auto done = [&logger](Step& step) {
+    if (logger) {
+      logger.Log("StrongWolfeLineSearch: Final value to minimize = " + current::ToString(step.value) + ", step " +
+                 current::ToString(step.t));
+    }
+    return LineSearchResult{ValueAndPoint(step.value, step.point), std::move(step.gradient)};
+  };
+
+  // The step with the lowest value so far, for which the sufficient decrease condition holds,
+  // and the other end of the interval which contains the step satisfying both conditions, once it is found.
+  Step lo;
+  lo.value = current.value;
+  lo.slope = slope;
+  lo.point = current.point;
+  lo.gradient = current_gradient;
+  Step hi;
+  bool bracketed = false;
+
+  size_t steps = 0;
+  double_t t = initial_step;
+  while (!bracketed && steps++ < max_steps) {
+    Step next;
+    next.t = t;
+    evaluate_value(next);
+    if (!sufficient_decrease(next) || next.value >= lo.value) {
+      hi = std::move(next);
+      bracketed = true;
+    } else {
+      evaluate_gradient(next);
+      if (std::abs(next.slope) <= -c2 * slope) {
+        return done(next);
+      }
+      if (next.slope >= 0) {
+        hi = std::move(lo);
+        bracketed = true;
+      }
+      lo = std::move(next);
+      t = lo.t * 2.0;
+    }
+  }
+
+  while (bracketed && steps++ < max_steps) {
+    const double_t width = hi.t - lo.t;
+    Step next;
+    // The minimum of the parabola by the value and the slope at `lo` and the value at `hi`, unless it is too close
+    // to either end of the interval, or is not a number, in which case the interval is bisected.
+    next.t = lo.t - lo.slope * width * width / (2.0 * (hi.value - lo.value - lo.slope * width));
+    const double_t margin = 0.1 * std::abs(width);
+    if (!(next.t > std::min(lo.t, hi.t) + margin && next.t < std::max(lo.t, hi.t) - margin)) {
+      next.t = lo.t + 0.5 * width;
+    }
+    evaluate_value(next);
+    if (!sufficient_decrease(next) || next.value >= lo.value) {
+      hi = std::move(next);
+    } else {
+      evaluate_gradient(next);
+      if (std::abs(next.slope) <= -c2 * slope) {
+        return done(next);
+      }
+      if (next.slope * width >= 0) {
+        hi = std::move(lo);
+      }
+      lo = std::move(next);
+    }
+  }
+
+  if (lo.t > 0) {
+    // The function has decreased, although the curvature condition does not hold.
+    return done(lo);
+  } else {
+    if (logger) {
+      logger.Log("StrongWolfeLineSearch: No step decreasing the function found.");
+    }
+    CURRENT_THROW(exceptions::LineSearchException("No step decreasing the function found."));
+  }
+}
+
+// The search direction of the L-BFGS method: minus the gradient multiplied by the approximation of the inverse
+// Hessian, which is built from the last few steps `s[i]` and the changes of the gradient `y[i]` along them,
+// by the two-loop recursion, see Nocedal and Wright, "Numerical Optimization", 7.4.
+struct LBFGSCorrection {
+  std::vector<double_t> s;
+  std::vector<double_t> y;
+  double_t rho;  // `1 / (y, s)`.
+};
+
+inline std::vector<double_t> LBFGSDirection(const std::vector<LBFGSCorrection>& history,
+                                            const std::vector<double_t>& gradient) {
+  std::vector<double_t> q(gradient);
+  std::vector<double_t> alpha(history.size());
+  for (size_t i = history.size(); i-- > 0;) {
+    alpha[i] = history[i].rho * DotProduct(history[i].s, q);
+    q = SumVectors(q, history[i].y, -alpha[i]);
+  }
+  if (!history.empty()) {
+    // Scale the initial approximation, the identity matrix, to the curvature along the most recent step.
+    const LBFGSCorrection& last = history.back();
+    const double_t gamma = DotProduct(last.s, last.y) / L2Norm(last.y);
+    std::transform(std::begin(q), std::end(q), std::begin(q), [gamma](double_t v) { return v * gamma; });
+  }
+  for (size_t i = 0; i < history.size(); ++i) {
+    const double_t beta = history[i].rho * DotProduct(history[i].y, q);
+    q = SumVectors(q, history[i].s, alpha[i] - beta);
+  }
+  FlipSign(q);
+  return q;
+}
+
 }  // namespace fncas::impl
 }  // namespace fncas
 
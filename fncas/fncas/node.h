@@ -77,10 +77,11 @@ namespace fncas {
 namespace impl {
 
 // Parsed expressions are stored in an array of node_impl objects.
-// Instances of `node_impl` take 10 bytes each and are packed.
+// Instances of `node_impl` take 18 bytes each and are packed.
 // Each node_impl refers to a value, an input variable, an operation or math function invocation.
-// The `ThreadLocalSingleton` containing `vector<node_impl>` is the allocator, thus
-// at most one expression per thread (at most one scope of `fncas::impl::X`) can be "recorded" at a time.
+// The `vector<node_impl>` of the context is the allocator, thus at most one expression per context (at most one scope
+// of `fncas::impl::X`) can be "recorded" at a time. Each thread has its default context, and independent expressions
+// can be recorded into contexts of their own, from one thread or from many threads at once.
 
 inline const char* operation_as_string(MathOperation operation) {
   static const char* representation[static_cast<size_t>(MathOperation::end)] = {"+", "-", "*", "/"};
@@ -104,42 +105,84 @@ T apply_operation(MathOperation operation, T lhs, T rhs) {
 
 struct node_impl;
 struct X;
-struct internals_impl {
+
+// The context is the expression graph: the nodes recorded, their derivatives, and the dimensionality of the function.
+// A context is used by one thread at a time; the functions recorded into it can be evaluated from any number of threads
+// once it is no longer being recorded into or differentiated.
+struct context_impl final : noncopyable {
   // The dimensionality of the function that is currently being worked with.
-  size_t dim_;
+  size_t dim_ = 0;
 
-  // The pointer to a thread-local vector of "variables" used for expression parsing.
-  X* x_ptr_;
+  // The pointer to the vector of "variables" used for expression parsing, while it is being recorded.
+  X* x_ptr_ = nullptr;
 
   // All expression nodes created so far, with fixed indexes.
   std::vector<node_impl> node_vector_;
 
-  // Values per node computed so far.
-  std::vector<double_t> node_value_;
-  std::vector<int8_t> node_computed_;
-
   // df_[var_index][node_index] => node index for d (node[node_index]) / d (x[variable_index]), -1 if unknown.
   std::vector<std::vector<node_index_t>> df_;
 
-  // A block of RAM to be used as the buffer for externally compiled functions.
-  std::vector<double_t> heap_for_compiled_evaluations_;
-
   // A hashmap of per-immediate-value-created nodes, to not create constants such as zeroes and ones way too often.
   std::unordered_map<double_t, node_index_t> allocated_values_map_;
 
+  // Whether to simplify the expressions before compiling them, see `simplify.h`. Kept when the context is reused.
+  bool simplify_before_compilation_ = true;
+
   void reset() {
     dim_ = 0;
     x_ptr_ = nullptr;
     node_vector_.clear();
     df_.clear();
-    heap_for_compiled_evaluations_.clear();
     allocated_values_map_.clear();
   }
 };
 
-inline internals_impl& internals_singleton() { return current::ThreadLocalSingleton<internals_impl>(); }
+// The default context of this thread, and the context which the expressions are currently recorded into by it.
+struct thread_contexts final : noncopyable {
+  context_impl default_context;
+  context_impl* current = &default_context;
+};
+
+inline thread_contexts& thread_contexts_singleton() { return current::ThreadLocalSingleton<thread_contexts>(); }
+
+inline context_impl& current_context() { return *thread_contexts_singleton().current; }
+
+inline std::vector<node_impl>& node_vector_singleton() { return current_context().node_vector_; }
+
+// Makes `context` the current one for this thread for the lifetime of the scope. The scopes must be nested.
+class context_scope final : noncopyable {
+ public:
+  explicit context_scope(context_impl& context) : previous_(thread_contexts_singleton().current) {
+    thread_contexts_singleton().current = &context;
+  }
+  ~context_scope() { thread_contexts_singleton().current = previous_; }
+
+ private:
+  context_impl* const previous_;
+};
+
+// The per-thread memory to evaluate the functions in, so that the same function, recorded or compiled, can be evaluated
+// from many threads at once.
+struct evaluation_buffers final : noncopyable {
+  // Values per node computed so far, and the context they are computed for.
+  const context_impl* context_ = nullptr;
+  std::vector<double_t> node_value_;
+  std::vector<int8_t> node_computed_;
+
+  // A block of RAM to be used as the buffer for externally compiled functions.
+  std::vector<double_t> heap_for_compiled_evaluations_;
 
-inline std::vector<node_impl>& node_vector_singleton() { return internals_singleton().node_vector_; }
+  double_t* heap(size_t size) {
+    if (heap_for_compiled_evaluations_.size() < size) {
+      heap_for_compiled_evaluations_.resize(size);
+    }
+    return &heap_for_compiled_evaluations_[0];
+  }
+};
+
+inline evaluation_buffers& evaluation_buffers_singleton() {
+  return current::ThreadLocalSingleton<evaluation_buffers>();
+}
 
 struct node_impl {
   uint8_t data_[18];
@@ -178,14 +221,18 @@ static_assert(sizeof(node_impl) == 18, "sizeof(node_impl) should be 18. Check st
 // eval_node() should use manual stack implementation to avoid SEGFAULT. Using plain recursion
 // will overflow the stack for every formula containing repeated operation on the top level.
 enum class reuse_cache : int8_t { invalidate = 0, reuse = 1 };
-inline double_t eval_node(node_index_t index,
+inline double_t eval_node(context_impl& context,
+                          node_index_t index,
                           const std::vector<double_t>& x,
                           reuse_cache reuse = reuse_cache::invalidate) {
-  std::vector<double_t>& node_value = internals_singleton().node_value_;
-  std::vector<int8_t>& B = internals_singleton().node_computed_;
-  if (reuse == reuse_cache::invalidate) {
+  evaluation_buffers& buffers = evaluation_buffers_singleton();
+  std::vector<double_t>& node_value = buffers.node_value_;
+  std::vector<int8_t>& B = buffers.node_computed_;
+  if (reuse == reuse_cache::invalidate || buffers.context_ != &context) {
     B.clear();
+    buffers.context_ = &context;
   }
+  std::vector<node_impl>& node_vector = context.node_vector_;
   std::stack<node_index_t> stack;
   stack.push(index);
   while (!stack.empty()) {
@@ -194,7 +241,7 @@ inline double_t eval_node(node_index_t index,
     const node_index_t dependent_i = ~i;
     if (i > dependent_i) {
       if (!growing_vector_access(B, i, static_cast<int8_t>(false))) {
-        node_impl& f = node_vector_singleton()[i];
+        node_impl& f = node_vector[i];
         if (f.type() == NodeType::variable) {
           const int32_t v = f.variable();
           CURRENT_ASSERT(v >= 0 && v < static_cast<int32_t>(x.size()));
@@ -217,7 +264,7 @@ inline double_t eval_node(node_index_t index,
         }
       }
     } else {
-      node_impl& f = node_vector_singleton()[dependent_i];
+      node_impl& f = node_vector[dependent_i];
       if (f.type() == NodeType::operation) {
         growing_vector_access(node_value, dependent_i, 0.0) =
             apply_operation<double_t>(f.operation(), node_value[f.lhs_index()], node_value[f.rhs_index()]);
@@ -236,8 +283,14 @@ inline double_t eval_node(node_index_t index,
   return node_value[index];
 }
 
+inline double_t eval_node(node_index_t index,
+                          const std::vector<double_t>& x,
+                          reuse_cache reuse = reuse_cache::invalidate) {
+  return eval_node(current_context(), index, x, reuse);
+}
+
 // The code that deals with nodes directly uses class V as a wrapper to node_impl.
-// Since the storage for node_impl-s is global, class V just holds an index of node_impl.
+// Since the storage for node_impl-s is the current context, class V just holds an index of node_impl.
 // User code that defines the function to work with is effectively dealing with class V objects:
 // arithmetical and mathematical operations are overloaded for class V.
 
@@ -252,7 +305,7 @@ struct node_index_allocator {
     node_vector_singleton().resize(index_ + 1);
   }
   node_index_allocator(allocate_for_double, double_t value) {
-    std::unordered_map<double_t, node_index_t>& map = internals_singleton().allocated_values_map_;
+    std::unordered_map<double_t, node_index_t>& map = current_context().allocated_values_map_;
     auto const cit = map.find(value);
     if (cit != map.end()) {
       index_ = cit->second;
@@ -408,33 +461,40 @@ namespace impl {
 struct X final : std::vector<V>, noncopyable {
   using super_t = std::vector<V>;
 
-  explicit X(size_t dim) {
+  // Records the expression into the default context of this thread.
+  explicit X(size_t dim) : X(thread_contexts_singleton().default_context, dim) {}
+
+  // Records the expression into `context`, which is made the current one of this thread for the lifetime of `X`.
+  X(context_impl& context, size_t dim) : context_(context), scope_(context) {
     CURRENT_ASSERT(dim > 0);
-    auto& meta = internals_singleton();
-    if (meta.x_ptr_) {
+    if (context_.x_ptr_) {
       CURRENT_THROW(exceptions::FnCASConcurrentEvaluationAttemptException());
     }
-    CURRENT_ASSERT(!meta.dim_);
     // Invalidates cached functions, resets temp nodes enumeration from zero and frees cache memory.
-    meta.reset();
-    meta.x_ptr_ = this;
-    meta.dim_ = dim;
+    context_.reset();
+    context_.x_ptr_ = this;
+    context_.dim_ = dim;
 
     // Initialize the actual `vector<V>`.
-    super_t::resize(internals_singleton().dim_);
+    super_t::resize(dim);
     for (size_t i = 0; i < super_t::size(); ++i) {
       super_t::operator[](i) = V::create_variable_node(i);
     }
   }
 
+  // The recorded functions, along with their `dim_`, stay in the context until it is recorded into again.
   virtual ~X() {
-    auto& meta = internals_singleton();
-    if (meta.x_ptr_ == this) {
+    if (context_.x_ptr_ == this) {
       // The condition is required to correctly handle the case when the constructor did `throw`.
-      meta.x_ptr_ = nullptr;
-      meta.dim_ = 0;
+      context_.x_ptr_ = nullptr;
     }
   }
+
+  context_impl& context() const { return context_; }
+
+ private:
+  context_impl& context_;
+  const context_scope scope_;
 };
 
 // Class "f_super" is the placeholder for function evaluators.
@@ -466,24 +526,31 @@ struct f_impl<JIT::NativeWrapper> final : f_super {
 template <>
 struct f_impl<JIT::Blueprint> final : f_super {
   const V f_;
-  f_impl(const V& f) : f_(f) {}
-  f_impl(f_impl&& rhs) : f_(rhs.f_) {}
+  context_impl& context_;  // The context `f_` is recorded in.
+  const size_t dim_;
+  f_impl(const V& f) : f_(f), context_(current_context()), dim_(context_.dim_) {}
+  f_impl(f_impl&& rhs) : f_(rhs.f_), context_(rhs.context_), dim_(rhs.dim_) {}
   double_t operator()(const std::vector<double_t>& x) const override {
     CURRENT_ASSERT(x.size() == dim());
-    return f_(x);
+    return eval_node(context_, f_.index_, x);
+  }
+  std::string debug_as_string() const {
+    const context_scope scope(context_);
+    return f_.debug_as_string();
   }
-  std::string debug_as_string() const { return f_.debug_as_string(); }
   // Template is used here as a form of forward declaration.
   template <typename TX>
   V differentiate(const TX& x_ref, size_t variable_index) const {
     static_assert(std::is_same_v<TX, X>,
                   "f_impl<JIT::Blueprint>::differentiate(const x& x, size_t variable_index);");
-    CURRENT_ASSERT(&x_ref == internals_singleton().x_ptr_);
+    CURRENT_ASSERT(&x_ref == context_.x_ptr_);
     CURRENT_ASSERT(variable_index >= 0);
     CURRENT_ASSERT(variable_index < dim());
+    const context_scope scope(context_);
     return f_.template differentiate<X>(x_ref, variable_index);
   }
-  size_t dim() const override { return internals_singleton().dim_; }
+  context_impl& context() const { return context_; }
+  size_t dim() const override { return dim_; }
 };
 
 // Helper code to enable JIT-based `f_impl`-s to be exposed as `fncas::function_t`.
@@ -590,11 +657,16 @@ using term_vector_t = std::vector<term_t>;
 // Extends `term_vector_t` to be used as the "default" parameter to user functions.
 // Passing a `variables_vector_t x(10)` as the parameter stands for "record the expression of this function
 // assuming it takes a 10-dimensional vector as the parameter".
-// The instance of the `variables_vector_t` is what maintains the state of the thread-local singleton corresponding
-// to the function being recorded, and thus at most one `variables_vector_t` per thread can exist at any given
-// point in time.
+// The instance of the `variables_vector_t` is what maintains the state of the context corresponding to the function
+// being recorded, and thus at most one `variables_vector_t` per context can exist at any given point in time.
+// By default, it is the default context of the thread; `variables_vector_t x(context, dim)` records into `context`.
 using variables_vector_t = impl::X;
 
+// The expression graph to record, differentiate and compile the functions in, independently of other contexts.
+// Each thread has a default one, which is used unless the context is passed in to `variables_vector_t` explicitly.
+// The context must outlive the functions recorded into it, except the compiled ones.
+using context_t = impl::context_impl;
+
 template <JIT JIT_IMPLEMENTATION = JIT::Super>
 using function_t = typename impl::f_impl_selector<JIT_IMPLEMENTATION>::type;
 
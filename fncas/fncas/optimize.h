@@ -39,6 +39,7 @@ SOFTWARE.
 #include "mathutil.h"
 #include "node.h"
 #include "jit.h"
+#include "thread_pool.h"
 
 #include "../../bricks/template/decay.h"
 #include "../../typesystem/struct.h"
@@ -184,13 +185,28 @@ class OptimizerParameters {
     return *this;
   }
 
+  // Compile the expressions as recorded, not simplified first, see `simplify.h`.
+  OptimizerParameters& DisableSimplification() {
+    simplification_enabled_ = false;
+    return *this;
+  }
+
+  // Evaluate the objective function, and its gradient, as the sum of `threads` parts, each on its own thread.
+  // The objective function must be sum-decomposable, see `IsSumDecomposable` below.
+  OptimizerParameters& EvaluateInParallel(size_t threads) {
+    parallel_evaluation_threads_ = threads;
+    return *this;
+  }
+
   OptimizerParameters& TrackOptimizationProgress() {
     track_optimization_progress_ = true;
     return *this;
   }
 
   bool IsJITEnabled() const { return jit_enabled_; }
+  bool IsSimplificationEnabled() const { return simplification_enabled_; }
   bool ShouldTrackProgress() const { return track_optimization_progress_; }
+  size_t ParallelEvaluationThreads() const { return parallel_evaluation_threads_; }
 
   OptimizerParameters& SetPointBeautifier(point_beautifier_t point_beautifier) {
     point_beautifier_ = point_beautifier;
@@ -211,7 +227,9 @@ class OptimizerParameters {
   point_beautifier_t point_beautifier_;
   stopping_criterion_t stopping_criterion_;
   bool jit_enabled_ = true;
+  bool simplification_enabled_ = true;
   bool track_optimization_progress_ = false;
+  size_t parallel_evaluation_threads_ = 0u;
 };
 
 // The base class for the optimizer of the function of type `F`.
@@ -277,6 +295,110 @@ class Optimizer : impl::noncopyable {
 template <typename IMPL, OptimizationDirection DIRECTION>
 struct OptimizeImpl;
 
+// The objective function is sum-decomposable if it defines `ObjectiveFunctionPart(x, part, parts)`, so that
+// `ObjectiveFunction(x)` is the sum of `ObjectiveFunctionPart(x, part, parts)` for `part` in `[0, parts)`, for any
+// `parts`. Such a function, and its gradient, can be evaluated as the sums of the parts, each on its own thread.
+template <class F, typename = void>
+struct IsSumDecomposable : std::false_type {};
+
+template <class F>
+struct IsSumDecomposable<F,
+                         std::void_t<decltype(std::declval<const F&>().ObjectiveFunctionPart(
+                             std::declval<const std::vector<double_t>&>(), size_t(0), size_t(1)))>> : std::true_type {};
+
+// The parts of the sum-decomposable objective function, each recorded into its own context, differentiated,
+// and, with `jit`, compiled on its own thread, and then evaluated, along with its gradient, on that thread too.
+// The sums are taken in the order of the parts, so that the result does not depend on the timing of the threads.
+template <class F, JIT JIT_IMPLEMENTATION>
+class ParallelObjectiveFunction final : impl::noncopyable {
+ public:
+  ParallelObjectiveFunction(const F& objective_function, size_t dim, size_t threads, bool jit, bool simplify)
+      : pool_(threads), parts_(threads) {
+    pool_.run(parts_.size(), [this, &objective_function, dim, jit, simplify](size_t i) {
+      Part& part = parts_[i];
+      part.context.simplify_before_compilation_ = simplify;
+      const impl::X x(part.context, dim);
+      const auto f_i = std::make_shared<const impl::f_impl<JIT::Blueprint>>(
+          ExtractValueFromObjectiveFunctionValue(objective_function.ObjectiveFunctionPart(x, i, parts_.size())));
+      const auto g_i = std::make_shared<const impl::g_impl<JIT::Blueprint>>(x, *f_i);
+      if (!jit) {
+        part.f = [f_i](const std::vector<double_t>& p) { return (*f_i)(p); };
+        part.g = [g_i](const std::vector<double_t>& p) { return (*g_i)(p); };
+      } else {
+#ifdef FNCAS_JIT_COMPILED
+        if constexpr (JIT_IMPLEMENTATION != JIT::Blueprint) {
+          const auto f = std::make_shared<const fncas::function_t<JIT_IMPLEMENTATION>>(*f_i);
+          const auto g = std::make_shared<const fncas::gradient_t<JIT_IMPLEMENTATION>>(*f_i, *g_i);
+          part.f = [f](const std::vector<double_t>& p) { return (*f)(p); };
+          part.g = [g](const std::vector<double_t>& p) { return (*g)(p); };
+        }
+#else
+        std::cerr << "Attempted to use FnCAS JIT when it's not compiled into the binary. Check your -D flags.\n";
+        std::exit(-1);
+#endif
+      }
+    });
+  }
+
+  double_t Value(const std::vector<double_t>& x) {
+    pool_.run(parts_.size(), [this, &x](size_t i) { parts_[i].value = parts_[i].f(x); });
+    double_t result = 0.0;
+    for (const Part& part : parts_) {
+      result += part.value;
+    }
+    return result;
+  }
+
+  std::vector<double_t> Gradient(const std::vector<double_t>& x) {
+    pool_.run(parts_.size(), [this, &x](size_t i) { parts_[i].gradient = parts_[i].g(x); });
+    std::vector<double_t> result(x.size());
+    for (const Part& part : parts_) {
+      result = impl::SumVectors(result, part.gradient);
+    }
+    return result;
+  }
+
+ private:
+  struct Part final {
+    impl::context_impl context;
+    std::function<double_t(const std::vector<double_t>&)> f;
+    std::function<std::vector<double_t>(const std::vector<double_t>&)> g;
+    double_t value;
+    std::vector<double_t> gradient;
+  };
+  impl::thread_pool pool_;
+  std::vector<Part> parts_;
+};
+
+// Runs the optimization algorithm on the sum-decomposable objective function evaluated in parallel,
+// see `OptimizerParameters::EvaluateInParallel()`.
+template <class IMPL, OptimizationDirection DIRECTION, JIT JIT_IMPLEMENTATION, class F>
+OptimizationResult OptimizeInParallel(const Optimizer<F, DIRECTION>& optimizer,
+                                      const std::vector<double_t>& starting_point) {
+  if constexpr (!IsSumDecomposable<F>::value) {
+    static_cast<void>(optimizer);
+    static_cast<void>(starting_point);
+    CURRENT_THROW(exceptions::FnCASOptimizationException(
+        "Evaluating in parallel requires the objective function to define `ObjectiveFunctionPart()`."));
+  } else {
+    const auto& logger = impl::OptimizerLogger();
+    const OptimizerParameters& parameters = Value(optimizer.Parameters());
+    const size_t threads = parameters.ParallelEvaluationThreads();
+    const bool jit = JIT_IMPLEMENTATION != fncas::JIT::Blueprint && parameters.IsJITEnabled();
+    logger.Log("Optimizer: Preparing the objective function as the sum of " + current::ToString(threads) +
+               " parts, " + (jit ? "compiled" : "not compiled") + ", on as many threads.");
+    const auto prepare_begin = current::time::Now();
+    ParallelObjectiveFunction<F, JIT_IMPLEMENTATION> objective(
+        optimizer.Function(), starting_point.size(), threads, jit, parameters.IsSimplificationEnabled());
+    logger.Log("Optimizer: Done preparing the objective function, took " +
+               current::ToString((current::time::Now() - prepare_begin).count() * 1e-6) + " seconds.");
+    const auto f = [&objective](const std::vector<double_t>& x) { return objective.Value(x); };
+    const auto g = [&objective](const std::vector<double_t>& x) { return objective.Gradient(x); };
+    return OptimizeImpl<IMPL, DIRECTION>::template RunOptimize<F>(
+        optimizer, optimizer.Function(), f, g, starting_point);
+  }
+}
+
 template <class F, OptimizationDirection DIRECTION, JIT JIT_IMPLEMENTATION, class IMPL>
 class OptimizeInvoker : public Optimizer<F, DIRECTION> {
  public:
@@ -284,10 +406,18 @@ class OptimizeInvoker : public Optimizer<F, DIRECTION> {
   using super_t::super_t;
 
   OptimizationResult Optimize(const std::vector<double_t>& starting_point) const override {
+    if (Exists(super_t::Parameters()) && Value(super_t::Parameters()).ParallelEvaluationThreads() > 1u) {
+      return OptimizeInParallel<IMPL, DIRECTION, JIT_IMPLEMENTATION>(*this, starting_point);
+    }
+
     const auto& logger = impl::OptimizerLogger();
     const auto& objective_function = super_t::Function();
 
-    const fncas::impl::X gradient_helper(starting_point.size());
+    // The objective function is recorded into a context of its own, independent of whatever this thread records.
+    fncas::impl::context_impl context;
+    context.simplify_before_compilation_ =
+        !Exists(super_t::Parameters()) || Value(super_t::Parameters()).IsSimplificationEnabled();
+    const fncas::impl::X gradient_helper(context, starting_point.size());
     // The `ExtractValueFromObjectiveFunctionValue` construct makes sure the user-defined objective function
     // can return either `T` or `ObjectiveFunctionValue<T>`. The original code enabled `ObjectiveFunctionValue<T>`
     // to be silently cast into `T`, but that proved to be error-prone with respect to the user forgetting
@@ -355,10 +485,16 @@ class OptimizeInvoker<F, DIRECTION, fncas::JIT::Blueprint, IMPL> : public Optimi
   using super_t::super_t;
 
   OptimizationResult Optimize(const std::vector<double_t>& starting_point) const override {
+    if (Exists(super_t::Parameters()) && Value(super_t::Parameters()).ParallelEvaluationThreads() > 1u) {
+      return OptimizeInParallel<IMPL, DIRECTION, fncas::JIT::Blueprint>(*this, starting_point);
+    }
+
     const auto& logger = impl::OptimizerLogger();
     const auto& objective_function = super_t::Function();
 
-    const fncas::impl::X gradient_helper(starting_point.size());
+    // The objective function is recorded into a context of its own, independent of whatever this thread records.
+    fncas::impl::context_impl context;
+    const fncas::impl::X gradient_helper(context, starting_point.size());
     // NOTE(dkorolev): Here, `fncas::impl::X` is magically cast into `std::vector<fncas::impl::V>`.
     const fncas::impl::f_impl<JIT::Blueprint> f_i(objective_function.ObjectiveFunction(gradient_helper));
     logger.Log("Optimizer: The objective function is " + current::ToString(impl::node_vector_singleton().size()) +
@@ -824,6 +960,187 @@ struct OptimizeImpl<ConjugateGradientOptimizerSelector, DIRECTION> {
   }
 };
 
+// Limited-memory BFGS optimizer: the quasi-Newton method, which approximates the inverse Hessian by the last few
+// steps and the changes of the gradient along them, with the line search satisfying the strong Wolfe conditions.
+// Searches for a local minimum of `F::ObjectiveFunction` function.
+struct LBFGSOptimizerSelector;
+
+template <class F,
+          OptimizationDirection DIRECTION = OptimizationDirection::Minimize,
+          JIT JIT_IMPLEMENTATION = JIT::Default>
+class LBFGSOptimizer final : public OptimizeInvoker<F, DIRECTION, JIT_IMPLEMENTATION, LBFGSOptimizerSelector> {
+ public:
+  using super_t = OptimizeInvoker<F, DIRECTION, JIT_IMPLEMENTATION, LBFGSOptimizerSelector>;
+  using super_t::super_t;
+};
+
+template <OptimizationDirection DIRECTION>
+struct OptimizeImpl<LBFGSOptimizerSelector, DIRECTION> {
+  template <typename ORIGINAL_F, typename F, typename G>
+  static OptimizationResult RunOptimize(const Optimizer<ORIGINAL_F, DIRECTION>& super,
+                                        const ORIGINAL_F& original_f,
+                                        F&& f,
+                                        G&& g,
+                                        const std::vector<double_t>& starting_point) {
+    const auto& logger = impl::OptimizerLogger();
+
+    size_t min_steps = 3;               // Minimum number of optimization steps (ignoring early stopping).
+    size_t max_steps = 250;             // Maximum number of optimization steps.
+    size_t history = 10;                // The number of the last steps to approximate the inverse Hessian by.
+    double_t wolfe_c1 = 1e-4;           // The sufficient decrease parameter of the line search.
+    double_t wolfe_c2 = 0.9;            // The curvature parameter of the line search.
+    size_t line_search_max_steps = 25;  // Maximum number of the line search steps.
+    double_t grad_eps = 1e-8;           // Magnitude of gradient for early stopping.
+    double_t min_absolute_per_step_improvement = 1e-25;  // Terminate early if the absolute improvement is small.
+    double_t min_relative_per_step_improvement = 1e-25;  // Terminate early if the relative improvement is small.
+    double_t no_improvement_steps_to_terminate = 2;      // Wait for this # of consecutive no improvement iterations.
+
+    bool track_progress = false;
+
+    if (Exists(super.Parameters())) {
+      const auto& parameters = Value(super.Parameters());
+      min_steps = parameters.GetValue("min_steps", min_steps);
+      max_steps = parameters.GetValue("max_steps", max_steps);
+      history = parameters.GetValue("lbfgs_history", history);
+      wolfe_c1 = parameters.GetValue("wolfe_c1", wolfe_c1);
+      wolfe_c2 = parameters.GetValue("wolfe_c2", wolfe_c2);
+      line_search_max_steps = parameters.GetValue("line_search_max_steps", line_search_max_steps);
+      grad_eps = parameters.GetValue("grad_eps", grad_eps);
+      min_relative_per_step_improvement =
+          parameters.GetValue("min_relative_per_step_improvement", min_relative_per_step_improvement);
+      min_absolute_per_step_improvement =
+          parameters.GetValue("min_absolute_per_step_improvement", min_absolute_per_step_improvement);
+      no_improvement_steps_to_terminate =
+          parameters.GetValue("no_improvement_steps_to_terminate", no_improvement_steps_to_terminate);
+
+      track_progress = parameters.ShouldTrackProgress();
+    }
+
+    ValueAndPoint current(f(starting_point), starting_point);
+    logger.Log("LBFGSOptimizer: Original objective function = " + current::ToString(current.value));
+    if (!fncas::IsNormal(current.value)) {
+      CURRENT_THROW(exceptions::FnCASOptimizationException("!fncas::IsNormal(current.value)"));
+    }
+
+    OptimizationProgress progress;
+
+    std::vector<double_t> current_gradient = g(current.point);
+
+    if (DIRECTION == OptimizationDirection::Maximize) {
+      current.value *= -1;
+      fncas::impl::FlipSign(current_gradient);
+    }
+
+    std::vector<impl::LBFGSCorrection> corrections;
+
+    logger.Log("LBFGSOptimizer: Begin at " + super.PointAsString(starting_point));
+    size_t iteration;
+    int no_improvement_steps = 0;
+    {
+      OptimizerStats stats("LBFGSOptimizer");
+      for (iteration = 0; iteration < max_steps; ++iteration) {
+        if (super.StoppingCriterionSatisfied(iteration, current, current_gradient) ==
+            EarlyStoppingCriterion::StopOptimization) {
+          logger.Log("LBFGSOptimizer: External stopping criterion satisfied, terminating.");
+          break;
+        }
+
+        if (track_progress) {
+          progress.TrackIteration(original_f.ObjectiveFunction(current.point));
+        }
+
+        stats.JournalIteration();
+        if (logger) {
+          // `PointAsString()` is an expensive call, don't make it if `logger` is not initialized.
+          logger.Log("LBFGSOptimizer: Iteration " + current::ToString(iteration + 1) + ", OF = " +
+                     current::ToString(current.value) + " @ " + super.PointAsString(current.point));
+        }
+
+        // Simple early stopping by the norm of the gradient.
+        const double_t gradient_norm = std::sqrt(impl::L2Norm(current_gradient));
+        if (gradient_norm < grad_eps && iteration >= min_steps) {
+          logger.Log("LBFGSOptimizer: Terminating due to small gradient norm.");
+          break;
+        }
+
+        std::vector<double_t> direction = impl::LBFGSDirection(corrections, current_gradient);
+        if (!(impl::DotProduct(direction, current_gradient) < 0)) {
+          // The approximation has lost its positive definiteness, start over against the gradient.
+          corrections.clear();
+          direction = impl::LBFGSDirection(corrections, current_gradient);
+        }
+        // With no curvature information yet, make the first step of unit length.
+        const double_t initial_step = corrections.empty() ? std::min(1.0, 1.0 / gradient_norm) : 1.0;
+
+        try {
+          impl::LineSearchResult next = impl::StrongWolfeLineSearch<DIRECTION>(f,
+                                                                               g,
+                                                                               current,
+                                                                               current_gradient,
+                                                                               direction,
+                                                                               stats,
+                                                                               initial_step,
+                                                                               wolfe_c1,
+                                                                               wolfe_c2,
+                                                                               line_search_max_steps);
+
+          impl::LBFGSCorrection correction;
+          correction.s = impl::SumVectors(next.value_and_point.point, current.point, -1.0);
+          correction.y = impl::SumVectors(next.gradient, current_gradient, -1.0);
+          const double_t sy = impl::DotProduct(correction.s, correction.y);
+          // Keep the approximation positive definite: skip the steps along which the function is not convex enough.
+          if (sy > 1e-10 * std::sqrt(impl::L2Norm(correction.s) * impl::L2Norm(correction.y))) {
+            correction.rho = 1.0 / sy;
+            corrections.push_back(std::move(correction));
+            if (corrections.size() > history) {
+              corrections.erase(corrections.begin());
+            }
+          }
+
+          if (NoImprovement(next.value_and_point,
+                            current,
+                            min_relative_per_step_improvement,
+                            min_absolute_per_step_improvement)) {
+            ++no_improvement_steps;
+            if (no_improvement_steps >= no_improvement_steps_to_terminate) {
+              logger.Log("LBFGSOptimizer: Terminating due to no improvement.");
+              break;
+            }
+          } else {
+            no_improvement_steps = 0;
+          }
+
+          current = std::move(next.value_and_point);
+          current_gradient = std::move(next.gradient);
+        } catch (const exceptions::LineSearchException&) {
+          if (corrections.empty()) {
+            logger.Log("LBFGSOptimizer: Terminating due to no line search step possible.");
+            break;
+          }
+          logger.Log("LBFGSOptimizer: No line search step possible, starting over against the gradient.");
+          corrections.clear();
+        }
+      }
+    }
+
+    if (DIRECTION == OptimizationDirection::Maximize) {
+      current.value *= -1;
+    }
+
+    logger.Log("LBFGSOptimizer: Result = " + super.PointAsString(current.point));
+    logger.Log("LBFGSOptimizer: Objective function = " + current::ToString(current.value));
+
+    OptimizationResult result(current);
+    result.optimization_iterations = iteration;
+
+    if (track_progress) {
+      result.progress = std::move(progress);
+    }
+
+    return result;
+  }
+};
+
 template <class F,
           OptimizationDirection DIRECTION = OptimizationDirection::Minimize,
           JIT JIT_IMPLEMENTATION = JIT::Default>
@@ -0,0 +1,222 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * *******************************************************************************/
+
+// Simplification of the expression graph before it is compiled: common subexpression elimination, constant folding,
+// and the algebraic simplifications that keep the value of every node, bit for bit, save for `x * 0`, which is `0`
+// here, as it is when differentiating.
+
+#ifndef FNCAS_FNCAS_SIMPLIFY_H
+#define FNCAS_FNCAS_SIMPLIFY_H
+
+#include <cmath>
+#include <cstring>
+#include <stack>
+#include <unordered_map>
+#include <vector>
+
+#include "base.h"
+#include "node.h"
+
+namespace fncas {
+namespace impl {
+
+// The node with its arguments replaced by their simplified counterparts, to find the equivalent nodes by.
+struct simplified_node_key final {
+  NodeType type;
+  uint8_t code;  // The `MathOperation`, or the `MathFunction`, or zero.
+  int64_t lhs;   // The argument(s), or the index of the variable, or the bits of the value.
+  int64_t rhs;
+  bool operator==(const simplified_node_key& rhs_key) const {
+    return type == rhs_key.type && code == rhs_key.code && lhs == rhs_key.lhs && rhs == rhs_key.rhs;
+  }
+};
+
+struct simplified_node_key_hash final {
+  size_t operator()(const simplified_node_key& key) const {
+    size_t hash = static_cast<size_t>(key.type) * 0x9e3779b97f4a7c15ull + key.code;
+    hash = hash * 0x9e3779b97f4a7c15ull + static_cast<size_t>(key.lhs);
+    hash = hash * 0x9e3779b97f4a7c15ull + static_cast<size_t>(key.rhs);
+    return hash ^ (hash >> 29);
+  }
+};
+
+// The number of distinct nodes the expressions of `roots` consist of.
+inline size_t count_nodes(context_impl& context, const std::vector<node_index_t>& roots) {
+  std::vector<node_impl>& node_vector = context.node_vector_;
+  std::vector<bool> visited(node_vector.size());
+  size_t result = 0u;
+  std::stack<node_index_t> stack;
+  for (node_index_t root : roots) {
+    stack.push(root);
+  }
+  while (!stack.empty()) {
+    const node_index_t i = stack.top();
+    stack.pop();
+    if (!visited[i]) {
+      visited[i] = true;
+      ++result;
+      node_impl& node = node_vector[i];
+      if (node.type() == NodeType::operation) {
+        stack.push(node.lhs_index());
+        stack.push(node.rhs_index());
+      } else if (node.type() == NodeType::function) {
+        stack.push(node.argument_index());
+      }
+    }
+  }
+  return result;
+}
+
+// Simplifies the expressions of `roots`, returning the indexes of the nodes to compute them by instead.
+//
+// * Structurally identical nodes, such as the many `exp(...)`-s of the gradient, are merged into one.
+// * The operations on constants, and the functions of constants, are folded into constants.
+// * `x + 0`, `0 + x`, `x - 0`, `x * 1`, `1 * x`, `x / 1` are `x`, and `x * 0`, `0 * x` are `0`.
+// * `sqr(x)` is `x * x`, and `x / c` is `x * (1 / c)` where `c` is a power of two, so that `1 / c` is exact.
+//
+// The nodes are updated in place to refer to the simplified arguments, so that the values of all the nodes,
+// and thus of the already recorded and differentiated functions, stay the same. The constants folded into are added
+// to the context, so, as with differentiating, the context should not be used from other threads meanwhile.
+inline std::vector<node_index_t> simplify_nodes(context_impl& context, const std::vector<node_index_t>& roots) {
+  const context_scope scope(context);
+  std::vector<node_impl>& node_vector = context.node_vector_;  // The reference stays valid, its elements do not.
+
+  std::vector<node_index_t> simplified(node_vector.size(), static_cast<node_index_t>(-1));
+  std::unordered_map<simplified_node_key, node_index_t, simplified_node_key_hash> unique_nodes;
+
+  const auto unique = [&unique_nodes](const simplified_node_key& key, node_index_t i) -> node_index_t {
+    return unique_nodes.emplace(key, i).first->second;
+  };
+  const auto is_value = [&node_vector](node_index_t i, double_t value) {
+    return node_vector[i].type() == NodeType::value && node_vector[i].value() == value;
+  };
+  const auto constant = [&](double_t value) -> node_index_t {
+    const node_index_t i = V(value).index();
+    growing_vector_access(simplified, i, static_cast<node_index_t>(-1));
+    int64_t bits;
+    static_assert(sizeof(bits) == sizeof(double), "");
+    std::memcpy(&bits, &value, sizeof(double));
+    const node_index_t result = unique({NodeType::value, 0u, bits, 0}, i);
+    simplified[result] = result;
+    return result;
+  };
+
+  std::stack<node_index_t> stack;
+  for (node_index_t root : roots) {
+    stack.push(root);
+  }
+  while (!stack.empty()) {
+    const node_index_t i = stack.top();
+    stack.pop();
+    const node_index_t dependent_i = ~i;
+    if (i > dependent_i) {
+      if (simplified[i] == -1) {
+        node_impl& node = node_vector[i];
+        if (node.type() == NodeType::variable) {
+          simplified[i] = unique({NodeType::variable, 0u, node.variable(), 0}, i);
+        } else if (node.type() == NodeType::value) {
+          const node_index_t value_index = constant(node.value());
+          simplified[i] = value_index;
+        } else if (node.type() == NodeType::operation) {
+          stack.push(~i);
+          stack.push(node.lhs_index());
+          stack.push(node.rhs_index());
+        } else if (node.type() == NodeType::function) {
+          stack.push(~i);
+          stack.push(node.argument_index());
+        } else {
+          CURRENT_ASSERT(false);
+        }
+      }
+    } else if (simplified[dependent_i] == -1) {
+      // Both the arguments may have been pushed onto the stack, yet the node may have already been simplified.
+      node_index_t result = -1;
+      if (node_vector[dependent_i].type() == NodeType::function) {
+        const node_index_t x = simplified[node_vector[dependent_i].argument_index()];
+        node_vector[dependent_i].argument_index() = x;
+        const MathFunction function = node_vector[dependent_i].function();
+        if (node_vector[x].type() == NodeType::value) {
+          result = constant(::fncas::apply_function<double_t>(function, node_vector[x].value()));
+        } else if (function == MathFunction::sqr) {
+          node_impl& node = node_vector[dependent_i];
+          node.type() = NodeType::operation;
+          node.operation() = MathOperation::multiply;
+          node.lhs_index() = x;
+          node.rhs_index() = x;
+        } else {
+          result = unique({NodeType::function, static_cast<uint8_t>(function), x, 0}, dependent_i);
+        }
+      }
+      if (result == -1) {
+        node_index_t a = simplified[node_vector[dependent_i].lhs_index()];
+        node_index_t b = simplified[node_vector[dependent_i].rhs_index()];
+        MathOperation operation = node_vector[dependent_i].operation();
+        if (node_vector[a].type() == NodeType::value && node_vector[b].type() == NodeType::value) {
+          result = constant(apply_operation<double_t>(operation, node_vector[a].value(), node_vector[b].value()));
+        } else if (operation == MathOperation::add) {
+          result = is_value(b, 0) ? a : is_value(a, 0) ? b : -1;
+        } else if (operation == MathOperation::subtract) {
+          result = is_value(b, 0) ? a : -1;
+        } else if (operation == MathOperation::multiply) {
+          result = is_value(a, 0) ? a : is_value(b, 0) ? b : is_value(b, 1) ? a : is_value(a, 1) ? b : -1;
+        } else if (operation == MathOperation::divide) {
+          if (is_value(b, 1)) {
+            result = a;
+          } else if (node_vector[b].type() == NodeType::value) {
+            int exponent;
+            const double_t value = node_vector[b].value();
+            if (std::isnormal(value) && std::isnormal(1.0 / value) && std::abs(std::frexp(value, &exponent)) == 0.5) {
+              operation = MathOperation::multiply;
+              b = constant(1.0 / value);
+            }
+          }
+        }
+        if (result == -1) {
+          node_impl& node = node_vector[dependent_i];
+          node.operation() = operation;
+          node.lhs_index() = a;
+          node.rhs_index() = b;
+          if ((operation == MathOperation::add || operation == MathOperation::multiply) && b < a) {
+            std::swap(a, b);  // To merge `x + y` and `y + x`, which are the same, bit for bit.
+          }
+          result = unique({NodeType::operation, static_cast<uint8_t>(operation), a, b}, dependent_i);
+        }
+      }
+      growing_vector_access(simplified, dependent_i, static_cast<node_index_t>(-1)) = result;
+    }
+  }
+
+  std::vector<node_index_t> result;
+  result.reserve(roots.size());
+  for (node_index_t root : roots) {
+    result.push_back(simplified[root]);
+  }
+  return result;
+}
+
+}  // namespace fncas::impl
+}  // namespace fncas
+
+#endif  // #ifndef FNCAS_FNCAS_SIMPLIFY_H
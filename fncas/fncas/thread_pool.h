@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * *******************************************************************************/
+
+// The threads to evaluate the parts of the sum-decomposable objective functions with, see `optimize.h`.
+
+#ifndef FNCAS_FNCAS_THREAD_POOL_H
+#define FNCAS_FNCAS_THREAD_POOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base.h"
+
+namespace fncas {
+namespace impl {
+
+// Runs `job(i)` for each `i` in `[0, n)` on `threads` threads, the calling one being one of them. The threads are kept
+// for the lifetime of the pool, so that their thread-local evaluation buffers are allocated once, not per job.
+class thread_pool final : noncopyable {
+ public:
+  explicit thread_pool(size_t threads) {
+    for (size_t i = 1; i < threads; ++i) {
+      threads_.emplace_back([this]() { worker(); });
+    }
+  }
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t threads() const { return threads_.size() + 1u; }
+
+  // Returns once all the `job(i)`-s are done, rethrowing the first exception thrown by any of them.
+  void run(size_t n, const std::function<void(size_t)>& job) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = &job;
+    n_ = n;
+    next_ = 0u;
+    done_ = 0u;
+    exception_ = nullptr;
+    work_.notify_all();
+    while (next_ < n_) {
+      run_next(lock);
+    }
+    done_all_.wait(lock, [this]() { return done_ == n_; });
+    job_ = nullptr;
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable work_;
+  std::condition_variable done_all_;
+  const std::function<void(size_t)>* job_ = nullptr;
+  size_t n_ = 0u;
+  size_t next_ = 0u;
+  size_t done_ = 0u;
+  std::exception_ptr exception_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+
+  // Takes the next `i` to run the job for, and runs it with the mutex unlocked.
+  void run_next(std::unique_lock<std::mutex>& lock) {
+    const std::function<void(size_t)>& job = *job_;
+    const size_t i = next_++;
+    lock.unlock();
+    std::exception_ptr exception;
+    try {
+      job(i);
+    } catch (...) {
+      exception = std::current_exception();
+    }
+    lock.lock();
+    if (exception && !exception_) {
+      exception_ = exception;
+    }
+    if (++done_ == n_) {
+      done_all_.notify_all();
+    }
+  }
+
+  void worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      work_.wait(lock, [this]() { return stop_ || (job_ && next_ < n_); });
+      if (stop_) {
+        return;
+      }
+      run_next(lock);
+    }
+  }
+};
+
+}  // namespace fncas::impl
+}  // namespace fncas
+
+#endif  // #ifndef FNCAS_FNCAS_THREAD_POOL_H
@@ -66,7 +66,7 @@ static_assert(std::is_same<typename fncas::term_vector_t::value_type, fncas::ter
 // To accomplish the above, `std::vector<fncas::term_t>` is overridden accordingly.
 static_assert(std::is_same<fncas::term_vector_t, std::vector<fncas::term_t>>::value, "");
 
-// And the `fncas::impl::X` type is the lifetime of the function to thread-locally analyze.
+// And the `fncas::impl::X` type is the lifetime of the function to analyze within its context.
 // It's derived from the now-custom `std::vector<fncas::term_t>`.
 static_assert(std::is_base_of_v<fncas::term_vector_t, fncas::variables_vector_t>, "");
 
@@ -256,6 +256,106 @@ TEST(FnCAS, CannotEvaluateMoreThanOneFunctionPerThreadAtOnce) {
   ASSERT_THROW(fncas::variables_vector_t x(2), fncas::exceptions::FnCASConcurrentEvaluationAttemptException);
 }
 
+TEST(FnCAS, SeveralContextsInOneThread) {
+  fncas::context_t context1;
+  fncas::context_t context2;
+  std::unique_ptr<fncas::function_t<fncas::JIT::Blueprint>> f1;
+  std::unique_ptr<fncas::function_t<fncas::JIT::Blueprint>> f2;
+  std::unique_ptr<fncas::gradient_t<fncas::JIT::Blueprint>> g1;
+  std::unique_ptr<fncas::gradient_t<fncas::JIT::Blueprint>> g2;
+  {
+    fncas::variables_vector_t x1(context1, 2);
+    f1 = std::make_unique<fncas::function_t<fncas::JIT::Blueprint>>(ParametrizedFunction(x1, 2));
+    {
+      // Another function can be recorded while the first one is, as long as it is recorded into another context.
+      fncas::variables_vector_t x2(context2, 2);
+      f2 = std::make_unique<fncas::function_t<fncas::JIT::Blueprint>>(ParametrizedFunction(x2, 3));
+      ASSERT_THROW(fncas::variables_vector_t(context2, 1),
+                   fncas::exceptions::FnCASConcurrentEvaluationAttemptException);
+      // And so can the one of the default context of this thread.
+      fncas::variables_vector_t x3(1);
+      EXPECT_EQ(4.0, fncas::function_t<fncas::JIT::Blueprint>(x3[0] * x3[0])({2.0}));
+    }
+    // The first function is still being recorded, and can be differentiated.
+    g1 = std::make_unique<fncas::gradient_t<fncas::JIT::Blueprint>>(x1, *f1);
+  }
+  // The second one can be differentiated once its `variables_vector_t` is gone, and then both can still be evaluated.
+  g2 = std::make_unique<fncas::gradient_t<fncas::JIT::Blueprint>>(*f2);
+  EXPECT_EQ(2u, f1->dim());
+  EXPECT_EQ(2u, f2->dim());
+  EXPECT_EQ(25, (*f1)({1.0, 2.0}));
+  EXPECT_EQ(49, (*f2)({1.0, 2.0}));
+  EXPECT_EQ("((x[0]+(x[1]*2))*(x[0]+(x[1]*2)))", f1->debug_as_string());
+  EXPECT_EQ("((x[0]+(x[1]*3))*(x[0]+(x[1]*3)))", f2->debug_as_string());
+  EXPECT_EQ(std::vector<fncas::double_t>({10, 20}), (*g1)({1.0, 2.0}));
+  EXPECT_EQ(std::vector<fncas::double_t>({14, 42}), (*g2)({1.0, 2.0}));
+#ifdef FNCAS_JIT_COMPILED
+  const fncas::function_t<fncas::JIT::Default> f1_compiled(*f1);
+  const fncas::gradient_t<fncas::JIT::Default> g2_compiled(*f2, *g2);
+  EXPECT_EQ(25, f1_compiled({1.0, 2.0}));
+  EXPECT_EQ(std::vector<fncas::double_t>({14, 42}), g2_compiled({1.0, 2.0}));
+#endif  // FNCAS_JIT_COMPILED
+}
+
+TEST(FnCAS, ContextsInConcurrentThreads) {
+  // Each thread records, differentiates, compiles, and evaluates its own functions, in its own context.
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([t]() {
+      for (size_t i = 0; i < 50; ++i) {
+        const size_t c = t * 100 + i + 1;
+        fncas::context_t context;
+        fncas::variables_vector_t x(context, 2);
+        const fncas::function_t<fncas::JIT::Blueprint> f = ParametrizedFunction(x, c);
+        const fncas::gradient_t<fncas::JIT::Blueprint> g(x, f);
+        EXPECT_EQ(fncas::sqr(1.0 + 2.0 * c), f({1.0, 2.0}));
+        EXPECT_EQ(2.0 * (1.0 + 2.0 * c) * c, g({1.0, 2.0})[1]);
+#ifdef FNCAS_JIT_COMPILED
+        const fncas::function_t<fncas::JIT::Default> f_compiled(f);
+        const fncas::gradient_t<fncas::JIT::Default> g_compiled(f, g);
+        EXPECT_EQ(fncas::sqr(1.0 + 2.0 * c), f_compiled({1.0, 2.0}));
+        EXPECT_EQ(2.0 * (1.0 + 2.0 * c) * c, g_compiled({1.0, 2.0})[1]);
+#endif  // FNCAS_JIT_COMPILED
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // The functions recorded, and compiled, once, are then evaluated from several threads at once.
+  fncas::context_t context;
+  std::unique_ptr<fncas::function_t<fncas::JIT::Blueprint>> f;
+  std::unique_ptr<fncas::gradient_t<fncas::JIT::Blueprint>> g;
+  {
+    fncas::variables_vector_t x(context, 2);
+    f = std::make_unique<fncas::function_t<fncas::JIT::Blueprint>>(ParametrizedFunction(x, 3));
+    g = std::make_unique<fncas::gradient_t<fncas::JIT::Blueprint>>(x, *f);
+  }
+#ifdef FNCAS_JIT_COMPILED
+  const fncas::function_t<fncas::JIT::Default> f_compiled(*f);
+  const fncas::gradient_t<fncas::JIT::Default> g_compiled(*f, *g);
+#endif  // FNCAS_JIT_COMPILED
+  threads.clear();
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = 0; i < 1000; ++i) {
+        const std::vector<fncas::double_t> p({static_cast<fncas::double_t>(t), static_cast<fncas::double_t>(i)});
+        const fncas::double_t d = p[0] + 3 * p[1];
+        EXPECT_EQ(d * d, (*f)(p));
+        EXPECT_EQ(std::vector<fncas::double_t>({2 * d, 6 * d}), (*g)(p));
+#ifdef FNCAS_JIT_COMPILED
+        EXPECT_EQ(d * d, f_compiled(p));
+        EXPECT_EQ(std::vector<fncas::double_t>({2 * d, 6 * d}), g_compiled(p));
+#endif  // FNCAS_JIT_COMPILED
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 // An obviously convex function with a single minimum `f(3, 4) == 1`.
 struct StaticFunction {
   template <typename T>
@@ -336,6 +436,35 @@ struct HimmelblauFunction {
   }
 };
 
+// The extended Rosenbrock function, of an even number of variables, with global minimum `f(1, 1, ..., 1) == 0`.
+// Sum-decomposable, to be evaluated in parallel, as the sum of the parts of its terms.
+struct ExtendedRosenbrockFunction {
+  template <typename T>
+  T ObjectiveFunctionPart(const std::vector<T>& x, size_t part, size_t parts) const {
+    const size_t n = x.size() / 2;
+    T result = 0.0;
+    for (size_t i = n * part / parts; i < n * (part + 1) / parts; ++i) {
+      const auto d1 = (1.0 - x[2 * i]);
+      const auto d2 = (x[2 * i + 1] - x[2 * i] * x[2 * i]);
+      result += d1 * d1 + 100.0 * d2 * d2;
+    }
+    return result;
+  }
+  template <typename T>
+  T ObjectiveFunction(const std::vector<T>& x) const {
+    return ObjectiveFunctionPart(x, 0, 1);
+  }
+};
+
+// The standard starting point for the extended Rosenbrock function, `(-1.2, 1, -1.2, 1, ...)`.
+inline std::vector<double> ExtendedRosenbrockStartingPoint(size_t dim) {
+  std::vector<double> result(dim);
+  for (size_t i = 0; i < dim; ++i) {
+    result[i] = (i % 2) ? 1.0 : -1.2;
+  }
+  return result;
+}
+
 #ifdef FNCAS_JIT_COMPILED
 TEST(FnCAS, JITOptimizationOfAStaticFunctionWith) {
   const auto result = fncas::optimize::GradientDescentOptimizer<StaticFunction>().Optimize({0, 0});
@@ -545,6 +674,37 @@ TEST(FnCAS, JITOptimizationOfHimmelblauUsingConjugateGradient) {
   EXPECT_NEAR(3.584428, min4.point[0], 1e-6);
   EXPECT_NEAR(-1.848126, min4.point[1], 1e-6);
 }
+
+TEST(FnCAS, JITOptimizationOfRosenbrockUsingLBFGS) {
+  const auto result = fncas::optimize::LBFGSOptimizer<RosenbrockFunction>().Optimize({-3.0, -4.0});
+  EXPECT_NEAR(0.0, result.value, 1e-6);
+  ASSERT_EQ(2u, result.point.size());
+  EXPECT_NEAR(1.0, result.point[0], 1e-6);
+  EXPECT_NEAR(1.0, result.point[1], 1e-6);
+}
+
+TEST(FnCAS, JITOptimizationOfHimmelblauUsingLBFGS) {
+  fncas::optimize::LBFGSOptimizer<HimmelblauFunction> optimizer;
+  const auto min1 = optimizer.Optimize({5.0, 5.0});
+  EXPECT_NEAR(0.0, min1.value, 1e-6);
+  ASSERT_EQ(2u, min1.point.size());
+  EXPECT_NEAR(3.0, min1.point[0], 1e-6);
+  EXPECT_NEAR(2.0, min1.point[1], 1e-6);
+}
+
+TEST(FnCAS, JITOptimizationOfExtendedRosenbrockUsingLBFGSInParallel) {
+  const std::vector<double> starting_point = ExtendedRosenbrockStartingPoint(100);
+  for (size_t threads : {1u, 2u, 4u}) {
+    const auto result = fncas::optimize::LBFGSOptimizer<ExtendedRosenbrockFunction>(
+                            fncas::optimize::OptimizerParameters().EvaluateInParallel(threads))
+                            .Optimize(starting_point);
+    EXPECT_NEAR(0.0, result.value, 1e-9) << threads;
+    ASSERT_EQ(100u, result.point.size());
+    for (double x : result.point) {
+      EXPECT_NEAR(1.0, x, 1e-4) << threads;
+    }
+  }
+}
 #endif  // FNCAS_JIT_COMPILED
 
 TEST(FnCAS, OptimizationOfAPolynomialMemberFunctionNoJIT) {
@@ -662,6 +822,63 @@ TEST(FnCAS, ConjugateGDvsBacktrackingGDOnRosenbrockFunction100StepsNoJIT) {
   EXPECT_NEAR(1.0, result_cg.point[1], 1e-6);
 }
 
+TEST(FnCAS, OptimizationOfRosenbrockUsingLBFGSNoJIT) {
+  const auto result = fncas::optimize::LBFGSOptimizer<RosenbrockFunction>(
+                          fncas::optimize::OptimizerParameters().DisableJIT()).Optimize({-3.0, -4.0});
+  EXPECT_NEAR(0.0, result.value, 1e-6);
+  ASSERT_EQ(2u, result.point.size());
+  EXPECT_NEAR(1.0, result.point[0], 1e-6);
+  EXPECT_NEAR(1.0, result.point[1], 1e-6);
+}
+
+// Check that L-BFGS converges in fewer iterations than the conjugate gradient method, on the Rosenbrock function,
+// and on the extended one, of 20 variables, which the conjugate gradient method does not minimize in 1000 iterations.
+TEST(FnCAS, LBFGSvsConjugateGDOnRosenbrockFunctionsNoJIT) {
+  {
+    fncas::optimize::OptimizerParameters params;
+    params.DisableJIT();
+    const auto result_lbfgs = fncas::optimize::LBFGSOptimizer<RosenbrockFunction>(params).Optimize({-3.0, -4.0});
+    const auto result_cg =
+        fncas::optimize::ConjugateGradientOptimizer<RosenbrockFunction>(params).Optimize({-3.0, -4.0});
+    EXPECT_NEAR(1.0, result_lbfgs.point[0], 1e-6);
+    EXPECT_NEAR(1.0, result_lbfgs.point[1], 1e-6);
+    EXPECT_NEAR(1.0, result_cg.point[0], 1e-6);
+    EXPECT_NEAR(1.0, result_cg.point[1], 1e-6);
+    EXPECT_LT(result_lbfgs.optimization_iterations, result_cg.optimization_iterations);
+  }
+  {
+    fncas::optimize::OptimizerParameters params;
+    params.SetValue("max_steps", 1000);
+    params.DisableJIT();
+    const std::vector<double> starting_point = ExtendedRosenbrockStartingPoint(20);
+    const auto result_lbfgs =
+        fncas::optimize::LBFGSOptimizer<ExtendedRosenbrockFunction>(params).Optimize(starting_point);
+    const auto result_cg =
+        fncas::optimize::ConjugateGradientOptimizer<ExtendedRosenbrockFunction>(params).Optimize(starting_point);
+    EXPECT_NEAR(0.0, result_lbfgs.value, 1e-9);
+    EXPECT_LT(result_lbfgs.value, result_cg.value);
+    EXPECT_LT(result_lbfgs.optimization_iterations, result_cg.optimization_iterations);
+  }
+}
+
+TEST(FnCAS, OptimizationInParallelNoJIT) {
+  const std::vector<double> starting_point = ExtendedRosenbrockStartingPoint(20);
+  fncas::optimize::OptimizerParameters params;
+  params.DisableJIT();
+  const auto sequential = fncas::optimize::LBFGSOptimizer<ExtendedRosenbrockFunction>(params).Optimize(starting_point);
+  params.EvaluateInParallel(3);
+  const auto parallel = fncas::optimize::LBFGSOptimizer<ExtendedRosenbrockFunction>(params).Optimize(starting_point);
+  EXPECT_NEAR(sequential.value, parallel.value, 1e-9);
+  ASSERT_EQ(20u, parallel.point.size());
+  for (size_t i = 0; i < 20u; ++i) {
+    EXPECT_NEAR(1.0, parallel.point[i], 1e-4);
+  }
+
+  // The functions which are not sum-decomposable can not be evaluated in parallel.
+  EXPECT_THROW(fncas::optimize::LBFGSOptimizer<RosenbrockFunction>(params).Optimize({-3.0, -4.0}),
+               fncas::exceptions::FnCASOptimizationException);
+}
+
 // To test evaluation and differentiation.
 template <typename T>
 T ZeroOrXFunction(const std::vector<T> x) {
@@ -819,6 +1036,19 @@ TEST(FnCAS, OptimizationInMaximizingDirection) {
     EXPECT_NEAR(6.0, result.point[0], 5e-2);
     EXPECT_NEAR(7.0, result.point[1], 5e-2);
   }
+
+  {
+    MemberFunction f;
+    f.a = 8.0;
+    f.b = 9.0;
+    f.k = -1;
+    const auto result = fncas::optimize::LBFGSOptimizer<MemberFunction, fncas::OptimizationDirection::Maximize>(
+                            fncas::optimize::OptimizerParameters().DisableJIT(), f).Optimize({0, 0});
+    EXPECT_NEAR(-1, result.value, 1e-3);
+    ASSERT_EQ(2u, result.point.size());
+    EXPECT_NEAR(8.0, result.point[0], 5e-2);
+    EXPECT_NEAR(9.0, result.point[1], 5e-2);
+  }
 }
 
 #ifdef FNCAS_X64_NATIVE_JIT_ENABLED
@@ -1043,4 +1273,205 @@ TEST(FnCASGradientSimplification, Smoke) {
   }
 }
 
+template <typename T>
+T BatchTestFunction(const std::vector<T>& x) {
+  EXPECT_EQ(3u, x.size());
+  return x[0] * x[1] - x[2] / (fncas::sqr(x[0]) + 1.0) + fncas::log(fncas::exp(x[1] - x[2]) + 1.0) +
+         fncas::ramp(x[2]);
+}
+
+TEST(FnCASX64NativeJIT, BatchEvaluation) {
+  const fncas::variables_vector_t x(3);
+  const fncas::function_t<fncas::JIT::Blueprint> fi = BatchTestFunction(x);
+  const fncas::gradient_t<fncas::JIT::Blueprint> gi(x, fi);
+  const fncas::function_t<fncas::JIT::X64NativeJIT> fc(fi);
+  const fncas::gradient_t<fncas::JIT::X64NativeJIT> gc(fi, gi);
+
+  // Seven points, to have the last block of four partially filled, in both the "point after point" layout,
+  // and in the "variable after variable" one.
+  const size_t n = 7u;
+  std::vector<std::vector<double>> points;
+  std::vector<double> point_after_point;
+  std::vector<double> variable_after_variable(3u * n);
+  for (size_t i = 0; i < n; ++i) {
+    points.push_back({0.5 * i - 1.0, 2.0 - 0.25 * i, 0.75 * i - 2.5});
+    for (size_t j = 0; j < 3u; ++j) {
+      point_after_point.push_back(points[i][j]);
+      variable_after_variable[j * n + i] = points[i][j];
+    }
+  }
+
+  std::vector<size_t> lanes({1u});
+  if (current::fncas::x64_native_jit::cpu_supports_avx()) {
+    lanes.push_back(4u);
+  }
+  for (size_t l : lanes) {
+    const fncas::batch_function_t fb(fi, l);
+    const fncas::batch_gradient_t gb(fi, gi, l);
+    for (bool transposed : {false, true}) {
+      const double* data = transposed ? &variable_after_variable[0] : &point_after_point[0];
+      const size_t point_stride = transposed ? 1u : 3u;
+      const size_t variable_stride = transposed ? n : 1u;
+      std::vector<double> values(n);
+      std::vector<double> gradients(3u * n);
+      fb(data, n, point_stride, variable_stride, &values[0]);
+      gb(data, n, point_stride, variable_stride, &gradients[0]);
+      for (size_t i = 0; i < n; ++i) {
+        EXPECT_DOUBLE_EQ(fc(points[i]), values[i]) << l << ' ' << transposed << ' ' << i;
+        EXPECT_DOUBLE_EQ(BatchTestFunction(points[i]), values[i]) << l << ' ' << transposed << ' ' << i;
+        const std::vector<double> g = gc(points[i]);
+        for (size_t j = 0; j < 3u; ++j) {
+          EXPECT_DOUBLE_EQ(g[j], gradients[i * 3u + j]) << l << ' ' << transposed << ' ' << i << ' ' << j;
+        }
+      }
+    }
+  }
+}
+
+
+TEST(FnCASSimplification, FoldsConstantsAndSimplifies) {
+  fncas::context_t context;
+  const fncas::variables_vector_t x(context, 2);
+  const fncas::term_t zero = fncas::exp(fncas::term_t(0.0)) - 1.0;
+  const fncas::function_t<fncas::JIT::Blueprint> f =
+      (x[0] * 1.0 + 0.0) * (fncas::term_t(2.0) * 3.0) + fncas::sqr(x[1]) / 4.0 + zero;
+  EXPECT_EQ("(((((x[0]*1)+0)*(2*3))+(sqr(x[1])/4))+(exp(0)-1))", f.debug_as_string());
+  EXPECT_EQ(17u, fncas::impl::count_nodes(context, {f.f_.index()}));
+
+  const fncas::impl::node_index_t simplified = fncas::impl::simplify_nodes(context, {f.f_.index()}).front();
+  EXPECT_EQ("((x[0]*6)+((x[1]*x[1])*0.25))", fncas::impl::V(fncas::impl::from_index(simplified)).debug_as_string());
+  EXPECT_EQ(8u, fncas::impl::count_nodes(context, {simplified}));
+
+  // The original nodes are updated in place, and keep their values.
+  EXPECT_EQ(6.0 * 3.0 + 0.25 * 4.0 * 4.0, f({3.0, 4.0}));
+}
+
+TEST(FnCASSimplification, MergesCommonSubexpressions) {
+  for (bool simplify : {false, true}) {
+    fncas::context_t context;
+    context.simplify_before_compilation_ = simplify;
+    const fncas::variables_vector_t x(context, 2);
+    const fncas::function_t<fncas::JIT::Blueprint> fi =
+        fncas::exp(x[0] + x[1]) * fncas::exp(x[1] + x[0]) + fncas::exp(x[0] + x[1]);
+    const fncas::gradient_t<fncas::JIT::Blueprint> gi(x, fi);
+    const std::vector<fncas::impl::node_index_t> roots({fi.f_.index(), gi.g_[0].index(), gi.g_[1].index()});
+    const size_t nodes = fncas::impl::count_nodes(context, roots);
+
+    const fncas::function_t<fncas::JIT::X64NativeJIT> fc(fi);
+    const fncas::gradient_t<fncas::JIT::X64NativeJIT> gc(fi, gi);
+    if (simplify) {
+      EXPECT_EQ(6u, fncas::impl::count_nodes(context, {fi.f_.index()}));
+      EXPECT_GT(nodes, fncas::impl::count_nodes(context, fncas::impl::simplify_nodes(context, roots)));
+    } else {
+      EXPECT_EQ(10u, fncas::impl::count_nodes(context, {fi.f_.index()}));
+      EXPECT_EQ(nodes, fncas::impl::count_nodes(context, roots));
+    }
+
+    for (const std::vector<double>& p : std::vector<std::vector<double>>({{0.0, 0.0}, {0.5, -1.0}, {-2.0, 1.5}})) {
+      const double e = std::exp(p[0] + p[1]);
+      EXPECT_DOUBLE_EQ(e * e + e, fi(p));
+      EXPECT_DOUBLE_EQ(e * e + e, fc(p));
+      EXPECT_DOUBLE_EQ(2.0 * e * e + e, gi(p)[0]);
+      EXPECT_DOUBLE_EQ(2.0 * e * e + e, gc(p)[0]);
+      EXPECT_DOUBLE_EQ(2.0 * e * e + e, gc(p)[1]);
+    }
+  }
+}
+
+TEST(FnCASJITCache, ReusesTheCompiledCode) {
+  const std::string directory = current::FileSystem::GenTmpFileName();
+  fncas::impl::jit_cache_impl& cache = fncas::impl::jit_cache();
+  const std::string original_directory = cache.Directory();
+  cache.SetDirectory(directory);
+  cache.ClearMemory();
+  const auto stats = [&cache]() {
+    const fncas::impl::jit_cache_impl::Stats stats = cache.GetStats();
+    return std::vector<size_t>({stats.memory_hits, stats.disk_hits, stats.misses});
+  };
+  const std::vector<size_t> stats_before = stats();
+  const auto stats_delta = [&stats, &stats_before]() {
+    std::vector<size_t> result = stats();
+    for (size_t i = 0; i < result.size(); ++i) {
+      result[i] -= stats_before[i];
+    }
+    return result;
+  };
+
+  // The same function, recorded into different contexts, has the same key, and its code is only generated once.
+  const auto f = [](const fncas::variables_vector_t& x, double c) { return x[0] * x[1] + fncas::exp(x[0]) * c; };
+  fncas::context_t context1;
+  const fncas::variables_vector_t x1(context1, 2);
+  const fncas::function_t<fncas::JIT::Blueprint> f1 = f(x1, 0.5);
+  const fncas::gradient_t<fncas::JIT::Blueprint> g1(x1, f1);
+  const fncas::function_t<fncas::JIT::X64NativeJIT> fc1(f1);
+  const fncas::gradient_t<fncas::JIT::X64NativeJIT> gc1(f1, g1);
+  EXPECT_EQ(std::vector<size_t>({0u, 0u, 2u}), stats_delta());
+
+  fncas::context_t context2;
+  const fncas::variables_vector_t x2(context2, 2);
+  const fncas::function_t<fncas::JIT::Blueprint> f2 = f(x2, 0.5);
+  const fncas::gradient_t<fncas::JIT::Blueprint> g2(x2, f2);
+  const fncas::function_t<fncas::JIT::X64NativeJIT> fc2(f2);
+  const fncas::gradient_t<fncas::JIT::X64NativeJIT> gc2(f2, g2);
+  EXPECT_EQ(std::vector<size_t>({2u, 0u, 2u}), stats_delta());
+  EXPECT_EQ(fc1.jit_compiled_code.get(), fc2.jit_compiled_code.get());
+  EXPECT_EQ(gc1.jit_compiled_code.get(), gc2.jit_compiled_code.get());
+
+  // Once forgotten in memory, the code is loaded from disk, as it would be by the restarted binary.
+  cache.ClearMemory();
+  fncas::context_t context3;
+  const fncas::variables_vector_t x3(context3, 2);
+  const fncas::function_t<fncas::JIT::Blueprint> f3 = f(x3, 0.5);
+  const fncas::gradient_t<fncas::JIT::Blueprint> g3(x3, f3);
+  const fncas::function_t<fncas::JIT::X64NativeJIT> fc3(f3);
+  const fncas::gradient_t<fncas::JIT::X64NativeJIT> gc3(f3, g3);
+  EXPECT_EQ(std::vector<size_t>({2u, 2u, 2u}), stats_delta());
+
+  // A different function is a different key.
+  fncas::context_t context4;
+  const fncas::variables_vector_t x4(context4, 2);
+  const fncas::function_t<fncas::JIT::Blueprint> f4 = f(x4, 0.25);
+  const fncas::function_t<fncas::JIT::X64NativeJIT> fc4(f4);
+  EXPECT_EQ(std::vector<size_t>({2u, 2u, 3u}), stats_delta());
+
+  // So is the same function compiled by another code generator, which caches the libraries it builds.
+  const fncas::function_t<fncas::JIT::AS> fa1(f1);
+  const fncas::function_t<fncas::JIT::AS> fa2(f2);
+  EXPECT_EQ(std::vector<size_t>({3u, 2u, 4u}), stats_delta());
+  EXPECT_EQ(0u, fa1.lib_filename().find(directory));
+  EXPECT_EQ(fa1.lib_filename(), fa2.lib_filename());
+
+  // The nodes are keyed by their positions in the expression, not by their indexes in the context, so the same
+  // function recorded after the other nodes shares the code too.
+  fncas::context_t context5;
+  const fncas::variables_vector_t x5(context5, 2);
+  const fncas::function_t<fncas::JIT::Blueprint> unrelated = fncas::log(x5[1]) - x5[0] * 3.0;
+  const fncas::function_t<fncas::JIT::Blueprint> f5 = f(x5, 0.5);
+  const fncas::gradient_t<fncas::JIT::Blueprint> g5(x5, f5);
+  const fncas::function_t<fncas::JIT::X64NativeJIT> fc5(f5);
+  const fncas::gradient_t<fncas::JIT::X64NativeJIT> gc5(f5, g5);
+  EXPECT_EQ(std::vector<size_t>({5u, 2u, 4u}), stats_delta());
+  EXPECT_EQ(fc3.jit_compiled_code.get(), fc5.jit_compiled_code.get());
+  EXPECT_EQ(gc3.jit_compiled_code.get(), gc5.jit_compiled_code.get());
+
+  for (const std::vector<double>& p : std::vector<std::vector<double>>({{0.0, 0.0}, {0.5, -1.0}, {-2.0, 1.5}})) {
+    const double e = std::exp(p[0]);
+    EXPECT_DOUBLE_EQ(p[0] * p[1] + e * 0.5, fc1(p));
+    EXPECT_DOUBLE_EQ(p[0] * p[1] + e * 0.5, fc2(p));
+    EXPECT_DOUBLE_EQ(p[0] * p[1] + e * 0.5, fc3(p));
+    EXPECT_DOUBLE_EQ(p[0] * p[1] + e * 0.5, fc5(p));
+    EXPECT_DOUBLE_EQ(p[0] * p[1] + e * 0.25, fc4(p));
+    EXPECT_DOUBLE_EQ(p[0] * p[1] + e * 0.5, fa1(p));
+    EXPECT_DOUBLE_EQ(p[0] * p[1] + e * 0.5, fa2(p));
+    for (const auto* gc : {&gc1, &gc2, &gc3, &gc5}) {
+      EXPECT_DOUBLE_EQ(p[1] + e * 0.5, (*gc)(p)[0]);
+      EXPECT_DOUBLE_EQ(p[0], (*gc)(p)[1]);
+    }
+  }
+
+  cache.SetDirectory(original_directory);
+  current::FileSystem::RmDir(
+      directory, current::FileSystem::RmDirParameters::Silent, current::FileSystem::RmDirRecursive::Yes);
+}
+
 #endif  // FNCAS_X64_NATIVE_JIT_ENABLED
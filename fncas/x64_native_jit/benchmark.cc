@@ -42,10 +42,17 @@ SOFTWARE.
 // Since no random noise is introduced for the picture, the lowest possible `penalty_per_point[p]` is `2 * log(2)`.
 // To keep things simple, in this example this value is subtracted from the cost function,
 // so that ultimately it optimizes towards zero.
+//
+// With `--algorithm`, the optimization algorithms can be compared, and with `--threads`, the cost function and its
+// gradient are evaluated as the sums of as many parts, each on its own thread.
+//
+// With `--batch_points` set, instead of optimizing, the function and its gradient are evaluated on that many
+// random points, first one point per call, and then in the batch mode, four points per instruction stream with AVX.
 
 #include "../fncas.h"
 
 #include "../../bricks/dflags/dflags.h"
+#include "../../bricks/time/chrono.h"
 #include "../../bricks/util/random.h"
 
 DEFINE_int64(n, 250, "The number of training examples.");
@@ -54,8 +61,13 @@ DEFINE_double(k, 0.1, "The fraction of variables used per training example.");
 
 DEFINE_string(function, "softmaxes", "The cost function to optimize for, `softmaxes/l1/l2`.");
 DEFINE_string(optimizer, "jit", "The gradient evaluation technique to use `jit|as|clang|slow`.");
+DEFINE_string(algorithm, "cg", "The optimization algorithm to use, `cg|lbfgs|bt`.");
+DEFINE_uint32(threads, 0, "If greater than one, evaluate the cost function in parallel, on this many threads.");
 DEFINE_uint32(max_iterations, 10000, "The maximum number of iterations to make.");
 
+DEFINE_uint32(batch_points, 0, "If set, benchmark the evaluation on this many points instead of the optimization.");
+DEFINE_uint32(batch_lanes, 0, "The number of points per instruction stream in the batch mode, 1 or 4, 0 to detect.");
+
 DEFINE_bool(dump, false, "Set to dump the input data and the optimization result.");
 DEFINE_bool(log, false, "Set to see the log of optimization iterations.");
 
@@ -110,11 +122,14 @@ struct CostFunction {
 
   explicit CostFunction(Data const& data) : data(data) {}
 
+  // The penalty of the training examples from `[n * part / parts, n * (part + 1) / parts)`.
   template <typename T>
-  T ObjectiveFunction(std::vector<T> const& x) const {
+  T ObjectiveFunctionPart(std::vector<T> const& x, size_t part, size_t parts) const {
     CURRENT_ASSERT(x.size() == data.m);
+    const size_t begin = data.n * part / parts;
+    const size_t end = data.n * (part + 1) / parts;
     T penalty = 0.0;
-    for (size_t i = 0; i < data.n; ++i) {
+    for (size_t i = begin; i < end; ++i) {
       T value = 0.0;
       for (uint32_t const k : data.sparse_matrix[i]) {
         value += x[k];
@@ -136,39 +151,128 @@ struct CostFunction {
       }
     }
     if (FLAGS_function == "softmaxes") {
-      return penalty - (2.0 * data.n * std::log(2.0));
+      return penalty - (2.0 * (end - begin) * std::log(2.0));
     } else {
       return penalty;
     }
   }
-};
 
-fncas::optimize::OptimizationResult RunOptimization(Data const& data) {
-  fncas::optimize::OptimizerParameters params;
-  if (FLAGS_max_iterations) {
-    params.SetValue("max_steps", FLAGS_max_iterations);
+  template <typename T>
+  T ObjectiveFunction(std::vector<T> const& x) const {
+    return ObjectiveFunctionPart(x, 0, 1);
   }
+};
+
+template <template <class, fncas::OptimizationDirection, fncas::JIT> class OPTIMIZER>
+fncas::optimize::OptimizationResult RunOptimization(Data const& data, fncas::optimize::OptimizerParameters& params) {
   if (FLAGS_optimizer == "jit") {
-    return fncas::optimize::
-        DefaultOptimizer<CostFunction, fncas::OptimizationDirection::Minimize, fncas::JIT::X64NativeJIT>(params, data)
-            .Optimize(data.StartingPoint());
+    return OPTIMIZER<CostFunction, fncas::OptimizationDirection::Minimize, fncas::JIT::X64NativeJIT>(params, data)
+        .Optimize(data.StartingPoint());
   } else if (FLAGS_optimizer == "as") {
-    return fncas::optimize::DefaultOptimizer<CostFunction, fncas::OptimizationDirection::Minimize, fncas::JIT::AS>(
-               params, data)
+    return OPTIMIZER<CostFunction, fncas::OptimizationDirection::Minimize, fncas::JIT::AS>(params, data)
         .Optimize(data.StartingPoint());
   } else if (FLAGS_optimizer == "clang") {
-    return fncas::optimize::DefaultOptimizer<CostFunction, fncas::OptimizationDirection::Minimize, fncas::JIT::CLANG>(
-               params, data)
+    return OPTIMIZER<CostFunction, fncas::OptimizationDirection::Minimize, fncas::JIT::CLANG>(params, data)
         .Optimize(data.StartingPoint());
   } else if (FLAGS_optimizer == "slow") {
     params.DisableJIT();
-    return fncas::optimize::DefaultOptimizer<CostFunction>(params, data).Optimize(data.StartingPoint());
+    return OPTIMIZER<CostFunction, fncas::OptimizationDirection::Minimize, fncas::JIT::Default>(params, data)
+        .Optimize(data.StartingPoint());
   } else {
     std::cout << "Invalid value for `--optimizer`, try `--help`." << std::endl;
     std::exit(-1);
   }
 }
 
+fncas::optimize::OptimizationResult RunOptimization(Data const& data) {
+  fncas::optimize::OptimizerParameters params;
+  if (FLAGS_max_iterations) {
+    params.SetValue("max_steps", FLAGS_max_iterations);
+  }
+  if (FLAGS_threads > 1u) {
+    params.EvaluateInParallel(FLAGS_threads);
+  }
+  if (FLAGS_algorithm == "cg") {
+    return RunOptimization<fncas::optimize::ConjugateGradientOptimizer>(data, params);
+  } else if (FLAGS_algorithm == "lbfgs") {
+    return RunOptimization<fncas::optimize::LBFGSOptimizer>(data, params);
+  } else if (FLAGS_algorithm == "bt") {
+    return RunOptimization<fncas::optimize::GradientDescentOptimizerBT>(data, params);
+  } else {
+    std::cout << "Invalid value for `--algorithm`, try `--help`." << std::endl;
+    std::exit(-1);
+  }
+}
+
+void RunBatchBenchmark(Data const& data) {
+  const size_t n = FLAGS_batch_points;
+  const size_t m = data.m;
+  const size_t lanes = FLAGS_batch_lanes ? FLAGS_batch_lanes : fncas::impl::x64_native_jit_default_batch_lanes();
+
+  const fncas::variables_vector_t x(m);
+  const fncas::function_t<fncas::JIT::Blueprint> fi = CostFunction(data).ObjectiveFunction(x);
+  const fncas::gradient_t<fncas::JIT::Blueprint> gi(x, fi);
+  const fncas::function_t<fncas::JIT::X64NativeJIT> f(fi);
+  const fncas::gradient_t<fncas::JIT::X64NativeJIT> g(fi, gi);
+  const fncas::batch_function_t batch_f(fi, lanes);
+  const fncas::batch_gradient_t batch_g(fi, gi, lanes);
+
+  std::vector<std::vector<double>> points(n, std::vector<double>(m));
+  std::vector<double> flat_points;  // The same points, one after another, for the batch mode.
+  flat_points.reserve(n * m);
+  for (std::vector<double>& point : points) {
+    for (double& value : point) {
+      value = current::random::RandomDouble(FLAGS_a, FLAGS_b);
+      flat_points.push_back(value);
+    }
+  }
+
+  std::vector<double> values(n);
+  std::vector<double> gradients(n * m);
+  std::vector<double> batch_values(n);
+  std::vector<double> batch_gradients(n * m);
+
+  const auto report = [n](const char* what, std::chrono::microseconds begin) {
+    const double seconds = 1e-6 * (current::time::Now() - begin).count();
+    std::cout << what << ": " << seconds << " seconds, " << static_cast<int64_t>(n / seconds) << " points per second."
+              << std::endl;
+  };
+
+  std::chrono::microseconds begin = current::time::Now();
+  for (size_t i = 0; i < n; ++i) {
+    values[i] = f(points[i]);
+  }
+  report("f, one point per call", begin);
+
+  begin = current::time::Now();
+  batch_f(&flat_points[0], n, m, 1u, &batch_values[0]);
+  report(lanes == 4u ? "f, batch, four points at once" : "f, batch, one point at once", begin);
+
+  begin = current::time::Now();
+  for (size_t i = 0; i < n; ++i) {
+    const std::vector<double> gradient = g(points[i]);
+    std::copy(gradient.begin(), gradient.end(), gradients.begin() + i * m);
+  }
+  report("g, one point per call", begin);
+
+  begin = current::time::Now();
+  batch_g(&flat_points[0], n, m, 1u, &batch_gradients[0]);
+  report(lanes == 4u ? "g, batch, four points at once" : "g, batch, one point at once", begin);
+
+  double max_difference = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    max_difference = std::max(max_difference, std::abs(values[i] - batch_values[i]));
+  }
+  for (size_t i = 0; i < n * m; ++i) {
+    max_difference = std::max(max_difference, std::abs(gradients[i] - batch_gradients[i]));
+  }
+  if (max_difference < 1e-9) {
+    std::cout << "OK, the results match." << std::endl;
+  } else {
+    std::cout << "FAIL, the results differ by up to " << max_difference << '.' << std::endl;
+  }
+}
+
 int main(int argc, char** argv) {
   ParseDFlags(&argc, &argv);
 
@@ -176,6 +280,11 @@ int main(int argc, char** argv) {
 
   Data const data;
 
+  if (FLAGS_batch_points) {
+    RunBatchBenchmark(data);
+    return 0;
+  }
+
   if (FLAGS_dump) {
     std::cout << JSON(data.sparse_matrix) << std::endl;
     std::cout << JSON(data.true_value_per_variable) << std::endl;
@@ -186,7 +295,10 @@ int main(int argc, char** argv) {
     optional_log_fncas_to_stderr_scope = std::make_unique<fncas::impl::ScopedLogToStderr>();
   }
 
+  const std::chrono::microseconds begin = current::time::Now();
   fncas::optimize::OptimizationResult const result = RunOptimization(data);
+  std::cout << result.optimization_iterations << " iterations, "
+            << 1e-6 * (current::time::Now() - begin).count() << " seconds." << std::endl;
 
   if (FLAGS_dump) {
     std::cout << JSON(result) << std::endl;
@@ -430,6 +430,60 @@ TEST(X64NativeJIT, LogExpFunctionsCombination) {
   EXPECT_EQ(a(), j());
 }
 
+TEST(X64NativeJIT, PerformsVectorArithmetic) {
+  using namespace current::fncas::x64_native_jit;
+
+  if (!cpu_supports_avx()) {
+    std::cerr << "Skipping the test, as the CPU does not support AVX.\n";
+    return;
+  }
+
+  std::vector<uint8_t> code;
+
+  opcodes::push_rbx(code);
+  opcodes::mov_rsi_rbx(code);
+
+  opcodes::load_from_memory_by_rdi_offset_to_ymm0(code, 0);
+  opcodes::add_from_memory_by_rsi_offset_to_ymm0(code, 0);
+  opcodes::store_ymm0_to_memory_by_rsi_offset(code, 0);
+
+  opcodes::load_from_memory_by_rdi_offset_to_ymm0(code, 4);
+  opcodes::sub_from_memory_by_rsi_offset_to_ymm0(code, 4);
+  opcodes::store_ymm0_to_memory_by_rsi_offset(code, 4);
+
+  opcodes::load_from_memory_by_rdi_offset_to_ymm0(code, 8);
+  opcodes::mul_from_memory_by_rbx_offset_to_ymm0(code, 8);
+  opcodes::store_ymm0_to_memory_by_rbx_offset(code, 8);
+
+  opcodes::load_from_memory_by_rdi_offset_to_ymm0(code, 12);
+  opcodes::div_from_memory_by_rbx_offset_to_ymm0(code, 12);
+  opcodes::store_ymm0_to_memory_by_rbx_offset(code, 12);
+
+  opcodes::load_from_memory_by_rbx_offset_to_ymm0(code, 0);
+  opcodes::add_from_memory_by_rbx_offset_to_ymm0(code, 12);
+  opcodes::store_ymm0_to_memory_by_rbx_offset(code, 16);
+
+  opcodes::vzeroupper(code);
+  opcodes::pop_rbx(code);
+  opcodes::ret(code);
+
+  std::vector<double> x(16);
+  std::vector<double> y(20, 5.0);
+  for (size_t i = 0; i < 16; ++i) {
+    x[i] = 10.0 + i;
+  }
+
+  (current::fncas::x64_native_jit::CallableVectorUInt8(code))(&x[0], &y[0], nullptr);
+
+  for (size_t k = 0; k < 4; ++k) {
+    EXPECT_EQ(15.0 + k, y[k]);
+    EXPECT_EQ(9.0 + k, y[4 + k]);
+    EXPECT_EQ(5.0 * (18.0 + k), y[8 + k]);
+    EXPECT_EQ((22.0 + k) / 5.0, y[12 + k]);
+    EXPECT_EQ(y[k] + y[12 + k], y[16 + k]);
+  }
+}
+
 #endif  // FNCAS_X64_NATIVE_JIT_ENABLED
 
 #endif  // X64_NATIVE_JIT_TEST_CC_INCLUDED
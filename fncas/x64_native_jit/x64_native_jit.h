@@ -333,6 +333,98 @@ void store_xmm0_to_memory_by_rbx_offset(C& c, O offset) {
   internal_store_xmm0_to_memory_by_reg_offset(c, 0x83, offset);
 }
 
+// The 256-bit AVX counterparts of the above, for the batch mode, which evaluates four points at once.
+// The offsets are in doubles, so the four lanes of a node are at `offset`, `offset + 1`, `offset + 2`, `offset + 3`.
+// The two-byte VEX prefix is `0xc5`, followed by `0xfd` for "`ymm0` as both the target and the first source".
+template <typename C>
+void vzeroupper(C& c) {
+  c.push_back(0xc5);
+  c.push_back(0xf8);
+  c.push_back(0x77);
+}
+
+template <typename C, typename O>
+void internal_vex_op_ymm0_memory_by_reg_offset(uint8_t opcode, C& c, uint8_t reg, O offset) {
+  auto o = static_cast<int64_t>(offset);
+  o += 16;  // HACK(dkorolev): Shift by 16 doubles to have the opcodes have the same length.
+  o *= 8;   // Double is eight bytes, signed multiplication by design.
+  X64_JIT_ASSERT(o >= 0x80);
+  X64_JIT_ASSERT(o <= 0x7fffffff);
+  c.push_back(0xc5);
+  c.push_back(0xfd);
+  c.push_back(opcode);
+  c.push_back(reg);
+  for (size_t i = 0; i < 4; ++i) {
+    c.push_back(o & 0xff);
+    o >>= 8;
+  }
+}
+
+template <typename C, typename O>
+void load_from_memory_by_rdi_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x10, c, 0x87, offset);
+}
+
+template <typename C, typename O>
+void load_from_memory_by_rsi_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x10, c, 0x86, offset);
+}
+
+template <typename C, typename O>
+void load_from_memory_by_rbx_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x10, c, 0x83, offset);
+}
+
+template <typename C, typename O>
+void add_from_memory_by_rsi_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x58, c, 0x86, offset);
+}
+
+template <typename C, typename O>
+void sub_from_memory_by_rsi_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x5c, c, 0x86, offset);
+}
+
+template <typename C, typename O>
+void mul_from_memory_by_rsi_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x59, c, 0x86, offset);
+}
+
+template <typename C, typename O>
+void div_from_memory_by_rsi_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x5e, c, 0x86, offset);
+}
+
+template <typename C, typename O>
+void add_from_memory_by_rbx_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x58, c, 0x83, offset);
+}
+
+template <typename C, typename O>
+void sub_from_memory_by_rbx_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x5c, c, 0x83, offset);
+}
+
+template <typename C, typename O>
+void mul_from_memory_by_rbx_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x59, c, 0x83, offset);
+}
+
+template <typename C, typename O>
+void div_from_memory_by_rbx_offset_to_ymm0(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x5e, c, 0x83, offset);
+}
+
+template <typename C, typename O>
+void store_ymm0_to_memory_by_rsi_offset(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x11, c, 0x86, offset);
+}
+
+template <typename C, typename O>
+void store_ymm0_to_memory_by_rbx_offset(C& c, O offset) {
+  internal_vex_op_ymm0_memory_by_reg_offset(0x11, c, 0x83, offset);
+}
+
 template <typename C>
 void call_function_from_rdx_pointers_array_by_index(C& c, uint8_t index) {
   X64_JIT_ASSERT(index < 31);  // Should fit one byte after adding one and multiplying by 8. -- D.K.
@@ -343,6 +435,12 @@ void call_function_from_rdx_pointers_array_by_index(C& c, uint8_t index) {
 
 }  // namespace current::fncas::x64_native_jit::opcodes
 
+// Whether the CPU, and the OS, support the 256-bit AVX instructions of the batch mode.
+inline bool cpu_supports_avx() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx");
+}
+
 }  // namespace current::fncas::x64_native_jit
 }  // namespace current::fncas
 }  // namespace current
@@ -28,7 +28,12 @@ SOFTWARE.
 
 #include "../port.h"
 
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
 
 #include "semantics.h"
 #include "transaction.h"
@@ -174,16 +179,90 @@ template <typename FIELDS, int COUNT>
 using FieldsTypeList = typename TypeListMapperImpl<FIELDS, current::variadic_indexes::generate_indexes<COUNT>>::result;
 #endif  // CURRENT_STORAGE_PATCH_SUPPORT
 
+// `MutationJournalArena` is the memory for the rollback records of one transaction.
+// It is allocated in blocks, which are kept for the next transactions, and reset at once after each transaction.
+class MutationJournalArena final {
+ public:
+  enum { kBlockSize = 64 * 1024, kMaxBlocksKept = 16 };
+
+  void* Allocate(size_t size, size_t alignment) {
+    CURRENT_ASSERT(alignment <= alignof(std::max_align_t));
+    if (size > kBlockSize) {
+      oversized_.push_back(std::make_unique<max_align_block_t[]>(BlocksFor(size)));
+      return oversized_.back().get();
+    }
+    offset_ = (offset_ + alignment - 1u) / alignment * alignment;
+    if (blocks_.empty() || offset_ + size > kBlockSize) {
+      if (!blocks_.empty()) {
+        ++current_block_;
+      }
+      if (current_block_ == blocks_.size()) {
+        blocks_.push_back(std::make_unique<max_align_block_t[]>(BlocksFor(kBlockSize)));
+      }
+      offset_ = 0u;
+    }
+    void* result = reinterpret_cast<char*>(blocks_[current_block_].get()) + offset_;
+    offset_ += size;
+    return result;
+  }
+
+  void Reset() {
+    current_block_ = 0u;
+    offset_ = 0u;
+    oversized_.clear();
+    if (blocks_.size() > kMaxBlocksKept) {
+      blocks_.resize(kMaxBlocksKept);
+    }
+  }
+
+ private:
+  using max_align_block_t = std::max_align_t;
+  static size_t BlocksFor(size_t size) { return (size + sizeof(max_align_block_t) - 1u) / sizeof(max_align_block_t); }
+
+  std::vector<std::unique_ptr<max_align_block_t[]>> blocks_;
+  std::vector<std::unique_ptr<max_align_block_t[]>> oversized_;
+  size_t current_block_ = 0u;
+  size_t offset_ = 0u;
+};
+
 // `MutationJournal` keeps all the changes made during one transaction, as well as the way to rollback them.
+// Both the events and the rollback functors are kept as typed records in the arena of the journal, so that logging
+// a mutation allocates no memory, except for the first transactions. The records which are trivially destructible,
+// as the rollback functors capturing only the timestamps and the trivial keys are, are never visited again once
+// the transaction is over; the other ones are listed aside, to be destroyed before the arena is reset.
 struct MutationJournal {
   TransactionMeta transaction_meta;
-  std::vector<std::unique_ptr<current::CurrentStruct>> commit_log;
-  std::vector<std::function<void()>> rollback_log;
 
-  template <typename T>
-  void LogMutation(T&& entry, std::function<void()> rollback) {
-    commit_log.push_back(std::make_unique<T>(std::move(entry)));
-    rollback_log.push_back(rollback);
+  MutationJournal() = default;
+  MutationJournal(const MutationJournal&) = delete;
+  MutationJournal& operator=(const MutationJournal&) = delete;
+  ~MutationJournal() { ClearRecords(); }
+
+  // Returns the logged event, which stays in place until the journal is cleared.
+  template <typename T, typename F>
+  std::decay_t<T>& LogMutation(T&& entry, F&& rollback) {
+    auto* event = Construct<EventRecordImpl<std::decay_t<T>>>(std::forward<T>(entry));
+    if (last_event_) {
+      last_event_->next = event;
+    } else {
+      first_event_ = event;
+    }
+    last_event_ = event;
+    ++events_count_;
+    last_rollback_record_ =
+        Construct<RollbackRecordImpl<std::decay_t<F>>>(std::forward<F>(rollback), last_rollback_record_);
+    return event->event;
+  }
+
+  size_t EventsCount() const { return events_count_; }
+
+  // Calls `f` with each logged event, in the order they were logged, moved out of the arena into the heap,
+  // as the variant of the transaction holds it.
+  template <typename F>
+  void ReleaseEvents(F&& f) {
+    for (EventRecord* event = first_event_; event; event = event->next) {
+      f(event->release(event));
+    }
   }
 
   void BeforeTransaction() { transaction_meta.begin_us = current::time::Now(); }
@@ -191,8 +270,8 @@ struct MutationJournal {
   void AfterTransaction() { transaction_meta.end_us = current::time::Now(); }
 
   void Rollback() {
-    for (auto rit = rollback_log.rbegin(); rit != rollback_log.rend(); ++rit) {
-      (*rit)();
+    for (RollbackRecord* record = last_rollback_record_; record; record = record->previous) {
+      record->rollback(record);
     }
     Clear();
   }
@@ -201,17 +280,82 @@ struct MutationJournal {
     transaction_meta.begin_us = std::chrono::microseconds(0);
     transaction_meta.end_us = std::chrono::microseconds(0);
     transaction_meta.fields.clear();
-    commit_log.clear();
-    rollback_log.clear();
+    ClearRecords();
   }
 
   void AssertEmpty() const {
     CURRENT_ASSERT(transaction_meta.begin_us.count() == 0);
     CURRENT_ASSERT(transaction_meta.end_us.count() == 0);
     CURRENT_ASSERT(transaction_meta.fields.empty());
-    CURRENT_ASSERT(commit_log.empty());
-    CURRENT_ASSERT(rollback_log.empty());
+    CURRENT_ASSERT(!first_event_);
+    CURRENT_ASSERT(!last_rollback_record_);
   }
+
+ private:
+  // The records are plain structs with function pointers, not virtual classes, to not need a destructor call each.
+  struct EventRecord {
+    EventRecord* next;
+    std::unique_ptr<current::CurrentStruct> (*release)(EventRecord*);
+  };
+
+  template <typename E>
+  struct EventRecordImpl final : EventRecord {
+    E event;
+    template <typename ARG>
+    explicit EventRecordImpl(ARG&& arg) : EventRecord{nullptr, &Release}, event(std::forward<ARG>(arg)) {}
+    static std::unique_ptr<current::CurrentStruct> Release(EventRecord* record) {
+      return std::make_unique<E>(std::move(static_cast<EventRecordImpl*>(record)->event));
+    }
+  };
+
+  struct RollbackRecord {
+    RollbackRecord* previous;
+    void (*rollback)(RollbackRecord*);
+  };
+
+  template <typename F>
+  struct RollbackRecordImpl final : RollbackRecord {
+    F f;
+    template <typename ARG>
+    RollbackRecordImpl(ARG&& f, RollbackRecord* previous)
+        : RollbackRecord{previous, &Rollback}, f(std::forward<ARG>(f)) {}
+    static void Rollback(RollbackRecord* record) { static_cast<RollbackRecordImpl*>(record)->f(); }
+  };
+
+  struct NonTrivialRecord {
+    void* record;
+    void (*destroy)(void*);
+  };
+
+  template <typename RECORD, typename... ARGS>
+  RECORD* Construct(ARGS&&... args) {
+    RECORD* record = new (arena_.Allocate(sizeof(RECORD), alignof(RECORD))) RECORD(std::forward<ARGS>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<RECORD>) {
+      non_trivial_records_.push_back({record, [](void* record) { static_cast<RECORD*>(record)->~RECORD(); }});
+    }
+    return record;
+  }
+
+  // Only the records which are not trivially destructible are destroyed, as the memory of all of them is reclaimed
+  // by resetting the arena. The list of them keeps its capacity for the next transactions.
+  void ClearRecords() {
+    for (const NonTrivialRecord& record : non_trivial_records_) {
+      record.destroy(record.record);
+    }
+    non_trivial_records_.clear();
+    first_event_ = nullptr;
+    last_event_ = nullptr;
+    events_count_ = 0u;
+    last_rollback_record_ = nullptr;
+    arena_.Reset();
+  }
+
+  MutationJournalArena arena_;
+  std::vector<NonTrivialRecord> non_trivial_records_;
+  EventRecord* first_event_ = nullptr;
+  EventRecord* last_event_ = nullptr;
+  size_t events_count_ = 0u;
+  RollbackRecord* last_rollback_record_ = nullptr;
 };
 
 template <typename BASE>
@@ -25,6 +25,14 @@ SOFTWARE.
 #ifndef CURRENT_STORAGE_CONTAINER_COMMON_H
 #define CURRENT_STORAGE_CONTAINER_COMMON_H
 
+#include <chrono>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+
+#include "flat_map.h"
+
 #include "../../bricks/util/comparators.h"
 
 namespace current {
@@ -37,6 +45,50 @@ using Unordered = std::unordered_map<KEY, VALUE, GenericHashFunction<KEY>>;
 template <typename KEY, typename VALUE>
 using Ordered = std::map<KEY, VALUE, CurrentComparator<KEY>>;
 
+template <typename KEY, typename VALUE>
+using Flat = FlatMap<KEY, VALUE, GenericHashFunction<KEY>>;
+
+// The maps of the cells of a matrix container, by their `std::pair<row, col>` key, and of their last modified times.
+// The cells must not move, as the rows and the cols point to them: they are owned by `std::unique_ptr`-s, unless the
+// matrix opts into `Flat` as its `ROW_MAP`, in which case they are stored inline in the `FlatMap`, which never moves
+// its entries either. `Take` moves the cell out, for the rollback record to put it back with `Set` as is.
+template <typename KEY, typename T, bool FLAT>
+struct MatrixCellsImpl {
+  using cell_t = std::unique_ptr<T>;
+  using map_t = Unordered<KEY, cell_t>;
+  using last_modified_map_t = Unordered<KEY, std::chrono::microseconds>;
+  static const T& Get(const cell_t& cell) { return *cell; }
+  static cell_t Take(map_t& map, const KEY& key) { return std::move(map[key]); }
+  static const T& Set(map_t& map, const KEY& key, const T& object) {
+    auto& placeholder = map[key];
+    placeholder = std::make_unique<T>(object);
+    return *placeholder;
+  }
+  static const T& Set(map_t& map, const KEY& key, cell_t&& cell) {
+    auto& placeholder = map[key];
+    placeholder = std::move(cell);
+    return *placeholder;
+  }
+};
+
+template <typename KEY, typename T>
+struct MatrixCellsImpl<KEY, T, true> {
+  using cell_t = T;
+  using map_t = Flat<KEY, cell_t>;
+  using last_modified_map_t = Flat<KEY, std::chrono::microseconds>;
+  static const T& Get(const cell_t& cell) { return cell; }
+  static cell_t Take(map_t& map, const KEY& key) { return std::move(map[key]); }
+  template <typename O>
+  static const T& Set(map_t& map, const KEY& key, O&& object) {
+    T& placeholder = map[key];
+    placeholder = std::forward<O>(object);
+    return placeholder;
+  }
+};
+
+template <template <typename...> class ROW_MAP, typename KEY, typename T>
+using MatrixCells = MatrixCellsImpl<KEY, T, std::is_same<ROW_MAP<KEY, T>, Flat<KEY, T>>::value>;
+
 }  // namespace container
 }  // namespace storage
 }  // namespace current
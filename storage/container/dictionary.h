@@ -27,6 +27,7 @@ SOFTWARE.
 #define CURRENT_STORAGE_CONTAINER_DICTIONARY_H
 
 #include "common.h"
+#include "index.h"
 #include "sfinae.h"
 
 #include "../base.h"
@@ -48,8 +49,15 @@ class GenericDictionary {
  public:
   using entry_t = T;
   using key_t = sfinae::entry_key_t<T>;
-  using map_t = MAP<key_t, T>;
+  // The last modified time is kept next to the entry, so that the lookup of an entry finds both.
+  struct Entry final {
+    T object;
+    std::chrono::microseconds last_modified;
+  };
+  using map_t = MAP<key_t, Entry>;
   using semantics_t = storage::semantics::Dictionary;
+  using indexes_t =
+      index::SecondaryIndexes<key_t, T, MAP, index::field_indexes_t<typename UPDATE_EVENT::storage_field_t>>;
 
   GenericDictionary(const std::string& field_name, MutationJournal& journal)
       : field_name_(field_name), journal_(journal) {}
@@ -63,16 +71,20 @@ class GenericDictionary {
   ImmutableOptional<T> operator[](sfinae::CF<key_t> key) const {
     const auto iterator = map_.find(key);
     if (iterator != map_.end()) {
-      return ImmutableOptional<T>(FromBarePointer(), &iterator->second);
+      return ImmutableOptional<T>(FromBarePointer(), &iterator->second.object);
     } else {
       return nullptr;
     }
   }
 
   ImmutableOptional<std::chrono::microseconds> LastModified(sfinae::CF<key_t> key) const {
-    const auto iterator = last_modified_.find(key);
-    if (iterator != last_modified_.end()) {
-      return ImmutableOptional<std::chrono::microseconds>(iterator->second);
+    const auto iterator = map_.find(key);
+    if (iterator != map_.end()) {
+      return ImmutableOptional<std::chrono::microseconds>(iterator->second.last_modified);
+    }
+    const auto deleted_iterator = deleted_.find(key);
+    if (deleted_iterator != deleted_.end()) {
+      return ImmutableOptional<std::chrono::microseconds>(deleted_iterator->second);
     } else {
       return nullptr;
     }
@@ -81,51 +93,52 @@ class GenericDictionary {
   void Add(const T& object) {
     const auto now = current::time::Now();
     const auto key = sfinae::GetKey(object);
+    indexes_.AssertNoConflicts(key, object);
     const auto map_iterator = map_.find(key);
-    const auto lm_iterator = last_modified_.find(key);
     if (map_iterator != map_.end()) {
-      const T& previous_object = map_iterator->second;
-      CURRENT_ASSERT(lm_iterator != last_modified_.end());
-      const auto previous_timestamp = lm_iterator->second;
-      journal_.LogMutation(UPDATE_EVENT(now, object),
-                           [this, key, previous_object, previous_timestamp]() {
-                             last_modified_[key] = previous_timestamp;
-                             map_[key] = previous_object;
-                           });
+      Entry& entry = map_iterator->second;
+      const auto previous_timestamp = entry.last_modified;
+      // The previous object is moved into the rollback record, and the new one is copied from the logged event,
+      // as `object` may well refer to the very entry being replaced.
+      UPDATE_EVENT event(now, object);
+      indexes_.Erase(key, entry.object);
+      const UPDATE_EVENT& logged_event = journal_.LogMutation(
+          std::move(event),
+          [this, key, previous_object = std::move(entry.object), previous_timestamp]() mutable {
+            DoSet(key, std::move(previous_object), previous_timestamp);
+          });
+      entry.object = logged_event.data;
+      entry.last_modified = now;
+      indexes_.Insert(key, entry.object);
     } else {
-      if (lm_iterator != last_modified_.end()) {
-        const auto previous_timestamp = lm_iterator->second;
+      const auto deleted_iterator = deleted_.find(key);
+      if (deleted_iterator != deleted_.end()) {
+        const auto previous_timestamp = deleted_iterator->second;
         journal_.LogMutation(UPDATE_EVENT(now, object),
-                             [this, key, previous_timestamp]() {
-                               last_modified_[key] = previous_timestamp;
-                               map_.erase(key);
-                             });
+                             [this, key, previous_timestamp]() { DoErase(key, previous_timestamp); });
       } else {
-        journal_.LogMutation(UPDATE_EVENT(now, object),
-                             [this, key]() {
-                               last_modified_.erase(key);
-                               map_.erase(key);
-                             });
+        journal_.LogMutation(UPDATE_EVENT(now, object), [this, key]() { DoForget(key); });
       }
+      DoSet(key, object, now);
     }
-    last_modified_[key] = now;
-    map_[key] = object;
   }
 
   void Erase(sfinae::CF<key_t> key) {
     const auto now = current::time::Now();
     const auto map_iterator = map_.find(key);
     if (map_iterator != map_.end()) {
-      const T& previous_object = map_iterator->second;
-      const auto lm_iterator = last_modified_.find(key);
-      CURRENT_ASSERT(lm_iterator != last_modified_.end());
-      const auto previous_timestamp = lm_iterator->second;
-      journal_.LogMutation(DELETE_EVENT(now, previous_object),
-                           [this, key, previous_object, previous_timestamp]() {
-                             last_modified_[key] = previous_timestamp;
-                             map_[key] = previous_object;
-                           });
-      last_modified_[key] = now;
+      Entry& entry = map_iterator->second;
+      const auto previous_timestamp = entry.last_modified;
+      // The erased object is moved into the rollback record. The key is taken from the map, as `key` may well refer
+      // to the very entry being erased.
+      DELETE_EVENT event(now, entry.object);
+      indexes_.Erase(map_iterator->first, entry.object);
+      deleted_[map_iterator->first] = now;
+      journal_.LogMutation(
+          std::move(event),
+          [this, key = map_iterator->first, previous_object = std::move(entry.object), previous_timestamp]() mutable {
+            DoSet(key, std::move(previous_object), previous_timestamp);
+          });
       map_.erase(map_iterator);
     }
   }
@@ -140,17 +153,22 @@ class GenericDictionary {
     const auto now = current::time::Now();
     const auto map_iterator = map_.find(key);
     if (map_iterator != map_.end()) {
-      const T& previous_object = map_iterator->second;
-      const auto lm_iterator = last_modified_.find(key);
-      CURRENT_ASSERT(lm_iterator != last_modified_.end());
-      const auto previous_timestamp = lm_iterator->second;
+      Entry& entry = map_iterator->second;
+      const T& previous_object = entry.object;
+      if constexpr (indexes_t::has_unique) {
+        T patched_object(previous_object);
+        patched_object.PatchWith(patch_object);
+        indexes_.AssertNoConflicts(key, patched_object);
+      }
+      const auto previous_timestamp = entry.last_modified;
       journal_.LogMutation(PATCH_EVENT_OR_VOID(now, key, patch_object),
                            [this, key, previous_object, previous_timestamp]() {
-                             last_modified_[key] = previous_timestamp;
-                             map_[key] = previous_object;
+                             DoSet(key, previous_object, previous_timestamp);
                            });
-      last_modified_[key] = now;
-      map_iterator->second.PatchWith(patch_object);
+      entry.last_modified = now;
+      indexes_.Erase(key, entry.object);
+      entry.object.PatchWith(patch_object);
+      indexes_.Insert(key, entry.object);
       return true;
     } else {
       return false;
@@ -168,15 +186,27 @@ class GenericDictionary {
   }
 #endif  // CURRENT_STORAGE_PATCH_SUPPORT
 
+  // Calls `f` with the events which, applied to the empty dictionary, restore its state, last modified times included.
+  template <typename F>
+  void ExportState(F&& f) const {
+    for (const auto& element : map_) {
+      f(UPDATE_EVENT(element.second.last_modified, element.second.object));
+    }
+    for (const auto& deleted : deleted_) {
+      DELETE_EVENT event;
+      event.us = deleted.second;
+      event.key = deleted.first;
+      f(std::move(event));
+    }
+  }
+
+  // The replayed entries are checked against the unique indexes too, for the stream written without them.
   void operator()(const UPDATE_EVENT& e) {
     const auto key = sfinae::GetKey(e.data);
-    last_modified_[key] = e.us;
-    map_[key] = e.data;
-  }
-  void operator()(const DELETE_EVENT& e) {
-    last_modified_[e.key] = e.us;
-    map_.erase(e.key);
+    indexes_.template AssertNoConflicts<StorageUniqueIndexViolationOnReplayException>(key, e.data);
+    DoSet(key, e.data, e.us);
   }
+  void operator()(const DELETE_EVENT& e) { DoErase(e.key, e.us); }
 #ifdef CURRENT_STORAGE_PATCH_SUPPORT
   struct DummyStructForNonExistentPatch {};  // Essential, as can't form a reference to `void` even if disabled.
   void operator()(const std::conditional_t<HasPatch<entry_t>(),
@@ -184,8 +214,16 @@ class GenericDictionary {
                                            DummyStructForNonExistentPatch>& e) {
     auto it = map_.find(e.key);
     if (it != map_.end()) {
-      last_modified_[e.key] = e.us;
-      it->second.PatchWith(e.patch);
+      Entry& entry = it->second;
+      if constexpr (indexes_t::has_unique) {
+        T patched_object(entry.object);
+        patched_object.PatchWith(e.patch);
+        indexes_.template AssertNoConflicts<StorageUniqueIndexViolationOnReplayException>(e.key, patched_object);
+      }
+      entry.last_modified = e.us;
+      indexes_.Erase(e.key, entry.object);
+      entry.object.PatchWith(e.patch);
+      indexes_.Insert(e.key, entry.object);
     }
   }
 #endif  // CURRENT_STORAGE_PATCH_SUPPORT
@@ -201,17 +239,76 @@ class GenericDictionary {
     // TODO(dkorolev): Replace `OuterKeyForPartialHypermediaCollectionView()` with `key()`?
     copy_free<key_t> OuterKeyForPartialHypermediaCollectionView() const { return iterator->first; }
     copy_free<key_t> key() const { return iterator->first; }
-    const T& operator*() const { return iterator->second; }
-    const T* operator->() const { return &iterator->second; }
+    const T& operator*() const { return iterator->second.object; }
+    const T* operator->() const { return &iterator->second.object; }
   };
 
   Iterator begin() const { return Iterator(map_.cbegin()); }
   Iterator end() const { return Iterator(map_.cend()); }
 
+  // The entry with this value of the unique index `INDEX`, or the accessor to the entries with it, ordered as the
+  // dictionary is, for the non-unique one. See `index.h`.
+  template <typename INDEX>
+  auto ByIndex(sfinae::CF<typename INDEX::value_t> value) const {
+    return indexes_.template Get<INDEX>().Find(value);
+  }
+
+  // The entries ordered by the value of the index `INDEX`, and then as the dictionary is: all of them,
+  // or, for the ordered index, the ones with the value in `[from, to)`.
+  template <typename INDEX>
+  using index_range_t = typename index::SecondaryIndex<INDEX, key_t, T, MAP>::Range;
+
+  template <typename INDEX>
+  index_range_t<INDEX> ByIndexRange() const {
+    return indexes_.template Get<INDEX>().All();
+  }
+  template <typename INDEX>
+  index_range_t<INDEX> ByIndexRange(sfinae::CF<typename INDEX::value_t> from,
+                                    sfinae::CF<typename INDEX::value_t> to) const {
+    return indexes_.template Get<INDEX>().FromTo(from, to);
+  }
+
  private:
+  // Every change of the entries goes through these three, for the secondary indexes and the deleted keys to follow.
+  template <typename O>
+  void DoSet(sfinae::CF<key_t> key, O&& object, std::chrono::microseconds us) {
+    const auto map_iterator = map_.find(key);
+    if (map_iterator != map_.end()) {
+      Entry& entry = map_iterator->second;
+      indexes_.Erase(key, entry.object);
+      entry.object = std::forward<O>(object);
+      entry.last_modified = us;
+      indexes_.Insert(key, entry.object);
+    } else {
+      indexes_.Insert(key, map_.emplace(key, Entry{std::forward<O>(object), us}).first->second.object);
+      if (!deleted_.empty()) {
+        deleted_.erase(key);
+      }
+    }
+  }
+
+  // Erases the entry, if any, and remembers when the key was deleted, for `LastModified()`.
+  void DoErase(sfinae::CF<key_t> key, std::chrono::microseconds us) {
+    DoForget(key);
+    deleted_[key] = us;
+  }
+
+  // Erases the entry, if any, as if the key has never been there, to roll back its addition.
+  void DoForget(sfinae::CF<key_t> key) {
+    const auto map_iterator = map_.find(key);
+    if (map_iterator != map_.end()) {
+      indexes_.Erase(key, map_iterator->second.object);
+      map_.erase(map_iterator);
+    }
+    if (!deleted_.empty()) {
+      deleted_.erase(key);
+    }
+  }
+
   const std::string field_name_;
   map_t map_;
-  std::unordered_map<key_t, std::chrono::microseconds, GenericHashFunction<key_t>> last_modified_;
+  MAP<key_t, std::chrono::microseconds> deleted_;  // The last modified times of the deleted keys.
+  indexes_t indexes_;
   MutationJournal& journal_;
 };
 
@@ -223,6 +320,9 @@ using UnorderedDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, PAT
 template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename PATCH_EVENT_OR_VOID>
 using OrderedDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, PATCH_EVENT_OR_VOID, Ordered>;
 
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename PATCH_EVENT_OR_VOID>
+using FlatDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, PATCH_EVENT_OR_VOID, Flat>;
+
 #else
 
 template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
@@ -231,6 +331,9 @@ using UnorderedDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, Uno
 template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
 using OrderedDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, Ordered>;
 
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
+using FlatDictionary = GenericDictionary<T, UPDATE_EVENT, DELETE_EVENT, Flat>;
+
 #endif  // CURRENT_STORAGE_PATCH_SUPPORT
 
 }  // namespace container
@@ -247,6 +350,11 @@ struct StorageFieldTypeSelector<container::OrderedDictionary<T, E1, E2, E3>> {
   static const char* HumanReadableName() { return "OrderedDictionary"; }
 };
 
+template <typename T, typename E1, typename E2, typename E3>  // Entry, update event, delete event, patch event.
+struct StorageFieldTypeSelector<container::FlatDictionary<T, E1, E2, E3>> {
+  static const char* HumanReadableName() { return "FlatDictionary"; }
+};
+
 #else
 
 template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
@@ -259,6 +367,11 @@ struct StorageFieldTypeSelector<container::OrderedDictionary<T, E1, E2>> {
   static const char* HumanReadableName() { return "OrderedDictionary"; }
 };
 
+template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
+struct StorageFieldTypeSelector<container::FlatDictionary<T, E1, E2>> {
+  static const char* HumanReadableName() { return "FlatDictionary"; }
+};
+
 #endif  // CURRENT_STORAGE_PATCH_SUPPORT
 
 }  // namespace storage
@@ -266,5 +379,6 @@ struct StorageFieldTypeSelector<container::OrderedDictionary<T, E1, E2>> {
 
 using current::storage::container::UnorderedDictionary;
 using current::storage::container::OrderedDictionary;
+using current::storage::container::FlatDictionary;
 
 #endif  // CURRENT_STORAGE_CONTAINER_DICTIONARY_H
@@ -0,0 +1,413 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The flat, open-addressing, hash map, for the storage containers to use as their `MAP`, see `Flat` in `common.h`.
+//
+// Unlike `std::unordered_map`, which allocates a node per entry, the entries are kept in chunks of slots, and
+// the hash table itself is an array of eight-byte buckets, each holding the index of the slot and 32 bits of the hash
+// of the key, probed linearly. A lookup scans one contiguous run of buckets, and then only reads the slot whose hash
+// matches. The memory per entry is that of the entry itself, plus about a dozen bytes of the buckets.
+//
+// The chunks grow geometrically, from `kSlotsInFirstChunk` slots to `kSlotsPerChunk`, and are all of `kSlotsPerChunk`
+// slots from then on. So a small map takes little memory, which matters for the secondary indexes and the matrix
+// containers, which keep one map per distinct value, row or column.
+//
+// The entries never move: the chunks are never reallocated, and the slots of the erased entries are reused.
+// So, as with `std::unordered_map`, the pointers to the entries stay valid until they are erased, which the secondary
+// indexes and the row and column maps of the matrix containers rely on. The iteration is over the slots, which is
+// in the order of insertion until the entries are erased. Holds up to 2^32 - 1 entries.
+
+#ifndef CURRENT_STORAGE_CONTAINER_FLAT_MAP_H
+#define CURRENT_STORAGE_CONTAINER_FLAT_MAP_H
+
+#include "../../port.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../../bricks/util/comparators.h"  // For `GenericHashFunction`.
+
+namespace current {
+namespace storage {
+namespace container {
+
+namespace impl {
+
+constexpr size_t FloorLog2(size_t x) {
+  size_t result = 0u;
+  while (x >>= 1u) {
+    ++result;
+  }
+  return result;
+}
+
+}  // namespace current::storage::container::impl
+
+template <typename KEY, typename VALUE, typename HASH = GenericHashFunction<KEY>>
+class FlatMap final {
+ public:
+  using key_type = KEY;
+  using mapped_type = VALUE;
+  using value_type = std::pair<const KEY, VALUE>;
+  using hasher = HASH;
+  using size_type = size_t;
+
+  constexpr static size_t kSlotsInFirstChunk = 8u;
+  constexpr static size_t kSlotsPerChunk = 1024u;
+
+ private:
+  static_assert(kSlotsInFirstChunk && !(kSlotsInFirstChunk & (kSlotsInFirstChunk - 1u)) &&
+                    kSlotsPerChunk % kSlotsInFirstChunk == 0u &&
+                    !((kSlotsPerChunk / kSlotsInFirstChunk) & (kSlotsPerChunk / kSlotsInFirstChunk - 1u)),
+                "The sizes of the chunks should be powers of two.");
+
+  // The growing chunks are those of `kSlotsInFirstChunk`, twice that, and so on, up to `kSlotsPerChunk / 2` slots.
+  constexpr static size_t kGrowingChunks = impl::FloorLog2(kSlotsPerChunk / kSlotsInFirstChunk);
+
+  struct Slot final {
+    alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+    value_type& Value() { return *std::launder(reinterpret_cast<value_type*>(storage)); }
+    const value_type& Value() const { return *std::launder(reinterpret_cast<const value_type*>(storage)); }
+  };
+
+  // The slots hold nothing but the entries, which ones of them are occupied is kept aside, in `occupied_`.
+  using chunk_t = std::unique_ptr<Slot[]>;
+
+  struct Bucket final {
+    uint32_t slot_plus_one = 0u;  // Zero for the empty bucket.
+    uint32_t hash = 0u;
+  };
+
+  template <bool IS_CONST>
+  class IteratorImpl final {
+   public:
+    using map_t = std::conditional_t<IS_CONST, const FlatMap, FlatMap>;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename FlatMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IS_CONST, const value_type*, value_type*>;
+    using reference = std::conditional_t<IS_CONST, const value_type&, value_type&>;
+
+    IteratorImpl() = default;
+    IteratorImpl(map_t* map, size_t index) : map_(map), index_(index) {}
+    template <bool B = IS_CONST, class = std::enable_if_t<B>>
+    IteratorImpl(const IteratorImpl<false>& rhs) : map_(rhs.map_), index_(rhs.index_) {}
+
+    reference operator*() const { return map_->SlotAt(index_).Value(); }
+    pointer operator->() const { return &map_->SlotAt(index_).Value(); }
+    IteratorImpl& operator++() {
+      index_ = map_->NextOccupied(index_ + 1u);
+      return *this;
+    }
+    IteratorImpl operator++(int) {
+      IteratorImpl result = *this;
+      operator++();
+      return result;
+    }
+    bool operator==(const IteratorImpl& rhs) const { return index_ == rhs.index_; }
+    bool operator!=(const IteratorImpl& rhs) const { return !operator==(rhs); }
+
+   private:
+    friend class FlatMap;
+    friend class IteratorImpl<!IS_CONST>;
+    map_t* map_ = nullptr;
+    size_t index_ = 0u;
+  };
+
+ public:
+  using iterator = IteratorImpl<false>;
+  using const_iterator = IteratorImpl<true>;
+
+  FlatMap() = default;
+  FlatMap(const FlatMap& rhs) {
+    reserve(rhs.size());
+    for (const value_type& entry : rhs) {
+      emplace(entry.first, entry.second);
+    }
+  }
+  FlatMap(FlatMap&& rhs) noexcept { swap(rhs); }
+  FlatMap& operator=(FlatMap rhs) {
+    swap(rhs);
+    return *this;
+  }
+  ~FlatMap() { clear(); }
+
+  void swap(FlatMap& rhs) noexcept {
+    std::swap(buckets_, rhs.buckets_);
+    std::swap(chunks_, rhs.chunks_);
+    std::swap(occupied_, rhs.occupied_);
+    std::swap(free_slots_, rhs.free_slots_);
+    std::swap(slots_used_, rhs.slots_used_);
+    std::swap(size_, rhs.size_);
+  }
+
+  bool empty() const { return size_ == 0u; }
+  size_t size() const { return size_; }
+  // The number of slots allocated, in all the chunks, be they occupied or not.
+  size_t capacity() const { return occupied_.size(); }
+
+  iterator begin() { return iterator(this, NextOccupied(0u)); }
+  iterator end() { return iterator(this, slots_used_); }
+  const_iterator begin() const { return cbegin(); }
+  const_iterator end() const { return cend(); }
+  const_iterator cbegin() const { return const_iterator(this, NextOccupied(0u)); }
+  const_iterator cend() const { return const_iterator(this, slots_used_); }
+
+  iterator find(const KEY& key) { return iterator(this, FindSlot(key)); }
+  const_iterator find(const KEY& key) const { return const_iterator(this, FindSlot(key)); }
+  size_t count(const KEY& key) const { return FindSlot(key) != slots_used_ ? 1u : 0u; }
+
+  template <typename K, typename... ARGS>
+  std::pair<iterator, bool> try_emplace(K&& key, ARGS&&... args) {
+    const uint32_t hash = Hash(key);
+    if (!buckets_.empty()) {
+      const Bucket& bucket = buckets_[FindBucket(key, hash)];
+      if (bucket.slot_plus_one) {
+        return std::make_pair(iterator(this, bucket.slot_plus_one - 1u), false);
+      }
+    }
+    if ((size_ + 1u) * 8u > buckets_.size() * 7u) {
+      Rehash(buckets_.empty() ? 16u : buckets_.size() * 2u);
+    }
+    const size_t index = AllocateSlot();
+    try {
+      new (SlotAt(index).storage) value_type(std::piecewise_construct,
+                                    std::forward_as_tuple(std::forward<K>(key)),
+                                    std::forward_as_tuple(std::forward<ARGS>(args)...));
+    } catch (...) {
+      free_slots_.push_back(static_cast<uint32_t>(index));
+      throw;
+    }
+    SetOccupied(index, true);
+    ++size_;
+    buckets_[FindEmptyBucket(hash)] = Bucket{static_cast<uint32_t>(index + 1u), hash};
+    return std::make_pair(iterator(this, index), true);
+  }
+
+  template <typename K, typename V>
+  std::pair<iterator, bool> emplace(K&& key, V&& value) {
+    return try_emplace(std::forward<K>(key), std::forward<V>(value));
+  }
+
+  VALUE& operator[](const KEY& key) { return try_emplace(key).first->second; }
+  VALUE& operator[](KEY&& key) { return try_emplace(std::move(key)).first->second; }
+
+  size_t erase(const KEY& key) {
+    if (buckets_.empty()) {
+      return 0u;
+    }
+    const size_t bucket = FindBucket(key, Hash(key));
+    if (buckets_[bucket].slot_plus_one) {
+      EraseBucket(bucket);
+      return 1u;
+    } else {
+      return 0u;
+    }
+  }
+
+  iterator erase(const_iterator it) {
+    const size_t index = it.index_;
+    const size_t mask = buckets_.size() - 1u;
+    size_t bucket = Hash(it->first) & mask;
+    while (buckets_[bucket].slot_plus_one != index + 1u) {
+      bucket = (bucket + 1u) & mask;
+    }
+    EraseBucket(bucket);
+    return iterator(this, NextOccupied(index + 1u));
+  }
+
+  void clear() {
+    for (size_t i = 0u; i < slots_used_; ++i) {
+      if (IsOccupied(i)) {
+        SlotAt(i).Value().~value_type();
+      }
+    }
+    buckets_.clear();
+    chunks_.clear();
+    occupied_.clear();
+    free_slots_.clear();
+    slots_used_ = 0u;
+    size_ = 0u;
+  }
+
+  void reserve(size_t size) {
+    size_t buckets = std::max(buckets_.size(), static_cast<size_t>(16u));
+    while (size * 8u > buckets * 7u) {
+      buckets *= 2u;
+    }
+    if (buckets != buckets_.size()) {
+      Rehash(buckets);
+    }
+  }
+
+ private:
+  // The hash of the key, mixed, as `std::hash<>` of an integer is the integer itself.
+  static uint32_t Hash(const KEY& key) {
+    uint64_t h = static_cast<uint64_t>(HASH()(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return static_cast<uint32_t>(h);
+  }
+
+  // The slots of the chunk `i` start from `(kSlotsInFirstChunk << i) - kSlotsInFirstChunk` while the chunks grow,
+  // so, with `kSlotsInFirstChunk` added, the index of the slot is in `[kSlotsInFirstChunk << i, kSlotsInFirstChunk <<
+  // (i + 1))`. From `kSlotsPerChunk` on, with `kSlotsInFirstChunk` added, each chunk is `kSlotsPerChunk` slots more.
+  static size_t ChunkSize(size_t chunk) {
+    return chunk < kGrowingChunks ? (kSlotsInFirstChunk << chunk) : kSlotsPerChunk;
+  }
+  Slot& SlotAt(size_t index) { return LocateSlot(index); }
+  const Slot& SlotAt(size_t index) const { return LocateSlot(index); }
+  Slot& LocateSlot(size_t index) const {
+    const size_t biased = index + kSlotsInFirstChunk;
+    if (biased >= kSlotsPerChunk) {
+      return chunks_[kGrowingChunks + (biased - kSlotsPerChunk) / kSlotsPerChunk][biased % kSlotsPerChunk];
+    } else {
+      const size_t chunk = impl::FloorLog2(biased / kSlotsInFirstChunk);
+      return chunks_[chunk][biased - (kSlotsInFirstChunk << chunk)];
+    }
+  }
+  bool IsOccupied(size_t index) const { return occupied_[index]; }
+  void SetOccupied(size_t index, bool occupied) { occupied_[index] = occupied; }
+
+  size_t NextOccupied(size_t index) const {
+    while (index < slots_used_ && !IsOccupied(index)) {
+      ++index;
+    }
+    return std::min(index, slots_used_);
+  }
+
+  // The bucket holding `key`, or the empty bucket ending its probe sequence. The table must not be empty.
+  size_t FindBucket(const KEY& key, uint32_t hash) const {
+    const size_t mask = buckets_.size() - 1u;
+    size_t i = hash & mask;
+    while (true) {
+      const Bucket& bucket = buckets_[i];
+      if (!bucket.slot_plus_one ||
+          (bucket.hash == hash && SlotAt(bucket.slot_plus_one - 1u).Value().first == key)) {
+        return i;
+      }
+      i = (i + 1u) & mask;
+    }
+  }
+
+  size_t FindEmptyBucket(uint32_t hash) const {
+    const size_t mask = buckets_.size() - 1u;
+    size_t i = hash & mask;
+    while (buckets_[i].slot_plus_one) {
+      i = (i + 1u) & mask;
+    }
+    return i;
+  }
+
+  // The index of the slot holding `key`, or `slots_used_` if there is none, for it to be the `end()` iterator.
+  size_t FindSlot(const KEY& key) const {
+    if (buckets_.empty()) {
+      return slots_used_;
+    }
+    const Bucket& bucket = buckets_[FindBucket(key, Hash(key))];
+    return bucket.slot_plus_one ? bucket.slot_plus_one - 1u : slots_used_;
+  }
+
+  size_t AllocateSlot() {
+    if (!free_slots_.empty()) {
+      const size_t index = free_slots_.back();
+      free_slots_.pop_back();
+      return index;
+    }
+    if (slots_used_ == occupied_.size()) {
+      const size_t slots = ChunkSize(chunks_.size());
+      // The slots are left uninitialized, as `std::make_unique<Slot[]>()` would zero them.
+      chunks_.push_back(chunk_t(new Slot[slots]));
+      occupied_.resize(occupied_.size() + slots, false);
+    }
+    return slots_used_++;
+  }
+
+  // Removes the entry, and then shifts the following buckets of the probe sequence back, leaving no tombstones.
+  void EraseBucket(size_t i) {
+    const size_t index = buckets_[i].slot_plus_one - 1u;
+    SlotAt(index).Value().~value_type();
+    SetOccupied(index, false);
+    if (--size_) {
+      free_slots_.push_back(static_cast<uint32_t>(index));
+    } else {
+      // All the slots are free, so start over from the first one, keeping the chunks allocated.
+      free_slots_.clear();
+      slots_used_ = 0u;
+    }
+    const size_t mask = buckets_.size() - 1u;
+    size_t j = i;
+    while (true) {
+      j = (j + 1u) & mask;
+      if (!buckets_[j].slot_plus_one) {
+        break;
+      }
+      const size_t home = buckets_[j].hash & mask;
+      if (((j - home) & mask) >= ((j - i) & mask)) {
+        buckets_[i] = buckets_[j];
+        i = j;
+      }
+    }
+    buckets_[i] = Bucket();
+  }
+
+  void Rehash(size_t buckets_count) {
+    std::vector<Bucket> buckets(buckets_count);
+    const size_t mask = buckets_count - 1u;
+    for (const Bucket& bucket : buckets_) {
+      if (bucket.slot_plus_one) {
+        size_t i = bucket.hash & mask;
+        while (buckets[i].slot_plus_one) {
+          i = (i + 1u) & mask;
+        }
+        buckets[i] = bucket;
+      }
+    }
+    buckets_.swap(buckets);
+  }
+
+  std::vector<Bucket> buckets_;  // The size is zero or a power of two.
+  std::vector<chunk_t> chunks_;
+  std::vector<bool> occupied_;  // Per slot, for all the slots of all the chunks.
+  std::vector<uint32_t> free_slots_;
+  size_t slots_used_ = 0u;  // The slots past this one have never been used.
+  size_t size_ = 0u;
+};
+
+}  // namespace current::storage::container
+}  // namespace current::storage
+}  // namespace current
+
+#endif  // CURRENT_STORAGE_CONTAINER_FLAT_MAP_H
@@ -0,0 +1,302 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The secondary indexes of the storage dictionaries.
+//
+// An index is declared on a field of the entry, as unique or non-unique, hashed (`Unordered`) or `Ordered`:
+//
+//   CURRENT_STORAGE_INDEX(UserByEmail, User, email, Unique, Unordered);
+//   CURRENT_STORAGE_INDEX(UserByAge, User, age, NonUnique, Ordered);
+//
+// and attached to the storage field, after it is declared, and before the storage using it is:
+//
+//   CURRENT_STORAGE_FIELD_ENTRY(OrderedDictionary, User, PersistedUser);
+//   CURRENT_STORAGE_FIELD_INDEXES(PersistedUser, UserByEmail, UserByAge);
+//
+// Then `fields.user.ByIndex<UserByEmail>(email)` is the `ImmutableOptional<User>`, `fields.user.ByIndex<UserByAge>(42)`
+// is the accessor to the users of that age, iterating over `const User&`-s by their keys, and
+// `fields.user.ByIndexRange<UserByAge>(18, 65)` iterates over the users with the age in `[18, 65)`, ordered by the age,
+// and then, as the dictionary itself is, by the key.
+//
+// The indexes are kept by the dictionary itself, and are updated along with its entries, be it from the transaction,
+// from its rollback, or from the replay of the stream, so they are always consistent with the committed entries.
+// Adding an entry which has the same value of a unique index as another one throws, rolling back the transaction,
+// and so does replaying the stream which has such entries, as the stream written before the index was declared may.
+
+#ifndef CURRENT_STORAGE_CONTAINER_INDEX_H
+#define CURRENT_STORAGE_CONTAINER_INDEX_H
+
+#include "../../port.h"
+
+#include <tuple>
+#include <type_traits>
+
+#include "common.h"
+#include "sfinae.h"
+
+#include "../exceptions.h"
+
+#include "../../typesystem/optional.h"
+
+#include "../../bricks/template/typelist.h"
+#include "../../bricks/util/iterator.h"
+#include "../../bricks/util/singleton.h"
+
+namespace current {
+namespace storage {
+
+struct StorageUniqueIndexViolationException : StorageException {
+  explicit StorageUniqueIndexViolationException(const std::string& index_name)
+      : StorageException("The value of the unique index `" + index_name + "` is already taken by another entry.") {}
+};
+
+// Thrown when the stream being replayed has two entries with the same value of the unique index, which only happens
+// if the stream was written without the index; it is not rebuilt from such a stream, as it would be ambiguous.
+struct StorageUniqueIndexViolationOnReplayException : StorageException {
+  explicit StorageUniqueIndexViolationOnReplayException(const std::string& index_name)
+      : StorageException("The stream being replayed has more than one entry with the same value of the unique index `" +
+                         index_name + "`.") {}
+};
+
+namespace index {
+
+struct Unique {};
+struct NonUnique {};
+
+// The indexes of the storage field, declared with `CURRENT_STORAGE_FIELD_INDEXES`, are found by ADL.
+::current::metaprogramming::TypeListImpl<> CurrentStorageFieldIndexes(...);
+
+template <typename STORAGE_FIELD>
+using field_indexes_t = decltype(CurrentStorageFieldIndexes(std::declval<const STORAGE_FIELD*>()));
+
+// The entries of the dictionary by the value of one index, and, for each value, by their keys.
+template <typename INDEX, typename KEY, typename ENTRY, template <typename...> class MAP>
+class SecondaryIndex final {
+ public:
+  using value_t = typename INDEX::value_t;
+  using entries_map_t = MAP<KEY, const ENTRY*>;
+  using index_map_t = typename INDEX::template map_t<value_t, entries_map_t>;
+  constexpr static bool is_unique = std::is_same_v<typename INDEX::uniqueness_t, Unique>;
+
+  // Iterates over the entries of a range of the values of the index, ordered by the value, and then as in `MAP`.
+  class Range final {
+   public:
+    using outer_iterator_t = typename index_map_t::const_iterator;
+    using inner_iterator_t = typename entries_map_t::const_iterator;
+
+    struct Iterator final {
+      outer_iterator_t outer;
+      outer_iterator_t outer_end;
+      inner_iterator_t inner;
+
+      Iterator(outer_iterator_t outer, outer_iterator_t outer_end) : outer(outer), outer_end(outer_end) {
+        if (outer != outer_end) {
+          inner = outer->second.begin();
+        }
+      }
+      void operator++() {
+        if (++inner == outer->second.end()) {
+          if (++outer != outer_end) {
+            inner = outer->second.begin();
+          }
+        }
+      }
+      bool operator==(const Iterator& rhs) const {
+        return outer == rhs.outer && (outer == outer_end || inner == rhs.inner);
+      }
+      bool operator!=(const Iterator& rhs) const { return !operator==(rhs); }
+      copy_free<value_t> IndexValue() const { return outer->first; }
+      copy_free<KEY> key() const { return inner->first; }
+      const ENTRY& operator*() const { return *inner->second; }
+      const ENTRY* operator->() const { return inner->second; }
+    };
+
+    Range(outer_iterator_t begin, outer_iterator_t end) : begin_(begin), end_(end) {}
+
+    bool Empty() const { return begin_ == end_; }
+    Iterator begin() const { return Iterator(begin_, end_); }
+    Iterator end() const { return Iterator(end_, end_); }
+
+   private:
+    outer_iterator_t begin_;
+    outer_iterator_t end_;
+  };
+
+  // The entries with one value of the non-unique index, by their keys, ordered as in `MAP`.
+  class Entries final {
+   public:
+    using inner_iterator_t = typename entries_map_t::const_iterator;
+
+    struct Iterator final {
+      inner_iterator_t inner;
+
+      void operator++() { ++inner; }
+      bool operator==(const Iterator& rhs) const { return inner == rhs.inner; }
+      bool operator!=(const Iterator& rhs) const { return !operator==(rhs); }
+      copy_free<KEY> key() const { return inner->first; }
+      const ENTRY& operator*() const { return *inner->second; }
+      const ENTRY* operator->() const { return inner->second; }
+    };
+
+    explicit Entries(const entries_map_t& map) : map_(map) {}
+
+    bool Empty() const { return map_.empty(); }
+    size_t Size() const { return map_.size(); }
+    bool Has(sfinae::CF<KEY> key) const { return map_.find(key) != map_.end(); }
+
+    ImmutableOptional<ENTRY> operator[](sfinae::CF<KEY> key) const {
+      const auto cit = map_.find(key);
+      if (cit != map_.end()) {
+        return ImmutableOptional<ENTRY>(FromBarePointer(), cit->second);
+      } else {
+        return nullptr;
+      }
+    }
+
+    Iterator begin() const { return Iterator{map_.cbegin()}; }
+    Iterator end() const { return Iterator{map_.cend()}; }
+
+   private:
+    const entries_map_t& map_;
+  };
+
+  // Whether `entry` can not be stored under `key`, as another entry has the same value of this unique index.
+  bool Conflicts(sfinae::CF<KEY> key, const ENTRY& entry) const {
+    if constexpr (is_unique) {
+      const auto cit = map_.find(INDEX::Get(entry));
+      return cit != map_.end() && cit->second.find(key) == cit->second.end();
+    } else {
+      static_cast<void>(key);
+      static_cast<void>(entry);
+      return false;
+    }
+  }
+
+  // `entry` must be the very entry stored in the dictionary, as it is referred to by the index.
+  void Insert(sfinae::CF<KEY> key, const ENTRY& entry) { map_[INDEX::Get(entry)][key] = &entry; }
+
+  void Erase(sfinae::CF<KEY> key, const ENTRY& entry) {
+    const auto it = map_.find(INDEX::Get(entry));
+    if (it != map_.end()) {
+      it->second.erase(key);
+      if (it->second.empty()) {
+        map_.erase(it);
+      }
+    }
+  }
+
+  // The entry with this value, if any, for the unique index, and the accessor to the entries for the non-unique one.
+  auto Find(sfinae::CF<value_t> value) const {
+    const auto cit = map_.find(value);
+    if constexpr (is_unique) {
+      if (cit != map_.end()) {
+        return ImmutableOptional<ENTRY>(FromBarePointer(), cit->second.begin()->second);
+      } else {
+        return ImmutableOptional<ENTRY>(nullptr);
+      }
+    } else {
+      return Entries(cit != map_.end() ? cit->second : current::ThreadLocalSingleton<entries_map_t>());
+    }
+  }
+
+  Range All() const { return Range(map_.begin(), map_.end()); }
+
+  // The entries with the value of the index in `[from, to)`, for the ordered index.
+  Range FromTo(sfinae::CF<value_t> from, sfinae::CF<value_t> to) const {
+    static_assert(!stl_wrappers::sfinae::is_unordered_map<index_map_t>::value,
+                  "The range of values can only be iterated over for an ordered index.");
+    const auto begin = map_.lower_bound(from);
+    return Range(begin, CurrentComparator<value_t>()(from, to) ? map_.lower_bound(to) : begin);
+  }
+
+ private:
+  index_map_t map_;
+};
+
+template <typename KEY, typename ENTRY, template <typename...> class MAP, typename INDEXES>
+class SecondaryIndexes;
+
+template <typename KEY, typename ENTRY, template <typename...> class MAP, typename... INDEXES>
+class SecondaryIndexes<KEY, ENTRY, MAP, ::current::metaprogramming::TypeListImpl<INDEXES...>> final {
+ public:
+  constexpr static bool has_unique = (SecondaryIndex<INDEXES, KEY, ENTRY, MAP>::is_unique || ... || false);
+
+  // Throws if `entry` can not be stored under `key`, before anything is changed.
+  template <typename EXCEPTION = StorageUniqueIndexViolationException>
+  void AssertNoConflicts(sfinae::CF<KEY> key, const ENTRY& entry) const {
+    if constexpr (has_unique) {
+      (AssertNoConflict<INDEXES, EXCEPTION>(key, entry), ...);
+    } else {
+      static_cast<void>(key);
+      static_cast<void>(entry);
+    }
+  }
+
+  void Insert(sfinae::CF<KEY> key, const ENTRY& entry) {
+    static_cast<void>(key);  // Unused if there are no indexes.
+    static_cast<void>(entry);
+    (std::get<SecondaryIndex<INDEXES, KEY, ENTRY, MAP>>(indexes_).Insert(key, entry), ...);
+  }
+
+  void Erase(sfinae::CF<KEY> key, const ENTRY& entry) {
+    static_cast<void>(key);  // Unused if there are no indexes.
+    static_cast<void>(entry);
+    (std::get<SecondaryIndex<INDEXES, KEY, ENTRY, MAP>>(indexes_).Erase(key, entry), ...);
+  }
+
+  template <typename INDEX>
+  const SecondaryIndex<INDEX, KEY, ENTRY, MAP>& Get() const {
+    return std::get<SecondaryIndex<INDEX, KEY, ENTRY, MAP>>(indexes_);
+  }
+
+ private:
+  template <typename INDEX, typename EXCEPTION>
+  void AssertNoConflict(sfinae::CF<KEY> key, const ENTRY& entry) const {
+    if (std::get<SecondaryIndex<INDEX, KEY, ENTRY, MAP>>(indexes_).Conflicts(key, entry)) {
+      CURRENT_THROW(EXCEPTION(INDEX::Name()));
+    }
+  }
+
+  std::tuple<SecondaryIndex<INDEXES, KEY, ENTRY, MAP>...> indexes_;
+};
+
+}  // namespace current::storage::index
+}  // namespace current::storage
+}  // namespace current
+
+#define CURRENT_STORAGE_INDEX(index_name, entry_type, field, uniqueness, map_type)                  \
+  struct index_name {                                                                               \
+    using entry_t = entry_type;                                                                     \
+    using value_t = std::decay_t<decltype(std::declval<entry_type>().field)>;                       \
+    using uniqueness_t = ::current::storage::index::uniqueness;                                     \
+    template <typename K, typename V>                                                               \
+    using map_t = ::current::storage::container::map_type<K, V>;                                    \
+    static const char* Name() { return #index_name; }                                               \
+    static const value_t& Get(const entry_type& entry) { return entry.field; }                      \
+  }
+
+#define CURRENT_STORAGE_FIELD_INDEXES(entry_name, ...) \
+  ::current::metaprogramming::TypeListImpl<__VA_ARGS__> CurrentStorageFieldIndexes(const entry_name*)
+
+#endif  // CURRENT_STORAGE_CONTAINER_INDEX_H
@@ -54,7 +54,8 @@ class GenericOneToMany {
   using row_t = sfinae::entry_row_t<T>;
   using col_t = sfinae::entry_col_t<T>;
   using key_t = std::pair<row_t, col_t>;
-  using elements_map_t = std::unordered_map<key_t, std::unique_ptr<T>, GenericHashFunction<key_t>>;
+  using cells_t = MatrixCells<ROW_MAP, key_t, T>;
+  using elements_map_t = typename cells_t::map_t;
   using row_elements_map_t = COL_MAP<col_t, const T*>;
   using forward_map_t = ROW_MAP<row_t, row_elements_map_t>;
   using transposed_map_t = row_elements_map_t;
@@ -82,26 +83,21 @@ class GenericOneToMany {
     const auto map_cit = map_.find(key);
     const auto lm_cit = last_modified_.find(key);
     if (map_cit != map_.end()) {
-      const T& previous_object = *(map_cit->second);
       CURRENT_ASSERT(lm_cit != last_modified_.end());
       const auto previous_timestamp = lm_cit->second;
-      journal_.LogMutation(UPDATE_EVENT(now, object),
-                           [this, key, previous_object, previous_timestamp]() {
-                             DoUpdateWithLastModified(previous_timestamp, key, previous_object);
-                           });
+      // The previous cell is moved into the rollback record, and the new object is copied from the logged event,
+      // as `object` may well refer to the very cell being replaced.
+      UPDATE_EVENT event(now, object);
+      const UPDATE_EVENT& logged_event = journal_.LogMutation(
+          std::move(event), [this, key, previous_cell = cells_t::Take(map_, key), previous_timestamp]() mutable {
+            DoUpdateWithLastModified(previous_timestamp, key, std::move(previous_cell));
+          });
+      DoUpdateWithLastModified(now, key, logged_event.data);
     } else {
       const auto transposed_cit = transposed_.find(col);
       if (transposed_cit != transposed_.end()) {
-        const T& conflicting_object = *(transposed_cit->second);
-        const auto conflicting_object_key = std::make_pair(sfinae::GetRow(conflicting_object), col);
-        const auto conflicting_object_lm_cit = last_modified_.find(conflicting_object_key);
-        CURRENT_ASSERT(conflicting_object_lm_cit != last_modified_.end());
-        const auto conflicting_object_timestamp = conflicting_object_lm_cit->second;
-        journal_.LogMutation(DELETE_EVENT(now, conflicting_object),
-                             [this, conflicting_object_key, conflicting_object, conflicting_object_timestamp]() {
-                               DoUpdateWithLastModified(
-                                   conflicting_object_timestamp, conflicting_object_key, conflicting_object);
-                             });
+        const auto conflicting_object_key = std::make_pair(sfinae::GetRow(*(transposed_cit->second)), col);
+        LogErasure(now, conflicting_object_key);
         DoEraseWithLastModified(now, conflicting_object_key);
         now = current::time::Now();
       }
@@ -116,8 +112,8 @@ class GenericOneToMany {
                                DoEraseWithoutTouchingLastModified(key);
                              });
       }
+      DoUpdateWithLastModified(now, key, object);
     }
-    DoUpdateWithLastModified(now, key, object);
   }
 
   // Here and below pass the key by a const reference, as `key_t` is an `std::pair<row_t, col_t>`.
@@ -125,14 +121,7 @@ class GenericOneToMany {
     const auto now = current::time::Now();
     const auto map_cit = map_.find(key);
     if (map_cit != map_.end()) {
-      const T& previous_object = *(map_cit->second);
-      const auto lm_cit = last_modified_.find(key);
-      CURRENT_ASSERT(lm_cit != last_modified_.end());
-      const auto previous_timestamp = lm_cit->second;
-      journal_.LogMutation(DELETE_EVENT(now, previous_object),
-                           [this, key, previous_object, previous_timestamp]() {
-                             DoUpdateWithLastModified(previous_timestamp, key, previous_object);
-                           });
+      LogErasure(now, key);
       DoEraseWithLastModified(now, key);
     }
   }
@@ -142,15 +131,8 @@ class GenericOneToMany {
     const auto now = current::time::Now();
     const auto map_cit = transposed_.find(col);
     if (map_cit != transposed_.end()) {
-      const T& previous_object = *(map_cit->second);
-      const auto key = std::make_pair(sfinae::GetRow(previous_object), col);
-      const auto lm_cit = last_modified_.find(key);
-      CURRENT_ASSERT(lm_cit != last_modified_.end());
-      const auto previous_timestamp = lm_cit->second;
-      journal_.LogMutation(DELETE_EVENT(now, previous_object),
-                           [this, key, previous_object, previous_timestamp]() {
-                             DoUpdateWithLastModified(previous_timestamp, key, previous_object);
-                           });
+      const auto key = std::make_pair(sfinae::GetRow(*(map_cit->second)), col);
+      LogErasure(now, key);
       DoEraseWithLastModified(now, key);
     }
   }
@@ -158,7 +140,7 @@ class GenericOneToMany {
   ImmutableOptional<T> operator[](const key_t& key) const {
     const auto cit = map_.find(key);
     if (cit != map_.end()) {
-      return ImmutableOptional<T>(FromBarePointer(), cit->second.get());
+      return ImmutableOptional<T>(FromBarePointer(), &cells_t::Get(cit->second));
     } else {
       return nullptr;
     }
@@ -192,6 +174,22 @@ class GenericOneToMany {
     return DoesNotConflict(std::make_pair(row, col));
   }
 
+  // Calls `f` with the events which, applied to the empty container, restore its state, last modified times included.
+  template <typename F>
+  void ExportState(F&& f) const {
+    for (const auto& lm : last_modified_) {
+      const auto map_cit = map_.find(lm.first);
+      if (map_cit != map_.end()) {
+        f(UPDATE_EVENT(lm.second, cells_t::Get(map_cit->second)));
+      } else {
+        DELETE_EVENT event;
+        event.us = lm.second;
+        event.key = lm.first;
+        f(std::move(event));
+      }
+    }
+  }
+
   void operator()(const UPDATE_EVENT& e) {
     const auto row = sfinae::GetRow(e.data);
     const auto col = sfinae::GetCol(e.data);
@@ -261,12 +259,25 @@ class GenericOneToMany {
   iterator_t end() const { return iterator_t(map_.end()); }
 
  private:
-  void DoUpdateWithLastModified(std::chrono::microseconds us, const key_t& key, const T& object) {
+  // Logs the erasure of the existing cell at `key`, which is to follow, moving the cell into the rollback record.
+  void LogErasure(std::chrono::microseconds now, const key_t& key) {
+    const auto lm_cit = last_modified_.find(key);
+    CURRENT_ASSERT(lm_cit != last_modified_.end());
+    const auto previous_timestamp = lm_cit->second;
+    DELETE_EVENT event(now, cells_t::Get(map_.find(key)->second));
+    journal_.LogMutation(std::move(event),
+                         [this, key, previous_cell = cells_t::Take(map_, key), previous_timestamp]() mutable {
+                           DoUpdateWithLastModified(previous_timestamp, key, std::move(previous_cell));
+                         });
+  }
+
+  // `object` is either the object to copy into the cell, or the very cell taken from it before, to put back.
+  template <typename O>
+  void DoUpdateWithLastModified(std::chrono::microseconds us, const key_t& key, O&& object) {
     last_modified_[key] = us;
-    auto& placeholder = map_[key];
-    placeholder = std::make_unique<T>(object);
-    forward_[key.first][key.second] = placeholder.get();
-    transposed_[key.second] = placeholder.get();
+    const T& placeholder = cells_t::Set(map_, key, std::forward<O>(object));
+    forward_[key.first][key.second] = &placeholder;
+    transposed_[key.second] = &placeholder;
   }
 
   void DoEraseWithoutTouchingLastModified(const key_t& key) {
@@ -288,7 +299,7 @@ class GenericOneToMany {
   elements_map_t map_;
   forward_map_t forward_;
   transposed_map_t transposed_;
-  std::unordered_map<key_t, std::chrono::microseconds, GenericHashFunction<key_t>> last_modified_;
+  typename cells_t::last_modified_map_t last_modified_;
   MutationJournal& journal_;
 };
 
@@ -326,6 +337,14 @@ using OrderedOneToUnorderedMany = GenericOneToMany<T,
                                                    Ordered,
                                                    Unordered>;
 
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT, typename PATCH_EVENT_OR_VOID>
+using FlatOneToFlatMany = GenericOneToMany<T,
+                                           UPDATE_EVENT,
+                                           DELETE_EVENT,
+                                           PATCH_EVENT_OR_VOID,
+                                           Flat,
+                                           Flat>;
+
 #else
 
 template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
@@ -340,6 +359,9 @@ using UnorderedOneToOrderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT
 template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
 using OrderedOneToUnorderedMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Ordered, Unordered>;
 
+template <typename T, typename UPDATE_EVENT, typename DELETE_EVENT>
+using FlatOneToFlatMany = GenericOneToMany<T, UPDATE_EVENT, DELETE_EVENT, Flat, Flat>;
+
 #endif  // CURRENT_STORAGE_PATCH_SUPPORT
 
 }  // namespace container
@@ -366,6 +388,11 @@ struct StorageFieldTypeSelector<container::OrderedOneToUnorderedMany<T, E1, E2,
   static const char* HumanReadableName() { return "OrderedOneToUnorderedMany"; }
 };
 
+template <typename T, typename E1, typename E2, typename E3>  // Entry, update event, delete event, patch event.
+struct StorageFieldTypeSelector<container::FlatOneToFlatMany<T, E1, E2, E3>> {
+  static const char* HumanReadableName() { return "FlatOneToFlatMany"; }
+};
+
 #else
 
 template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
@@ -388,6 +415,11 @@ struct StorageFieldTypeSelector<container::OrderedOneToUnorderedMany<T, E1, E2>>
   static const char* HumanReadableName() { return "OrderedOneToUnorderedMany"; }
 };
 
+template <typename T, typename E1, typename E2>  // Entry, update event, delete event.
+struct StorageFieldTypeSelector<container::FlatOneToFlatMany<T, E1, E2>> {
+  static const char* HumanReadableName() { return "FlatOneToFlatMany"; }
+};
+
 #endif  // CURRENT_STORAGE_PATCH_SUPPORT
 
 }  // namespace storage
@@ -397,5 +429,6 @@ using current::storage::container::UnorderedOneToUnorderedMany;
 using current::storage::container::OrderedOneToOrderedMany;
 using current::storage::container::UnorderedOneToOrderedMany;
 using current::storage::container::OrderedOneToUnorderedMany;
+using current::storage::container::FlatOneToFlatMany;
 
 #endif  // CURRENT_STORAGE_CONTAINER_ONE_TO_MANY_H
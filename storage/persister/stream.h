@@ -48,18 +48,22 @@ class StreamStreamPersisterImpl final {
                                             STREAM_RECORD_TYPE>;
   using stream_t = stream::Stream<stream_entry_t, UNDERLYING_PERSISTER>;
   using fields_update_function_t = std::function<void(const variant_t&)>;
+  using transaction_applied_function_t = std::function<void(const transaction_t&, idxts_t)>;
+  // Loads the state of the storage up to and including the stream entry returned, for which `is_valid` must hold,
+  // if it has any such state to load from.
+  using state_loader_function_t = std::function<Optional<idxts_t>(std::function<bool(idxts_t)> is_valid)>;
 
   struct StreamSubscriberImpl {
     using EntryResponse = current::ss::EntryResponse;
     using TerminationResponse = current::ss::TerminationResponse;
-    using replay_function_t = std::function<void(const transaction_t&, std::chrono::microseconds)>;
+    using replay_function_t = std::function<void(const transaction_t&, idxts_t)>;
     replay_function_t replay_f_;
     uint64_t next_replay_index_ = 0u;
 
     StreamSubscriberImpl(replay_function_t f) : replay_f_(f) {}
 
     EntryResponse operator()(const transaction_t& transaction, idxts_t current, idxts_t) {
-      replay_f_(transaction, current.us);
+      replay_f_(transaction, current);
       next_replay_index_ = current.index + 1u;
       return EntryResponse::More;
     }
@@ -74,31 +78,37 @@ class StreamStreamPersisterImpl final {
   struct Master {};
   struct Following {};
 
-  StreamStreamPersisterImpl(Master, fields_update_function_t f, Borrowed<stream_t> stream)
+  StreamStreamPersisterImpl(Master,
+                            fields_update_function_t f,
+                            Borrowed<stream_t> stream,
+                            state_loader_function_t state_loader = nullptr)
       : fields_update_f_(f),
         stream_publishing_mutex_ref_(stream->Impl()->publishing_mutex),
         stream_(std::move(stream)),
         publisher_used_(stream_->BecomeFollowingStream()) {
-    subscriber_instance_ = std::make_unique<StreamSubscriber>(
-        [this](const transaction_t& transaction, std::chrono::microseconds timestamp) {
-          std::lock_guard<std::mutex> lock(stream_publishing_mutex_ref_);
-          ApplyMutationsFromLockedSectionOrConstructor(transaction, timestamp);
-        });
+    subscriber_instance_ = std::make_unique<StreamSubscriber>([this](const transaction_t& transaction, idxts_t idx_ts) {
+      std::lock_guard<std::mutex> lock(stream_publishing_mutex_ref_);
+      ApplyMutationsFromLockedSectionOrConstructor(transaction, idx_ts);
+    });
     std::lock_guard<std::mutex> lock(stream_publishing_mutex_ref_);
-    SyncReplayStreamFromLockedSectionOrConstructor(0u);
+    LoadStateFromLockedSectionOrConstructor(state_loader);
+    SyncReplayStreamFromLockedSectionOrConstructor(next_applied_index_);
   }
 
-  StreamStreamPersisterImpl(Following, fields_update_function_t f, Borrowed<stream_t> stream)
+  StreamStreamPersisterImpl(Following,
+                            fields_update_function_t f,
+                            Borrowed<stream_t> stream,
+                            state_loader_function_t state_loader = nullptr)
       : fields_update_f_(f),
         stream_publishing_mutex_ref_(stream->Impl()->publishing_mutex),
         stream_(std::move(stream)) {
-    subscriber_instance_ = std::make_unique<StreamSubscriber>(
-        [this](const transaction_t& transaction, std::chrono::microseconds timestamp) {
-          std::lock_guard<std::mutex> lock(stream_publishing_mutex_ref_);
-          ApplyMutationsFromLockedSectionOrConstructor(transaction, timestamp);
-        });
+    subscriber_instance_ = std::make_unique<StreamSubscriber>([this](const transaction_t& transaction, idxts_t idx_ts) {
+      std::lock_guard<std::mutex> lock(stream_publishing_mutex_ref_);
+      ApplyMutationsFromLockedSectionOrConstructor(transaction, idx_ts);
+    });
     std::lock_guard<std::mutex> lock(stream_publishing_mutex_ref_);
-    SubscribeToStreamFromLockedSection();
+    LoadStateFromLockedSectionOrConstructor(state_loader);
+    SubscribeToStreamFromLockedSection(next_applied_index_);
   }
 
   ~StreamStreamPersisterImpl() {
@@ -121,24 +131,40 @@ class StreamStreamPersisterImpl final {
   void PersistJournalFromLockedSection(MutationJournal& journal) {
     const std::chrono::microseconds timestamp = current::time::Now();
     CURRENT_ASSERT(Exists(publisher_used_));
-    if (!journal.commit_log.empty()) {
+    if (journal.EventsCount()) {
 #ifndef CURRENT_MOCK_TIME
       CURRENT_ASSERT(journal.transaction_meta.begin_us < journal.transaction_meta.end_us);
 #else
       CURRENT_ASSERT(journal.transaction_meta.begin_us <= journal.transaction_meta.end_us);
 #endif
       transaction_t transaction;
-      for (auto&& entry : journal.commit_log) {
+      transaction.mutations.reserve(journal.EventsCount());
+      journal.ReleaseEvents([&transaction](std::unique_ptr<current::CurrentStruct> entry) {
         transaction.mutations.emplace_back(BypassVariantTypeCheck(), std::move(entry));
-      }
+      });
       std::swap(transaction.meta, journal.transaction_meta);
-      Value(publisher_used_)
-          ->template Publish<current::locks::MutexLockStatus::AlreadyLocked>(std::move(transaction), timestamp);
+      auto& publisher = Value(publisher_used_);
+      if (transaction_applied_f_) {
+        // Followed only once published, so that the followers never see a transaction the stream does not have.
+        const idxts_t published = publisher->template Publish<current::locks::MutexLockStatus::AlreadyLocked>(
+            static_cast<const transaction_t&>(transaction), timestamp);
+        next_applied_index_ = published.index + 1u;
+        transaction_applied_f_(transaction, published);
+      } else {
+        next_applied_index_ = publisher->template Publish<current::locks::MutexLockStatus::AlreadyLocked>(
+                                  std::move(transaction), timestamp).index +
+                              1u;
+      }
       SetLastAppliedTimestampFromLockedSection(timestamp);
     }
     journal.Clear();
   }
 
+  // Calls `f` for each transaction applied from now on, with its index and timestamp in the stream, be it committed
+  // by this master storage, or replayed from the stream by this following storage. It is called from the section
+  // locked by the publishing mutex of the stream, as is this method.
+  void FollowAppliedTransactionsFromLockedSection(transaction_applied_function_t f) { transaction_applied_f_ = f; }
+
   void ExposeRawLogViaHTTP(uint16_t port, const std::string& route) {
     handlers_scope_ += HTTP(port).Register(route,
                                            URLPathArgs::CountMask::None | URLPathArgs::CountMask::One,
@@ -178,30 +204,55 @@ class StreamStreamPersisterImpl final {
  private:
   // Invariant: both `subscriber_creator_destructor_mutex_` and `stream_publishing_mutex_ref_` are locked,
   // or the call is taking place from the constructor.
+  // The state loaded is only trusted if the stream has the very entry it ends with.
+  void LoadStateFromLockedSectionOrConstructor(state_loader_function_t state_loader) {
+    if (state_loader) {
+      const Optional<idxts_t> loaded = state_loader([this](idxts_t last) {
+        if (last.index >= stream_->Data()->template Size<current::locks::MutexLockStatus::AlreadyLocked>()) {
+          return false;
+        }
+        for (const auto& stream_record :
+             stream_->Data()->template Iterate<current::locks::MutexLockStatus::AlreadyLocked>(last.index,
+                                                                                                last.index + 1u)) {
+          return stream_record.idx_ts.us == last.us;
+        }
+        return false;
+      });
+      if (Exists(loaded)) {
+        next_applied_index_ = Value(loaded).index + 1u;
+        SetLastAppliedTimestampFromLockedSection(Value(loaded).us);
+      }
+    }
+  }
+
   void SyncReplayStreamFromLockedSectionOrConstructor(uint64_t from_idx) {
     for (const auto& stream_record :
          stream_->Data()->template Iterate<current::locks::MutexLockStatus::AlreadyLocked>(from_idx)) {
       if (Exists<transaction_t>(stream_record.entry)) {
         const transaction_t& transaction = Value<transaction_t>(stream_record.entry);
-        ApplyMutationsFromLockedSectionOrConstructor(transaction, stream_record.idx_ts.us);
+        ApplyMutationsFromLockedSectionOrConstructor(transaction, stream_record.idx_ts);
       }
     }
   }
 
-  void ApplyMutationsFromLockedSectionOrConstructor(const transaction_t& transaction,
-                                                    std::chrono::microseconds timestamp) {
+  void ApplyMutationsFromLockedSectionOrConstructor(const transaction_t& transaction, idxts_t idx_ts) {
     for (const auto& mutation : transaction.mutations) {
       fields_update_f_(mutation);
     }
-    SetLastAppliedTimestampFromLockedSection(timestamp);
+    if (transaction_applied_f_) {
+      transaction_applied_f_(transaction, idx_ts);
+    }
+    next_applied_index_ = idx_ts.index + 1u;
+    SetLastAppliedTimestampFromLockedSection(idx_ts.us);
   }
 
  private:
   // Invariant: `master_follower_change_mutex_` is locked, or the call is happening from the constructor.
-  void SubscribeToStreamFromLockedSection() {
+  void SubscribeToStreamFromLockedSection(uint64_t from_idx) {
     CURRENT_ASSERT(!subscriber_scope_);
     CURRENT_ASSERT(subscriber_instance_);
-    subscriber_scope_ = std::move(stream_->template Subscribe<transaction_t>(*subscriber_instance_));
+    subscriber_instance_->next_replay_index_ = from_idx;
+    subscriber_scope_ = std::move(stream_->template Subscribe<transaction_t>(*subscriber_instance_, from_idx));
   }
 
   // Invariant: `master_follower_change_mutex_` is locked.
@@ -215,6 +266,8 @@ class StreamStreamPersisterImpl final {
 
  private:
   fields_update_function_t fields_update_f_;
+  transaction_applied_function_t transaction_applied_f_;  // Set iff the transactions applied are followed.
+  uint64_t next_applied_index_ = 0u;  // The index of the stream entry after the last transaction applied.
 
   std::mutex& stream_publishing_mutex_ref_;  // == `stream_->Impl()->publishing_mutex`.
   Borrowed<stream_t> stream_;
@@ -0,0 +1,164 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The committed snapshots of the storage fields, for the read-only transactions to run in parallel, with no lock.
+//
+// Two replicas of the fields are kept, in the "left-right" manner. The read-only transactions run against the front
+// replica, while the committed transactions are applied to the back one, which then becomes the front replica.
+// The back replica lags behind by the transactions committed since the last flip, which are kept and applied to it
+// before the next committed transaction is.
+//
+// The replicas are only updated with the committed transactions, so the read-only transactions always see a
+// consistent, committed, version of the storage. The price is the memory for the two extra copies of the fields,
+// and that a commit waits, by yielding, for the read-only transactions still running against the back replica.
+// The wait is bounded: once it runs out, the commit returns with the front replica behind, the replicas are not
+// `UpToDate()`, and the read-only transactions run from the locked section, against the fields themselves, until
+// the replicas catch up, with the next commit or with a read-only transaction from the locked section.
+
+#ifndef CURRENT_STORAGE_SNAPSHOT_H
+#define CURRENT_STORAGE_SNAPSHOT_H
+
+#include "../port.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "transaction.h"
+
+#include "../blocks/ss/idx_ts.h"
+
+#include "../bricks/util/make_scope_guard.h"
+
+#include "../typesystem/optional.h"
+
+namespace current {
+namespace storage {
+
+template <typename FIELDS, typename TRANSACTION>
+class StorageSnapshots final {
+ public:
+  // The number of yields a commit waits for the read-only transactions running against the back replica.
+  constexpr static size_t kMaxYieldsWaitingForReaders = 1000u;
+
+  // Applies a mutation, such as one of the events exporting the state of the storage, to both replicas,
+  // before the snapshots are first read from.
+  template <typename MUTATION>
+  void ApplyMutationFromConstructor(const MUTATION& mutation) {
+    replicas_[0](mutation);
+    replicas_[1](mutation);
+  }
+
+  // Applies a committed transaction, which is at `idx_ts` in the stream. Must be called from the section locked by
+  // the publishing mutex of the stream. If the replicas are already behind, does not wait for the readers at all.
+  void ApplyFromLockedSection(const TRANSACTION& transaction, idxts_t idx_ts) {
+    pending_.push_back(transaction);
+    pending_last_ = idx_ts;
+    Flip(up_to_date_ ? kMaxYieldsWaitingForReaders : 0u);
+  }
+
+  // Brings the replicas up to date, if the back one has no readers left. Must be called from the locked section.
+  void CatchUpFromLockedSection() {
+    if (!up_to_date_) {
+      Flip(0u);
+    }
+  }
+
+  // Whether the front replica has all the transactions committed. If not, the read-only transactions should run from
+  // the locked section, to see the most recently committed version of the storage.
+  bool UpToDate() const { return up_to_date_; }
+
+  // Calls `f` with the front replica of the fields.
+  template <typename F>
+  std::result_of_t<F(const FIELDS&)> Read(F&& f) const {
+    const size_t index = AcquireFront();
+    const auto guard = current::MakeScopeGuard([this, index]() { --readers_[index]; });
+    return f(static_cast<const FIELDS&>(replicas_[index]));
+  }
+
+  // Calls `f` with the front replica of the fields, and with the index and the timestamp of the last transaction
+  // applied to it, or `nullptr` if there was none since the replicas were created.
+  template <typename F>
+  std::result_of_t<F(const FIELDS&, const Optional<idxts_t>&)> ReadWithLast(F&& f) const {
+    const size_t index = AcquireFront();
+    const auto guard = current::MakeScopeGuard([this, index]() { --readers_[index]; });
+    return f(static_cast<const FIELDS&>(replicas_[index]), static_cast<const Optional<idxts_t>&>(last_[index]));
+  }
+
+ private:
+  static void ApplyToReplica(FIELDS& replica, const TRANSACTION& transaction) {
+    for (const auto& mutation : transaction.mutations) {
+      mutation.Call(replica);
+    }
+  }
+
+  size_t AcquireFront() const {
+    while (true) {
+      const size_t index = front_;
+      ++readers_[index];
+      if (front_ == index) {
+        return index;
+      }
+      --readers_[index];
+    }
+  }
+
+  // Applies the lagging and the pending transactions to the back replica, and makes it the front one, unless its
+  // readers are still there after `max_yields` yields.
+  void Flip(size_t max_yields) {
+    const size_t back = 1u - front_;
+    for (size_t i = 0u; readers_[back]; ++i) {
+      if (i == max_yields) {
+        up_to_date_ = false;
+        return;
+      }
+      std::this_thread::yield();
+    }
+    for (const TRANSACTION& lagging : lagging_) {
+      ApplyToReplica(replicas_[back], lagging);
+    }
+    lagging_.clear();
+    for (const TRANSACTION& pending : pending_) {
+      ApplyToReplica(replicas_[back], pending);
+    }
+    last_[back] = pending_last_;
+    front_ = back;
+    lagging_.swap(pending_);
+    up_to_date_ = true;
+  }
+
+  FIELDS replicas_[2];
+  Optional<idxts_t> last_[2];  // The last transaction applied to each replica.
+  std::atomic_size_t front_{0u};
+  std::atomic_bool up_to_date_{true};
+  mutable std::atomic_size_t readers_[2] = {{0u}, {0u}};
+  std::vector<TRANSACTION> lagging_;  // Applied to the front replica, but not yet to the back one.
+  std::vector<TRANSACTION> pending_;  // Committed, but not yet applied to either replica.
+  Optional<idxts_t> pending_last_;    // The last transaction committed.
+};
+
+}  // namespace storage
+}  // namespace current
+
+#endif  // CURRENT_STORAGE_SNAPSHOT_H
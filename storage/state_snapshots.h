@@ -0,0 +1,397 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The snapshots of the full state of the storage, for the storage to start from the most recent one, replaying
+// only the transactions after it, instead of the whole stream.
+//
+// A snapshot is the list of the events which, replayed into the empty storage, restore its state: one update event
+// per entry, and one delete event per deleted key, to keep its last modified timestamp. It is tagged with the index
+// and the timestamp of the last transaction it reflects, and is only loaded if the stream has this very entry.
+//
+// The file is binary: the magic, the schema fingerprint of the events, the index and the timestamp, the events in
+// the compact binary format of `typesystem/serialization/binary.h`, back to back, the number of events, and the 64-bit
+// FNV-1a checksum of everything before it. A snapshot is written into a temporary file, which is synced to disk and
+// then renamed, with the directory synced after, so that an incomplete snapshot is never found, even after a crash.
+// A snapshot is parsed in full before any of its events is applied. One which can not be parsed, say, as written by
+// a different schema of the storage, leaves the fields untouched, and the older snapshot is tried instead.
+//
+// The snapshots are written by `StateSnapshotter`, which keeps its own copy of the fields, updated by following
+// the stream from its own thread. Thus writing a snapshot blocks neither the writers nor the readers of the storage,
+// at the cost of the memory for that extra copy of the fields. Once the snapshot reads of the storage are enabled,
+// the copy is dropped, and the snapshots are written from the front replica of `StorageSnapshots` instead. Holding
+// that replica for the time of writing makes the commits fall back to the locked reads, rather than wait for it.
+
+#ifndef CURRENT_STORAGE_STATE_SNAPSHOTS_H
+#define CURRENT_STORAGE_STATE_SNAPSHOTS_H
+
+#include "../port.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef CURRENT_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#endif  // CURRENT_WINDOWS
+
+#include "base.h"
+#include "exceptions.h"
+#include "snapshot.h"
+#include "transaction.h"
+
+#include "../blocks/ss/ss.h"
+
+#include "../stream/stream.h"
+
+#include "../bricks/file/file.h"
+#include "../bricks/strings/printf.h"
+#include "../bricks/template/variadic_indexes.h"
+
+#include "../typesystem/serialization/binary.h"
+
+namespace current {
+namespace storage {
+
+struct StateSnapshotsOptions {
+  std::string directory;        // The snapshots are not used if empty.
+  uint64_t every_transactions;  // Write a snapshot once this many transactions have been applied since the last one.
+  size_t keep;                  // The number of the most recent snapshots to keep.
+
+  explicit StateSnapshotsOptions(std::string directory = "", uint64_t every_transactions = 10000u, size_t keep = 2u)
+      : directory(std::move(directory)), every_transactions(every_transactions), keep(std::max(keep, size_t(1u))) {}
+};
+
+namespace impl {
+
+constexpr static const char kStateSnapshotMagic[] = "CSTATE02";
+constexpr static size_t kStateSnapshotMagicBytes = sizeof(kStateSnapshotMagic) - 1u;
+constexpr static const char* kStateSnapshotFilePrefix = "snapshot.";
+constexpr static size_t kStateSnapshotHeaderBytes = kStateSnapshotMagicBytes + 8u * 3u;
+constexpr static size_t kStateSnapshotTrailerBytes = 8u * 2u;
+constexpr static size_t kStateSnapshotWriteBufferBytes = 1024 * 1024;
+
+class StateSnapshotChecksum final {
+ public:
+  void Update(const char* data, size_t length) {
+    for (size_t i = 0u; i < length; ++i) {
+      hash_ = (hash_ ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    }
+  }
+  uint64_t Value() const { return hash_; }
+
+ private:
+  uint64_t hash_ = 14695981039346656037ull;
+};
+
+inline void AppendLittleEndian(std::string& output, uint64_t value, size_t bytes) {
+  for (size_t i = 0u; i < bytes; ++i) {
+    output += static_cast<char>((value >> (8u * i)) & 0xff);
+  }
+}
+
+inline uint64_t ReadLittleEndian(const std::string& input, size_t offset, size_t bytes) {
+  uint64_t value = 0u;
+  for (size_t i = 0u; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(input[offset + i])) << (8u * i);
+  }
+  return value;
+}
+
+// Flushes the file, or the directory entries, at `path` to disk. Windows can not sync a directory, and skips it.
+inline void SyncStateSnapshotPath(const std::string& path, bool is_directory) {
+#ifndef CURRENT_WINDOWS
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  const bool ok = fd >= 0 && ::fsync(fd) == 0;
+  if (fd >= 0) {
+    ::close(fd);
+  }
+#else
+  bool ok = true;
+  if (!is_directory) {
+    const int fd = ::_open(path.c_str(), _O_RDWR | _O_BINARY);
+    ok = fd >= 0 && ::_commit(fd) == 0;
+    if (fd >= 0) {
+      ::_close(fd);
+    }
+  }
+#endif  // CURRENT_WINDOWS
+  if (!ok) {
+    CURRENT_THROW(StorageCannotAppendToFileException(path));
+  }
+  static_cast<void>(is_directory);
+}
+
+template <typename FIELDS, typename F, int... NS>
+void ExportFieldsState(const FIELDS& fields, F&& f, current::variadic_indexes::indexes<NS...>) {
+  (fields(ImmutableFieldByIndex<NS>(), [&f](const auto& field) { field.ExportState(f); }), ...);
+}
+
+}  // namespace current::storage::impl
+
+// The snapshots in `directory`, the most recent first.
+inline std::vector<std::pair<uint64_t, std::string>> ListStateSnapshots(const std::string& directory) {
+  std::vector<std::pair<uint64_t, std::string>> result;
+  const size_t prefix_length = std::strlen(impl::kStateSnapshotFilePrefix);
+  while (true) {
+    try {
+      FileSystem::ScanDir(directory, [&result, prefix_length](const FileSystem::ScanDirItemInfo& item) {
+        const std::string& name = item.basename;
+        if (name.length() > prefix_length && name.compare(0u, prefix_length, impl::kStateSnapshotFilePrefix) == 0 &&
+            std::all_of(name.begin() + prefix_length, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+          result.emplace_back(std::stoull(name.substr(prefix_length)), item.pathname);
+        }
+      });
+      break;
+    } catch (const DirDoesNotExistException&) {
+      break;
+    } catch (const PathNotDirException&) {
+      break;
+    } catch (const FileException&) {
+      // A snapshot has been renamed or removed while the directory was being scanned.
+      result.clear();
+    }
+  }
+  std::sort(result.rbegin(), result.rend());
+  return result;
+}
+
+// Writes the snapshot of `fields`, which reflect the stream up to and including the transaction at `last`,
+// and removes the older snapshots beyond `options.keep`.
+template <typename FIELDS_VARIANT, int FIELDS_COUNT, typename FIELDS>
+void WriteStateSnapshot(const StateSnapshotsOptions& options, const FIELDS& fields, idxts_t last) {
+  FileSystem::MkDir(options.directory, FileSystem::MkDirParameters::Silent);
+  const std::string file_name =
+      FileSystem::JoinPath(options.directory,
+                           impl::kStateSnapshotFilePrefix +
+                               current::strings::Printf("%020llu", static_cast<unsigned long long>(last.index)));
+  const std::string tmp_file_name = file_name + ".tmp";
+  try {
+    std::ofstream fo(tmp_file_name, std::ios::binary);
+    impl::StateSnapshotChecksum checksum;
+    std::string buffer;
+    const auto flush = [&fo, &checksum, &buffer]() {
+      checksum.Update(buffer.data(), buffer.length());
+      fo.write(buffer.data(), buffer.length());
+      buffer.clear();
+    };
+    buffer.assign(impl::kStateSnapshotMagic, impl::kStateSnapshotMagicBytes);
+    impl::AppendLittleEndian(
+        buffer, static_cast<uint64_t>(serialization::binary::BinarySchemaFingerprint<FIELDS_VARIANT>()), 8u);
+    impl::AppendLittleEndian(buffer, last.index, 8u);
+    impl::AppendLittleEndian(buffer, static_cast<uint64_t>(last.us.count()), 8u);
+    uint64_t count = 0u;
+    serialization::binary::BinarySerializer serializer(buffer);
+    impl::ExportFieldsState(fields,
+                            [&buffer, &count, &flush, &serializer](auto&& event) {
+                              serialization::Serialize(serializer,
+                                                       FIELDS_VARIANT(std::forward<decltype(event)>(event)));
+                              ++count;
+                              if (buffer.length() >= impl::kStateSnapshotWriteBufferBytes) {
+                                flush();
+                              }
+                            },
+                            current::variadic_indexes::generate_indexes<FIELDS_COUNT>());
+    impl::AppendLittleEndian(buffer, count, 8u);
+    flush();
+    impl::AppendLittleEndian(buffer, checksum.Value(), 8u);
+    fo.write(buffer.data(), buffer.length());
+    fo.close();
+    if (!fo) {
+      CURRENT_THROW(StorageCannotAppendToFileException(tmp_file_name));
+    }
+    impl::SyncStateSnapshotPath(tmp_file_name, false);
+    FileSystem::RenameFile(tmp_file_name, file_name);
+  } catch (...) {
+    FileSystem::RmFile(tmp_file_name, FileSystem::RmFileParameters::Silent);
+    throw;
+  }
+  impl::SyncStateSnapshotPath(options.directory, true);
+  const auto snapshots = ListStateSnapshots(options.directory);
+  for (size_t i = options.keep; i < snapshots.size(); ++i) {
+    FileSystem::RmFile(snapshots[i].second, FileSystem::RmFileParameters::Silent);
+  }
+}
+
+// Loads the most recent snapshot which is complete, parses in full, and for which `is_valid(last)` holds, passing
+// each of its events to `f(const FIELDS_VARIANT&)`. Returns the `last` of the snapshot loaded, or `nullptr` if none
+// was, for the whole stream to be replayed.
+template <typename FIELDS_VARIANT, typename F>
+Optional<idxts_t> LoadStateSnapshot(const std::string& directory,
+                                    std::function<bool(idxts_t)> is_valid,
+                                    F&& f) {
+  for (const auto& snapshot : ListStateSnapshots(directory)) {
+    std::string contents;
+    try {
+      contents = FileSystem::ReadFileAsString(snapshot.second);
+    } catch (const FileException&) {
+      continue;
+    }
+    if (contents.length() < impl::kStateSnapshotHeaderBytes + impl::kStateSnapshotTrailerBytes ||
+        contents.compare(0u, impl::kStateSnapshotMagicBytes, impl::kStateSnapshotMagic) != 0) {
+      continue;
+    }
+    const size_t checksum_offset = contents.length() - 8u;
+    impl::StateSnapshotChecksum checksum;
+    checksum.Update(contents.data(), checksum_offset);
+    if (checksum.Value() != impl::ReadLittleEndian(contents, checksum_offset, 8u)) {
+      continue;
+    }
+    if (impl::ReadLittleEndian(contents, impl::kStateSnapshotMagicBytes, 8u) !=
+        static_cast<uint64_t>(serialization::binary::BinarySchemaFingerprint<FIELDS_VARIANT>())) {
+      continue;
+    }
+    idxts_t last;
+    last.index = impl::ReadLittleEndian(contents, impl::kStateSnapshotMagicBytes + 8u, 8u);
+    last.us = std::chrono::microseconds(
+        static_cast<int64_t>(impl::ReadLittleEndian(contents, impl::kStateSnapshotMagicBytes + 16u, 8u)));
+    if (!is_valid(last)) {
+      continue;
+    }
+    const size_t count_offset = checksum_offset - 8u;
+    const uint64_t count = impl::ReadLittleEndian(contents, count_offset, 8u);
+    // Parses all the events, passing each of them to `g`, and returns whether the snapshot parsed in full. The first
+    // pass only validates the snapshot, to not apply a part of it; the events are parsed again in the second one,
+    // instead of being kept, to not need the memory.
+    const auto for_each_event = [&contents, count_offset, count](auto&& g) {
+      try {
+        serialization::binary::BinaryDeserializer deserializer(contents.data() + impl::kStateSnapshotHeaderBytes,
+                                                               contents.data() + count_offset);
+        for (uint64_t i = 0u; i < count; ++i) {
+          FIELDS_VARIANT event;
+          serialization::Deserialize(deserializer, event);
+          g(static_cast<const FIELDS_VARIANT&>(event));
+        }
+        return !deserializer.BytesLeft();
+      } catch (const TypeSystemParseBinaryException&) {
+        return false;
+      }
+    };
+    if (!for_each_event([](const FIELDS_VARIANT&) {})) {
+      continue;
+    }
+    for_each_event(f);
+    return last;
+  }
+  return nullptr;
+}
+
+// Keeps its own copy of the fields up to date by following the stream, and writes the snapshots of it.
+template <typename FIELDS, typename FIELDS_VARIANT, int FIELDS_COUNT, typename STREAM>
+class StateSnapshotter final {
+ public:
+  using transaction_t = Transaction<FIELDS_VARIANT>;
+  using replicas_t = StorageSnapshots<FIELDS, transaction_t>;
+
+  explicit StateSnapshotter(StateSnapshotsOptions options)
+      : options_(std::move(options)), fields_(std::make_unique<FIELDS>()) {}
+
+  // Loads the most recent valid snapshot, into these fields as well as with `f(const FIELDS_VARIANT&)`.
+  template <typename F>
+  Optional<idxts_t> LoadFromConstructor(std::function<bool(idxts_t)> is_valid, F&& f) {
+    loaded_ = LoadStateSnapshot<FIELDS_VARIANT>(options_.directory, is_valid, [this, &f](const FIELDS_VARIANT& event) {
+      event.Call(*fields_);
+      f(event);
+    });
+    return loaded_;
+  }
+
+  // Follows the stream from the transaction after the snapshot loaded, if any, or from the very first one.
+  void FollowStream(Borrowed<STREAM> stream) {
+    subscriber_ = std::make_unique<Subscriber>(*this);
+    subscriber_scope_ = std::move(
+        stream->template Subscribe<transaction_t>(*subscriber_, Exists(loaded_) ? Value(loaded_).index + 1u : 0u));
+  }
+
+  // Writes the snapshots from the front replica of `replicas`, which must outlive this snapshotter, from now on,
+  // dropping the copy of the fields of its own.
+  void WriteFromReplicas(const replicas_t& replicas) { replicas_ = &replicas; }
+
+ private:
+  struct SubscriberImpl {
+    using EntryResponse = current::ss::EntryResponse;
+    using TerminationResponse = current::ss::TerminationResponse;
+
+    StateSnapshotter& self;
+    uint64_t transactions_since_snapshot = 0u;
+
+    explicit SubscriberImpl(StateSnapshotter& self) : self(self) {}
+
+    EntryResponse operator()(const transaction_t& transaction, idxts_t current, idxts_t) {
+      const replicas_t* replicas = self.replicas_;
+      if (!replicas) {
+        for (const auto& mutation : transaction.mutations) {
+          mutation.Call(*self.fields_);
+        }
+      } else {
+        self.fields_ = nullptr;
+      }
+      if (++transactions_since_snapshot >= self.options_.every_transactions) {
+        // A snapshot which can not be written, say, as the disk is full, is skipped, to try again with the next one.
+        // So is the one from the replicas which have not seen a transaction yet, as its index is not known.
+        try {
+          if (!replicas) {
+            WriteStateSnapshot<FIELDS_VARIANT, FIELDS_COUNT>(self.options_, *self.fields_, current);
+          } else {
+            replicas->ReadWithLast([this](const FIELDS& fields, const Optional<idxts_t>& last) {
+              if (Exists(last)) {
+                WriteStateSnapshot<FIELDS_VARIANT, FIELDS_COUNT>(self.options_, fields, Value(last));
+              }
+            });
+          }
+        } catch (const std::exception&) {
+        }
+        transactions_since_snapshot = 0u;
+      }
+      return EntryResponse::More;
+    }
+
+    EntryResponse operator()(std::chrono::microseconds) const { return EntryResponse::More; }
+
+    EntryResponse EntryResponseIfNoMorePassTypeFilter() const { return EntryResponse::More; }
+    TerminationResponse Terminate() const { return TerminationResponse::Terminate; }
+  };
+  using Subscriber = current::ss::StreamSubscriber<SubscriberImpl, transaction_t>;
+
+  const StateSnapshotsOptions options_;
+  std::unique_ptr<FIELDS> fields_;  // Dropped by the subscriber once the snapshots are written from `replicas_`.
+  std::atomic<const replicas_t*> replicas_{nullptr};
+  Optional<idxts_t> loaded_;
+  std::unique_ptr<Subscriber> subscriber_;
+  current::stream::SubscriberScope subscriber_scope_;  // Declared last, to stop following the stream first.
+};
+
+}  // namespace storage
+}  // namespace current
+
+#endif  // CURRENT_STORAGE_STATE_SNAPSHOTS_H
@@ -26,11 +26,14 @@ SOFTWARE.
 // Current-friendly container types.
 
 // * (Ordered/Unordered)Dictionary<T> <=> std::(map/unordered_map)<key_t, T>
+//   FlatDictionary<T> is the unordered one atop the open-addressing `FlatMap`, see `container/flat_map.h`.
 //   Empty(), Size(), operator[](key), Erase(key) [, iteration, {lower/upper}_bound].
 //   `key_t` is either the type of `T.key` or of `T.get_key()`.
+//   ByIndex<INDEX>(value), ByIndexRange<INDEX>([from, to]) for the secondary indexes, see `container/index.h`.
 //
 // * (Ordered/Unordered)(One/Many)To(One/Many)<T> <=> { row_t, col_t } -> T, two `std::(map/unordered_map)<>`-s.
 //   Entries are stored in third `std::unordered_map<std::pair<row_t, col_t>, std::unique_ptr<T>>`.
+//   Flat(One/Many)ToFlat(One/Many)<T> use `FlatMap`-s instead, with the entries stored inline in the third one.
 //   Empty(), Size(), Rows()/Cols(), Add(cell), Delete(row, col) [, iteration, {lower/upper}_bound].
 //   `row_t` and `col_t` are either the type of `T.row` / `T.col`, or of `T.get_row()` / `T.get_col()`.
 //
@@ -44,8 +47,11 @@ SOFTWARE.
 #include "../port.h"
 
 #include <atomic>
+#include <memory>
 
 #include "base.h"
+#include "snapshot.h"
+#include "state_snapshots.h"
 #include "transaction.h"
 #include "transaction_policy.h"
 #include "transaction_result.h"
@@ -155,6 +161,9 @@ namespace storage {
 #define CURRENT_STORAGE_FIELD_ENTRY_OrderedDictionary(entry_type, entry_name) \
   CURRENT_STORAGE_FIELD_ENTRY_Dictionary_IMPL(OrderedDictionary, entry_type, entry_name)
 
+#define CURRENT_STORAGE_FIELD_ENTRY_FlatDictionary(entry_type, entry_name) \
+  CURRENT_STORAGE_FIELD_ENTRY_Dictionary_IMPL(FlatDictionary, entry_type, entry_name)
+
 #ifdef CURRENT_STORAGE_PATCH_SUPPORT
 
 // NOTE(dkorolev): `Patch` is only supported in the dictionaries for now.
@@ -269,6 +278,15 @@ namespace storage {
 #define CURRENT_STORAGE_FIELD_ENTRY_OrderedOneToUnorderedMany(entry_type, entry_name) \
   CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(OrderedOneToUnorderedMany, entry_type, entry_name)
 
+#define CURRENT_STORAGE_FIELD_ENTRY_FlatManyToFlatMany(entry_type, entry_name) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(FlatManyToFlatMany, entry_type, entry_name)
+
+#define CURRENT_STORAGE_FIELD_ENTRY_FlatOneToFlatOne(entry_type, entry_name) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(FlatOneToFlatOne, entry_type, entry_name)
+
+#define CURRENT_STORAGE_FIELD_ENTRY_FlatOneToFlatMany(entry_type, entry_name) \
+  CURRENT_STORAGE_FIELD_ENTRY_Matrix_IMPL(FlatOneToFlatMany, entry_type, entry_name)
+
 #define CURRENT_STORAGE_FIELD_ENTRY(container, entry_type, entry_name) \
   CURRENT_STORAGE_FIELD_ENTRY_##container(entry_type, entry_name)
 
@@ -302,8 +320,14 @@ class StorageImpl {
   using stream_t = typename persister_t::stream_t;
 
  private:
+  using snapshots_t = StorageSnapshots<FIELDS, current::storage::Transaction<fields_variant_t>>;
+  using snapshotter_t = StateSnapshotter<FIELDS, fields_variant_t, FIELDS_COUNT, stream_t>;
+
   FIELDS fields_;
+  std::unique_ptr<snapshots_t> snapshots_;  // Set iff the snapshot reads are enabled, outlives the persister.
+  std::atomic<snapshots_t*> snapshots_enabled_{nullptr};
   Optional<Owned<stream_t>> owned_stream_;  // Valid iff the Storage has been constructed to keep its own stream.
+  std::unique_ptr<snapshotter_t> snapshotter_;  // Set iff the state snapshots are enabled, stops before the stream.
   persister_t persister_;
   TRANSACTION_POLICY<persister_t> transaction_policy_;
 
@@ -315,20 +339,40 @@ class StorageImpl {
 
   template <typename... ARGS>
   static Owned<StorageImpl> CreateMasterStorage(ARGS&&... args) {
-    return MakeOwned<StorageImpl>(typename persister_t::Master(), CreateStreamAsWell(), std::forward<ARGS>(args)...);
+    return MakeOwned<StorageImpl>(
+        typename persister_t::Master(), CreateStreamAsWell(), StateSnapshotsOptions(), std::forward<ARGS>(args)...);
   }
 
   template <typename... ARGS>
   static Owned<StorageImpl> CreateFollowingStorage(ARGS&&... args) {
-    return MakeOwned<StorageImpl>(typename persister_t::Following(), CreateStreamAsWell(), std::forward<ARGS>(args)...);
+    return MakeOwned<StorageImpl>(
+        typename persister_t::Following(), CreateStreamAsWell(), StateSnapshotsOptions(), std::forward<ARGS>(args)...);
+  }
+
+  // With the state snapshots, the storage starts from the most recent snapshot in `options.directory`, replaying only
+  // the transactions after it, and keeps writing the snapshots of its state, from a thread of its own.
+  template <typename... ARGS>
+  static Owned<StorageImpl> CreateMasterStorageWithStateSnapshots(const StateSnapshotsOptions& options,
+                                                                  ARGS&&... args) {
+    return MakeOwned<StorageImpl>(
+        typename persister_t::Master(), CreateStreamAsWell(), options, std::forward<ARGS>(args)...);
+  }
+
+  template <typename... ARGS>
+  static Owned<StorageImpl> CreateFollowingStorageWithStateSnapshots(const StateSnapshotsOptions& options,
+                                                                     ARGS&&... args) {
+    return MakeOwned<StorageImpl>(
+        typename persister_t::Following(), CreateStreamAsWell(), options, std::forward<ARGS>(args)...);
   }
 
-  static Owned<StorageImpl> CreateMasterStorageAtopExistingStream(Borrowed<stream_t> stream) {
-    return MakeOwned<StorageImpl>(typename persister_t::Master(), UseExistingStream(), stream);
+  static Owned<StorageImpl> CreateMasterStorageAtopExistingStream(
+      Borrowed<stream_t> stream, const StateSnapshotsOptions& options = StateSnapshotsOptions()) {
+    return MakeOwned<StorageImpl>(typename persister_t::Master(), UseExistingStream(), options, stream);
   }
 
-  static Owned<StorageImpl> CreateFollowingStorageAtopExistingStream(Borrowed<stream_t> stream) {
-    return MakeOwned<StorageImpl>(typename persister_t::Following(), UseExistingStream(), stream);
+  static Owned<StorageImpl> CreateFollowingStorageAtopExistingStream(
+      Borrowed<stream_t> stream, const StateSnapshotsOptions& options = StateSnapshotsOptions()) {
+    return MakeOwned<StorageImpl>(typename persister_t::Following(), UseExistingStream(), options, stream);
   }
 
  private:
@@ -338,16 +382,47 @@ class StorageImpl {
   struct UseExistingStream {};
 
   template <typename CONSTRUCTION_TYPE>
-  StorageImpl(CONSTRUCTION_TYPE, UseExistingStream, Borrowed<stream_t> stream)
-      : persister_(CONSTRUCTION_TYPE(), [this](const fields_variant_t& entry) { entry.Call(fields_); }, stream),
-        transaction_policy_(persister_, fields_.current_storage_mutation_journal_) {}
+  StorageImpl(CONSTRUCTION_TYPE, UseExistingStream, const StateSnapshotsOptions& options, Borrowed<stream_t> stream)
+      : snapshotter_(CreateSnapshotter(options)),
+        persister_(CONSTRUCTION_TYPE(),
+                   [this](const fields_variant_t& entry) { entry.Call(fields_); },
+                   stream,
+                   StateLoader()),
+        transaction_policy_(persister_, fields_.current_storage_mutation_journal_) {
+    FollowStreamWithSnapshotter();
+  }
 
   template <typename CONSTRUCTION_TYPE, typename... ARGS>
-  StorageImpl(CONSTRUCTION_TYPE, CreateStreamAsWell, ARGS&&... args)
+  StorageImpl(CONSTRUCTION_TYPE, CreateStreamAsWell, const StateSnapshotsOptions& options, ARGS&&... args)
       : owned_stream_(std::move(stream_t::CreateStream(std::forward<ARGS>(args)...))),
-        persister_(
-            CONSTRUCTION_TYPE(), [this](const fields_variant_t& entry) { entry.Call(fields_); }, Value(owned_stream_)),
-        transaction_policy_(persister_, fields_.current_storage_mutation_journal_) {}
+        snapshotter_(CreateSnapshotter(options)),
+        persister_(CONSTRUCTION_TYPE(),
+                   [this](const fields_variant_t& entry) { entry.Call(fields_); },
+                   Value(owned_stream_),
+                   StateLoader()),
+        transaction_policy_(persister_, fields_.current_storage_mutation_journal_) {
+    FollowStreamWithSnapshotter();
+  }
+
+  static std::unique_ptr<snapshotter_t> CreateSnapshotter(const StateSnapshotsOptions& options) {
+    return options.directory.empty() ? nullptr : std::make_unique<snapshotter_t>(options);
+  }
+
+  typename persister_t::state_loader_function_t StateLoader() {
+    if (!snapshotter_) {
+      return nullptr;
+    }
+    return [this](std::function<bool(idxts_t)> is_valid) {
+      return snapshotter_->LoadFromConstructor(is_valid,
+                                               [this](const fields_variant_t& entry) { entry.Call(fields_); });
+    };
+  }
+
+  void FollowStreamWithSnapshotter() {
+    if (snapshotter_) {
+      snapshotter_->FollowStream(persister_.BorrowStream());
+    }
+  }
 
  public:
   template <current::locks::MutexLockStatus MLS = current::locks::MutexLockStatus::NeedToLock>
@@ -393,7 +468,16 @@ class StorageImpl {
   template <current::locks::MutexLockStatus MLS = current::locks::MutexLockStatus::NeedToLock, typename F>
   ::current::Future<::current::storage::TransactionResult<f_result_t<F>>, ::current::StrictFuture::Strict>
   ReadOnlyTransaction(F&& f) const {
+    snapshots_t* snapshots = snapshots_enabled_;
+    if (MLS == current::locks::MutexLockStatus::NeedToLock && snapshots && snapshots->UpToDate()) {
+      return snapshots->Read([&f, this](const FIELDS& fields) {
+        return transaction_policy_.TransactionFromSnapshot([&f, &fields]() { return f(fields); });
+      });
+    }
     current::locks::SmartMutexLockGuard<MLS> lock(persister_.Stream()->Impl()->publishing_mutex);
+    if (snapshots) {
+      snapshots->CatchUpFromLockedSection();
+    }
     return transaction_policy_.TransactionFromLockedSection(
         [&f, this]() { return f(static_cast<const FIELDS&>(fields_)); });
   }
@@ -401,11 +485,45 @@ class StorageImpl {
   template <current::locks::MutexLockStatus MLS = current::locks::MutexLockStatus::NeedToLock, typename F1, typename F2>
   ::current::Future<::current::storage::TransactionResult<void>, ::current::StrictFuture::Strict> ReadOnlyTransaction(
       F1&& f1, F2&& f2) const {
+    snapshots_t* snapshots = snapshots_enabled_;
+    if (MLS == current::locks::MutexLockStatus::NeedToLock && snapshots && snapshots->UpToDate()) {
+      return snapshots->Read([&f1, &f2, this](const FIELDS& fields) {
+        return transaction_policy_.TransactionFromSnapshot([&f1, &fields]() { return f1(fields); },
+                                                           std::forward<F2>(f2));
+      });
+    }
     current::locks::SmartMutexLockGuard<MLS> lock(persister_.Stream()->Impl()->publishing_mutex);
+    if (snapshots) {
+      snapshots->CatchUpFromLockedSection();
+    }
     return transaction_policy_.TransactionFromLockedSection(
         [&f1, this]() { return f1(static_cast<const FIELDS&>(fields_)); }, std::forward<F2>(f2));
   }
 
+  // Makes the read-only transactions run against the most recently committed snapshot of the storage, with no lock,
+  // in parallel with each other and with the read-write transactions. Costs the memory for two more copies of the
+  // storage fields, and the time to export the state of the storage into them. The read-only transactions run from
+  // a locked section, i.e. with `MutexLockStatus::AlreadyLocked`, keep reading the fields themselves. With the state
+  // snapshots enabled, they are written from these copies from now on, instead of from a copy of their own.
+  void EnableSnapshotReads() {
+    std::lock_guard<std::mutex> lock(persister_.Stream()->Impl()->publishing_mutex);
+    if (!snapshots_) {
+      snapshots_ = std::make_unique<snapshots_t>();
+      snapshots_t* snapshots = snapshots_.get();
+      impl::ExportFieldsState(fields_,
+                              [snapshots](auto&& event) { snapshots->ApplyMutationFromConstructor(event); },
+                              current::variadic_indexes::generate_indexes<FIELDS_COUNT>());
+      persister_.FollowAppliedTransactionsFromLockedSection([snapshots](const transaction_t& transaction,
+                                                                        idxts_t idx_ts) {
+        snapshots->ApplyFromLockedSection(transaction, idx_ts);
+      });
+      snapshots_enabled_ = snapshots;
+      if (snapshotter_) {
+        snapshotter_->WriteFromReplicas(*snapshots);
+      }
+    }
+  }
+
   void ExposeRawLogViaHTTP(int port, const std::string& route) { persister_.ExposeRawLogViaHTTP(port, route); }
 
   Borrowed<stream_t> BorrowUnderlyingStream() const { return persister_.BorrowStream(); }
@@ -475,6 +593,7 @@ class NullStoragePersisterImpl {
   void PersistJournal(MutationJournal& journal) { journal.Clear(); }
 
   // No-ops to make everything compile.
+  using state_loader_function_t = std::function<Optional<idxts_t>(std::function<bool(idxts_t)> is_valid)>;
   struct stream_t {
     struct impl_t {};
     struct entry_t {};
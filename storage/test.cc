@@ -28,7 +28,12 @@ SOFTWARE.
 
 #define CURRENT_MOCK_TIME
 
+#include <atomic>
+#include <future>
+#include <map>
 #include <set>
+#include <thread>
+#include <tuple>
 #include <type_traits>
 
 #ifndef STORAGE_ONLY_RUN_RESTFUL_TESTS
@@ -1928,6 +1933,725 @@ TEST(TransactionalStorage, GracefulShutdown) {
   ASSERT_THROW(result.Go(), current::storage::StorageInGracefulShutdownException);
 }
 
+TEST(TransactionalStorage, SnapshotReads) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using storage_t = TestStorage<StreamInMemoryStreamPersister>;
+
+  auto storage = storage_t::CreateMasterStorage();
+  auto follower_storage = storage_t::CreateFollowingStorageAtopExistingStream(storage->BorrowUnderlyingStream());
+
+  // The transactions committed before the snapshot reads are enabled are exported into the snapshots.
+  current::time::SetNow(std::chrono::microseconds(100));
+  EXPECT_TRUE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    fields.d.Add(Record("one", 1));
+    fields.umany_to_umany.Add(Cell(1, "one"));
+  }).Go()));
+
+  storage->EnableSnapshotReads();
+  follower_storage->EnableSnapshotReads();
+  EXPECT_EQ(1u, Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+              return fields.d.Size();
+            }).Go()));
+
+  // The read-only transactions do not wait for the read-write one in progress, and do not see its changes.
+  current::time::SetNow(std::chrono::microseconds(200));
+  EXPECT_TRUE(WasCommitted(storage->ReadWriteTransaction([&storage](MutableFields<storage_t> fields) {
+    fields.d.Add(Record("two", 2));
+    fields.umany_to_umany.Add(Cell(2, "two"));
+    EXPECT_EQ(2u, fields.d.Size());
+    EXPECT_EQ(1u,
+              std::async(std::launch::async,
+                         [&storage]() {
+                           return Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+                             return fields.d.Size();
+                           }).Go());
+                         })
+                  .get());
+  }).Go()));
+  EXPECT_EQ(2u, Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+              return fields.d.Size();
+            }).Go()));
+
+  // The rolled back transactions are not seen.
+  current::time::SetNow(std::chrono::microseconds(300));
+  EXPECT_FALSE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    fields.d.Add(Record("three", 3));
+    CURRENT_STORAGE_THROW_ROLLBACK();
+  }).Go()));
+  EXPECT_EQ(2u, Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+              return fields.d.Size();
+            }).Go()));
+
+  // Each read-only transaction sees a consistent version, committed as a whole, while the writer keeps committing.
+  const size_t kTransactions = 250u;
+  std::atomic_bool done(false);
+  std::atomic_size_t inconsistencies(0u);
+  std::vector<std::thread> readers;
+  for (size_t i = 0u; i < 4u; ++i) {
+    readers.emplace_back([&storage, &done, &inconsistencies]() {
+      size_t last_size = 0u;
+      while (!done) {
+        storage->ReadOnlyTransaction([&last_size, &inconsistencies](ImmutableFields<storage_t> fields) {
+          const size_t size = fields.d.Size();
+          if (size != fields.umany_to_umany.Size() || size < last_size) {
+            ++inconsistencies;
+          }
+          last_size = size;
+        }).Wait();
+      }
+    });
+  }
+  for (size_t i = 0u; i < kTransactions; ++i) {
+    current::time::SetNow(std::chrono::microseconds(1000 + i));
+    storage->ReadWriteTransaction([i](MutableFields<storage_t> fields) {
+      fields.d.Add(Record(current::ToString(i), static_cast<int32_t>(i)));
+      fields.umany_to_umany.Add(Cell(static_cast<int32_t>(i + 100u), "x"));
+    }).Wait();
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0u, inconsistencies);
+  EXPECT_EQ(kTransactions + 2u, Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+              return fields.d.Size();
+            }).Go()));
+
+  // The following storage keeps its snapshots updated with the transactions it replays.
+  while (Value(follower_storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+           return fields.umany_to_umany.Size();
+         }).Go()) != kTransactions + 2u) {
+    std::this_thread::yield();
+  }
+  EXPECT_TRUE(Value(follower_storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+    return Exists(fields.d["two"]) && !Exists(fields.d["three"]);
+  }).Go()));
+
+  // A long read-only transaction does not hold up the commits: once the back replica it holds can not be updated,
+  // the read-only transactions run from the locked section, seeing the commits, until the replicas catch up.
+  std::atomic_bool pinned(false);
+  std::atomic_bool release(false);
+  auto long_read = std::async(std::launch::async, [&storage, &pinned, &release]() {
+    return Value(storage->ReadOnlyTransaction([&pinned, &release](ImmutableFields<storage_t> fields) {
+      pinned = true;
+      while (!release) {
+        std::this_thread::yield();
+      }
+      return fields.d.Size();
+    }).Go());
+  });
+  while (!pinned) {
+    std::this_thread::yield();
+  }
+  for (size_t i = 0u; i < 2u; ++i) {
+    current::time::SetNow(std::chrono::microseconds(5000 + i));
+    storage->ReadWriteTransaction([i](MutableFields<storage_t> fields) {
+      fields.d.Add(Record("long" + current::ToString(i), static_cast<int32_t>(i)));
+    }).Wait();
+  }
+  EXPECT_EQ(kTransactions + 4u, Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+              return fields.d.Size();
+            }).Go()));
+  release = true;
+  EXPECT_EQ(kTransactions + 2u, long_read.get());
+  EXPECT_EQ(kTransactions + 4u, Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+              return fields.d.Size();
+            }).Go()));
+}
+
+TEST(TransactionalStorage, StateSnapshots) {
+  using namespace transactional_storage_test;
+  using storage_t = TestStorage<StreamStreamPersister>;
+  using stream_t = typename storage_t::stream_t;
+
+  const std::string a_file_name = current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "state_a");
+  const std::string b_file_name = current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "state_b");
+  const std::string snapshots_dir =
+      current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "state_snapshots");
+  const auto a_file_remover = current::FileSystem::ScopedRmFile(a_file_name);
+  const auto b_file_remover = current::FileSystem::ScopedRmFile(b_file_name);
+  const auto snapshots_dir_remover = current::FileSystem::ScopedRmDir(snapshots_dir);
+  const current::storage::StateSnapshotsOptions options(snapshots_dir, 2u, 2u);
+
+  // Streams `a` and `b` have five transactions each, with the same timestamps, but with different records.
+  const auto write_transactions = [](current::Owned<storage_t>& storage, const std::string& prefix) {
+    current::time::ResetToZero();
+    for (int32_t i = 1; i <= 5; ++i) {
+      current::time::SetNow(std::chrono::microseconds(i * 100));
+      storage->ReadWriteTransaction([&prefix, i](MutableFields<storage_t> fields) {
+        fields.d.Add(Record(prefix + current::ToString(i), i));
+        fields.umany_to_umany.Add(Cell(i, prefix));
+        if (i == 3) {
+          fields.d.Erase(prefix + "2");
+          fields.umany_to_umany.Erase(2, prefix);
+        }
+      }).Wait();
+    }
+  };
+  const auto keys = [](const current::Owned<storage_t>& storage) {
+    return Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+      std::string result;
+      for (const auto& record : fields.d) {
+        result += record.lhs + ',';
+      }
+      return result + current::ToString(fields.umany_to_umany.Size());
+    }).Go());
+  };
+
+  {
+    auto stream = stream_t::CreateStream(b_file_name);
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(stream);
+    write_transactions(storage, "b");
+    EXPECT_EQ("b1,b3,b4,b5,4", keys(storage));
+  }
+
+  // The snapshots are written every two transactions, after the ones at index 1 and at index 3.
+  {
+    auto stream = stream_t::CreateStream(a_file_name);
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(stream, options);
+    write_transactions(storage, "a");
+    while (current::storage::ListStateSnapshots(snapshots_dir).empty() ||
+           current::storage::ListStateSnapshots(snapshots_dir).front().first != 3u) {
+      std::this_thread::yield();
+    }
+    const auto snapshots = current::storage::ListStateSnapshots(snapshots_dir);
+    ASSERT_EQ(2u, snapshots.size());
+    EXPECT_EQ(1u, snapshots[1].first);
+  }
+
+  // The storage starts from the snapshot, keeping the last modified times of the deleted entries too.
+  {
+    auto stream = stream_t::CreateStream(a_file_name);
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(stream, options);
+    EXPECT_EQ("a1,a3,a4,a5,4", keys(storage));
+    EXPECT_EQ(500, storage->LastAppliedTimestamp().count());
+    EXPECT_EQ(300, Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+                           return Value(fields.d.LastModified("a2"));
+                         }).Go()).count());
+  }
+
+  // Only the transactions after the snapshot are replayed: started atop `b`, the storage has `a` up to index 3.
+  {
+    auto stream = stream_t::CreateStream(b_file_name);
+    auto storage = storage_t::CreateFollowingStorageAtopExistingStream(stream, options);
+    while (storage->LastAppliedTimestamp().count() != 500) {
+      std::this_thread::yield();
+    }
+    EXPECT_EQ("a1,a3,a4,b5,4", keys(storage));
+  }
+
+  // A corrupt snapshot is skipped, in favor of the previous one.
+  const std::string newest_snapshot = current::storage::ListStateSnapshots(snapshots_dir).front().second;
+  current::FileSystem::WriteStringToFile("!", newest_snapshot.c_str(), true);
+  {
+    auto stream = stream_t::CreateStream(b_file_name);
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(stream, options);
+    EXPECT_EQ("a1,a2,b3,b4,b5,5", keys(storage));
+  }
+
+  // A snapshot of a different stream is not loaded.
+  const std::string c_file_name = current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "state_c");
+  const auto c_file_remover = current::FileSystem::ScopedRmFile(c_file_name);
+  {
+    auto stream = stream_t::CreateStream(c_file_name);
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(stream);
+    current::time::SetNow(std::chrono::microseconds(10000));
+    storage->ReadWriteTransaction([](MutableFields<storage_t> fields) { fields.d.Add(Record("c", 1)); }).Wait();
+    current::time::SetNow(std::chrono::microseconds(20000));
+    storage->ReadWriteTransaction([](MutableFields<storage_t> fields) { fields.d.Add(Record("c", 2)); }).Wait();
+  }
+  {
+    auto stream = stream_t::CreateStream(c_file_name);
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(stream, options);
+    EXPECT_EQ("c,0", keys(storage));
+  }
+
+  // A snapshot which can not be parsed in full, or which was written by a different schema, is rejected before any
+  // of its events is applied, in favor of the previous one. Here, the valid snapshot followed by one more event,
+  // of the type not in the storage, and the valid snapshot with a different schema fingerprint, each with the count
+  // and the checksum updated.
+  {
+    using fields_variant_t = typename storage_t::fields_variant_t;
+    size_t valid_events = 0u;
+    const auto valid_last = current::storage::LoadStateSnapshot<fields_variant_t>(
+        snapshots_dir, [](idxts_t) { return true; }, [&valid_events](const fields_variant_t&) { ++valid_events; });
+    ASSERT_TRUE(Exists(valid_last));
+    EXPECT_LT(0u, valid_events);
+
+    const std::string valid = current::FileSystem::ReadFileAsString(
+        current::storage::ListStateSnapshots(snapshots_dir).front().second);
+    const auto with_checksum = [](std::string contents) {
+      current::storage::impl::StateSnapshotChecksum checksum;
+      checksum.Update(contents.data(), contents.length());
+      current::storage::impl::AppendLittleEndian(contents, checksum.Value(), 8u);
+      return contents;
+    };
+    std::string extra_event = valid.substr(0u, valid.length() - 16u);
+    extra_event += std::string(8u, '\x01');
+    current::storage::impl::AppendLittleEndian(
+        extra_event, current::storage::impl::ReadLittleEndian(valid, valid.length() - 16u, 8u) + 1u, 8u);
+    current::FileSystem::WriteStringToFile(
+        with_checksum(extra_event),
+        current::FileSystem::JoinPath(snapshots_dir, "snapshot.00000000000000000099").c_str());
+    std::string other_schema = valid.substr(0u, valid.length() - 8u);
+    other_schema[current::storage::impl::kStateSnapshotMagicBytes] ^= 1;
+    current::FileSystem::WriteStringToFile(
+        with_checksum(other_schema),
+        current::FileSystem::JoinPath(snapshots_dir, "snapshot.00000000000000000098").c_str());
+
+    size_t events_applied = 0u;
+    const auto last = current::storage::LoadStateSnapshot<fields_variant_t>(
+        snapshots_dir, [](idxts_t) { return true; }, [&events_applied](const fields_variant_t&) { ++events_applied; });
+    ASSERT_TRUE(Exists(last));
+    EXPECT_EQ(Value(valid_last).index, Value(last).index);
+    EXPECT_EQ(valid_events, events_applied);
+  }
+
+  // A snapshot which can not be written is skipped, and the snapshots are written again once they can be.
+  const std::string d_file_name = current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "state_d");
+  const auto d_file_remover = current::FileSystem::ScopedRmFile(d_file_name);
+  const std::string unwritable_dir =
+      current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "state_unwritable");
+  const auto unwritable_dir_remover = current::FileSystem::ScopedRmDir(unwritable_dir);
+  {
+    current::FileSystem::WriteStringToFile("Not a directory.", unwritable_dir.c_str());
+    auto stream = stream_t::CreateStream(d_file_name);
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(
+        stream, current::storage::StateSnapshotsOptions(unwritable_dir, 1u, 1u));
+    current::time::SetNow(std::chrono::microseconds(30000));
+    storage->ReadWriteTransaction([](MutableFields<storage_t> fields) { fields.d.Add(Record("d", 1)); }).Wait();
+    current::FileSystem::RmFile(unwritable_dir);
+    current::time::SetNow(std::chrono::microseconds(40000));
+    storage->ReadWriteTransaction([](MutableFields<storage_t> fields) { fields.d.Add(Record("d", 2)); }).Wait();
+    while (current::storage::ListStateSnapshots(unwritable_dir).empty() ||
+           current::storage::ListStateSnapshots(unwritable_dir).front().first != 1u) {
+      std::this_thread::yield();
+    }
+  }
+
+  // With the snapshot reads enabled, the snapshots are written from their replicas, as of the last transaction
+  // applied to the front one, which may be ahead of, or, if the replicas are behind, before the one it is due after.
+  const std::string e_file_name = current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "state_e");
+  const auto e_file_remover = current::FileSystem::ScopedRmFile(e_file_name);
+  const std::string replicas_dir =
+      current::FileSystem::JoinPath(FLAGS_transactional_storage_test_tmpdir, "state_replicas");
+  const auto replicas_dir_remover = current::FileSystem::ScopedRmDir(replicas_dir);
+  const current::storage::StateSnapshotsOptions replicas_options(replicas_dir, 2u, 2u);
+  {
+    auto stream = stream_t::CreateStream(e_file_name);
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(stream, replicas_options);
+    storage->EnableSnapshotReads();
+    write_transactions(storage, "e");
+    while (current::storage::ListStateSnapshots(replicas_dir).empty()) {
+      std::this_thread::yield();
+    }
+  }
+  {
+    auto stream = stream_t::CreateStream(e_file_name);
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(stream, replicas_options);
+    EXPECT_EQ("e1,e3,e4,e5,4", keys(storage));
+    EXPECT_EQ(300, Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+                           return Value(fields.d.LastModified("e2"));
+                         }).Go()).count());
+  }
+}
+
+namespace transactional_storage_test {
+
+CURRENT_STRUCT(IndexedUser) {
+  CURRENT_FIELD(key, std::string);
+  CURRENT_FIELD(email, std::string);
+  CURRENT_FIELD(age, int32_t);
+  CURRENT_CONSTRUCTOR(IndexedUser)(const std::string& key = "", const std::string& email = "", int32_t age = 0)
+      : key(key), email(email), age(age) {}
+};
+
+CURRENT_STORAGE_INDEX(IndexedUserByEmail, IndexedUser, email, Unique, Unordered);
+CURRENT_STORAGE_INDEX(IndexedUserByAge, IndexedUser, age, NonUnique, Ordered);
+
+CURRENT_STORAGE_FIELD_ENTRY(OrderedDictionary, IndexedUser, IndexedUserDictionary);
+CURRENT_STORAGE_FIELD_INDEXES(IndexedUserDictionary, IndexedUserByEmail, IndexedUserByAge);
+
+CURRENT_STORAGE(IndexedStorage) { CURRENT_STORAGE_FIELD(user, IndexedUserDictionary); };
+
+}  // namespace transactional_storage_test
+
+TEST(TransactionalStorage, SecondaryIndexes) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using storage_t = IndexedStorage<StreamInMemoryStreamPersister>;
+
+  auto storage = storage_t::CreateMasterStorage();
+  auto follower_storage = storage_t::CreateFollowingStorageAtopExistingStream(storage->BorrowUnderlyingStream());
+
+  const auto by_email = [](ImmutableFields<storage_t> fields, const std::string& email) -> std::string {
+    const auto user = fields.user.ByIndex<IndexedUserByEmail>(email);
+    return Exists(user) ? Value(user).key : "";
+  };
+  const auto by_age = [](ImmutableFields<storage_t> fields, int32_t age) {
+    std::string result;
+    for (const auto& user : fields.user.ByIndex<IndexedUserByAge>(age)) {
+      result += user.key + ',';
+    }
+    return result;
+  };
+  const auto by_age_range = [](ImmutableFields<storage_t> fields, int32_t from, int32_t to) {
+    std::string result;
+    for (const auto& user : fields.user.ByIndexRange<IndexedUserByAge>(from, to)) {
+      result += user.key + ',';
+    }
+    return result;
+  };
+  const auto dump = [&by_email, &by_age, &by_age_range](ImmutableFields<storage_t> fields) {
+    return by_email(fields, "a@x") + '|' + by_email(fields, "b@x") + '|' + by_email(fields, "c@x") + '|' +
+           by_age(fields, 20) + '|' + by_age(fields, 30) + '|' + by_age_range(fields, 0, 100);
+  };
+
+  current::time::SetNow(std::chrono::microseconds(100));
+  EXPECT_TRUE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    fields.user.Add(IndexedUser("alice", "a@x", 30));
+    fields.user.Add(IndexedUser("bob", "b@x", 20));
+    fields.user.Add(IndexedUser("carol", "c@x", 30));
+  }).Go()));
+  EXPECT_EQ("alice|bob|carol|bob,|alice,carol,|bob,alice,carol,", Value(storage->ReadOnlyTransaction(dump).Go()));
+  EXPECT_EQ("alice,carol,", Value(storage->ReadOnlyTransaction([&by_age_range](ImmutableFields<storage_t> fields) {
+              return by_age_range(fields, 21, 31);
+            }).Go()));
+  EXPECT_EQ("", Value(storage->ReadOnlyTransaction([&by_age_range](ImmutableFields<storage_t> fields) {
+              return by_age_range(fields, 31, 21);
+            }).Go()));
+
+  // The indexes follow the updates and the deletions.
+  current::time::SetNow(std::chrono::microseconds(200));
+  EXPECT_TRUE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    fields.user.Add(IndexedUser("alice", "a@x", 20));
+    fields.user.Add(IndexedUser("carol", "c2@x", 30));
+    fields.user.Erase("bob");
+    fields.user.Add(IndexedUser("dave", "b@x", 40));
+  }).Go()));
+  const std::string expected = "alice|dave||alice,|carol,|alice,carol,dave,";
+  EXPECT_EQ(expected, Value(storage->ReadOnlyTransaction(dump).Go()));
+
+  // Taking the value of a unique index of another entry throws, and rolls back the whole transaction.
+  current::time::SetNow(std::chrono::microseconds(300));
+  EXPECT_THROW(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    fields.user.Add(IndexedUser("eve", "e@x", 20));
+    fields.user.Erase("carol");
+    fields.user.Add(IndexedUser("alice", "a@x", 30));
+    fields.user.Add(IndexedUser("frank", "b@x", 20));
+  }).Go(), current::storage::StorageUniqueIndexViolationException);
+  EXPECT_EQ(expected, Value(storage->ReadOnlyTransaction(dump).Go()));
+
+  // The rollback requested by the user restores the indexes too.
+  current::time::SetNow(std::chrono::microseconds(400));
+  EXPECT_FALSE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    fields.user.Add(IndexedUser("alice", "c@x", 30));
+    fields.user.Erase("dave");
+    fields.user.Add(IndexedUser("eve", "b@x", 20));
+    CURRENT_STORAGE_THROW_ROLLBACK();
+  }).Go()));
+  EXPECT_EQ(expected, Value(storage->ReadOnlyTransaction(dump).Go()));
+
+  // The following storage builds the same indexes from the stream.
+  while (follower_storage->LastAppliedTimestamp() != storage->LastAppliedTimestamp()) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(expected, Value(follower_storage->ReadOnlyTransaction(dump).Go()));
+
+  // The accessor to the entries of the non-unique index is by their keys.
+  EXPECT_EQ("2,1,false,c2@x,", Value(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+              const auto by_age = fields.user.ByIndex<IndexedUserByAge>(30);
+              const auto carol = by_age["carol"];
+              return current::ToString(fields.user.ByIndex<IndexedUserByAge>(20).Size() +
+                                       fields.user.ByIndex<IndexedUserByAge>(40).Size()) +
+                     ',' + current::ToString(by_age.Size()) + ',' + current::ToString(by_age.Has("alice")) + ',' +
+                     (Exists(carol) ? Value(carol).email : "") + ',' +
+                     (Exists(by_age["dave"]) ? "dave" : "");
+            }).Go()));
+}
+
+TEST(TransactionalStorage, SecondaryIndexesReplayDuplicates) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using storage_t = IndexedStorage<StreamInMemoryStreamPersister>;
+
+  // The stream written without the unique index may have the same value of it in more than one entry.
+  auto stream = storage_t::stream_t::CreateStream();
+  {
+    auto storage = storage_t::CreateMasterStorageAtopExistingStream(stream);
+    typename storage_t::transaction_t transaction;
+    transaction.mutations.push_back(IndexedUserDictionaryUpdated(std::chrono::microseconds(1), IndexedUser("a", "x")));
+    transaction.mutations.push_back(IndexedUserDictionaryUpdated(std::chrono::microseconds(1), IndexedUser("b", "x")));
+    storage->PublisherUsed()->Publish(transaction, std::chrono::microseconds(1));
+  }
+  EXPECT_THROW(storage_t::CreateMasterStorageAtopExistingStream(stream),
+               current::storage::StorageUniqueIndexViolationOnReplayException);
+}
+
+TEST(TransactionalStorage, MutationJournal) {
+  using namespace transactional_storage_test;
+
+  current::storage::MutationJournal journal;
+  std::string log;
+  const auto counter = std::make_shared<int>(0);
+  for (int pass = 0; pass < 2; ++pass) {
+    // The rollback functors are called in the reverse order, and the events are released in the order they were logged.
+    for (int32_t i = 0; i < 3; ++i) {
+      Record& logged = journal.LogMutation(Record("r" + current::ToString(i), i), [&log, i]() {
+        log += current::ToString(i);
+      });
+      EXPECT_EQ(i, logged.rhs);
+      // The functors holding non-trivially destructible captures are destroyed once the journal is cleared.
+      journal.LogMutation(Record(), [counter]() {});
+    }
+    EXPECT_EQ(6u, journal.EventsCount());
+    EXPECT_EQ(4, counter.use_count());
+    if (!pass) {
+      journal.Rollback();
+      EXPECT_EQ("210", log);
+    } else {
+      journal.ReleaseEvents([&log](std::unique_ptr<current::CurrentStruct> event) {
+        log += dynamic_cast<const Record&>(*event).lhs + ',';
+      });
+      journal.Clear();
+      EXPECT_EQ("210r0,,r1,,r2,,", log);
+    }
+    EXPECT_EQ(0u, journal.EventsCount());
+    EXPECT_EQ(1, counter.use_count());
+    journal.AssertEmpty();
+  }
+}
+
+TEST(TransactionalStorage, FlatMap) {
+  // Compare against `std::map` through enough insertions and erasures to grow the table, and to shift the buckets.
+  current::storage::container::FlatMap<uint32_t, std::string> map;
+  std::map<uint32_t, std::string> golden;
+  uint32_t x = 42u;
+  for (uint32_t i = 0u; i < 20000u; ++i) {
+    x = x * 1103515245u + 12345u;
+    const uint32_t key = (x >> 8) % 2000u;
+    if (x & 1u) {
+      map[key] = current::ToString(i);
+      golden[key] = current::ToString(i);
+    } else {
+      EXPECT_EQ(golden.erase(key), map.erase(key));
+    }
+  }
+  EXPECT_EQ(golden.size(), map.size());
+  std::map<uint32_t, std::string> contents(map.begin(), map.end());
+  EXPECT_TRUE(golden == contents);
+  for (uint32_t key = 0u; key < 2000u; ++key) {
+    const auto cit = map.find(key);
+    ASSERT_EQ(golden.count(key), static_cast<size_t>(cit != map.end()));
+    if (cit != map.end()) {
+      EXPECT_EQ(golden[key], cit->second);
+    }
+  }
+
+  // The entries do not move as others are added and erased.
+  const std::string* pointer = &map[100000u];
+  for (uint32_t key = 0u; key < 2000u; ++key) {
+    map.erase(key);
+    map[key + 200000u] = "x";
+  }
+  EXPECT_EQ(pointer, &map.find(100000u)->second);
+
+  // Erasing via the iterator returns the next one.
+  for (auto it = map.begin(); it != map.end();) {
+    it = (it->first % 2u) ? map.erase(it) : std::next(it);
+  }
+  EXPECT_EQ(1001u, map.size());
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.begin() == map.end());
+}
+
+TEST(TransactionalStorage, FlatMapCapacity) {
+  // The secondary indexes keep a map per distinct value, so the map of one entry must not take a whole chunk:
+  // the chunks of slots double from `kSlotsInFirstChunk`, up to `kSlotsPerChunk` each.
+  using map_t = current::storage::container::FlatMap<uint32_t, uint32_t>;
+  map_t map;
+  EXPECT_EQ(0u, map.capacity());
+  size_t expected_capacity = 0u;
+  size_t chunk = map_t::kSlotsInFirstChunk;
+  for (uint32_t i = 0u; i < 5u * map_t::kSlotsPerChunk; ++i) {
+    map[i] = i;
+    if (map.size() > expected_capacity) {
+      expected_capacity += chunk;
+      chunk = std::min(chunk * 2u, map_t::kSlotsPerChunk);
+    }
+    ASSERT_EQ(expected_capacity, map.capacity()) << i;
+  }
+  EXPECT_EQ(map_t::kSlotsPerChunk * 5u + map_t::kSlotsPerChunk - map_t::kSlotsInFirstChunk, map.capacity());
+
+  // The slots of the erased entries are reused, and the chunks are kept until the map is cleared.
+  map.erase(42u);
+  map[5u * map_t::kSlotsPerChunk] = 0u;
+  EXPECT_EQ(expected_capacity, map.capacity());
+  for (uint32_t i = 0u; i <= 5u * map_t::kSlotsPerChunk; ++i) {
+    map.erase(i);
+  }
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(expected_capacity, map.capacity());
+  map.clear();
+  EXPECT_EQ(0u, map.capacity());
+  map[0u] = 0u;
+  EXPECT_EQ(map_t::kSlotsInFirstChunk, map.capacity());
+}
+
+namespace transactional_storage_test {
+
+CURRENT_STORAGE_INDEX(RecordByRhs, Record, rhs, Unique, Flat);
+CURRENT_STORAGE_FIELD_ENTRY(FlatDictionary, Record, RecordFlatDictionary);
+CURRENT_STORAGE_FIELD_INDEXES(RecordFlatDictionary, RecordByRhs);
+
+CURRENT_STORAGE_FIELD_ENTRY(FlatManyToFlatMany, Cell, CellFlatManyToMany);
+CURRENT_STORAGE_FIELD_ENTRY(FlatOneToFlatOne, Cell, CellFlatOneToOne);
+CURRENT_STORAGE_FIELD_ENTRY(FlatOneToFlatMany, Cell, CellFlatOneToMany);
+
+CURRENT_STORAGE(FlatStorage) {
+  CURRENT_STORAGE_FIELD(d, RecordFlatDictionary);
+  CURRENT_STORAGE_FIELD(mm, CellFlatManyToMany);
+  CURRENT_STORAGE_FIELD(oo, CellFlatOneToOne);
+  CURRENT_STORAGE_FIELD(om, CellFlatOneToMany);
+};
+
+}  // namespace transactional_storage_test
+
+TEST(TransactionalStorage, FlatDictionary) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using storage_t = FlatStorage<StreamInMemoryStreamPersister>;
+
+  auto storage = storage_t::CreateMasterStorage();
+  auto follower_storage = storage_t::CreateFollowingStorageAtopExistingStream(storage->BorrowUnderlyingStream());
+
+  const auto dump = [](ImmutableFields<storage_t> fields) {
+    std::map<std::string, std::string> sorted;
+    for (const auto& record : fields.d) {
+      sorted[record.lhs] =
+          current::ToString(record.rhs) + '@' + current::ToString(Value(fields.d.LastModified(record.lhs)).count());
+    }
+    std::string result = current::ToString(fields.d.Size()) + ':';
+    for (const auto& e : sorted) {
+      result += e.first + '=' + e.second + ',';
+    }
+    const auto deleted = fields.d.LastModified("deleted");
+    result += Exists(deleted) ? current::ToString(Value(deleted).count()) : "-";
+    const auto by_rhs = fields.d.ByIndex<RecordByRhs>(7);
+    result += '|' + (Exists(by_rhs) ? Value(by_rhs).lhs : "");
+    for (const auto& matrix : {std::make_tuple(fields.mm.Size(), fields.mm.Rows().Size(), fields.mm.Cols().Size()),
+                               std::make_tuple(fields.oo.Size(), fields.oo.Rows().Size(), fields.oo.Cols().Size()),
+                               std::make_tuple(fields.om.Size(), fields.om.Rows().Size(), fields.om.Cols().Size())}) {
+      result += '|' + current::ToString(std::get<0>(matrix)) + ',' + current::ToString(std::get<1>(matrix)) + ',' +
+                current::ToString(std::get<2>(matrix));
+    }
+    const auto cell = fields.mm.Get(1, "y");
+    return result + '|' + (Exists(cell) ? current::ToString(Value(cell).phew) : "-");
+  };
+
+  current::time::SetNow(std::chrono::microseconds(100));
+  EXPECT_TRUE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    for (int32_t i = 0; i < 100; ++i) {
+      fields.d.Add(Record("r" + current::ToString(i), 1000 + i));
+      fields.mm.Add(Cell(i % 10, "x" + current::ToString(i / 10)));
+      fields.oo.Add(Cell(i, "x" + current::ToString(i)));
+      fields.om.Add(Cell(i % 10, "x" + current::ToString(i)));
+    }
+    fields.d.Add(Record("deleted", 7));
+    fields.mm.Add(Cell(1, "y", 1));
+  }).Go()));
+  current::time::SetNow(std::chrono::microseconds(200));
+  EXPECT_TRUE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    for (int32_t i = 2; i < 100; ++i) {
+      fields.d.Erase("r" + current::ToString(i));
+    }
+    fields.d.Erase("deleted");
+    fields.d.Add(Record("r1", 7));
+    for (int32_t i = 10; i < 100; ++i) {
+      fields.mm.Erase(i % 10, "x" + current::ToString(i / 10));
+      fields.oo.Erase(i, "x" + current::ToString(i));
+      fields.om.Erase(i % 10, "x" + current::ToString(i));
+    }
+    fields.mm.Add(Cell(1, "y", 2));
+  }).Go()));
+  const std::string expected = "2:r0=1000@100,r1=7@200,200|r1|11,10,2|10,10,10|10,10,10|2";
+  EXPECT_EQ(expected, Value(storage->ReadOnlyTransaction(dump).Go()));
+
+  // The rollback restores the entries, their last modified times, and the ones of the deleted keys.
+  current::time::SetNow(std::chrono::microseconds(300));
+  EXPECT_FALSE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    fields.d.Add(Record("deleted", 8));
+    fields.d.Erase("r1");
+    fields.d.Add(Record("r0", 7));
+    fields.d.Add(Record("r2", 2));
+    fields.mm.Erase(1, "y");
+    fields.mm.Add(Cell(42, "z"));
+    fields.oo.Add(Cell(0, "x1"));
+    fields.om.Add(Cell(0, "x1"));
+    CURRENT_STORAGE_THROW_ROLLBACK();
+  }).Go()));
+  EXPECT_EQ(expected, Value(storage->ReadOnlyTransaction(dump).Go()));
+
+  while (follower_storage->LastAppliedTimestamp() != storage->LastAppliedTimestamp()) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(expected, Value(follower_storage->ReadOnlyTransaction(dump).Go()));
+}
+
+TEST(TransactionalStorage, RollbackOfLongTransactionsAndOfEntriesReplacedByThemselves) {
+  current::time::ResetToZero();
+
+  using namespace transactional_storage_test;
+  using storage_t = TestStorage<StreamInMemoryStreamPersister>;
+
+  auto storage = storage_t::CreateMasterStorage();
+
+  current::time::SetNow(std::chrono::microseconds(100));
+  EXPECT_TRUE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+    for (int32_t i = 0; i < 1000; ++i) {
+      fields.d.Add(Record(current::ToString(i), i));
+    }
+  }).Go()));
+
+  // Enough rollback records to span several blocks of the arena of the journal, some of them replacing the entries
+  // with themselves, or erasing them by the keys that refer to the entries themselves.
+  for (int attempt = 0; attempt < 3; ++attempt) {
+    current::time::SetNow(std::chrono::microseconds(200 + attempt * 100));
+    EXPECT_FALSE(WasCommitted(storage->ReadWriteTransaction([](MutableFields<storage_t> fields) {
+      for (int32_t i = 0; i < 1000; ++i) {
+        const std::string key = current::ToString(i);
+        fields.d.Add(Value(fields.d[key]));
+        EXPECT_EQ(key, Value(fields.d[key]).lhs);
+        EXPECT_EQ(i, Value(fields.d[key]).rhs);
+        fields.d.Add(Record(key, -i));
+        fields.d.Add(Record(key + "-new", i));
+        fields.d.Erase(Value(fields.d[key + "-new"]).lhs);
+        fields.d.Erase(Value(fields.d[key]).lhs);
+        fields.d.Add(Record(key + std::string(10000u, '+'), i));
+      }
+      EXPECT_EQ(1000u, fields.d.Size());
+      CURRENT_STORAGE_THROW_ROLLBACK();
+    }).Go()));
+  }
+
+  EXPECT_TRUE(WasCommitted(storage->ReadOnlyTransaction([](ImmutableFields<storage_t> fields) {
+    EXPECT_EQ(1000u, fields.d.Size());
+    for (int32_t i = 0; i < 1000; ++i) {
+      const std::string key = current::ToString(i);
+      ASSERT_TRUE(Exists(fields.d[key]));
+      EXPECT_EQ(i, Value(fields.d[key]).rhs);
+      EXPECT_EQ(100, Value(fields.d.LastModified(key)).count());
+      EXPECT_FALSE(Exists(fields.d.LastModified(key + "-new")));
+    }
+  }).Go()));
+}
+
 #endif  // STORAGE_ONLY_RUN_RESTFUL_TESTS
 
 namespace transactional_storage_test {
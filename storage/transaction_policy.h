@@ -97,9 +97,8 @@ class Synchronous final {
 
   // Read-only transaction returning non-void type.
   template <typename F, class = std::enable_if_t<!std::is_void<f_result_t<F>>::value>>
-  Future<TransactionResult<f_result_t<F>>, StrictFuture::Strict> TransactionFromLockedSection(F&& f) const {
+  Future<TransactionResult<f_result_t<F>>, StrictFuture::Strict> TransactionFromSnapshot(F&& f) const {
     using result_t = f_result_t<F>;
-    journal_.AssertEmpty();
     std::promise<TransactionResult<result_t>> promise;
     if (destructing_) {
       promise.set_exception(std::make_exception_ptr(StorageInGracefulShutdownException()));  // LCOV_EXCL_LINE
@@ -118,7 +117,7 @@ class Synchronous final {
         try {
           promise.set_exception(std::current_exception());
         } catch (const std::exception& e) {
-          std::cerr << "`promise.set_exception()` failed in Synchronous::TransactionFromLockedSection: " << e.what()
+          std::cerr << "`promise.set_exception()` failed in Synchronous::TransactionFromSnapshot: " << e.what()
                     << std::endl;
           std::exit(-1);
         }
@@ -172,8 +171,7 @@ class Synchronous final {
 
   // Read-only transaction returning void type.
   template <typename F, class = std::enable_if_t<std::is_void<f_result_t<F>>::value>>
-  Future<TransactionResult<void>, StrictFuture::Strict> TransactionFromLockedSection(F&& f) const {
-    journal_.AssertEmpty();
+  Future<TransactionResult<void>, StrictFuture::Strict> TransactionFromSnapshot(F&& f) const {
     std::promise<TransactionResult<void>> promise;
     if (destructing_) {
       promise.set_exception(std::make_exception_ptr(StorageInGracefulShutdownException()));
@@ -189,7 +187,7 @@ class Synchronous final {
         try {
           promise.set_exception(std::current_exception());
         } catch (const std::exception& e) {
-          std::cerr << "`promise.set_exception()` failed in Synchronous::TransactionFromLockedSection: " << e.what()
+          std::cerr << "`promise.set_exception()` failed in Synchronous::TransactionFromSnapshot: " << e.what()
                     << std::endl;
           std::exit(-1);
         }
@@ -247,9 +245,8 @@ class Synchronous final {
 
   // Read-only two-step transaction.
   template <typename F1, typename F2, class = std::enable_if_t<!std::is_void<f_result_t<F1>>::value>>
-  Future<TransactionResult<void>, StrictFuture::Strict> TransactionFromLockedSection(F1&& f1, F2&& f2) const {
+  Future<TransactionResult<void>, StrictFuture::Strict> TransactionFromSnapshot(F1&& f1, F2&& f2) const {
     using result_t = f_result_t<F1>;
-    journal_.AssertEmpty();
     std::promise<TransactionResult<void>> promise;
     if (destructing_) {
       promise.set_exception(std::make_exception_ptr(StorageInGracefulShutdownException()));  // LCOV_EXCL_LINE
@@ -269,7 +266,7 @@ class Synchronous final {
         try {
           promise.set_exception(std::current_exception());
         } catch (const std::exception& e) {
-          std::cerr << "`promise.set_exception()` failed in Synchronous::TransactionFromLockedSection: " << e.what()
+          std::cerr << "`promise.set_exception()` failed in Synchronous::TransactionFromSnapshot: " << e.what()
                     << std::endl;
           std::exit(-1);
         }
@@ -279,6 +276,13 @@ class Synchronous final {
     return Future<TransactionResult<void>, StrictFuture::Strict>(promise.get_future());
   }
 
+  // Read-only transactions from the section locked by the publishing mutex, with the fields themselves.
+  template <typename... FS>
+  auto TransactionFromLockedSection(FS&&... fs) const {
+    journal_.AssertEmpty();
+    return TransactionFromSnapshot(std::forward<FS>(fs)...);
+  }
+
   void GracefulShutdown() { destructing_ = true; }
 
  private:
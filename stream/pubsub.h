@@ -30,6 +30,7 @@ SOFTWARE.
 
 #include <utility>
 
+#include "replication_format.h"
 #include "stream_impl.h"
 
 #include "../typesystem/timestamp.h"
@@ -113,6 +114,9 @@ SOFTWARE.
 //    HEAD request : Same as `sizeonly`, but return the total number of records in HTTP header, not body.
 //
 //    `terminate`  : Terminate HTTP connection for the subscription id passed as the value of this parameter.
+//
+//    `binary`     : Send the entries in length-prefixed batches of raw log lines, for replication.
+//                   See `replication_format.h`. Ignored if `entries_only` or `array` is set.
 
 // TODO(dkorolev): Add timestamps to `sizeonly` and `HEAD` too?
 // TODO(dkorolev): Mention head updates now as we're here?
@@ -161,6 +165,8 @@ struct ParsedHTTPRequestParams {
   // If set, parse and validate each entry before sending it.
   // If not, skip the validation (using the "unsafe" iteration) to speed up the communication.
   bool checked = false;
+  // If set, send the entries in length-prefixed binary batches. Controlled by `binary` URL parameter.
+  bool binary = false;
 };
 
 inline ParsedHTTPRequestParams ParsePubSubHTTPRequest(const Request& r) {
@@ -225,6 +231,9 @@ inline ParsedHTTPRequestParams ParsePubSubHTTPRequest(const Request& r) {
   if (r.url.query.has("checked")) {
     result.checked = true;
   }
+  if (r.url.query.has("binary") && !result.entries_only) {
+    result.binary = true;
+  }
 
   return result;
 }
@@ -244,11 +253,8 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
         output_started_(false),
         http_response_(http_request_.SendChunkedResponse(
             HTTPResponseCode.OK,
-            current::net::http::Headers({
-                {kStreamHeaderCurrentSubscriptionId, subscription_id},
-                {kStreamHeaderCurrentStreamSize, current::ToString(impl_->persister.Size())},
-            }),
-            current::net::constants::kDefaultJSONContentType)) {
+            ResponseHeaders(subscription_id, impl_->persister.Size(), params_.binary),
+            params_.binary ? "application/octet-stream" : current::net::constants::kDefaultJSONContentType)) {
     if (params_.recent.count() > 0) {
       serving_ = false;  // Start in 'non-serving' mode when `recent` is set.
       from_timestamp_ = r.timestamp - params_.recent;
@@ -292,24 +298,30 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
         if (to_timestamp_.count() && current.us > to_timestamp_) {
           return ss::EntryResponse::Done;
         }
-        const std::string entry_json = [this, &current, &entry]() {
-          if (params_.entries_only) {
-            return JSON<J>(entry) + '\n';
-          } else {
-            return JSON<J>(current) + '\t' + JSON<J>(entry) + '\n';
-          }
-        }();
-        current_response_size_ += entry_json.length();
         try {
-          if (params_.array) {
-            if (!output_started_) {
-              http_response_("[\n");
-              output_started_ = true;
-            } else {
-              http_response_(",\n");
+          if (params_.binary) {
+            const std::string line = JSON<J>(current) + '\t' + JSON<J>(entry);
+            current_response_size_ += line.length() + 1u;
+            AddToBinaryBatch(line, current.index == last.index);
+          } else {
+            const std::string entry_json = [this, &current, &entry]() {
+              if (params_.entries_only) {
+                return JSON<J>(entry) + '\n';
+              } else {
+                return JSON<J>(current) + '\t' + JSON<J>(entry) + '\n';
+              }
+            }();
+            current_response_size_ += entry_json.length();
+            if (params_.array) {
+              if (!output_started_) {
+                http_response_("[\n");
+                output_started_ = true;
+              } else {
+                http_response_(",\n");
+              }
             }
+            http_response_(std::move(entry_json));
           }
-          http_response_(std::move(entry_json));
         } catch (const current::net::NetworkException&) {  // LCOV_EXCL_LINE
           return ss::EntryResponse::Done;                  // LCOV_EXCL_LINE
         }
@@ -337,6 +349,8 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
       } else {
         http_response_("]\n");
       }
+    } else if (result == ss::EntryResponse::Done && params_.binary) {
+      FlushBinaryBatch();
     }
     return result;
   }
@@ -374,27 +388,33 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
         if (to_timestamp_.count() && GetCurrentUs() > to_timestamp_) {
           return ss::EntryResponse::Done;
         }
-        const std::string response_data = [this, &raw_log_line]() {
-          if (!params_.entries_only) {
-            return raw_log_line;
-          } else {
-            const auto tab_pos = raw_log_line.find('\t');
-            return tab_pos != std::string::npos ? raw_log_line.substr(tab_pos + 1) : raw_log_line;
-          }
-        }() + '\n';
-        current_response_size_ += response_data.length();
         try {
-          if (params_.array) {
-            if (!output_started_) {
-              http_response_("[\n", current::net::ChunkFlush::NoFlush);
-              output_started_ = true;
-            } else {
-              http_response_(",\n", current::net::ChunkFlush::NoFlush);
+          if (params_.binary) {
+            // The raw log line is sent as is, with no copies other than into the batch.
+            current_response_size_ += raw_log_line.length() + 1u;
+            AddToBinaryBatch(raw_log_line, current_index == last.index);
+          } else {
+            const std::string response_data = [this, &raw_log_line]() {
+              if (!params_.entries_only) {
+                return raw_log_line;
+              } else {
+                const auto tab_pos = raw_log_line.find('\t');
+                return tab_pos != std::string::npos ? raw_log_line.substr(tab_pos + 1) : raw_log_line;
+              }
+            }() + '\n';
+            current_response_size_ += response_data.length();
+            if (params_.array) {
+              if (!output_started_) {
+                http_response_("[\n", current::net::ChunkFlush::NoFlush);
+                output_started_ = true;
+              } else {
+                http_response_(",\n", current::net::ChunkFlush::NoFlush);
+              }
             }
+            http_response_(
+                response_data,
+                current_index == last.index ? current::net::ChunkFlush::Flush : current::net::ChunkFlush::NoFlush);
           }
-          http_response_(
-              response_data,
-              current_index == last.index ? current::net::ChunkFlush::Flush : current::net::ChunkFlush::NoFlush);
         } catch (const current::net::NetworkException&) {  // LCOV_EXCL_LINE
           return ss::EntryResponse::Done;                  // LCOV_EXCL_LINE
         }
@@ -423,6 +443,8 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
         } else {
           http_response_("]\n");
         }
+      } else if (params_.binary) {
+        FlushBinaryBatch();
       } else {
         // flush cached response data.
         http_response_("", current::net::ChunkFlush::Flush);
@@ -448,7 +470,9 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
       if (to_timestamp_.count() && us > to_timestamp_) {
         return ss::EntryResponse::Done;
       }
-      if (!params_.array && !params_.entries_only) {
+      if (params_.binary) {
+        AddToBinaryBatch(JSON<J>(ts_only_t(us)), true);
+      } else if (!params_.array && !params_.entries_only) {
         http_response_(JSON<J>(ts_only_t(us)) + '\n');
       }
     }
@@ -466,6 +490,8 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
     static const std::string message = "{\"error\":\"The subscriber has terminated.\"}\n";
     if (params_.array && output_started_) {
       http_response_(",\n" + message + "]\n");
+    } else if (params_.binary) {
+      AddToBinaryBatch(message.substr(0u, message.length() - 1u), true);
     } else {
       http_response_(message);
     }
@@ -474,6 +500,33 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
   // LCOV_EXCL_STOP
 
  private:
+  static current::net::http::Headers ResponseHeaders(const std::string& subscription_id,
+                                                     uint64_t stream_size,
+                                                     bool binary) {
+    current::net::http::Headers headers({
+        {kStreamHeaderCurrentSubscriptionId, subscription_id},
+        {kStreamHeaderCurrentStreamSize, current::ToString(stream_size)},
+    });
+    if (binary) {
+      headers.Set(kStreamHeaderCurrentStreamFormat, kStreamFormatBinary);
+    }
+    return headers;
+  }
+
+  // With `&binary`: adds the line to the batch, and sends the batch if `flush` is set, or if the batch is full.
+  void AddToBinaryBatch(const std::string& line, bool flush) {
+    binary_batch_.Add(line);
+    if (flush || binary_batch_.Full()) {
+      FlushBinaryBatch();
+    }
+  }
+
+  void FlushBinaryBatch() {
+    if (!binary_batch_.Empty()) {
+      binary_batch_.Flush([this](const std::string& batch) { http_response_(batch, current::net::ChunkFlush::Flush); });
+    }
+  }
+
   // The HTTP listener must register itself as a user of stream data to ensure the lifetime of stream data.
   const BorrowedWithCallback<impl_t> impl_;
   std::atomic_bool time_to_terminate_{false};
@@ -496,6 +549,8 @@ class PubSubHTTPEndpointImpl : public AbstractSubscriberObject {
   std::chrono::microseconds from_timestamp_ = std::chrono::microseconds(0);
   // Calculated if `period_` is set.
   std::chrono::microseconds to_timestamp_ = std::chrono::microseconds(0);
+  // The batch being collected, with `&binary`.
+  BinaryBatchWriter binary_batch_;
   // Remaining number of records to return. Initialized if `n` URL parameter is set.
   uint64_t n_ = 0u;
 
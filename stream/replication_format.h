@@ -0,0 +1,124 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The binary wire format of the HTTP subscriptions to the stream, for replication, requested with `&binary`.
+//
+// Instead of one chunk of one line per entry, the response body is a sequence of length-prefixed batches.
+// Each batch is a four-byte little-endian length, followed by that many bytes of raw log lines, each terminated
+// by a '\n': the entries exactly as persisted, `{"index":...,"us":...}\t{...}`, and the head updates, `{"us":...}`.
+// A batch is sent once the subscriber has caught up with the stream, or once it grows to `kMaxBinaryBatchBytes`.
+//
+// The server confirms the format with the `X-Current-Stream-Format: binary` header. Without this header,
+// the response is line-based, as it is from the servers that do not know of the binary format.
+
+#ifndef CURRENT_STREAM_REPLICATION_FORMAT_H
+#define CURRENT_STREAM_REPLICATION_FORMAT_H
+
+#include "../port.h"
+
+#include <string>
+#include <string_view>
+
+#include "../blocks/ss/types.h"
+
+namespace current {
+namespace stream {
+
+constexpr static const char* kStreamHeaderCurrentStreamFormat = "X-Current-Stream-Format";
+constexpr static const char* kStreamFormatBinary = "binary";
+constexpr static size_t kMaxBinaryBatchBytes = 1024 * 1024;
+
+// Server-side: collects the lines into a batch, and frames it.
+class BinaryBatchWriter final {
+ public:
+  BinaryBatchWriter() : buffer_(kLengthBytes, '\0') {}
+
+  // Appends the line, which must not contain a '\n'.
+  void Add(const std::string& line) {
+    buffer_ += line;
+    buffer_ += '\n';
+  }
+
+  bool Empty() const { return buffer_.length() == kLengthBytes; }
+  bool Full() const { return buffer_.length() >= kLengthBytes + kMaxBinaryBatchBytes; }
+
+  // Frames the batch, passes it to `send()`, and starts the next one, reusing the buffer.
+  template <typename F>
+  void Flush(F&& send) {
+    const size_t length = buffer_.length() - kLengthBytes;
+    for (size_t i = 0u; i < kLengthBytes; ++i) {
+      buffer_[i] = static_cast<char>((length >> (8u * i)) & 0xff);
+    }
+    send(static_cast<const std::string&>(buffer_));
+    buffer_.resize(kLengthBytes);
+  }
+
+ private:
+  static constexpr size_t kLengthBytes = 4u;
+  std::string buffer_;
+};
+
+// Client-side: reassembles the batches from the chunks received, regardless of how the batches span them.
+class BinaryBatchReader final {
+ public:
+  // Calls `f(ss::RawLogLinesBatch)` for each batch completed by `chunk`, in order.
+  // Returns `false` if the data is malformed.
+  template <typename F>
+  bool Feed(const std::string& chunk, F&& f) {
+    buffer_ += chunk;
+    size_t offset = 0u;
+    bool ok = true;
+    while (buffer_.length() - offset >= kLengthBytes) {
+      size_t length = 0u;
+      for (size_t i = 0u; i < kLengthBytes; ++i) {
+        length |= static_cast<size_t>(static_cast<unsigned char>(buffer_[offset + i])) << (8u * i);
+      }
+      if (buffer_.length() - offset - kLengthBytes < length) {
+        break;
+      }
+      const ss::RawLogLinesBatch batch(std::string_view(buffer_).substr(offset + kLengthBytes, length));
+      offset += kLengthBytes + length;
+      if (!batch.Empty()) {
+        if (!batch.Complete()) {
+          ok = false;
+          break;
+        }
+        f(batch);
+      }
+    }
+    buffer_.erase(0u, offset);
+    return ok;
+  }
+
+  void Clear() { buffer_.clear(); }
+
+ private:
+  static constexpr size_t kLengthBytes = 4u;
+  std::string buffer_;
+};
+
+}  // namespace current::stream
+}  // namespace current
+
+#endif  // CURRENT_STREAM_REPLICATION_FORMAT_H
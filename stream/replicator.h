@@ -27,12 +27,15 @@ SOFTWARE.
 #ifndef CURRENT_STREAM_REPLICATOR_H
 #define CURRENT_STREAM_REPLICATOR_H
 
+#include <atomic>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <type_traits>
 
 #include "exceptions.h"
+#include "replication_format.h"
 #include "stream.h"
 #include "stream_impl.h"
 
@@ -85,9 +88,12 @@ class SubscribableRemoteStream final {
 
     std::string GetURLToSubscribe(uint64_t index, std::chrono::microseconds from_us, SubscriptionMode mode) const {
       return url_ + "?i=" + current::ToString(index) + (mode == SubscriptionMode::Checked ? "&checked" : "") +
-             (from_us.count() > 0 ? "&since=" + current::ToString(from_us) : "");
+             (from_us.count() > 0 ? "&since=" + current::ToString(from_us) : "") + (binary_ ? "&binary" : "");
     }
 
+    // Whether to request the binary, batched, format of the subscription. See `replication_format.h`.
+    void UseBinaryFormat(bool binary) { binary_ = binary; }
+
     std::string GetURLToTerminate(const std::string& subscription_id) const {
       return url_ + "?terminate=" + subscription_id;
     }
@@ -106,6 +112,7 @@ class SubscribableRemoteStream final {
    private:
     const std::string url_;
     const SubscribableStreamSchema schema_;
+    std::atomic_bool binary_{true};
   };
 
   template <typename F, typename TYPE_SUBSCRIBED_TO, ReplicationMode RM>
@@ -125,6 +132,13 @@ class SubscribableRemoteStream final {
           unused_idxts_() {}
 
     void PassChunkToSubscriber(const std::string& chunk) {
+      if (binary_) {
+        if (!binary_reader_.Feed(chunk, [this](const ss::RawLogLinesBatch& batch) { PassBatchToSubscriber(batch); })) {
+          CURRENT_THROW(RemoteStreamMalformedChunkException());
+        }
+        return;
+      }
+
       const size_t chunk_size = chunk.size();
       size_t begin_pos = 0u;
 
@@ -172,8 +186,56 @@ class SubscribableRemoteStream final {
     std::chrono::microseconds from_us_;
     const idxts_t unused_idxts_;
     std::string carried_over_data_;
+    // Set once the server has confirmed the binary format of the response.
+    bool binary_ = false;
+    BinaryBatchReader binary_reader_;
 
    private:
+    // In the unchecked mode, if the subscriber accepts them, the runs of entries are passed on as is, in bulk.
+    // The head updates, as well as all the lines in the checked mode, are passed on one by one.
+    void PassBatchToSubscriber(const ss::RawLogLinesBatch& batch) {
+      if constexpr (RM == ReplicationMode::Unchecked && ss::AcceptsRawLogLinesBatch<F>::value) {
+        const std::string_view lines = batch.lines;
+        size_t run_begin = 0u;
+        size_t run_length = 0u;
+        const auto pass_run = [&](size_t run_end) {
+          if (run_length) {
+            const ss::RawLogLinesBatch run(lines.substr(run_begin, run_end - run_begin));
+            if (subscriber_(run, next_expected_index_, unused_idxts_) == ss::EntryResponse::Done) {
+              CURRENT_THROW(StreamTerminatedBySubscriber());
+            }
+            next_expected_index_ += run_length;
+            from_us_ = std::chrono::microseconds(0);
+            run_length = 0u;
+          }
+        };
+        size_t begin = 0u;
+        while (begin < lines.length()) {
+          const size_t end = lines.find('\n', begin);
+          const std::string_view line = lines.substr(begin, end - begin);
+          if (line.find('\t') != std::string_view::npos) {
+            if (!run_length) {
+              run_begin = begin;
+            }
+            ++run_length;
+          } else {
+            pass_run(begin);
+            if (!line.empty()) {
+              PassEntryToSubscriber(std::string(line));
+            }
+          }
+          begin = end + 1u;
+        }
+        pass_run(lines.length());
+      } else {
+        batch.ForEachLine([this](std::string_view line) {
+          if (!line.empty()) {
+            PassEntryToSubscriber(std::string(line));
+          }
+        });
+      }
+    }
+
     template <ReplicationMode MODE = RM>
     std::enable_if_t<MODE == ReplicationMode::Checked> PassEntryToSubscriber(const std::string& raw_log_line) {
       const auto split = current::strings::Split(raw_log_line, '\t');
@@ -311,6 +373,8 @@ class SubscribableRemoteStream final {
         } catch (current::Exception&) {
         }
         this->carried_over_data_.clear();
+        this->binary_ = false;
+        this->binary_reader_.Clear();
         subscription_id_.MutableScopedAccessor()->clear();
       }
     }
@@ -318,6 +382,8 @@ class SubscribableRemoteStream final {
     void OnHeader(const std::string& header, const std::string& value) {
       if (header == "X-Current-Stream-Subscription-Id") {  // NOTE(dkorolev): Case and `-`-vs-`_`-aware comparison?
         subscription_id_.SetValue(value);
+      } else if (header == kStreamHeaderCurrentStreamFormat) {
+        this->binary_ = (value == kStreamFormatBinary);
       }
     }
 
@@ -432,6 +498,9 @@ class SubscribableRemoteStream final {
     return stream_.ObjectAccessorDespitePossiblyDestructing().GetNumberOfEntries();
   }
 
+  // Whether the subscriptions made after this call request the binary, batched, format. On by default.
+  void UseBinaryFormat(bool binary) { stream_->UseBinaryFormat(binary); }
+
  private:
   Owned<RemoteStream> stream_;
 };
@@ -475,6 +544,11 @@ struct StreamReplicatorImpl {
     return EntryResponse::More;
   }
 
+  EntryResponse operator()(const ss::RawLogLinesBatch& batch, uint64_t, idxts_t) {
+    Value(publisher_)->PublishUnsafe(batch);
+    return EntryResponse::More;
+  }
+
   EntryResponse operator()(std::chrono::microseconds ts) {
     Value(publisher_)->UpdateHead(ts);
     return EntryResponse::More;
@@ -45,6 +45,7 @@ SOFTWARE.
 #include "../blocks/http/api.h"
 #include "../blocks/persistence/memory.h"
 #include "../blocks/persistence/file.h"
+#include "../blocks/persistence/segmented_file.h"
 #include "../blocks/ss/ss.h"
 #include "../blocks/ss/signature.h"
 
@@ -63,6 +64,11 @@ SOFTWARE.
 //
 // To create a persisted one, pass in the type of persister and its construction parameters, such as:
 // `auto my_stream = stream::Stream<ENTRY, current::persistence::File>::CreateStream("data.json");`.
+// The `File` persister takes optional `current::persistence::FilePersisterOptions` to set its `FileSyncPolicy`:
+// `...::CreateStream("data.json", FilePersisterOptions(FileSyncPolicy::FDataSyncEveryBatch));`.
+// Next to the file, the `File` persister keeps its sparse index, "data.json.idx", to not replay the file at startup.
+// For large streams, `current::persistence::SegmentedFile` keeps the data in binary segment files in a directory:
+// `auto my_stream = stream::Stream<ENTRY, current::persistence::SegmentedFile>::CreateStream("data_dir");`.
 //
 // Stream streams can be published into and subscribed to.
 //
@@ -71,7 +77,9 @@ SOFTWARE.
 // any number of "borrowed" publishers, forked off the master one.
 //
 // Subscription is done via `auto scope = my_stream.Subscribe(my_subscriber);`, where `my_subscriber`
-// is an instance of the class doing the subscription. Stream runs each subscriber in a dedicated thread.
+// is an instance of the class doing the subscription. Stream runs each subscriber in a dedicated thread,
+// or, after `my_stream->RunSubscribersOnPool(&pool)`, as a task on a shared `SubscriberPool` of threads.
+// The recently published entries are cached, so that the subscribers following the stream do not each parse them.
 //
 // Stack ownership of `my_subscriber` is respected, and `SubscriberScope` is returned for the user to store.
 // As the returned `scope` object leaves the scope, the subscriber is sent a signal to terminate,
@@ -264,8 +272,11 @@ class Stream final {
   }
 
   // TODO(dkorolev): Master-follower flip between two streams belongs in Stream first, then in Storage.
+  // Runs the subscriber either in a dedicated thread, or, if the stream has a `SubscriberPool` set, as a task
+  // on that pool. Either way, the same `Step()` is what moves the subscriber forward.
   template <typename TYPE_SUBSCRIBED_TO, typename F, SubscriptionMode SM>
-  class SubscriberThreadInstance final : public current::stream::SubscriberScope::SubscriberThread {
+  class SubscriberThreadInstance final : public current::stream::SubscriberScope::SubscriberThread,
+                                         public SubscriberPool::Task {
    private:
     bool this_is_valid_;
     std::function<void()> done_callback_;
@@ -275,7 +286,14 @@ class Stream final {
     F& subscriber_;
     const uint64_t begin_idx_;
     const std::chrono::microseconds from_us_;
+    // The cursor of the subscriber: the next index to pass to it, and the last head it has been passed.
+    uint64_t index_;
+    std::chrono::microseconds head_;
     std::thread thread_;
+    // For the pooled subscriber, whether it is done, to wait for in the destructor.
+    std::mutex pooled_done_mutex_;
+    std::condition_variable pooled_done_cv_;
+    bool pooled_done_ = false;
 
     SubscriberThreadInstance() = delete;
     SubscriberThreadInstance(const SubscriberThreadInstance&) = delete;
@@ -289,20 +307,34 @@ class Stream final {
                              uint64_t begin_idx,
                              std::chrono::microseconds from_us,
                              std::function<void()> done_callback)
-        : this_is_valid_(false),
+        : SubscriberPool::Task(impl->subscriber_pool.load()),
+          this_is_valid_(false),
           done_callback_(done_callback),
           terminate_signal_(),
           terminate_sent_(false),
           impl_(std::move(impl),
                 [this]() {
                   // NOTE(dkorolev): I'm uncertain whether this lock is necessary here. Keeping it for safety now.
-                  std::lock_guard<std::mutex> lock(impl_->publishing_mutex);
-                  terminate_signal_.SignalExternalTermination();
+                  {
+                    std::lock_guard<std::mutex> lock(impl_->publishing_mutex);
+                    terminate_signal_.SignalExternalTermination();
+                  }
+                  Wake();
                 }),
           subscriber_(subscriber),
           begin_idx_(begin_idx),
           from_us_(from_us),
-          thread_(&SubscriberThreadInstance::Thread, this) {
+          index_(begin_idx),
+          head_(from_us - std::chrono::microseconds(1)) {
+      if (Pool()) {
+        {
+          std::lock_guard<std::mutex> lock(impl_->pooled_subscribers_mutex);
+          impl_->pooled_subscribers.insert(this);
+        }
+        Wake();
+      } else {
+        thread_ = std::thread(&SubscriberThreadInstance::Thread, this);
+      }
       // Must guard against the constructor of `BorrowedWithCallback<impl_t> impl_` throwing.
       // NOTE(dkorolev): This is obsolete now, but keeping the logic for now, to keep it safe. -- D.K.
       this_is_valid_ = true;
@@ -311,12 +343,25 @@ class Stream final {
     ~SubscriberThreadInstance() {
       if (this_is_valid_) {
         // The constructor has completed successfully. The thread has started, and `impl_` is valid.
-        CURRENT_ASSERT(thread_.joinable());
         if (!subscriber_thread_done_) {
           std::lock_guard<std::mutex> lock(impl_->publishing_mutex);
           terminate_signal_.SignalExternalTermination();
         }
-        thread_.join();
+        if (Pool()) {
+          Wake();
+          {
+            std::unique_lock<std::mutex> lock(pooled_done_mutex_);
+            pooled_done_cv_.wait(lock, [this]() { return pooled_done_; });
+          }
+          {
+            std::lock_guard<std::mutex> lock(impl_->pooled_subscribers_mutex);
+            impl_->pooled_subscribers.erase(this);
+          }
+          Pool()->Remove(this);
+        } else {
+          CURRENT_ASSERT(thread_.joinable());
+          thread_.join();
+        }
       } else {
         // The constructor has not completed successfully. The thread was not started, and `impl_` is garbage.
         if (done_callback_) {
@@ -328,7 +373,32 @@ class Stream final {
     void Thread() {
       // Keep the subscriber thread exception-safe. By construction, it's guaranteed to live
       // strictly within the scope of existence of `impl_t` contained in `impl_`.
-      ThreadImpl(begin_idx_);
+      ThreadImpl();
+      Done();
+    }
+
+    // `SubscriberPool::Task`: pass at most a batch of entries, and have the task parked when there is nothing to do.
+    bool RunBatch() override {
+      {
+        std::lock_guard<std::mutex> lock(pooled_done_mutex_);
+        if (pooled_done_) {
+          return false;
+        }
+      }
+      const StepResult result = Step(Pool()->BatchSize());
+      if (result == StepResult::Done) {
+        Done();
+        {
+          std::lock_guard<std::mutex> lock(pooled_done_mutex_);
+          pooled_done_ = true;
+        }
+        pooled_done_cv_.notify_all();
+        return false;
+      }
+      return result == StepResult::MoreToDo;
+    }
+
+    void Done() {
       subscriber_thread_done_ = true;
       std::lock_guard<std::mutex> lock(impl_->http_subscriptions_mutex);
       if (done_callback_) {
@@ -336,24 +406,48 @@ class Stream final {
       }
     }
 
+    ss::EntryResponse PassEntryToSubscriber(const impl_t& impl, const entry_t& entry, idxts_t idx_ts) {
+      if (!terminate_sent_ && terminate_signal_) {
+        terminate_sent_ = true;
+        if (subscriber_.Terminate() != ss::TerminationResponse::Wait) {
+          return ss::EntryResponse::Done;
+        }
+      }
+      return current::ss::PassEntryToSubscriberIfTypeMatches<TYPE_SUBSCRIBED_TO, entry_t>(
+          subscriber_,
+          [this]() -> ss::EntryResponse { return subscriber_.EntryResponseIfNoMorePassTypeFilter(); },
+          entry,
+          idx_ts,
+          impl.persister.LastPublishedIndexAndTimestamp());
+    }
+
+    // Passes the entries from the stream's cache of the recently published ones, if they are there,
+    // and otherwise, for the subscribers lagging behind, from the persister.
     template <SubscriptionMode MODE = SM>
     std::enable_if_t<MODE == SubscriptionMode::Checked, ss::EntryResponse> PassEntriesToSubscriber(const impl_t& impl,
                                                                                                    uint64_t index,
                                                                                                    uint64_t size) {
-      for (const auto& e : impl.persister.Iterate(index, size)) {
-        if (!terminate_sent_ && terminate_signal_) {
-          terminate_sent_ = true;
-          if (subscriber_.Terminate() != ss::TerminationResponse::Wait) {
-            return ss::EntryResponse::Done;
+      auto& cache = impl.entry_cache;
+      while (index < size) {
+        const uint64_t first_cached_index = cache.FirstCachedIndex(index, size);
+        if (index < first_cached_index) {
+          for (const auto& e : impl.persister.Iterate(index, first_cached_index)) {
+            cache.CountMiss();
+            if (PassEntryToSubscriber(impl, e.entry, e.idx_ts) == ss::EntryResponse::Done) {
+              return ss::EntryResponse::Done;
+            }
+          }
+          index = first_cached_index;
+        } else {
+          // The entry may have just been evicted, then it is read from the persister on the next iteration.
+          const auto cached = cache.Get(index);
+          if (cached.entry) {
+            cache.CountHit();
+            if (PassEntryToSubscriber(impl, *cached.entry, cached.idx_ts) == ss::EntryResponse::Done) {
+              return ss::EntryResponse::Done;
+            }
+            ++index;
           }
-        }
-        if (current::ss::PassEntryToSubscriberIfTypeMatches<TYPE_SUBSCRIBED_TO, entry_t>(
-                subscriber_,
-                [this]() -> ss::EntryResponse { return subscriber_.EntryResponseIfNoMorePassTypeFilter(); },
-                e.entry,
-                e.idx_ts,
-                impl.persister.LastPublishedIndexAndTimestamp()) == ss::EntryResponse::Done) {
-          return ss::EntryResponse::Done;
         }
       }
       return ss::EntryResponse::More;
@@ -377,41 +471,55 @@ class Stream final {
       return ss::EntryResponse::More;
     }
 
-    void ThreadImpl(uint64_t begin_idx) {
-      auto head = from_us_ - std::chrono::microseconds(1);
-      uint64_t index = begin_idx;
-      uint64_t size = 0;
-      while (true) {
-        if (!terminate_sent_ && terminate_signal_) {
-          terminate_sent_ = true;
-          if (subscriber_.Terminate() != ss::TerminationResponse::Wait) {
-            return;
-          }
+    enum class StepResult { Done, MoreToDo, NothingToDo };
+
+    // Passes the subscriber at most `max_entries` entries, and the head, if it has moved forward.
+    StepResult Step(uint64_t max_entries) {
+      if (!terminate_sent_ && terminate_signal_) {
+        terminate_sent_ = true;
+        if (subscriber_.Terminate() != ss::TerminationResponse::Wait) {
+          return StepResult::Done;
         }
-        const auto head_idx = impl_->persister.HeadAndLastPublishedIndexAndTimestamp();
-        size = Exists(head_idx.idxts) ? Value(head_idx.idxts).index + 1 : 0;
-        if (head_idx.head > head) {
-          if (size > index) {
-            if (PassEntriesToSubscriber(*impl_, index, size) == ss::EntryResponse::Done) {
-              return;
-            }
-            index = size;
-            head = Value(head_idx.idxts).us;
-          }
-          if (size >= begin_idx && head_idx.head > head && subscriber_(head_idx.head) == ss::EntryResponse::Done) {
-            return;
-          }
-          head = head_idx.head;
-        } else {
+      }
+      const auto head_idx = impl_->persister.HeadAndLastPublishedIndexAndTimestamp();
+      const uint64_t size = Exists(head_idx.idxts) ? Value(head_idx.idxts).index + 1 : 0;
+      if (!(head_idx.head > head_)) {
+        return StepResult::NothingToDo;
+      }
+      if (size > index_) {
+        const uint64_t end = (size - index_ > max_entries) ? index_ + max_entries : size;
+        if (PassEntriesToSubscriber(*impl_, index_, end) == ss::EntryResponse::Done) {
+          return StepResult::Done;
+        }
+        index_ = end;
+        if (end < size) {
+          return StepResult::MoreToDo;
+        }
+        head_ = Value(head_idx.idxts).us;
+      }
+      if (size >= begin_idx_ && head_idx.head > head_ && subscriber_(head_idx.head) == ss::EntryResponse::Done) {
+        return StepResult::Done;
+      }
+      head_ = head_idx.head;
+      return StepResult::MoreToDo;
+    }
+
+    void ThreadImpl() {
+      while (true) {
+        const StepResult result = Step(static_cast<uint64_t>(-1));
+        if (result == StepResult::Done) {
+          return;
+        } else if (result == StepResult::NothingToDo) {
           std::unique_lock<std::mutex> lock(impl_->publishing_mutex);
           current::WaitableTerminateSignalBulkNotifier::Scope scope(impl_->notifier, terminate_signal_);
           terminate_signal_.WaitUntil(
               lock,
-              [this, &index, &begin_idx, &head]() {
+              [this]() {
                 return terminate_signal_ ||
-                       impl_->persister.template Size<current::locks::MutexLockStatus::AlreadyLocked>() > index ||
-                       (index > begin_idx &&
-                        impl_->persister.template CurrentHead<current::locks::MutexLockStatus::AlreadyLocked>() > head);
+                       impl_->persister.template Size<current::locks::MutexLockStatus::AlreadyLocked>() > index_ ||
+                       (index_ > begin_idx_ &&
+                        impl_->persister.template CurrentHead<current::locks::MutexLockStatus::AlreadyLocked>() >
+                            head_);
               });
         }
       }
@@ -629,6 +737,13 @@ class Stream final {
   // NOTE(dkorolev): Returns the pointer, because we're using `->` everywhere now. -- D.K.
   const persistence_layer_t* Data() const { return &impl_->persister; }
 
+  // The hit/miss counters of the cache of the recently published entries, shared by the subscribers.
+  StreamEntryCacheStats EntryCacheStats() const { return impl_->entry_cache.Stats(); }
+
+  // Runs the subscribers created from now on, including the HTTP ones, as tasks on the `pool`,
+  // or, if `pool` is `nullptr`, each in a dedicated thread. The pool must outlive their scopes.
+  void RunSubscribersOnPool(SubscriberPool* pool) { impl_->subscriber_pool = pool; }
+
   static StreamSchema StaticConstructSchemaAsObject(const ss::StreamNamespaceName& namespace_name) {
     StreamSchema schema;
 
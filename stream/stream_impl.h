@@ -27,15 +27,23 @@ SOFTWARE.
 
 #include "../port.h"
 
+#include <atomic>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <thread>
 #include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "subscriber_pool.h"
 
 #include "../bricks/util/random.h"
 #include "../bricks/util/waitable_terminate_signal.h"
 
 #include "../blocks/persistence/memory.h"
 #include "../blocks/persistence/file.h"
+#include "../blocks/persistence/segmented_file.h"
 #include "../blocks/ss/pubsub.h"
 
 namespace current {
@@ -101,6 +109,97 @@ class AbstractSubscriberObject {
   virtual ~AbstractSubscriberObject() = default;
 };
 
+namespace constants {
+constexpr size_t kDefaultEntryCacheCapacity = 1024u;
+}  // namespace current::stream::constants
+
+CURRENT_STRUCT(StreamEntryCacheStats) {
+  CURRENT_FIELD(capacity, uint64_t, 0u);
+  CURRENT_FIELD(hits, uint64_t, 0u);    // The entries passed to subscribers from the cache.
+  CURRENT_FIELD(misses, uint64_t, 0u);  // The entries passed to subscribers from the persister.
+};
+
+// The persisters which keep the entries decoded in memory do not need a `StreamEntryCache` in front of them.
+template <typename PERSISTER>
+struct PersisterKeepsEntriesDecoded : std::false_type {};
+
+template <typename ENTRY>
+struct PersisterKeepsEntriesDecoded<current::persistence::Memory<ENTRY>> : std::true_type {};
+
+// The ring of the most recently published entries, decoded and shared among all the subscribers of the stream,
+// so that the subscribers following the tail of the stream do not read and parse each entry on their own.
+// The entries are placed by their indexes, so the cache may have holes, for instance, after `PublishUnsafe()`.
+template <typename ENTRY>
+class StreamEntryCache final {
+ public:
+  struct CachedEntry {
+    idxts_t idx_ts;
+    std::shared_ptr<const ENTRY> entry;
+  };
+
+  explicit StreamEntryCache(size_t capacity) : slots_(capacity) {}
+
+  bool Enabled() const { return !slots_.empty(); }
+
+  void Put(idxts_t idx_ts, std::shared_ptr<const ENTRY> entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slots_[idx_ts.index % slots_.size()];
+    slot.idx_ts = idx_ts;
+    slot.entry = std::move(entry);
+    end_ = std::max(end_, idx_ts.index + 1u);
+  }
+
+  // Returns a null `entry` if the entry with this index is not in the cache.
+  CachedEntry Get(uint64_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (Enabled()) {
+      const Slot& slot = slots_[index % slots_.size()];
+      if (slot.entry && slot.idx_ts.index == index) {
+        return CachedEntry{slot.idx_ts, slot.entry};
+      }
+    }
+    return CachedEntry{idxts_t(), nullptr};
+  }
+
+  // Returns the lowest index in `[from, till)` which is in the cache, or `till` if there is none.
+  uint64_t FirstCachedIndex(uint64_t from, uint64_t till) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (Enabled()) {
+      const uint64_t begin = end_ > slots_.size() ? end_ - slots_.size() : 0u;
+      for (uint64_t index = std::max(from, begin); index < std::min(till, end_); ++index) {
+        const Slot& slot = slots_[index % slots_.size()];
+        if (slot.entry && slot.idx_ts.index == index) {
+          return index;
+        }
+      }
+    }
+    return till;
+  }
+
+  void CountHit() { ++hits_; }
+  void CountMiss() { ++misses_; }
+
+  StreamEntryCacheStats Stats() const {
+    StreamEntryCacheStats stats;
+    stats.capacity = slots_.size();
+    stats.hits = hits_;
+    stats.misses = misses_;
+    return stats;
+  }
+
+ private:
+  struct Slot {
+    idxts_t idx_ts;
+    std::shared_ptr<const ENTRY> entry;
+  };
+
+  mutable std::mutex mutex_;
+  std::vector<Slot> slots_;
+  uint64_t end_ = 0u;  // The greatest index put into the cache so far, plus one.
+  std::atomic<uint64_t> hits_{0u};
+  std::atomic<uint64_t> misses_{0u};
+};
+
 template <typename ENTRY, template <typename> class PERSISTENCE_LAYER>
 struct StreamImpl {
   using entry_t = ENTRY;
@@ -111,6 +210,15 @@ struct StreamImpl {
   persistence_layer_t persister;
   mutable current::WaitableTerminateSignalBulkNotifier notifier;
 
+  // The recently published entries, for the subscribers to not parse them from the persister, which may be slow.
+  mutable StreamEntryCache<entry_t> entry_cache;
+
+  // The pool to run the new subscribers on, or `nullptr` to run each of them in a dedicated thread.
+  std::atomic<SubscriberPool*> subscriber_pool;
+  // The subscribers running on a pool, to be scheduled to run on every update of the stream.
+  mutable std::mutex pooled_subscribers_mutex;
+  mutable std::unordered_set<SubscriberPool::Task*> pooled_subscribers;
+
   // The HTTP-subscription-related logic is `mutable` because subscribing to a stream is `const` by convention.
   using http_subscriptions_t =
       std::unordered_map<std::string, std::pair<SubscriberScope, std::unique_ptr<AbstractSubscriberObject>>>;
@@ -119,7 +227,49 @@ struct StreamImpl {
 
   template <typename... ARGS>
   StreamImpl(ARGS&&... args)
-      : persister(publishing_mutex, std::forward<ARGS>(args)...) {}
+      : persister(publishing_mutex, std::forward<ARGS>(args)...),
+        entry_cache(PersisterKeepsEntriesDecoded<persistence_layer_t>::value
+                        ? 0u
+                        : constants::kDefaultEntryCacheCapacity),
+        subscriber_pool(nullptr) {}
+
+  // Wakes up the subscribers, both those waiting in their dedicated threads, and those parked on a pool.
+  void NotifySubscribers() const {
+    notifier.NotifyAllOfExternalWaitableEvent();
+    std::lock_guard<std::mutex> lock(pooled_subscribers_mutex);
+    for (SubscriberPool::Task* task : pooled_subscribers) {
+      task->Wake();
+    }
+  }
+};
+
+// The range of the entries held by `shared_ptr`-s, for `PublishBatch()` to persist the entries it then caches.
+template <typename ENTRY>
+class SharedEntriesRange final {
+ public:
+  using entries_t = std::vector<std::shared_ptr<const ENTRY>>;
+
+  class Iterator final {
+   public:
+    explicit Iterator(typename entries_t::const_iterator it) : it_(it) {}
+    const ENTRY& operator*() const { return **it_; }
+    Iterator& operator++() {
+      ++it_;
+      return *this;
+    }
+    bool operator!=(const Iterator& rhs) const { return it_ != rhs.it_; }
+
+   private:
+    typename entries_t::const_iterator it_;
+  };
+
+  explicit SharedEntriesRange(const entries_t& entries) : entries_(entries) {}
+  Iterator begin() const { return Iterator(entries_.begin()); }
+  Iterator end() const { return Iterator(entries_.end()); }
+  size_t size() const { return entries_.size(); }
+
+ private:
+  const entries_t& entries_;
 };
 
 template <typename ENTRY, template <typename> class PERSISTENCE_LAYER>
@@ -137,23 +287,72 @@ class StreamPublisherImpl {
             typename TIMESTAMP,
             class = std::enable_if_t<ss::can_publish_v<current::decay_t<E>, ENTRY>>>
   idxts_t PublisherPublishImpl(E&& e, TIMESTAMP&& timestamp) {
-    const auto result =
-        data_->persister.template PersisterPublishImpl<MLS>(std::forward<E>(e), std::forward<TIMESTAMP>(timestamp));
-    data_->notifier.NotifyAllOfExternalWaitableEvent();
-    return result;
+    if (data_->entry_cache.Enabled()) {
+      // Decode once, on behalf of all the subscribers: keep the published entry as is, not to parse it back.
+      auto entry = std::make_shared<const ENTRY>(std::forward<E>(e));
+      const auto result =
+          data_->persister.template PersisterPublishImpl<MLS>(*entry, std::forward<TIMESTAMP>(timestamp));
+      data_->entry_cache.Put(result, std::move(entry));
+      data_->NotifySubscribers();
+      return result;
+    } else {
+      const auto result =
+          data_->persister.template PersisterPublishImpl<MLS>(std::forward<E>(e), std::forward<TIMESTAMP>(timestamp));
+      data_->NotifySubscribers();
+      return result;
+    }
+  }
+
+  template <current::locks::MutexLockStatus MLS, typename ENTRIES, typename TIMESTAMPS>
+  idxts_t PublisherPublishBatchImpl(ENTRIES&& entries, const TIMESTAMPS& timestamps) {
+    if (data_->entry_cache.Enabled()) {
+      // Same as `PublisherPublishImpl()`, for each entry of the batch.
+      std::vector<std::shared_ptr<const ENTRY>> decoded;
+      decoded.reserve(static_cast<size_t>(std::size(entries)));
+      for (auto&& entry : entries) {
+        if constexpr (std::is_lvalue_reference_v<ENTRIES>) {
+          decoded.push_back(std::make_shared<const ENTRY>(entry));
+        } else {
+          decoded.push_back(std::make_shared<const ENTRY>(std::move(entry)));
+        }
+      }
+      const auto result =
+          data_->persister.template PersisterPublishBatchImpl<MLS>(SharedEntriesRange<ENTRY>(decoded), timestamps);
+      uint64_t index = result.index + 1u - decoded.size();
+      auto timestamp = std::begin(timestamps);
+      for (auto& entry : decoded) {
+        data_->entry_cache.Put(idxts_t(index, *timestamp), std::move(entry));
+        ++index;
+        ++timestamp;
+      }
+      data_->NotifySubscribers();
+      return result;
+    } else {
+      const auto result =
+          data_->persister.template PersisterPublishBatchImpl<MLS>(std::forward<ENTRIES>(entries), timestamps);
+      data_->NotifySubscribers();
+      return result;
+    }
   }
 
   template <current::locks::MutexLockStatus MLS>
   idxts_t PublisherPublishUnsafeImpl(const std::string& raw_log_line) {
     const auto result = data_->persister.template PersisterPublishUnsafeImpl<MLS>(raw_log_line);
-    data_->notifier.NotifyAllOfExternalWaitableEvent();
+    data_->NotifySubscribers();
+    return result;
+  }
+
+  template <current::locks::MutexLockStatus MLS>
+  idxts_t PublisherPublishUnsafeImpl(const ss::RawLogLinesBatch& batch) {
+    const auto result = data_->persister.template PersisterPublishUnsafeImpl<MLS>(batch);
+    data_->NotifySubscribers();
     return result;
   }
 
   template <current::locks::MutexLockStatus MLS, typename TIMESTAMP>
   void PublisherUpdateHeadImpl(TIMESTAMP&& timestamp) {
     data_->persister.template PersisterUpdateHeadImpl<MLS>(std::forward<TIMESTAMP>(timestamp));
-    data_->notifier.NotifyAllOfExternalWaitableEvent();
+    data_->NotifySubscribers();
   }
 
  private:
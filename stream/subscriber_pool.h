@@ -0,0 +1,170 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2016 Dmitry "Dima" Korolev <dmitry.korolev@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// A fixed pool of worker threads to run stream subscribers on, as opposed to a dedicated thread per subscriber.
+//
+// Each subscriber is a `SubscriberPool::Task`. The pool runs one bounded batch of a task at a time, and then puts
+// the task to the back of the queue if it has more to do, so that the tasks get their turns round-robin.
+// A task with nothing to do is parked until `Schedule()`-d again, which the stream does on each update.
+//
+// The pool must outlive the tasks, i.e. the subscriber scopes, that run on it.
+
+#ifndef CURRENT_STREAM_SUBSCRIBER_POOL_H
+#define CURRENT_STREAM_SUBSCRIBER_POOL_H
+
+#include "../port.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace current {
+namespace stream {
+
+class SubscriberPool final {
+ public:
+  class Task {
+   public:
+    // The `pool` may be `nullptr`, for the classes that only run as tasks optionally.
+    explicit Task(SubscriberPool* pool) : pool_(pool) {}
+    virtual ~Task() = default;
+
+    // Runs one batch, of at most `SubscriberPool::BatchSize()` entries.
+    // Returns `true` if there is more to do right away, or `false` to have the task parked.
+    virtual bool RunBatch() = 0;
+
+    // Have the task run, unless it is already scheduled to. THREAD-SAFE.
+    void Wake() {
+      if (pool_) {
+        pool_->Schedule(this);
+      }
+    }
+
+    SubscriberPool* Pool() const { return pool_; }
+
+   private:
+    friend class SubscriberPool;
+    enum class State { Parked, Queued, Running, RunningAndWoken };
+
+    SubscriberPool* const pool_;
+    State state_ = State::Parked;  // Guarded by `pool_.mutex_`.
+    bool removed_ = false;         // Guarded by `pool_.mutex_`.
+
+    Task() = delete;
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+  };
+
+  explicit SubscriberPool(size_t threads = std::max(2u, std::thread::hardware_concurrency()),
+                          size_t batch_size = 64u)
+      : batch_size_(std::max(batch_size, static_cast<size_t>(1u))) {
+    for (size_t i = 0u; i < std::max(threads, static_cast<size_t>(1u)); ++i) {
+      threads_.emplace_back([this]() { WorkerThread(); });
+    }
+  }
+
+  ~SubscriberPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    queue_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t BatchSize() const { return batch_size_; }
+
+  // Makes the task run, or, if it is running now, run once more. THREAD-SAFE.
+  void Schedule(Task* task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!task->removed_) {
+      if (task->state_ == Task::State::Parked) {
+        task->state_ = Task::State::Queued;
+        queue_.push_back(task);
+        queue_cv_.notify_one();
+      } else if (task->state_ == Task::State::Running) {
+        task->state_ = Task::State::RunningAndWoken;
+      }
+    }
+  }
+
+  // Makes sure the task is not and will not be run, waiting for its running batch, if any, to complete.
+  // Must be called before the task is destroyed, and not from within its own `RunBatch()`.
+  void Remove(Task* task) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    task->removed_ = true;
+    if (task->state_ == Task::State::Queued) {
+      queue_.erase(std::find(queue_.begin(), queue_.end(), task));
+      task->state_ = Task::State::Parked;
+    }
+    task_done_cv_.wait(lock, [task]() { return task->state_ == Task::State::Parked; });
+  }
+
+ private:
+  void WorkerThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      queue_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+      if (stop_) {
+        return;
+      }
+      Task* task = queue_.front();
+      queue_.pop_front();
+      task->state_ = Task::State::Running;
+      lock.unlock();
+      const bool more = task->RunBatch();
+      lock.lock();
+      if ((more || task->state_ == Task::State::RunningAndWoken) && !task->removed_) {
+        // To the back of the queue, to let the other tasks run their batches first.
+        task->state_ = Task::State::Queued;
+        queue_.push_back(task);
+        queue_cv_.notify_one();
+      } else {
+        task->state_ = Task::State::Parked;
+        task_done_cv_.notify_all();
+      }
+    }
+  }
+
+  const size_t batch_size_;
+  std::mutex mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable task_done_cv_;
+  std::deque<Task*> queue_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+
+  SubscriberPool(const SubscriberPool&) = delete;
+  SubscriberPool& operator=(const SubscriberPool&) = delete;
+};
+
+}  // namespace current::stream
+}  // namespace current
+
+#endif  // CURRENT_STREAM_SUBSCRIBER_POOL_H
@@ -1096,6 +1096,235 @@ TEST(Stream, ParsesFromFile) {
       << joined_expected_values << " != " << d_unchecked.results_;
 }
 
+TEST(Stream, PersistsToAndParsesFromSegmentedFile) {
+  current::time::ResetToZero();
+
+  using namespace stream_unittest;
+  using stream_t = current::stream::Stream<Record, current::persistence::SegmentedFile>;
+
+  const std::string persistence_dir_name = current::FileSystem::JoinPath(FLAGS_stream_test_tmpdir, "segments");
+  const auto persistence_dir_remover = current::FileSystem::ScopedRmDir(persistence_dir_name);
+
+  {
+    auto persisted = stream_t::CreateStream(persistence_dir_name);
+    current::time::SetNow(std::chrono::microseconds(100));
+    persisted->Publisher()->Publish(Record(1));
+    current::time::SetNow(std::chrono::microseconds(200));
+    persisted->Publisher()->Publish(Record(2));
+    current::time::SetNow(std::chrono::microseconds(300));
+    persisted->Publisher()->UpdateHead();
+    current::time::SetNow(std::chrono::microseconds(400));
+    persisted->Publisher()->Publish(Record(3));
+    current::time::SetNow(std::chrono::microseconds(500));
+    persisted->Publisher()->UpdateHead();
+  }
+
+  auto parsed = stream_t::CreateStream(persistence_dir_name);
+  EXPECT_EQ(3u, parsed->Data()->Size());
+  EXPECT_EQ(500, parsed->Data()->CurrentHead().count());
+
+  Data d;
+  Data d_unchecked;
+  {
+    StreamTestProcessor p(d, false, true);
+    StreamTestProcessor p_unchecked(d_unchecked, false, true);
+    p.SetMax(4u);
+    p_unchecked.SetMax(4u);
+    parsed->Subscribe(p);
+    parsed->SubscribeUnchecked(p_unchecked);
+    EXPECT_EQ(4u, d.seen_);
+    EXPECT_EQ(500, d.head_.count());
+    EXPECT_EQ(4u, d_unchecked.seen_);
+    EXPECT_EQ(500, d_unchecked.head_.count());
+  }
+  const std::vector<std::string> expected_values{"[0:100,2:400] 1", "[1:200,2:400] 2", "[2:400,2:400] 3"};
+  EXPECT_TRUE(CompareValuesMixedWithTerminate(d.results_, expected_values, StreamTestProcessor::kTerminateStr))
+      << d.results_;
+  EXPECT_TRUE(
+      CompareValuesMixedWithTerminate(d_unchecked.results_, expected_values, StreamTestProcessor::kTerminateStr))
+      << d_unchecked.results_;
+}
+
+TEST(Stream, SubscribersShareTheCacheOfDecodedEntries) {
+  current::time::ResetToZero();
+
+  using namespace stream_unittest;
+  using stream_t = current::stream::Stream<Record, current::persistence::File>;
+
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_stream_test_tmpdir, "data");
+  const auto persistence_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+  const auto persistence_index_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name + ".idx");
+
+  const std::vector<std::string> expected_values{"1", "2", "3", "4", "5"};
+  const auto SubscribeThreeTimes = [&expected_values](const current::Owned<stream_t>& stream) {
+    for (int i = 0; i < 3; ++i) {
+      Data d;
+      {
+        StreamTestProcessor p(d, false);
+        p.SetMax(5u);
+        stream->Subscribe(p);
+      }
+      EXPECT_TRUE(CompareValuesMixedWithTerminate(d.results_, expected_values, StreamTestProcessor::kTerminateStr))
+          << d.results_;
+    }
+  };
+
+  {
+    auto stream = stream_t::CreateStream(persistence_file_name);
+    EXPECT_EQ(current::stream::constants::kDefaultEntryCacheCapacity, stream->EntryCacheStats().capacity);
+    for (int i = 1; i <= 5; ++i) {
+      stream->Publisher()->Publish(Record(i), std::chrono::microseconds(i * 100));
+    }
+    SubscribeThreeTimes(stream);
+    // The entries are passed to subscribers straight from the cache, as they have just been published.
+    EXPECT_EQ(15u, stream->EntryCacheStats().hits);
+    EXPECT_EQ(0u, stream->EntryCacheStats().misses);
+  }
+
+  {
+    auto stream = stream_t::CreateStream(persistence_file_name);
+    SubscribeThreeTimes(stream);
+    // The entries persisted before the stream was created are read from the persister.
+    EXPECT_EQ(0u, stream->EntryCacheStats().hits);
+    EXPECT_EQ(15u, stream->EntryCacheStats().misses);
+    stream->Publisher()->Publish(Record(6), std::chrono::microseconds(600));
+    {
+      Data d;
+      {
+        StreamTestProcessor p(d, false);
+        p.SetMax(6u);
+        stream->Subscribe(p);
+      }
+      EXPECT_TRUE(CompareValuesMixedWithTerminate(
+          d.results_, {"1", "2", "3", "4", "5", "6"}, StreamTestProcessor::kTerminateStr))
+          << d.results_;
+    }
+    EXPECT_EQ(1u, stream->EntryCacheStats().hits);
+    EXPECT_EQ(20u, stream->EntryCacheStats().misses);
+  }
+
+  {
+    // The in-memory stream keeps the entries decoded, and needs no cache.
+    auto stream = current::stream::Stream<Record>::CreateStream();
+    EXPECT_EQ(0u, stream->EntryCacheStats().capacity);
+  }
+}
+
+TEST(Stream, PublishBatch) {
+  current::time::ResetToZero();
+
+  using namespace stream_unittest;
+  using us_t = std::chrono::microseconds;
+
+  const std::string persistence_file_name = current::FileSystem::JoinPath(FLAGS_stream_test_tmpdir, "data");
+  const auto persistence_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name);
+  const auto persistence_index_file_remover = current::FileSystem::ScopedRmFile(persistence_file_name + ".idx");
+
+  const auto PublishAndSubscribe = [](auto& stream) {
+    stream->Publisher()->Publish(Record(1), us_t(100));
+    stream->Publisher()->PublishBatch(std::vector<Record>({Record(2), Record(3), Record(4)}),
+                                      std::vector<us_t>({us_t(200), us_t(300), us_t(400)}));
+    ASSERT_THROW(stream->Publisher()->PublishBatch(std::vector<Record>({Record(5), Record(6)}),
+                                                   std::vector<us_t>({us_t(500), us_t(500)})),
+                 current::ss::InconsistentTimestampException);
+    const std::vector<Record> more({Record(5), Record(6)});
+    const auto last = stream->Publisher()->PublishBatch(more, std::vector<us_t>({us_t(500), us_t(600)}));
+    EXPECT_EQ(5u, last.index);
+    EXPECT_EQ(600, last.us.count());
+    EXPECT_EQ(6u, stream->Data()->Size());
+
+    Data d;
+    {
+      StreamTestProcessor p(d, false, true);
+      p.SetMax(6u);
+      stream->Subscribe(p);
+    }
+    EXPECT_TRUE(CompareValuesMixedWithTerminate(d.results_,
+                                                {"[0:100,5:600] 1",
+                                                 "[1:200,5:600] 2",
+                                                 "[2:300,5:600] 3",
+                                                 "[3:400,5:600] 4",
+                                                 "[4:500,5:600] 5",
+                                                 "[5:600,5:600] 6"},
+                                                StreamTestProcessor::kTerminateStr))
+        << d.results_;
+  };
+
+  {
+    auto stream = current::stream::Stream<Record>::CreateStream();
+    PublishAndSubscribe(stream);
+  }
+
+  {
+    auto stream = current::stream::Stream<Record, current::persistence::File>::CreateStream(persistence_file_name);
+    PublishAndSubscribe(stream);
+    // The entries of the batch are cached as they are published, as the individually published ones are.
+    EXPECT_EQ(6u, stream->EntryCacheStats().hits);
+    EXPECT_EQ(0u, stream->EntryCacheStats().misses);
+  }
+}
+
+TEST(Stream, SubscribersRunOnPool) {
+  current::time::ResetToZero();
+
+  using namespace stream_unittest;
+
+  constexpr size_t kSubscribers = 25u;
+  constexpr int kEntries = 20;
+
+  std::vector<std::string> expected_values;
+  for (int i = 1; i <= kEntries; ++i) {
+    expected_values.push_back(current::ToString(i));
+  }
+
+  current::stream::SubscriberPool pool(2u, 4u);
+  EXPECT_EQ(4u, pool.BatchSize());
+
+  auto stream = current::stream::Stream<Record>::CreateStream();
+  stream->RunSubscribersOnPool(&pool);
+  auto publisher = stream->BorrowPublisher();
+  for (int i = 1; i <= kEntries / 2; ++i) {
+    publisher->Publish(Record(i), std::chrono::microseconds(i * 10));
+  }
+
+  std::vector<std::unique_ptr<Data>> data;
+  {
+    std::vector<std::unique_ptr<StreamTestProcessor>> processors;
+    std::vector<current::stream::SubscriberScope> scopes;
+    for (size_t i = 0; i < kSubscribers; ++i) {
+      data.emplace_back(std::make_unique<Data>());
+      processors.emplace_back(std::make_unique<StreamTestProcessor>(*data.back(), false));
+      processors.back()->SetMax(kEntries);
+      scopes.emplace_back(stream->Subscribe(*processors.back()));
+    }
+    // The entries published after subscribing wake up the pooled subscribers.
+    for (int i = kEntries / 2 + 1; i <= kEntries; ++i) {
+      publisher->Publish(Record(i), std::chrono::microseconds(i * 10));
+    }
+    // The scopes are destroyed before the processors, waiting for each subscriber to process all the entries.
+    scopes.clear();
+  }
+
+  for (const auto& d : data) {
+    EXPECT_EQ(static_cast<size_t>(kEntries), d->seen_);
+    EXPECT_TRUE(CompareValuesMixedWithTerminate(d->results_, expected_values, StreamTestProcessor::kTerminateStr))
+        << d->results_;
+  }
+
+  {
+    // A pooled subscriber that agrees to terminate is released without processing the entries to come.
+    Data d;
+    {
+      StreamTestProcessor p(d, true);
+      const auto scope = stream->Subscribe(p);
+      while (d.seen_ != static_cast<size_t>(kEntries)) {
+        std::this_thread::yield();
+      }
+    }
+    EXPECT_EQ(Join(expected_values, ',') + ',' + StreamTestProcessor::kTerminateStr, d.results_);
+  }
+}
+
 TEST(Stream, UncheckedVsCheckedSubscription) {
   using namespace stream_unittest;
 
@@ -1351,6 +1580,72 @@ TEST(Stream, ParseArbitrarilySplitChunks) {
   EXPECT_EQ(stream_golden_data, current::FileSystem::ReadFileAsString(persistence_file_name));
 }
 
+TEST(Stream, ReplicatesInBinaryBatches) {
+  current::time::ResetToZero();
+
+  using namespace stream_unittest;
+  using stream_t = current::stream::Stream<Record, current::persistence::File>;
+  using RemoteStreamReplicator = current::stream::StreamReplicator<stream_t>;
+  static_assert(current::ss::AcceptsRawLogLinesBatch<RemoteStreamReplicator>::value, "");
+
+  const std::string master_file_name = current::FileSystem::JoinPath(FLAGS_stream_test_tmpdir, "master");
+  const std::string follower_file_name = current::FileSystem::JoinPath(FLAGS_stream_test_tmpdir, "follower");
+  const auto master_file_remover = current::FileSystem::ScopedRmFile(master_file_name);
+  const std::string base_url = Printf("http://localhost:%d/exposed", FLAGS_stream_http_test_port);
+
+  auto master = stream_t::CreateStream(master_file_name);
+  for (int i = 1; i <= 1000; ++i) {
+    master->Publisher()->Publish(Record(i), std::chrono::microseconds(i * 10));
+  }
+  master->Publisher()->UpdateHead(std::chrono::microseconds(20000));
+  const auto scope =
+      HTTP(FLAGS_stream_http_test_port)
+          .Register("/exposed", URLPathArgs::CountMask::None | URLPathArgs::CountMask::One, *master);
+
+  {
+    const auto response = HTTP(GET(base_url + "?i=998&binary&nowait"));
+    ASSERT_TRUE(response.headers.Has("X-Current-Stream-Format"));
+    EXPECT_EQ("binary", response.headers.Get("X-Current-Stream-Format"));
+    const std::string lines =
+        "{\"index\":998,\"us\":9990}\t{\"x\":999}\n"
+        "{\"index\":999,\"us\":10000}\t{\"x\":1000}\n";
+    ASSERT_EQ(4u + lines.length(), response.body.length());
+    EXPECT_EQ(std::string({static_cast<char>(lines.length()), 0, 0, 0}) + lines, response.body);
+  }
+  {
+    const auto response = HTTP(GET(base_url + "?i=999&nowait"));
+    EXPECT_FALSE(response.headers.Has("X-Current-Stream-Format"));
+    EXPECT_EQ("{\"index\":999,\"us\":10000}\t{\"x\":1000}\n", response.body);
+  }
+
+  const auto replicate = [&](bool binary, current::stream::ReplicationMode mode) {
+    const auto follower_file_remover = current::FileSystem::ScopedRmFile(follower_file_name);
+    auto follower = stream_t::CreateStream(follower_file_name);
+    {
+      current::stream::SubscribableRemoteStream<Record> remote_stream(base_url);
+      remote_stream.UseBinaryFormat(binary);
+      auto replicator = RemoteStreamReplicator(follower);
+      std::unique_ptr<current::stream::SubscriberScope> subscriber_scope;
+      if (mode == current::stream::ReplicationMode::Checked) {
+        subscriber_scope = std::make_unique<current::stream::SubscriberScope>(remote_stream.Subscribe(replicator));
+      } else {
+        subscriber_scope =
+            std::make_unique<current::stream::SubscriberScope>(remote_stream.SubscribeUnchecked(replicator));
+      }
+      while (follower->Data()->CurrentHead() < std::chrono::microseconds(20000)) {
+        std::this_thread::yield();
+      }
+    }
+    return current::FileSystem::ReadFileAsString(follower_file_name);
+  };
+
+  const std::string master_contents = current::FileSystem::ReadFileAsString(master_file_name);
+  EXPECT_EQ(master_contents, replicate(false, current::stream::ReplicationMode::Unchecked));
+  EXPECT_EQ(master_contents, replicate(true, current::stream::ReplicationMode::Unchecked));
+  EXPECT_EQ(master_contents, replicate(false, current::stream::ReplicationMode::Checked));
+  EXPECT_EQ(master_contents, replicate(true, current::stream::ReplicationMode::Checked));
+}
+
 TEST(Stream, MasterFollowerFlip) {
   current::time::ResetToZero();
 
@@ -0,0 +1,322 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+// The compact binary format of `CURRENT_STRUCT`-s, `Variant`-s, and the types they consist of.
+//
+// `SaveIntoBinary(object)` returns, and `SaveIntoBinary(ostream, object)` writes, the frame of:
+// * The four bytes of the signature, "C5TB".
+// * The schema fingerprint, the `CurrentTypeID<T>()` of the saved type, as eight bytes, little endian.
+// * The length of the body, as a varint padded to its maximum width of ten bytes, for it to be written in place once
+//   the body is serialized. The readers accept any varint there.
+// * The body, which has no field names and no type information other than the type IDs of the `Variant` cases:
+//   * The unsigned integers, save for the one byte ones, as the LEB128 varints.
+//   * The signed integers, save for the one byte ones, and the `std::chrono` durations, as the zigzag varints.
+//   * `bool`, `char`, `int8_t` and `uint8_t` as one byte, `float` and `double` as four and eight bytes, little endian.
+//   * The enums as their underlying types.
+//   * The strings and the containers as the varint size followed by their characters or elements.
+//   * `Optional` as the byte of zero or one, followed by the value if it is there.
+//   * `Variant` as the eight byte type ID of its case, followed by the case itself.
+//   * `CURRENT_STRUCT` as the fields of its base, if any, followed by its own fields, in the order of declaration.
+//
+// `LoadFromBinary<T>()` throws `BinarySchemaMismatchException` if the data has been saved from a type with a different
+// schema, as the fingerprint is the hash of the names and of the types of the fields, and of the cases of the variants,
+// all the way down. The binary format is thus no substitute for JSON for the data the schema of which is to evolve.
+// For the same reason, only the types the reflection knows of can be saved, i.e. no `std::tuple`, and no containers
+// with custom hash functions or comparators.
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_BINARY_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_BINARY_H
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#include "../exceptions.h"
+#include "../serialization.h"
+
+#include "../../struct.h"
+#include "../../optional.h"
+#include "../../helpers.h"
+#include "../../reflection/reflection.h"
+
+#include "../../../bricks/template/pod.h"  // `current::copy_free`.
+
+namespace current {
+namespace serialization {
+namespace binary {
+
+class BinarySerializer final {
+ public:
+  explicit BinarySerializer(std::string& output) : output_(output) {}
+
+  void Byte(uint8_t value) { output_.push_back(static_cast<char>(value)); }
+
+  void Bytes(const char* data, size_t size) { output_.append(data, size); }
+
+  void Varint(uint64_t value) {
+    char buffer[10];
+    size_t size = 0u;
+    while (value >= 0x80u) {
+      buffer[size++] = static_cast<char>((value & 0x7fu) | 0x80u);
+      value >>= 7;
+    }
+    buffer[size++] = static_cast<char>(value);
+    output_.append(buffer, size);
+  }
+
+  void SignedVarint(int64_t value) {
+    Varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+  }
+
+  template <typename T>
+  void Fixed(T value) {
+    static_assert(std::is_unsigned_v<T>, "");
+    char buffer[sizeof(T)];
+    for (size_t i = 0u; i < sizeof(T); ++i) {
+      buffer[i] = static_cast<char>(static_cast<uint64_t>(value) >> (8u * i));
+    }
+    output_.append(buffer, sizeof(T));
+  }
+
+ private:
+  std::string& output_;
+};
+
+class BinaryDeserializer final {
+ public:
+  BinaryDeserializer(const char* begin, const char* end) : current_(begin), end_(end) {}
+
+  size_t BytesLeft() const { return static_cast<size_t>(end_ - current_); }
+
+  uint8_t Byte() {
+    Require(1u);
+    return static_cast<uint8_t>(*current_++);
+  }
+
+  const char* Bytes(size_t size) {
+    Require(size);
+    const char* result = current_;
+    current_ += size;
+    return result;
+  }
+
+  uint64_t Varint() {
+    uint64_t value = 0u;
+    for (size_t shift = 0u; shift < 64u; shift += 7u) {
+      const uint8_t byte = Byte();
+      value |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+      if (!(byte & 0x80u)) {
+        return value;
+      }
+    }
+    CURRENT_THROW(BinaryLoadFromStreamException("Malformed varint."));
+  }
+
+  int64_t SignedVarint() {
+    const uint64_t value = Varint();
+    return static_cast<int64_t>((value >> 1) ^ (0u - (value & 1u)));
+  }
+
+  template <typename T>
+  T Fixed() {
+    static_assert(std::is_unsigned_v<T>, "");
+    const char* bytes = Bytes(sizeof(T));
+    uint64_t value = 0u;
+    for (size_t i = 0u; i < sizeof(T); ++i) {
+      value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (8u * i);
+    }
+    return static_cast<T>(value);
+  }
+
+ private:
+  void Require(size_t size) const {
+    if (size > BytesLeft()) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Unexpected end of input."));
+    }
+  }
+
+  const char* current_;
+  const char* const end_;
+};
+
+constexpr static const char* kBinaryFormatSignature = "C5TB";
+constexpr static size_t kBinaryFormatSignatureLength = 4u;
+constexpr static size_t kBinaryFormatHeaderLength = kBinaryFormatSignatureLength + sizeof(uint64_t);
+constexpr static size_t kBinaryFormatBodyLengthBytes = 10u;  // The maximum width of a varint.
+constexpr static size_t kBinaryFormatStreamReadBytes = 1024u * 1024u;
+
+// The type ID is computed once per type, as the reflector is thread local, and walks the whole schema of the type.
+// The same holds for the type IDs of the cases of the variants, see `BinaryVariantCaseTypeID()`.
+template <typename T>
+reflection::TypeID BinarySchemaFingerprint() {
+  static const reflection::TypeID fingerprint = reflection::CurrentTypeID<T>();
+  return fingerprint;
+}
+
+// Appends the body alone, with no signature, fingerprint, or length, for the callers which keep those on their own.
+template <typename T>
+inline void AppendBinaryBody(std::string& output, const T& source) {
+  BinarySerializer serializer(output);
+  Serialize(serializer, source);
+}
+
+template <typename T>
+inline void AppendBinaryFrame(std::string& output, const T& source) {
+  output.append(kBinaryFormatSignature, kBinaryFormatSignatureLength);
+  BinarySerializer serializer(output);
+  serializer.Fixed(static_cast<uint64_t>(BinarySchemaFingerprint<T>()));
+  // The length of the body is only known once it is serialized, so the room for it is reserved in front of it.
+  const size_t body_length_begin = output.length();
+  output.append(kBinaryFormatBodyLengthBytes, '\0');
+  const size_t body_begin = output.length();
+  AppendBinaryBody(output, source);
+  uint64_t body_length = output.length() - body_begin;
+  for (size_t i = 0u; i < kBinaryFormatBodyLengthBytes; ++i) {
+    const bool last = (i + 1u == kBinaryFormatBodyLengthBytes);
+    output[body_length_begin + i] = static_cast<char>((body_length & 0x7fu) | (last ? 0x00u : 0x80u));
+    body_length >>= 7;
+  }
+}
+
+// Checks the signature and the schema fingerprint, which are the first `kBinaryFormatHeaderLength` bytes of the frame.
+template <typename T>
+inline void CheckBinaryFrameHeader(const char* header) {
+  if (std::memcmp(header, kBinaryFormatSignature, kBinaryFormatSignatureLength)) {
+    CURRENT_THROW(BinaryLoadFromStreamException("Not the binary format."));
+  }
+  BinaryDeserializer deserializer(header + kBinaryFormatSignatureLength, header + kBinaryFormatHeaderLength);
+  if (deserializer.Fixed<uint64_t>() != static_cast<uint64_t>(BinarySchemaFingerprint<T>())) {
+    CURRENT_THROW(BinarySchemaMismatchException(std::string("Expected the binary format of `") +
+                                                reflection::CurrentTypeName<T, reflection::NameFormat::Z>() + "`."));
+  }
+}
+
+template <typename T>
+inline void LoadBinaryBody(const char* begin, const char* end, T& destination) {
+  try {
+    BinaryDeserializer deserializer(begin, end);
+    Deserialize(deserializer, destination);
+    if (deserializer.BytesLeft()) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Extra bytes after the end of the body."));
+    }
+    CheckIntegrity(destination);
+  } catch (UninitializedVariant) {
+    CURRENT_THROW(BinaryUninitializedVariantObjectException());
+  }
+}
+
+template <typename T>
+inline std::string SaveIntoBinary(const T& source) {
+  std::string output;
+  AppendBinaryFrame(output, source);
+  return output;
+}
+
+template <typename T>
+inline void SaveIntoBinary(std::ostream& os, const T& source) {
+  const std::string output = SaveIntoBinary(source);
+  os.write(output.data(), static_cast<std::streamsize>(output.length()));
+}
+
+template <typename T>
+inline void LoadFromBinary(const std::string& source, T& destination) {
+  if (source.length() < kBinaryFormatHeaderLength) {
+    CURRENT_THROW(BinaryLoadFromStreamException("Unexpected end of input."));
+  }
+  CheckBinaryFrameHeader<T>(source.data());
+  BinaryDeserializer deserializer(source.data() + kBinaryFormatHeaderLength, source.data() + source.length());
+  const uint64_t body_length = deserializer.Varint();
+  if (body_length != deserializer.BytesLeft()) {
+    CURRENT_THROW(BinaryLoadFromStreamException("The length of the body does not match the input."));
+  }
+  const char* body = deserializer.Bytes(static_cast<size_t>(body_length));
+  LoadBinaryBody(body, body + body_length, destination);
+}
+
+// Loads the next frame from the stream, so that a stream of frames can be read one by one.
+template <typename T>
+inline void LoadFromBinary(std::istream& is, T& destination) {
+  char header[kBinaryFormatHeaderLength];
+  if (!is.read(header, kBinaryFormatHeaderLength)) {
+    CURRENT_THROW(BinaryLoadFromStreamException("Unexpected end of input."));
+  }
+  CheckBinaryFrameHeader<T>(header);
+  uint64_t body_length = 0u;
+  for (size_t shift = 0u;; shift += 7u) {
+    const int c = is.get();
+    if (c == std::char_traits<char>::eof() || shift >= 64u) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Malformed body length."));
+    }
+    body_length |= static_cast<uint64_t>(c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      break;
+    }
+  }
+  // The length comes from the input, so the body is read in bounded parts, not to allocate more than there is to read.
+  std::string body;
+  while (body.length() < body_length) {
+    const size_t part = static_cast<size_t>(
+        std::min(body_length - body.length(), static_cast<uint64_t>(kBinaryFormatStreamReadBytes)));
+    const size_t offset = body.length();
+    body.resize(offset + part);
+    if (!is.read(&body[offset], static_cast<std::streamsize>(part))) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Unexpected end of input."));
+    }
+  }
+  LoadBinaryBody(body.data(), body.data() + body.length(), destination);
+}
+
+template <typename T>
+inline T LoadFromBinary(const std::string& source) {
+  T result;
+  LoadFromBinary(source, result);
+  return result;
+}
+
+template <typename T>
+inline T LoadFromBinary(std::istream& is) {
+  T result;
+  LoadFromBinary(is, result);
+  return result;
+}
+
+}  // namespace current::serialization::binary
+}  // namespace current::serialization
+
+// Keep top-level symbols both in `current::` and in global namespace.
+using serialization::binary::SaveIntoBinary;
+using serialization::binary::LoadFromBinary;
+using serialization::binary::TypeSystemParseBinaryException;
+using serialization::binary::BinaryLoadFromStreamException;
+using serialization::binary::BinarySchemaMismatchException;
+using serialization::binary::BinaryUninitializedVariantObjectException;
+}  // namespace current
+
+using current::SaveIntoBinary;
+using current::LoadFromBinary;
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_BINARY_H
@@ -0,0 +1,83 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_MAP_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_MAP_H
+
+#include <map>
+#include <unordered_map>
+
+#include "primitives.h"
+
+namespace current {
+namespace serialization {
+
+namespace binary {
+template <class MAP>
+struct SerializeMapImpl {
+  static void DoSerialize(BinarySerializer& serializer, const MAP& value) {
+    serializer.Varint(value.size());
+    for (const auto& element : value) {
+      Serialize(serializer, element.first);
+      Serialize(serializer, element.second);
+    }
+  }
+};
+
+template <class MAP>
+struct DeserializeMapImpl {
+  static void DoDeserialize(BinaryDeserializer& deserializer, MAP& destination) {
+    const size_t size = CheckedIntegerCast<size_t>(deserializer.Varint());
+    destination.clear();
+    for (size_t i = 0u; i < size; ++i) {
+      typename MAP::key_type k;
+      typename MAP::mapped_type v;
+      Deserialize(deserializer, k);
+      Deserialize(deserializer, v);
+      destination.emplace(std::move(k), std::move(v));
+    }
+  }
+};
+}  // namespace current::serialization::binary
+
+template <typename TK, typename TV, typename TC, typename TA>
+struct SerializeImpl<binary::BinarySerializer, std::map<TK, TV, TC, TA>>
+    : binary::SerializeMapImpl<std::map<TK, TV, TC, TA>> {};
+
+template <typename TK, typename TV, typename TC, typename TA>
+struct DeserializeImpl<binary::BinaryDeserializer, std::map<TK, TV, TC, TA>>
+    : binary::DeserializeMapImpl<std::map<TK, TV, TC, TA>> {};
+
+template <typename TK, typename TV, typename TH, typename TE, typename TA>
+struct SerializeImpl<binary::BinarySerializer, std::unordered_map<TK, TV, TH, TE, TA>>
+    : binary::SerializeMapImpl<std::unordered_map<TK, TV, TH, TE, TA>> {};
+
+template <typename TK, typename TV, typename TH, typename TE, typename TA>
+struct DeserializeImpl<binary::BinaryDeserializer, std::unordered_map<TK, TV, TH, TE, TA>>
+    : binary::DeserializeMapImpl<std::unordered_map<TK, TV, TH, TE, TA>> {};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_MAP_H
@@ -0,0 +1,196 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_PRIMITIVES_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_PRIMITIVES_H
+
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "binary.h"
+
+namespace current {
+namespace serialization {
+
+namespace binary {
+template <typename T>
+constexpr static bool IsOneByteInteger() {
+  return std::is_integral_v<T> && sizeof(T) == 1u && !std::is_same_v<T, bool>;
+}
+
+template <typename T>
+constexpr static bool IsVarintInteger() {
+  return std::is_integral_v<T> && sizeof(T) > 1u;
+}
+
+template <typename T>
+inline T CheckedIntegerCast(uint64_t value) {
+  if (value > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+    CURRENT_THROW(BinaryLoadFromStreamException("Integer out of range."));
+  }
+  return static_cast<T>(value);
+}
+
+template <typename T>
+inline T CheckedIntegerCast(int64_t value) {
+  if (value < static_cast<int64_t>(std::numeric_limits<T>::min()) ||
+      value > static_cast<int64_t>(std::numeric_limits<T>::max())) {
+    CURRENT_THROW(BinaryLoadFromStreamException("Integer out of range."));
+  }
+  return static_cast<T>(value);
+}
+}  // namespace current::serialization::binary
+
+// `bool`.
+template <>
+struct SerializeImpl<binary::BinarySerializer, bool> {
+  static void DoSerialize(binary::BinarySerializer& serializer, bool value) { serializer.Byte(value ? 1u : 0u); }
+};
+
+template <>
+struct DeserializeImpl<binary::BinaryDeserializer, bool> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, bool& destination) {
+    const uint8_t byte = deserializer.Byte();
+    if (byte > 1u) {
+      CURRENT_THROW(BinaryLoadFromStreamException("Malformed boolean."));
+    }
+    destination = (byte != 0u);
+  }
+};
+
+// `char`, `int8_t`, and `uint8_t`.
+template <typename T>
+struct SerializeImpl<binary::BinarySerializer, T, std::enable_if_t<binary::IsOneByteInteger<T>()>> {
+  static void DoSerialize(binary::BinarySerializer& serializer, T value) {
+    serializer.Byte(static_cast<uint8_t>(value));
+  }
+};
+
+template <typename T>
+struct DeserializeImpl<binary::BinaryDeserializer, T, std::enable_if_t<binary::IsOneByteInteger<T>()>> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, T& destination) {
+    destination = static_cast<T>(deserializer.Byte());
+  }
+};
+
+// `uint*_t` and `int*_t`.
+template <typename T>
+struct SerializeImpl<binary::BinarySerializer, T, std::enable_if_t<binary::IsVarintInteger<T>()>> {
+  static void DoSerialize(binary::BinarySerializer& serializer, T value) {
+    if constexpr (std::is_signed_v<T>) {
+      serializer.SignedVarint(static_cast<int64_t>(value));
+    } else {
+      serializer.Varint(static_cast<uint64_t>(value));
+    }
+  }
+};
+
+template <typename T>
+struct DeserializeImpl<binary::BinaryDeserializer, T, std::enable_if_t<binary::IsVarintInteger<T>()>> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, T& destination) {
+    if constexpr (std::is_signed_v<T>) {
+      destination = binary::CheckedIntegerCast<T>(deserializer.SignedVarint());
+    } else {
+      destination = binary::CheckedIntegerCast<T>(deserializer.Varint());
+    }
+  }
+};
+
+// `float`.
+template <>
+struct SerializeImpl<binary::BinarySerializer, float> {
+  static void DoSerialize(binary::BinarySerializer& serializer, float value) {
+    static_assert(sizeof(float) == sizeof(uint32_t), "");
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    serializer.Fixed(bits);
+  }
+};
+
+template <>
+struct DeserializeImpl<binary::BinaryDeserializer, float> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, float& destination) {
+    const uint32_t bits = deserializer.Fixed<uint32_t>();
+    std::memcpy(&destination, &bits, sizeof(bits));
+  }
+};
+
+// `double`.
+template <>
+struct SerializeImpl<binary::BinarySerializer, double> {
+  static void DoSerialize(binary::BinarySerializer& serializer, double value) {
+    static_assert(sizeof(double) == sizeof(uint64_t), "");
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    serializer.Fixed(bits);
+  }
+};
+
+template <>
+struct DeserializeImpl<binary::BinaryDeserializer, double> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, double& destination) {
+    const uint64_t bits = deserializer.Fixed<uint64_t>();
+    std::memcpy(&destination, &bits, sizeof(bits));
+  }
+};
+
+// `std::string`.
+template <>
+struct SerializeImpl<binary::BinarySerializer, std::string> {
+  static void DoSerialize(binary::BinarySerializer& serializer, const std::string& value) {
+    serializer.Varint(value.length());
+    serializer.Bytes(value.data(), value.length());
+  }
+};
+
+template <>
+struct DeserializeImpl<binary::BinaryDeserializer, std::string> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, std::string& destination) {
+    const size_t length = binary::CheckedIntegerCast<size_t>(deserializer.Varint());
+    destination.assign(deserializer.Bytes(length), length);
+  }
+};
+
+// `std::chrono::microseconds` and `std::chrono::milliseconds`.
+template <typename REP, typename PERIOD>
+struct SerializeImpl<binary::BinarySerializer, std::chrono::duration<REP, PERIOD>> {
+  static void DoSerialize(binary::BinarySerializer& serializer, std::chrono::duration<REP, PERIOD> value) {
+    serializer.SignedVarint(static_cast<int64_t>(value.count()));
+  }
+};
+
+template <typename REP, typename PERIOD>
+struct DeserializeImpl<binary::BinaryDeserializer, std::chrono::duration<REP, PERIOD>> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, std::chrono::duration<REP, PERIOD>& destination) {
+    destination = std::chrono::duration<REP, PERIOD>(binary::CheckedIntegerCast<REP>(deserializer.SignedVarint()));
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_PRIMITIVES_H
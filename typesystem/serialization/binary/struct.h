@@ -0,0 +1,118 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_STRUCT_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_STRUCT_H
+
+#include <type_traits>
+
+#include "binary.h"
+
+#include "../../reflection/reflection.h"
+
+namespace current {
+namespace serialization {
+
+namespace binary {
+// The fields are written in the order of their declaration, with no names, as the schema fingerprint covers them.
+class BinaryStructFieldsSerializer {
+ public:
+  explicit BinaryStructFieldsSerializer(BinarySerializer& serializer) : serializer_(serializer) {}
+
+  template <typename U>
+  void operator()(const char*, const U& source) const {
+    Serialize(serializer_, source);
+  }
+
+ private:
+  BinarySerializer& serializer_;
+};
+
+template <typename T>
+struct SerializeStructImpl {
+  static void SerializeStruct(BinaryStructFieldsSerializer& visitor, const T& source) {
+    using decayed_t = current::decay_t<T>;
+    using super_t = current::reflection::SuperType<decayed_t>;
+
+    SerializeStructImpl<super_t>::SerializeStruct(visitor, source);
+
+    current::reflection::VisitAllFields<decayed_t, current::reflection::FieldNameAndImmutableValue>::WithObject(
+        source, visitor);
+  }
+};
+
+template <>
+struct SerializeStructImpl<CurrentStruct> {
+  static void SerializeStruct(BinaryStructFieldsSerializer&, const CurrentStruct&) {}
+};
+}  // namespace current::serialization::binary
+
+template <typename T>
+struct SerializeImpl<binary::BinarySerializer,
+                     T,
+                     std::enable_if_t<IS_CURRENT_STRUCT(T) && !std::is_same_v<T, CurrentStruct>>> {
+  static void DoSerialize(binary::BinarySerializer& serializer, const T& value) {
+    binary::BinaryStructFieldsSerializer visitor(serializer);
+    binary::SerializeStructImpl<T>::SerializeStruct(visitor, value);
+  }
+};
+
+template <>
+struct DeserializeImpl<binary::BinaryDeserializer, CurrentStruct> {
+  static void DoDeserialize(binary::BinaryDeserializer&, CurrentStruct&) {}
+};
+
+template <typename T>
+struct DeserializeImpl<binary::BinaryDeserializer,
+                       T,
+                       std::enable_if_t<IS_CURRENT_STRUCT(T) && !std::is_same_v<T, CurrentStruct>>> {
+  class DeserializeSingleField {
+   public:
+    explicit DeserializeSingleField(binary::BinaryDeserializer& deserializer) : deserializer_(deserializer) {}
+
+    template <typename U>
+    void operator()(const char*, U& value) const {
+      Deserialize(deserializer_, value);
+    }
+
+   private:
+    binary::BinaryDeserializer& deserializer_;
+  };
+
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, T& destination) {
+    using decayed_t = current::decay_t<T>;
+    using super_t = current::reflection::SuperType<decayed_t>;
+
+    if (!std::is_same_v<super_t, CurrentStruct>) {
+      Deserialize(deserializer, static_cast<super_t&>(destination));
+    }
+    current::reflection::VisitAllFields<decayed_t, current::reflection::FieldNameAndMutableValue>::WithObject(
+        destination, DeserializeSingleField(deserializer));
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_STRUCT_H
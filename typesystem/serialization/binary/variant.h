@@ -0,0 +1,152 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VARIANT_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VARIANT_H
+
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+
+#include "primitives.h"
+
+#include "../../variant.h"
+#include "../../reflection/reflection.h"
+
+#include "../../../bricks/template/call_all_constructors.h"
+
+// Binary format for `Variant` objects: the type ID of the case, as eight bytes, followed by the case itself.
+// The type ID is the same as the one in the JSON format, so it does not depend on the order of the cases,
+// and the empty `Variant` is saved as `TypeID::UninitializedType`, which throws when loaded, as `null` does in JSON.
+
+namespace current {
+namespace serialization {
+
+namespace binary {
+
+// Computed once per type, as `BinarySchemaFingerprint()` is.
+template <typename X>
+reflection::TypeID BinaryVariantCaseTypeID() {
+  static const reflection::TypeID type_id =
+      Value<reflection::ReflectedTypeBase>(reflection::Reflector().ReflectType<X>()).type_id;
+  return type_id;
+}
+
+class BinaryVariantSerializer {
+ public:
+  explicit BinaryVariantSerializer(BinarySerializer& serializer) : serializer_(serializer) {}
+
+  template <typename X>
+  std::enable_if_t<IS_CURRENT_STRUCT_OR_VARIANT(X)> operator()(const X& object) {
+    serializer_.Fixed(static_cast<uint64_t>(BinaryVariantCaseTypeID<X>()));
+    Serialize(serializer_, object);
+  }
+
+ private:
+  BinarySerializer& serializer_;
+};
+
+class BinaryVariantCaseAbstractBase {
+ public:
+  virtual ~BinaryVariantCaseAbstractBase() = default;
+  virtual void Deserialize(BinaryDeserializer& deserializer, IHasUncheckedMoveFromUniquePtr& destination) const = 0;
+};
+
+template <typename T>
+class BinaryVariantCase : public BinaryVariantCaseAbstractBase {
+ public:
+  void Deserialize(BinaryDeserializer& deserializer, IHasUncheckedMoveFromUniquePtr& destination) const override {
+    auto result = std::make_unique<T>();
+    ::current::serialization::Deserialize(deserializer, *result);
+    destination.UncheckedMoveFromUniquePtr(std::move(result));
+  }
+};
+
+template <typename VARIANT>
+class BinaryVariantDeserializer {
+ public:
+  using deserializers_map_t = std::unordered_map<reflection::TypeID,
+                                                 std::unique_ptr<BinaryVariantCaseAbstractBase>,
+                                                 GenericHashFunction<::current::reflection::TypeID>>;
+
+  template <typename X>
+  struct Registerer {
+    Registerer(deserializers_map_t& deserializers) {
+      // Silently discard duplicate types in the input type list. They would be deserialized correctly.
+      deserializers[BinaryVariantCaseTypeID<X>()] = std::make_unique<BinaryVariantCase<X>>();
+    }
+  };
+
+  BinaryVariantDeserializer() {
+    current::metaprogramming::call_all_constructors_with<Registerer, deserializers_map_t, typename VARIANT::typelist_t>(
+        deserializers_);
+  }
+
+  void DoLoadVariant(BinaryDeserializer& deserializer, VARIANT& destination) const {
+    const auto type_id = static_cast<reflection::TypeID>(deserializer.Fixed<uint64_t>());
+    if (type_id == reflection::TypeID::UninitializedType) {
+      CURRENT_THROW(BinaryUninitializedVariantObjectException());
+    }
+    const auto cit = deserializers_.find(type_id);
+    if (cit != deserializers_.end()) {
+      cit->second->Deserialize(deserializer, destination);
+    } else {
+      CURRENT_THROW(BinarySchemaMismatchException("Expected a type ID listed in the type list of the variant."));
+    }
+  }
+
+  static const BinaryVariantDeserializer& Instance() {
+    static BinaryVariantDeserializer impl;
+    return impl;
+  }
+
+ private:
+  deserializers_map_t deserializers_;
+};
+
+}  // namespace current::serialization::binary
+
+template <typename T>
+struct SerializeImpl<binary::BinarySerializer, T, std::enable_if_t<IS_CURRENT_VARIANT(T)>> {
+  static void DoSerialize(binary::BinarySerializer& serializer, const T& value) {
+    if (Exists(value)) {
+      binary::BinaryVariantSerializer impl(serializer);
+      value.Call(impl);
+    } else {
+      serializer.Fixed(static_cast<uint64_t>(reflection::TypeID::UninitializedType));
+    }
+  }
+};
+
+template <typename T>
+struct DeserializeImpl<binary::BinaryDeserializer, T, std::enable_if_t<IS_CURRENT_VARIANT(T)>> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, T& value) {
+    binary::BinaryVariantDeserializer<T>::Instance().DoLoadVariant(deserializer, value);
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VARIANT_H
@@ -0,0 +1,87 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 Maxim Zhurovich <zhurovich@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VECTOR_H
+#define CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VECTOR_H
+
+#include <algorithm>
+#include <vector>
+
+#include "primitives.h"
+
+namespace current {
+namespace serialization {
+
+template <typename T, typename TA>
+struct SerializeImpl<binary::BinarySerializer, std::vector<T, TA>> {
+  static void DoSerialize(binary::BinarySerializer& serializer, const std::vector<T, TA>& value) {
+    serializer.Varint(value.size());
+    for (const auto& element : value) {
+      Serialize(serializer, element);
+    }
+  }
+};
+
+template <typename TA>
+struct SerializeImpl<binary::BinarySerializer, std::vector<bool, TA>> {
+  static void DoSerialize(binary::BinarySerializer& serializer, const std::vector<bool, TA>& value) {
+    serializer.Varint(value.size());
+    for (const bool element : value) {
+      Serialize(serializer, element);
+    }
+  }
+};
+
+// The size is not trusted for the allocation, as it comes from the input: the vector grows as the elements are read.
+template <typename T, typename TA>
+struct DeserializeImpl<binary::BinaryDeserializer, std::vector<T, TA>> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, std::vector<T, TA>& destination) {
+    const size_t size = binary::CheckedIntegerCast<size_t>(deserializer.Varint());
+    destination.clear();
+    destination.reserve(std::min(size, deserializer.BytesLeft()));
+    for (size_t i = 0u; i < size; ++i) {
+      destination.emplace_back();
+      Deserialize(deserializer, destination.back());
+    }
+  }
+};
+
+template <typename TA>
+struct DeserializeImpl<binary::BinaryDeserializer, std::vector<bool, TA>> {
+  static void DoDeserialize(binary::BinaryDeserializer& deserializer, std::vector<bool, TA>& destination) {
+    const size_t size = binary::CheckedIntegerCast<size_t>(deserializer.Varint());
+    destination.clear();
+    destination.reserve(std::min(size, deserializer.BytesLeft()));
+    for (size_t i = 0u; i < size; ++i) {
+      bool element;
+      Deserialize(deserializer, element);
+      destination.push_back(element);
+    }
+  }
+};
+
+}  // namespace current::serialization
+}  // namespace current
+
+#endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_BINARY_VECTOR_H
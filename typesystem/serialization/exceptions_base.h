@@ -49,6 +49,26 @@ struct JSONUninitializedVariantObjectException : TypeSystemParseJSONException {}
 
 }  // namepsace current::serialization::json
 
+namespace binary {
+
+struct TypeSystemParseBinaryException : Exception {
+  using Exception::Exception;
+};
+
+// The input is truncated, or is not the binary format at all.
+struct BinaryLoadFromStreamException : TypeSystemParseBinaryException {
+  using TypeSystemParseBinaryException::TypeSystemParseBinaryException;
+};
+
+// The input has been saved from a type with a different schema.
+struct BinarySchemaMismatchException : TypeSystemParseBinaryException {
+  using TypeSystemParseBinaryException::TypeSystemParseBinaryException;
+};
+
+struct BinaryUninitializedVariantObjectException : TypeSystemParseBinaryException {};
+
+}  // namespace current::serialization::binary
+
 }  // namespace current::serialization
 }  // namespace current
 
@@ -57,4 +77,9 @@ using current::serialization::json::TypeSystemParseJSONException;
 using current::serialization::json::RapidJSONAssertionFailedException;
 using current::serialization::json::JSONUninitializedVariantObjectException;
 
+using current::serialization::binary::TypeSystemParseBinaryException;
+using current::serialization::binary::BinaryLoadFromStreamException;
+using current::serialization::binary::BinarySchemaMismatchException;
+using current::serialization::binary::BinaryUninitializedVariantObjectException;
+
 #endif  // TYPE_SYSTEM_SERIALIZATION_EXCEPTIONS_BASE_H
@@ -63,6 +63,31 @@ struct DeserializeImpl<json::JSONParser<JSON_FORMAT>, T, std::enable_if_t<std::i
   }
 };
 
+template <class JSON_FORMAT, typename T>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, T, std::enable_if_t<std::is_enum_v<T>>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier, const T enum_value) {
+    Serialize(json_stringifier, static_cast<typename std::underlying_type<T>::type>(enum_value));
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, T, std::enable_if_t<std::is_enum_v<T>>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, T& destination) {
+    const rapidjson::Value& number = json_parser.Number();
+    if (std::numeric_limits<typename std::underlying_type<T>::type>::is_signed) {
+      if (!number.IsInt64()) {
+        json_parser.Fallback();
+      }
+      destination = static_cast<T>(number.GetInt64());
+    } else {
+      if (!number.IsUint64()) {
+        json_parser.Fallback();
+      }
+      destination = static_cast<T>(number.GetUint64());
+    }
+  }
+};
+
 }  // namespace current::serialization
 }  // namespace current
 
@@ -26,6 +26,8 @@ SOFTWARE.
 #ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_JSON_H
 #define CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_JSON_H
 
+#include <cstring>
+
 #include "exceptions.h"
 #include "rapidjson.h"
 
@@ -323,19 +325,389 @@ class JSONParser final {
   rapidjson::Document document_;
 };
 
+// Thrown by the streaming stringifier and parser on whatever they leave to their DOM-based counterparts: the input
+// the streaming parser does not handle itself, malformed or merely unusual, and the output of non-finite numbers.
+// Never escapes `JSON()` or `ParseJSON()`, which then redo the job via RapidJSON DOM, reporting the errors, if any.
+struct JSONStreamingFallback {};
+
+// The streaming counterpart of `JSONStringifier`: writes the JSON straight into the output string, with no DOM built.
+// The output is byte-identical to that of `JSONStringifier`, followed by `rapidjson::Writer`, in every `JSONFormat`.
+template <class JSON_FORMAT>
+class JSONStreamingStringifier final {
+ public:
+  explicit JSONStreamingStringifier(std::string& output) : output_(output) {}
+
+  std::string& Output() { return output_; }
+
+  void Null() { output_.append("null", 4u); }
+  void Bool(bool value) { value ? output_.append("true", 4u) : output_.append("false", 5u); }
+
+  void Int64(int64_t value) {
+    char buffer[21];
+    output_.append(buffer, rapidjson::internal::i64toa(value, buffer));
+  }
+
+  void Uint64(uint64_t value) {
+    char buffer[20];
+    output_.append(buffer, rapidjson::internal::u64toa(value, buffer));
+  }
+
+  void Double(double value) {
+    if (rapidjson::internal::Double(value).IsNanOrInf()) {
+      // `rapidjson::Writer` gives up on these midway, and the output of `JSON()` is what it has written so far.
+      throw JSONStreamingFallback();
+    }
+    char buffer[25];
+    output_.append(buffer, rapidjson::internal::dtoa(value, buffer, kMaxDecimalPlaces));
+  }
+
+  // Escapes what `rapidjson::Writer` does: the quote, the backslash, and the control characters.
+  void String(const char* s, size_t length) {
+    output_ += '"';
+    const char* const end = s + length;
+    const char* unescaped = s;
+    for (const char* p = s; p != end; ++p) {
+      const unsigned char c = static_cast<unsigned char>(*p);
+      if (c < 0x20 || c == '"' || c == '\\') {
+        output_.append(unescaped, p);
+        AppendEscaped(c);
+        unescaped = p + 1;
+      }
+    }
+    output_.append(unescaped, end);
+    output_ += '"';
+  }
+  void String(const std::string& s) { String(s.data(), s.length()); }
+
+  // Serialize another object, as the value of the array element, of the map entry, or of the whole JSON.
+  template <typename T>
+  void Inner(T&& x) {
+    Serialize(*this, std::forward<T>(x));
+    if (absent_) {
+      absent_ = false;
+      Null();
+    }
+  }
+
+  // The value which may end up a no-op, such as a `Variant` or an `Optional` in the `Minimalistic` format, marks itself
+  // as absent instead of writing anything, for the struct to omit the field, and for everything else to write `null`.
+  void MarkAsAbsentValue() { absent_ = true; }
+
+  // Serialize the field of the struct, with `key` being its name quoted and followed by the colon, and preceded by
+  // the comma unless it is the first field written, or write nothing if the value is absent.
+  template <typename T>
+  void Field(bool& first, const std::string& key, T&& x) {
+    const size_t rollback = output_.length();
+    if (!first) {
+      output_ += ',';
+    }
+    output_.append(key);
+    Serialize(*this, std::forward<T>(x));
+    if (absent_) {
+      absent_ = false;
+      output_.resize(rollback);
+    } else {
+      first = false;
+    }
+  }
+
+ private:
+  void AppendEscaped(unsigned char c) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    output_ += '\\';
+    switch (c) {
+      case '"':
+      case '\\':
+        output_ += static_cast<char>(c);
+        break;
+      case '\b':
+        output_ += 'b';
+        break;
+      case '\f':
+        output_ += 'f';
+        break;
+      case '\n':
+        output_ += 'n';
+        break;
+      case '\r':
+        output_ += 'r';
+        break;
+      case '\t':
+        output_ += 't';
+        break;
+      default:
+        output_.append("u00", 3u);
+        output_ += hex_digits[c >> 4];
+        output_ += hex_digits[c & 0xf];
+    }
+  }
+
+  constexpr static int kMaxDecimalPlaces = rapidjson::Writer<rapidjson::StringBuffer>::kDefaultMaxDecimalPlaces;
+
+  std::string& output_;
+  bool absent_ = false;
+};
+
+// The streaming counterpart of `JSONParser`: fills the object straight from the input, with no DOM built.
+// Only the scalars the hand-written scanner below does not handle on its own, such as the strings with escape
+// sequences or the floating point numbers, are parsed by `rapidjson::Reader`, to keep their semantics exactly the same.
+// On any input which is not handled here, the parser throws `JSONStreamingFallback`, leaving it to `JSONParser`.
+template <class JSON_FORMAT>
+class JSONStreamingParser final {
+ public:
+  explicit JSONStreamingParser(const char* json) : json_(json) {}
+
+  [[noreturn]] static void Fallback() { throw JSONStreamingFallback(); }
+
+  // The next character of the input after the whitespace, which is what RapidJSON treats as whitespace too.
+  char Peek() {
+    while (*json_ == ' ' || *json_ == '\n' || *json_ == '\r' || *json_ == '\t') {
+      ++json_;
+    }
+    return *json_;
+  }
+
+  bool TryConsume(char c) {
+    if (Peek() == c) {
+      ++json_;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  void Expect(char c) {
+    if (!TryConsume(c)) {
+      Fallback();
+    }
+  }
+
+  void ExpectEnd() {
+    if (Peek() != '\0') {
+      Fallback();
+    }
+  }
+
+  bool TryNull() {
+    if (Peek() == 'n' && !std::strncmp(json_, "null", 4u)) {
+      json_ += 4;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  bool Bool() {
+    if (Peek() == 't' && !std::strncmp(json_, "true", 4u)) {
+      json_ += 4;
+      return true;
+    } else if (*json_ == 'f' && !std::strncmp(json_, "false", 5u)) {
+      json_ += 5;
+      return false;
+    } else {
+      Fallback();
+    }
+  }
+
+  // The contents of the string, which is next in the input, without the quotes. Unless the string has escape
+  // sequences, the returned pointer is into the input itself, and `storage` is only used for the unescaped string.
+  const char* StringView(size_t& length, std::string& storage) {
+    if (Peek() != '"') {
+      Fallback();
+    }
+    const char* const begin = json_ + 1;
+    for (const char* p = begin;; ++p) {
+      const unsigned char c = static_cast<unsigned char>(*p);
+      if (c == '"') {
+        length = static_cast<size_t>(p - begin);
+        json_ = p + 1;
+        return begin;
+      } else if (c == '\\' || c < 0x20) {
+        break;
+      }
+    }
+    StringHandler handler(storage);
+    ParseWithRapidJSON(handler);
+    length = storage.length();
+    return storage.data();
+  }
+
+  void String(std::string& destination) {
+    size_t length;
+    const char* s = StringView(length, destination);
+    if (s != destination.data()) {
+      destination.assign(s, length);
+    }
+  }
+
+  // The number, which is next in the input, as the very `rapidjson::Value` the DOM-based parser would have made of it.
+  // The integers of up to 18 digits, which RapidJSON parses as integers too, are parsed right here.
+  const rapidjson::Value& Number() {
+    const bool negative = (Peek() == '-');
+    const char* p = negative ? json_ + 1 : json_;
+    const char* const digits = p;
+    uint64_t value = 0u;
+    while (*p >= '0' && *p <= '9' && p - digits < 18) {
+      value = value * 10u + static_cast<uint64_t>(*p++ - '0');
+    }
+    if (p == digits) {
+      Fallback();
+    }
+    if ((*p < '0' || *p > '9') && *p != '.' && *p != 'e' && *p != 'E' && (*digits != '0' || p - digits == 1)) {
+      number_.SetInt64(negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value));
+      json_ = p;
+    } else {
+      NumberHandler handler(number_);
+      ParseWithRapidJSON(handler);
+    }
+    return number_;
+  }
+
+  // Skips the value of the unknown key, still making sure it is valid JSON, as the DOM-based parser would.
+  void SkipValue() {
+    rapidjson::BaseReaderHandler<> handler;
+    ParseWithRapidJSON(handler);
+  }
+
+  template <size_t N>
+  static bool KeyIs(const char* key, size_t length, const char (&expected)[N]) {
+    return length == N - 1u && !std::memcmp(key, expected, N - 1u);
+  }
+
+  // Calls `f(key, key_length)` for each member of the object, which is next in the input, with its value next.
+  template <typename F>
+  void ForEachMember(F&& f) {
+    Expect('{');
+    if (TryConsume('}')) {
+      return;
+    }
+    std::string storage;
+    do {
+      size_t length;
+      const char* key = StringView(length, storage);
+      Expect(':');
+      f(key, length);
+    } while (TryConsume(','));
+    Expect('}');
+  }
+
+  // Calls `f()` for each element of the array, which is next in the input, with the element next.
+  template <typename F>
+  void ForEachElement(F&& f) {
+    Expect('[');
+    if (TryConsume(']')) {
+      return;
+    }
+    do {
+      f();
+    } while (TryConsume(','));
+    Expect(']');
+  }
+
+ private:
+  struct StringHandler : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, StringHandler> {
+    std::string& destination;
+    explicit StringHandler(std::string& destination) : destination(destination) {}
+    bool String(const char* s, rapidjson::SizeType length, bool) {
+      destination.assign(s, length);
+      return true;
+    }
+    bool Default() { return false; }
+  };
+
+  struct NumberHandler : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, NumberHandler> {
+    rapidjson::Value& destination;
+    explicit NumberHandler(rapidjson::Value& destination) : destination(destination) {}
+    bool Int(int i) {
+      destination.SetInt(i);
+      return true;
+    }
+    bool Uint(unsigned u) {
+      destination.SetUint(u);
+      return true;
+    }
+    bool Int64(int64_t i) {
+      destination.SetInt64(i);
+      return true;
+    }
+    bool Uint64(uint64_t u) {
+      destination.SetUint64(u);
+      return true;
+    }
+    bool Double(double d) {
+      destination.SetDouble(d);
+      return true;
+    }
+    bool Default() { return false; }
+  };
+
+  template <typename HANDLER>
+  void ParseWithRapidJSON(HANDLER& handler) {
+    rapidjson::StringStream stream(json_);
+    if (reader_.Parse<rapidjson::kParseStopWhenDoneFlag>(stream, handler).IsError()) {
+      Fallback();
+    }
+    json_ += stream.Tell();
+  }
+
+  const char* json_;
+  rapidjson::Value number_;
+  rapidjson::Reader reader_;
+};
+
+// Handles the field missing from the input for the streaming parser. Only `Optional`-s, and `Variant`-s in the styles
+// with no nulls, can be missing, as `JSONParser` would throw otherwise.
+template <class JSON_FORMAT, typename T, typename ENABLE = void>
+struct JSONStreamingMissingValue {
+  static void Apply(T&) { JSONStreamingParser<JSON_FORMAT>::Fallback(); }
+};
+
 template <class J, typename T>
 void ParseJSONViaRapidJSON(const char* json, T& destination) {
   JSONParser<J> json_parser(json);
   Deserialize(json_parser, destination);
 }
 
-template <class J = JSONFormat::Current, typename T>
-inline std::string JSON(const T& source) {
+// Parses the JSON with the streaming parser, or, should it give up, with RapidJSON DOM. The streaming parser only
+// writes into `destination` what the DOM-based one would write there too, so it is fine for the latter to start over.
+template <class J, typename T>
+void ParseJSONViaStreamingParser(const char* json, T& destination) {
+  try {
+    JSONStreamingParser<J> json_parser(json);
+    Deserialize(json_parser, destination);
+    json_parser.ExpectEnd();
+  } catch (const JSONStreamingFallback&) {
+    ParseJSONViaRapidJSON<J>(json, destination);
+  }
+}
+
+template <class J, typename T>
+inline std::string JSONViaRapidJSON(const T& source) {
   JSONStringifier<J> json_stringifier;
   Serialize(json_stringifier, source);
   return json_stringifier.ResultingJSON();
 }
 
+// Appends the JSON to `output`, which can thus be reused across calls, saving on memory allocations.
+template <class J = JSONFormat::Current, typename T>
+inline void AppendJSON(std::string& output, const T& source) {
+  const size_t length = output.length();
+  try {
+    JSONStreamingStringifier<J> json_stringifier(output);
+    json_stringifier.Inner(source);
+  } catch (const JSONStreamingFallback&) {
+    output.resize(length);
+    output.append(JSONViaRapidJSON<J>(source));
+  }
+}
+
+template <class J = JSONFormat::Current, typename T>
+inline std::string JSON(const T& source) {
+  std::string result;
+  AppendJSON<J>(result, source);
+  return result;
+}
+
 template <class J = JSONFormat::Current>
 inline std::string JSON(const char* special_case_bare_c_string) {
   return JSON<J>(std::string(special_case_bare_c_string));
@@ -344,7 +716,7 @@ inline std::string JSON(const char* special_case_bare_c_string) {
 template <typename T, class J = JSONFormat::Current>
 inline void ParseJSON(const char* source, T& destination) {
   try {
-    ParseJSONViaRapidJSON<J>(source, destination);
+    ParseJSONViaStreamingParser<J>(source, destination);
     CheckIntegrity(destination);
   } catch (UninitializedVariant) {
     CURRENT_THROW(JSONUninitializedVariantObjectException());
@@ -425,6 +797,7 @@ inline Optional<T> TryParseJSON(const strings::Chunk& source) {
 
 // Keep top-level symbols both in `current::` and in global namespace.
 using serialization::json::JSON;
+using serialization::json::AppendJSON;
 using serialization::json::ParseJSON;
 using serialization::json::TryParseJSON;
 using serialization::json::PatchObjectWithJSON;
@@ -436,6 +809,7 @@ using serialization::json::JSONUninitializedVariantObjectException;
 }  // namespace current
 
 using current::JSON;
+using current::AppendJSON;
 using current::ParseJSON;
 using current::TryParseJSON;
 using current::PatchObjectWithJSON;
@@ -112,6 +112,76 @@ struct DeserializeImpl<json::JSONParser<JSON_FORMAT>, std::map<TK, TV, TC, TA>,
   }
 };
 
+template <class JSON_FORMAT, typename TK, typename TV, typename TC, typename TA>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, std::map<TK, TV, TC, TA>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier,
+                          const std::map<TK, TV, TC, TA>& value) {
+    json_stringifier.Output() += '[';
+    bool first = true;
+    for (const auto& element : value) {
+      json_stringifier.Output().append(first ? "[" : ",[", first ? 1u : 2u);
+      first = false;
+      json_stringifier.Inner(element.first);
+      json_stringifier.Output() += ',';
+      json_stringifier.Inner(element.second);
+      json_stringifier.Output() += ']';
+    }
+    json_stringifier.Output() += ']';
+  }
+};
+
+template <class JSON_FORMAT, typename TV, typename TC, typename TA>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, std::map<std::string, TV, TC, TA>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier,
+                          const std::map<std::string, TV, TC, TA>& value) {
+    json_stringifier.Output() += '{';
+    bool first = true;
+    for (const auto& element : value) {
+      if (!first) {
+        json_stringifier.Output() += ',';
+      }
+      first = false;
+      json_stringifier.String(element.first);
+      json_stringifier.Output() += ':';
+      json_stringifier.Inner(element.second);
+    }
+    json_stringifier.Output() += '}';
+  }
+};
+
+// As with `JSONParser`, the first of the duplicate keys wins.
+template <class JSON_FORMAT, typename TK, typename TV, typename TC, typename TA>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, std::map<TK, TV, TC, TA>> {
+  template <typename K = TK>
+  static std::enable_if_t<std::is_same_v<std::string, K>> DoDeserialize(
+      json::JSONStreamingParser<JSON_FORMAT>& json_parser, std::map<TK, TV, TC, TA>& destination) {
+    destination.clear();
+    TK k;
+    TV v;
+    json_parser.ForEachMember([&](const char* key, size_t length) {
+      k.assign(key, length);
+      Deserialize(json_parser, v);
+      destination.emplace(std::move(k), std::move(v));
+    });
+  }
+
+  template <typename K = TK>
+  static std::enable_if_t<!std::is_same_v<std::string, K>> DoDeserialize(
+      json::JSONStreamingParser<JSON_FORMAT>& json_parser, std::map<TK, TV, TC, TA>& destination) {
+    destination.clear();
+    json_parser.ForEachElement([&]() {
+      TK k;
+      TV v;
+      json_parser.Expect('[');
+      Deserialize(json_parser, k);
+      json_parser.Expect(',');
+      Deserialize(json_parser, v);
+      json_parser.Expect(']');
+      destination.emplace(std::move(k), std::move(v));
+    });
+  }
+};
+
 namespace json {
 template <typename K, typename V, typename CMP, typename ALLOC>
 struct IsJSONSerializable<std::map<K, V, CMP, ALLOC>> {
@@ -136,6 +136,102 @@ struct DeserializeImpl<json::JSONParser<JSONFormat::NewtonsoftFSharp>, Optional<
   }
 };
 
+template <class JSON_FORMAT, typename T>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, Optional<T>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier, const Optional<T>& value) {
+    if (Exists(value)) {
+      Serialize(json_stringifier, Value(value));
+    } else {
+      json_stringifier.Null();
+    }
+  }
+};
+
+template <typename T>
+struct SerializeImpl<json::JSONStreamingStringifier<json::JSONFormat::Minimalistic>, Optional<T>> {
+  static void DoSerialize(json::JSONStreamingStringifier<json::JSONFormat::Minimalistic>& json_stringifier,
+                          const Optional<T>& value) {
+    if (Exists(value)) {
+      Serialize(json_stringifier, Value(value));
+    } else {
+      json_stringifier.MarkAsAbsentValue();
+    }
+  }
+};
+
+template <typename T>
+struct SerializeImpl<json::JSONStreamingStringifier<json::JSONFormat::NewtonsoftFSharp>, Optional<T>> {
+  static void DoSerialize(json::JSONStreamingStringifier<json::JSONFormat::NewtonsoftFSharp>& json_stringifier,
+                          const Optional<T>& value) {
+    if (Exists(value)) {
+      json_stringifier.Output().append("{\"Case\":\"Some\",\"Fields\":[");
+      json_stringifier.Inner(Value(value));
+      json_stringifier.Output().append("]}");
+    } else {
+      json_stringifier.MarkAsAbsentValue();
+    }
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, Optional<T>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, Optional<T>& destination) {
+    if (json_parser.TryNull()) {
+      destination = nullptr;
+    } else {
+      destination = T();
+      Deserialize(json_parser, Value(destination));
+    }
+  }
+};
+
+// Only `{"Case":"Some","Fields":[value]}` and `{"Case":"None"}`, with the keys in this order, are parsed right away.
+template <typename T>
+struct DeserializeImpl<json::JSONStreamingParser<JSONFormat::NewtonsoftFSharp>, Optional<T>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSONFormat::NewtonsoftFSharp>& json_parser,
+                            Optional<T>& destination) {
+    if (json_parser.TryNull()) {
+      destination = nullptr;
+    } else {
+      bool has_case = false;
+      bool has_fields = false;
+      std::string case_name;
+      json_parser.ForEachMember([&](const char* key, size_t length) {
+        if (json_parser.KeyIs(key, length, "Case") && !has_case) {
+          json_parser.String(case_name);
+          has_case = true;
+        } else if (json_parser.KeyIs(key, length, "Fields") && case_name == "Some" && !has_fields) {
+          size_t count = 0u;
+          json_parser.ForEachElement([&]() {
+            if (count++) {
+              json_parser.Fallback();
+            }
+            destination = T();
+            Deserialize(json_parser, Value(destination));
+          });
+          has_fields = (count == 1u);
+        } else if (json_parser.KeyIs(key, length, "Case") || json_parser.KeyIs(key, length, "Fields")) {
+          json_parser.Fallback();
+        } else {
+          json_parser.SkipValue();
+        }
+      });
+      if (case_name == "None") {
+        destination = nullptr;
+      } else if (!has_fields) {
+        json_parser.Fallback();
+      }
+    }
+  }
+};
+
+namespace json {
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingMissingValue<JSON_FORMAT, Optional<T>> {
+  static void Apply(Optional<T>& destination) { destination = nullptr; }
+};
+}  // namespace json
+
 namespace json {
 template <typename T>
 struct IsJSONSerializable<Optional<T>> {
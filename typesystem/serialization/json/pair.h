@@ -87,6 +87,66 @@ struct DeserializeImpl<json::JSONParser<JSONFormat::NewtonsoftFSharp>, std::pair
   }
 };
 
+template <class JSON_FORMAT, typename TF, typename TS>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, std::pair<TF, TS>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier,
+                          const std::pair<TF, TS>& value) {
+    json_stringifier.Output() += '[';
+    json_stringifier.Inner(value.first);
+    json_stringifier.Output() += ',';
+    json_stringifier.Inner(value.second);
+    json_stringifier.Output() += ']';
+  }
+};
+
+template <typename TF, typename TS>
+struct SerializeImpl<json::JSONStreamingStringifier<json::JSONFormat::NewtonsoftFSharp>, std::pair<TF, TS>> {
+  static void DoSerialize(json::JSONStreamingStringifier<json::JSONFormat::NewtonsoftFSharp>& json_stringifier,
+                          const std::pair<TF, TS>& value) {
+    json_stringifier.Output().append("{\"Item1\":");
+    json_stringifier.Inner(value.first);
+    json_stringifier.Output().append(",\"Item2\":");
+    json_stringifier.Inner(value.second);
+    json_stringifier.Output() += '}';
+  }
+};
+
+template <class JSON_FORMAT, typename TF, typename TS>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, std::pair<TF, TS>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, std::pair<TF, TS>& destination) {
+    json_parser.Expect('[');
+    Deserialize(json_parser, destination.first);
+    json_parser.Expect(',');
+    Deserialize(json_parser, destination.second);
+    json_parser.Expect(']');
+  }
+};
+
+template <typename TF, typename TS>
+struct DeserializeImpl<json::JSONStreamingParser<JSONFormat::NewtonsoftFSharp>, std::pair<TF, TS>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSONFormat::NewtonsoftFSharp>& json_parser,
+                            std::pair<TF, TS>& destination) {
+    bool has_first = false;
+    bool has_second = false;
+    json_parser.ForEachMember([&](const char* key, size_t length) {
+      if (json_parser.KeyIs(key, length, "Item1") && !has_first) {
+        Deserialize(json_parser, destination.first);
+        has_first = true;
+      } else if (json_parser.KeyIs(key, length, "Item2") && !has_second) {
+        Deserialize(json_parser, destination.second);
+        has_second = true;
+      } else if (json_parser.KeyIs(key, length, "Item1") || json_parser.KeyIs(key, length, "Item2")) {
+        json_parser.Fallback();
+      } else {
+        json_parser.SkipValue();
+      }
+    });
+    if (!has_first || !has_second) {
+      json_parser.Fallback();
+    }
+  }
+};
+
 namespace json {
 template <typename F, typename S>
 struct IsJSONSerializable<std::pair<F, S>> {
@@ -176,6 +176,137 @@ struct DeserializeImpl<json::JSONParser<JSON_FORMAT>, std::chrono::microseconds>
   }
 };
 
+// The streaming JSON of primitive types, with the very same number formatting and string escaping as in RapidJSON.
+template <class JSON_FORMAT, typename T>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>,
+                     T,
+                     std::enable_if_t<std::numeric_limits<T>::is_integer && !std::numeric_limits<T>::is_signed &&
+                                      !std::is_same_v<T, bool>>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier, T value) {
+    json_stringifier.Uint64(static_cast<uint64_t>(value));
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>,
+                     T,
+                     std::enable_if_t<std::numeric_limits<T>::is_integer && std::numeric_limits<T>::is_signed>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier, T value) {
+    json_stringifier.Int64(static_cast<int64_t>(value));
+  }
+};
+
+template <class JSON_FORMAT>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, bool> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier, bool value) {
+    json_stringifier.Bool(value);
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>,
+                     T,
+                     std::enable_if_t<std::is_floating_point_v<T>>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier, T value) {
+    json_stringifier.Double(static_cast<double>(value));
+  }
+};
+
+template <class JSON_FORMAT>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, std::string> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier, const std::string& value) {
+    json_stringifier.String(value);
+  }
+};
+
+template <class JSON_FORMAT>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, std::chrono::milliseconds> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier,
+                          std::chrono::milliseconds value) {
+    json_stringifier.Int64(value.count());
+  }
+};
+
+template <class JSON_FORMAT>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, std::chrono::microseconds> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier,
+                          std::chrono::microseconds value) {
+    json_stringifier.Int64(value.count());
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>,
+                       T,
+                       std::enable_if_t<std::numeric_limits<T>::is_integer && !std::numeric_limits<T>::is_signed &&
+                                        !std::is_same_v<T, bool>>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, T& destination) {
+    const rapidjson::Value& number = json_parser.Number();
+    if (!number.IsUint64()) {
+      json_parser.Fallback();
+    }
+    destination = static_cast<T>(number.GetUint64());
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>,
+                       T,
+                       std::enable_if_t<std::numeric_limits<T>::is_integer && std::numeric_limits<T>::is_signed>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, T& destination) {
+    const rapidjson::Value& number = json_parser.Number();
+    if (!number.IsInt64()) {
+      json_parser.Fallback();
+    }
+    destination = static_cast<T>(number.GetInt64());
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, T& destination) {
+    destination = static_cast<T>(json_parser.Number().GetDouble());
+  }
+};
+
+template <class JSON_FORMAT>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, std::string> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, std::string& destination) {
+    json_parser.String(destination);
+  }
+};
+
+template <class JSON_FORMAT>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, bool> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, bool& destination) {
+    destination = json_parser.Bool();
+  }
+};
+
+template <class JSON_FORMAT>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, std::chrono::milliseconds> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser,
+                            std::chrono::milliseconds& destination) {
+    const rapidjson::Value& number = json_parser.Number();
+    if (!number.IsInt64()) {
+      json_parser.Fallback();
+    }
+    destination = std::chrono::milliseconds(number.GetInt64());
+  }
+};
+
+template <class JSON_FORMAT>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, std::chrono::microseconds> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser,
+                            std::chrono::microseconds& destination) {
+    const rapidjson::Value& number = json_parser.Number();
+    if (!number.IsInt64()) {
+      json_parser.Fallback();
+    }
+    destination = std::chrono::microseconds(number.GetInt64());
+  }
+};
+
 }  // namespace current::serialization
 }  // namespace current
 
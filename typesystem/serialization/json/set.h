@@ -64,6 +64,36 @@ struct DeserializeImpl<json::JSONParser<JSON_FORMAT>, std::set<T, EQ, ALLOCATOR>
   }
 };
 
+template <class JSON_FORMAT, typename T, class EQ, class ALLOCATOR>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, std::set<T, EQ, ALLOCATOR>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier,
+                          const std::set<T, EQ, ALLOCATOR>& value) {
+    json_stringifier.Output() += '[';
+    bool first = true;
+    for (const auto& element : value) {
+      if (!first) {
+        json_stringifier.Output() += ',';
+      }
+      first = false;
+      json_stringifier.Inner(element);
+    }
+    json_stringifier.Output() += ']';
+  }
+};
+
+template <class JSON_FORMAT, typename T, class EQ, class ALLOCATOR>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, std::set<T, EQ, ALLOCATOR>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser,
+                            std::set<T, EQ, ALLOCATOR>& destination) {
+    destination.clear();
+    json_parser.ForEachElement([&]() {
+      T element;
+      Deserialize(json_parser, element);
+      destination.insert(std::move(element));
+    });
+  }
+};
+
 namespace json {
 template <typename T, typename CMP, typename ALLOC>
 struct IsJSONSerializable<std::set<T, CMP, ALLOC>> {
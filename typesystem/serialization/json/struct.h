@@ -26,7 +26,10 @@ SOFTWARE.
 #ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_STRUCT_H
 #define CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_STRUCT_H
 
+#include <bitset>
+#include <cstring>
 #include <type_traits>
+#include <vector>
 
 #include "json.h"
 
@@ -132,6 +135,196 @@ struct DeserializeImpl<json::JSONParser<JSON_FORMAT>,
   }
 };
 
+namespace json {
+
+// The number of fields of the struct, including those of its base structs.
+template <typename T>
+struct JSONStreamingStructFieldCount {
+  constexpr static size_t value =
+      reflection::FieldCounter<T>::value + JSONStreamingStructFieldCount<reflection::SuperType<T>>::value;
+};
+
+template <>
+struct JSONStreamingStructFieldCount<CurrentStruct> {
+  constexpr static size_t value = 0u;
+};
+
+// The fields of the struct, including those of its base structs, first, for the streaming parser to look them up by
+// the keys of the input JSON object, which are expected to be in this very order, as `JSON()` outputs them.
+template <class JSON_FORMAT, typename T>
+class JSONStreamingStructFields final {
+ public:
+  using parser_t = JSONStreamingParser<JSON_FORMAT>;
+
+  struct Field final {
+    std::string name;
+    void (*parse)(parser_t&, T&);
+    void (*missing)(T&);
+  };
+
+  constexpr static size_t count = JSONStreamingStructFieldCount<T>::value;
+
+  static const JSONStreamingStructFields& Instance() {
+    static const JSONStreamingStructFields instance;
+    return instance;
+  }
+
+  // The index of the field named `key`, or `count` if there is no such field. The field next to the previous one
+  // is checked first.
+  size_t Find(const char* key, size_t length, size_t next) const {
+    if (next < count && Matches(fields_[next], key, length)) {
+      return next;
+    }
+    for (size_t i = 0u; i < count; ++i) {
+      if (Matches(fields_[i], key, length)) {
+        return i;
+      }
+    }
+    return count;
+  }
+
+  const Field& operator[](size_t i) const { return fields_[i]; }
+
+  // The struct some fields of which share the name, of the derived struct and of its base, is left to `JSONParser`.
+  bool HasDuplicateNames() const { return has_duplicate_names_; }
+
+ private:
+  JSONStreamingStructFields() {
+    AddFields<T>();
+    for (size_t i = 0u; i < count; ++i) {
+      for (size_t j = 0u; j < i; ++j) {
+        if (fields_[i].name == fields_[j].name) {
+          has_duplicate_names_ = true;
+        }
+      }
+    }
+  }
+
+  template <typename S>
+  void AddFields() {
+    using super_t = reflection::SuperType<S>;
+    if constexpr (!std::is_same_v<super_t, CurrentStruct>) {
+      AddFields<super_t>();
+    }
+    AddFieldsImpl<S>(std::make_integer_sequence<int, reflection::FieldCounter<S>::value>());
+  }
+
+  template <typename S, int... IS>
+  void AddFieldsImpl(std::integer_sequence<int, IS...>) {
+    (AddField<S, IS>(), ...);
+  }
+
+  template <typename S, int I>
+  void AddField() {
+    S::CURRENT_REFLECTION(
+        [this](auto, const char* name) { fields_.push_back(Field{name, &Parse<S, I>, &Missing<S, I>}); },
+        reflection::Index<reflection::FieldTypeAndName, I>());
+  }
+
+  template <typename S, int I>
+  static void Parse(parser_t& json_parser, T& destination) {
+    static_cast<S&>(destination)
+        .CURRENT_REFLECTION([&json_parser](const char*, auto& value) { Deserialize(json_parser, value); },
+                            reflection::Index<reflection::FieldNameAndMutableValue, I>());
+  }
+
+  template <typename S, int I>
+  static void Missing(T& destination) {
+    static_cast<S&>(destination)
+        .CURRENT_REFLECTION(
+            [](const char*, auto& value) {
+              JSONStreamingMissingValue<JSON_FORMAT, current::decay_t<decltype(value)>>::Apply(value);
+            },
+            reflection::Index<reflection::FieldNameAndMutableValue, I>());
+  }
+
+  static bool Matches(const Field& field, const char* key, size_t length) {
+    return field.name.length() == length && !std::memcmp(field.name.data(), key, length);
+  }
+
+  std::vector<Field> fields_;
+  bool has_duplicate_names_ = false;
+};
+
+}  // namespace current::serialization::json
+
+template <class JSON_FORMAT, typename T>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>,
+                     T,
+                     std::enable_if_t<IS_CURRENT_STRUCT(T) && !std::is_same_v<T, CurrentStruct>>> {
+  using stringifier_t = json::JSONStreamingStringifier<JSON_FORMAT>;
+
+  template <typename S>
+  static void SerializeFields(stringifier_t& json_stringifier, const S& value, bool& first) {
+    using super_t = reflection::SuperType<S>;
+    if constexpr (!std::is_same_v<super_t, CurrentStruct>) {
+      SerializeFields<super_t>(json_stringifier, value, first);
+    }
+    SerializeFieldsImpl<S>(
+        json_stringifier, value, first, std::make_integer_sequence<int, reflection::FieldCounter<S>::value>());
+  }
+
+  template <typename S, int... IS>
+  static void SerializeFieldsImpl(stringifier_t& json_stringifier,
+                                  const S& value,
+                                  bool& first,
+                                  std::integer_sequence<int, IS...>) {
+    (SerializeField<S, IS>(json_stringifier, value, first), ...);
+  }
+
+  // The name of each field is quoted and followed by the colon once, as it is written into the output.
+  template <typename S, int I>
+  static void SerializeField(stringifier_t& json_stringifier, const S& value, bool& first) {
+    static const std::string key = []() {
+      std::string result;
+      S::CURRENT_REFLECTION([&result](auto, const char* name) { stringifier_t(result).String(name, strlen(name)); },
+                            reflection::Index<reflection::FieldTypeAndName, I>());
+      return result + ':';
+    }();
+    value.CURRENT_REFLECTION([&](const char*, const auto& field) { json_stringifier.Field(first, key, field); },
+                             reflection::Index<reflection::FieldNameAndImmutableValue, I>());
+  }
+
+  static void DoSerialize(stringifier_t& json_stringifier, const T& value) {
+    json_stringifier.Output() += '{';
+    bool first = true;
+    SerializeFields<T>(json_stringifier, value, first);
+    json_stringifier.Output() += '}';
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>,
+                       T,
+                       std::enable_if_t<IS_CURRENT_STRUCT(T) && !std::is_same_v<T, CurrentStruct>>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, T& destination) {
+    using fields_t = json::JSONStreamingStructFields<JSON_FORMAT, T>;
+    const fields_t& fields = fields_t::Instance();
+    if (fields.HasDuplicateNames()) {
+      json_parser.Fallback();
+    }
+    std::bitset<fields_t::count> seen;
+    size_t next = 0u;
+    json_parser.ForEachMember([&](const char* key, size_t length) {
+      const size_t i = fields.Find(key, length, next);
+      if (i == fields_t::count) {
+        json_parser.SkipValue();
+      } else if (seen[i]) {
+        json_parser.Fallback();
+      } else {
+        seen[i] = true;
+        fields[i].parse(json_parser, destination);
+        next = i + 1u;
+      }
+    });
+    for (size_t i = 0u; i < fields_t::count; ++i) {
+      if (!seen[i]) {
+        fields[i].missing(destination);
+      }
+    }
+  }
+};
+
 }  // namespace current::serialization
 }  // namespace current
 
@@ -87,6 +87,42 @@ struct DeserializeImpl<json::JSONParser<JSON_FORMAT>, std::tuple<TS...>> {
   }
 };
 
+template <class JSON_FORMAT, typename... TS>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, std::tuple<TS...>> {
+  template <size_t... IS>
+  static void SerializeElements(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier,
+                                const std::tuple<TS...>& value,
+                                std::index_sequence<IS...>) {
+    ((json_stringifier.Output().append(IS ? "," : ""), json_stringifier.Inner(std::get<IS>(value))), ...);
+  }
+
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier,
+                          const std::tuple<TS...>& value) {
+    json_stringifier.Output() += '[';
+    SerializeElements(json_stringifier, value, std::index_sequence_for<TS...>());
+    json_stringifier.Output() += ']';
+  }
+};
+
+template <class JSON_FORMAT, typename... TS>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, std::tuple<TS...>> {
+  template <size_t... IS>
+  static void DeserializeElements(json::JSONStreamingParser<JSON_FORMAT>& json_parser,
+                                  std::tuple<TS...>& destination,
+                                  std::index_sequence<IS...>) {
+    ((json_parser.Expect(IS ? ',' : '['), Deserialize(json_parser, std::get<IS>(destination))), ...);
+  }
+
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, std::tuple<TS...>& destination) {
+    if (sizeof...(TS)) {
+      DeserializeElements(json_parser, destination, std::index_sequence_for<TS...>());
+    } else {
+      json_parser.Expect('[');
+    }
+    json_parser.Expect(']');
+  }
+};
+
 namespace json {
 template <>
 struct IsJSONSerializable<std::tuple<>> {
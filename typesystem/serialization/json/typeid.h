@@ -55,6 +55,25 @@ struct DeserializeImpl<json::JSONParser<JSON_FORMAT>, reflection::TypeID> {
   }
 };
 
+template <class JSON_FORMAT>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, reflection::TypeID> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier, reflection::TypeID value) {
+    json_stringifier.String("T" + current::ToString(value));
+  }
+};
+
+template <class JSON_FORMAT>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, reflection::TypeID> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, reflection::TypeID& destination) {
+    std::string value;
+    json_parser.String(value);
+    if (value.c_str()[0] != 'T') {
+      json_parser.Fallback();
+    }
+    destination = static_cast<reflection::TypeID>(current::FromString<uint64_t>(value.c_str() + 1));
+  }
+};
+
 namespace json {
 template <>
 struct IsJSONSerializable<reflection::TypeID> {
@@ -26,7 +26,9 @@ SOFTWARE.
 #ifndef CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_VARIANT_H
 #define CURRENT_TYPE_SYSTEM_SERIALIZATION_JSON_VARIANT_H
 
+#include <cstring>
 #include <type_traits>
+#include <vector>
 
 #include "primitives.h"
 #include "typeid.h"
@@ -431,6 +433,314 @@ struct DeserializeImpl<json::JSONParser<JSON_FORMAT>, T, std::enable_if_t<IS_CUR
   }
 };
 
+namespace json {
+
+template <json::JSONVariantStyle, class JSON_FORMAT>
+class JSONStreamingVariantSerializer;
+
+// The name of the case, and the type ID or the name once again, are quoted once per case, as they are first written.
+template <class JSON_FORMAT>
+class JSONStreamingVariantSerializer<json::JSONVariantStyle::Current, JSON_FORMAT> {
+ public:
+  explicit JSONStreamingVariantSerializer(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier)
+      : json_stringifier_(json_stringifier) {}
+
+  template <typename X>
+  std::enable_if_t<IS_CURRENT_STRUCT_OR_VARIANT(X)> operator()(const X& object) {
+    static const std::string prefix = Prefix<X>();
+    static const std::string suffix = Suffix<X>();
+    json_stringifier_.Output().append(prefix);
+    json_stringifier_.Inner(object);
+    json_stringifier_.Output().append(suffix);
+  }
+
+ private:
+  template <typename X>
+  static std::string Prefix() {
+    std::string result = "{";
+    json::JSONStreamingStringifier<JSON_FORMAT>(result).String(
+        reflection::CurrentTypeName<X, reflection::NameFormat::Z>());
+    return result + ':';
+  }
+
+  template <typename X>
+  static std::string Suffix() {
+    std::string result;
+    json::JSONStreamingStringifier<JSON_FORMAT> json_stringifier(result);
+    if (json::JSONVariantTypeIDInEmptyKey<JSON_FORMAT>::value) {
+      using namespace ::current::reflection;
+      result.append(",\"\":");
+      json_stringifier.Inner(Value<ReflectedTypeBase>(Reflector().ReflectType<X>()).type_id);
+    }
+    if (json::JSONVariantTypeNameInDollarKey<JSON_FORMAT>::value) {
+      result.append(",\"$\":");
+      json_stringifier.String(reflection::CurrentTypeName<X, reflection::NameFormat::Z>());
+    }
+    return result + '}';
+  }
+
+  json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier_;
+};
+
+template <class JSON_FORMAT>
+class JSONStreamingVariantSerializer<json::JSONVariantStyle::Simple, JSON_FORMAT>
+    : public JSONStreamingVariantSerializer<json::JSONVariantStyle::Current, JSON_FORMAT> {
+  using JSONStreamingVariantSerializer<json::JSONVariantStyle::Current, JSON_FORMAT>::JSONStreamingVariantSerializer;
+};
+
+template <class JSON_FORMAT>
+class JSONStreamingVariantSerializer<json::JSONVariantStyle::NewtonsoftFSharp, JSON_FORMAT> {
+ public:
+  explicit JSONStreamingVariantSerializer(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier)
+      : json_stringifier_(json_stringifier) {}
+
+  template <typename X>
+  std::enable_if_t<IS_CURRENT_STRUCT_OR_VARIANT(X)> operator()(const X& object) {
+    constexpr static bool has_fields = IS_CURRENT_VARIANT(X) || !IS_EMPTY_CURRENT_STRUCT(X);
+    static const std::string prefix = [&]() {
+      std::string result = "{\"Case\":";
+      json::JSONStreamingStringifier<JSON_FORMAT>(result).String(
+          reflection::CurrentTypeName<X, reflection::NameFormat::Z>());
+      return result + (has_fields ? ",\"Fields\":[" : "");
+    }();
+    json_stringifier_.Output().append(prefix);
+    if (has_fields) {
+      json_stringifier_.Inner(object);
+      json_stringifier_.Output() += ']';
+    }
+    json_stringifier_.Output() += '}';
+  }
+
+ private:
+  json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier_;
+};
+
+// The cases of the `Variant`, for the streaming parser to look them up by their names.
+template <class JSON_FORMAT, typename VARIANT>
+class JSONStreamingVariantCases final {
+ public:
+  using parser_t = JSONStreamingParser<JSON_FORMAT>;
+
+  struct Case final {
+    std::string name;
+    reflection::TypeID type_id;
+    void (*parse)(parser_t&, VARIANT&);
+    void (*construct_empty)(VARIANT&);  // For the empty `CURRENT_STRUCT`-s only, which F# has no `"Fields"` for.
+  };
+
+  template <typename X>
+  struct Registerer {
+    Registerer(std::vector<Case>& cases) {
+      using namespace ::current::reflection;
+      cases.push_back(Case{CurrentTypeName<X, NameFormat::Z>(),
+                           Value<ReflectedTypeBase>(Reflector().ReflectType<X>()).type_id,
+                           &Parse<X>,
+                           IS_EMPTY_CURRENT_STRUCT(X) ? &ConstructEmpty<X> : nullptr});
+    }
+  };
+
+  static const JSONStreamingVariantCases& Instance() {
+    static const JSONStreamingVariantCases instance;
+    return instance;
+  }
+
+  // The case named `name`, or `nullptr` if there is no such case.
+  const Case* Find(const char* name, size_t length) const {
+    for (const Case& c : cases_) {
+      if (c.name.length() == length && !std::memcmp(c.name.data(), name, length)) {
+        return &c;
+      }
+    }
+    return nullptr;
+  }
+
+  // The `Variant` with the cases of the same name, from different namespaces, is left to `JSONParser`.
+  bool HasAmbiguousNames() const { return has_ambiguous_names_; }
+
+ private:
+  JSONStreamingVariantCases() {
+    current::metaprogramming::call_all_constructors_with<Registerer, std::vector<Case>, typename VARIANT::typelist_t>(
+        cases_);
+    for (size_t i = 0u; i < cases_.size(); ++i) {
+      for (size_t j = 0u; j < i; ++j) {
+        if (cases_[i].name == cases_[j].name) {
+          has_ambiguous_names_ = true;
+        }
+      }
+    }
+  }
+
+  template <typename X>
+  static void Parse(parser_t& json_parser, VARIANT& destination) {
+    auto result = std::make_unique<X>();
+    Deserialize(json_parser, *result);
+    destination.UncheckedMoveFromUniquePtr(std::move(result));
+  }
+
+  template <typename X>
+  static void ConstructEmpty(VARIANT& destination) {
+    destination.UncheckedMoveFromUniquePtr(std::make_unique<X>());
+  }
+
+  std::vector<Case> cases_;
+  bool has_ambiguous_names_ = false;
+};
+
+template <JSONVariantStyle J, class JSON_FORMAT, typename VARIANT>
+struct JSONStreamingVariantPerStyle;
+
+// The case is parsed by its name, and then the type ID, which follows it in the output of `JSON()`, is checked.
+template <class JSON_FORMAT, typename VARIANT>
+struct JSONStreamingVariantPerStyle<JSONVariantStyle::Current, JSON_FORMAT, VARIANT> {
+  using cases_t = JSONStreamingVariantCases<JSON_FORMAT, VARIANT>;
+  static void DoLoadVariant(JSONStreamingParser<JSON_FORMAT>& json_parser,
+                            const cases_t& cases,
+                            VARIANT& destination) {
+    const typename cases_t::Case* parsed_case = nullptr;
+    bool has_type_id = false;
+    reflection::TypeID type_id = reflection::TypeID::UninitializedType;
+    json_parser.ForEachMember([&](const char* key, size_t length) {
+      if (!length) {
+        if (has_type_id) {
+          json_parser.Fallback();
+        }
+        Deserialize(json_parser, type_id);
+        has_type_id = true;
+      } else if (const typename cases_t::Case* c = cases.Find(key, length)) {
+        if (parsed_case) {
+          json_parser.Fallback();
+        }
+        c->parse(json_parser, destination);
+        parsed_case = c;
+      } else {
+        json_parser.SkipValue();
+      }
+    });
+    if (!parsed_case || !has_type_id || parsed_case->type_id != type_id) {
+      json_parser.Fallback();
+    }
+  }
+};
+
+template <class JSON_FORMAT, typename VARIANT>
+struct JSONStreamingVariantPerStyle<JSONVariantStyle::Simple, JSON_FORMAT, VARIANT> {
+  using cases_t = JSONStreamingVariantCases<JSON_FORMAT, VARIANT>;
+  static void DoLoadVariant(JSONStreamingParser<JSON_FORMAT>& json_parser,
+                            const cases_t& cases,
+                            VARIANT& destination) {
+    bool parsed = false;
+    json_parser.ForEachMember([&](const char* key, size_t length) {
+      // Skip keys "" and "$" for "backwards" compatibility with the "Current" format.
+      if (!length || json_parser.KeyIs(key, length, "$")) {
+        json_parser.SkipValue();
+      } else {
+        const typename cases_t::Case* c = cases.Find(key, length);
+        if (parsed || !c) {
+          json_parser.Fallback();
+        }
+        c->parse(json_parser, destination);
+        parsed = true;
+      }
+    });
+    if (!parsed) {
+      json_parser.Fallback();
+    }
+  }
+};
+
+// Only the `"Case"` followed by the `"Fields"`, if any, as `JSON()` outputs them, is parsed right away.
+template <class JSON_FORMAT, typename VARIANT>
+struct JSONStreamingVariantPerStyle<JSONVariantStyle::NewtonsoftFSharp, JSON_FORMAT, VARIANT> {
+  using cases_t = JSONStreamingVariantCases<JSON_FORMAT, VARIANT>;
+  static void DoLoadVariant(JSONStreamingParser<JSON_FORMAT>& json_parser,
+                            const cases_t& cases,
+                            VARIANT& destination) {
+    const typename cases_t::Case* parsed_case = nullptr;
+    bool has_fields = false;
+    json_parser.ForEachMember([&](const char* key, size_t length) {
+      if (json_parser.KeyIs(key, length, "Case")) {
+        if (parsed_case) {
+          json_parser.Fallback();
+        }
+        std::string case_name;
+        json_parser.String(case_name);
+        parsed_case = cases.Find(case_name.data(), case_name.length());
+        if (!parsed_case) {
+          json_parser.Fallback();
+        }
+      } else if (json_parser.KeyIs(key, length, "Fields")) {
+        if (!parsed_case || has_fields) {
+          json_parser.Fallback();
+        }
+        size_t count = 0u;
+        json_parser.ForEachElement([&]() {
+          if (count++) {
+            json_parser.Fallback();
+          }
+          parsed_case->parse(json_parser, destination);
+        });
+        has_fields = (count == 1u);
+      } else {
+        json_parser.SkipValue();
+      }
+    });
+    if (!parsed_case) {
+      json_parser.Fallback();
+    }
+    if (!has_fields) {
+      if (!parsed_case->construct_empty) {
+        json_parser.Fallback();
+      }
+      parsed_case->construct_empty(destination);
+    }
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct JSONStreamingMissingValue<JSON_FORMAT, T, std::enable_if_t<IS_CURRENT_VARIANT(T)>> {
+  static void Apply(T&) {
+    if (JSONVariantStyleUseNulls<JSON_FORMAT::variant_style>::value) {
+      JSONStreamingParser<JSON_FORMAT>::Fallback();
+    }
+  }
+};
+
+}  // namespace current::serialization::json
+
+template <class JSON_FORMAT, typename T>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, T, std::enable_if_t<IS_CURRENT_VARIANT(T)>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier, const T& value) {
+    if (Exists(value)) {
+      json::JSONStreamingVariantSerializer<JSON_FORMAT::variant_style, JSON_FORMAT> impl(json_stringifier);
+      value.Call(impl);
+    } else {
+      if (json::JSONVariantStyleUseNulls<JSON_FORMAT::variant_style>::value) {
+        json_stringifier.Null();
+      } else {
+        json_stringifier.MarkAsAbsentValue();
+      }
+    }
+  }
+};
+
+template <class JSON_FORMAT, typename T>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, T, std::enable_if_t<IS_CURRENT_VARIANT(T)>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, T& value) {
+    if (json_parser.TryNull()) {
+      if (json::JSONVariantStyleUseNulls<JSON_FORMAT::variant_style>::value) {
+        json_parser.Fallback();
+      }
+    } else {
+      const auto& cases = json::JSONStreamingVariantCases<JSON_FORMAT, T>::Instance();
+      if (cases.HasAmbiguousNames()) {
+        json_parser.Fallback();
+      }
+      json::JSONStreamingVariantPerStyle<JSON_FORMAT::variant_style, JSON_FORMAT, T>::DoLoadVariant(
+          json_parser, cases, value);
+    }
+  }
+};
+
 }  // namespace current::serialization
 }  // namespace current
 
@@ -90,6 +90,55 @@ struct DeserializeImpl<json::JSONParser<JSON_FORMAT>, std::vector<bool, TA>> {
   }
 };
 
+template <class JSON_FORMAT, typename T, typename TA>
+struct SerializeImpl<json::JSONStreamingStringifier<JSON_FORMAT>, std::vector<T, TA>> {
+  static void DoSerialize(json::JSONStreamingStringifier<JSON_FORMAT>& json_stringifier,
+                          const std::vector<T, TA>& value) {
+    json_stringifier.Output() += '[';
+    bool first = true;
+    for (const auto& element : value) {
+      if (!first) {
+        json_stringifier.Output() += ',';
+      }
+      first = false;
+      json_stringifier.Inner(static_cast<const T&>(element));
+    }
+    json_stringifier.Output() += ']';
+  }
+};
+
+// As with `JSONParser`, the elements already in the vector are parsed into, not replaced.
+template <class JSON_FORMAT, typename T, typename TA>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, std::vector<T, TA>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, std::vector<T, TA>& destination) {
+    size_t size = 0u;
+    json_parser.ForEachElement([&]() {
+      if (size == destination.size()) {
+        destination.emplace_back();
+      }
+      Deserialize(json_parser, destination[size++]);
+    });
+    destination.resize(size);
+  }
+};
+
+template <class JSON_FORMAT, typename TA>
+struct DeserializeImpl<json::JSONStreamingParser<JSON_FORMAT>, std::vector<bool, TA>> {
+  static void DoDeserialize(json::JSONStreamingParser<JSON_FORMAT>& json_parser, std::vector<bool, TA>& destination) {
+    size_t size = 0u;
+    json_parser.ForEachElement([&]() {
+      const bool element = json_parser.Bool();
+      if (size == destination.size()) {
+        destination.push_back(element);
+      } else {
+        destination[size] = element;
+      }
+      ++size;
+    });
+    destination.resize(size);
+  }
+};
+
 namespace json {
 template <typename T, typename ALLOC>
 struct IsJSONSerializable<std::vector<T, ALLOC>> {
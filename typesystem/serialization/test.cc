@@ -117,6 +117,11 @@ CURRENT_STRUCT(WithNontrivialUnorderedSet) {
   CURRENT_FIELD(s, (std::unordered_set<Serializable, current::GenericHashFunction<Serializable>>));
 };
 
+CURRENT_STRUCT(WithUnorderedContainers) {
+  CURRENT_FIELD(m, (std::unordered_map<std::string, Serializable>));
+  CURRENT_FIELD(s, std::unordered_set<std::string>);
+};
+
 CURRENT_STRUCT(WithOptional) {
   CURRENT_FIELD(i, Optional<int>);
   CURRENT_FIELD(b, Optional<bool>);
@@ -181,8 +186,6 @@ CURRENT_STRUCT(WithInnerVariant) { CURRENT_FIELD(v, InnerVariant); };
 }  // namespace serialization_test::named_variant
 }  // namespace serialization_test
 
-#if 0
-// TODO(dkorolev): DIMA FIXME binary format.
 TEST(Serialization, Binary) {
   using namespace serialization_test;
 
@@ -252,8 +255,15 @@ TEST(Serialization, Binary) {
     std::istringstream is("Invalid");
     ASSERT_THROW(LoadFromBinary<ComplexSerializable>(is), BinaryLoadFromStreamException);
   }
+  {
+    // The length of the body is not trusted: a frame claiming a huge body, with none after it, fails to load cleanly.
+    const std::string frame = SaveIntoBinary(Serializable(1, "one", false, Enum::DEFAULT));
+    std::string header = frame.substr(0u, current::serialization::binary::kBinaryFormatHeaderLength);
+    header += std::string(8u, static_cast<char>(0xff)) + '\x7f';
+    std::istringstream is(header + "body");
+    ASSERT_THROW(LoadFromBinary<Serializable>(is), BinaryLoadFromStreamException);
+  }
 }
-#endif
 
 TEST(JSONSerialization, CPPTypes) {
   using namespace serialization_test;
@@ -363,8 +373,6 @@ TEST(JSONSerialization, Tuple) {
   }
 }
 
-#if 0
-// TODO(dkorolev): DIMA FIXME binary format.
 TEST(Serialization, OptionalAsBinary) {
   using namespace serialization_test;
 
@@ -407,7 +415,6 @@ TEST(Serialization, OptionalAsBinary) {
     EXPECT_TRUE(Value(parsed_with_b.b));
   }
 }
-#endif
 
 TEST(JSONSerialization, CurrentStructs) {
   using namespace serialization_test;
@@ -876,8 +883,6 @@ TEST(JSONSerialization, Time) {
   }
 }
 
-#if 0
-// TODO(dkorolev): DIMA FIXME binary format.
 TEST(Serialization, TimeAsBinary) {
   using namespace serialization_test;
 
@@ -885,7 +890,8 @@ TEST(Serialization, TimeAsBinary) {
     WithTime zero;
     std::ostringstream oss;
     SaveIntoBinary(oss, zero);
-    EXPECT_EQ(16u, oss.str().length());
+    // The signature, the schema fingerprint, the ten bytes of the length of the body, and the two one byte varints.
+    EXPECT_EQ(4u + 8u + 10u + 2u, oss.str().length());
   }
 
   {
@@ -900,7 +906,123 @@ TEST(Serialization, TimeAsBinary) {
     EXPECT_EQ(6ll, parsed.micros.count());
   }
 }
-#endif
+
+TEST(Serialization, IntegersAsBinary) {
+  const auto Size = [](const auto& x) { return SaveIntoBinary(x).length() - (4u + 8u + 10u); };
+  EXPECT_EQ(1u, Size(static_cast<uint64_t>(0u)));
+  EXPECT_EQ(1u, Size(static_cast<uint64_t>(127u)));
+  EXPECT_EQ(2u, Size(static_cast<uint64_t>(128u)));
+  EXPECT_EQ(10u, Size(std::numeric_limits<uint64_t>::max()));
+  EXPECT_EQ(1u, Size(static_cast<int32_t>(-1)));
+  EXPECT_EQ(1u, Size(static_cast<int32_t>(63)));
+  EXPECT_EQ(2u, Size(static_cast<int32_t>(-65)));
+  EXPECT_EQ(5u, Size(std::numeric_limits<int32_t>::min()));
+  EXPECT_EQ(1u, Size(static_cast<uint8_t>(255u)));
+  EXPECT_EQ(1u, Size('x'));
+  EXPECT_EQ(4u, Size(1.0f));
+  EXPECT_EQ(8u, Size(1.0));
+
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(),
+            LoadFromBinary<uint64_t>(SaveIntoBinary(std::numeric_limits<uint64_t>::max())));
+  EXPECT_EQ(std::numeric_limits<int64_t>::min(),
+            LoadFromBinary<int64_t>(SaveIntoBinary(std::numeric_limits<int64_t>::min())));
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(),
+            LoadFromBinary<int64_t>(SaveIntoBinary(std::numeric_limits<int64_t>::max())));
+  EXPECT_EQ(-42, LoadFromBinary<int16_t>(SaveIntoBinary(static_cast<int16_t>(-42))));
+  EXPECT_EQ(-42, LoadFromBinary<int8_t>(SaveIntoBinary(static_cast<int8_t>(-42))));
+  EXPECT_EQ(0.1f, LoadFromBinary<float>(SaveIntoBinary(0.1f)));
+  EXPECT_EQ(-1e-300, LoadFromBinary<double>(SaveIntoBinary(-1e-300)));
+  EXPECT_EQ(std::string("a\0b", 3), LoadFromBinary<std::string>(SaveIntoBinary(std::string("a\0b", 3))));
+}
+
+TEST(Serialization, VariantAndContainersAsBinary) {
+  using namespace serialization_test;
+  using namespace serialization_test::named_variant;
+
+  {
+    ContainsVariant object;
+    object.variant = ComplexSerializable('a', 'c');
+    const auto parsed = LoadFromBinary<ContainsVariant>(SaveIntoBinary(object));
+    ASSERT_TRUE(Exists<ComplexSerializable>(parsed.variant));
+    EXPECT_EQ(JSON(object), JSON(parsed));
+  }
+  {
+    OuterB outer;
+    T t;
+    t.t = 42;
+    outer.b = t;
+    const WrappedQ object = outer;
+    EXPECT_EQ(JSON(object), JSON(LoadFromBinary<WrappedQ>(SaveIntoBinary(object))));
+  }
+  {
+    WithInnerVariant object;
+    WithVectorOfPairs with_vector_of_pairs;
+    with_vector_of_pairs.v.emplace_back(-1, "minus one");
+    with_vector_of_pairs.v.emplace_back(100, "one hundred");
+    object.v = with_vector_of_pairs;
+    EXPECT_EQ(JSON(object), JSON(LoadFromBinary<WithInnerVariant>(SaveIntoBinary(object))));
+  }
+  {
+    WithUnorderedContainers object;
+    object.m["one"] = Serializable(1, "one", true, Enum::SET);
+    object.m["two"] = Serializable(2);
+    object.s.insert("foo");
+    object.s.insert("bar");
+    const auto parsed = LoadFromBinary<WithUnorderedContainers>(SaveIntoBinary(object));
+    ASSERT_EQ(2u, parsed.m.size());
+    EXPECT_EQ("one", parsed.m.at("one").s);
+    EXPECT_EQ(Enum::SET, parsed.m.at("one").e);
+    EXPECT_EQ(2u, parsed.m.at("two").i);
+    EXPECT_EQ(2u, parsed.s.size());
+    EXPECT_EQ(1u, parsed.s.count("foo"));
+  }
+  {
+    const std::map<std::string, Optional<double>> object{{"pi", 3.14}, {"none", nullptr}};
+    EXPECT_EQ(JSON(object), JSON(LoadFromBinary<std::map<std::string, Optional<double>>>(SaveIntoBinary(object))));
+  }
+  {
+    const std::vector<bool> object{true, false, true};
+    EXPECT_EQ(object, LoadFromBinary<std::vector<bool>>(SaveIntoBinary(object)));
+  }
+}
+
+TEST(Serialization, BinaryExceptions) {
+  using namespace serialization_test;
+
+  const std::string binary = SaveIntoBinary(ComplexSerializable('a', 'z'));
+
+  // A different schema, even if just by the name of a field, is rejected.
+  ASSERT_THROW(LoadFromBinary<WithTime>(binary), BinarySchemaMismatchException);
+  ASSERT_THROW(LoadFromBinary<WithTrivialMap>(SaveIntoBinary(WithTrivialSet())), BinarySchemaMismatchException);
+
+  // Truncated input, input with trailing bytes, and input with the length of the body not matching it.
+  ASSERT_THROW(LoadFromBinary<ComplexSerializable>(binary.substr(0u, 10u)), BinaryLoadFromStreamException);
+  ASSERT_THROW(LoadFromBinary<ComplexSerializable>(binary.substr(0u, binary.length() - 1u)),
+               BinaryLoadFromStreamException);
+  ASSERT_THROW(LoadFromBinary<ComplexSerializable>(binary + '\0'), BinaryLoadFromStreamException);
+  {
+    std::istringstream is(binary.substr(0u, binary.length() - 1u));
+    ASSERT_THROW(LoadFromBinary<ComplexSerializable>(is), BinaryLoadFromStreamException);
+  }
+  {
+    std::string malformed = binary;
+    malformed[0] = 'X';
+    ASSERT_THROW(LoadFromBinary<ComplexSerializable>(malformed), BinaryLoadFromStreamException);
+  }
+
+  // An uninitialized `Variant` can be saved, but not loaded, as it is the case with JSON.
+  ASSERT_THROW(LoadFromBinary<ContainsVariant>(SaveIntoBinary(ContainsVariant())),
+               BinaryUninitializedVariantObjectException);
+
+  // Integers out of range of the type are rejected, not truncated.
+  {
+    std::string body;
+    current::serialization::binary::BinarySerializer(body).Varint(70000u);
+    uint16_t value;
+    current::serialization::binary::BinaryDeserializer deserializer(body.data(), body.data() + body.length());
+    ASSERT_THROW(current::serialization::Deserialize(deserializer, value), BinaryLoadFromStreamException);
+  }
+}
 
 TEST(JSONSerialization, Optional) {
   using namespace serialization_test;
@@ -1654,4 +1776,133 @@ TEST(JSONSerialization, CanSerializeWithSubtypesOfTInCurrentStructT) {
   EXPECT_EQ("{'x':{'xs':'hello','xv':['world']}}", SingleQuoted(JSON(ds)));
 }
 
+namespace serialization_test {
+
+CURRENT_STRUCT(StreamingJSONScalars) {
+  CURRENT_FIELD(i8, int8_t, -128);
+  CURRENT_FIELD(u16, uint16_t, 65535u);
+  CURRENT_FIELD(i64, int64_t, std::numeric_limits<int64_t>::min());
+  CURRENT_FIELD(u64, uint64_t, std::numeric_limits<uint64_t>::max());
+  CURRENT_FIELD(c, char, 'x');
+  CURRENT_FIELD(f, float, 0.1f);
+  CURRENT_FIELD(d, std::vector<double>);
+  CURRENT_FIELD(s, std::string, "\"quoted\"\\ \b\f\n\r\t\x01\x1f/\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82");
+  CURRENT_FIELD(b, std::vector<bool>);
+  CURRENT_FIELD(e, Enum, Enum::SET);
+  CURRENT_FIELD(t, std::chrono::microseconds, std::chrono::microseconds(-1));
+};
+
+CURRENT_STRUCT(StreamingJSONContainers, StreamingJSONScalars) {
+  CURRENT_FIELD(none, Optional<int32_t>);
+  CURRENT_FIELD(some, Optional<std::string>, std::string("some"));
+  CURRENT_FIELD(pairs, (std::vector<std::pair<int32_t, std::string>>));
+  CURRENT_FIELD(trivial_map, (std::map<std::string, Optional<int32_t>>));
+  CURRENT_FIELD(nontrivial_map, (std::map<Serializable, std::string>));
+  CURRENT_FIELD(unordered, WithUnorderedContainers);
+  CURRENT_FIELD(set, std::set<std::string>);
+  CURRENT_FIELD(variant, simple_variant_t);
+  CURRENT_FIELD(variants, std::vector<simple_variant_t>);
+  CURRENT_FIELD(nested, named_variant::WrappedQ);
+  CURRENT_FIELD(empty_variant, named_variant::InnerVariant);
+  CURRENT_FIELD(derived, DerivedSerializable);
+};
+
+}  // namespace serialization_test
+
+// Makes sure the streaming stringifier and parser are byte-for-byte the same as those via RapidJSON DOM, and that the
+// streaming parser parses what `JSON()` outputs right away, with no fallback to RapidJSON DOM.
+template <class J, typename T>
+void StreamingJSONTest(const T& object) {
+  using namespace current::serialization::json;
+  const std::string json = JSON<J>(object);
+  EXPECT_EQ(JSONViaRapidJSON<J>(object), json);
+  T result;
+  JSONStreamingParser<J> json_parser(json.c_str());
+  ASSERT_NO_THROW(current::serialization::Deserialize(json_parser, result));
+  ASSERT_NO_THROW(json_parser.ExpectEnd());
+  EXPECT_EQ(json, JSON<J>(result));
+  T result_via_rapidjson;
+  ParseJSONViaRapidJSON<J>(json.c_str(), result_via_rapidjson);
+  EXPECT_EQ(json, JSON<J>(result_via_rapidjson));
+}
+
+TEST(JSONSerialization, StreamingMatchesRapidJSON) {
+  using namespace serialization_test;
+
+  StreamingJSONContainers object;
+  object.d = {0.0, -0.0, 0.5, 1e-7, 3.14159265358979, 1e300, -2.5e-300};
+  object.b = {true, false, true};
+  object.pairs.emplace_back(-1, "minus one");
+  object.pairs.emplace_back(42, "");
+  object.trivial_map["a"] = 1;
+  object.trivial_map["b"] = nullptr;
+  object.trivial_map["\n"] = 3;
+  object.nontrivial_map[Serializable(2, "two", true, Enum::SET)] = "2";
+  object.unordered.m["one"] = Serializable(1);
+  object.unordered.s.insert("x");
+  object.set = {"x", "y"};
+  object.variant = Serializable(1, "one", false, Enum::DEFAULT);
+  object.variants.push_back(Empty());
+  object.variants.push_back(ComplexSerializable('a', 'c'));
+  object.nested = named_variant::OuterB();
+  Value<named_variant::OuterB>(object.nested).b = named_variant::T();
+  object.derived.d = 0.25;
+
+  // The uninitialized `Variant` is not allowed in the `Current` and `NewtonsoftFSharp` formats.
+  StreamingJSONTest<JSONFormat::Minimalistic>(object);
+  StreamingJSONTest<JSONFormat::JavaScript>(object);
+  object.empty_variant = WithOptional();
+  StreamingJSONTest<JSONFormat::Current>(object);
+  StreamingJSONTest<JSONFormat::Minimalistic>(object);
+  StreamingJSONTest<JSONFormat::JavaScript>(object);
+  StreamingJSONTest<JSONFormat::NewtonsoftFSharp>(object);
+
+  StreamingJSONTest<JSONFormat::Current>(std::make_tuple(1, std::string("two"), 3.0));
+  StreamingJSONTest<JSONFormat::NewtonsoftFSharp>(std::make_pair(std::string("one"), Optional<int32_t>(1)));
+  StreamingJSONTest<JSONFormat::Minimalistic>(Optional<int32_t>());
+  StreamingJSONTest<JSONFormat::Current>(std::string("top-level string"));
+  StreamingJSONTest<JSONFormat::Current>(std::vector<Optional<bool>>{true, nullptr});
+}
+
+TEST(JSONSerialization, StreamingParser) {
+  using namespace serialization_test;
+
+  // Whitespace, escape sequences, unknown keys, and keys out of order are parsed with no fallback.
+  {
+    const char* json =
+        " {\"unknown\" : [ 1, {\"x\": null}, \"\\u0041\" ], \"s\":\"\\u0041\\n\\\"\",\t\"b\" : true,\n"
+        "\"e\":100, \"i\" :\r 12345678901234567890 } ";
+    current::serialization::json::JSONStreamingParser<JSONFormat::Current> json_parser(json);
+    Serializable result;
+    ASSERT_NO_THROW(current::serialization::Deserialize(json_parser, result));
+    ASSERT_NO_THROW(json_parser.ExpectEnd());
+    EXPECT_EQ(12345678901234567890ull, result.i);
+    EXPECT_EQ("A\n\"", result.s);
+    EXPECT_TRUE(result.b);
+    EXPECT_EQ(Enum::SET, result.e);
+  }
+
+  // Duplicate keys are left to RapidJSON DOM, where the first one wins.
+  EXPECT_EQ(1u, ParseJSON<Serializable>("{\"i\":1,\"s\":\"\",\"b\":false,\"e\":0,\"i\":2}").i);
+
+  // So are the malformed JSONs, with the same exceptions as before.
+  ASSERT_THROW(ParseJSON<Serializable>("{\"i\":1,\"s\":\"\",\"b\":false,\"e\":0,}"), InvalidJSONException);
+  ASSERT_THROW(ParseJSON<Serializable>("{\"i\":1,\"s\":\"\",\"b\":false,\"e\":0} 1"), InvalidJSONException);
+  ASSERT_THROW(ParseJSON<Serializable>("{\"i\":01,\"s\":\"\",\"b\":false,\"e\":0}"), InvalidJSONException);
+  ASSERT_THROW(ParseJSON<Serializable>("{\"i\":-1,\"s\":\"\",\"b\":false,\"e\":0}"), JSONSchemaException);
+  ASSERT_THROW(ParseJSON<ContainsVariant>("{\"variant\":null}"), JSONUninitializedVariantObjectException);
+
+  // The output of non-finite numbers is what it has been, via RapidJSON DOM.
+  Double d;
+  d.x = std::numeric_limits<double>::infinity();
+  EXPECT_EQ(current::serialization::json::JSONViaRapidJSON<JSONFormat::Current>(d), JSON(d));
+
+  // The output is appended to the string, which can be reused.
+  std::string output = "[";
+  AppendJSON(output, Int());
+  output += ',';
+  AppendJSON<JSONFormat::Minimalistic>(output, WithOptional());
+  EXPECT_EQ("[{\"x\":0},{}", output);
+}
+
 #endif  // CURRENT_TYPE_SYSTEM_SERIALIZATION_TEST_CC